@@ -22,6 +22,7 @@ Copyright Glare Technologies Limited 2024 -
 #include <resonance_audio/api/resonance_audio_api.h>
 #include <tracy/Tracy.hpp>
 #include <limits>
+#include <algorithm>
 
 
 #define USE_MINIAUDIO 1
@@ -68,7 +69,8 @@ namespace glare
 
 AudioSource::AudioSource()
 :	resonance_handle(INVALID_RESONANCE_HANDLE), cur_read_i(0), type(SourceType_NonStreaming), spatial_type(SourceSpatialType_Spatial), paused(false), looping(true), remove_on_finish(false), volume(1.f), mute_volume_factor(1.f), mute_change_start_time(-2), mute_change_end_time(-1), mute_vol_fac_start(1.f),
-	mute_vol_fac_end(1.f), pos(0,0,0,1), num_occlusions(0), userdata_1(0), doppler_factor(1), smoothed_cur_level(0), sampling_rate(44100), EOF_marker_position(std::numeric_limits<int64>::max())
+	mute_vol_fac_end(1.f), pos(0,0,0,1), num_occlusions(0), userdata_1(0), doppler_factor(1), smoothed_cur_level(0), sampling_rate(44100), EOF_marker_position(std::numeric_limits<int64>::max()),
+	mixer_pos(0,0,0,1), mixer_volume(1.f), mixer_num_occlusions(0), voice_gain(0), in_mixer(false), is_real_voice(false)
 {}
 
 
@@ -172,8 +174,11 @@ float SoundFile::minVal() const
 
 AudioEngine::AudioEngine()
 :	audio(NULL),
+	device(NULL),
 	resonance(NULL),
-	initialised(false)
+	initialised(false),
+	command_queue(/*capacity=*/1 << 14),
+	finished_sources_queue(/*capacity=*/1 << 12)
 {
 
 }
@@ -335,12 +340,16 @@ static void zeroBuffer(js::Vector<float, 16>& v)
 }
 
 
-// Gets buffered audio data from audio sources, copies it to resonance buffers.
+// The mixer.
+// Applies commands from the main thread, chooses which sources are real voices, gets buffered audio data from audio sources and copies it to resonance buffers.
 // Then gets mixed data from resonance, puts on queue to rtAudioCallback.
+// The list of playing sources, and all Resonance source objects, are only accessed by this thread.
 class ResonanceThread : public MessageableThread
 {
 public:
-	ResonanceThread() : buffers_processed(0) {}
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	ResonanceThread() : buffers_processed(0), listener_pos(0,0,0,1) {}
 
 	virtual void doRun() override
 	{
@@ -362,182 +371,59 @@ public:
 				// For N = 4 this gives 0.0213 s = 21.3 ms of latency.
 				while(num_samples_buffered < (frames_per_buffer * 2) * 4)
 				{
-					bool filled_valid_buffer = false;
+					processCommands();
+
+					updateVoices();
+
+					// Set resonance audio buffers for all playing audio sources
+					for(size_t i=0; i<playing_sources.size(); )
 					{
-						Lock lock(engine->mutex);
+						AudioSource* source = playing_sources[i].ptr();
 
-						// Set resonance audio buffers for all audio sources
-						for(auto it = engine->active_audio_sources.begin(); it != engine->active_audio_sources.end(); )
+						bool stop_source_playing;
+						if(source->type == AudioSource::SourceType_Streaming)
+						{
+							// Streaming source data is written by StreamerThread etc., so hold the engine mutex while reading it.
+							Lock lock(engine->mutex);
+							stop_source_playing = processSource(source);
+						}
+						else
+							stop_source_playing = processSource(source);
+
+						if(stop_source_playing)
 						{
-							AudioSource* source = it->ptr();
-							bool remove_source = false;
-
-							const int source_sampling_rate = source->sampling_rate;
-							const int resonance_sampling_rate = engine->getSampleRate();
-
-							size_t src_samples_needed;
-							if(source_sampling_rate == resonance_sampling_rate)
-								src_samples_needed = frames_per_buffer;
-							else
-								src_samples_needed = (int)source->resampler.numSrcSamplesNeeded(frames_per_buffer);
-
-							temp_buf.resizeNoCopy(src_samples_needed);
-
-							const float* contiguous_data_ptr = temp_buf.data(); // Pointer to a buffer of contiguous source samples.
-							// Will either point into an existing shared buffer, or at the start of temp_buf if we need to use it.
-
-							if(source->type == AudioSource::SourceType_NonStreaming)
-							{
-								if(source->shared_buffer.nonNull()) // If we are reading from shared_buffer:
-								{
-									if(source->cur_read_i + src_samples_needed <= source->shared_buffer->buffer.size()) // If we can just copy the current buffer range directly from source->buffer:
-									{
-										contiguous_data_ptr = &source->shared_buffer->buffer[source->cur_read_i];
-										
-										source->cur_read_i += src_samples_needed;
-										if(source->looping && (source->cur_read_i == source->shared_buffer->buffer.size())) // If reached end of buf, and this is a looping audio source:
-											source->cur_read_i = 0; // wrap
-									}
-									else
-									{
-										// The data range we want to read from the shared buffer exceeds the shared buffer length.  Just read as much data as we can and then pad with zeroes, or wrap the source index.
-										// Copy data to a temporary contiguous buffer
-										size_t cur_i = source->cur_read_i;
-
-										const size_t source_buffer_size = source->shared_buffer->buffer.size();
-										for(size_t i=0; i<src_samples_needed; ++i)
-										{
-											// TODO: optimise: do simple copy in 2 sections.
-											if(cur_i < source_buffer_size)
-											{
-												temp_buf[i] = source->shared_buffer->buffer[cur_i++];
-
-												if(source->looping && (cur_i == source_buffer_size)) // If reached end of buf, and this is a looping audio source:
-													cur_i = 0; // Reset read index back to start of buffer.
-											}
-											else
-											{
-												temp_buf[i] = 0;
-											}
-										}
-										source->cur_read_i = cur_i;
-										remove_source = source->remove_on_finish && (cur_i >= source_buffer_size); // Remove the source if we reached the end of the buffer.
-									}
-								}
-								else // Else if we are reading from a circular buffer:
-								{
-									assert(0); // SourceType_OneShot sources should only read from shared buffers.
-									zeroBuffer(temp_buf); // Just pass zeroes to resonance so as to not blow up the listener's ears.
-								}
-							}
-							else if(source->type == AudioSource::SourceType_Streaming)
-							{
-								if(!source->mix_sources.empty())
-								{
-									// Mix together the audio sources, applying pitch shift factor and volume factor.
-									zeroBuffer(temp_buf);
-
-									for(size_t z=0; z<source->mix_sources.size(); ++z)
-									{
-										MixSource& mix_source = source->mix_sources[z];
-										const size_t src_buffer_size  = mix_source.soundfile->buf->buffer.size();
-										const float* const src_buffer = mix_source.soundfile->buf->buffer.data();
-
-										for(size_t i=0; i<src_samples_needed; ++i)
-										{
-											mix_source.sound_file_i += mix_source.source_delta; // Advance floating-point read index (index into source buffer)
-
-											const size_t index   = (size_t)mix_source.sound_file_i % src_buffer_size;
-											const size_t index_1 = (index + 1)                     % src_buffer_size;
-											const float frac = (float)(mix_source.sound_file_i - (size_t)mix_source.sound_file_i);
-
-											const float sample = src_buffer[index] * (1 - frac) + src_buffer[index_1] * frac;
-											temp_buf[i] += sample * mix_source.mix_factor;
-										}
-									}
-								}
-								else
-								{
-									if(source->buffer.size() >= src_samples_needed) // If there is sufficient data in the circular buffer:
-									{
-										// Copy data to temp_buf before we pop it from the source buffer.  NOTE: Could optimise by popping later, after we process the data, to avoid copying to temp_buf.
-										source->buffer.popFrontNItems(/*dest=*/temp_buf.data(), src_samples_needed);
-									}
-									else
-									{
-										//conPrint("Ran out of data for streaming audio src!");
-										const size_t source_buf_size = source->buffer.size();
-										source->buffer.popFrontNItems(/*dest=*/temp_buf.data(), source_buf_size); // Copy the data that there is to temp_buf
-										for(size_t i=source_buf_size; i<src_samples_needed; ++i) // Pad the rest with zeroes.
-											temp_buf[i] = 0.f;
-									}
-								}
-							}
-							else
-								runtimeCheckFailed("Invalid source->type");
-
-							runtimeCheck(contiguous_data_ptr != NULL);
-							if(source_sampling_rate == resonance_sampling_rate)
-							{
-								const float* bufptr = contiguous_data_ptr;
-								resonance->SetPlanarBuffer(source->resonance_handle, &bufptr, /*num channels=*/1, frames_per_buffer);
-							}
-							else
-							{
-								// Resample audio to the audio engine and Resonance sampling rate.
-								resampled_buf.resizeNoCopy(frames_per_buffer);
-								
-								source->resampler.resample(resampled_buf.data(), frames_per_buffer, contiguous_data_ptr, src_samples_needed, temp_resampling_buf);
-
-								const float* bufptr = resampled_buf.data();
-								resonance->SetPlanarBuffer(source->resonance_handle, &bufptr, /*num channels=*/1, frames_per_buffer);
-							}
-
-							source->EOF_marker_position -= (int64)src_samples_needed;
-							const bool stream_reached_EOF = source->EOF_marker_position <= 0;
-
-							const bool stop_source_playing = remove_source || (!source->looping && stream_reached_EOF);
-
-							if(remove_source)
-							{
-								// conPrint("ResonanceThread: removing audio source.");
-								engine->audio_sources.erase(*it);
-							}
-
-							if(stop_source_playing)
-							{
-								// Remove the audio source from Resonance and remove from active_audio_sources.
-								// conPrint("ResonanceThread: stopping source playing: removing from resonance and active_audio_sources.");
-								resonance->DestroySource(source->resonance_handle);
-								source->resonance_handle = INVALID_RESONANCE_HANDLE;
-								
-								it = engine->active_audio_sources.erase(it);  // Remove currently iterated to source, advance iterator.
-							}
-							else
-								++it;
-						} // End for each audio source
-
-						// Get mixed/filtered data from Resonance.
-						temp_buf.resizeNoCopy(frames_per_buffer * 2); // We will receive stereo data
-						filled_valid_buffer = resonance->FillInterleavedOutputBuffer(
-							2, // num channels
-							frames_per_buffer, // num frames
-							temp_buf.data()
-						);
-
-						buffers_processed++;
-
-						//for(size_t i=0; i<10; ++i)
-						//	conPrint("buf[" + toString(i) + "]: " + toString(buf[i]));
-						if(buffers_processed * frames_per_buffer < 48000) // Ignore first second or so of sound because resonance seems to fill it with garbage.
-							filled_valid_buffer = false;
-
-						if(!filled_valid_buffer)
-							break; // break while loop
-					} // End engine->mutex scope
+							// conPrint("ResonanceThread: stopping source playing.");
+							if(source->remove_on_finish)
+								pending_finished_sources.push_back(playing_sources[i]); // Tell the main thread to remove the source from audio_sources.
+
+							stopPlayingSource(i); // Swaps the last source into index i.
+						}
+						else
+							++i;
+					} // End for each audio source
+
+					while(!pending_finished_sources.empty() && engine->finished_sources_queue.tryPush(pending_finished_sources.back()))
+						pending_finished_sources.pop_back();
+
+					// Get mixed/filtered data from Resonance.
+					temp_buf.resizeNoCopy(frames_per_buffer * 2); // We will receive stereo data
+					bool filled_valid_buffer = resonance->FillInterleavedOutputBuffer(
+						2, // num channels
+						frames_per_buffer, // num frames
+						temp_buf.data()
+					);
+
+					buffers_processed++;
+
+					//for(size_t i=0; i<10; ++i)
+					//	conPrint("buf[" + toString(i) + "]: " + toString(buf[i]));
+					if(buffers_processed * frames_per_buffer < 48000) // Ignore first second or so of sound because resonance seems to fill it with garbage.
+						filled_valid_buffer = false;
+
+					if(!filled_valid_buffer)
+						break; // break while loop
 
 					// Push mixed/filtered data onto back of buffer that feeds to rtAudioCallback / miniaudioCallBack.
-					if(filled_valid_buffer)
 					{
 						Lock lock(callback_data->buffer_mutex);
 						callback_data->buffer.pushBackNItems(temp_buf.data(), frames_per_buffer * 2);
@@ -559,6 +445,316 @@ public:
 		die = 1;
 	}
 
+private:
+	void setMixerParamsFromCommand(AudioSource& source, const AudioEngineCommand& command)
+	{
+		if(command.vec.isFinite()) // Avoid crash in Resonance with NaN or Inf position coords.
+			source.mixer_pos = command.vec;
+		source.mixer_volume = command.volume;
+		source.mixer_num_occlusions = command.num_occlusions;
+	}
+
+	void startPlayingSource(const AudioSourceRef& source)
+	{
+		if(source->in_mixer)
+			return;
+
+		{
+			Lock lock(engine->mutex); // sampling_rate and resampler may be modified by StreamerThread.
+			source->resampler.init(/*src rate=*/source->sampling_rate, engine->getSampleRate());
+		}
+
+		source->in_mixer = true;
+		source->is_real_voice = false;
+		source->voice_gain = 1; // Start at full volume if the source is chosen as a real voice, so one-shot sounds aren't faded in.
+		playing_sources.push_back(source);
+	}
+
+	void stopPlayingSource(size_t index)
+	{
+		AudioSource* source = playing_sources[index].ptr();
+		destroyResonanceSource(*source);
+		source->in_mixer = false;
+		source->is_real_voice = false;
+
+		playing_sources[index] = playing_sources.back();
+		playing_sources.pop_back();
+	}
+
+	void createResonanceSource(AudioSource& source)
+	{
+		if(source.spatial_type == AudioSource::SourceSpatialType_Spatial)
+		{
+			source.resonance_handle = resonance->CreateSoundObjectSource(vraudio::RenderingMode::kBinauralHighQuality);
+			resonance->SetSourcePosition(source.resonance_handle, source.mixer_pos[0], source.mixer_pos[1], source.mixer_pos[2]);
+			resonance->SetSoundObjectOcclusionIntensity(source.resonance_handle, source.mixer_num_occlusions);
+		}
+		else
+		{
+			source.resonance_handle = resonance->CreateStereoSource(/*num channels=*/2);
+		}
+		resonance->SetSourceVolume(source.resonance_handle, source.mixer_volume * source.voice_gain);
+	}
+
+	void destroyResonanceSource(AudioSource& source)
+	{
+		if(source.resonance_handle != INVALID_RESONANCE_HANDLE)
+		{
+			resonance->DestroySource(source.resonance_handle);
+			source.resonance_handle = INVALID_RESONANCE_HANDLE;
+		}
+	}
+
+	void processCommands()
+	{
+		AudioEngineCommand command;
+		while(engine->command_queue.tryPop(command))
+		{
+			AudioSource* source = command.source.ptr();
+			switch(command.type)
+			{
+			case AudioEngineCommand::Type_AddSource:
+				setMixerParamsFromCommand(*source, command);
+				startPlayingSource(command.source);
+				break;
+			case AudioEngineCommand::Type_RemoveSource:
+				for(size_t i=0; i<playing_sources.size(); ++i)
+					if(playing_sources[i].ptr() == source)
+					{
+						stopPlayingSource(i);
+						break;
+					}
+				break;
+			case AudioEngineCommand::Type_SeekToStartAndUnpause:
+				setMixerParamsFromCommand(*source, command);
+				source->cur_read_i = 0;
+				startPlayingSource(command.source);
+				break;
+			case AudioEngineCommand::Type_SetSourcePosition:
+				source->mixer_pos = command.vec;
+				if(source->resonance_handle != INVALID_RESONANCE_HANDLE && source->spatial_type == AudioSource::SourceSpatialType_Spatial)
+					resonance->SetSourcePosition(source->resonance_handle, command.vec[0], command.vec[1], command.vec[2]);
+				break;
+			case AudioEngineCommand::Type_SetSourceVolume:
+				source->mixer_volume = command.volume;
+				if(source->resonance_handle != INVALID_RESONANCE_HANDLE)
+					resonance->SetSourceVolume(source->resonance_handle, source->mixer_volume * source->voice_gain);
+				break;
+			case AudioEngineCommand::Type_SetSourceOcclusion:
+				source->mixer_num_occlusions = command.num_occlusions;
+				if(source->resonance_handle != INVALID_RESONANCE_HANDLE && source->spatial_type == AudioSource::SourceSpatialType_Spatial)
+					resonance->SetSoundObjectOcclusionIntensity(source->resonance_handle, command.num_occlusions);
+				break;
+			case AudioEngineCommand::Type_SetHeadTransform:
+				listener_pos = command.vec;
+				resonance->SetHeadPosition(command.vec[0], command.vec[1], command.vec[2]);
+				resonance->SetHeadRotation(command.rot[0], command.rot[1], command.rot[2], command.rot[3]);
+				break;
+			}
+		}
+	}
+
+	// Choose the most audible sources as real voices, and fade real voices in and virtual voices out.
+	// Resonance source objects are created for sources becoming real voices, and destroyed for virtual voices once they have faded out.
+	void updateVoices()
+	{
+		voice_candidates.resize(playing_sources.size());
+		for(size_t i=0; i<playing_sources.size(); ++i)
+		{
+			const AudioSource* source = playing_sources[i].ptr();
+			float audibility = AudioEngine::computeSourceAudibility(source->spatial_type == AudioSource::SourceSpatialType_Spatial, source->mixer_volume, source->mixer_num_occlusions,
+				source->mixer_pos, listener_pos);
+			if(source->is_real_voice)
+				audibility *= 1.5f; // Favour current real voices, so that sources with similar audibility don't keep swapping.
+
+			voice_candidates[i].audibility = audibility;
+			voice_candidates[i].index = (uint32)i;
+		}
+
+		const size_t num_real_voices = AudioEngine::chooseRealVoices(voice_candidates, AudioEngine::MAX_NUM_REAL_VOICES);
+		for(size_t i=0; i<voice_candidates.size(); ++i)
+			playing_sources[voice_candidates[i].index]->is_real_voice = i < num_real_voices;
+
+		const float fade_delta = (float)frames_per_buffer / ((float)engine->getSampleRate() * AudioEngine::VOICE_FADE_TIME); // Change in voice_gain per buffer.
+
+		for(size_t i=0; i<playing_sources.size(); ++i)
+		{
+			AudioSource* source = playing_sources[i].ptr();
+			const float old_voice_gain = source->voice_gain;
+			if(source->is_real_voice)
+			{
+				if(source->resonance_handle == INVALID_RESONANCE_HANDLE)
+					createResonanceSource(*source);
+				source->voice_gain = myMin(1.f, source->voice_gain + fade_delta);
+			}
+			else
+			{
+				if(source->resonance_handle == INVALID_RESONANCE_HANDLE)
+					source->voice_gain = 0;
+				else
+				{
+					source->voice_gain = myMax(0.f, source->voice_gain - fade_delta);
+					if(source->voice_gain == 0) // If finished fading out:
+						destroyResonanceSource(*source);
+				}
+			}
+
+			if((source->resonance_handle != INVALID_RESONANCE_HANDLE) && (source->voice_gain != old_voice_gain))
+				resonance->SetSourceVolume(source->resonance_handle, source->mixer_volume * source->voice_gain);
+		}
+
+		engine->num_playing_sources = (int64)playing_sources.size();
+		engine->num_real_voices = (int64)num_real_voices;
+	}
+
+	// Reads the next buffer of samples from the source, and passes them to Resonance if the source has a Resonance source object.
+	// Sources without a Resonance source object (virtual voices) just have their read positions advanced.
+	// Returns true if the source has finished playing.
+	bool processSource(AudioSource* source)
+	{
+		const bool is_real = source->resonance_handle != INVALID_RESONANCE_HANDLE; // True for real voices, and virtual voices that are still fading out.
+		bool remove_source = false;
+
+		const int source_sampling_rate = source->sampling_rate;
+		const int resonance_sampling_rate = engine->getSampleRate();
+
+		size_t src_samples_needed;
+		if(source_sampling_rate == resonance_sampling_rate)
+			src_samples_needed = frames_per_buffer;
+		else
+			src_samples_needed = (int)source->resampler.numSrcSamplesNeeded(frames_per_buffer);
+
+		temp_buf.resizeNoCopy(src_samples_needed);
+
+		const float* contiguous_data_ptr = temp_buf.data(); // Pointer to a buffer of contiguous source samples.
+		// Will either point into an existing shared buffer, or at the start of temp_buf if we need to use it.
+
+		if(source->type == AudioSource::SourceType_NonStreaming)
+		{
+			if(source->shared_buffer.nonNull()) // If we are reading from shared_buffer:
+			{
+				if(source->cur_read_i + src_samples_needed <= source->shared_buffer->buffer.size()) // If we can just copy the current buffer range directly from source->buffer:
+				{
+					contiguous_data_ptr = &source->shared_buffer->buffer[source->cur_read_i];
+					
+					source->cur_read_i += src_samples_needed;
+					if(source->looping && (source->cur_read_i == source->shared_buffer->buffer.size())) // If reached end of buf, and this is a looping audio source:
+						source->cur_read_i = 0; // wrap
+				}
+				else
+				{
+					// The data range we want to read from the shared buffer exceeds the shared buffer length.  Just read as much data as we can and then pad with zeroes, or wrap the source index.
+					// Copy data to a temporary contiguous buffer
+					size_t cur_i = source->cur_read_i;
+
+					const size_t source_buffer_size = source->shared_buffer->buffer.size();
+					for(size_t i=0; i<src_samples_needed; ++i)
+					{
+						// TODO: optimise: do simple copy in 2 sections.
+						if(cur_i < source_buffer_size)
+						{
+							temp_buf[i] = source->shared_buffer->buffer[cur_i++];
+
+							if(source->looping && (cur_i == source_buffer_size)) // If reached end of buf, and this is a looping audio source:
+								cur_i = 0; // Reset read index back to start of buffer.
+						}
+						else
+						{
+							temp_buf[i] = 0;
+						}
+					}
+					source->cur_read_i = cur_i;
+					remove_source = source->remove_on_finish && (cur_i >= source_buffer_size); // Remove the source if we reached the end of the buffer.
+				}
+			}
+			else // Else if we are reading from a circular buffer:
+			{
+				assert(0); // SourceType_OneShot sources should only read from shared buffers.
+				zeroBuffer(temp_buf); // Just pass zeroes to resonance so as to not blow up the listener's ears.
+			}
+		}
+		else if(source->type == AudioSource::SourceType_Streaming)
+		{
+			if(!source->mix_sources.empty())
+			{
+				if(is_real)
+				{
+					// Mix together the audio sources, applying pitch shift factor and volume factor.
+					zeroBuffer(temp_buf);
+
+					for(size_t z=0; z<source->mix_sources.size(); ++z)
+					{
+						MixSource& mix_source = source->mix_sources[z];
+						const size_t src_buffer_size  = mix_source.soundfile->buf->buffer.size();
+						const float* const src_buffer = mix_source.soundfile->buf->buffer.data();
+
+						for(size_t i=0; i<src_samples_needed; ++i)
+						{
+							mix_source.sound_file_i += mix_source.source_delta; // Advance floating-point read index (index into source buffer)
+
+							const size_t index   = (size_t)mix_source.sound_file_i % src_buffer_size;
+							const size_t index_1 = (index + 1)                     % src_buffer_size;
+							const float frac = (float)(mix_source.sound_file_i - (size_t)mix_source.sound_file_i);
+
+							const float sample = src_buffer[index] * (1 - frac) + src_buffer[index_1] * frac;
+							temp_buf[i] += sample * mix_source.mix_factor;
+						}
+					}
+				}
+				else
+				{
+					// Virtual voice: just advance the read indices.
+					for(size_t z=0; z<source->mix_sources.size(); ++z)
+						source->mix_sources[z].sound_file_i += source->mix_sources[z].source_delta * (double)src_samples_needed;
+				}
+			}
+			else
+			{
+				if(source->buffer.size() >= src_samples_needed) // If there is sufficient data in the circular buffer:
+				{
+					// Copy data to temp_buf before we pop it from the source buffer.  NOTE: Could optimise by popping later, after we process the data, to avoid copying to temp_buf.
+					source->buffer.popFrontNItems(/*dest=*/temp_buf.data(), src_samples_needed);
+				}
+				else
+				{
+					//conPrint("Ran out of data for streaming audio src!");
+					const size_t source_buf_size = source->buffer.size();
+					source->buffer.popFrontNItems(/*dest=*/temp_buf.data(), source_buf_size); // Copy the data that there is to temp_buf
+					for(size_t i=source_buf_size; i<src_samples_needed; ++i) // Pad the rest with zeroes.
+						temp_buf[i] = 0.f;
+				}
+			}
+		}
+		else
+			runtimeCheckFailed("Invalid source->type");
+
+		if(is_real)
+		{
+			runtimeCheck(contiguous_data_ptr != NULL);
+			if(source_sampling_rate == resonance_sampling_rate)
+			{
+				const float* bufptr = contiguous_data_ptr;
+				resonance->SetPlanarBuffer(source->resonance_handle, &bufptr, /*num channels=*/1, frames_per_buffer);
+			}
+			else
+			{
+				// Resample audio to the audio engine and Resonance sampling rate.
+				resampled_buf.resizeNoCopy(frames_per_buffer);
+				
+				source->resampler.resample(resampled_buf.data(), frames_per_buffer, contiguous_data_ptr, src_samples_needed, temp_resampling_buf);
+
+				const float* bufptr = resampled_buf.data();
+				resonance->SetPlanarBuffer(source->resonance_handle, &bufptr, /*num channels=*/1, frames_per_buffer);
+			}
+		}
+
+		source->EOF_marker_position -= (int64)src_samples_needed;
+		const bool stream_reached_EOF = source->EOF_marker_position <= 0;
+
+		return remove_source || (!source->looping && stream_reached_EOF);
+	}
+
+public:
 	AudioEngine* engine;
 	vraudio::ResonanceAudioApi* resonance;
 	AudioCallbackData* callback_data;
@@ -570,6 +766,12 @@ public:
 	js::Vector<float, 16> temp_buf;
 	js::Vector<float, 16> temp_resampling_buf;
 	js::Vector<float, 16> resampled_buf;
+
+private:
+	std::vector<AudioSourceRef> playing_sources; // Sources that are playing: not paused, and not finished.
+	std::vector<AudioSourceRef> pending_finished_sources; // Finished sources that couldn't be pushed to finished_sources_queue yet since it was full.
+	std::vector<AudioEngine::VoiceCandidate> voice_candidates;
+	Vec4f listener_pos;
 };
 
 
@@ -768,24 +970,34 @@ void AudioEngine::setCurentRoomDimensions(const js::AABBox& room_aabb)
 }
 
 
+static AudioEngineCommand makeSourceCommand(AudioEngineCommand::Type type, AudioSource& source)
+{
+	AudioEngineCommand command;
+	command.type = type;
+	command.source = &source;
+	command.vec = source.pos;
+	command.volume = source.volume * source.getMuteVolumeFactor();
+	command.num_occlusions = source.num_occlusions;
+	return command;
+}
+
+
 void AudioEngine::seekToStartAndUnpauseAudio(AudioSource& source)
 {
 	if(!initialised)
 		return;
 
+	source.paused = false;
+
+	// The mixer resets the read index and starts playing the source, if it isn't playing already.
+	enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_SeekToStartAndUnpause, source), /*must_deliver=*/true);
+
 	Lock lock(mutex);
 
-	source.cur_read_i = 0;
-	source.paused = false;
 	//source.stream_reached_EOF = false;
 	source.EOF_marker_position = std::numeric_limits<int64>::max();
 	source.buffer.clear();
 
-	if(source.resonance_handle == INVALID_RESONANCE_HANDLE)
-	{
-		createResonanceObAndResamplerForSource(source);
-	}
-
 	AudioSourceRef ref(&source);
 
 	// If there is a streamer for this source, then restart the stream.
@@ -796,9 +1008,6 @@ void AudioEngine::seekToStartAndUnpauseAudio(AudioSource& source)
 		if(source_set.count(ref) != 0)
 			it->first->seekToBeginningOfFile();
 	}
-	
-	if(active_audio_sources.count(ref) == 0)
-		active_audio_sources.insert(ref);
 }
 
 
@@ -813,7 +1022,11 @@ void AudioEngine::setMasterVolume(float volume)
 
 void AudioEngine::shutdown()
 {
+	initialised = false; // Stop sending commands to the mixer, and stop using resonance.
+
 	thread_manager.killThreadsBlocking();
+
+	overflow_commands.clear();
 	
 #if USE_MINIAUDIO
 	if(device)
@@ -845,34 +1058,34 @@ void AudioEngine::shutdown()
 }
 
 
-void AudioEngine::createResonanceObAndResamplerForSource(AudioSource& source_)
+// If the command queue is full, commands are kept in overflow_commands and sent by flushOverflowCommands() once the mixer has made space, so we never block the main thread.
+// Once there are overflow commands, later commands are added to overflow_commands as well, so that the mixer receives all commands in order (e.g. a volume update must not arrive before the AddSource command for the source).
+void AudioEngine::enqueueCommand(const AudioEngineCommand& command, bool must_deliver)
 {
-	if(!initialised)
-		return;
+	if(!overflow_commands.empty())
+		flushOverflowCommands();
 
-	AudioSource* source = &source_;
-
-	if(source->spatial_type == AudioSource::SourceSpatialType_Spatial)
-	{
-		source->resonance_handle = resonance->CreateSoundObjectSource(vraudio::RenderingMode::kBinauralHighQuality);
+	if(overflow_commands.empty() && command_queue.tryPush(command))
+		return;
 
-		if(source->pos.isFinite()) // Avoid crash in Resonance with NaN or Inf position coords.
-		{
-			resonance->SetSourcePosition(source->resonance_handle, source->pos[0], source->pos[1], source->pos[2]);
-			resonance->SetSourceVolume(source->resonance_handle, source->volume * source->getMuteVolumeFactor());
-		}
-	}
-	else if(source->spatial_type == AudioSource::SourceSpatialType_NonSpatial)
+	// Don't let position and volume updates build up without limit if the mixer isn't keeping up.  Dropping one just means the mixer uses a slightly out-of-date value until the next update.
+	if(!must_deliver && overflow_commands.size() >= command_queue.capacity())
 	{
-		source->resonance_handle = resonance->CreateStereoSource(/*num channels=*/2);
-		resonance->SetSourceVolume(source->resonance_handle, source->volume * source->getMuteVolumeFactor());
-	}
-	else
-	{
-		assert(0);
+		num_dropped_commands.increment();
+		return;
 	}
 
-	source->resampler.init(/*src rate=*/source->sampling_rate, this->sample_rate);
+	overflow_commands.push_back(command);
+}
+
+
+void AudioEngine::flushOverflowCommands()
+{
+	size_t num_sent = 0;
+	while(num_sent < overflow_commands.size() && command_queue.tryPush(overflow_commands[num_sent]))
+		num_sent++;
+
+	overflow_commands.erase(overflow_commands.begin(), overflow_commands.begin() + num_sent);
 }
 
 
@@ -884,16 +1097,12 @@ void AudioEngine::addSource(AudioSourceRef source)
 	if(source->sampling_rate < 8000 || source->sampling_rate > 48000)
 		throw glare::Exception("Unsupported sampling rate for audio source: " + toString(source->sampling_rate));
 
-	if(!source->paused)
-	{
-		createResonanceObAndResamplerForSource(*source);
-	}
+	updateFinishedSources(); // Make sure finished one-shot sources don't accumulate in audio_sources, even if updateFinishedSources() isn't called regularly.
 
-	Lock lock(mutex);
 	audio_sources.insert(source);
 
 	if(!source->paused)
-		active_audio_sources.insert(source);
+		enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_AddSource, *source), /*must_deliver=*/true);
 }
 
 
@@ -904,13 +1113,12 @@ void AudioEngine::removeSource(AudioSourceRef source)
 	if(!initialised)
 		return;
 
-	if(source->resonance_handle != INVALID_RESONANCE_HANDLE)
-		resonance->DestroySource(source->resonance_handle);
+	audio_sources.erase(source);
+
+	enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_RemoveSource, *source), /*must_deliver=*/true); // The mixer will destroy the Resonance source.
 
 	{
 		Lock lock(mutex);
-		audio_sources.erase(source);
-		active_audio_sources.erase(source);
 
 		// Remove audio source from sources_playing_streams (MP3AudioStreamer -> set<AudioSourceRef>) map.
 		Reference<MP3AudioStreamer> streamer_to_remove;
@@ -943,6 +1151,17 @@ void AudioEngine::removeSource(AudioSourceRef source)
 }
 
 
+void AudioEngine::updateFinishedSources()
+{
+	AudioSourceRef source;
+	while(finished_sources_queue.tryPop(source))
+		audio_sources.erase(source);
+
+	if(!overflow_commands.empty())
+		flushOverflowCommands();
+}
+
+
 void AudioEngine::sourcePositionUpdated(AudioSource& source)
 {
 	if(!initialised)
@@ -951,8 +1170,7 @@ void AudioEngine::sourcePositionUpdated(AudioSource& source)
 	if(!source.pos.isFinite())
 		return; // Avoid crash in Resonance with NaN or Inf position coords.
 
-	if(source.resonance_handle != INVALID_RESONANCE_HANDLE)
-		resonance->SetSourcePosition(source.resonance_handle, source.pos[0], source.pos[1], source.pos[2]);
+	enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_SetSourcePosition, source), /*must_deliver=*/false);
 }
 
 
@@ -961,8 +1179,7 @@ void AudioEngine::sourceVolumeUpdated(AudioSource& source)
 	if(!initialised)
 		return;
 	// conPrint("Setting volume to " + doubleToStringNSigFigs(source.volume, 4));
-	if(source.resonance_handle != INVALID_RESONANCE_HANDLE)
-		resonance->SetSourceVolume(source.resonance_handle, source.volume * source.getMuteVolumeFactor());
+	enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_SetSourceVolume, source), /*must_deliver=*/false);
 }
 
 
@@ -970,8 +1187,7 @@ void AudioEngine::sourceNumOcclusionsUpdated(AudioSource& source)
 {
 	if(!initialised)
 		return;
-	if(source.resonance_handle != INVALID_RESONANCE_HANDLE)
-		resonance->SetSoundObjectOcclusionIntensity(source.resonance_handle, source.num_occlusions);
+	enqueueCommand(makeSourceCommand(AudioEngineCommand::Type_SetSourceOcclusion, source), /*must_deliver=*/false);
 }
 
 
@@ -980,16 +1196,46 @@ void AudioEngine::setHeadTransform(const Vec4f& head_pos, const Quatf& head_rot)
 	if(!initialised)
 		return;
 
-	//Lock lock(mutex);
-	
 	if(head_pos.isFinite() && head_rot.v.isFinite()) // Avoid crash in Resonance with NaN or Inf position coords.
 	{
-		resonance->SetHeadPosition(head_pos[0], head_pos[1], head_pos[2]);
-		resonance->SetHeadRotation(head_rot.v[0], head_rot.v[1], head_rot.v[2], head_rot.v[3]);
+		AudioEngineCommand command;
+		command.type = AudioEngineCommand::Type_SetHeadTransform;
+		command.vec = head_pos;
+		command.rot = head_rot.v;
+		enqueueCommand(command, /*must_deliver=*/false);
 	}
 }
 
 
+float AudioEngine::computeSourceAudibility(bool spatial, float volume, float num_occlusions, const Vec4f& source_pos, const Vec4f& listener_pos)
+{
+	if(volume <= 0)
+		return 0;
+
+	if(!spatial)
+		return std::numeric_limits<float>::infinity(); // Non-spatial sources (UI sounds etc.) aren't attenuated by distance, so always make them real voices.
+
+	// Perceived power falls off with the square of distance.  Clamp the distance so that sources very close to the listener don't dominate.
+	const float dist2 = myMax(1.f, source_pos.getDist2(listener_pos));
+
+	return volume / ((1.f + num_occlusions) * dist2);
+}
+
+
+size_t AudioEngine::chooseRealVoices(std::vector<VoiceCandidate>& candidates, size_t max_num_real_voices)
+{
+	const size_t n = myMin(max_num_real_voices, candidates.size());
+
+	if(n < candidates.size())
+		std::nth_element(candidates.begin(), candidates.begin() + n, candidates.end(), [](const VoiceCandidate& a, const VoiceCandidate& b) { return a.audibility > b.audibility; });
+
+	// Move inaudible candidates to the end of the first n, they don't need to be real voices.
+	const auto audible_end = std::partition(candidates.begin(), candidates.begin() + n, [](const VoiceCandidate& c) { return c.audibility > 0; });
+
+	return audible_end - candidates.begin();
+}
+
+
 SoundFileRef AudioEngine::loadSoundFile(const std::string& sound_file_path)
 {
 	return AudioFileReader::readAudioFile(sound_file_path);
@@ -1082,8 +1328,6 @@ AudioSourceRef AudioEngine::addSourceFromStreamingSoundFile(AddSourceFromStreami
 {
 	ZoneScoped; // Tracy profiler
 
-	Lock lock(mutex);
-
 	// Make a new audio source
 	AudioSourceRef source = new AudioSource();
 	source->type = AudioSource::SourceType_Streaming;
@@ -1093,45 +1337,50 @@ AudioSourceRef AudioEngine::addSourceFromStreamingSoundFile(AddSourceFromStreami
 	source->looping = params.looping;
 	source->paused = params.paused;
 
-	// We want to use a new MP3AudioStreamer if either
-	// a) The source is paused, since it may be unpaused by a script at any time independently of other sources, so shouldn't use the same stream as other sources
-	// b) No MP3AudioStreamer for the given sound file path exists yet.
-
-	auto res = unpaused_streams.find(params.sound_file_path);
-	if((res == unpaused_streams.end()) || params.paused)
 	{
-		// Create a new MP3AudioStreamer from the given data source
-		Reference<MP3AudioStreamer> streamer;
-		if(params.sound_data_source)
-			streamer = new MP3AudioStreamer(params.sound_data_source);
-		else
-			streamer = new MP3AudioStreamer(params.mem_mapped_sound_file);
+		Lock lock(mutex);
+
+		// We want to use a new MP3AudioStreamer if either
+		// a) The source is paused, since it may be unpaused by a script at any time independently of other sources, so shouldn't use the same stream as other sources
+		// b) No MP3AudioStreamer for the given sound file path exists yet.
 
-		if(!params.paused) // if not paused, we can use the same stream as other sources.
+		auto res = unpaused_streams.find(params.sound_file_path);
+		if((res == unpaused_streams.end()) || params.paused)
 		{
-			streamer->seekToApproxTimeWrapped(params.global_time);
+			// Create a new MP3AudioStreamer from the given data source
+			Reference<MP3AudioStreamer> streamer;
+			if(params.sound_data_source)
+				streamer = new MP3AudioStreamer(params.sound_data_source);
+			else
+				streamer = new MP3AudioStreamer(params.mem_mapped_sound_file);
+
+			if(!params.paused) // if not paused, we can use the same stream as other sources.
+			{
+				streamer->seekToApproxTimeWrapped(params.global_time);
 
-			unpaused_streams.insert(std::make_pair(params.sound_file_path, streamer));
+				unpaused_streams.insert(std::make_pair(params.sound_file_path, streamer));
+			}
+
+			stream_to_source_map[streamer].insert(source); // Add this audio source as a user of this stream.
 		}
+		else
+		{
+			// Streamer for this mp3 file already exists.
+			Reference<MP3AudioStreamer> streamer = res->second;
 
-		stream_to_source_map[streamer].insert(source); // Add this audio source as a user of this stream.
-	}
-	else
-	{
-		// Streamer for this mp3 file already exists.
-		Reference<MP3AudioStreamer> streamer = res->second;
+			// If there is another source playing this stream, copy the other source's buffer in order to synchronise the audio sources in the audio stream.
+			auto first_source_it = stream_to_source_map[streamer].begin();
+			if(first_source_it != stream_to_source_map[streamer].end())
+			{
+				AudioSourceRef first_source = *first_source_it;
 
-		// If there is another source playing this stream, copy the other source's buffer in order to synchronise the audio sources in the audio stream.
-		auto first_source_it = stream_to_source_map[streamer].begin();
-		if(first_source_it != stream_to_source_map[streamer].end())
-		{
-			AudioSourceRef first_source = *first_source_it;
+				source->buffer = first_source->buffer;
+			}
 
-			source->buffer = first_source->buffer;
+			stream_to_source_map[streamer].insert(source); // Add this audio source as a user of this stream.
 		}
 
-		stream_to_source_map[streamer].insert(source); // Add this audio source as a user of this stream.
-	}
+	} // End lock scope
 
 	addSource(source);
 
@@ -1159,8 +1408,180 @@ bool AudioEngine::needNewStreamerForPath(const std::string& sound_file_path, boo
 #include "../utils/TestUtils.h"
 
 
+class SPSCQueueTestProducerThread : public MyThread
+{
+public:
+	virtual void run()
+	{
+		for(uint64 i=0; i<num_items; ++i)
+			while(!queue->tryPush(i))
+			{}
+	}
+
+	glare::SPSCQueue<uint64>* queue;
+	uint64 num_items;
+};
+
+
 void glare::AudioEngine::test()
 {
+	conPrint("AudioEngine::test()");
+
+	//------------------------------------ Test SPSCQueue -----------------------
+	{
+		SPSCQueue<int> queue(4);
+		testAssert(queue.capacity() == 4);
+		int x;
+		testAssert(!queue.tryPop(x));
+
+		// Push and pop enough items to wrap around the ring buffer a few times
+		for(int i=0; i<10; ++i)
+		{
+			testAssert(queue.tryPush(i*3 + 0));
+			testAssert(queue.tryPush(i*3 + 1));
+			testAssert(queue.tryPush(i*3 + 2));
+			testAssert(queue.sizeApprox() == 3);
+			testAssert(queue.tryPop(x) && x == i*3 + 0);
+			testAssert(queue.tryPop(x) && x == i*3 + 1);
+			testAssert(queue.tryPop(x) && x == i*3 + 2);
+			testAssert(!queue.tryPop(x));
+		}
+
+		// Test pushing to a full queue
+		for(int i=0; i<4; ++i)
+			testAssert(queue.tryPush(i));
+		testAssert(!queue.tryPush(100));
+		for(int i=0; i<4; ++i)
+			testAssert(queue.tryPop(x) && x == i);
+		testAssert(!queue.tryPop(x));
+	}
+
+	// Test that popping releases references held in the queue.
+	{
+		SPSCQueue<AudioSourceRef> queue(4);
+		AudioSourceRef source = new AudioSource();
+		testAssert(queue.tryPush(source));
+		testAssert(source->getRefCount() == 2);
+		AudioSourceRef popped;
+		testAssert(queue.tryPop(popped) && popped == source);
+		popped = NULL;
+		testAssert(source->getRefCount() == 1);
+	}
+
+	// Test with a producer thread and consumer thread
+	{
+		SPSCQueue<uint64> queue(256);
+		Reference<SPSCQueueTestProducerThread> producer = new SPSCQueueTestProducerThread();
+		producer->queue = &queue;
+		producer->num_items = 1000000;
+		producer->launch();
+
+		for(uint64 i=0; i<producer->num_items; ++i)
+		{
+			uint64 x;
+			while(!queue.tryPop(x))
+			{}
+			testAssert(x == i); // Items should be received in order, with none lost or duplicated.
+		}
+
+		producer->join();
+		testAssert(queue.sizeApprox() == 0);
+	}
+
+	//------------------------------------ Test command queue overflow -----------------------
+	// Commands that don't fit in the command queue should be kept and sent in order once the mixer makes space, rather than dropped.
+	{
+		AudioEngine engine; // Not initialised, so there is no mixer thread, and we can pop commands ourselves.
+		const size_t capacity = engine.command_queue.capacity();
+
+		AudioEngineCommand command;
+		command.type = AudioEngineCommand::Type_SetHeadTransform;
+		for(size_t i=0; i<capacity + 100; ++i)
+		{
+			command.vec = Vec4f((float)i, 0, 0, 1);
+			engine.enqueueCommand(command, /*must_deliver=*/true);
+		}
+		testAssert(engine.getNumOverflowCommands() == 100);
+
+		// Non-must-deliver commands should be added after the overflow commands, so that order is preserved.
+		command.vec = Vec4f((float)(capacity + 100), 0, 0, 1);
+		engine.enqueueCommand(command, /*must_deliver=*/false);
+		testAssert(engine.getNumOverflowCommands() == 101);
+		testAssert(engine.getNumDroppedCommands() == 0);
+
+		// Simulate the mixer processing some commands, then flush.
+		AudioEngineCommand popped;
+		for(size_t i=0; i<50; ++i)
+			testAssert(engine.command_queue.tryPop(popped) && popped.vec[0] == (float)i);
+
+		engine.updateFinishedSources();
+		testAssert(engine.getNumOverflowCommands() == 51);
+
+		for(size_t i=50; i<capacity + 101; ++i)
+		{
+			if(!engine.command_queue.tryPop(popped))
+			{
+				engine.updateFinishedSources();
+				testAssert(engine.command_queue.tryPop(popped));
+			}
+			testAssert(popped.vec[0] == (float)i);
+		}
+		testAssert(engine.getNumOverflowCommands() == 0);
+		testAssert(!engine.command_queue.tryPop(popped));
+
+		// Once the overflow list is large, non-must-deliver commands are dropped, but must-deliver commands are still kept.
+		for(size_t i=0; i<capacity * 2; ++i)
+			engine.enqueueCommand(command, /*must_deliver=*/true);
+		engine.enqueueCommand(command, /*must_deliver=*/false);
+		testAssert(engine.getNumDroppedCommands() == 1);
+		engine.enqueueCommand(command, /*must_deliver=*/true);
+		testAssert(engine.getNumOverflowCommands() == capacity + 1);
+	}
+
+	//------------------------------------ Test virtual voice selection -----------------------
+	{
+		const Vec4f listener_pos(0,0,0,1);
+		const float near_audibility     = computeSourceAudibility(/*spatial=*/true, /*volume=*/1.f, /*num occlusions=*/0, Vec4f(5,0,0,1), listener_pos);
+		const float far_audibility      = computeSourceAudibility(/*spatial=*/true, /*volume=*/1.f, /*num occlusions=*/0, Vec4f(50,0,0,1), listener_pos);
+		const float loud_far_audibility = computeSourceAudibility(/*spatial=*/true, /*volume=*/1000.f, /*num occlusions=*/0, Vec4f(50,0,0,1), listener_pos);
+		const float occluded_audibility = computeSourceAudibility(/*spatial=*/true, /*volume=*/1.f, /*num occlusions=*/1, Vec4f(5,0,0,1), listener_pos);
+		testAssert(near_audibility > far_audibility);
+		testAssert(loud_far_audibility > near_audibility);
+		testAssert(occluded_audibility < near_audibility);
+		testAssert(computeSourceAudibility(/*spatial=*/true, /*volume=*/0.f, /*num occlusions=*/0, Vec4f(1,0,0,1), listener_pos) == 0);
+		testAssert(computeSourceAudibility(/*spatial=*/false, /*volume=*/0.1f, /*num occlusions=*/0, Vec4f(1000,0,0,1), listener_pos) > loud_far_audibility);
+
+		// Sources at distance 1, 2, 3, ... 100, with every 10th source muted.
+		std::vector<VoiceCandidate> candidates(100);
+		for(uint32 i=0; i<100; ++i)
+		{
+			const float volume = (i % 10 == 0) ? 0.f : 1.f;
+			candidates[i].audibility = computeSourceAudibility(/*spatial=*/true, volume, /*num occlusions=*/0, Vec4f((float)(i + 1),0,0,1), listener_pos);
+			candidates[i].index = i;
+		}
+
+		const size_t num_real = chooseRealVoices(candidates, /*max num real voices=*/16);
+		testAssert(num_real == 16);
+		std::set<uint32> real_indices;
+		for(size_t i=0; i<num_real; ++i)
+			real_indices.insert(candidates[i].index);
+		// The real voices should be the 16 closest non-muted sources, which are indices 1-9 and 11-17.
+		for(uint32 i=1; i<=17; ++i)
+			testAssert((real_indices.count(i) != 0) == (i != 10));
+
+		// Test with fewer candidates than the max number of real voices.  Muted sources should not be real voices.
+		candidates.resize(5);
+		for(uint32 i=0; i<5; ++i)
+		{
+			candidates[i].audibility = (i == 2) ? 0.f : 1.f;
+			candidates[i].index = i;
+		}
+		testAssert(chooseRealVoices(candidates, /*max num real voices=*/16) == 4);
+		testAssert(candidates[4].index == 2);
+
+		testAssert(chooseRealVoices(candidates, /*max num real voices=*/0) == 0);
+	}
+
 	try
 	{
 		AudioEngine engine;
@@ -1168,7 +1589,6 @@ void glare::AudioEngine::test()
 
 		PlatformUtils::Sleep(1000); // We mute the first second or so of output from Resonance due to a Resonance bug.
 
-		Lock lock(engine.mutex);
 		//------------------------------- Test playOneShotSound(), loads sound completely as a non-streaming source. ------------------------------------
 		// Play a single non-looping WAV sound, check it gets removed properly at the end
 		{
@@ -1176,13 +1596,13 @@ void glare::AudioEngine::test()
 			engine.playOneShotSound(TestUtils::getTestReposDir() + "/testfiles/WAVs/1_second_chirp.wav", Vec4f(1,0,0,1));
 
 			testAssert(engine.audio_sources.size() == 1);
-			testAssert(engine.active_audio_sources.size() == 1);
 
 			for(int i=0; i<100; ++i)
 				PlatformUtils::Sleep(2000 / 100);
 
+			engine.updateFinishedSources();
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
+			testAssert(engine.getNumPlayingSources() == 0);
 
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
@@ -1195,13 +1615,13 @@ void glare::AudioEngine::test()
 			engine.playOneShotSound(TestUtils::getTestReposDir() + "/testfiles/mp3s/1_second_chirp.mp3", Vec4f(1,0,0,1));
 
 			testAssert(engine.audio_sources.size() == 1);
-			testAssert(engine.active_audio_sources.size() == 1);
 
 			for(int i=0; i<100; ++i)
 				PlatformUtils::Sleep(2000 / 100);
 
+			engine.updateFinishedSources();
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
+			testAssert(engine.getNumPlayingSources() == 0);
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1239,7 +1659,6 @@ void glare::AudioEngine::test()
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1277,7 +1696,6 @@ void glare::AudioEngine::test()
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1296,11 +1714,10 @@ void glare::AudioEngine::test()
 
 			// Source should have finished playing by now.
 			testAssert(!source->isPlaying());
-			testAssert(engine.active_audio_sources.empty()); // Should have been removed from active_audio_sources
+			testAssert(engine.getNumPlayingSources() == 0); // Mixer should have stopped playing it
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1321,7 +1738,6 @@ void glare::AudioEngine::test()
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1344,12 +1760,11 @@ void glare::AudioEngine::test()
 
 			// Source should have finished playing by now.
 			testAssert(!source->isPlaying());
-			testAssert(engine.active_audio_sources.empty()); // Should have been removed from active_audio_sources
+			testAssert(engine.getNumPlayingSources() == 0); // Mixer should have stopped playing it
 
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
@@ -1373,7 +1788,6 @@ void glare::AudioEngine::test()
 			engine.removeSource(source);
 
 			testAssert(engine.audio_sources.empty());
-			testAssert(engine.active_audio_sources.empty());
 			testAssert(engine.unpaused_streams.empty());
 			testAssert(engine.stream_to_source_map.empty());
 		}
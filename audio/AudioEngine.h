@@ -7,6 +7,7 @@ Copyright Glare Technologies Limited 2021 -
 
 
 #include "AudioResampler.h"
+#include "SPSCQueue.h"
 #include "../maths/vec3.h"
 #include "../maths/vec2.h"
 #include "../maths/matrix3.h"
@@ -18,6 +19,7 @@ Copyright Glare Technologies Limited 2021 -
 #include <utils/Vector.h>
 #include <utils/VRef.h>
 #include <utils/MemMappedFile.h>
+#include <utils/AtomicInt.h>
 #include <vector>
 #include <set>
 #include <map>
@@ -111,7 +113,7 @@ public:
 
 	bool isPlaying();
 
-	int resonance_handle; // Set in AudioEngine::addSource().
+	int resonance_handle; // Created and destroyed by the mixer (ResonanceThread) only.
 
 	int sampling_rate;
 	
@@ -152,10 +154,45 @@ public:
 	float smoothed_cur_level;
 
 	AudioResampler resampler;
+
+	// Mixer state.  Only accessed by the mixer (ResonanceThread), which receives updates via AudioEngine commands.
+	Vec4f mixer_pos; // Position as last sent to the mixer.
+	float mixer_volume; // volume * mute_volume_factor, as last sent to the mixer.
+	float mixer_num_occlusions;
+	float voice_gain; // Fade factor in [0, 1], for fading between real and virtual voice.
+	bool in_mixer; // Is the source in the mixer's list of playing sources?
+	bool is_real_voice; // Is the source one of the most audible sources, which are spatialised by Resonance?
 };
 typedef Reference<AudioSource> AudioSourceRef;
 
 
+// A command from the main thread to the mixer (ResonanceThread), passed via AudioEngine::command_queue.
+struct AudioEngineCommand
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	enum Type
+	{
+		Type_AddSource,
+		Type_RemoveSource,
+		Type_SeekToStartAndUnpause,
+		Type_SetSourcePosition,
+		Type_SetSourceVolume,
+		Type_SetSourceOcclusion,
+		Type_SetHeadTransform
+	};
+
+	AudioEngineCommand() : type(Type_AddSource), volume(1), num_occlusions(0) {}
+
+	Vec4f vec; // Source position, or head position for Type_SetHeadTransform.
+	Vec4f rot; // Head rotation quaternion (x, y, z, w) for Type_SetHeadTransform.
+	AudioSourceRef source;
+	Type type;
+	float volume; // Source volume * mute volume factor.
+	float num_occlusions;
+};
+
+
 struct AudioCallbackData
 {
 	Mutex buffer_mutex; // protects buffer
@@ -172,10 +209,28 @@ struct AudioCallbackData
 /*=====================================================================
 AudioEngine
 -----------
+Sources are played and mixed on the ResonanceThread (the mixer).
+
+The main thread doesn't modify mixer state directly, but sends commands
+(add/remove source, position, volume etc.) to the mixer over a lock-free
+single-producer/single-consumer queue.  So the main thread and the mixer
+don't contend on a lock for source updates, and the mixer owns all
+Resonance source objects.
+
+Only the MAX_NUM_REAL_VOICES most audible sources (ranked by volume,
+distance from the listener and occlusion) are spatialised by Resonance.
+The remaining 'virtual' sources are faded out, and then just have their
+read positions advanced, so they stay in sync if they become audible again.
+
+The AudioEngine methods, apart from those noted otherwise, must be called
+from the main thread only.
 =====================================================================*/
 class AudioEngine
 {
 public:
+	static const size_t MAX_NUM_REAL_VOICES = 48; // Max number of sources spatialised by Resonance at once.
+	static constexpr float VOICE_FADE_TIME = 0.1f; // Time in seconds to fade a source in or out when it changes between a real and virtual voice.
+
 	AudioEngine();
 	~AudioEngine();
 
@@ -227,12 +282,34 @@ public:
 	
 	void setMasterVolume(float volume);
 
+	// Removes sources that have finished playing, and that have remove_on_finish set, from audio_sources.
+	// Also retries sending commands that didn't fit in the command queue.  Should be called every frame.
+	void updateFinishedSources();
+
+	size_t getNumPlayingSources() const { return (size_t)num_playing_sources; }
+	size_t getNumRealVoices() const { return (size_t)num_real_voices; }
+	size_t getNumDroppedCommands() const { return (size_t)num_dropped_commands; }
+	size_t getNumOverflowCommands() const { return overflow_commands.size(); }
+
+	// How loud the source will be heard by the listener, used for choosing which sources are real voices.
+	static float computeSourceAudibility(bool spatial, float volume, float num_occlusions, const Vec4f& source_pos, const Vec4f& listener_pos);
+
+	struct VoiceCandidate
+	{
+		float audibility;
+		uint32 index;
+	};
+	// Partially sorts candidates so that the first min(max_num_real_voices, candidates.size()) elements are the most audible.
+	// Returns the number of real voices, which excludes inaudible candidates.
+	static size_t chooseRealVoices(std::vector<VoiceCandidate>& candidates, size_t max_num_real_voices);
+
 	void insertSoundFile(const std::string& sound_file_path, SoundFileRef sound);
 	SoundFileRef getOrLoadSoundFile(const std::string& sound_file_path);
 
 	static void test();
 private:
-	void createResonanceObAndResamplerForSource(AudioSource& source);
+	void enqueueCommand(const AudioEngineCommand& command, bool must_deliver);
+	void flushOverflowCommands();
 	SoundFileRef loadSoundFile(const std::string& sound_file_path);
 
 	RtAudio* audio;
@@ -244,9 +321,17 @@ private:
 	bool initialised;
 
 public:
-	Mutex mutex; // Guards access to audio_sources, and resonance
-	std::set<AudioSourceRef> active_audio_sources	GUARDED_BY(mutex); // active audio sources
-	std::set<AudioSourceRef> audio_sources			GUARDED_BY(mutex);
+	Mutex mutex; // Guards streaming source data (AudioSource::buffer, EOF_marker_position, mix_sources, resampler), unpaused_streams and stream_to_source_map.
+
+	std::set<AudioSourceRef> audio_sources; // All added sources, including paused sources.  Only accessed by the main thread.
+
+	SPSCQueue<AudioEngineCommand> command_queue; // Main thread -> mixer.
+	std::vector<AudioEngineCommand> overflow_commands; // Commands that didn't fit in command_queue, in the order they were enqueued.  Only accessed by the main thread.
+	SPSCQueue<AudioSourceRef> finished_sources_queue; // Mixer -> main thread.  Sources that finished playing, with remove_on_finish set.
+
+	glare::AtomicInt num_playing_sources; // Updated by the mixer.
+	glare::AtomicInt num_real_voices; // Updated by the mixer.
+	glare::AtomicInt num_dropped_commands;
 
 	ThreadManager thread_manager; // Manages: ResonanceThread, StreamerThread
 
@@ -0,0 +1,98 @@
+/*=====================================================================
+SPSCQueue.h
+-----------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <utils/Vector.h>
+#include <utils/Platform.h>
+#include <atomic>
+#include <cassert>
+
+
+namespace glare
+{
+
+
+/*=====================================================================
+SPSCQueue
+---------
+A fixed-capacity, lock-free queue for passing items from exactly one
+producer thread to exactly one consumer thread.
+
+Neither tryPush() nor tryPop() ever blocks or allocates, so the queue can be
+used from a real-time thread such as the audio mixer.
+=====================================================================*/
+template <class T>
+class SPSCQueue
+{
+public:
+	// capacity must be a power of two.
+	explicit SPSCQueue(size_t capacity);
+
+	// Called by the producer thread only.  Returns false if the queue is full, in which case the item is not added.
+	bool tryPush(const T& item);
+
+	// Called by the consumer thread only.  Returns false if the queue is empty.
+	// The queue slot is reset to T() after popping, so that any references held by the item are released.
+	bool tryPop(T& item_out);
+
+	size_t capacity() const { return items.size(); }
+
+	// May be called from any thread, but the result may be out of date by the time it is returned.
+	size_t sizeApprox() const { return write_index.load(std::memory_order_relaxed) - read_index.load(std::memory_order_relaxed); }
+
+private:
+	js::Vector<T, 16> items;
+	size_t mask;
+
+	// Keep the producer and consumer indices on separate cache lines to avoid false sharing.
+	uint8 padding_0[64];
+	std::atomic<size_t> write_index; // Only written by the producer.
+	uint8 padding_1[64];
+	std::atomic<size_t> read_index; // Only written by the consumer.
+	uint8 padding_2[64];
+};
+
+
+template <class T>
+SPSCQueue<T>::SPSCQueue(size_t capacity)
+:	items(capacity),
+	mask(capacity - 1),
+	write_index(0),
+	read_index(0)
+{
+	assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+}
+
+
+template <class T>
+bool SPSCQueue<T>::tryPush(const T& item)
+{
+	const size_t w = write_index.load(std::memory_order_relaxed);
+	if(w - read_index.load(std::memory_order_acquire) >= items.size()) // If full:
+		return false;
+
+	items[w & mask] = item;
+	write_index.store(w + 1, std::memory_order_release); // Publish the item to the consumer.
+	return true;
+}
+
+
+template <class T>
+bool SPSCQueue<T>::tryPop(T& item_out)
+{
+	const size_t r = read_index.load(std::memory_order_relaxed);
+	if(r == write_index.load(std::memory_order_acquire)) // If empty:
+		return false;
+
+	item_out = items[r & mask];
+	items[r & mask] = T();
+	read_index.store(r + 1, std::memory_order_release); // Hand the slot back to the producer.
+	return true;
+}
+
+
+} // end namespace glare
@@ -33,10 +33,13 @@ EquippedGearGraphics::~EquippedGearGraphics() {}
 
 AvatarGraphics::AvatarGraphics(Avatar* avatar_)
 :	loaded_lod_level(-1),
+	skipped_pose_dt(0),
 	avatar(avatar_),
 	our_avatar(false)
 {
 	last_pos.set(0, 0, 0);
+	posed_pos.set(0, 0, 0);
+	posed_gl_ob = NULL;
 	last_selected_ob_target_pos.set(0, 0, 0);
 	last_cam_rotation.set(0,0,0);
 	avatar_rotation.set(0,0,0);
@@ -128,6 +131,14 @@ void AvatarGraphics::setOverallTransform(OpenGLEngine& engine, PhysicsWorld& phy
 	if(dt == 0.0) // May happen in web client, avoid dividing by zero below.
 		return;
 
+	updatePose(pos, cam_rotation, use_xyplane_speed_rel_ground_override, xyplane_speed_rel_ground_override, pre_ob_to_world_matrix, anim_state, cur_time, dt, pose_constraint, anim_events_out);
+
+	applyPose(engine, physics_world, pos);
+}
+
+
+void AvatarGraphics::applyPose(OpenGLEngine& engine, PhysicsWorld& physics_world, const Vec3d& pos)
+{
 	if(false && !debug_avatar_basis_ob)
 	{
 		debug_avatar_basis_ob = engine.allocateObject();
@@ -166,7 +177,26 @@ void AvatarGraphics::setOverallTransform(OpenGLEngine& engine, PhysicsWorld& phy
 			physics_world.setNewPosition(*physics_ob, last_eye_pos - Vec4f(0, 0, EYE_HEIGHT / 2.f, 0));
 		}
 
+		engine.updateObjectTransformData(*skinned_gl_ob);
+
+		for(size_t i=0; i<equipped_gear_graphics.size(); ++i)
+		{
+			EquippedGearGraphics& gear = equipped_gear_graphics[i];
+			if(gear.gear_gl_ob && gear.bone_node_i >= 0 && gear.bone_node_i < (int)skinned_gl_ob->anim_node_data.size())
+				engine.updateObjectTransformData(*gear.gear_gl_ob);
+		}
+	}
+}
+
+
+void AvatarGraphics::updatePose(const Vec3d& pos, const Vec3f& cam_rotation, bool use_xyplane_speed_rel_ground_override, float xyplane_speed_rel_ground_override, 
+	const Matrix4f& pre_ob_to_world_matrix, uint32 anim_state, double cur_time, double dt, const PoseConstraint& pose_constraint, AnimEvents& anim_events_out)
+{
+	if(dt == 0.0) // May happen in web client, avoid dividing by zero below.
+		return;
 
+	if(skinned_gl_ob && skinned_gl_ob->mesh_data)
+	{
 		const AnimationData& anim_data = skinned_gl_ob->mesh_data->animation_data;
 		js::Vector<GLObjectAnimNodeData, 16>& anim_node_data = skinned_gl_ob->anim_node_data;
 
@@ -868,8 +898,6 @@ void AvatarGraphics::setOverallTransform(OpenGLEngine& engine, PhysicsWorld& phy
 				Matrix4f::rotationAroundZAxis(Maths::pi_2<float>()) * pre_ob_to_world_matrix;
 		} // end if not sitting
 
-		engine.updateObjectTransformData(*skinned_gl_ob);
-
 		// See if we need to start a transition to a new animation
 		if(new_anim_i != skinned_gl_ob->current_anim_i)
 		{
@@ -1229,11 +1257,7 @@ void AvatarGraphics::setOverallTransform(OpenGLEngine& engine, PhysicsWorld& phy
 			if(gear.gear_gl_ob && gear.bone_node_i != -1)
 			{
 				if(gear.bone_node_i >= 0 && gear.bone_node_i < (int)skinned_gl_ob->anim_node_data.size())
-				{
 					gear.gear_gl_ob->ob_to_world_matrix = (skinned_gl_ob->ob_to_world_matrix * skinned_gl_ob->anim_node_data[gear.bone_node_i].node_hierarchical_to_object) * gear.transform;
-
-					engine.updateObjectTransformData(*gear.gear_gl_ob);
-				}
 			}
 		}
 	}
@@ -1251,10 +1275,29 @@ void AvatarGraphics::setOverallTransform(OpenGLEngine& engine, PhysicsWorld& phy
 
 	
 	last_pos = pos;
+	posed_pos = pos;
+	posed_gl_ob = skinned_gl_ob.ptr();
 	last_cam_rotation = cam_rotation;
 }
 
 
+void AvatarGraphics::translateLastPose(const Vec3d& pos)
+{
+	if(skinned_gl_ob)
+	{
+		const Vec4f offset = (pos - posed_pos).toVec4fVector();
+
+		skinned_gl_ob->ob_to_world_matrix.setColumn(3, skinned_gl_ob->ob_to_world_matrix.getColumn(3) + offset);
+
+		for(size_t i=0; i<equipped_gear_graphics.size(); ++i)
+			if(equipped_gear_graphics[i].gear_gl_ob)
+				equipped_gear_graphics[i].gear_gl_ob->ob_to_world_matrix.setColumn(3, equipped_gear_graphics[i].gear_gl_ob->ob_to_world_matrix.getColumn(3) + offset);
+	}
+
+	posed_pos = pos;
+}
+
+
 //void AvatarGraphics::create(OpenGLEngine& engine, const std::string& URL)
 //{
 //}
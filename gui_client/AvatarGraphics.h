@@ -29,7 +29,7 @@ class Avatar;
 
 struct AnimEvents
 {
-	AnimEvents() : footstrike(false) {}
+	AnimEvents() : footstrike(false), num_blobs(0) {}
 	bool footstrike;
 	Vec3d footstrike_pos;
 
@@ -133,6 +133,22 @@ public:
 	void setOverallTransform(OpenGLEngine& engine, PhysicsWorld& physics_world, ParticleManager& particle_manager, const Vec3d& pos, const Vec3f& rotation, bool use_xyplane_speed_rel_ground_override, float xyplane_speed_rel_ground_override,
 		const Matrix4f& pre_ob_to_world_matrix, uint32 anim_state, double cur_time, double dt, const PoseConstraint& pose_constraint, AnimEvents& anim_events_out);
 
+	// setOverallTransform() is split into two parts:
+	// updatePose() works out the animation to play and the procedural bone transforms, and sets the object-to-world matrices of skinned_gl_ob and the gear objects.
+	// It only touches the state of this avatar, so may be called for different avatars in parallel.
+	void updatePose(const Vec3d& pos, const Vec3f& rotation, bool use_xyplane_speed_rel_ground_override, float xyplane_speed_rel_ground_override,
+		const Matrix4f& pre_ob_to_world_matrix, uint32 anim_state, double cur_time, double dt, const PoseConstraint& pose_constraint, AnimEvents& anim_events_out);
+
+	// applyPose() passes the results of updatePose() to the OpenGL engine and physics world.  Main thread only.
+	void applyPose(OpenGLEngine& engine, PhysicsWorld& physics_world, const Vec3d& pos);
+
+	// Moves the avatar to pos, keeping the pose from the last updatePose() call.  Used instead of updatePose() on frames where the pose update is skipped due to animation LOD.
+	// applyPose() should be called afterwards.
+	void translateLastPose(const Vec3d& pos);
+
+	// Has updatePose() been called since skinned_gl_ob was last set?
+	bool hasPoseForCurrentModel() const { return skinned_gl_ob.ptr() == posed_gl_ob; }
+
 	void build(bool our_avatar);
 	//void create(OpenGLEngine& engine, const std::string& URL);
 	void updateGearBones();
@@ -172,11 +188,16 @@ public:
 
 	Reference<MeshData> mesh_data; // Hang on to a reference to the mesh data, so when object-uses of it are removed, it can be removed from the MeshManager with meshDataBecameUnused().
 
+	double skipped_pose_dt; // Sum of dt over the frames since the last updatePose() call, for frames where the pose update was skipped due to animation LOD.
+	AnimEvents last_anim_events; // Anim events from the last updatePose() call.
+
 private:
 	Vec3f avatar_rotation_at_turn_start;
 	Vec3f avatar_rotation; // The avatar rotation is decoupled from the camera rotation.  The avatar will perform a turn animation when the difference becomes too large.
 	Vec3f last_cam_rotation;
 	Vec3d last_pos;
+	Vec3d posed_pos; // The position that the current skinned_gl_ob and gear object-to-world matrices were computed for.
+	const GLObject* posed_gl_ob; // The skinned_gl_ob at the last updatePose() call.  Just used for comparison, may be dangling.
 	Vec3d last_vel;
 	Vec3d last_hand_pos;
 	Vec3d last_selected_ob_target_pos;
@@ -0,0 +1,250 @@
+/*=====================================================================
+AvatarPoseUpdater.cpp
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "AvatarPoseUpdater.h"
+
+
+#include "../shared/Avatar.h"
+#include <utils/TaskManager.h>
+#include <maths/mathstypes.h>
+#include <tracy/Tracy.hpp>
+
+
+// Don't make tasks with fewer avatars than this, the task overhead would outweigh the gains.
+static const size_t MIN_AVATARS_PER_TASK = 4;
+
+
+class AvatarPoseUpdateTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		for(size_t i=begin; i<end; ++i)
+		{
+			AvatarPoseUpdateJob& job = *jobs[i];
+			Avatar* avatar = job.avatar;
+			avatar->graphics.updatePose(job.pos, job.rotation, job.use_xyplane_speed_rel_ground_override, job.xyplane_speed_rel_ground_override,
+				avatar->avatar_settings.pre_ob_to_world_matrix, avatar->anim_state, cur_time, job.dt, job.pose_constraint, job.anim_events);
+			avatar->graphics.last_anim_events = job.anim_events;
+		}
+	}
+
+	AvatarPoseUpdateJob* const* jobs;
+	size_t begin, end;
+	double cur_time;
+};
+
+
+AvatarPoseUpdater::AvatarPoseUpdater()
+{}
+
+
+AvatarPoseUpdater::~AvatarPoseUpdater()
+{}
+
+
+int AvatarPoseUpdater::getUpdatePeriod(float cam_to_avatar_d2)
+{
+	if(cam_to_avatar_d2 < Maths::square(30.f))
+		return 1;
+	else if(cam_to_avatar_d2 < Maths::square(60.f))
+		return 2;
+	else if(cam_to_avatar_d2 < Maths::square(120.f))
+		return 4;
+	else
+		return 8;
+}
+
+
+void AvatarPoseUpdater::scheduleUpdate(AvatarGraphics& graphics, bool always_update, float cam_to_avatar_d2, uint64 frame_num, uint64 stagger_key, double frame_dt, AvatarPoseUpdateJob& job)
+{
+	// Always update if the avatar model has changed since the last update, since there is no previous pose for the model.
+	const int period = (always_update || !graphics.hasPoseForCurrentModel()) ? 1 : getUpdatePeriod(cam_to_avatar_d2);
+
+	job.update_pose = ((frame_num + stagger_key) & (uint64)(period - 1)) == 0;
+	if(job.update_pose)
+	{
+		job.dt = graphics.skipped_pose_dt + frame_dt;
+		graphics.skipped_pose_dt = 0;
+	}
+	else
+	{
+		job.dt = 0;
+		graphics.skipped_pose_dt += frame_dt;
+
+		// The pose isn't changing, so reuse the blob shadow positions from the last update, but don't repeat any footstrike.
+		job.anim_events = graphics.last_anim_events;
+		job.anim_events.footstrike = false;
+	}
+}
+
+
+void AvatarPoseUpdater::updatePoses(std::vector<AvatarPoseUpdateJob>& jobs, double cur_time, glare::TaskManager* task_manager)
+{
+	ZoneScoped; // Tracy profiler
+
+	jobs_to_update.clear();
+	for(size_t i=0; i<jobs.size(); ++i)
+		if(jobs[i].update_pose)
+			jobs_to_update.push_back(&jobs[i]);
+
+	const size_t num_jobs = jobs_to_update.size();
+	const size_t num_tasks = task_manager ? myClamp<size_t>(num_jobs / MIN_AVATARS_PER_TASK, 1, task_manager->getConcurrency()) : 1;
+	if(num_tasks <= 1)
+	{
+		AvatarPoseUpdateTask task;
+		task.jobs = jobs_to_update.data();
+		task.begin = 0;
+		task.end = num_jobs;
+		task.cur_time = cur_time;
+		task.run(0);
+		return;
+	}
+
+	const size_t jobs_per_task = Maths::roundedUpDivide(num_jobs, num_tasks);
+
+	Reference<glare::TaskGroup> task_group = new glare::TaskGroup();
+	for(size_t begin = 0; begin < num_jobs; begin += jobs_per_task)
+	{
+		const size_t task_i = task_group->tasks.size();
+		if(task_i >= tasks.size())
+			tasks.push_back(new AvatarPoseUpdateTask());
+
+		AvatarPoseUpdateTask* task = tasks[task_i].ptr();
+		task->jobs = jobs_to_update.data();
+		task->begin = begin;
+		task->end = myMin(begin + jobs_per_task, num_jobs);
+		task->cur_time = cur_time;
+		task_group->tasks.push_back(task);
+	}
+
+	task_manager->runTaskGroup(task_group);
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+
+
+void AvatarPoseUpdater::test()
+{
+	conPrint("AvatarPoseUpdater::test()");
+
+	//------------------------ Test getUpdatePeriod() ------------------------
+	{
+		testAssert(getUpdatePeriod(0.f) == 1);
+		testAssert(getUpdatePeriod(Maths::square(29.f)) == 1);
+		testAssert(getUpdatePeriod(Maths::square(31.f)) == 2);
+		testAssert(getUpdatePeriod(Maths::square(100.f)) == 4);
+		testAssert(getUpdatePeriod(Maths::square(1000.f)) == 8);
+
+		int last_period = 1;
+		for(float d=0; d<1000.f; d += 1.f)
+		{
+			const int period = getUpdatePeriod(d * d);
+			testAssert(period >= last_period); // Check period is non-decreasing with distance
+			testAssert(period >= 1 && period <= 8 && ((period & (period - 1)) == 0)); // Check power of 2
+			last_period = period;
+		}
+	}
+
+	//------------------------ Test scheduleUpdate() ------------------------
+	{
+		const int num_avatars = 64;
+		const int num_frames = 64;
+		const double frame_dt = 0.01;
+		std::vector<Reference<AvatarGraphics>> graphics(num_avatars);
+		for(int i=0; i<num_avatars; ++i)
+			graphics[i] = new AvatarGraphics(/*avatar=*/NULL);
+
+		std::vector<int> num_updates(num_avatars, 0);
+		std::vector<double> total_dt(num_avatars, 0.0);
+		AvatarPoseUpdateJob job;
+		for(uint64 frame = 0; frame < (uint64)num_frames; ++frame)
+		{
+			int num_updated_this_frame = 0;
+			for(int i=0; i<num_avatars; ++i)
+			{
+				const float dist = (i == 0) ? 1000.f : (float)(i * 4); // Avatar 0 is always updated but far away.
+				scheduleUpdate(*graphics[i], /*always_update=*/i == 0, dist * dist, frame, /*stagger_key=*/(uint64)i, frame_dt, job);
+				if(job.update_pose)
+				{
+					num_updates[i]++;
+					total_dt[i] += job.dt;
+					num_updated_this_frame++;
+				}
+				else
+					testAssert(job.dt == 0);
+			}
+			testAssert(num_updated_this_frame > 0 && num_updated_this_frame < num_avatars);
+		}
+
+		for(int i=0; i<num_avatars; ++i)
+		{
+			const float dist = (i == 0) ? 1000.f : (float)(i * 4);
+			const int period = (i == 0) ? 1 : getUpdatePeriod(dist * dist);
+			testAssert(num_updates[i] == num_frames / period);
+
+			// The dt values passed to the updates, plus the dt since the last update, should sum to the total elapsed time.
+			testAssert(epsEqual(total_dt[i] + graphics[i]->skipped_pose_dt, num_frames * frame_dt));
+		}
+
+		// Check the updates are spread evenly over frames, for avatars with the same update period.
+		for(uint64 frame = 0; frame < 8; ++frame)
+		{
+			int num_updated_this_frame = 0;
+			for(int i=0; i<num_avatars; ++i)
+			{
+				AvatarGraphics temp_graphics(/*avatar=*/NULL);
+				scheduleUpdate(temp_graphics, /*always_update=*/false, Maths::square(1000.f), frame, /*stagger_key=*/(uint64)i, frame_dt, job);
+				if(job.update_pose)
+					num_updated_this_frame++;
+			}
+			testAssert(num_updated_this_frame == num_avatars / 8);
+		}
+	}
+
+	//------------------------ Test updatePoses() ------------------------
+	{
+		glare::TaskManager task_manager;
+		AvatarPoseUpdater updater;
+
+		for(int use_task_manager=0; use_task_manager<2; ++use_task_manager)
+		{
+			const int num_avatars = 100;
+			std::vector<Reference<Avatar>> avatars(num_avatars);
+			std::vector<AvatarPoseUpdateJob> jobs(num_avatars);
+			for(int i=0; i<num_avatars; ++i)
+			{
+				avatars[i] = new Avatar();
+				avatars[i]->anim_state = 0;
+
+				AvatarPoseUpdateJob& job = jobs[i];
+				job.avatar = avatars[i].ptr();
+				job.pos = Vec3d(i, 0, 1.67);
+				job.rotation = Vec3f(0, 0, 0);
+				job.use_xyplane_speed_rel_ground_override = false;
+				job.xyplane_speed_rel_ground_override = 0;
+				job.update_pose = (i % 3) != 0;
+				job.dt = 0.01;
+				job.anim_events.num_blobs = -1;
+			}
+
+			updater.updatePoses(jobs, /*cur_time=*/1.0, use_task_manager ? &task_manager : NULL);
+
+			// The avatars don't have any graphics loaded, so updatePose() should just have reset num_blobs, for the avatars that were updated.
+			for(int i=0; i<num_avatars; ++i)
+				testAssert(jobs[i].anim_events.num_blobs == (jobs[i].update_pose ? 0 : -1));
+		}
+	}
+
+	conPrint("AvatarPoseUpdater::test() done.");
+}
+
+
+#endif // BUILD_TESTS
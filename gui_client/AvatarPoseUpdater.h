@@ -0,0 +1,81 @@
+/*=====================================================================
+AvatarPoseUpdater.h
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "AvatarGraphics.h"
+#include <utils/Reference.h>
+#include <vector>
+class Avatar;
+namespace glare { class TaskManager; }
+
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable:4324) // Disable 'structure was padded due to __declspec(align())' warning.
+#endif
+// The inputs and outputs of AvatarGraphics::updatePose() for a single avatar for the current frame.
+struct AvatarPoseUpdateJob
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	Avatar* avatar;
+	Vec3d pos;
+	Vec3f rotation;
+	bool use_xyplane_speed_rel_ground_override;
+	float xyplane_speed_rel_ground_override;
+	PoseConstraint pose_constraint;
+
+	bool update_pose; // Should the pose be updated this frame?  Set by AvatarPoseUpdater::scheduleUpdate().
+	double dt; // Time since the last pose update.  Set by AvatarPoseUpdater::scheduleUpdate().
+
+	AnimEvents anim_events; // Output
+};
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+
+class AvatarPoseUpdateTask;
+
+
+/*=====================================================================
+AvatarPoseUpdater
+-----------------
+Calls AvatarGraphics::updatePose() for all avatars that need a pose
+update this frame, in parallel on a TaskManager.
+The OpenGL engine and physics world updates are done afterwards on the
+main thread with AvatarGraphics::applyPose().
+
+Avatars far from the camera have their pose updated at a reduced rate
+(animation LOD), every 2nd, 4th or 8th frame.  The frames on which each
+avatar is updated are staggered so the work is spread evenly over frames.
+=====================================================================*/
+class AvatarPoseUpdater
+{
+public:
+	AvatarPoseUpdater();
+	~AvatarPoseUpdater();
+
+	// Returns the number of frames between pose updates for an avatar at squared distance cam_to_avatar_d2 from the camera.  Always a power of 2.
+	static int getUpdatePeriod(float cam_to_avatar_d2);
+
+	// Sets job.update_pose and job.dt, based on the avatar distance from the camera.
+	// stagger_key should be different for different avatars, e.g. the avatar UID.
+	// If the update is skipped, frame_dt is accumulated in graphics.skipped_pose_dt so that the next update uses the full time since the last update,
+	// and job.anim_events is set from the last update.
+	static void scheduleUpdate(AvatarGraphics& graphics, bool always_update, float cam_to_avatar_d2, uint64 frame_num, uint64 stagger_key, double frame_dt, AvatarPoseUpdateJob& job);
+
+	// Calls updatePose() for each job with update_pose set.  The world state mutex should be held.
+	// task_manager may be null, in which case the updates are done on the calling thread.
+	void updatePoses(std::vector<AvatarPoseUpdateJob>& jobs, double cur_time, glare::TaskManager* task_manager);
+
+	static void test();
+
+private:
+	std::vector<AvatarPoseUpdateJob*> jobs_to_update;
+	std::vector<Reference<AvatarPoseUpdateTask>> tasks;
+};
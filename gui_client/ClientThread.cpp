@@ -176,6 +176,15 @@ void ClientThread::handleObjectInitialSend(RandomAccessInStream& msg_stream)
 }
 
 
+// Apply staged updates if there is no more data immediately available on the socket, so that a burst of updates gets applied with a single world state lock,
+// but updates are not held back while we are waiting for more data.
+void ClientThread::applyUpdateBatchIfNoDataPending()
+{
+	if(!update_batch.empty() && !socket->readable(/*timeout (s)=*/0.0))
+		update_batch.applyToWorldState(*world_state);
+}
+
+
 void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 {
 	ZoneScopedN("ClientThread::readAndHandleMessage"); // Tracy profiler
@@ -200,6 +209,8 @@ void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 	// Handle ObjectInitialSendCompressed specially since we do a streaming read and decompression of its body.
 	if(msg_type == Protocol::ObjectInitialSendCompressed)
 	{
+		update_batch.applyToWorldState(*world_state); // Apply any staged updates first, to preserve message ordering.
+
 		// Do streaming decompression of objects
 
 		ZoneScopedN("ClientThread: handling ObjectInitialSendCompressed"); // Tracy profiler
@@ -316,6 +327,17 @@ void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 
 	socket->readData(msg_buffer.buf.data() + sizeof(uint32) * 2, msg_len - sizeof(uint32) * 2); // Read rest of message, store in msg_buffer.
 
+	// Transform and full object updates are decoded into update_batch without taking the world state lock, and applied in batches. See ClientUpdateBatch.
+	if(update_batch.stageMessage(msg_type, ArrayRef<uint8>(msg_buffer.buf.data() + sizeof(uint32) * 2, msg_len - sizeof(uint32) * 2), this->client_avatar_uid))
+	{
+		if(update_batch.size() >= MAX_UPDATE_BATCH_SIZE)
+			update_batch.applyToWorldState(*world_state);
+		return;
+	}
+
+	// Apply any staged updates before handling this message, to preserve message ordering.
+	update_batch.applyToWorldState(*world_state);
+
 	switch(msg_type)
 	{
 	case Protocol::AllObjectsSent:
@@ -344,38 +366,6 @@ void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 
 			out_msg_queue->enqueue(new RemoteClientAudioStreamToServerEnded(avatar_uid)); // Inform MainWindow
 
-			break;
-		}
-	case Protocol::AvatarTransformUpdate:
-		{
-			//conPrint("AvatarTransformUpdate");
-			const UID avatar_uid = readUIDFromStream(msg_buffer);
-			const Vec3d pos = readVec3FromStream<double>(msg_buffer);
-			const Vec3f rotation = readVec3FromStream<float>(msg_buffer);
-			const uint32 anim_state_and_input_bitflags = msg_buffer.readUInt32();
-
-			// Look up existing avatar in world state
-			{
-				Lock lock(world_state->mutex);
-				auto res = world_state->avatars.find(avatar_uid);
-				if(res != world_state->avatars.end())
-				{
-					Avatar* avatar = res->second.getPointer();
-					avatar->pos = pos;
-					avatar->rotation = rotation;
-					avatar->anim_state = anim_state_and_input_bitflags & 0xFF;
-					avatar->last_physics_input_bitflags = anim_state_and_input_bitflags >> 16;
-					avatar->transform_dirty = true;
-
-					//conPrint("updated avatar transform");
-
-					avatar->pos_snapshots      [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = pos;
-					avatar->rotation_snapshots [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = rotation;
-					avatar->snapshot_times     [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = Clock::getTimeSinceInit();
-					//avatar->last_snapshot_time = Clock::getCurTimeRealSec();
-					avatar->next_snapshot_i++;
-				}
-			}
 			break;
 		}
 	case Protocol::AvatarFullUpdate:
@@ -606,72 +596,6 @@ void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 
 			break;
 		}
-	case Protocol::ObjectTransformUpdate:
-		{
-			//conPrint("ObjectTransformUpdate");
-			const UID object_uid = readUIDFromStream(msg_buffer);
-			const Vec3d pos = readVec3FromStream<double>(msg_buffer);
-			const Vec3f axis = readVec3FromStream<float>(msg_buffer);
-			const float angle = msg_buffer.readFloat();
-			const Vec3f scale = readVec3FromStream<float>(msg_buffer);
-
-			// Read transform_update_avatar_uid, added during protocol version 36.
-			uint32 transform_update_avatar_uid = std::numeric_limits<uint32>::max();
-			if(!msg_buffer.endOfStream())
-				transform_update_avatar_uid = msg_buffer.readUInt32();
-
-			// conPrint("ClientThread: received ObjectTransformUpdate, transform_update_avatar_uid: " + toString(transform_update_avatar_uid));
-
-			if(transform_update_avatar_uid != (uint32)this->client_avatar_uid.value()) // Discard ObjectTransformUpdate messages we sent. 
-			{
-				// Look up existing object in world state
-				Lock lock(world_state->mutex);
-				auto res = world_state->objects.find(object_uid);
-				if(res != world_state->objects.end())
-				{
-								
-					WorldObject* ob = res.getValue().ptr();
-#if GUI_CLIENT
-					if(!ob->is_selected) // Don't update the selected object - we will consider the local client control authoritative while the object is selected.
-#endif
-					{
-						//conPrint("ObjectTransformUpdate: setting ob pos to " + pos.toString());
-#if GUI_CLIENT
-						//ob->last_pos = ob->pos;
-#endif
-						ob->pos = pos;
-						ob->axis = axis;
-						ob->angle = angle;
-						ob->scale = scale;
-
-						// If we had physics snapshots, reset snapshots.
-						if(ob->snapshots_are_physics_snapshots)
-						{
-							// conPrint("Resetting snapshots.");
-							ob->next_insertable_snapshot_i = 0;
-							ob->next_snapshot_i = 0;
-						}
-						ob->snapshots_are_physics_snapshots = false;
-
-									
-						ob->snapshots[ob->next_snapshot_i % (uint32)WorldObject::HISTORY_BUF_SIZE] = 
-							WorldObject::Snapshot({pos.toVec4fPoint(), Quatf::fromAxisAndAngle(normalise(axis), angle), /*linear vel=*/Vec4f(0.f), /*angular_vel=*/Vec4f(0.f), /*client time=*/0.0, /*local time=*/Clock::getTimeSinceInit()});
-
-						ob->next_snapshot_i++;
-
-						ob->from_remote_transform_dirty = true;
-						world_state->dirty_from_remote_objects.insert(ob);
-
-						//conPrint("updated object transform");
-					}
-				}
-			}
-			else
-			{
-				// conPrint("\tDiscarding ObjectTransformUpdate message, as we sent it.");
-			}
-			break;
-		}
 		case Protocol::ObjectMoveTo:
 		{
 			Reference<ScriptedObMoveToMessage> m = new ScriptedObMoveToMessage();
@@ -733,113 +657,6 @@ void ClientThread::readAndHandleMessage(const uint32 peer_protocol_version)
 			}
 			break;
 		}
-	case Protocol::ObjectPhysicsTransformUpdate:
-		{
-			const UID object_uid = readUIDFromStream(msg_buffer);
-			const Vec3d pos = readVec3FromStream<double>(msg_buffer);
-
-			Quatf rot;
-			msg_buffer.readData(rot.v.x, sizeof(float) * 4);
-
-			Vec4f linear_vel(0.f);
-			msg_buffer.readData(linear_vel.x, sizeof(float) * 3);
-
-			Vec4f angular_vel(0.f);
-			msg_buffer.readData(angular_vel.x, sizeof(float) * 3);
-
-			const uint32 transform_update_avatar_uid = msg_buffer.readUInt32();
-			const double transform_client_time = msg_buffer.readDouble();
-
-			//conPrint("ClientThread: received ObjectPhysicsTransformUpdate, transform_update_avatar_uid: " + toString(transform_update_avatar_uid));
-			//conPrint("transform_client_time: " + toString(transform_client_time) + ", cur global time: " + toString(world_state->getCurrentGlobalTime()));
-
-			if(transform_update_avatar_uid != (uint32)this->client_avatar_uid.value()) // Discard ObjectPhysicsTransformUpdate messages we sent.
-			{
-				// Look up existing object in world state
-				Lock lock(world_state->mutex);
-				auto res = world_state->objects.find(object_uid);
-				if(res != world_state->objects.end())
-				{
-					WorldObject* ob = res.getValue().ptr();
-
-					if(ob->physics_owner_id == transform_update_avatar_uid) // Only process messages that are from the physics owner of this object, discard others.
-					{
-						// If we had non-physics snapshots, reset snapshots.
-						if(!ob->snapshots_are_physics_snapshots)
-						{
-							// conPrint("Resetting snapshots.");
-							ob->next_insertable_snapshot_i = 0;
-							ob->next_snapshot_i = 0;
-						}
-						ob->snapshots_are_physics_snapshots = true;
-
-						const double local_time = Clock::getTimeSinceInit();
-
-						ob->snapshots[ob->next_snapshot_i % (uint32)WorldObject::HISTORY_BUF_SIZE] = WorldObject::Snapshot({pos.toVec4fPoint(), rot, linear_vel, angular_vel, transform_client_time, local_time});
-
-						ob->next_snapshot_i++;
-
-						// conPrint("ClientThread: Added snapshot " + toString(ob->next_snapshot_i));
-
-						//NEW: Compute transmission_time_offset: An estimate of local_clock_time - sending_clock_time.
-						// TODO: Handle a different client taking over sending messages.
-						/*if(ob->transmission_time_offset == std::numeric_limits<double>::infinity())
-						{
-							ob->transmission_time_offset = Clock::getTimeSinceInit() - last_transform_client_time;
-
-							conPrint("Storing new ob->transmission_time_offset: " + doubleToString(ob->transmission_time_offset));
-						}*/
-
-						ob->from_remote_physics_transform_dirty = true;
-						world_state->dirty_from_remote_objects.insert(ob);
-					}
-					else
-					{
-						// conPrint("\tDiscarding ObjectPhysicsTransformUpdate message as not from physics owner of object.");
-					}
-				}
-			}
-			else
-			{
-				// conPrint("\tDiscarding ObjectPhysicsTransformUpdate message as we sent it.");
-			}
-
-			break;
-		}
-	case Protocol::ObjectFullUpdate:
-		{
-			//conPrint("ObjectFullUpdate");
-			const UID object_uid = readUIDFromStream(msg_buffer);
-
-			// Look up existing object in world state
-			{
-				bool read = false;
-				Lock lock(world_state->mutex);
-				auto res = world_state->objects.find(object_uid);
-				if(res != world_state->objects.end())
-				{
-					WorldObject* ob = res.getValue().ptr();
-#if GUI_CLIENT
-					if(!ob->is_selected) // Don't update the selected object - we will consider the local client control authoritative while the object is selected.
-#endif
-					{
-						readWorldObjectFromNetworkStreamGivenUID(msg_buffer, *ob);
-						read = true;
-						ob->from_remote_other_dirty = true;
-						world_state->dirty_from_remote_objects.insert(ob);
-					}
-				}
-
-				// Make sure we have read the whole object from the network stream
-				if(!read)
-				{
-					WorldObject dummy;
-					readWorldObjectFromNetworkStreamGivenUID(msg_buffer, dummy);
-				}
-
-			}
-			break;
-		}
 	case Protocol::ObjectLightmapURLChanged:
 		{
 			//conPrint("ObjectLightmapURLChanged");
@@ -1506,6 +1323,8 @@ void ClientThread::doRun()
 
 			// TODO: remove readable() check for win32, since we can interrupt socket calls properly and cleanly now.
 
+			applyUpdateBatchIfNoDataPending();
+
 			if(socket->readable(/*timeout (s)=*/0.1)) // If socket has some data to read from it:  (Use a timeout so we can check should_die occasionally)
 			{
 				readAndHandleMessage(peer_protocol_version);
@@ -1515,8 +1334,12 @@ void ClientThread::doRun()
 			
 			readAndHandleMessage(peer_protocol_version);
 
+			update_batch.applyToWorldState(*world_state); // We can't check if more data is pending without blocking, so just apply updates after each message.
+
 #else // Else Linux:
 
+			applyUpdateBatchIfNoDataPending();
+
 			// Block until either the socket is readable or the event fd is signalled, which means should_die has been set.
 			if(socket->readable(event_fd)) // If there is some data to read:
 			{
@@ -7,6 +7,7 @@ Copyright Glare Technologies Limited 2024 -
 
 
 #include "ThreadMessages.h"
+#include "ClientUpdateBatch.h"
 #include "../shared/WorldSettings.h"
 #include "../shared/UID.h"
 #include "../shared/UserID.h"
@@ -279,6 +280,7 @@ public:
 	void killConnection();
 private:
 	void readAndHandleMessage(uint32 peer_protocol_version);
+	void applyUpdateBatchIfNoDataPending();
 	void handleObjectInitialSend(RandomAccessInStream& msg_stream);
 
 	Reference<WorldState> world_state;
@@ -304,6 +306,9 @@ private:
 
 	BufferInStream msg_buffer;
 
+	static const size_t MAX_UPDATE_BATCH_SIZE = 1024;
+	ClientUpdateBatch update_batch; // Staged transform and object updates, not yet applied to world_state.
+
 	Reference<glare::FastPoolAllocator> world_ob_pool_allocator;
 
 	ThreadManager client_sender_thread_manager;
@@ -20,14 +20,13 @@ Copyright Glare Technologies Limited 2023 -
 #include <MySocket.h>
 #include <PlatformUtils.h>
 #include <Networking.h>
-#include <opus.h>
 
 
-ClientUDPHandlerThread::ClientUDPHandlerThread(Reference<UDPSocket> udp_socket_, const std::string& server_hostname_, WorldState* world_state_, glare::AudioEngine* audio_engine_)
+ClientUDPHandlerThread::ClientUDPHandlerThread(Reference<UDPSocket> udp_socket_, const std::string& server_hostname_, WorldState* world_state_, Reference<VoiceReceiver> voice_receiver_)
 :	udp_socket(udp_socket_),
 	server_hostname(server_hostname_),
 	world_state(world_state_),
-	audio_engine(audio_engine_)
+	voice_receiver(voice_receiver_)
 {
 }
 
@@ -38,21 +37,11 @@ ClientUDPHandlerThread::~ClientUDPHandlerThread()
 }
 
 
-struct AvatarVoiceStreamInfo
-{
-	Reference<glare::AudioSource> avatar_audio_source;
-	OpusDecoder* opus_decoder;
-	uint32 sampling_rate;
-	uint32 stream_id;
-	uint32 next_seq_num_expected;
-};
-
-
 void ClientUDPHandlerThread::doRun()
 {
 	PlatformUtils::setCurrentThreadNameIfTestsEnabled("ClientUDPHandlerThread");
 
-	std::unordered_map<uint32, AvatarVoiceStreamInfo> avatar_stream_info; // Map from avatar UID to AvatarVoiceStreamInfo for that avatar.
+	std::vector<uint32> stream_avatar_ids;
 
 	try
 	{
@@ -61,7 +50,6 @@ void ClientUDPHandlerThread::doRun()
 		const IPAddress server_ip_addr = server_ips[0];
 
 		std::vector<uint8> packet_buf(4096);
-		std::vector<float> pcm_buffer(480);
 
 		while(die == 0)
 		{
@@ -80,51 +68,17 @@ void ClientUDPHandlerThread::doRun()
 				{
 					Avatar* av = it->second.ptr();
 
-					// If there is an avatar not in our avatar_stream_info map, that has an audio source, add it to our map.
-					// If we are already have stream info, but stream IDs differ: this indicates a new stream has been created.  We need to reset the expected next sequence number.  We will also recreate the Opus decoder in this case.
-					bool create_stream_info = false; // Should we (re)create stream info for this avatar?
+					// If there is an avatar that has an audio source, make sure we have a voice stream for it.
+					// If we already have a stream, but stream IDs differ, this indicates a new stream has been created, and the voice receiver will recreate the stream.
 					if(av->audio_source.nonNull())
-					{
-						auto info_res = avatar_stream_info.find((uint32)av->uid.value());
-						if(info_res == avatar_stream_info.end())
-							create_stream_info = true;
-						else // Else if we already have stream info for this avatar:
-						{
-							AvatarVoiceStreamInfo& stream_info = info_res->second;
-							if(stream_info.stream_id != av->audio_stream_id) // But the stream ID is different:
-							{
-								if(stream_info.opus_decoder)
-								{
-									conPrint("Stream ID changed, destroying existing Opus decoder.");
-									opus_decoder_destroy(stream_info.opus_decoder);
-								}
-								create_stream_info = true;
-							}
-						}
-					}
-
-					if(create_stream_info)
-					{
-						const uint32 sampling_rate = av->audio_stream_sampling_rate;
-
-						conPrint("Creating Opus decoder for avatar, sampling_rate: " + toString(sampling_rate));
-
-						int opus_error = 0;
-						OpusDecoder* opus_decoder = opus_decoder_create(
-							sampling_rate, // sampling rate
-							1, // channels
-							&opus_error
-						);
-						if(opus_error != OPUS_OK)
-							throw glare::Exception("opus_decoder_create failed.");
-
-						avatar_stream_info[(uint32)av->uid.value()] = AvatarVoiceStreamInfo({av->audio_source, opus_decoder, sampling_rate, /*stream_id=*/av->audio_stream_id, /*next_seq_num_expected=*/0});
-					}
+						voice_receiver->createOrUpdateStream((uint32)av->uid.value(), av->audio_source, av->audio_stream_sampling_rate, /*stream_id=*/av->audio_stream_id);
 				}
 
-				for(auto it = avatar_stream_info.begin(); it != avatar_stream_info.end();)
+				// Remove streams for avatars that no longer exist, or that no longer have an audio source.
+				voice_receiver->getStreamAvatarIDs(stream_avatar_ids);
+				for(size_t i=0; i<stream_avatar_ids.size(); ++i)
 				{
-					const UID avatar_uid(it->first);
+					const UID avatar_uid(stream_avatar_ids[i]);
 
 					bool remove = false;
 					auto res = world_state->avatars.find(avatar_uid);
@@ -139,12 +93,9 @@ void ClientUDPHandlerThread::doRun()
 
 					if(remove)
 					{
-						conPrint("Destroying Opus decoder for avatar");
-						opus_decoder_destroy(it->second.opus_decoder);
-						it = avatar_stream_info.erase(it); // Remove from our stream info map
+						conPrint("Removing voice stream for avatar");
+						voice_receiver->removeStream(stream_avatar_ids[i]);
 					}
-					else
-						++it;
 				}
 
 				world_state->avatars_changed = 0;
@@ -164,96 +115,31 @@ void ClientUDPHandlerThread::doRun()
 							uint32 avatar_id;
 							std::memcpy(&avatar_id, packet_buf.data() + 4, 4);
 
-							// Lookup VoiceChatStreamInfo from avatar_id
-							auto res = avatar_stream_info.find(avatar_id);
-							if(res != avatar_stream_info.end())
-							{
-								AvatarVoiceStreamInfo* stream_info = &res->second;
-
-								uint32 rcvd_seq_num;
-								std::memcpy(&rcvd_seq_num, packet_buf.data() + 8, 4);
-
-								//conPrint("Received voice packet for avatar (UID: " + toString(avatar_id) + ", seq num: " + toString(rcvd_seq_num) + ")");
-
-								if(rcvd_seq_num < stream_info->next_seq_num_expected)
-								{
-									// Discard packet
-									conPrint("Discarding packet.");
-								}
-								else // else seq_num >= next_seq_num_expected
-								{
-									/*
-									while(next_seq_num_expected < rcvd_seq_num)
-									{
-										conPrint("Packet was missed, doing loss concealment...");
-										// We received a packet with a sequence number (rcvd_seq_num) greater than the one we were expecting (next_seq_num_expected).  Treat the packets with sequence number < rcvd_seq_num as lost.
-										// Tell Opus we had a missing packet.
-										// "Lost packets can be replaced with loss concealment by calling the decoder with a null pointer and zero length for the missing packet."  https://opus-codec.org/docs/opus_api-1.3.1/group__opus__decoder.html
-
-										// "For the PLC and FEC cases, frame_size must be a multiple of 2.5 ms."
-										// at 48000 hz, 1 sample = 1 / 48000 s^-1 = 2.08333 e-5 s
-										// samples per 2.5 ms = 0.0025 s / 2.08333 e-5 s = 120
-										const int num_samples_decoded = opus_decode_float(stream_info->opus_decoder, NULL, 0, pcm_buffer.data(), 480,//(int)pcm_buffer.size(), 
-											0 // decode_fec
-										);
-										if(num_samples_decoded < 0)
-										{
-											conPrint("Opus decoding failed: " + toString(num_samples_decoded));
-										}
-										next_seq_num_expected++;
-									}
-									assert(rcvd_seq_num == next_seq_num_expected);
-									*/
-
-									// Decode opus packet into pcm_buffer
-									const size_t packet_header_size_B = 12;
-									const size_t opus_packet_len = packet_len - packet_header_size_B;
-									const int num_samples_decoded = opus_decode_float(stream_info->opus_decoder, packet_buf.data() + packet_header_size_B, (int32)opus_packet_len, pcm_buffer.data(), (int)pcm_buffer.size(), 
-										0 // decode_fec
-									);
-									if(num_samples_decoded < 0)
-										conPrint("Opus decoding failed: " + toString(num_samples_decoded));
-									else
-									{
-										// We are using 10ms frames, so expect sampling_rate * 0.01 samples.
-										if(num_samples_decoded != (int)stream_info->sampling_rate / 100)
-											conPrint("Unexpected number of samples");
-										else
-										{
-											// Get max abs value in decoded buffer
-											float max_val = 0;
-											for(int i=0; i<num_samples_decoded; ++i)
-												max_val = myMax(max_val, std::fabs(pcm_buffer[i]));
-											//printVar(max_val);
-
-											// Append to audio source buffer
-											Lock lock(audio_engine->mutex);
-
-											// If too much data is queued up for this audio source:
-											if(stream_info->avatar_audio_source->buffer.size() > 4096) // 4096 samples ~= 85 ms at 48 khz
-											{
-												// Pop all but 2048 items from the buffer.
-												const size_t num_samples_to_remove = stream_info->avatar_audio_source->buffer.size() - 2048;
-												conPrint("Audio source buffer too full, removing " + toString(num_samples_to_remove) + " samples");
-
-												stream_info->avatar_audio_source->buffer.popFrontNItems(num_samples_to_remove);
-											}
-
-											stream_info->avatar_audio_source->buffer.pushBackNItems(pcm_buffer.data(), num_samples_decoded);
-
-											stream_info->avatar_audio_source->smoothed_cur_level = myMax(stream_info->avatar_audio_source->smoothed_cur_level * 0.95f, max_val);
-										}
-
-										// conPrint("ClientUDPHandlerThread: decoded " + toString(num_samples_decoded) + " samples.");
-
-										stream_info->next_seq_num_expected++;
-									}
-								}
-							}
-							else
-							{
-								// conPrint("Received voice packet for avatar without streaming context. UID: " + toString(avatar_id));
-							}
+							uint32 rcvd_seq_num;
+							std::memcpy(&rcvd_seq_num, packet_buf.data() + 8, 4);
+
+							//conPrint("Received voice packet for avatar (UID: " + toString(avatar_id) + ", seq num: " + toString(rcvd_seq_num) + ")");
+
+							// Put the packet in the jitter buffer for the stream.  It will be decoded on a voice receiver worker thread.
+							const size_t packet_header_size_B = 12;
+							voice_receiver->handleVoicePacket(avatar_id, rcvd_seq_num, packet_buf.data() + packet_header_size_B, packet_len - packet_header_size_B);
+						}
+					}
+					else if(type == 3) // If packet is a server-mixed voice stream for a region of distant speakers:
+					{
+						const size_t packet_header_size_B = 24;
+						if(packet_len > packet_header_size_B)
+						{
+							uint32 stream_id;
+							std::memcpy(&stream_id, packet_buf.data() + 4, 4);
+
+							uint32 rcvd_seq_num;
+							std::memcpy(&rcvd_seq_num, packet_buf.data() + 8, 4);
+
+							float pos[3];
+							std::memcpy(pos, packet_buf.data() + 12, 12);
+
+							voice_receiver->handleMixedVoicePacket(stream_id, rcvd_seq_num, Vec4f(pos[0], pos[1], pos[2], 1.f), packet_buf.data() + packet_header_size_B, packet_len - packet_header_size_B);
 						}
 					}
 				}
@@ -279,10 +165,6 @@ void ClientUDPHandlerThread::doRun()
 		conPrint("ClientUDPHandlerThread: Caught std::bad_alloc.");
 	}
 
-	// Destroy Opus decoders
-	for(auto it = avatar_stream_info.begin(); it != avatar_stream_info.end(); ++it)
-		opus_decoder_destroy(it->second.opus_decoder);
-
 	udp_socket = NULL;
 }
 
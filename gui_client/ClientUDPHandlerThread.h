@@ -16,18 +16,20 @@ Copyright Glare Technologies Limited 2023 -
 #include <Vector.h>
 #include <BufferInStream.h>
 #include <string>
-#include "../audio/AudioEngine.h"
+#include "VoiceReceiver.h"
 class WorldState;
 
 
 /*=====================================================================
 ClientUDPHandlerThread
 ----------------------
+Receives UDP packets from the server.  Voice packets are passed to
+VoiceReceiver for decoding.
 =====================================================================*/
 class ClientUDPHandlerThread : public MessageableThread
 {
 public:
-	ClientUDPHandlerThread(Reference<UDPSocket> udp_socket, const std::string& server_hostname, WorldState* world_state, glare::AudioEngine* audio_engine);
+	ClientUDPHandlerThread(Reference<UDPSocket> udp_socket, const std::string& server_hostname, WorldState* world_state, Reference<VoiceReceiver> voice_receiver);
 	virtual ~ClientUDPHandlerThread();
 
 	virtual void doRun() override;
@@ -40,5 +42,5 @@ public:
 	std::string server_hostname;
 
 	WorldState* world_state;
-	glare::AudioEngine* audio_engine;
+	Reference<VoiceReceiver> voice_receiver;
 };
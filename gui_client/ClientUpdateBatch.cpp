@@ -0,0 +1,473 @@
+/*=====================================================================
+ClientUpdateBatch.cpp
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ClientUpdateBatch.h"
+
+
+#include "WorldState.h"
+#include "../shared/Protocol.h"
+#include "../shared/WorldObject.h"
+#include "../shared/Avatar.h"
+#include <utils/BufferViewInStream.h>
+#include <utils/Clock.h>
+#include <utils/Lock.h>
+#include <cstring>
+#include <limits>
+
+
+ClientUpdateBatch::ClientUpdateBatch()
+{}
+
+
+ClientUpdateBatch::~ClientUpdateBatch()
+{}
+
+
+void ClientUpdateBatch::clear()
+{
+	updates.clear();
+	full_update_obs.clear();
+}
+
+
+bool ClientUpdateBatch::stageMessage(uint32 msg_type, ArrayRef<uint8> msg_body, UID client_avatar_uid)
+{
+	if(!(msg_type == Protocol::ObjectTransformUpdate || msg_type == Protocol::ObjectPhysicsTransformUpdate || msg_type == Protocol::AvatarTransformUpdate || msg_type == Protocol::ObjectFullUpdate))
+		return false;
+
+	BufferViewInStream msg_buffer(msg_body);
+
+	StagedUpdate update;
+	update.msg_type = msg_type;
+	update.uid = readUIDFromStream(msg_buffer);
+	update.local_time = Clock::getTimeSinceInit();
+
+	if(msg_type == Protocol::ObjectTransformUpdate)
+	{
+		update.pos = readVec3FromStream<double>(msg_buffer);
+		update.axis = readVec3FromStream<float>(msg_buffer);
+		update.angle = msg_buffer.readFloat();
+		update.scale = readVec3FromStream<float>(msg_buffer);
+
+		// Read transform_update_avatar_uid, added during protocol version 36.
+		update.transform_update_avatar_uid = std::numeric_limits<uint32>::max();
+		if(!msg_buffer.endOfStream())
+			update.transform_update_avatar_uid = msg_buffer.readUInt32();
+
+		if(update.transform_update_avatar_uid == (uint32)client_avatar_uid.value()) // Discard ObjectTransformUpdate messages we sent.
+			return true;
+	}
+	else if(msg_type == Protocol::ObjectPhysicsTransformUpdate)
+	{
+		update.pos = readVec3FromStream<double>(msg_buffer);
+		msg_buffer.readData(update.rot, sizeof(float) * 4);
+		msg_buffer.readData(&update.linear_vel.x, sizeof(float) * 3);
+		msg_buffer.readData(&update.angular_vel.x, sizeof(float) * 3);
+		update.transform_update_avatar_uid = msg_buffer.readUInt32();
+		update.transform_client_time = msg_buffer.readDouble();
+
+		if(update.transform_update_avatar_uid == (uint32)client_avatar_uid.value()) // Discard ObjectPhysicsTransformUpdate messages we sent.
+			return true;
+	}
+	else if(msg_type == Protocol::AvatarTransformUpdate)
+	{
+		update.pos = readVec3FromStream<double>(msg_buffer);
+		update.scale = readVec3FromStream<float>(msg_buffer); // Avatar rotation
+		update.transform_update_avatar_uid = msg_buffer.readUInt32(); // anim_state_and_input_bitflags
+	}
+	else // else if(msg_type == Protocol::ObjectFullUpdate)
+	{
+		// Decode the object data now, so that a malformed message throws here, instead of when the batch is being applied.
+		// A new object is used for each message, since the existing object takes the decoded materials and voxel data when the batch is applied.
+		WorldObjectRef decoded_ob = new WorldObject();
+		readWorldObjectFromNetworkStreamGivenUID(msg_buffer, *decoded_ob);
+
+		update.full_update_ob_index = full_update_obs.size();
+		full_update_obs.push_back(decoded_ob);
+	}
+
+	updates.push_back(update);
+	return true;
+}
+
+
+// Copies the state decoded from an ObjectFullUpdate message into the existing object.
+// Sets the same changed_flags, and updates the same derived data, as readWorldObjectFromNetworkStreamGivenUID() would if reading directly into the object.
+static void applyFullUpdate(const WorldObject& decoded_ob, WorldObject& ob)
+{
+	if(ob.script != decoded_ob.script)
+		ob.changed_flags |= WorldObject::SCRIPT_CHANGED;
+	if(ob.content != decoded_ob.content)
+		ob.changed_flags |= WorldObject::CONTENT_CHANGED;
+	if(ob.audio_source_url != decoded_ob.audio_source_url)
+		ob.changed_flags |= WorldObject::AUDIO_SOURCE_URL_CHANGED;
+	if(ob.physics_owner_id != decoded_ob.physics_owner_id)
+		ob.changed_flags |= WorldObject::PHYSICS_OWNER_CHANGED;
+
+	ob.copyNetworkStateFrom(decoded_ob);
+
+	ob.setCompressedVoxels(ob.compressed_voxels); // Updates compressed_voxels_hash
+	ob.transformChanged(); // Since aabb_os and the transform may have changed.
+}
+
+
+void ClientUpdateBatch::applyToWorldState(WorldState& world_state)
+{
+	if(updates.empty())
+		return;
+
+	{
+		Lock lock(world_state.mutex);
+
+		for(size_t i=0; i<updates.size(); ++i)
+		{
+			const StagedUpdate& update = updates[i];
+
+			if(update.msg_type == Protocol::AvatarTransformUpdate)
+			{
+				auto res = world_state.avatars.find(update.uid);
+				if(res != world_state.avatars.end())
+				{
+					Avatar* avatar = res->second.getPointer();
+					const Vec3f rotation = update.scale;
+					const uint32 anim_state_and_input_bitflags = update.transform_update_avatar_uid;
+					avatar->pos = update.pos;
+					avatar->rotation = rotation;
+					avatar->anim_state = anim_state_and_input_bitflags & 0xFF;
+					avatar->last_physics_input_bitflags = anim_state_and_input_bitflags >> 16;
+					avatar->transform_dirty = true;
+
+					avatar->pos_snapshots      [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = update.pos;
+					avatar->rotation_snapshots [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = rotation;
+					avatar->snapshot_times     [Maths::intMod(avatar->next_snapshot_i, Avatar::HISTORY_BUF_SIZE)] = update.local_time;
+					avatar->next_snapshot_i++;
+				}
+				continue;
+			}
+
+			// Else object update.  Look up existing object in world state
+			auto res = world_state.objects.find(update.uid);
+			if(res == world_state.objects.end())
+				continue;
+
+			WorldObject* ob = res.getValue().ptr();
+
+			if(update.msg_type == Protocol::ObjectTransformUpdate)
+			{
+#if GUI_CLIENT
+				if(!ob->is_selected) // Don't update the selected object - we will consider the local client control authoritative while the object is selected.
+#endif
+				{
+					ob->pos = update.pos;
+					ob->axis = update.axis;
+					ob->angle = update.angle;
+					ob->scale = update.scale;
+
+					// If we had physics snapshots, reset snapshots.
+					if(ob->snapshots_are_physics_snapshots)
+					{
+						ob->next_insertable_snapshot_i = 0;
+						ob->next_snapshot_i = 0;
+					}
+					ob->snapshots_are_physics_snapshots = false;
+
+					ob->snapshots[ob->next_snapshot_i % (uint32)WorldObject::HISTORY_BUF_SIZE] = 
+						WorldObject::Snapshot({update.pos.toVec4fPoint(), Quatf::fromAxisAndAngle(normalise(update.axis), update.angle), /*linear vel=*/Vec4f(0.f), /*angular_vel=*/Vec4f(0.f), /*client time=*/0.0, /*local time=*/update.local_time});
+
+					ob->next_snapshot_i++;
+
+					ob->from_remote_transform_dirty = true;
+					world_state.dirty_from_remote_objects.insert(ob);
+				}
+			}
+			else if(update.msg_type == Protocol::ObjectPhysicsTransformUpdate)
+			{
+				if(ob->physics_owner_id == update.transform_update_avatar_uid) // Only process messages that are from the physics owner of this object, discard others.
+				{
+					// If we had non-physics snapshots, reset snapshots.
+					if(!ob->snapshots_are_physics_snapshots)
+					{
+						ob->next_insertable_snapshot_i = 0;
+						ob->next_snapshot_i = 0;
+					}
+					ob->snapshots_are_physics_snapshots = true;
+
+					const Quatf rot(update.rot[0], update.rot[1], update.rot[2], update.rot[3]);
+					const Vec4f linear_vel(update.linear_vel.x, update.linear_vel.y, update.linear_vel.z, 0.f);
+					const Vec4f angular_vel(update.angular_vel.x, update.angular_vel.y, update.angular_vel.z, 0.f);
+
+					ob->snapshots[ob->next_snapshot_i % (uint32)WorldObject::HISTORY_BUF_SIZE] = WorldObject::Snapshot({update.pos.toVec4fPoint(), rot, linear_vel, angular_vel, update.transform_client_time, update.local_time});
+
+					ob->next_snapshot_i++;
+
+					ob->from_remote_physics_transform_dirty = true;
+					world_state.dirty_from_remote_objects.insert(ob);
+				}
+			}
+			else if(update.msg_type == Protocol::ObjectFullUpdate)
+			{
+#if GUI_CLIENT
+				if(!ob->is_selected) // Don't update the selected object - we will consider the local client control authoritative while the object is selected.
+#endif
+				{
+					applyFullUpdate(*full_update_obs[update.full_update_ob_index], *ob);
+					ob->from_remote_other_dirty = true;
+					world_state.dirty_from_remote_objects.insert(ob);
+				}
+			}
+		}
+	}
+
+	clear();
+}
+
+
+#if BUILD_TESTS
+
+
+#include "../shared/MessageUtils.h"
+#include <utils/SocketBufferOutStream.h>
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Timer.h>
+#include <maths/PCG32.h>
+
+
+// Makes an update stream like the one the server sends in a crowded world: mostly object transform and avatar transform updates, with some object full updates.
+static void makeTestUpdateStream(int num_obs, int num_avatars, int num_messages, const std::vector<WorldObjectRef>& obs, std::vector<uint8>& stream_out)
+{
+	PCG32 rng(1);
+	SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+
+	for(int i=0; i<num_messages; ++i)
+	{
+		const float r = rng.unitRandom();
+		if(r < 0.6f)
+		{
+			const int ob_i = (int)rng.nextUInt((uint32)num_obs);
+			MessageUtils::initPacket(packet, Protocol::ObjectTransformUpdate);
+			writeToStream(obs[ob_i]->uid, packet);
+			writeToStream(Vec3d(rng.unitRandom() * 100, rng.unitRandom() * 100, rng.unitRandom() * 10), packet);
+			writeToStream(Vec3f(0, 0, 1), packet);
+			packet.writeFloat(rng.unitRandom() * 6.f);
+			writeToStream(Vec3f(1, 1, 1), packet);
+			packet.writeUInt32(12345); // transform_update_avatar_uid
+		}
+		else if(r < 0.9f)
+		{
+			MessageUtils::initPacket(packet, Protocol::AvatarTransformUpdate);
+			writeToStream(UID(rng.nextUInt((uint32)num_avatars)), packet);
+			writeToStream(Vec3d(rng.unitRandom() * 100, rng.unitRandom() * 100, 2), packet);
+			writeToStream(Vec3f(0, 0, rng.unitRandom() * 6.f), packet);
+			packet.writeUInt32(1);
+		}
+		else if(r < 0.99f)
+		{
+			const int ob_i = (int)rng.nextUInt((uint32)num_obs);
+			MessageUtils::initPacket(packet, Protocol::ObjectPhysicsTransformUpdate);
+			writeToStream(obs[ob_i]->uid, packet);
+			writeToStream(Vec3d(rng.unitRandom() * 100, rng.unitRandom() * 100, rng.unitRandom() * 10), packet);
+			const float rot[4] = { 0, 0, 0, 1 };
+			packet.writeData(rot, sizeof(float) * 4);
+			const float vel[3] = { 1, 2, 3 };
+			packet.writeData(vel, sizeof(float) * 3);
+			packet.writeData(vel, sizeof(float) * 3);
+			packet.writeUInt32(obs[ob_i]->physics_owner_id);
+			packet.writeDouble(1.0);
+		}
+		else
+		{
+			const int ob_i = (int)rng.nextUInt((uint32)num_obs);
+			WorldObject ob;
+			ob.uid = obs[ob_i]->uid;
+			ob.pos = Vec3d(rng.unitRandom() * 100, rng.unitRandom() * 100, rng.unitRandom() * 10);
+			ob.content = "content " + toString(i);
+			MessageUtils::initPacket(packet, Protocol::ObjectFullUpdate);
+			ob.writeToNetworkStream(packet);
+		}
+		MessageUtils::updatePacketLengthField(packet);
+
+		stream_out.insert(stream_out.end(), packet.buf.begin(), packet.buf.end());
+	}
+}
+
+
+static Reference<WorldState> makeTestWorldState(int num_obs, int num_avatars, std::vector<WorldObjectRef>& obs_out)
+{
+	Reference<WorldState> world_state = new WorldState();
+	Lock lock(world_state->mutex);
+	obs_out.clear();
+	for(int i=0; i<num_obs; ++i)
+	{
+		WorldObjectRef ob = new WorldObject();
+		ob->uid = UID(1000 + i);
+		ob->physics_owner_id = 7;
+		world_state->objects.insert(std::make_pair(ob->uid, ob));
+		obs_out.push_back(ob);
+	}
+	for(int i=0; i<num_avatars; ++i)
+	{
+		Reference<Avatar> avatar = new Avatar();
+		avatar->uid = UID(i);
+		world_state->avatars[avatar->uid] = avatar;
+	}
+	return world_state;
+}
+
+
+// Replays the update stream through a ClientUpdateBatch, applying the batch every max_batch_size messages.  Returns the number of world state lock acquisitions.
+static size_t replayUpdateStream(const std::vector<uint8>& stream, size_t max_batch_size, WorldState& world_state)
+{
+	ClientUpdateBatch batch;
+	size_t num_lock_acquisitions = 0;
+	size_t i = 0;
+	while(i < stream.size())
+	{
+		uint32 header[2];
+		std::memcpy(header, &stream[i], sizeof(uint32) * 2);
+		const uint32 msg_type = header[0];
+		const uint32 msg_len = header[1];
+		testAssert(msg_len >= sizeof(uint32) * 2 && i + msg_len <= stream.size());
+
+		const bool staged = batch.stageMessage(msg_type, ArrayRef<uint8>(&stream[i + sizeof(uint32) * 2], msg_len - sizeof(uint32) * 2), /*client_avatar_uid=*/UID(999999));
+		testAssert(staged);
+
+		if(batch.size() >= max_batch_size)
+		{
+			batch.applyToWorldState(world_state);
+			num_lock_acquisitions++;
+		}
+
+		i += msg_len;
+	}
+	if(!batch.empty())
+	{
+		batch.applyToWorldState(world_state);
+		num_lock_acquisitions++;
+	}
+	return num_lock_acquisitions;
+}
+
+
+void ClientUpdateBatch::test()
+{
+	conPrint("ClientUpdateBatch::test()");
+
+	const int num_obs = 2000;
+	const int num_avatars = 100;
+	const int num_messages = 200000;
+
+	std::vector<WorldObjectRef> obs_a, obs_b;
+	Reference<WorldState> world_state_a = makeTestWorldState(num_obs, num_avatars, obs_a);
+	Reference<WorldState> world_state_b = makeTestWorldState(num_obs, num_avatars, obs_b);
+
+	std::vector<uint8> stream;
+	makeTestUpdateStream(num_obs, num_avatars, num_messages, obs_a, stream);
+
+	// Test that messages that aren't batched are not staged.
+	{
+		ClientUpdateBatch batch;
+		const uint8 dummy[8] = { 0 };
+		testAssert(!batch.stageMessage(Protocol::ObjectDestroyed, ArrayRef<uint8>(dummy, sizeof(dummy)), UID(0)));
+		testAssert(batch.empty());
+	}
+
+	// Test that updates sent by this client are discarded.
+	{
+		SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+		writeToStream(obs_a[0]->uid, packet);
+		writeToStream(Vec3d(1, 2, 3), packet);
+		writeToStream(Vec3f(0, 0, 1), packet);
+		packet.writeFloat(0.f);
+		writeToStream(Vec3f(1, 1, 1), packet);
+		packet.writeUInt32(55); // transform_update_avatar_uid
+
+		ClientUpdateBatch batch;
+		testAssert(batch.stageMessage(Protocol::ObjectTransformUpdate, ArrayRef<uint8>(packet.buf.data(), packet.buf.size()), /*client_avatar_uid=*/UID(55)));
+		testAssert(batch.empty());
+	}
+
+	// Test that a malformed ObjectFullUpdate throws when staged, and doesn't affect updates already staged.
+	{
+		std::vector<WorldObjectRef> test_obs;
+		Reference<WorldState> world_state = makeTestWorldState(/*num_obs=*/1, /*num_avatars=*/0, test_obs);
+
+		SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+		writeToStream(test_obs[0]->uid, packet);
+		writeToStream(Vec3d(1, 2, 3), packet);
+		writeToStream(Vec3f(0, 0, 1), packet);
+		packet.writeFloat(0.f);
+		writeToStream(Vec3f(1, 1, 1), packet);
+		packet.writeUInt32(55); // transform_update_avatar_uid
+
+		ClientUpdateBatch batch;
+		testAssert(batch.stageMessage(Protocol::ObjectTransformUpdate, ArrayRef<uint8>(packet.buf.data(), packet.buf.size()), /*client_avatar_uid=*/UID(999999)));
+		testAssert(batch.size() == 1);
+
+		// Make a full update message, and truncate it after the number of materials.
+		WorldObject ob;
+		ob.uid = test_obs[0]->uid;
+		ob.content = "new content";
+		SocketBufferOutStream full_update_packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+		ob.writeToNetworkStream(full_update_packet);
+		try
+		{
+			batch.stageMessage(Protocol::ObjectFullUpdate, ArrayRef<uint8>(full_update_packet.buf.data(), /*size=*/20), /*client_avatar_uid=*/UID(999999));
+			failTest("Expected exception");
+		}
+		catch(glare::Exception&)
+		{}
+		testAssert(batch.size() == 1);
+
+		// The whole message should be staged fine.
+		testAssert(batch.stageMessage(Protocol::ObjectFullUpdate, ArrayRef<uint8>(full_update_packet.buf.data(), full_update_packet.buf.size()), /*client_avatar_uid=*/UID(999999)));
+		testAssert(batch.size() == 2);
+
+		batch.applyToWorldState(*world_state);
+		testAssert(batch.empty());
+		testAssert(test_obs[0]->content == "new content");
+		testAssert(BitUtils::isBitSet(test_obs[0]->changed_flags, WorldObject::CONTENT_CHANGED));
+		testAssert(!BitUtils::isBitSet(test_obs[0]->changed_flags, WorldObject::SCRIPT_CHANGED));
+	}
+
+	// Replay the stream, applying each message individually (one lock acquisition per message, like ClientThread used to do), then in batches.
+	Timer timer;
+	const size_t unbatched_num_locks = replayUpdateStream(stream, /*max_batch_size=*/1, *world_state_a);
+	const double unbatched_elapsed = timer.elapsed();
+
+	timer.reset();
+	const size_t batched_num_locks = replayUpdateStream(stream, /*max_batch_size=*/256, *world_state_b);
+	const double batched_elapsed = timer.elapsed();
+
+	conPrint("Replayed " + toString(num_messages) + " messages (" + toString(stream.size()) + " B):");
+	conPrint("    unbatched: " + doubleToStringNSigFigs(unbatched_elapsed * 1.0e3, 4) + " ms, " + toString(unbatched_num_locks) + " lock acquisitions");
+	conPrint("    batched:   " + doubleToStringNSigFigs(batched_elapsed * 1.0e3, 4) + " ms, " + toString(batched_num_locks) + " lock acquisitions");
+
+	// Check the resulting world states are the same.
+	{
+		Lock lock_a(world_state_a->mutex);
+		Lock lock_b(world_state_b->mutex);
+		for(int i=0; i<num_obs; ++i)
+		{
+			testAssert(obs_a[i]->pos == obs_b[i]->pos);
+			testAssert(obs_a[i]->angle == obs_b[i]->angle);
+			testAssert(obs_a[i]->content == obs_b[i]->content);
+			testAssert(obs_a[i]->next_snapshot_i == obs_b[i]->next_snapshot_i);
+		}
+		for(auto it = world_state_a->avatars.begin(); it != world_state_a->avatars.end(); ++it)
+		{
+			const Avatar* avatar_b = world_state_b->avatars[it->first].ptr();
+			testAssert(it->second->pos == avatar_b->pos);
+			testAssert(it->second->next_snapshot_i == avatar_b->next_snapshot_i);
+		}
+		testAssert(world_state_a->dirty_from_remote_objects.size() == world_state_b->dirty_from_remote_objects.size());
+	}
+
+	conPrint("ClientUpdateBatch::test() done");
+}
+
+
+#endif // BUILD_TESTS
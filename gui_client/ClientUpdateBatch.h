@@ -0,0 +1,80 @@
+/*=====================================================================
+ClientUpdateBatch.h
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "../shared/UID.h"
+#include "../shared/WorldObject.h"
+#include <maths/vec3.h>
+#include <utils/Platform.h>
+#include <utils/Vector.h>
+#include <utils/ArrayRef.h>
+#include <vector>
+class WorldState;
+
+
+/*=====================================================================
+ClientUpdateBatch
+-----------------
+Staging buffer for object and avatar updates received from the server.
+
+ClientThread decodes ObjectTransformUpdate, ObjectPhysicsTransformUpdate,
+AvatarTransformUpdate and ObjectFullUpdate messages into the batch without
+holding the world state lock, then applies the whole batch with
+applyToWorldState(), which takes the world state lock once.
+
+Messages are fully decoded when staged (ObjectFullUpdate bodies are
+decoded into a new WorldObject, which is copied into the existing object
+when the batch is applied), so a malformed message throws from
+stageMessage(), before any of the batch has been applied.
+
+Updates are applied in the order they were received.  ClientThread applies
+the batch before handling any other message type, so ordering relative to
+other messages (e.g. ObjectDestroyed) is also preserved.
+=====================================================================*/
+class ClientUpdateBatch
+{
+public:
+	ClientUpdateBatch();
+	~ClientUpdateBatch();
+
+	// If msg_type is one of the batched message types, decodes the message body into the batch and returns true.
+	// Otherwise returns false.
+	// Updates that were sent by this client (as identified by client_avatar_uid) are discarded.
+	// Throws glare::Exception if the message is invalid.
+	bool stageMessage(uint32 msg_type, ArrayRef<uint8> msg_body, UID client_avatar_uid);
+
+	// Applies all staged updates to the world state, holding the world state lock once for the whole batch, then clears the batch.
+	void applyToWorldState(WorldState& world_state);
+
+	bool empty() const { return updates.empty(); }
+	size_t size() const { return updates.size(); }
+
+	void clear();
+
+	static void test();
+
+private:
+	struct StagedUpdate
+	{
+		uint32 msg_type;
+		UID uid;
+		Vec3d pos;
+		Vec3f axis; // ObjectTransformUpdate
+		float angle; // ObjectTransformUpdate
+		Vec3f scale; // ObjectTransformUpdate.  Also used for AvatarTransformUpdate rotation.
+		float rot[4]; // ObjectPhysicsTransformUpdate rotation quaternion
+		Vec3f linear_vel; // ObjectPhysicsTransformUpdate
+		Vec3f angular_vel; // ObjectPhysicsTransformUpdate
+		uint32 transform_update_avatar_uid; // ObjectPhysicsTransformUpdate.  anim_state_and_input_bitflags for AvatarTransformUpdate.
+		double transform_client_time; // ObjectPhysicsTransformUpdate
+		double local_time; // Clock::getTimeSinceInit() when the update was received.
+		size_t full_update_ob_index; // ObjectFullUpdate: index of decoded object in full_update_obs
+	};
+
+	std::vector<StagedUpdate> updates;
+	std::vector<WorldObjectRef> full_update_obs; // Objects decoded from ObjectFullUpdate messages.
+};
@@ -0,0 +1,238 @@
+/*=====================================================================
+DiskCacheFile.cpp
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "DiskCacheFile.h"
+
+
+#include "../dll/include/IndigoException.h"
+#include "../dll/IndigoStringUtils.h"
+#include <utils/FileUtils.h>
+#include <utils/MemMappedFile.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <AtomicInt.h>
+#include <xxhash.h>
+
+
+static glare::AtomicInt next_temp_file_id;
+
+
+std::string DiskCacheFile::getPathForKey(const std::string& cache_dir, const std::vector<uint8>& key, const std::string& extension)
+{
+	const uint64 key_hash = XXH64(key.data(), key.size(), /*seed=*/1);
+	return cache_dir + "/" + toHexString(key_hash) + extension;
+}
+
+
+void DiskCacheFile::beginFile(uint32 magic_number, uint32 version, const std::vector<uint8>& key, std::vector<uint8>& file_data_out)
+{
+	file_data_out.clear();
+	appendToBuffer(file_data_out, magic_number);
+	appendToBuffer(file_data_out, version);
+	appendToBuffer(file_data_out, (uint32)key.size());
+	file_data_out.insert(file_data_out.end(), key.begin(), key.end());
+}
+
+
+void DiskCacheFile::writeFile(const std::string& path, std::vector<uint8>& file_data, const std::string& cache_name)
+{
+	const uint64 checksum = XXH64(file_data.data(), file_data.size(), /*seed=*/1);
+	appendToBuffer(file_data, checksum);
+
+	const std::string temp_path = path + "_tmp" + toString(next_temp_file_id.increment());
+	try
+	{
+		FileUtils::writeEntireFile(temp_path, (const char*)file_data.data(), file_data.size());
+		FileUtils::moveFile(temp_path, path);
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		conPrint(cache_name + ": failed to write '" + path + "': " + e.what());
+		try
+		{
+			if(FileUtils::fileExists(temp_path))
+				FileUtils::deleteFile(temp_path);
+		}
+		catch(FileUtils::FileUtilsExcep&)
+		{}
+	}
+}
+
+
+bool DiskCacheFile::tryReadFile(const std::string& path, uint32 magic_number, uint32 version, const std::vector<uint8>& key, const std::string& cache_name,
+	const std::function<void (Reader& reader)>& read_payload)
+{
+	if(!FileUtils::fileExists(path))
+		return false;
+
+	try
+	{
+		MemMappedFile file(path);
+		const uint8* data = (const uint8*)file.fileData();
+		const size_t data_size = file.fileSize();
+
+		// Check checksum first
+		if(data_size < sizeof(uint64))
+			throw glare::Exception("file too short");
+		uint64 checksum;
+		std::memcpy(&checksum, data + data_size - sizeof(uint64), sizeof(uint64));
+		if(XXH64(data, data_size - sizeof(uint64), /*seed=*/1) != checksum)
+			throw glare::Exception("checksum mismatch");
+
+		Reader reader(data, data_size - sizeof(uint64));
+
+		if(reader.readValue<uint32>() != magic_number)
+			throw glare::Exception("invalid magic number");
+		if(reader.readValue<uint32>() != version)
+			throw glare::Exception("invalid version");
+
+		// Check key matches, in case of a hash collision.
+		const uint32 key_size = reader.readValue<uint32>();
+		if(key_size != key.size() || key_size > reader.bytesRemaining() || std::memcmp(reader.currentData(), key.data(), key_size) != 0)
+			throw glare::Exception("key mismatch");
+		reader.skip(key_size);
+
+		read_payload(reader);
+		return true;
+	}
+	catch(glare::Exception& e)
+	{
+		conPrint(cache_name + ": ignoring invalid cache file '" + path + "': " + e.what());
+	}
+	catch(Indigo::IndigoException& e)
+	{
+		conPrint(cache_name + ": ignoring invalid cache file '" + path + "': " + toStdString(e.what()));
+	}
+	return false;
+}
+
+
+void DiskCacheFile::deleteFilesInDir(const std::string& dir)
+{
+	const std::vector<std::string> paths = FileUtils::getFilesInDirFullPaths(dir);
+	for(size_t i=0; i<paths.size(); ++i)
+		FileUtils::deleteFile(paths[i]);
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/PlatformUtils.h>
+
+
+static const uint32 TEST_MAGIC_NUMBER = 0x1234ABCD;
+static const uint32 TEST_VERSION = 3;
+
+
+static void writeTestFile(const std::string& path, uint32 version, const std::vector<uint8>& key, const std::vector<uint8>& payload)
+{
+	std::vector<uint8> file_data;
+	DiskCacheFile::beginFile(TEST_MAGIC_NUMBER, version, key, file_data);
+	DiskCacheFile::appendToBuffer(file_data, (uint32)payload.size());
+	file_data.insert(file_data.end(), payload.begin(), payload.end());
+	DiskCacheFile::writeFile(path, file_data, "DiskCacheFile test");
+}
+
+
+static bool tryReadTestFile(const std::string& path, const std::vector<uint8>& key, std::vector<uint8>& payload_out)
+{
+	return DiskCacheFile::tryReadFile(path, TEST_MAGIC_NUMBER, TEST_VERSION, key, "DiskCacheFile test", [&](DiskCacheFile::Reader& reader)
+		{
+			const uint32 payload_size = reader.readValue<uint32>();
+			if(payload_size != reader.bytesRemaining())
+				throw glare::Exception("invalid payload size");
+			payload_out.resize(payload_size);
+			reader.read(payload_out.data(), payload_size);
+		});
+}
+
+
+void DiskCacheFile::test()
+{
+	conPrint("DiskCacheFile::test()");
+
+	try
+	{
+		const std::string cache_dir = PlatformUtils::getTempDirPath() + "/disk_cache_file_test";
+		FileUtils::createDirIfDoesNotExist(cache_dir);
+		deleteFilesInDir(cache_dir);
+
+		const std::vector<uint8> key = { 1, 2, 3, 4, 5 };
+		std::vector<uint8> payload(1000);
+		for(size_t i=0; i<payload.size(); ++i)
+			payload[i] = (uint8)i;
+
+		const std::string path = getPathForKey(cache_dir, key, ".test");
+		testAssert(path != getPathForKey(cache_dir, std::vector<uint8>({ 1, 2, 3, 4, 6 }), ".test"));
+
+		// Should miss before the file is written
+		std::vector<uint8> loaded_payload;
+		testAssert(!tryReadTestFile(path, key, loaded_payload));
+
+		writeTestFile(path, TEST_VERSION, key, payload);
+		testAssert(tryReadTestFile(path, key, loaded_payload));
+		testAssert(loaded_payload == payload);
+
+		// The temp file should have been moved into place.
+		testAssert(FileUtils::getFilesInDirFullPaths(cache_dir).size() == 1);
+
+		// A different key (e.g. from a hash collision) should miss.
+		testAssert(!tryReadTestFile(path, std::vector<uint8>({ 1, 2, 3, 4 }), loaded_payload));
+		testAssert(!tryReadTestFile(path, std::vector<uint8>({ 1, 2, 3, 4, 6 }), loaded_payload));
+
+		// A different magic number should miss.
+		testAssert(!DiskCacheFile::tryReadFile(path, TEST_MAGIC_NUMBER + 1, TEST_VERSION, key, "DiskCacheFile test", [&](DiskCacheFile::Reader& /*reader*/) {}));
+
+		// An invalid payload should miss.
+		testAssert(!DiskCacheFile::tryReadFile(path, TEST_MAGIC_NUMBER, TEST_VERSION, key, "DiskCacheFile test", [&](DiskCacheFile::Reader& reader) { reader.skip(reader.bytesRemaining() + 1); }));
+
+		std::vector<uint8> contents;
+		FileUtils::readEntireFile(path, contents);
+
+		// Corrupted files should be detected and treated as misses.
+		for(size_t i=0; i<contents.size(); i += 7)
+		{
+			std::vector<uint8> corrupted = contents;
+			corrupted[i] ^= 0x10;
+			FileUtils::writeEntireFile(path, (const char*)corrupted.data(), corrupted.size());
+			testAssert(!tryReadTestFile(path, key, loaded_payload));
+		}
+
+		// Truncated files
+		for(size_t len=0; len<contents.size(); len += 13)
+		{
+			FileUtils::writeEntireFile(path, (const char*)contents.data(), len);
+			testAssert(!tryReadTestFile(path, key, loaded_payload));
+		}
+
+		// A file written with an older version should miss.
+		writeTestFile(path, TEST_VERSION - 1, key, payload);
+		testAssert(!tryReadTestFile(path, key, loaded_payload));
+
+		// Overwriting an existing file should work.
+		payload[0] = 77;
+		writeTestFile(path, TEST_VERSION, key, payload);
+		testAssert(tryReadTestFile(path, key, loaded_payload));
+		testAssert(loaded_payload == payload);
+
+		deleteFilesInDir(cache_dir);
+		testAssert(FileUtils::getFilesInDirFullPaths(cache_dir).empty());
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("DiskCacheFile::test() done.");
+}
+
+
+#endif // BUILD_TESTS
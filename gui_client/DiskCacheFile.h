@@ -0,0 +1,105 @@
+/*=====================================================================
+DiskCacheFile.h
+---------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <utils/Exception.h>
+#include <Platform.h>
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstring>
+
+
+/*=====================================================================
+DiskCacheFile
+-------------
+File format and reading and writing code shared by the on-disk caches
+(PhysicsShapeCache, VoxelMeshCache and TerrainChunkCache).
+
+File layout:
+uint32 magic number
+uint32 cache version
+uint32 key size, followed by key bytes
+payload (defined by each cache)
+uint64 XXH64 checksum of all preceding bytes
+
+Files are named by a hash of the key.  The full key is stored in the file,
+so hash collisions are detected, and the checksum means truncated or
+corrupted files are detected.  Both are treated as cache misses.
+=====================================================================*/
+namespace DiskCacheFile
+{
+	template <class T>
+	inline void appendToBuffer(std::vector<uint8>& buf, const T& x)
+	{
+		const size_t write_i = buf.size();
+		buf.resize(write_i + sizeof(T));
+		std::memcpy(&buf[write_i], &x, sizeof(T));
+	}
+
+
+	// Reads values from a buffer, throwing glare::Exception if we go past the end.
+	class Reader
+	{
+	public:
+		Reader(const uint8* data_, size_t size_) : data(data_), size(size_), offset(0) {}
+
+		void read(void* dest, size_t num_bytes)
+		{
+			if(num_bytes > size - offset)
+				throw glare::Exception("file too short");
+			std::memcpy(dest, data + offset, num_bytes);
+			offset += num_bytes;
+		}
+
+		template <class T>
+		T readValue()
+		{
+			T x;
+			read(&x, sizeof(T));
+			return x;
+		}
+
+		void skip(size_t num_bytes)
+		{
+			if(num_bytes > size - offset)
+				throw glare::Exception("file too short");
+			offset += num_bytes;
+		}
+
+		const uint8* currentData() const { return data + offset; }
+		size_t bytesRemaining() const { return size - offset; }
+
+	private:
+		const uint8* data;
+		size_t size;
+		size_t offset;
+	};
+
+
+	// Returns cache_dir + "/" + hex hash of key + extension.
+	std::string getPathForKey(const std::string& cache_dir, const std::vector<uint8>& key, const std::string& extension);
+
+	// Replaces file_data_out with the file header (magic number, version and key).  The caller then appends the payload, and calls writeFile().
+	void beginFile(uint32 magic_number, uint32 version, const std::vector<uint8>& key, std::vector<uint8>& file_data_out);
+
+	// Appends the checksum to file_data, then writes it to path.
+	// Writes to a temp file then moves it into place, so other threads (or a later session, if we crash part way through writing) never see a partially-written file.
+	// Failures to write are ignored (apart from printing a message prefixed with cache_name), since the caches are just an optimisation.
+	void writeFile(const std::string& path, std::vector<uint8>& file_data, const std::string& cache_name);
+
+	// If path is a valid cache file with the given magic number, version and key, calls read_payload with a reader positioned at the start of the payload, and returns true.
+	// read_payload should throw glare::Exception if the payload is invalid.
+	// Returns false if the file doesn't exist, or if the file or payload is invalid, in which case a message prefixed with cache_name is printed.
+	bool tryReadFile(const std::string& path, uint32 magic_number, uint32 version, const std::vector<uint8>& key, const std::string& cache_name,
+		const std::function<void (Reader& reader)>& read_payload);
+
+	// Deletes all files in dir.  Throws FileUtils::FileUtilsExcep on failure.
+	void deleteFilesInDir(const std::string& dir);
+
+	void test();
+}
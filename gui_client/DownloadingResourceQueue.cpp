@@ -6,6 +6,7 @@ Copyright Glare Technologies Limited 2024 -
 #include "DownloadingResourceQueue.h"
 
 
+#include "LoadItemQueue.h"
 #include <utils/ConPrint.h>
 #include <utils/Timer.h>
 #include <utils/Lock.h>
@@ -14,14 +15,17 @@ Copyright Glare Technologies Limited 2024 -
 
 
 DownloadingResourceQueue::DownloadingResourceQueue()
-:	begin_i(0)
+:	priority_campos(0, 0, 0),
+	priority_campos_valid(false)
 {}
 
 
 DownloadingResourceQueue::~DownloadingResourceQueue()
 {
-	for(size_t i = begin_i; i < items.size(); ++i)
-		delete items[i];
+	Lock lock(mutex);
+
+	for(DownloadQueueItem* item : heap)
+		delete item;
 }
 
 
@@ -33,6 +37,8 @@ void DownloadingResourceQueue::enqueueOrUpdateItem(/*const DownloadQueueItem& it
 	{
 		Lock lock(mutex);
 
+		const Vec4f campos_zero_w(priority_campos.x, priority_campos.y, priority_campos.z, 0.f);
+
 		auto res = item_URL_map.find(URL);
 		if(res == item_URL_map.end()) // If not already inserted:
 		{
@@ -41,9 +47,10 @@ void DownloadingResourceQueue::enqueueOrUpdateItem(/*const DownloadQueueItem& it
 			new_item->pos_info.resize(1);
 			new_item->pos_info[0].pos = Vec3f(pos);
 			new_item->pos_info[0].size_factor = size_factor;
+			new_item->priority = new_item->computePriority(campos_zero_w);
 			
 			item_URL_map[URL] = new_item;
-			items.push_back(new_item);
+			heap.insert(new_item);
 
 			already_inserted = false;
 		}
@@ -55,6 +62,14 @@ void DownloadingResourceQueue::enqueueOrUpdateItem(/*const DownloadQueueItem& it
 			new_pos_info.pos = Vec3f(pos);
 			new_pos_info.size_factor = size_factor;
 			existing_item->pos_info.push_back(new_pos_info);
+
+			// The item priority is the min over positions, so adding a position can only decrease it.
+			const float new_pos_priority = campos_zero_w.getDist(maskWToZero(pos)) * size_factor;
+			if(new_pos_priority < existing_item->priority)
+			{
+				existing_item->priority = new_pos_priority;
+				heap.priorityChanged(existing_item);
+			}
 			
 			already_inserted = true;
 		}
@@ -68,57 +83,41 @@ void DownloadingResourceQueue::enqueueOrUpdateItem(/*const DownloadQueueItem& it
 size_t DownloadingResourceQueue::size() const
 {
 	Lock lock(mutex);
-	return items.size() - begin_i;
+	return heap.size();
 }
 
 
-struct QueueItemDistComparator
+void DownloadingResourceQueue::updatePriorities(const Vec3d& campos_)
 {
-	bool operator () (const DownloadQueueItem* a, const DownloadQueueItem* b)
-	{
-		return a->priority < b->priority;
-	}
-};
-
+	const Vec3f campos((float)campos_.x, (float)campos_.y, (float)campos_.z);
 
-void DownloadingResourceQueue::sortQueue(const Vec3d& campos_) // Sort queue
-{
-	// Sort download list by distance from camera
-	const Vec4f campos_zero_w((float)campos_.x, (float)campos_.y, (float)campos_.z, 0.f);
+	Lock lock(mutex);
 
-	{
-		Lock lock(mutex);
+	// See LoadItemQueue::updatePriorities().
+	if(priority_campos_valid && campos.getDist(priority_campos) < LoadItemQueue::REPRIORITISE_CAM_MOVE_DIST)
+		return;
 
-		Timer timer;
+	priority_campos = campos;
+	priority_campos_valid = true;
 
-		QueueItemDistComparator comparator;
+	Timer timer;
 
-		// Do pass over queue items to compute priority, store and use that for sorting.
-		const size_t items_size = items.size();
-		for(size_t i = begin_i; i < items_size; ++i)
-		{
-			const SmallVector<DownloadQueuePosInfo, 4>& pos_info = items[i]->pos_info;
-			assert(pos_info.size() >= 1);
-			float smallest_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[0].pos.x))) * pos_info[0].size_factor;
-			for(size_t z=1; z<pos_info.size(); ++z)
-			{
-				const float pos_info_z_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[z].pos.x))) * pos_info[z].size_factor;
-				smallest_priority = myMin(smallest_priority, pos_info_z_priority);
-			}
+	const Vec4f campos_zero_w(campos.x, campos.y, campos.z, 0.f);
+	for(DownloadQueueItem* item : heap)
+		item->priority = item->computePriority(campos_zero_w);
 
-			items[i]->priority = smallest_priority;
-		}
+	heap.rebuild();
 
-		std::sort(items.begin() + begin_i, items.end(), comparator);
+	// conPrint("!!!!Updating download queue priorities (" + toString(heap.size()) + " items) took " + timer.elapsedStringNSigFigs(4));
+}
 
-		/*conPrint("Download queue: ");
-		for(int i=(int)begin_i; i<(int)items.size(); ++i)
-		{
-			conPrint("item " + toString(i) + ": " + items[i].URL + ", (" + doubleToStringNSigFigs(items[i].pos.getDist(campos), 3) + " m away)");
-		}*/
 
-		// conPrint("!!!!Sorting download queue (" + toString(items.size() - begin_i) + " items) took " + timer.elapsedStringNSigFigs(4) + " (begin_i: " + toString(begin_i) + ")");
-	}
+void DownloadingResourceQueue::dequeueTopItem(DownloadQueueItem& item_out)
+{
+	DownloadQueueItem* item = heap.popTop();
+	item_out = *item;
+	item_URL_map.erase(item->URL);
+	delete item;
 }
 
 
@@ -128,28 +127,13 @@ void DownloadingResourceQueue::dequeueItemsWithTimeOut(double wait_time_seconds,
 
 	Lock lock(mutex);
 
-	if(begin_i < items.size()) // If there are any items in the queue:
-	{
-		for(size_t i=0; (i<max_num_items) && (begin_i < items.size()); ++i) // while we have removed <= max_num_items and there are still items in the queue:
-		{
-			items_out.push_back(*items[begin_i]);
-			item_URL_map.erase(items[begin_i]->URL);
-			delete items[begin_i];
-			items[begin_i] = NULL;
-			begin_i++;
-		}
-		return;
-	}
-
-	nonempty.waitWithTimeout(mutex, wait_time_seconds); // Suspend thread until there are (maybe) items in the queue
+	if(heap.empty())
+		nonempty.waitWithTimeout(mutex, wait_time_seconds); // Suspend thread until there are (maybe) items in the queue
 
-	for(size_t i=0; (i<max_num_items) && (begin_i < items.size()); ++i) // while we have removed <= max_num_items and there are still items in the queue:
+	while((items_out.size() < max_num_items) && !heap.empty()) // while we have removed < max_num_items and there are still items in the queue:
 	{
-		items_out.push_back(*items[begin_i]);
-		item_URL_map.erase(items[begin_i]->URL);
-		delete items[begin_i];
-		items[begin_i] = NULL;
-		begin_i++;
+		items_out.resize(items_out.size() + 1);
+		dequeueTopItem(items_out.back());
 	}
 }
 
@@ -158,15 +142,72 @@ bool DownloadingResourceQueue::tryDequeueItem(DownloadQueueItem& item_out)
 {
 	Lock lock(mutex);
 
-	if(begin_i < items.size()) // If there are any items in the queue:
+	if(!heap.empty()) // If there are any items in the queue:
 	{
-		item_out = *items[begin_i];
-		item_URL_map.erase(items[begin_i]->URL);
-		delete items[begin_i];
-		items[begin_i] = NULL;
-		begin_i++;
+		dequeueTopItem(item_out);
 		return true;
 	}
 	else
 		return false;
 }
+
+
+float DownloadQueueItem::computePriority(const Vec4f& campos_zero_w) const
+{
+	assert(pos_info.size() >= 1);
+	float smallest_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[0].pos.x))) * pos_info[0].size_factor;
+	for(size_t z=1; z<pos_info.size(); ++z)
+	{
+		const float pos_info_z_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[z].pos.x))) * pos_info[z].size_factor;
+		smallest_priority = myMin(smallest_priority, pos_info_z_priority);
+	}
+	return smallest_priority;
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+
+
+void DownloadingResourceQueue::test()
+{
+	conPrint("DownloadingResourceQueue::test()");
+
+	{
+		DownloadingResourceQueue queue;
+		queue.enqueueOrUpdateItem(URLString("a"), Vec4f(10, 0, 0, 1), /*size_factor=*/1.f);
+		queue.enqueueOrUpdateItem(URLString("b"), Vec4f(20, 0, 0, 1), /*size_factor=*/1.f);
+		queue.enqueueOrUpdateItem(URLString("c"), Vec4f(30, 0, 0, 1), /*size_factor=*/1.f);
+		queue.enqueueOrUpdateItem(URLString("c"), Vec4f(5, 0, 0, 1), /*size_factor=*/1.f); // Update c with a closer position
+		testAssert(queue.size() == 3);
+
+		queue.updatePriorities(Vec3d(0, 0, 0));
+
+		DownloadQueueItem item;
+		testAssert(queue.tryDequeueItem(item));
+		testAssert(item.URL == URLString("c"));
+		testAssert(item.pos_info.size() == 2);
+
+		queue.updatePriorities(Vec3d(25, 0, 0));
+
+		std::vector<DownloadQueueItem> items;
+		queue.dequeueItemsWithTimeOut(/*wait_time_s=*/0.0, /*max_num_items=*/10, items);
+		testAssert(items.size() == 2);
+		testAssert(items[0].URL == URLString("b"));
+		testAssert(items[1].URL == URLString("a"));
+
+		testAssert(!queue.tryDequeueItem(item));
+		testAssert(queue.size() == 0);
+
+		// Re-enqueueing a dequeued URL should add a new item.
+		queue.enqueueOrUpdateItem(URLString("a"), Vec4f(10, 0, 0, 1), /*size_factor=*/1.f);
+		testAssert(queue.size() == 1);
+	}
+
+	conPrint("DownloadingResourceQueue::test() done.");
+}
+
+
+#endif // BUILD_TESTS
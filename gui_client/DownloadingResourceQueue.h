@@ -6,6 +6,7 @@ Copyright Glare Technologies Limited 2024 -
 #pragma once
 
 
+#include "IndexedPriorityHeap.h"
 #include "../shared/URLString.h"
 #include <physics/jscol_aabbox.h>
 #include <utils/Platform.h>
@@ -42,10 +43,13 @@ struct DownloadQueueItem
 		return 1.f / myMax(min_len, aabb_ws_longest_len);
 	}
 
+	float computePriority(const Vec4f& campos_zero_w) const; // Smallest distance * size_factor over pos_info.
+
 	SmallVector<DownloadQueuePosInfo, 4> pos_info; // Store multiple positions and size factors, since multiple different objects may be using the same resource.
 	URLString URL;
 
-	float priority;
+	float priority; // Smaller values are downloaded first.
+	size_t heap_index; // Index in DownloadingResourceQueue heap.
 };
 
 
@@ -53,7 +57,10 @@ struct DownloadQueueItem
 DownloadingResourceQueue
 ------------------------
 Queue of resource URLs to download, together with the position of the object using the resource,
-which is used for sorting the items based on distance from the camera.
+which is used for prioritising the items based on distance from the camera.
+
+Like LoadItemQueue, items are kept in an indexed binary heap ordered by priority, and all priorities are
+only recomputed when the camera has moved more than LoadItemQueue::REPRIORITISE_CAM_MOVE_DIST.
 
 DownloadResourcesThreads will dequeue items from this queue.
 =====================================================================*/
@@ -67,16 +74,20 @@ public:
 
 	size_t size() const;
 
-	void sortQueue(const Vec3d& campos); // Sort queue (approximately by item distance to camera)
+	void updatePriorities(const Vec3d& campos); // Recompute item priorities if the camera has moved far enough since they were last computed.
 
 	void dequeueItemsWithTimeOut(double wait_time_s, size_t max_num_items, std::vector<DownloadQueueItem>& items_out); // Blocks for up to wait_time_s
 
 	bool tryDequeueItem(DownloadQueueItem& item_out);
+
+	static void test();
 private:
+	void dequeueTopItem(DownloadQueueItem& item_out) REQUIRES(mutex);
 
 	mutable Mutex mutex;
 	Condition nonempty;
-	size_t begin_i										GUARDED_BY(mutex);
-	js::Vector<DownloadQueueItem*, 16> items			GUARDED_BY(mutex);
-	std::unordered_map<URLString, DownloadQueueItem*, URLStringHasher> item_URL_map	GUARDED_BY(mutex); // Map from item URL to pointer to DownloadQueueItem in items.
+	IndexedPriorityHeap<DownloadQueueItem> heap			GUARDED_BY(mutex);
+	std::unordered_map<URLString, DownloadQueueItem*, URLStringHasher> item_URL_map	GUARDED_BY(mutex); // Map from item URL to pointer to DownloadQueueItem in heap.
+	Vec3f priority_campos								GUARDED_BY(mutex); // Camera position that item priorities were computed with.
+	bool priority_campos_valid							GUARDED_BY(mutex);
 };
@@ -25,6 +25,9 @@ Copyright Glare Technologies Limited 2024 -
 #include "URLWhitelist.h"
 #include "URLParser.h"
 #include "LoadModelTask.h"
+#include "PhysicsShapeCache.h"
+#include "VoxelMeshCache.h"
+#include "TerrainChunkCache.h"
 #include "BuildScatteringInfoTask.h"
 #include "LoadTextureTask.h"
 #include "LoadAudioTask.h"
@@ -139,6 +142,7 @@ static const float DECAL_EDGE_AABB_WIDTH = 0.02f;
 static const bool LOD_CHUNK_SUPPORT = true;
 static const float chunk_w = 128.f;
 static const float recip_chunk_w = 1.f / chunk_w;
+static const float LOD_CHUNK_DIST_THRESHOLD = 150.f; // LOD chunks further than this from the camera (in the XY plane) are displayed.
 
 static const URLString DEFAULT_AVATAR_MODEL_URL = "xbot.bmesh"; // This file should be in the resources directory in the distribution.
 
@@ -184,7 +188,6 @@ GUIClient::GUIClient(const std::string& base_dir_path_, const std::string& appda
 	biome_manager(NULL),
 	scratch_packet(SocketBufferOutStream::DontUseNetworkByteOrder),
 	frame_num(0),
-	next_lod_changes_begin_i(0),
 	last_vehicle_renewal_msg_time(-1),
 	stack_allocator(/*size (B)=*/22 * 1024 * 1024), // Used for the Jolt physics temp allocator also.
 	arena_allocator(/*size (B)=*/4 * 1024 * 1024), // Used for WorldObject::appendDependencyURLs() etc.
@@ -197,6 +200,7 @@ GUIClient::GUIClient(const std::string& base_dir_path_, const std::string& appda
 	server_has_basisu_terrain_detail_maps(false),
 	server_has_optimised_meshes(false),
 	server_opt_mesh_version(-1),
+	server_has_physics_shapes(false),
 	last_cursor_movement_was_from_mouse(true),
 	sent_perform_gesture_without_stop_gesture(false),
 	use_lightmaps(true),
@@ -397,7 +401,15 @@ void GUIClient::postConnectInitialise()
 #if !defined(EMSCRIPTEN)
 	// With Emscripten we use an ephemeral virtual file system, so no point in saving resource manager state to it.
 	save_resources_db_thread_manager.addThread(new SaveResourcesDBThread(resource_manager, resources_db_path));
+
+	// Cooked physics shapes and voxel meshes are stored next to the resources, and are also not worth caching with Emscripten.
+	physics_shape_cache = new PhysicsShapeCache(cache_dir + "/physics_shapes");
+	voxel_mesh_cache = new VoxelMeshCache(cache_dir + "/voxel_meshes");
+	const std::string terrain_chunk_cache_dir = cache_dir + "/terrain_chunks";
+#else
+	const std::string terrain_chunk_cache_dir; // Just use the in-memory terrain chunk cache with Emscripten.
 #endif
+	terrain_chunk_cache = new TerrainChunkCache(terrain_chunk_cache_dir, /*max_mem_bytes=*/64 * 1024 * 1024, /*max_disk_bytes=*/1024 * 1024 * 1024);
 
 
 	garbage_deleter_thread_manager.addThread(new GarbageDeleterThread());
@@ -529,7 +541,7 @@ void GUIClient::afterGLInitInitialise(double device_pixel_ratio, Reference<OpenG
 	// For emscripten, wait until we connect to server.
 	terrain_decal_manager = new TerrainDecalManager(this->base_dir_path, /*async_tex_loader=*/async_texture_loader.ptr(), opengl_engine.ptr());
 
-	particle_manager = new ParticleManager(this->base_dir_path, /*async_tex_loader=*/async_texture_loader.ptr(), opengl_engine.ptr(), physics_world.ptr(), terrain_decal_manager.ptr());
+	particle_manager = new ParticleManager(this->base_dir_path, /*async_tex_loader=*/async_texture_loader.ptr(), opengl_engine.ptr(), physics_world.ptr(), terrain_decal_manager.ptr(), high_priority_task_manager);
 #endif
 
 
@@ -1071,6 +1083,9 @@ void GUIClient::shutdown()
 	
 	client_thread_manager.killThreadsBlocking();
 	client_udp_handler_thread_manager.killThreadsBlocking();
+	if(voice_receiver.nonNull())
+		voice_receiver->removeMixedStreams();
+	voice_receiver = NULL;
 	mic_read_thread_manager.killThreadsBlocking();
 	resource_upload_thread_manager.killThreadsBlocking();
 	resource_download_thread_manager.killThreadsBlocking();
@@ -1619,6 +1634,7 @@ bool GUIClient::isResourceCurrentlyNeededForObject(const URLString& url, const W
 	options.include_lightmaps = this->use_lightmaps;
 	options.get_optimised_mesh = this->server_has_optimised_meshes;
 	options.opt_mesh_version = this->server_opt_mesh_version;
+	options.get_physics_shape = this->server_has_physics_shapes;
 	options.allocator = &arena_allocator;
 
 	DependencyURLSet dependency_URLs(std::less<DependencyURL>(), stl_arena_allocator);
@@ -1728,6 +1744,7 @@ void GUIClient::startDownloadingResourcesForObject(WorldObject* ob, int ob_lod_l
 	options.include_lightmaps = this->use_lightmaps;
 	options.get_optimised_mesh = this->server_has_optimised_meshes;
 	options.opt_mesh_version = this->server_opt_mesh_version;
+	options.get_physics_shape = this->server_has_physics_shapes;
 	options.allocator = &arena_allocator;
 
 	DependencyURLSet dependency_URLs(std::less<DependencyURL>(), stl_arena_allocator);
@@ -2731,6 +2748,7 @@ void GUIClient::loadModelForObject(WorldObject* ob, WorldStateLock& world_state_
 							load_model_task->compressed_voxels = ob->getCompressedVoxels();
 							load_model_task->ob_to_world_matrix = obToWorldMatrix(*ob);
 							load_model_task->voxel_hash = hash;
+							load_model_task->voxel_mesh_cache = voxel_mesh_cache;
 							load_model_task->mat_transparent = mat_transparent;
 							load_model_task->need_lightmap_uvs = !ob->lightmap_url.empty();
 							load_model_task->build_dynamic_physics_ob = ob->isDynamic();
@@ -2832,6 +2850,9 @@ void GUIClient::loadModelForObject(WorldObject* ob, WorldStateLock& world_state_
 							load_model_task->opengl_engine = this->opengl_engine;
 							load_model_task->result_msg_queue = &this->msg_queue;
 							load_model_task->resource_manager = resource_manager;
+							load_model_task->physics_shape_cache = physics_shape_cache;
+							if(this->server_has_physics_shapes)
+								load_model_task->physics_shape_url = WorldObject::getPhysicsShapeURLForModelURL(lod_model_url, ob->isDynamic());
 							load_model_task->build_dynamic_physics_ob = ob->isDynamic();
 							load_model_task->worker_allocator = worker_allocator;
 							load_model_task->upload_thread = opengl_upload_thread;
@@ -3070,6 +3091,8 @@ void GUIClient::loadPresentObjectGraphicsAndPhysicsModels(WorldObject* ob, const
 	opengl_engine->addObject(ob->opengl_engine_ob);
 	//if(timer.elapsed() > 0.01) conPrint("addObject took                    " + timer.elapsedStringNSigFigs(5));
 
+	scripted_ob_proximity_checker.objectTransformChanged(ob); // The object's AABB is now taken from the new OpenGL object, so re-bin it.
+
 
 	// Add any objects with mp4 textures to the set of animated objects. (if not already)
 	for(size_t i=0; i<ob->materials.size(); ++i)
@@ -4276,6 +4299,8 @@ void GUIClient::doMoveAndRotateObject(WorldObjectRef ob, const Vec3d& new_ob_pos
 
 	ob->transformChanged();
 
+	scripted_ob_proximity_checker.objectTransformChanged(ob.ptr());
+
 	ob->last_modified_time = TimeStamp::currentTime(); // Gets set on server as well, this is just for updating the local display.
 
 	// Set graphics object pos and update in opengl engine.
@@ -4365,11 +4390,9 @@ static inline bool shouldDisplayLODChunk(const Vec3i& chunk_coords, const Vec4f&
 {
 	const Vec4f chunk_centre = Vec4f((chunk_coords.x + 0.5f) * chunk_w, (chunk_coords.y + 0.5f) * chunk_w, 0, 1);
 	
-	const float CHUNK_DIST_THRESHOLD = 150.f;
-	
 	const float dist_to_chunk2 = xyDist2(campos, chunk_centre);
 
-	return dist_to_chunk2 > Maths::square(CHUNK_DIST_THRESHOLD);
+	return dist_to_chunk2 > Maths::square(LOD_CHUNK_DIST_THRESHOLD);
 }
 
 
@@ -4387,69 +4410,39 @@ void GUIClient::checkForLODChanges(Timer& timer_event_timer)
 		// Make sure server_using_lod_chunks is up-to-date.
 		if(!this->world_state->lod_chunks.empty() && LOD_CHUNK_SUPPORT)
 			this->server_using_lod_chunks = true;
-		const bool use_server_using_lod_chunks = this->server_using_lod_chunks;
 
+		ObjectLODEvaluationParams params;
+		params.cam_pos = cam_controller.getPosition().toVec4fPoint();
+		params.proj_len_viewable_threshold = only_load_most_important_obs ? 0.02f : 0.f; // Objects with a projected length >= this value will be loaded
+		params.load_everything_distance2   = only_load_most_important_obs ? Maths::square(60.f) : this->load_distance2; // Load everything <= this distance.
+		params.use_lod_chunks              = this->server_using_lod_chunks;
+		params.lod_chunk_w                 = chunk_w;
+		params.lod_chunk_display_dist      = LOD_CHUNK_DIST_THRESHOLD;
 
-		const Vec4f cam_pos = cam_controller.getPosition().toVec4fPoint();
-		const float proj_len_viewable_threshold = only_load_most_important_obs ? 0.02f : 0.f; // Objects with a projected length >= this value will be loaded
-		const float load_everything_distance2   = only_load_most_important_obs ? Maths::square(60.f) : this->load_distance2; // Load everything <= this distance.
-
-		glare::FastIterMapValueInfo<UID, WorldObjectRef>* const objects_data = this->world_state->objects.vector.data();
-		const size_t objects_size                                            = this->world_state->objects.vector.size();
-
-		// Process just some of the objects each frame, to reduce CPU time and ease pressure on the cache.
-		const size_t num_slices = 4;
-		const size_t max_num = Maths::roundedUpDivide(objects_size, num_slices);
-		const size_t begin_i = myMin(objects_size, this->next_lod_changes_begin_i);
-		const size_t end_i   = myMin(objects_size, begin_i + max_num);
+		// Evaluate all objects (in parallel), getting back just the objects whose proximity or LOD level changed.
+		lod_evaluator.evaluateObjects(this->world_state->objects.vector.data(), this->world_state->objects.vector.size(), params, high_priority_task_manager, /*changes out=*/lod_changes);
 
-		//conPrint("checking slice from " + toString(begin_i) + " to " + toString(end_i));
 		size_t num_object_changes = 0;
-		size_t i;
-		for(i = begin_i; i<end_i; ++i)
+		for(size_t i=0; i<lod_changes.size(); ++i)
 		{
-			if(i + 16 < end_i)
-				_mm_prefetch((const char*)(&objects_data[i + 16].value->centroid_ws), _MM_HINT_T0);
-
-			WorldObject* const ob = objects_data[i].value.ptr();
-
-			const Vec4f centroid = ob->getCentroidWS();
+			WorldObject* const ob = lod_changes[i].ob;
 
-			const float cam_to_ob_d2 = ob->getCentroidWS().getDist2(cam_pos);
-			//const float cam_to_ob_d2 = ob->getAABBWS().getClosestPointInAABB(cam_pos).getDist2(cam_pos); // More robust but slower. use?
-
-			const float recip_dist = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(cam_to_ob_d2)));
-			//assert(epsEqual(recip_dist, 1 / sqrt(cam_to_ob_d2)));
-			const float proj_len = ob->getBiasedAABBLength() * recip_dist;
-
-			bool in_proximity = (proj_len > proj_len_viewable_threshold) || (cam_to_ob_d2 <= load_everything_distance2);
-
-			// If this object is in a chunk region, and we are displaying the chunk, then don't show the object.
-			const Vec3i chunk_coords(Maths::floorToInt(centroid[0] / chunk_w), Maths::floorToInt(centroid[1] / chunk_w), 0);
-			if(use_server_using_lod_chunks && shouldDisplayLODChunk(chunk_coords, cam_pos) && !ob->exclude_from_lod_chunk_mesh)
-				in_proximity = false;
-
-			assert(ob->exclude_from_lod_chunk_mesh == BitUtils::isBitSet(ob->flags, WorldObject::EXCLUDE_FROM_LOD_CHUNK_MESH));
-
-			bool object_changed = false;
-			if(!in_proximity) // If object is out of load distance:
+			if(!lod_changes[i].in_proximity) // If object is out of load distance:
 			{
 				if(ob->in_proximity) // If an object was in proximity to the camera, and moved out of load distance:
 				{
 					unloadObject(ob);
 					ob->in_proximity = false;
-					object_changed = true;
 				}
 			}
 			else // Else if object is within load distance:
 			{
-				const int lod_level = ob->getLODLevel(cam_to_ob_d2);
+				const int lod_level = lod_changes[i].lod_level;
 
 				if((lod_level != ob->current_lod_level)/* || ob->opengl_engine_ob.isNull()*/)
 				{
 					loadModelForObject(ob, lock);
 					ob->current_lod_level = lod_level;
-					object_changed = true;
 					// conPrint("Changing LOD level for object " + ob->uid.toString() + " to " + toString(lod_level));
 				}
 
@@ -4458,28 +4451,20 @@ void GUIClient::checkForLODChanges(Timer& timer_event_timer)
 					ob->in_proximity = true;
 					loadModelForObject(ob, lock);
 					ob->current_lod_level = lod_level;
-					object_changed = true;
 				}
 			}
 
-			if(object_changed)
+			// Changes we don't get to this frame will be found again by the evaluator next frame.
+			num_object_changes++;
+			const double elapsed = timer_event_timer.elapsed();
+			if(elapsed > 0.0035f)
 			{
-				num_object_changes++;
-				const double elapsed = /*timer*/timer_event_timer.elapsed();
-				if(elapsed > 0.0035f)
-				{
-					//conPrint("checkForLODChanges(): breaking after " + toString(num_object_changes) + " changes, timer_event_timer: " + doubleToStringNDecimalPlaces(elapsed * 1.0e3, 2) + " ms");
-					break;
-				}
+				//conPrint("checkForLODChanges(): breaking after " + toString(num_object_changes) + " changes, timer_event_timer: " + doubleToStringNDecimalPlaces(elapsed * 1.0e3, 2) + " ms");
+				break;
 			}
 		}
 
-		this->next_lod_changes_begin_i = i;
-		if(this->next_lod_changes_begin_i >= objects_size)
-			this->next_lod_changes_begin_i = 0;
-
-		//conPrint("checkForLODChanges took " + timer.elapsedStringMSWIthNSigFigs(4) + ", " + toString(num_object_changes) + " changes, " + toString(world_state->objects.size()) + " obs, begin: " + toString(begin_i) + 
-		//	", end i: " + toString(i));
+		//conPrint("checkForLODChanges took " + timer.elapsedStringMSWIthNSigFigs(4) + ", " + toString(num_object_changes) + " / " + toString(lod_changes.size()) + " changes, " + toString(world_state->objects.size()) + " obs");
 
 	} // End lock scope
 }
@@ -5961,16 +5946,20 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 			if(script_evaluator)
 			{
 				// Check timer is still valid (has not been destroyed by destroyTimer), by checking the timer id with the same index is still equal to our timer id.
-				assert(timer.timer_index >= 0 && timer.timer_index <= LuaScriptEvaluator::MAX_NUM_TIMERS);
+				assert(timer.timer_index >= 0 && timer.timer_index < (int)script_evaluator->timers.size());
 				if(timer.timer_id == script_evaluator->timers[timer.timer_index].id)
 				{
 					script_evaluator->doOnTimerEvent(timer.onTimerEvent_ref, lock); // Execute the Lua timer event callback function
 
+					// The callback may have destroyed the timer (and possibly created a new timer in the same slot), so check the timer id again.
+					if(timer.timer_id != script_evaluator->timers[timer.timer_index].id)
+						continue;
+
 					if(timer.repeating)
 					{
 						// Re-insert timer with updated trigger time
 						timer.tigger_time = cur_time + timer.period;
-						script_timer_queue.addTimer(cur_time, timer);
+						script_evaluator->timers[timer.timer_index].queue_handle = script_timer_queue.addTimer(cur_time, timer);
 					}
 					else // Else if timer was a one-shot timer, 'destroy' it.
 					{
@@ -6024,8 +6013,7 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 	{
 		Lock lock(particles_creation_buf_mutex);
 		
-		for(size_t i=0; i<this->particles_creation_buf.size(); ++i)
-			this->particle_manager->addParticle(this->particles_creation_buf[i]);
+		this->particle_manager->addParticles(this->particles_creation_buf.data(), this->particles_creation_buf.size());
 		
 		this->particles_creation_buf.clear();
 	}
@@ -6142,18 +6130,18 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 	}
 
 
-	// Sort load_item_queue every now and then
+	// Update load_item_queue priorities every now and then.  This only does work if the camera has moved far enough.
 	if(load_item_queue_sort_timer.elapsed() > 0.1)
 	{
-		this->load_item_queue.sortQueue(cam_controller.getPosition());
+		this->load_item_queue.updatePriorities(cam_controller.getPosition());
 		load_item_queue_sort_timer.reset();
 	}
 
 
-	// Sort download queue every now and then
-	if(download_queue_sort_timer.elapsed() > 2.0)
+	// Update download queue priorities every now and then
+	if(download_queue_sort_timer.elapsed() > 0.5)
 	{
-		this->download_queue.sortQueue(cam_controller.getPosition());
+		this->download_queue.updatePriorities(cam_controller.getPosition());
 		download_queue_sort_timer.reset();
 	}
 
@@ -6339,6 +6327,13 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 		object_scripts_evaluator->evaluateObjectScripts(this->obs_with_scripts, global_time, dt, world_state.ptr(), opengl_engine.ptr(), this->physics_world.ptr(), &this->audio_engine,
 			this->high_priority_task_manager, /*num_scripts_processed_out=*/this->last_num_scripts_processed
 		);
+
+		// Winter scripts may have moved objects, so re-bin them in scripted_ob_proximity_checker.  This is just a hash table lookup for objects not in the checker.
+		const size_t obs_with_scripts_size          = obs_with_scripts.size();
+		WorldObjectRef* const obs_with_scripts_data = obs_with_scripts.vector.data();
+		for(size_t i=0; i<obs_with_scripts_size; ++i)
+			scripted_ob_proximity_checker.objectTransformChanged(obs_with_scripts_data[i].ptr());
+
 		this->last_eval_script_time = timer.elapsed();
 	}
 
@@ -6403,6 +6398,7 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 					{
 						ObjectMoveToController* controller = it->ptr();
 						const bool still_active = controller->update(*physics_world, opengl_engine.ptr(), (float)substep_dt);
+						scripted_ob_proximity_checker.objectTransformChanged(controller->controlled_ob.ptr());
 						if(!still_active)
 							temp_move_to_controllers.push_back(controller);
 						// Leave the ObjectMoveToController alive and referenced from ob->move_to_controller, it can be reused for subsequent move messages.
@@ -6659,6 +6655,8 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 								//}
 							}
 
+							scripted_ob_proximity_checker.objectTransformChanged(ob);
+
 							// Update audio source for the object, if it has one.
 							if(ob->audio_source)
 							{
@@ -6976,7 +6974,9 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 		PERFORMANCEAPI_INSTRUMENT("audio occlusions");
 		ZoneScopedN("audio occlusions"); // Tracy profiler
 
-		Lock lock(audio_engine.mutex);
+		audio_engine.updateFinishedSources();
+
+		// audio_sources is only accessed by the main thread, so we don't need to lock the audio engine mutex here.  Updates are sent to the mixer via the audio engine command queue.
 		for(auto it = audio_engine.audio_sources.begin(); it != audio_engine.audio_sources.end(); ++it)
 		{
 			glare::AudioSource* source = it->ptr();
@@ -7072,6 +7072,12 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 	const Quatf q = z_axis_rot_q * x_axis_rot_q;
 	audio_engine.setHeadTransform(this->cam_controller.getPosition().toVec4fPoint(), q);
 
+	if(voice_receiver.nonNull())
+	{
+		voice_receiver->setListenerPos(this->cam_controller.getPosition().toVec4fPoint()); // Used for prioritising voice decoding.
+		voice_receiver->updateMixedStreams(cur_time);
+	}
+
 
 	// Send a AvatarEnteredVehicle to server with renewal bit set, occasionally.
 	// This is so any new player joining the world after we entered the vehicle can receive the information that we are inside it.
@@ -7210,6 +7216,8 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 						else if(ob->state == WorldObject::State_InitialSend)
 							ob->was_just_created = false;
 
+						scripted_ob_proximity_checker.objectTransformChanged(ob); // Full updates may have changed the object transform.
+
 						// Decompress voxel group
 						//ob->decompressVoxels();
 
@@ -7380,6 +7388,8 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 				{
 					active_objects.insert(ob); // Add to active_objects: objects that have moved recently and so need interpolation done on them.
 
+					scripted_ob_proximity_checker.objectTransformChanged(ob);
+
 					ob->from_remote_transform_dirty = false;
 				}
 
@@ -7413,6 +7423,8 @@ void GUIClient::timerEvent(const MouseCursorState& mouse_cursor_state)
 
 					updateSplatObjectTransform(*ob);
 
+					scripted_ob_proximity_checker.objectTransformChanged(ob);
+
 					ob->from_remote_summoned_dirty = false;
 				}
 			}
@@ -8248,6 +8260,8 @@ void GUIClient::updateAvatarGraphics(double cur_time, double dt, const Vec3d& ou
 		{
 			WorldStateLock lock(this->world_state->mutex);
 
+			avatar_pose_jobs.clear();
+
 			for(auto it = this->world_state->avatars.begin(); it != this->world_state->avatars.end();)
 			{
 				Avatar* avatar = it->second.getPointer();
@@ -8571,282 +8585,304 @@ void GUIClient::updateAvatarGraphics(double cur_time, double dt, const Vec3d& ou
 								}
 							}
 						}
-						 
-						AnimEvents anim_events;
-						avatar->graphics.setOverallTransform(*opengl_engine, *physics_world, *particle_manager, pos, rotation, use_xyplane_speed_rel_ground_override, xyplane_speed_rel_ground_override,
-							avatar->avatar_settings.pre_ob_to_world_matrix, avatar->anim_state, cur_time, dt, pose_constraint, anim_events);
 						
-						if(!BitUtils::isBitSet(avatar->anim_state, AvatarGraphics::ANIM_STATE_IN_AIR) && anim_events.footstrike && !pose_constraint.sitting) // If avatar is on ground, and the anim played a footstrike
-						{
-							//const int rnd_src_i = rng.nextUInt((uint32)footstep_sources.size());
-							//footstep_sources[rnd_src_i]->cur_read_i = 0;
-							//audio_engine.setSourcePosition(footstep_sources[rnd_src_i], anim_events.footstrike_pos.toVec4fPoint());
-							const int rnd_src_i = rng.nextUInt(4);
-							audio_engine.playOneShotSound(resources_dir_path + "/sounds/footstep_mono" + toString(rnd_src_i) + ".wav", anim_events.footstrike_pos.toVec4fPoint());
-						}
-
-						for(int i=0; i<anim_events.num_blobs; ++i)
-							temp_av_positions.push_back(anim_events.blob_sphere_positions[i]);
+						// Add a job to update the pose.  The poses of all avatars are updated in parallel after this loop.
+						avatar_pose_jobs.push_back(AvatarPoseUpdateJob());
+						AvatarPoseUpdateJob& job = avatar_pose_jobs.back();
+						job.avatar = avatar;
+						job.pos = pos;
+						job.rotation = rotation;
+						job.use_xyplane_speed_rel_ground_override = use_xyplane_speed_rel_ground_override;
+						job.xyplane_speed_rel_ground_override = xyplane_speed_rel_ground_override;
+						job.pose_constraint = pose_constraint;
+
+						const float cam_to_avatar_d2 = (float)pos.getDist2(cam_controller.getPosition());
+						AvatarPoseUpdater::scheduleUpdate(avatar->graphics, /*always_update=*/our_avatar, cam_to_avatar_d2, frame_num, /*stagger_key=*/avatar->uid.value(), dt, job);
 					}
 
-					
-					// If the avatar is in a vehicle, use the vehicle transform, which can be somewhat different from the avatar location due to different interpolation methods.
-					// Use the last head position (animated) for the nametag position.  Matches better for animations with root motion and shorter avatars etc.
-					Vec4f use_nametag_pos = avatar->graphics.getLastHeadPosition(); // Also used for red dot in HeadUpDisplay
-					if(avatar->entered_vehicle)
+
+					avatar->other_dirty = false;
+					avatar->transform_dirty = false;
+
+					assert(avatar->state == Avatar::State_JustCreated || avatar->state == Avatar::State_Alive);
+					if(avatar->state == Avatar::State_JustCreated)
 					{
-						const auto controller_res = vehicle_controllers.find(avatar->entered_vehicle.ptr()); // Find a vehicle controller for the avatar 'entered_vehicle' object.
-						if(controller_res != vehicle_controllers.end())
-						{
-							VehiclePhysics* controller = controller_res->second.ptr();
-							const Matrix4f seat_to_world = controller->getSeatToWorldTransformNoScale(*this->physics_world, avatar->vehicle_seat_index, /*use_smoothed_network_transform=*/true);
+						avatar->state = Avatar::State_Alive;
 
-							use_nametag_pos = seat_to_world * Vec4f(0,0,1.0f,1);
-						}
+						world_state->avatars_changed = 1;
 					}
 
-					// Update nametag transform also
-					if(avatar->nametag_gl_ob.nonNull())
+					++it;
+				} // End if avatar state != dead.
+			} // end for each avatar
+
+			// Update the poses of all avatars, in parallel.
+			avatar_pose_updater.updatePoses(avatar_pose_jobs, cur_time, high_priority_task_manager);
+
+			// Pass the new poses to the OpenGL engine and physics world, and do other per-avatar updates that depend on the pose.
+			for(size_t z=0; z<avatar_pose_jobs.size(); ++z)
+			{
+				AvatarPoseUpdateJob& job = avatar_pose_jobs[z];
+				Avatar* avatar = job.avatar;
+				const bool our_avatar = avatar->isOurAvatar();
+				const Vec3d& pos = job.pos;
+
+				if(!job.update_pose)
+					avatar->graphics.translateLastPose(pos);
+				avatar->graphics.applyPose(*opengl_engine, *physics_world, pos);
+
+				if(!BitUtils::isBitSet(avatar->anim_state, AvatarGraphics::ANIM_STATE_IN_AIR) && job.anim_events.footstrike && !job.pose_constraint.sitting) // If avatar is on ground, and the anim played a footstrike
+				{
+					//const int rnd_src_i = rng.nextUInt((uint32)footstep_sources.size());
+					//footstep_sources[rnd_src_i]->cur_read_i = 0;
+					//audio_engine.setSourcePosition(footstep_sources[rnd_src_i], job.anim_events.footstrike_pos.toVec4fPoint());
+					const int rnd_src_i = rng.nextUInt(4);
+					audio_engine.playOneShotSound(resources_dir_path + "/sounds/footstep_mono" + toString(rnd_src_i) + ".wav", job.anim_events.footstrike_pos.toVec4fPoint());
+				}
+
+				for(int i=0; i<job.anim_events.num_blobs; ++i)
+					temp_av_positions.push_back(job.anim_events.blob_sphere_positions[i]);
+
+				// If the avatar is in a vehicle, use the vehicle transform, which can be somewhat different from the avatar location due to different interpolation methods.
+				// Use the last head position (animated) for the nametag position.  Matches better for animations with root motion and shorter avatars etc.
+				Vec4f use_nametag_pos = avatar->graphics.getLastHeadPosition(); // Also used for red dot in HeadUpDisplay
+				if(avatar->entered_vehicle)
+				{
+					const auto controller_res = vehicle_controllers.find(avatar->entered_vehicle.ptr()); // Find a vehicle controller for the avatar 'entered_vehicle' object.
+					if(controller_res != vehicle_controllers.end())
 					{
-						// We want to rotate the nametag towards the camera.
-						Vec4f to_cam = normalise(use_nametag_pos - this->cam_controller.getPosition().toVec4fPoint());
-						if(!isFinite(to_cam[0]))
-							to_cam = Vec4f(1, 0, 0, 0); // Handle case where to_cam was zero.
+						VehiclePhysics* controller = controller_res->second.ptr();
+						const Matrix4f seat_to_world = controller->getSeatToWorldTransformNoScale(*this->physics_world, avatar->vehicle_seat_index, /*use_smoothed_network_transform=*/true);
 
-						const Vec4f axis_k = Vec4f(0, 0, 1, 0);
-						if(std::fabs(dot(to_cam, axis_k)) > 0.999f) // Make vectors linearly independent.
-							to_cam[0] += 0.1;
+						use_nametag_pos = seat_to_world * Vec4f(0,0,1.0f,1);
+					}
+				}
 
-						const Vec4f axis_j = normalise(removeComponentInDir(to_cam, axis_k));
-						const Vec4f axis_i = crossProduct(axis_j, axis_k);
-						const Matrix4f rot_matrix(axis_i, axis_j, axis_k, Vec4f(0, 0, 0, 1));
+				// Update nametag transform also
+				if(avatar->nametag_gl_ob.nonNull())
+				{
+					// We want to rotate the nametag towards the camera.
+					Vec4f to_cam = normalise(use_nametag_pos - this->cam_controller.getPosition().toVec4fPoint());
+					if(!isFinite(to_cam[0]))
+						to_cam = Vec4f(1, 0, 0, 0); // Handle case where to_cam was zero.
 
-						const float ws_height = 0.2f; // world space height of nametag in metres
-						const float ws_width = ws_height * avatar->nametag_gl_ob->mesh_data->aabb_os.axisLength(0) / avatar->nametag_gl_ob->mesh_data->aabb_os.axisLength(2);
+					const Vec4f axis_k = Vec4f(0, 0, 1, 0);
+					if(std::fabs(dot(to_cam, axis_k)) > 0.999f) // Make vectors linearly independent.
+						to_cam[0] += 0.1;
 
-						const float total_w = ws_width + (avatar->speaker_gl_ob.nonNull() ? (0.05f + ws_height) : 0.f); // Width of nametag and speaker icon (and spacing between them).
+					const Vec4f axis_j = normalise(removeComponentInDir(to_cam, axis_k));
+					const Vec4f axis_i = crossProduct(axis_j, axis_k);
+					const Matrix4f rot_matrix(axis_i, axis_j, axis_k, Vec4f(0, 0, 0, 1));
 
-						// If avatar is flying (e.g playing floating anim) move nametag up so it isn't blocked by the avatar head, which is higher in floating anim.
-						const float flying_z_offset = ((avatar->anim_state & AvatarGraphics::ANIM_STATE_IN_AIR) != 0) ? 0.3f : 0.f;
+					const float ws_height = 0.2f; // world space height of nametag in metres
+					const float ws_width = ws_height * avatar->nametag_gl_ob->mesh_data->aabb_os.axisLength(0) / avatar->nametag_gl_ob->mesh_data->aabb_os.axisLength(2);
 
-						// Blend in new z offset, don't immediately jump to it.
-						const float blend_speed = 0.1f;
-						avatar->nametag_z_offset = avatar->nametag_z_offset * (1 - blend_speed) + flying_z_offset * blend_speed;
+					const float total_w = ws_width + (avatar->speaker_gl_ob.nonNull() ? (0.05f + ws_height) : 0.f); // Width of nametag and speaker icon (and spacing between them).
 
-						// Rotate around z-axis, then translate to just above the avatar's head.
-						avatar->nametag_gl_ob->ob_to_world_matrix = Matrix4f::translationMatrix(use_nametag_pos + Vec4f(0, 0, 0.45f + avatar->nametag_z_offset, 0)) *
-							rot_matrix * Matrix4f::translationMatrix(-total_w/2, 0.f, 0.f) * Matrix4f::uniformScaleMatrix(ws_width);
+					// If avatar is flying (e.g playing floating anim) move nametag up so it isn't blocked by the avatar head, which is higher in floating anim.
+					const float flying_z_offset = ((avatar->anim_state & AvatarGraphics::ANIM_STATE_IN_AIR) != 0) ? 0.3f : 0.f;
 
-						assert(isFinite(avatar->nametag_gl_ob->ob_to_world_matrix.e[0]));
-						opengl_engine->updateObjectTransformData(*avatar->nametag_gl_ob); // Update transform in 3d engine
+					// Blend in new z offset, don't immediately jump to it.
+					const float blend_speed = 0.1f;
+					avatar->nametag_z_offset = avatar->nametag_z_offset * (1 - blend_speed) + flying_z_offset * blend_speed;
 
-						// Set speaker icon transform and colour
-						if(avatar->speaker_gl_ob.nonNull())
-						{
-							const float vol_padding_frac = 0.f;
-							const float vol_h = ws_height * (1 - vol_padding_frac * 2);
-							const float vol_padding = ws_height * vol_padding_frac;
-							avatar->speaker_gl_ob->ob_to_world_matrix = Matrix4f::translationMatrix(use_nametag_pos + Vec4f(0, 0, 0.45f + avatar->nametag_z_offset, 0)) *
-								rot_matrix * Matrix4f::translationMatrix(-total_w/2 + ws_width + 0.05f, 0.f, vol_padding) * Matrix4f::scaleMatrix(vol_h, 1, vol_h);
+					// Rotate around z-axis, then translate to just above the avatar's head.
+					avatar->nametag_gl_ob->ob_to_world_matrix = Matrix4f::translationMatrix(use_nametag_pos + Vec4f(0, 0, 0.45f + avatar->nametag_z_offset, 0)) *
+						rot_matrix * Matrix4f::translationMatrix(-total_w/2, 0.f, 0.f) * Matrix4f::uniformScaleMatrix(ws_width);
 
-							opengl_engine->updateObjectTransformData(*avatar->speaker_gl_ob); // Update transform in 3d engine
+					assert(isFinite(avatar->nametag_gl_ob->ob_to_world_matrix.e[0]));
+					opengl_engine->updateObjectTransformData(*avatar->nametag_gl_ob); // Update transform in 3d engine
 
-							if(avatar->audio_source.nonNull())
-							{
-								const float a_0 = 1.0e-2f;
-								const float d = 0.5f * std::log10(avatar->audio_source->smoothed_cur_level / a_0);
-								const float display_level = myClamp(d, 0.f, 1.f);
-
-								// Show a white/grey icon that changes to green when the user is speaking, and changes to red if the amplitude gets too close to 1.
-								const Colour3f default_col = toLinearSRGB(Colour3f(0.8f));
-								const Colour3f green       = toLinearSRGB(Colour3f(0, 54.5f/100, 8.6f/100));
-								const Colour3f red         = toLinearSRGB(Colour3f(78.7f / 100, 0, 0));
-
-								const Colour3f col = Maths::uncheckedLerp(
-									Maths::uncheckedLerp(default_col, green, display_level),
-									red,
-									Maths::smoothStep(0.97f, 1.f, avatar->audio_source->smoothed_cur_level)
-								);
-
-								avatar->speaker_gl_ob->materials[0].albedo_linear_rgb = col;
-								opengl_engine->objectMaterialsUpdated(*avatar->speaker_gl_ob);
-							}
+					// Set speaker icon transform and colour
+					if(avatar->speaker_gl_ob.nonNull())
+					{
+						const float vol_padding_frac = 0.f;
+						const float vol_h = ws_height * (1 - vol_padding_frac * 2);
+						const float vol_padding = ws_height * vol_padding_frac;
+						avatar->speaker_gl_ob->ob_to_world_matrix = Matrix4f::translationMatrix(use_nametag_pos + Vec4f(0, 0, 0.45f + avatar->nametag_z_offset, 0)) *
+							rot_matrix * Matrix4f::translationMatrix(-total_w/2 + ws_width + 0.05f, 0.f, vol_padding) * Matrix4f::scaleMatrix(vol_h, 1, vol_h);
+
+						opengl_engine->updateObjectTransformData(*avatar->speaker_gl_ob); // Update transform in 3d engine
+
+						if(avatar->audio_source.nonNull())
+						{
+							const float a_0 = 1.0e-2f;
+							const float d = 0.5f * std::log10(avatar->audio_source->smoothed_cur_level / a_0);
+							const float display_level = myClamp(d, 0.f, 1.f);
+
+							// Show a white/grey icon that changes to green when the user is speaking, and changes to red if the amplitude gets too close to 1.
+							const Colour3f default_col = toLinearSRGB(Colour3f(0.8f));
+							const Colour3f green       = toLinearSRGB(Colour3f(0, 54.5f/100, 8.6f/100));
+							const Colour3f red         = toLinearSRGB(Colour3f(78.7f / 100, 0, 0));
+
+							const Colour3f col = Maths::uncheckedLerp(
+								Maths::uncheckedLerp(default_col, green, display_level),
+								red,
+								Maths::smoothStep(0.97f, 1.f, avatar->audio_source->smoothed_cur_level)
+							);
+
+							avatar->speaker_gl_ob->materials[0].albedo_linear_rgb = col;
+							opengl_engine->objectMaterialsUpdated(*avatar->speaker_gl_ob);
 						}
 					}
+				}
+
+				// Make foam decal if object just entered water
+				if(BitUtils::isBitSet(this->connected_world_settings.terrain_spec.flags, TerrainSpec::WATER_ENABLED_FLAG) &&
+					(pos.z - PlayerPhysics::getEyeHeight()) < this->connected_world_settings.terrain_spec.water_z)
+				{
+					// Avatar is partially or completely in water
+
+					const float foam_width = myClamp((float)avatar->graphics.getLastVel().length() * 0.1f, 0.5f, 3.f);
 
-					// Make foam decal if object just entered water
-					if(BitUtils::isBitSet(this->connected_world_settings.terrain_spec.flags, TerrainSpec::WATER_ENABLED_FLAG) &&
-						(pos.z - PlayerPhysics::getEyeHeight()) < this->connected_world_settings.terrain_spec.water_z)
+					if(!avatar->underwater) // If just entered water:
 					{
-						// Avatar is partially or completely in water
+						// Create a big 'splash' foam decal
+						Vec4f foam_pos = pos.toVec4fPoint();
+						foam_pos[2] = this->connected_world_settings.terrain_spec.water_z;
 
-						const float foam_width = myClamp((float)avatar->graphics.getLastVel().length() * 0.1f, 0.5f, 3.f);
+						terrain_decal_manager->addFoamDecal(foam_pos, foam_width, /*opacity=*/1.f, TerrainDecalManager::DecalType_ThickFoam);
 
-						if(!avatar->underwater) // If just entered water:
+						// Add splash particle(s)
+						for(int i=0; i<10; ++i)
 						{
-							// Create a big 'splash' foam decal
-							Vec4f foam_pos = pos.toVec4fPoint();
-							foam_pos[2] = this->connected_world_settings.terrain_spec.water_z;
+							Particle particle;
+							particle.pos = foam_pos;
+							particle.area = 0.000001f;
+							const float xy_spread = 1.f;
+							const float splash_particle_speed = myClamp((float)avatar->graphics.getLastVel().length() * 0.1f, 1.f, 6.f);
+							particle.vel = Vec4f(xy_spread * (-0.5f + rng.unitRandom()), xy_spread * (-0.5f + rng.unitRandom()), rng.unitRandom() * 2, 0) * splash_particle_speed;
+							particle.colour = Colour3f(1.f);
+							particle.particle_type = Particle::ParticleType_Foam;
+							particle.theta = rng.unitRandom() * Maths::get2Pi<float>();
+							particle.width = 0.5f;
+							particle.dwidth_dt = 1.f;
+							particle.die_when_hit_surface = true;
+							particle_manager->addParticle(particle);
+						}
 
-							terrain_decal_manager->addFoamDecal(foam_pos, foam_width, /*opacity=*/1.f, TerrainDecalManager::DecalType_ThickFoam);
+						avatar->underwater = true;
+					}
 
-							// Add splash particle(s)
-							for(int i=0; i<10; ++i)
+					if(pos.z + 0.1 > this->connected_world_settings.terrain_spec.water_z) // If avatar intersects the surface (approximately)
+					{
+						if(vehicle_controller_inside.isNull() && // If avatar is not inside a vehicle:
+							(avatar->graphics.getLastVel().length() > 5)) // If avatar is roughly going above walking speed: walking speed is ~2.9 m/s, running ~14 m/s
+						{
+							if(avatar->last_foam_decal_creation_time + 0.02 < cur_time)
 							{
+								Vec4f foam_pos = pos.toVec4fPoint();
+								foam_pos[2] = this->connected_world_settings.terrain_spec.water_z;
+
+								terrain_decal_manager->addFoamDecal(foam_pos, 0.75f, /*opacity=*/0.4f, TerrainDecalManager::DecalType_ThickFoam);
+
+
+								// Add splash particle(s)
 								Particle particle;
 								particle.pos = foam_pos;
 								particle.area = 0.000001f;
 								const float xy_spread = 1.f;
-								const float splash_particle_speed = myClamp((float)avatar->graphics.getLastVel().length() * 0.1f, 1.f, 6.f);
-								particle.vel = Vec4f(xy_spread * (-0.5f + rng.unitRandom()), xy_spread * (-0.5f + rng.unitRandom()), rng.unitRandom() * 2, 0) * splash_particle_speed;
-								particle.colour = Colour3f(1.f);
+								particle.vel = Vec4f(xy_spread * (-0.5f + rng.unitRandom()), xy_spread * (-0.5f + rng.unitRandom()), rng.unitRandom() * 2, 0) * 2.f;
+								particle.colour = Colour3f(0.7f);
 								particle.particle_type = Particle::ParticleType_Foam;
 								particle.theta = rng.unitRandom() * Maths::get2Pi<float>();
 								particle.width = 0.5f;
 								particle.dwidth_dt = 1.f;
 								particle.die_when_hit_surface = true;
 								particle_manager->addParticle(particle);
-							}
-
-							avatar->underwater = true;
-						}
-
-						if(pos.z + 0.1 > this->connected_world_settings.terrain_spec.water_z) // If avatar intersects the surface (approximately)
-						{
-							if(vehicle_controller_inside.isNull() && // If avatar is not inside a vehicle:
-								(avatar->graphics.getLastVel().length() > 5)) // If avatar is roughly going above walking speed: walking speed is ~2.9 m/s, running ~14 m/s
-							{
-								if(avatar->last_foam_decal_creation_time + 0.02 < cur_time)
-								{
-									Vec4f foam_pos = pos.toVec4fPoint();
-									foam_pos[2] = this->connected_world_settings.terrain_spec.water_z;
 
-									terrain_decal_manager->addFoamDecal(foam_pos, 0.75f, /*opacity=*/0.4f, TerrainDecalManager::DecalType_ThickFoam);
 
-
-									// Add splash particle(s)
-									Particle particle;
-									particle.pos = foam_pos;
-									particle.area = 0.000001f;
-									const float xy_spread = 1.f;
-									particle.vel = Vec4f(xy_spread * (-0.5f + rng.unitRandom()), xy_spread * (-0.5f + rng.unitRandom()), rng.unitRandom() * 2, 0) * 2.f;
-									particle.colour = Colour3f(0.7f);
-									particle.particle_type = Particle::ParticleType_Foam;
-									particle.theta = rng.unitRandom() * Maths::get2Pi<float>();
-									particle.width = 0.5f;
-									particle.dwidth_dt = 1.f;
-									particle.die_when_hit_surface = true;
-									particle_manager->addParticle(particle);
-
-
-									avatar->last_foam_decal_creation_time = cur_time;
-								}
+								avatar->last_foam_decal_creation_time = cur_time;
 							}
 						}
 					}
-					else
-					{
-						if(avatar->underwater)
-							avatar->underwater = false;
-					}
+				}
+				else
+				{
+					if(avatar->underwater)
+						avatar->underwater = false;
+				}
 
-					// Update avatar audio source position
-					if(avatar->audio_source.nonNull())
-					{
-						avatar->audio_source->pos = avatar->pos.toVec4fPoint();
-						audio_engine.sourcePositionUpdated(*avatar->audio_source);
-					}
+				// Update avatar audio source position
+				if(avatar->audio_source.nonNull())
+				{
+					avatar->audio_source->pos = avatar->pos.toVec4fPoint();
+					audio_engine.sourcePositionUpdated(*avatar->audio_source);
+				}
 
-					// Update selected object beam for the avatar, if it has an object selected
-					// TEMP: Disabled this code as it was messing with objects being edited.
-					/*if(avatar->selected_object_uid.valid())
+				// Update selected object beam for the avatar, if it has an object selected
+				// TEMP: Disabled this code as it was messing with objects being edited.
+				/*if(avatar->selected_object_uid.valid())
+				{
+					auto selected_it = world_state->objects.find(avatar->selected_object_uid);
+					if(selected_it != world_state->objects.end())
 					{
-						auto selected_it = world_state->objects.find(avatar->selected_object_uid);
-						if(selected_it != world_state->objects.end())
+						WorldObject* their_selected_ob = selected_it->second.getPointer();
+						Vec3d selected_pos;
+						Vec3f axis;
+						float angle;
+						their_selected_ob->getInterpolatedTransform(cur_time, selected_pos, axis, angle);
+
+						// Replace pos with the centre of the AABB (instead of the object space origin)
+						if(their_selected_ob->opengl_engine_ob.nonNull())
 						{
-							WorldObject* their_selected_ob = selected_it->second.getPointer();
-							Vec3d selected_pos;
-							Vec3f axis;
-							float angle;
-							their_selected_ob->getInterpolatedTransform(cur_time, selected_pos, axis, angle);
-
-							// Replace pos with the centre of the AABB (instead of the object space origin)
-							if(their_selected_ob->opengl_engine_ob.nonNull())
-							{
-								their_selected_ob->opengl_engine_ob->ob_to_world_matrix = Matrix4f::translationMatrix((float)selected_pos.x, (float)selected_pos.y, (float)selected_pos.z) *
-									Matrix4f::rotationMatrix(normalise(axis.toVec4fVector()), angle) *
-									Matrix4f::scaleMatrix(their_selected_ob->scale.x, their_selected_ob->scale.y, their_selected_ob->scale.z);
+							their_selected_ob->opengl_engine_ob->ob_to_world_matrix = Matrix4f::translationMatrix((float)selected_pos.x, (float)selected_pos.y, (float)selected_pos.z) *
+								Matrix4f::rotationMatrix(normalise(axis.toVec4fVector()), angle) *
+								Matrix4f::scaleMatrix(their_selected_ob->scale.x, their_selected_ob->scale.y, their_selected_ob->scale.z);
 
-								opengl_engine->updateObjectTransformData(*their_selected_ob->opengl_engine_ob);
+							opengl_engine->updateObjectTransformData(*their_selected_ob->opengl_engine_ob);
 
-								selected_pos = toVec3d(their_selected_ob->opengl_engine_ob->aabb_ws.centroid());
-							}
-
-							avatar->graphics.setSelectedObBeam(*opengl_engine, selected_pos);
+							selected_pos = toVec3d(their_selected_ob->opengl_engine_ob->aabb_ws.centroid());
 						}
+
+						avatar->graphics.setSelectedObBeam(*opengl_engine, selected_pos);
 					}
-					else
-					{
-						avatar->graphics.hideSelectedObBeam(*opengl_engine);
-					}*/
+				}
+				else
+				{
+					avatar->graphics.hideSelectedObBeam(*opengl_engine);
+				}*/
 
 
-					if(!our_avatar)
-					{
-						hud_ui.updateMarkerForAvatar(avatar, Vec3d(use_nametag_pos)); // Update marker on HUD
-						if(minimap)
-							minimap->updateMarkerForAvatar(avatar, Vec3d(use_nametag_pos)); // Update marker on minimap
+				if(!our_avatar)
+				{
+					hud_ui.updateMarkerForAvatar(avatar, Vec3d(use_nametag_pos)); // Update marker on HUD
+					if(minimap)
+						minimap->updateMarkerForAvatar(avatar, Vec3d(use_nametag_pos)); // Update marker on minimap
 
 
-						// Send UserMovedNearToAvatar/UserMovedAwayFromAvatar messages to server if needed.  Used by chatbot code.
-						if(server_protocol_version >= 46) // UserMovedNearToAvatar, UserMovedAwayFromAvatar messages were added in protocol version 46.
+					// Send UserMovedNearToAvatar/UserMovedAwayFromAvatar messages to server if needed.  Used by chatbot code.
+					if(server_protocol_version >= 46) // UserMovedNearToAvatar, UserMovedAwayFromAvatar messages were added in protocol version 46.
+					{
+						const double AVATAR_NEARBY_DIST = 6;
+						const bool near_avatar = avatar->pos.getDist2(this->cam_controller.getFirstPersonPosition()) < Maths::square(AVATAR_NEARBY_DIST);
+						if(near_avatar)
 						{
-							const double AVATAR_NEARBY_DIST = 6;
-							const bool near_avatar = avatar->pos.getDist2(this->cam_controller.getFirstPersonPosition()) < Maths::square(AVATAR_NEARBY_DIST);
-							if(near_avatar)
+							if(!avatar->in_proximity)
 							{
-								if(!avatar->in_proximity)
-								{
-									// Send UserMovedNearToAvatar message to server
-									MessageUtils::initPacket(scratch_packet, Protocol::UserMovedNearToAvatar);
-									::writeToStream(avatar->uid, scratch_packet);
-									enqueueMessageToSend(*this->client_thread, scratch_packet);
+								// Send UserMovedNearToAvatar message to server
+								MessageUtils::initPacket(scratch_packet, Protocol::UserMovedNearToAvatar);
+								::writeToStream(avatar->uid, scratch_packet);
+								enqueueMessageToSend(*this->client_thread, scratch_packet);
 
-									avatar->in_proximity = true;
-								}
+								avatar->in_proximity = true;
 							}
-							else
+						}
+						else
+						{
+							if(avatar->in_proximity)
 							{
-								if(avatar->in_proximity)
-								{
-									// Send UserMovedAwayFromAvatar message to server
-									MessageUtils::initPacket(scratch_packet, Protocol::UserMovedAwayFromAvatar);
-									::writeToStream(avatar->uid, scratch_packet);
-									enqueueMessageToSend(*this->client_thread, scratch_packet);
+								// Send UserMovedAwayFromAvatar message to server
+								MessageUtils::initPacket(scratch_packet, Protocol::UserMovedAwayFromAvatar);
+								::writeToStream(avatar->uid, scratch_packet);
+								enqueueMessageToSend(*this->client_thread, scratch_packet);
 
-									avatar->in_proximity = false;
-								}
+								avatar->in_proximity = false;
 							}
 						}
 					}
-
-
-
-
-					avatar->other_dirty = false;
-					avatar->transform_dirty = false;
-
-					assert(avatar->state == Avatar::State_JustCreated || avatar->state == Avatar::State_Alive);
-					if(avatar->state == Avatar::State_JustCreated)
-					{
-						avatar->state = Avatar::State_Alive;
-
-						world_state->avatars_changed = 1;
-					}
-
-					++it;
-				} // End if avatar state != dead.
-			} // end for each avatar
+				}
+			}
 
 			// Sort avatar positions based on distance from camera
 			CloserToCamComparator comparator(cam_controller.getPosition().toVec4fPoint());
@@ -9253,7 +9289,10 @@ void GUIClient::handleMessages(double global_time, double cur_time)
 				//logAndConPrintMessage("Created UDP socket, local_UDP_port: " + toString(local_UDP_port));
 
 				// Create ClientUDPHandlerThread for handling incoming UDP messages from server
-				Reference<ClientUDPHandlerThread> udp_handler_thread = new ClientUDPHandlerThread(udp_socket, server_hostname, this->world_state.ptr(), &this->audio_engine);
+				voice_receiver = new VoiceReceiver(&this->audio_engine, VoiceReceiver::getDefaultNumDecodeThreads());
+				voice_receiver->setListenerPos(this->cam_controller.getPosition().toVec4fPoint());
+
+				Reference<ClientUDPHandlerThread> udp_handler_thread = new ClientUDPHandlerThread(udp_socket, server_hostname, this->world_state.ptr(), voice_receiver);
 				client_udp_handler_thread_manager.addThread(udp_handler_thread);
 
 				// Send ClientUDPSocketOpen message
@@ -9291,6 +9330,11 @@ void GUIClient::handleMessages(double global_time, double cur_time)
 			this->server_has_basis_textures             = BitUtils::isBitSet(this->server_capabilities, Protocol::OBJECT_TEXTURE_BASISU_SUPPORT);
 			this->server_has_basisu_terrain_detail_maps = BitUtils::isBitSet(this->server_capabilities, Protocol::TERRAIN_DETAIL_MAPS_BASISU_SUPPORT);
 			this->server_has_optimised_meshes           = BitUtils::isBitSet(this->server_capabilities, Protocol::OPTIMISED_MESH_SUPPORT);
+#if EMSCRIPTEN
+			this->server_has_physics_shapes             = false; // Downloaded resources are passed around as LoadedBuffers with Emscripten, not read from disk, so LoadModelTask can't use downloaded shapes yet.
+#else
+			this->server_has_physics_shapes             = BitUtils::isBitSet(this->server_capabilities, Protocol::PHYSICS_SHAPE_SUPPORT) && this->server_has_optimised_meshes; // Shapes are only built for optimised meshes.
+#endif
 
 			ui_interface->clientConnectedToServer();
 
@@ -10017,6 +10061,7 @@ void GUIClient::handleMessages(double global_time, double cur_time)
 								options.include_lightmaps = this->use_lightmaps;
 								options.get_optimised_mesh = this->server_has_optimised_meshes;
 								options.opt_mesh_version = this->server_opt_mesh_version;
+								options.get_physics_shape = this->server_has_physics_shapes;
 								options.allocator = &arena_allocator;
 
 								DependencyURLSet URL_set(std::less<DependencyURL>(), stl_arena_allocator);
@@ -10168,6 +10213,9 @@ void GUIClient::handleMessages(double global_time, double cur_time)
 									load_model_task->opengl_engine = this->opengl_engine;
 									load_model_task->result_msg_queue = &this->msg_queue;
 									load_model_task->resource_manager = resource_manager;
+									load_model_task->physics_shape_cache = physics_shape_cache;
+									if(this->server_has_physics_shapes && info.build_physics_ob)
+										load_model_task->physics_shape_url = WorldObject::getPhysicsShapeURLForModelURL(URL, info.build_dynamic_physics_ob);
 									load_model_task->build_physics_ob = info.build_physics_ob;
 									load_model_task->build_dynamic_physics_ob = info.build_dynamic_physics_ob;
 									load_model_task->loaded_buffer = m->loaded_buffer;
@@ -10484,13 +10532,13 @@ std::string GUIClient::getDiagnosticsString(bool do_graphics_diagnostics, bool d
 
 	{
 		msg += "\nAudio engine:\n";
-		{
-			Lock lock(audio_engine.mutex);
-			msg += "Num audio obs: " + toString(audio_obs.size()) + "\n";
-			msg += "Num active audio sources: " + toString(audio_engine.audio_sources.size()) + "\n";
-		}
+		msg += "Num audio obs: " + toString(audio_obs.size()) + "\n";
+		msg += "Num audio sources: " + toString(audio_engine.audio_sources.size()) + "\n";
+		msg += "Num playing audio sources: " + toString(audio_engine.getNumPlayingSources()) + "\n";
+		msg += "Num real voices: " + toString(audio_engine.getNumRealVoices()) + "\n";
+		msg += "Num dropped audio commands: " + toString(audio_engine.getNumDroppedCommands()) + "\n";
+		msg += "Num overflow audio commands: " + toString(audio_engine.getNumOverflowCommands()) + "\n";
 		/*msg += "Audio sources\n";
-		Lock lock(audio_engine.mutex);
 		for(auto it = audio_engine.audio_sources.begin(); it != audio_engine.audio_sources.end(); ++it)
 		{
 		msg += (*it)->debugname + "\n";
@@ -11710,6 +11758,7 @@ void GUIClient::applyUndoOrRedoObject(const WorldObjectRef& restored_ob)
 
 					// updateInstancedCopiesOfObject(ob); // TODO: enable + test this
 					in_world_ob->transformChanged();
+					scripted_ob_proximity_checker.objectTransformChanged(in_world_ob.ptr());
 
 					// Mark as from-local-dirty to send an object updated message to the server
 					in_world_ob->from_local_other_dirty = true;
@@ -12611,6 +12660,7 @@ void GUIClient::objectTransformEdited()
 						useScaleForWorldOb(selected_ob->scale).toVec4fVector());
 
 				selected_ob->transformChanged(); // Recompute centroid_ws, biased_aabb_len etc..
+				scripted_ob_proximity_checker.objectTransformChanged(selected_ob.ptr());
 
 				Lock lock(this->world_state->mutex);
 
@@ -12696,7 +12746,7 @@ void GUIClient::objectEdited()
 				Reference<OpenGLMeshRenderData> gl_meshdata = ModelLoading::makeModelForVoxelGroup(selected_ob->getDecompressedVoxelGroup(), subsample_factor, ob_to_world,
 					opengl_engine->vert_buf_allocator.ptr(), /*do_opengl_stuff=*/true, /*need_lightmap_uvs=*/false, mat_transparent, /*build_dynamic_physics_ob=*/selected_ob->isDynamic(),
 					worker_allocator.ptr(), 
-					physics_shape);
+					physics_shape, /*task_manager=*/high_priority_task_manager); // We are blocking the main thread while meshing, so mesh in parallel.
 
 				// Remove existing physics object
 				checkRemoveObAndSetRefToNull(physics_world, selected_ob->physics_object);
@@ -13003,6 +13053,7 @@ void GUIClient::objectEdited()
 					//ui->indigoView->objectTransformChanged(*selected_ob);
 
 					selected_ob->transformChanged();
+					scripted_ob_proximity_checker.objectTransformChanged(selected_ob.ptr());
 
 					Lock lock(this->world_state->mutex);
 
@@ -13436,6 +13487,9 @@ void GUIClient::disconnectFromServerAndClearAllObjects() // Remove any WorldObje
 	// Kill any existing threads connected to the server
 	net_resource_download_thread_manager.killThreadsBlocking();
 	client_udp_handler_thread_manager.killThreadsBlocking();
+	if(voice_receiver.nonNull())
+		voice_receiver->removeMixedStreams();
+	voice_receiver = NULL;
 	mic_read_thread_manager.killThreadsBlocking();
 
 #if defined(EMSCRIPTEN)
@@ -13958,7 +14012,7 @@ void GUIClient::checkCreateManagersAndMinimapAndBuilderAIUI()
 			terrain_decal_manager = new TerrainDecalManager(this->base_dir_path, async_texture_loader.ptr(), opengl_engine.ptr());
 		
 		if(!particle_manager)
-			particle_manager = new ParticleManager(this->base_dir_path, async_texture_loader.ptr(), opengl_engine.ptr(), physics_world.ptr(), terrain_decal_manager.ptr());
+			particle_manager = new ParticleManager(this->base_dir_path, async_texture_loader.ptr(), opengl_engine.ptr(), physics_world.ptr(), terrain_decal_manager.ptr(), high_priority_task_manager);
 
 		if(!minimap)
 			minimap = new MiniMap(opengl_engine, /*gui_client_=*/this, gl_ui);
@@ -14353,7 +14407,7 @@ void GUIClient::updateObjectModelForChangedDecompressedVoxels(WorldObjectRef& ob
 		Reference<OpenGLMeshRenderData> gl_meshdata = ModelLoading::makeModelForVoxelGroup(ob->getDecompressedVoxelGroup(), subsample_factor, ob_to_world,
 			opengl_engine->vert_buf_allocator.ptr(), /*do_opengl_stuff=*/true, /*need_lightmap_uvs=*/false, mat_transparent, /*build_dynamic_physics_ob=*/ob->isDynamic(),
 			worker_allocator.ptr(),
-			physics_shape);
+			physics_shape, /*task_manager=*/high_priority_task_manager); // We are blocking the main thread while meshing, so mesh in parallel.
 
 		GLObjectRef gl_ob = opengl_engine->allocateObject();
 		gl_ob->ob_to_world_matrix = ob_to_world;
@@ -14803,6 +14857,8 @@ void GUIClient::rotateObject(WorldObjectRef ob, const Vec4f& axis, float angle)
 
 		ob->transformChanged();
 
+		scripted_ob_proximity_checker.objectTransformChanged(ob.ptr());
+
 		ob->last_modified_time = TimeStamp::currentTime(); // Gets set on server as well, this is just for updating the local display.
 
 		// Mark as from-local-dirty to send an object updated message to the server.
@@ -15540,7 +15596,8 @@ void GUIClient::updateGroundPlane()
 
 
 		terrain_system = new TerrainSystem();
-		terrain_system->init(path_spec, this->base_dir_path, opengl_engine.ptr(), this->physics_world.ptr(), biome_manager, this->cam_controller.getPosition(), &this->model_and_texture_loader_task_manager, stack_allocator, &this->msg_queue);
+		terrain_system->init(path_spec, this->base_dir_path, opengl_engine.ptr(), this->physics_world.ptr(), biome_manager, this->cam_controller.getPosition(), &this->model_and_texture_loader_task_manager, stack_allocator, &this->msg_queue, 
+			terrain_chunk_cache);
 	}
 
 #if 0
@@ -19,6 +19,8 @@ Copyright Glare Technologies Limited 2024 -
 #include "ChatUI.h"
 #include "DownloadingResourceQueue.h"
 #include "LoadItemQueue.h"
+#include "ObjectLODEvaluator.h"
+#include "AvatarPoseUpdater.h"
 #include "MeshManager.h"
 #include "AnimationManager.h"
 #include "URLParser.h"
@@ -84,6 +86,10 @@ class ClientThread;
 class MySocket;
 class LogWindow;
 class ResourceManager;
+class PhysicsShapeCache;
+class VoxelMeshCache;
+class TerrainChunkCache;
+class VoiceReceiver;
 struct ID3D11Device;
 struct IMFDXGIDeviceManager;
 class SettingsStore;
@@ -526,6 +532,7 @@ public:
 	Reference<ClientThread> client_thread;
 	ThreadManager client_thread_manager;
 	ThreadManager client_udp_handler_thread_manager;
+	Reference<VoiceReceiver> voice_receiver; // Decodes voice packets received by the ClientUDPHandlerThread.
 	ThreadManager mic_read_thread_manager;
 	ThreadManager resource_upload_thread_manager;
 	ThreadManager resource_download_thread_manager;
@@ -555,6 +562,9 @@ public:
 	ParcelRef selected_parcel;
 
 	Reference<ResourceManager> resource_manager;
+	Reference<PhysicsShapeCache> physics_shape_cache; // Null with Emscripten.
+	Reference<VoxelMeshCache> voxel_mesh_cache; // Null with Emscripten.
+	Reference<TerrainChunkCache> terrain_chunk_cache; // Has no disk cache with Emscripten.
 
 
 	// NOTE: these object sets need to be cleared in connectToServer(), also when removing a dead object in ob->state == WorldObject::State_Dead case in timerEvent, the object needs to be removed
@@ -812,7 +822,12 @@ public:
 	uint32 server_capabilities;
 
 	uint64 frame_num;
-	size_t next_lod_changes_begin_i;
+
+	ObjectLODEvaluator lod_evaluator;
+	std::vector<ObjectLODChange> lod_changes; // temp vector
+
+	AvatarPoseUpdater avatar_pose_updater;
+	std::vector<AvatarPoseUpdateJob> avatar_pose_jobs; // temp vector
 
 	MicReadStatus mic_read_status;
 
@@ -860,6 +875,7 @@ public:
 	bool server_has_basisu_terrain_detail_maps;
 	bool server_has_optimised_meshes;
 	int server_opt_mesh_version;
+	bool server_has_physics_shapes; // Does the server build physics shapes for optimised meshes, that we can download instead of building them ourselves.
 
 	bool shown_object_modification_error_msg;
 
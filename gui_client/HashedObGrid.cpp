@@ -0,0 +1,496 @@
+/*=====================================================================
+HashedObGrid.cpp
+----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "HashedObGrid.h"
+
+
+HashedObGrid::HashedObGrid(float cell_w_, int expected_num_items)
+:	cell_w(cell_w_),
+	recip_cell_w(1 / cell_w_),
+	num_cells(0),
+	num_obs(0)
+{
+	assert(expected_num_items > 0);
+
+	const unsigned int num_table_entries = myMax<unsigned int>(8, (unsigned int)Maths::roundToNextHighestPowerOf2((unsigned int)expected_num_items));
+
+	HashedObGridCell empty_cell;
+	empty_cell.x = empty_cell.y = empty_cell.z = 0;
+	empty_cell.num_obs = 0;
+	empty_cell.block_offset = 0;
+	empty_cell.block_size_class = 0;
+	cells.resize(num_table_entries, empty_cell);
+
+	hash_mask = num_table_entries - 1;
+}
+
+
+HashedObGrid::~HashedObGrid()
+{}
+
+
+void HashedObGrid::clear()
+{
+	for(size_t i=0; i<cells.size(); ++i)
+		cells[i].num_obs = 0;
+	num_cells = 0;
+
+	ob_slots.clear();
+	for(int i=0; i<NUM_SIZE_CLASSES; ++i)
+		free_blocks[i].clear();
+
+	num_obs = 0;
+}
+
+
+uint32 HashedObGrid::allocBlock(uint32 size_class)
+{
+	assert(size_class < NUM_SIZE_CLASSES);
+	if(!free_blocks[size_class].empty())
+	{
+		const uint32 offset = free_blocks[size_class].back();
+		free_blocks[size_class].pop_back();
+		return offset;
+	}
+
+	const uint32 offset = (uint32)ob_slots.size();
+	ob_slots.resize(ob_slots.size() + ((size_t)1 << size_class));
+	return offset;
+}
+
+
+void HashedObGrid::freeBlock(uint32 offset, uint32 size_class)
+{
+	free_blocks[size_class].push_back(offset);
+}
+
+
+// Double the size of the cell table and reinsert all cells.  Object blocks are unchanged.
+void HashedObGrid::expandTable()
+{
+	std::vector<HashedObGridCell> old_cells;
+	old_cells.swap(cells);
+
+	HashedObGridCell empty_cell;
+	empty_cell.x = empty_cell.y = empty_cell.z = 0;
+	empty_cell.num_obs = 0;
+	empty_cell.block_offset = 0;
+	empty_cell.block_size_class = 0;
+	cells.resize(old_cells.size() * 2, empty_cell);
+	hash_mask = (uint32)cells.size() - 1;
+
+	for(size_t i=0; i<old_cells.size(); ++i)
+	{
+		const HashedObGridCell& cell = old_cells[i];
+		if(cell.num_obs > 0)
+		{
+			unsigned int dest_i = computeHash(cell.x, cell.y, cell.z);
+			while(cells[dest_i].num_obs != 0)
+				dest_i = (dest_i + 1) & hash_mask;
+			cells[dest_i] = cell;
+		}
+	}
+}
+
+
+unsigned int HashedObGrid::insertNewCell(int x, int y, int z)
+{
+	// Keep load factor <= 0.5
+	if((num_cells + 1) * 2 > cells.size())
+		expandTable();
+
+	unsigned int i = computeHash(x, y, z);
+	while(cells[i].num_obs != 0)
+		i = (i + 1) & hash_mask;
+
+	HashedObGridCell& cell = cells[i];
+	cell.x = x;
+	cell.y = y;
+	cell.z = z;
+	cell.block_size_class = 1;
+	cell.block_offset = allocBlock(cell.block_size_class);
+	// NOTE: num_obs is still 0 here, caller will add the first object.
+
+	num_cells++;
+	return i;
+}
+
+
+// Remove the (now empty) cell at index cell_i using backward-shift deletion, so no tombstones are needed.
+void HashedObGrid::removeCell(unsigned int cell_i)
+{
+	freeBlock(cells[cell_i].block_offset, cells[cell_i].block_size_class);
+
+	unsigned int hole_i = cell_i;
+	unsigned int j = cell_i;
+	while(1)
+	{
+		j = (j + 1) & hash_mask;
+		if(cells[j].num_obs == 0)
+			break;
+
+		// Cell at j can be moved to the hole if its home index is not cyclically in (hole_i, j].
+		const unsigned int home_i = computeHash(cells[j].x, cells[j].y, cells[j].z);
+		const bool home_in_range = (hole_i <= j) ? ((hole_i < home_i) && (home_i <= j)) : ((hole_i < home_i) || (home_i <= j));
+		if(!home_in_range)
+		{
+			cells[hole_i] = cells[j];
+			hole_i = j;
+		}
+	}
+
+	cells[hole_i].num_obs = 0;
+	num_cells--;
+}
+
+
+void HashedObGrid::insertAtPos(const WorldObjectRef& ob, const Vec4f& pos)
+{
+	const Vec4i p_i = bucketIndicesForPoint(pos);
+
+	int cell_i = findCellIndex(p_i[0], p_i[1], p_i[2]);
+	if(cell_i >= 0)
+	{
+		// Return if object is already in the cell
+		const HashedObGridCell& cell = cells[cell_i];
+		const WorldObjectRef* const obs = &ob_slots[cell.block_offset];
+		for(uint32 i=0; i<cell.num_obs; ++i)
+			if(obs[i].ptr() == ob.ptr())
+				return;
+	}
+	else
+		cell_i = (int)insertNewCell(p_i[0], p_i[1], p_i[2]);
+
+	HashedObGridCell& cell = cells[cell_i];
+	if(cell.num_obs == (1u << cell.block_size_class)) // If block is full:
+	{
+		// Move objects to a block with double the capacity.
+		const uint32 new_size_class = cell.block_size_class + 1;
+		const uint32 new_offset = allocBlock(new_size_class);
+		for(uint32 i=0; i<cell.num_obs; ++i)
+		{
+			ob_slots[new_offset + i] = ob_slots[cell.block_offset + i];
+			ob_slots[cell.block_offset + i] = WorldObjectRef();
+		}
+		freeBlock(cell.block_offset, cell.block_size_class);
+
+		cell.block_offset = new_offset;
+		cell.block_size_class = new_size_class;
+	}
+
+	ob_slots[cell.block_offset + cell.num_obs] = ob;
+	cell.num_obs++;
+	num_obs++;
+}
+
+
+void HashedObGrid::removeAtPos(const WorldObjectRef& ob, const Vec4f& pos)
+{
+	const Vec4i p_i = bucketIndicesForPoint(pos);
+
+	const int cell_i = findCellIndex(p_i[0], p_i[1], p_i[2]);
+	if(cell_i < 0)
+		return;
+
+	HashedObGridCell& cell = cells[cell_i];
+	WorldObjectRef* const obs = &ob_slots[cell.block_offset];
+	for(uint32 i=0; i<cell.num_obs; ++i)
+	{
+		if(obs[i].ptr() == ob.ptr())
+		{
+			// Swap with last object and remove last object.
+			const uint32 last_i = cell.num_obs - 1;
+			if(i != last_i)
+				obs[i] = obs[last_i];
+			obs[last_i] = WorldObjectRef();
+			cell.num_obs--;
+			num_obs--;
+
+			if(cell.num_obs == 0)
+				removeCell((unsigned int)cell_i);
+			return;
+		}
+	}
+}
+
+
+void HashedObGrid::objectMoved(const WorldObjectRef& ob, const Vec4f& old_pos)
+{
+	const Vec4f new_pos = ob->pos.toVec4fPoint();
+	const Vec4i old_cell = bucketIndicesForPoint(old_pos);
+	const Vec4i new_cell = bucketIndicesForPoint(new_pos);
+	if(old_cell[0] != new_cell[0] || old_cell[1] != new_cell[1] || old_cell[2] != new_cell[2])
+	{
+		removeAtPos(ob, old_pos);
+		insertAtPos(ob, new_pos);
+	}
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Timer.h>
+#include <maths/PCG32.h>
+#include <unordered_set>
+#include <set>
+#include <tuple>
+
+
+// The previous HashedObGrid implementation, using a std::unordered_set per hash bucket, for performance comparison.
+class UnorderedSetObGrid
+{
+public:
+	UnorderedSetObGrid(float cell_w_, int expected_num_items)
+	:	recip_cell_w(1 / cell_w_)
+	{
+		const unsigned int num_buckets = myMax<unsigned int>(8, (unsigned int)Maths::roundToNextHighestPowerOf2((unsigned int)expected_num_items));
+		buckets.resize(num_buckets);
+		hash_mask = num_buckets - 1;
+	}
+
+	inline unsigned int getBucketIndexForPoint(const Vec4f& p) const
+	{
+		const Vec4i p_i = floorToVec4i(p * recip_cell_w);
+		return computeHash(p_i[0], p_i[1], p_i[2]);
+	}
+
+	inline unsigned int computeHash(int x, int y, int z) const
+	{
+		return ((x * 73856093) ^ (y * 19349663) ^ (z * 83492791)) & hash_mask;
+	}
+
+	void insertAtPos(const WorldObjectRef& ob, const Vec4f& pos) { buckets[getBucketIndexForPoint(pos)].insert(ob); }
+	void removeAtPos(const WorldObjectRef& ob, const Vec4f& pos) { buckets[getBucketIndexForPoint(pos)].erase(ob); }
+
+	float recip_cell_w;
+	std::vector<std::unordered_set<WorldObjectRef, WorldObjectRefHash>> buckets;
+	uint32 hash_mask;
+};
+
+
+// Check grid contents against a brute-force computation of the objects in each cell.
+static void checkGridContents(const HashedObGrid& grid, const std::vector<WorldObjectRef>& obs, const std::vector<bool>& in_grid)
+{
+	size_t num_in_grid = 0;
+	std::set<std::tuple<int, int, int>> cells;
+	for(size_t i=0; i<obs.size(); ++i)
+	{
+		if(in_grid[i])
+		{
+			num_in_grid++;
+			const Vec4i p_i = grid.bucketIndicesForPoint(obs[i]->pos.toVec4fPoint());
+			cells.insert(std::make_tuple(p_i[0], p_i[1], p_i[2]));
+
+			// Check object is in its cell
+			const HashedObGridBucket bucket = grid.getBucketForIndices(p_i);
+			bool found = false;
+			for(auto it = bucket.objects.begin(); it != bucket.objects.end(); ++it)
+				if(it->ptr() == obs[i].ptr())
+					found = true;
+			testAssert(found);
+		}
+	}
+	testAssert(grid.numObjects() == num_in_grid);
+	testAssert(grid.numNonEmptyCells() == cells.size());
+
+	// Check the total number of objects over all non-empty cells, and that each object in a cell belongs there.
+	size_t total = 0;
+	for(auto it = cells.begin(); it != cells.end(); ++it)
+	{
+		const HashedObGridBucket bucket = grid.getBucketForIndices(std::get<0>(*it), std::get<1>(*it), std::get<2>(*it));
+		for(auto ob_it = bucket.objects.begin(); ob_it != bucket.objects.end(); ++ob_it)
+		{
+			const Vec4i p_i = grid.bucketIndicesForPoint((*ob_it)->pos.toVec4fPoint());
+			testAssert(p_i[0] == std::get<0>(*it) && p_i[1] == std::get<1>(*it) && p_i[2] == std::get<2>(*it));
+		}
+		total += bucket.objects.size();
+	}
+	testAssert(total == num_in_grid);
+}
+
+
+void HashedObGrid::test()
+{
+	conPrint("HashedObGrid::test()");
+
+	//------------------------- Basic tests -------------------------
+	{
+		HashedObGrid grid(/*cell_w=*/10.f, /*expected_num_items=*/8);
+
+		WorldObjectRef ob = new WorldObject();
+		ob->pos = Vec3d(1, 2, 3);
+		grid.insert(ob);
+		grid.insert(ob); // Inserting again should do nothing.
+		testAssert(grid.numObjects() == 1);
+		testAssert(grid.getBucketForIndices(0, 0, 0).objects.size() == 1);
+		testAssert(grid.getBucketForIndices(1, 0, 0).objects.empty());
+
+		const Vec4f old_pos = ob->pos.toVec4fPoint();
+		ob->pos = Vec3d(-15, 2, 3);
+		grid.objectMoved(ob, old_pos);
+		testAssert(grid.getBucketForIndices(0, 0, 0).objects.empty());
+		testAssert(grid.getBucketForIndices(-2, 0, 0).objects.size() == 1);
+		testAssert(grid.numNonEmptyCells() == 1);
+
+		grid.remove(ob);
+		testAssert(grid.numObjects() == 0);
+		testAssert(grid.numNonEmptyCells() == 0);
+		testAssert(ob->getRefCount() == 1);
+	}
+
+	//------------------------- Randomised test against brute force -------------------------
+	{
+		PCG32 rng(1);
+		HashedObGrid grid(/*cell_w=*/10.f, /*expected_num_items=*/8); // Start small to test table expansion
+		const int N = 2000;
+		std::vector<WorldObjectRef> obs(N);
+		std::vector<bool> in_grid(N, false);
+		for(int i=0; i<N; ++i)
+		{
+			obs[i] = new WorldObject();
+			obs[i]->pos = Vec3d(-100 + rng.unitRandom() * 200, -100 + rng.unitRandom() * 200, rng.unitRandom() * 20);
+		}
+
+		for(int iter=0; iter<20000; ++iter)
+		{
+			const int i = (int)rng.nextUInt(N);
+			const float r = rng.unitRandom();
+			if(r < 0.4f)
+			{
+				grid.insert(obs[i]);
+				in_grid[i] = true;
+			}
+			else if(r < 0.7f)
+			{
+				grid.remove(obs[i]);
+				in_grid[i] = false;
+			}
+			else
+			{
+				const Vec4f old_pos = obs[i]->pos.toVec4fPoint();
+				obs[i]->pos += Vec3d(-10 + rng.unitRandom() * 20, -10 + rng.unitRandom() * 20, 0);
+				if(in_grid[i])
+					grid.objectMoved(obs[i], old_pos);
+			}
+
+			if(iter % 1000 == 0)
+				checkGridContents(grid, obs, in_grid);
+		}
+		checkGridContents(grid, obs, in_grid);
+
+		grid.clear();
+		testAssert(grid.numObjects() == 0);
+		for(int i=0; i<N; ++i)
+			testAssert(obs[i]->getRefCount() == 1);
+	}
+
+	//------------------------- Perf test: compare against UnorderedSetObGrid -------------------------
+	{
+		const int N = 100000;
+		const float cell_w = 200.f; // Same as ProximityLoader
+		const float world_w = 8000.f;
+		PCG32 rng(1);
+		std::vector<WorldObjectRef> obs(N);
+		std::vector<Vec4f> positions(N);
+		std::vector<Vec4f> new_positions(N);
+		for(int i=0; i<N; ++i)
+		{
+			obs[i] = new WorldObject();
+			positions[i] = Vec4f(rng.unitRandom() * world_w, rng.unitRandom() * world_w, rng.unitRandom() * 50.f, 1.f);
+			new_positions[i] = positions[i] + Vec4f(-20 + rng.unitRandom() * 40, -20 + rng.unitRandom() * 40, 0, 0);
+			obs[i]->pos = Vec3d(new_positions[i][0], new_positions[i][1], new_positions[i][2]); // Final position after the move phase
+		}
+
+		const int query_r = 10; // Query (2*10+1)^2 cells around camera, like ProximityLoader with a 2km load distance.
+		const int num_queries = 100;
+
+		// New grid
+		double new_insert_time, new_move_time, new_query_time;
+		size_t new_query_count = 0;
+		{
+			HashedObGrid grid(cell_w, 1 << 10);
+			Timer timer;
+			for(int i=0; i<N; ++i)
+				grid.insertAtPos(obs[i], positions[i]);
+			new_insert_time = timer.elapsed();
+
+			timer.reset();
+			for(int i=0; i<N; ++i)
+			{
+				grid.removeAtPos(obs[i], positions[i]);
+				grid.insertAtPos(obs[i], new_positions[i]);
+			}
+			new_move_time = timer.elapsed();
+
+			timer.reset();
+			for(int q=0; q<num_queries; ++q)
+			{
+				const Vec4i c = grid.bucketIndicesForPoint(Vec4f(world_w * q / num_queries, world_w * 0.5f, 0, 1));
+				for(int y=c[1]-query_r; y<=c[1]+query_r; ++y)
+				for(int x=c[0]-query_r; x<=c[0]+query_r; ++x)
+				{
+					const HashedObGridBucket bucket = grid.getBucketForIndices(x, y, 0);
+					for(auto it = bucket.objects.begin(); it != bucket.objects.end(); ++it)
+						new_query_count += (size_t)((*it)->pos.x >= 0);
+				}
+			}
+			new_query_time = timer.elapsed();
+		}
+
+		// Old grid
+		double old_insert_time, old_move_time, old_query_time;
+		size_t old_query_count = 0;
+		{
+			UnorderedSetObGrid grid(cell_w, 1 << 10);
+			Timer timer;
+			for(int i=0; i<N; ++i)
+				grid.insertAtPos(obs[i], positions[i]);
+			old_insert_time = timer.elapsed();
+
+			timer.reset();
+			for(int i=0; i<N; ++i)
+			{
+				grid.removeAtPos(obs[i], positions[i]);
+				grid.insertAtPos(obs[i], new_positions[i]);
+			}
+			old_move_time = timer.elapsed();
+
+			timer.reset();
+			for(int q=0; q<num_queries; ++q)
+			{
+				const Vec4i c = floorToVec4i(Vec4f(world_w * q / num_queries, world_w * 0.5f, 0, 1) * grid.recip_cell_w);
+				for(int y=c[1]-query_r; y<=c[1]+query_r; ++y)
+				for(int x=c[0]-query_r; x<=c[0]+query_r; ++x)
+				{
+					const auto& bucket = grid.buckets[grid.computeHash(x, y, 0)];
+					for(auto it = bucket.begin(); it != bucket.end(); ++it)
+					{
+						// Buckets may contain objects from other cells with the same hash, so these need to be filtered out.
+						const Vec4i p_i = floorToVec4i((*it)->pos.toVec4fPoint() * grid.recip_cell_w);
+						if(p_i[0] == x && p_i[1] == y && p_i[2] == 0)
+							old_query_count += (size_t)((*it)->pos.x >= 0);
+					}
+				}
+			}
+			old_query_time = timer.elapsed();
+		}
+
+		testAssert(new_query_count == old_query_count);
+
+		conPrint("HashedObGrid perf, " + toString(N) + " objects:");
+		conPrint("    insert: " + doubleToStringNSigFigs(new_insert_time * 1.0e3, 4) + " ms (unordered_set grid: " + doubleToStringNSigFigs(old_insert_time * 1.0e3, 4) + " ms)");
+		conPrint("    move:   " + doubleToStringNSigFigs(new_move_time   * 1.0e3, 4) + " ms (unordered_set grid: " + doubleToStringNSigFigs(old_move_time   * 1.0e3, 4) + " ms)");
+		conPrint("    query:  " + doubleToStringNSigFigs(new_query_time  * 1.0e3, 4) + " ms (unordered_set grid: " + doubleToStringNSigFigs(old_query_time  * 1.0e3, 4) + " ms)");
+	}
+
+	conPrint("HashedObGrid::test() done");
+}
+
+
+#endif // BUILD_TESTS
@@ -7,118 +7,157 @@ Copyright Glare Technologies Limited 2021 -
 
 
 #include "../shared/WorldObject.h"
-#include <unordered_set>
-
+#include <vector>
 
 
+// The objects in a single grid cell.
 class HashedObGridBucket
 {
 public:
-	//SmallVector<WorldObjectRef, 2> objects;
-	std::unordered_set<WorldObjectRef, WorldObjectRefHash> objects;
+	struct ObjectRange
+	{
+		const WorldObjectRef* begin() const { return begin_; }
+		const WorldObjectRef* end() const { return end_; }
+		size_t size() const { return end_ - begin_; }
+		bool empty() const { return begin_ == end_; }
+
+		const WorldObjectRef* begin_;
+		const WorldObjectRef* end_;
+	};
+
+	ObjectRange objects;
+};
+
+
+struct HashedObGridCell
+{
+	int x, y, z; // Cell coordinates
+	uint32 num_obs; // A table entry with num_obs = 0 is unused.
+	uint32 block_offset; // Offset of this cell's object array in HashedObGrid::ob_slots
+	uint32 block_size_class; // Capacity of the object array is (1 << block_size_class).
 };
 
 
 /*=====================================================================
 HashedObGrid
 ------------
-TODO: Try using open addressing (don't use a vector in buckets, spill into adjacent buckets)
+Grid of objects, bucketed into cubic cells of width cell_w.
+
+Non-empty cells are stored in an open-addressed (linear probing) table,
+keyed by cell coordinates, so lookups for a cell don't return objects from
+other cells with colliding hashes.  Cells are removed from the table when
+they become empty, using backward-shift deletion.
+
+Each cell's objects are stored contiguously in a block in ob_slots.
+Blocks have power-of-two capacities, and freed blocks are kept on
+per-capacity free lists for reuse, so inserting and removing objects
+doesn't do a heap allocation per operation.
+
+Inserting an object that is already in its cell does nothing.
+Not threadsafe.
+
+NOTE: ProximityLoader, the only user of this class, currently has its object
+insert, remove and cell iteration code disabled (object loading is driven by
+the per-object LOD code in GUIClient instead), so in the client only
+bucketIndicesForPoint(), clear() and numObjects() are called at the moment.
 =====================================================================*/
 class HashedObGrid
 {
 public:
-	HashedObGrid(float cell_w_, int expected_num_items)
-	:	cell_w(cell_w_),
-		recip_cell_w(1 / cell_w_)
-	{
-		assert(expected_num_items > 0);
-
-		const unsigned int num_buckets = myMax<unsigned int>(8, (unsigned int)Maths::roundToNextHighestPowerOf2((unsigned int)expected_num_items/* * 2*/));
-		buckets.resize(num_buckets);
+	HashedObGrid(float cell_w_, int expected_num_items);
+	~HashedObGrid();
 
-		hash_mask = num_buckets - 1;
-	}
-
-	inline void clear()
-	{
-		for(size_t i = 0; i < buckets.size(); ++i)
-			buckets[i].objects.clear();
-	}
+	void clear();
 
 	inline Vec4i bucketIndicesForPoint(const Vec4f& p) const
 	{
 		return floorToVec4i(p * recip_cell_w);
 	}
 
-	inline void insert(const WorldObjectRef& ob)
-	{
-		unsigned int bucket_i = getBucketIndexForPoint(ob->pos.toVec4fPoint());
-		//buckets[bucket_i].objects.push_back(ob);
-		buckets[bucket_i].objects.insert(ob);
-	}
+	// Insert into the cell containing ob->pos.
+	inline void insert(const WorldObjectRef& ob) { insertAtPos(ob, ob->pos.toVec4fPoint()); }
 
-	inline void remove(const WorldObjectRef& ob)
-	{
-		unsigned int bucket_i = getBucketIndexForPoint(ob->pos.toVec4fPoint());
-		// Find item
-		/*for(size_t i=0; i<buckets[bucket_i].objects.size(); ++i)
-		{
-			if(buckets[bucket_i].objects[i] == ob)
-			{
-				buckets[bucket_i].objects.erase(buckets[bucket_i].objects.begin() + i);
-				return;
-			}
-		}*/
-		buckets[bucket_i].objects.erase(ob);
-	}
+	// Remove from the cell containing ob->pos.
+	inline void remove(const WorldObjectRef& ob) { removeAtPos(ob, ob->pos.toVec4fPoint()); }
+
+	void insertAtPos(const WorldObjectRef& ob, const Vec4f& pos);
+	void removeAtPos(const WorldObjectRef& ob, const Vec4f& pos);
+
+	// Move the object from the cell containing old_pos to the cell containing ob->pos.  Does nothing if the cell hasn't changed.
+	void objectMoved(const WorldObjectRef& ob, const Vec4f& old_pos);
 
 #if GUI_CLIENT
 	inline void removeAtLastPos(const WorldObjectRef& ob)
 	{
-		//unsigned int bucket_i = getBucketIndexForPoint(ob->last_pos.toVec4fPoint());
-		//buckets[bucket_i].objects.erase(ob);
+		//removeAtPos(ob, ob->last_pos.toVec4fPoint());
 	}
 #endif
 
-
-	inline const HashedObGridBucket& getBucketForIndices(const Vec4i& p) const
+	inline HashedObGridBucket getBucketForIndices(const Vec4i& p) const
 	{
-		return buckets[computeHash(p)];
+		return getBucketForIndices(p[0], p[1], p[2]);
 	}
 
-	inline const HashedObGridBucket& getBucketForIndices(const int x, const int y, const int z) const
+	inline HashedObGridBucket getBucketForIndices(const int x, const int y, const int z) const
 	{
-		return buckets[computeHash(x, y, z)];
+		HashedObGridBucket bucket;
+		const int cell_i = findCellIndex(x, y, z);
+		if(cell_i >= 0)
+		{
+			const HashedObGridCell& cell = cells[cell_i];
+			bucket.objects.begin_ = ob_slots.data() + cell.block_offset;
+			bucket.objects.end_   = ob_slots.data() + cell.block_offset + cell.num_obs;
+		}
+		else
+			bucket.objects.begin_ = bucket.objects.end_ = nullptr;
+		return bucket;
 	}
 
-	inline unsigned int getBucketIndexForPoint(const Vec4f& p) const
+	size_t numObjects() const { return num_obs; }
+	size_t numNonEmptyCells() const { return num_cells; }
+
+	inline unsigned int computeHash(int x, int y, int z) const
 	{
-		const Vec4i p_i = floorToVec4i(p * recip_cell_w); //truncateToVec4i((p - grid_aabb.min_) * recip_cell_w);
+		// NOTE: technically possible undefined behaviour here (signed overflow)
 
-		return computeHash(p_i);
+		return ((x * 73856093) ^ (y * 19349663) ^ (z * 83492791)) & hash_mask;
 	}
 
+	static void test();
 
-	inline unsigned int computeHash(const Vec4i& p_i) const
+private:
+	// Returns index into cells, or -1 if there is no cell with the given coordinates.
+	inline int findCellIndex(int x, int y, int z) const
 	{
-		// NOTE: technically possible undefined behaviour here (signed overflow)
+		unsigned int i = computeHash(x, y, z);
+		while(1)
+		{
+			const HashedObGridCell& cell = cells[i];
+			if(cell.num_obs == 0)
+				return -1;
+			if(cell.x == x && cell.y == y && cell.z == z)
+				return (int)i;
+			i = (i + 1) & hash_mask;
+		}
+	}
 
-		//unsigned int u[4];
-		//storeVec4i(p_i, u);
+	unsigned int insertNewCell(int x, int y, int z); // Returns index of new cell in cells.
+	void removeCell(unsigned int cell_i);
+	void expandTable();
 
-		return ((p_i[0] * 73856093) ^ (p_i[1] * 19349663) ^ (p_i[2] * 83492791)) & hash_mask;
-	}
+	uint32 allocBlock(uint32 size_class);
+	void freeBlock(uint32 offset, uint32 size_class);
 
-	inline unsigned int computeHash(int x, int y, int z) const
-	{
-		// NOTE: technically possible undefined behaviour here (signed overflow)
+	float cell_w;
+	float recip_cell_w;
 
-		return ((x * 73856093) ^ (y * 19349663) ^ (z * 83492791)) & hash_mask;
-	}
+	std::vector<HashedObGridCell> cells; // Open-addressed table of non-empty cells.  Size is a power of 2.
+	uint32 hash_mask; // hash_mask = cells.size() - 1;
+	size_t num_cells; // Number of used entries in cells.
 
+	std::vector<WorldObjectRef> ob_slots; // Storage for per-cell object arrays.
+	static const int NUM_SIZE_CLASSES = 32;
+	std::vector<uint32> free_blocks[NUM_SIZE_CLASSES]; // Offsets of unused blocks in ob_slots, for each size class.
 
-	float recip_cell_w;
-	float cell_w;
-	std::vector<HashedObGridBucket> buckets;
-	uint32 hash_mask; // hash_mask = buckets_size - 1;
+	size_t num_obs;
 };
@@ -0,0 +1,138 @@
+/*=====================================================================
+IndexedPriorityHeap.h
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <utils/Platform.h>
+#include <vector>
+#include <cassert>
+
+
+/*=====================================================================
+IndexedPriorityHeap
+-------------------
+Binary min-heap of item pointers, ordered by item->priority (smallest first).
+
+Each item stores its current index in the heap in item->heap_index, so the
+priority of an item already in the heap can be changed in O(log n) time with
+priorityChanged().
+
+T must have members
+	float priority;
+	size_t heap_index;
+
+Does not own the items.  Not threadsafe.
+=====================================================================*/
+template <class T>
+class IndexedPriorityHeap
+{
+public:
+	size_t size() const { return heap.size(); }
+	bool empty() const { return heap.empty(); }
+
+	T* top() const { assert(!heap.empty()); return heap[0]; }
+
+	// item->priority should be set.  O(log n).
+	void insert(T* item)
+	{
+		item->heap_index = heap.size();
+		heap.push_back(item);
+		siftUp(item->heap_index);
+	}
+
+	// Removes and returns the item with the smallest priority.  O(log n).
+	T* popTop()
+	{
+		assert(!heap.empty());
+		T* top_item = heap[0];
+		T* last = heap.back();
+		heap.pop_back();
+		if(!heap.empty())
+		{
+			heap[0] = last;
+			last->heap_index = 0;
+			siftDown(0);
+		}
+		return top_item;
+	}
+
+	// Call after changing the priority of an item in the heap.  O(log n).
+	void priorityChanged(T* item)
+	{
+		assert(item->heap_index < heap.size() && heap[item->heap_index] == item);
+		siftUp(item->heap_index);
+		siftDown(item->heap_index);
+	}
+
+	// Restores the heap property after the priorities of many items have changed.  O(n).
+	void rebuild()
+	{
+		for(size_t i=0; i<heap.size(); ++i)
+			heap[i]->heap_index = i;
+		if(heap.size() >= 2)
+			for(size_t i = heap.size() / 2; i-- > 0; )
+				siftDown(i);
+	}
+
+	void clear() { heap.clear(); }
+
+	// Items in heap order (not sorted order).  The priorities may be modified as long as rebuild() is called afterwards.
+	T* const* begin() const { return heap.data(); }
+	T* const* end() const { return heap.data() + heap.size(); }
+
+	// For testing
+	bool isValidHeap() const
+	{
+		for(size_t i=0; i<heap.size(); ++i)
+		{
+			if(heap[i]->heap_index != i)
+				return false;
+			if(i > 0 && heap[i]->priority < heap[(i - 1) / 2]->priority)
+				return false;
+		}
+		return true;
+	}
+
+private:
+	void siftUp(size_t i)
+	{
+		T* item = heap[i];
+		while(i > 0)
+		{
+			const size_t parent = (i - 1) / 2;
+			if(!(item->priority < heap[parent]->priority))
+				break;
+			heap[i] = heap[parent];
+			heap[i]->heap_index = i;
+			i = parent;
+		}
+		heap[i] = item;
+		item->heap_index = i;
+	}
+
+	void siftDown(size_t i)
+	{
+		const size_t N = heap.size();
+		T* item = heap[i];
+		while(true)
+		{
+			size_t child = 2 * i + 1;
+			if(child >= N)
+				break;
+			if(child + 1 < N && heap[child + 1]->priority < heap[child]->priority)
+				child++;
+			if(!(heap[child]->priority < item->priority))
+				break;
+			heap[i] = heap[child];
+			heap[i]->heap_index = i;
+			i = child;
+		}
+		heap[i] = item;
+		item->heap_index = i;
+	}
+
+	std::vector<T*> heap;
+};
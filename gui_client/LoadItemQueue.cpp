@@ -17,13 +17,19 @@ Copyright Glare Technologies Limited 2024 -
 #include <algorithm>
 
 
+const float LoadItemQueue::REPRIORITISE_CAM_MOVE_DIST = 2.f;
+
+
 LoadItemQueue::LoadItemQueue()
-:	begin_i(0)
+:	priority_campos(0, 0, 0),
+	priority_campos_valid(false)
 {}
 
 
 LoadItemQueue::~LoadItemQueue()
-{}
+{
+	clear();
+}
 
 
 void LoadItemQueue::enqueueItem(const URLString& key, const WorldObject& ob, const glare::TaskRef& task, float task_max_dist)
@@ -58,8 +64,9 @@ void LoadItemQueue::enqueueItem(const URLString& key, const Vec4f& pos, float si
 	item->key = key;
 	item->task = task;
 	item->task_max_dist = task_max_dist;
+	item->priority = item->computePriority(Vec4f(priority_campos.x, priority_campos.y, priority_campos.z, 0.f));
 
-	items.push_back(item);
+	heap.insert(item);
 
 	item_map.insert(std::make_pair(key, item));
 }
@@ -97,103 +104,70 @@ void LoadItemQueue::checkUpdateItemPosition(const URLString& key, const Vec4f& p
 		new_pos_info.pos = Vec3f(pos);
 		new_pos_info.size_factor = size_factor;
 		existing_item->pos_info.push_back(new_pos_info);
+
+		// The item priority is the min over positions, so adding a position can only decrease it.
+		const Vec4f campos_zero_w(priority_campos.x, priority_campos.y, priority_campos.z, 0.f);
+		const float new_pos_priority = campos_zero_w.getDist(maskWToZero(pos)) * size_factor;
+		if(new_pos_priority < existing_item->priority)
+		{
+			existing_item->priority = new_pos_priority;
+			heap.priorityChanged(existing_item);
+		}
 	}
 }
 
 
 size_t LoadItemQueue::size() const
 {
-	return items.size() - begin_i;
+	return heap.size();
 }
 
 
 void LoadItemQueue::clear()
 {
-	for(size_t i = begin_i; i < items.size(); ++i)
-		delete items[i];
+	for(LoadItemQueueItem* item : heap)
+		delete item;
 
-	begin_i = 0;
-	items.clear();
+	heap.clear();
 	item_map.clear();
 }
 
 
-struct QueueItemDistComparator
+void LoadItemQueue::updatePriorities(const Vec3d& campos_)
 {
-	bool operator () (const LoadItemQueueItem* a, const LoadItemQueueItem* b)
-	{
-		return a->priority < b->priority;
-	}
-};
+	const Vec3f campos((float)campos_.x, (float)campos_.y, (float)campos_.z);
 
+	// Item priorities change by at most (camera move distance * size_factor), so while the camera stays close to where the priorities
+	// were computed, the order is approximately correct and we don't need to touch every item.
+	if(priority_campos_valid && campos.getDist(priority_campos) < REPRIORITISE_CAM_MOVE_DIST)
+		return;
 
-void LoadItemQueue::sortQueue(const Vec3d& campos_) // Sort queue
-{
-	// Sort items into ascending order of priority: roughly distance from camera
-	
-	const Vec4f campos_zero_w((float)campos_.x, (float)campos_.y, (float)campos_.z, 0.f);
+	priority_campos = campos;
+	priority_campos_valid = true;
 
 	Timer timer;
 
-	// Do pass over queue items to compute priority, store and use that for sorting.
-	const size_t items_size = items.size();
-	for(size_t i = begin_i; i < items_size; ++i)
-	{
-		SmallVector<LoadItemQueuePosInfo, 4>& pos_info = items[i]->pos_info;
-		assert(pos_info.size() >= 1);
-		float smallest_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[0].pos.x))) * pos_info[0].size_factor;
-		for(size_t z=1; z<pos_info.size(); ++z)
-		{
-			const float pos_info_z_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[z].pos.x))) * pos_info[z].size_factor;
-			smallest_priority = myMin(smallest_priority, pos_info_z_priority);
-		}
+	const Vec4f campos_zero_w(campos.x, campos.y, campos.z, 0.f);
+	for(LoadItemQueueItem* item : heap)
+		item->priority = item->computePriority(campos_zero_w);
 
-		items[i]->priority = smallest_priority;
-	}
+	heap.rebuild();
 
-	QueueItemDistComparator comparator;
-	std::sort(items.begin() + begin_i, items.end(), comparator);
-
-	//conPrint("\n!!!!Sorting load item queue (" + toString(items.size() - begin_i) + " items) took " + timer.elapsedStringNSigFigs(4));
-
-	/*
-	If the unused space at the start of the array gets too large, copy items back to the start of the array, and trim off the end.
-	                 begin_i                    end
-	---------------------------------------------
-	   unused          |         data           |
-	---------------------------------------------
-	
-	|
-	v
-
-	begin_i                  end
-	--------------------------
-	|         data           |
-	--------------------------
-	
-	*/
-	if(begin_i > 1000)
-	{
-		//conPrint("LoadItemQueue::sortQueue(): copying backwards (begin_i: " + toString(begin_i) + ")");
-		for(size_t i = begin_i; i < items_size; ++i)
-			items[i - begin_i] = items[i];
-		items.resize(items.size() - begin_i);
-		begin_i = 0;
-	}
+	//conPrint("\n!!!!Updating load item queue priorities (" + toString(heap.size()) + " items) took " + timer.elapsedStringNSigFigs(4));
 }
 
 
 void LoadItemQueue::dequeueFront(LoadItemQueueItem& item_out)
 {
-	assert(begin_i < items.size());
+	assert(!heap.empty());
+
+	LoadItemQueueItem* item = heap.popTop();
 
-	item_map.erase(items[begin_i]->key);
+	item_map.erase(item->key);
 
-	item_out = *items[begin_i]; // Copy to item_out
+	item_out = *item; // Copy to item_out
 
-	delete items[begin_i];
-	items[begin_i] = NULL;
-	begin_i++;
+	delete item;
 }
 
 
@@ -205,3 +179,180 @@ float LoadItemQueueItem::getDistanceToCamera(const Vec4f& cam_pos_) const
 		smallest_dist = myMin(smallest_dist, maskWToZero(loadUnalignedVec4f(&pos_info[i].pos.x)).getDist(cam_pos_zero_w));
 	return smallest_dist;
 }
+
+
+float LoadItemQueueItem::computePriority(const Vec4f& campos_zero_w) const
+{
+	assert(pos_info.size() >= 1);
+	float smallest_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[0].pos.x))) * pos_info[0].size_factor;
+	for(size_t z=1; z<pos_info.size(); ++z)
+	{
+		const float pos_info_z_priority = campos_zero_w.getDist(maskWToZero(loadUnalignedVec4f(&pos_info[z].pos.x))) * pos_info[z].size_factor;
+		smallest_priority = myMin(smallest_priority, pos_info_z_priority);
+	}
+	return smallest_priority;
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <maths/PCG32.h>
+
+
+static void checkDequeueOrder(LoadItemQueue& queue, const Vec3f& campos)
+{
+	const Vec4f campos_zero_w(campos.x, campos.y, campos.z, 0.f);
+	float last_priority = -1;
+	while(!queue.empty())
+	{
+		LoadItemQueueItem item;
+		queue.dequeueFront(item);
+		const float priority = item.computePriority(campos_zero_w);
+		testAssert(item.priority == priority);
+		testAssert(priority >= last_priority);
+		last_priority = priority;
+	}
+}
+
+
+void LoadItemQueue::test()
+{
+	conPrint("LoadItemQueue::test()");
+
+	//------------------------- Basic tests -------------------------
+	{
+		LoadItemQueue queue;
+		queue.enqueueItem(URLString("a"), Vec4f(10, 0, 0, 1), /*size_factor=*/1.f, /*task=*/NULL, /*task_max_dist=*/1000.f);
+		queue.enqueueItem(URLString("b"), Vec4f(20, 0, 0, 1), /*size_factor=*/1.f, /*task=*/NULL, /*task_max_dist=*/1000.f);
+		queue.enqueueItem(URLString("c"), Vec4f(30, 0, 0, 1), /*size_factor=*/1.f, /*task=*/NULL, /*task_max_dist=*/1000.f);
+		testAssert(queue.size() == 3);
+
+		queue.updatePriorities(Vec3d(0, 0, 0));
+
+		// Adding a closer position for c should move it to the front.
+		queue.checkUpdateItemPosition(URLString("c"), Vec4f(5, 0, 0, 1), /*size_factor=*/1.f);
+		// Adding a further position for a shouldn't change its priority.
+		queue.checkUpdateItemPosition(URLString("a"), Vec4f(100, 0, 0, 1), /*size_factor=*/1.f);
+		// Updating a key not in the queue should do nothing.
+		queue.checkUpdateItemPosition(URLString("d"), Vec4f(1, 0, 0, 1), /*size_factor=*/1.f);
+
+		LoadItemQueueItem item;
+		queue.dequeueFront(item);
+		testAssert(item.key == URLString("c"));
+		testAssert(item.pos_info.size() == 2);
+		queue.dequeueFront(item);
+		testAssert(item.key == URLString("a"));
+		testAssert(queue.size() == 1);
+
+		// Moving the camera a long way should reprioritise.
+		queue.enqueueItem(URLString("e"), Vec4f(-10, 0, 0, 1), /*size_factor=*/1.f, /*task=*/NULL, /*task_max_dist=*/1000.f);
+		queue.updatePriorities(Vec3d(25, 0, 0));
+		queue.dequeueFront(item);
+		testAssert(item.key == URLString("b"));
+		queue.dequeueFront(item);
+		testAssert(item.key == URLString("e"));
+		testAssert(queue.empty());
+	}
+
+	//------------------------- Randomised test -------------------------
+	{
+		PCG32 rng(1);
+		LoadItemQueue queue;
+		const int N = 2000;
+		for(int i=0; i<N; ++i)
+		{
+			const Vec4f pos(-500 + rng.unitRandom() * 1000, -500 + rng.unitRandom() * 1000, rng.unitRandom() * 50, 1);
+			const float size_factor = LoadItemQueueItem::sizeFactorForAABBWS(rng.unitRandom() * 20, /*importance_factor=*/1.f);
+			queue.enqueueItem(toURLString("item_" + toString(i)), pos, size_factor, /*task=*/NULL, /*task_max_dist=*/1000.f);
+
+			if(i % 3 == 0)
+			{
+				const int other = (int)rng.nextUInt(i + 1);
+				const Vec4f other_pos(-500 + rng.unitRandom() * 1000, -500 + rng.unitRandom() * 1000, rng.unitRandom() * 50, 1);
+				queue.checkUpdateItemPosition(toURLString("item_" + toString(other)), other_pos, size_factor);
+			}
+
+			if(i % 500 == 0)
+				queue.updatePriorities(Vec3d(-500 + rng.unitRandom() * 1000, -500 + rng.unitRandom() * 1000, 0));
+
+			testAssert(queue.heap.isValidHeap());
+		}
+		testAssert(queue.size() == N);
+
+		const Vec3f campos(100, 200, 0);
+		queue.updatePriorities(Vec3d(campos.x, campos.y, campos.z));
+
+		// A small camera move shouldn't recompute priorities.
+		queue.updatePriorities(Vec3d(campos.x + 0.5f * REPRIORITISE_CAM_MOVE_DIST, campos.y, campos.z));
+		testAssert(queue.heap.isValidHeap());
+
+		checkDequeueOrder(queue, campos);
+	}
+
+	//------------------------- Perf test: compare against sorting the whole queue -------------------------
+	{
+		const int N = 50000;
+		PCG32 rng(1);
+		LoadItemQueue queue;
+		std::vector<LoadItemQueueItem*> sort_items; // Items for the previous approach: recompute priorities and std::sort all items.
+		for(int i=0; i<N; ++i)
+		{
+			const Vec4f pos(-2000 + rng.unitRandom() * 4000, -2000 + rng.unitRandom() * 4000, rng.unitRandom() * 50, 1);
+			const float size_factor = LoadItemQueueItem::sizeFactorForAABBWS(rng.unitRandom() * 20, /*importance_factor=*/1.f);
+			const URLString key = toURLString("item_" + toString(i));
+			queue.enqueueItem(key, pos, size_factor, /*task=*/NULL, /*task_max_dist=*/1000.f);
+
+			LoadItemQueueItem* item = new LoadItemQueueItem();
+			item->pos_info.resize(1);
+			item->pos_info[0].pos = Vec3f(pos);
+			item->pos_info[0].size_factor = size_factor;
+			item->key = key;
+			sort_items.push_back(item);
+		}
+
+		// Simulate walking: the camera moves 0.5 m between each update.
+		const int num_updates = 100;
+		{
+			Timer timer;
+			for(int z=0; z<num_updates; ++z)
+			{
+				const Vec4f campos_zero_w(z * 0.5f, 0, 0, 0);
+				for(size_t i=0; i<sort_items.size(); ++i)
+					sort_items[i]->priority = sort_items[i]->computePriority(campos_zero_w);
+				std::sort(sort_items.begin(), sort_items.end(), [](const LoadItemQueueItem* a, const LoadItemQueueItem* b) { return a->priority < b->priority; });
+			}
+			conPrint("Full sort:           " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_updates, 4) + " ms per update (" + toString(N) + " items)");
+		}
+		{
+			Timer timer;
+			for(int z=0; z<num_updates; ++z)
+				queue.updatePriorities(Vec3d(z * 0.5f, 0, 0));
+			conPrint("updatePriorities():  " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_updates, 4) + " ms per update (" + toString(N) + " items)");
+		}
+		{
+			// Teleport: every update needs a full reprioritisation.
+			Timer timer;
+			for(int z=0; z<num_updates; ++z)
+				queue.updatePriorities(Vec3d(z * 100.f, 0, 0));
+			conPrint("updatePriorities() with full reprioritisation: " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_updates, 4) + " ms per update (" + toString(N) + " items)");
+		}
+		{
+			Timer timer;
+			LoadItemQueueItem item;
+			for(int i=0; i<N; ++i)
+				queue.dequeueFront(item);
+			conPrint("dequeueFront():      " + doubleToStringNSigFigs(timer.elapsed() * 1.0e9 / N, 4) + " ns per item");
+			testAssert(queue.empty());
+		}
+
+		for(size_t i=0; i<sort_items.size(); ++i)
+			delete sort_items[i];
+	}
+
+	conPrint("LoadItemQueue::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -6,6 +6,7 @@ Copyright Glare Technologies Limited 2024 -
 #pragma once
 
 
+#include "IndexedPriorityHeap.h"
 #include "../shared/URLString.h"
 #include <physics/jscol_aabbox.h>
 #include <maths/Vec4.h>
@@ -46,12 +47,15 @@ struct LoadItemQueueItem
 
 	float getDistanceToCamera(const Vec4f& cam_pos_) const; // Get distance from camera to closest position stored in pos_info.
 
+	float computePriority(const Vec4f& campos_zero_w) const; // Smallest distance * size_factor over pos_info.
+
 	SmallVector<LoadItemQueuePosInfo, 4> pos_info; // Store multiple positions and size factors, since multiple different objects may be using the same resource.
 	URLString key;
 	float task_max_dist; // Max distance from camera before task should be discarded.
 	glare::TaskRef task;
 	
-	float priority;
+	float priority; // Smaller values are loaded first.
+	size_t heap_index; // Index in LoadItemQueue heap.
 };
 
 
@@ -59,7 +63,13 @@ struct LoadItemQueueItem
 LoadItemQueue
 -------------
 Queue of load model tasks, load texture tasks etc, together with the position of the item,
-which is used for sorting the tasks based on distance from the camera.
+which is used for prioritising the tasks based on distance from the camera.
+
+Items are kept in an indexed binary heap ordered by priority, so enqueueing and dequeueing are
+O(log n), and adding a position to an existing item only moves that item in the heap.
+Priorities are computed with the camera position passed to the last updatePriorities() call.
+All priorities are only recomputed (and the heap rebuilt in O(n)) when the camera has moved
+more than REPRIORITISE_CAM_MOVE_DIST since then.
 =====================================================================*/
 class LoadItemQueue
 {
@@ -83,13 +93,18 @@ public:
 
 	size_t size() const;
 
-	void sortQueue(const Vec3d& campos); // Sort queue (approximately by item distance to camera)
+	void updatePriorities(const Vec3d& campos); // Recompute item priorities if the camera has moved far enough since they were last computed.
+
+	void dequeueFront(LoadItemQueueItem& item_out); // Dequeue the item with the smallest priority value.
 
-	void dequeueFront(LoadItemQueueItem& item_out);
+	static const float REPRIORITISE_CAM_MOVE_DIST;
+
+	static void test();
 private:
-	// Valid items are at indices [begin_i, items.size())
-	size_t begin_i;
-	js::Vector<LoadItemQueueItem*, 16> items;
+	IndexedPriorityHeap<LoadItemQueueItem> heap;
 
 	std::unordered_map<URLString, LoadItemQueueItem*, URLStringHasher> item_map; // Map from key to pointer to LoadItemQueueItem.
+
+	Vec3f priority_campos; // Camera position that item priorities were computed with.
+	bool priority_campos_valid;
 };
@@ -9,6 +9,11 @@ Copyright Glare Technologies Limited 2025 -
 #include "LoadTextureTask.h"
 #include "ThreadMessages.h"
 #include "ModelLoading.h"
+#include "PhysicsShapeCache.h"
+#include "VoxelMeshCache.h"
+#include "PhysicsWorld.h"
+#include "../shared/JoltShapeBuilding.h"
+#include "../shared/VoxelMeshBuilding.h"
 #include "../shared/ResourceManager.h"
 #include <opengl/OpenGLEngine.h>
 #include <opengl/OpenGLMeshRenderData.h>
@@ -57,22 +62,35 @@ void LoadModelTask::run(size_t thread_index)
 
 				assert(compressed_voxels->size() > 0);
 
-				VoxelGroup voxel_group;
-				voxel_group.voxels.setAllocator(worker_allocator);
-				WorldObject::decompressVoxelGroup(compressed_voxels->data(), compressed_voxels->size(), worker_allocator.ptr(), /*decompressed group out=*/voxel_group);
+				// If we have a cached mesh for this voxel data, use it, so we don't need to decompress and mesh the voxels.
+				Reference<Indigo::Mesh> voxel_mesh;
+				if(voxel_mesh_cache)
+					voxel_mesh = voxel_mesh_cache->tryLoadMesh(voxel_hash, model_lod_level, mat_transparent, /*subsample_factor_out=*/subsample_factor);
 
-				const int max_model_lod_level = (voxel_group.voxels.size() > 256) ? 2 : 0;
-				const int use_model_lod_level = myMin(model_lod_level, max_model_lod_level);
+				if(!voxel_mesh)
+				{
+					VoxelGroup voxel_group;
+					voxel_group.voxels.setAllocator(worker_allocator);
+					WorldObject::decompressVoxelGroup(compressed_voxels->data(), compressed_voxels->size(), worker_allocator.ptr(), /*decompressed group out=*/voxel_group);
+
+					const int max_model_lod_level = (voxel_group.voxels.size() > 256) ? 2 : 0;
+					const int use_model_lod_level = myMin(model_lod_level, max_model_lod_level);
+
+					if(use_model_lod_level == 1)
+						subsample_factor = 2;
+					else if(use_model_lod_level == 2)
+						subsample_factor = 4;
 
-				if(use_model_lod_level == 1)
-					subsample_factor = 2;
-				else if(use_model_lod_level == 2)
-					subsample_factor = 4;
+					// conPrint("Loading vox model for ob with UID " + voxel_ob->uid.toString() + " for LOD level " + toString(use_model_lod_level) + ", using subsample_factor " + toString(subsample_factor) + ", " + toString(voxel_group.voxels.size()) + " voxels");
 
-				// conPrint("Loading vox model for ob with UID " + voxel_ob->uid.toString() + " for LOD level " + toString(use_model_lod_level) + ", using subsample_factor " + toString(subsample_factor) + ", " + toString(voxel_group.voxels.size()) + " voxels");
+					voxel_mesh = VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(voxel_group, subsample_factor, mat_transparent, worker_allocator.ptr());
 
-				gl_meshdata = ModelLoading::makeModelForVoxelGroup(voxel_group, subsample_factor, ob_to_world_matrix, /*vert_buf_allocator=*/NULL, /*do_opengl_stuff=*/false, 
-					need_lightmap_uvs, mat_transparent, build_dynamic_physics_ob, worker_allocator.ptr(), /*physics shape out=*/physics_shape);
+					if(voxel_mesh_cache)
+						voxel_mesh_cache->storeMesh(voxel_hash, model_lod_level, mat_transparent, subsample_factor, *voxel_mesh);
+				}
+
+				gl_meshdata = ModelLoading::makeModelForVoxelMesh(*voxel_mesh, ob_to_world_matrix, /*vert_buf_allocator=*/NULL, /*do_opengl_stuff=*/false, 
+					need_lightmap_uvs, build_dynamic_physics_ob, worker_allocator.ptr(), /*physics shape out=*/physics_shape);
 			}
 			else // Else not voxel ob, just loading a model:
 			{
@@ -155,15 +173,40 @@ void LoadModelTask::run(size_t thread_index)
 				{
 					js::Vector<bool> create_tris_for_mat;
 
+					// If we have a cached physics shape for this model, use it instead of building a new one.
+					bool loaded_physics_shape = build_physics_ob && physics_shape_cache && physics_shape_cache->tryLoadShape(lod_model_url, build_dynamic_physics_ob, physics_shape);
+
+					// Otherwise if we have downloaded a physics shape built by the server, use that.
+					if(build_physics_ob && !loaded_physics_shape && !physics_shape_url.empty() && resource_manager->isFileForURLPresent(physics_shape_url))
+					{
+						try
+						{
+							physics_shape.jolt_shape = JoltShapeBuilding::readShapeResourceFromDisk(resource_manager->pathForURLForPresentResource(physics_shape_url));
+							physics_shape.size_B = PhysicsWorld::computeSizeBForShape(physics_shape.jolt_shape);
+							loaded_physics_shape = true;
+
+							if(physics_shape_cache)
+								physics_shape_cache->storeShape(lod_model_url, build_dynamic_physics_ob, physics_shape);
+						}
+						catch(glare::Exception& e)
+						{
+							// May have been built with a different Jolt version.  Just build the shape ourselves.
+							conPrint("LoadModelTask: failed to read physics shape '" + toStdString(physics_shape_url) + "', building shape instead: " + e.what());
+						}
+					}
+
 					gl_meshdata = ModelLoading::makeGLMeshDataAndPhysicsShape(lod_model_path,
 						model_buffer,
 						/*vert_buf_allocator=*/NULL, 
 						true, // skip_opengl_calls - we need to do these on the main thread.
-						build_physics_ob,
+						build_physics_ob && !loaded_physics_shape,
 						build_dynamic_physics_ob,
 						create_tris_for_mat,
 						worker_allocator.ptr(),
 						/*physics shape out=*/physics_shape);
+
+					if(build_physics_ob && !loaded_physics_shape && physics_shape_cache)
+						physics_shape_cache->storeShape(lod_model_url, build_dynamic_physics_ob, physics_shape);
 				}
 			}
 
@@ -20,6 +20,8 @@ Copyright Glare Technologies Limited 2025 -
 class OpenGLEngine;
 class ResourceManager;
 class GaussianSplatData;
+class PhysicsShapeCache;
+class VoxelMeshCache;
 
 
 class ModelLoadedThreadMessage : public ThreadMessage
@@ -105,6 +107,9 @@ public:
 
 	Reference<OpenGLEngine> opengl_engine;
 	Reference<ResourceManager> resource_manager;
+	Reference<PhysicsShapeCache> physics_shape_cache; // May be null.  If non-null, cooked physics shapes for models are loaded from and stored to this cache.
+	URLString physics_shape_url; // URL of a physics shape built by the server for this model.  Used instead of building the shape if it has been downloaded.  May be empty.
+	Reference<VoxelMeshCache> voxel_mesh_cache; // May be null.  If non-null, meshes for voxel groups are loaded from and stored to this cache, keyed by voxel_hash.
 	ThreadSafeQueue<Reference<ThreadMessage> >* result_msg_queue;
 
 	Reference<glare::Allocator> worker_allocator;
@@ -1655,6 +1655,19 @@ static Reference<OpenGLMeshRenderData> buildVoxelOpenGLMeshData(const Indigo::Me
 
 Reference<OpenGLMeshRenderData> ModelLoading::makeModelForVoxelGroup(const VoxelGroup& voxel_group, int subsample_factor, const Matrix4f& ob_to_world, 
 	VertexBufferAllocator* vert_buf_allocator, bool do_opengl_stuff, bool need_lightmap_uvs, const js::Vector<bool, 16>& mats_transparent, bool build_dynamic_physics_ob, 
+	glare::Allocator* mem_allocator, PhysicsShape& physics_shape_out, glare::TaskManager* task_manager)
+{
+	ZoneScoped; // Tracy profiler
+
+	Indigo::MeshRef indigo_mesh = VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(voxel_group, subsample_factor, mats_transparent, mem_allocator, task_manager);
+	// We will compute geometric normals in the opengl shader, so don't need to compute them here.
+
+	return makeModelForVoxelMesh(*indigo_mesh, ob_to_world, vert_buf_allocator, do_opengl_stuff, need_lightmap_uvs, build_dynamic_physics_ob, mem_allocator, physics_shape_out);
+}
+
+
+Reference<OpenGLMeshRenderData> ModelLoading::makeModelForVoxelMesh(Indigo::Mesh& indigo_mesh, const Matrix4f& ob_to_world, 
+	VertexBufferAllocator* vert_buf_allocator, bool do_opengl_stuff, bool need_lightmap_uvs, bool build_dynamic_physics_ob, 
 	glare::Allocator* mem_allocator, PhysicsShape& physics_shape_out)
 {
 	ZoneScoped; // Tracy profiler
@@ -1662,28 +1675,25 @@ Reference<OpenGLMeshRenderData> ModelLoading::makeModelForVoxelGroup(const Voxel
 	// Timer timer;
 	StandardPrintOutput print_output;
 
-	Indigo::MeshRef indigo_mesh = VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(voxel_group, subsample_factor, mats_transparent, mem_allocator);
-	// We will compute geometric normals in the opengl shader, so don't need to compute them here.
-
 	if(need_lightmap_uvs)
 	{
 		// UV unwrap it:
 		const js::AABBox aabb_os(
-			Vec4f(indigo_mesh->aabb_os.bound[0].x, indigo_mesh->aabb_os.bound[0].y, indigo_mesh->aabb_os.bound[0].z, 1.f),
-			Vec4f(indigo_mesh->aabb_os.bound[1].x, indigo_mesh->aabb_os.bound[1].y, indigo_mesh->aabb_os.bound[1].z, 1.f)
+			Vec4f(indigo_mesh.aabb_os.bound[0].x, indigo_mesh.aabb_os.bound[0].y, indigo_mesh.aabb_os.bound[0].z, 1.f),
+			Vec4f(indigo_mesh.aabb_os.bound[1].x, indigo_mesh.aabb_os.bound[1].y, indigo_mesh.aabb_os.bound[1].z, 1.f)
 		);
 		const js::AABBox aabb_ws = aabb_os.transformedAABB(ob_to_world);
 
 		const int clamped_side_res = WorldObject::getLightMapSideResForAABBWS(aabb_ws);
 
 		const float normed_margin = 2.f / clamped_side_res;
-		UVUnwrapper::build(*indigo_mesh, ob_to_world, print_output, normed_margin); // Adds UV set to indigo_mesh.
+		UVUnwrapper::build(indigo_mesh, ob_to_world, print_output, normed_margin); // Adds UV set to indigo_mesh.
 	}
 
 	// Convert Indigo mesh to opengl data
-	Reference<OpenGLMeshRenderData> mesh_data = buildVoxelOpenGLMeshData(*indigo_mesh, mem_allocator);
+	Reference<OpenGLMeshRenderData> mesh_data = buildVoxelOpenGLMeshData(indigo_mesh, mem_allocator);
 
-	physics_shape_out = PhysicsWorld::createJoltShapeForIndigoMesh(*indigo_mesh, build_dynamic_physics_ob, mem_allocator);
+	physics_shape_out = PhysicsWorld::createJoltShapeForIndigoMesh(indigo_mesh, build_dynamic_physics_ob, mem_allocator);
 
 	// Load rendering data into GPU mem if requested.
 	if(do_opengl_stuff)
@@ -1714,7 +1724,7 @@ Reference<OpenGLMeshRenderData> ModelLoading::makeModelForVoxelGroup(const Voxel
 		mesh_data->vert_index_buffer_uint8.clearAndFreeMem();
 	}
 
-	// conPrint("ModelLoading::makeModelForVoxelGroup for " + toString(voxel_group.voxels.size()) + " voxels took " + timer.elapsedString());
+	// conPrint("ModelLoading::makeModelForVoxelMesh took " + timer.elapsedString());
 	return mesh_data;
 }
 
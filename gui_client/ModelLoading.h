@@ -23,6 +23,7 @@ class PhysicsShape;
 class VoxelGroup;
 class VertexBufferAllocator;
 namespace Indigo { class TaskManager; }
+namespace glare { class TaskManager; }
 
 
 /*=====================================================================
@@ -99,9 +100,18 @@ public:
 		PhysicsShape& physics_shape_out);
 
 	// Build OpenGLMeshRenderData from voxel data.  Also return a reference to a physics shape.
+	// If task_manager is non-null, large voxel groups are meshed in parallel using it.
 	static Reference<OpenGLMeshRenderData> makeModelForVoxelGroup(const VoxelGroup& voxel_group, int subsample_factor, const Matrix4f& ob_to_world, 
 		VertexBufferAllocator* vert_buf_allocator, bool do_opengl_stuff, bool need_lightmap_uvs, const js::Vector<bool, 16>& mats_transparent, bool build_dynamic_physics_ob,
 		glare::Allocator* mem_allocator,
+		PhysicsShape& physics_shape_out,
+		glare::TaskManager* task_manager = nullptr);
+
+	// Build OpenGLMeshRenderData and a physics shape from a mesh made by VoxelMeshBuilding::makeIndigoMeshForVoxelGroup().
+	// Adds a UV set to voxel_mesh if need_lightmap_uvs is true.
+	static Reference<OpenGLMeshRenderData> makeModelForVoxelMesh(Indigo::Mesh& voxel_mesh, const Matrix4f& ob_to_world, 
+		VertexBufferAllocator* vert_buf_allocator, bool do_opengl_stuff, bool need_lightmap_uvs, bool build_dynamic_physics_ob,
+		glare::Allocator* mem_allocator,
 		PhysicsShape& physics_shape_out);
 
 	//static Reference<BatchedMesh> makeBatchedMeshForVoxelGroup(const VoxelGroup& voxel_group);
@@ -0,0 +1,355 @@
+/*=====================================================================
+ObjectLODEvaluator.cpp
+----------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ObjectLODEvaluator.h"
+
+
+#include <utils/TaskManager.h>
+#include <utils/BitUtils.h>
+#include <maths/mathstypes.h>
+#include <tracy/Tracy.hpp>
+#include <smmintrin.h>
+
+
+// Number of objects gathered into the SoA arrays at a time.  Should be a multiple of 4.
+static const size_t LOD_EVAL_BLOCK_SIZE = 64;
+
+// Don't make tasks with fewer objects than this, the task overhead would outweigh the gains.
+static const size_t MIN_OBJECTS_PER_TASK = 4096;
+
+
+class ObjectLODEvaluationTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		changes.clear();
+		ObjectLODEvaluator::evaluateObjectRange(objects, begin, end, *params, changes);
+	}
+
+	const glare::FastIterMapValueInfo<UID, WorldObjectRef>* objects;
+	size_t begin, end;
+	const ObjectLODEvaluationParams* params;
+	std::vector<ObjectLODChange> changes; // Output
+};
+
+
+ObjectLODEvaluator::ObjectLODEvaluator()
+{}
+
+
+ObjectLODEvaluator::~ObjectLODEvaluator()
+{}
+
+
+void ObjectLODEvaluator::evaluateObjectRange(const glare::FastIterMapValueInfo<UID, WorldObjectRef>* objects, size_t begin, size_t end, const ObjectLODEvaluationParams& params,
+	std::vector<ObjectLODChange>& changes_out)
+{
+	// SoA arrays for the current block
+	alignas(16) float centroid_x[LOD_EVAL_BLOCK_SIZE];
+	alignas(16) float centroid_y[LOD_EVAL_BLOCK_SIZE];
+	alignas(16) float centroid_z[LOD_EVAL_BLOCK_SIZE];
+	alignas(16) float biased_aabb_len[LOD_EVAL_BLOCK_SIZE];
+	alignas(16) int32 cur_lod_level[LOD_EVAL_BLOCK_SIZE];
+	alignas(16) int32 cur_in_proximity[LOD_EVAL_BLOCK_SIZE]; // 0 or -1 (all bits set)
+	alignas(16) int32 exclude_from_lod_chunk[LOD_EVAL_BLOCK_SIZE]; // 0 or -1 (all bits set)
+	alignas(16) int32 new_lod_level[LOD_EVAL_BLOCK_SIZE];
+
+	const __m128 cam_x = _mm_set1_ps(params.cam_pos[0]);
+	const __m128 cam_y = _mm_set1_ps(params.cam_pos[1]);
+	const __m128 cam_z = _mm_set1_ps(params.cam_pos[2]);
+	const __m128 proj_len_viewable_threshold = _mm_set1_ps(params.proj_len_viewable_threshold);
+	const __m128 load_everything_distance2   = _mm_set1_ps(params.load_everything_distance2);
+	const __m128 lod_chunk_w                 = _mm_set1_ps(params.lod_chunk_w);
+	const __m128 lod_chunk_display_dist2     = _mm_set1_ps(Maths::square(params.lod_chunk_display_dist));
+	const __m128 lod_thresholds[3] = { _mm_set1_ps(0.6f), _mm_set1_ps(0.16f), _mm_set1_ps(0.03f) }; // See WorldObject::getLODLevel()
+
+	for(size_t block_begin = begin; block_begin < end; block_begin += LOD_EVAL_BLOCK_SIZE)
+	{
+		const size_t block_size = myMin(LOD_EVAL_BLOCK_SIZE, end - block_begin);
+		const size_t padded_block_size = Maths::roundUpToMultipleOfPowerOf2<size_t>(block_size, 4);
+
+		// Gather object data into the SoA arrays.  Centroid, biased AABB length, current LOD level etc. are all in the first cache line of the object.
+		for(size_t i=0; i<block_size; ++i)
+		{
+			if(i + 8 < block_size)
+				_mm_prefetch((const char*)(&objects[block_begin + i + 8].value->centroid_ws), _MM_HINT_T0);
+
+			const WorldObject* const ob = objects[block_begin + i].value.ptr();
+			centroid_x[i] = ob->centroid_ws[0];
+			centroid_y[i] = ob->centroid_ws[1];
+			centroid_z[i] = ob->centroid_ws[2];
+			biased_aabb_len[i] = ob->getBiasedAABBLength();
+			cur_lod_level[i] = ob->current_lod_level;
+			cur_in_proximity[i] = ob->in_proximity ? -1 : 0;
+			exclude_from_lod_chunk[i] = ob->exclude_from_lod_chunk_mesh ? -1 : 0;
+
+			assert(ob->exclude_from_lod_chunk_mesh == BitUtils::isBitSet(ob->flags, WorldObject::EXCLUDE_FROM_LOD_CHUNK_MESH));
+		}
+		// Pad to a multiple of 4.  Results for the padding are ignored.
+		for(size_t i=block_size; i<padded_block_size; ++i)
+		{
+			centroid_x[i] = centroid_y[i] = centroid_z[i] = 0;
+			biased_aabb_len[i] = 0;
+			cur_lod_level[i] = cur_in_proximity[i] = exclude_from_lod_chunk[i] = 0;
+		}
+
+		// Evaluate 4 objects at a time
+		for(size_t i=0; i<padded_block_size; i += 4)
+		{
+			const __m128 x = _mm_load_ps(centroid_x + i);
+			const __m128 y = _mm_load_ps(centroid_y + i);
+			const __m128 dx = _mm_sub_ps(x, cam_x);
+			const __m128 dy = _mm_sub_ps(y, cam_y);
+			const __m128 dz = _mm_sub_ps(_mm_load_ps(centroid_z + i), cam_z);
+			const __m128 cam_to_ob_d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+			const __m128 proj_len = _mm_mul_ps(_mm_load_ps(biased_aabb_len + i), _mm_rsqrt_ps(cam_to_ob_d2));
+
+			__m128 in_proximity = _mm_or_ps(_mm_cmpgt_ps(proj_len, proj_len_viewable_threshold), _mm_cmple_ps(cam_to_ob_d2, load_everything_distance2));
+
+			if(params.use_lod_chunks)
+			{
+				// If this object is in a chunk region, and we are displaying the chunk, then the object is not in proximity.  See shouldDisplayLODChunk() in GUIClient.cpp.
+				const __m128 half = _mm_set1_ps(0.5f);
+				const __m128 chunk_centre_x = _mm_mul_ps(_mm_add_ps(_mm_floor_ps(_mm_div_ps(x, lod_chunk_w)), half), lod_chunk_w);
+				const __m128 chunk_centre_y = _mm_mul_ps(_mm_add_ps(_mm_floor_ps(_mm_div_ps(y, lod_chunk_w)), half), lod_chunk_w);
+				const __m128 chunk_dx = _mm_sub_ps(chunk_centre_x, cam_x);
+				const __m128 chunk_dy = _mm_sub_ps(chunk_centre_y, cam_y);
+				const __m128 chunk_d2 = _mm_add_ps(_mm_mul_ps(chunk_dx, chunk_dx), _mm_mul_ps(chunk_dy, chunk_dy));
+				const __m128 display_chunk = _mm_cmpgt_ps(chunk_d2, lod_chunk_display_dist2);
+				const __m128 hidden_by_chunk = _mm_andnot_ps(_mm_castsi128_ps(_mm_load_si128((const __m128i*)(exclude_from_lod_chunk + i))), display_chunk);
+				in_proximity = _mm_andnot_ps(hidden_by_chunk, in_proximity);
+			}
+
+			// lod_level = -1 + number of thresholds that proj_len is not greater than.  Use not-greater-than comparisons so NaNs give the same result as WorldObject::getLODLevel().
+			__m128i lod_level = _mm_set1_epi32(-1);
+			for(int t=0; t<3; ++t)
+				lod_level = _mm_sub_epi32(lod_level, _mm_castps_si128(_mm_cmpngt_ps(proj_len, lod_thresholds[t]))); // Comparison results are -1 (all bits set) for true.
+			_mm_store_si128((__m128i*)(new_lod_level + i), lod_level);
+
+			// Object changed if in_proximity changed, or if it is in proximity and the LOD level changed.
+			const __m128i in_proximity_i = _mm_castps_si128(in_proximity);
+			const __m128i proximity_changed = _mm_xor_si128(in_proximity_i, _mm_load_si128((const __m128i*)(cur_in_proximity + i)));
+			const __m128i lod_changed = _mm_andnot_si128(_mm_cmpeq_epi32(lod_level, _mm_load_si128((const __m128i*)(cur_lod_level + i))), in_proximity_i);
+			int changed_mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(proximity_changed, lod_changed)));
+			if(i + 4 > block_size)
+				changed_mask &= (1 << (block_size - i)) - 1; // Ignore padding
+
+			const int in_proximity_mask = _mm_movemask_ps(in_proximity);
+			while(changed_mask != 0)
+			{
+				const int z = (int)BitUtils::lowestSetBitIndex((uint64)changed_mask);
+				changed_mask &= changed_mask - 1;
+
+				ObjectLODChange change;
+				change.ob = objects[block_begin + i + z].value.ptr();
+				change.lod_level = new_lod_level[i + z];
+				change.in_proximity = (in_proximity_mask & (1 << z)) != 0;
+				changes_out.push_back(change);
+			}
+		}
+	}
+}
+
+
+void ObjectLODEvaluator::evaluateObjects(const glare::FastIterMapValueInfo<UID, WorldObjectRef>* objects, size_t num_objects, const ObjectLODEvaluationParams& params,
+	glare::TaskManager* task_manager, std::vector<ObjectLODChange>& changes_out)
+{
+	ZoneScoped; // Tracy profiler
+
+	changes_out.clear();
+
+	const size_t num_tasks = task_manager ? myClamp<size_t>(num_objects / MIN_OBJECTS_PER_TASK, 1, task_manager->getConcurrency()) : 1;
+	if(num_tasks <= 1)
+	{
+		evaluateObjectRange(objects, 0, num_objects, params, changes_out);
+		return;
+	}
+
+	// Split objects into ranges, with range boundaries on block boundaries.
+	const size_t objects_per_task = Maths::roundUpToMultipleOfPowerOf2<size_t>(Maths::roundedUpDivide(num_objects, num_tasks), LOD_EVAL_BLOCK_SIZE);
+
+	Reference<glare::TaskGroup> task_group = new glare::TaskGroup();
+	for(size_t begin = 0; begin < num_objects; begin += objects_per_task)
+	{
+		const size_t task_i = task_group->tasks.size();
+		if(task_i >= tasks.size())
+			tasks.push_back(new ObjectLODEvaluationTask());
+
+		ObjectLODEvaluationTask* task = tasks[task_i].ptr();
+		task->objects = objects;
+		task->begin = begin;
+		task->end = myMin(begin + objects_per_task, num_objects);
+		task->params = &params;
+		task_group->tasks.push_back(task);
+	}
+
+	task_manager->runTaskGroup(task_group);
+
+	for(size_t i=0; i<task_group->tasks.size(); ++i)
+		changes_out.insert(changes_out.end(), tasks[i]->changes.begin(), tasks[i]->changes.end());
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Timer.h>
+#include <maths/PCG32.h>
+
+
+// Straightforward per-object evaluation, as previously done in GUIClient::checkForLODChanges(), for comparison.
+static void evaluateObjectsReference(const std::vector<WorldObjectRef>& obs, const ObjectLODEvaluationParams& params, std::vector<ObjectLODChange>& changes_out)
+{
+	changes_out.clear();
+	for(size_t i=0; i<obs.size(); ++i)
+	{
+		WorldObject* ob = obs[i].ptr();
+		const Vec4f centroid = ob->getCentroidWS();
+		const float dx = centroid[0] - params.cam_pos[0];
+		const float dy = centroid[1] - params.cam_pos[1];
+		const float dz = centroid[2] - params.cam_pos[2];
+		const float cam_to_ob_d2 = dx*dx + dy*dy + dz*dz;
+
+		const float recip_dist = _mm_cvtss_f32(_mm_rsqrt_ss(_mm_set_ss(cam_to_ob_d2)));
+		const float proj_len = ob->getBiasedAABBLength() * recip_dist;
+
+		bool in_proximity = (proj_len > params.proj_len_viewable_threshold) || (cam_to_ob_d2 <= params.load_everything_distance2);
+
+		if(params.use_lod_chunks && !ob->exclude_from_lod_chunk_mesh)
+		{
+			const float chunk_centre_x = (Maths::floorToInt(centroid[0] / params.lod_chunk_w) + 0.5f) * params.lod_chunk_w;
+			const float chunk_centre_y = (Maths::floorToInt(centroid[1] / params.lod_chunk_w) + 0.5f) * params.lod_chunk_w;
+			const float chunk_dx = chunk_centre_x - params.cam_pos[0];
+			const float chunk_dy = chunk_centre_y - params.cam_pos[1];
+			if(chunk_dx*chunk_dx + chunk_dy*chunk_dy > Maths::square(params.lod_chunk_display_dist))
+				in_proximity = false;
+		}
+
+		const int lod_level = ob->getLODLevel(cam_to_ob_d2);
+
+		if((in_proximity != ob->in_proximity) || (in_proximity && (lod_level != ob->current_lod_level)))
+		{
+			ObjectLODChange change;
+			change.ob = ob;
+			change.lod_level = lod_level;
+			change.in_proximity = in_proximity;
+			changes_out.push_back(change);
+		}
+	}
+}
+
+
+static void checkChangesEqual(const std::vector<ObjectLODChange>& a, const std::vector<ObjectLODChange>& b)
+{
+	testAssert(a.size() == b.size());
+	for(size_t i=0; i<a.size(); ++i)
+	{
+		testAssert(a[i].ob == b[i].ob);
+		testAssert(a[i].in_proximity == b[i].in_proximity);
+		if(a[i].in_proximity)
+			testAssert(a[i].lod_level == b[i].lod_level);
+	}
+}
+
+
+void ObjectLODEvaluator::test()
+{
+	conPrint("ObjectLODEvaluator::test()");
+
+	glare::TaskManager task_manager;
+
+	PCG32 rng(1);
+	const int N = 100003; // Not a multiple of the block size, to test the last partial block.
+	glare::FastIterMap<UID, WorldObjectRef, UIDHasher> objects(/*empty key=*/UID::invalidUID());
+	std::vector<WorldObjectRef> obs;
+	for(int i=0; i<N; ++i)
+	{
+		WorldObjectRef ob = new WorldObject();
+		ob->uid = UID(i);
+		ob->pos = Vec3d(-2000 + rng.unitRandom() * 4000, -2000 + rng.unitRandom() * 4000, rng.unitRandom() * 100);
+		ob->scale = Vec3f(0.1f + rng.unitRandom() * 30);
+		ob->setAABBOS(js::AABBox(Vec4f(0,0,0,1), Vec4f(1,1,1,1)));
+		ob->transformChanged();
+		ob->current_lod_level = (int)rng.nextUInt(4) - 1;
+		ob->in_proximity = rng.unitRandom() < 0.5f;
+		ob->exclude_from_lod_chunk_mesh = rng.unitRandom() < 0.2f;
+		objects.insert(ob->uid, ob);
+		obs.push_back(ob);
+	}
+	// The reference evaluation iterates over obs, so make sure it has the same order as the map vector.
+	for(size_t i=0; i<objects.vector.size(); ++i)
+		obs[i] = objects.vector[i].value;
+
+	ObjectLODEvaluator evaluator;
+	std::vector<ObjectLODChange> changes, ref_changes;
+
+	for(int use_lod_chunks=0; use_lod_chunks<2; ++use_lod_chunks)
+	for(int use_task_manager=0; use_task_manager<2; ++use_task_manager)
+	{
+		ObjectLODEvaluationParams params;
+		params.cam_pos = Vec4f(10, 20, 5, 1);
+		params.proj_len_viewable_threshold = 0.02f;
+		params.load_everything_distance2 = Maths::square(60.f);
+		params.use_lod_chunks = use_lod_chunks != 0;
+		params.lod_chunk_w = 128.f;
+		params.lod_chunk_display_dist = 150.f;
+
+		evaluator.evaluateObjects(objects.vector.data(), objects.vector.size(), params, use_task_manager ? &task_manager : NULL, changes);
+		evaluateObjectsReference(obs, params, ref_changes);
+		testAssert(ref_changes.size() > 0);
+		checkChangesEqual(changes, ref_changes);
+	}
+
+	// Apply changes, after which there should be no changes.
+	{
+		ObjectLODEvaluationParams params;
+		params.cam_pos = Vec4f(-100, 300, 2, 1);
+		params.proj_len_viewable_threshold = 0.f;
+		params.load_everything_distance2 = Maths::square(500.f);
+		params.use_lod_chunks = true;
+		params.lod_chunk_w = 128.f;
+		params.lod_chunk_display_dist = 150.f;
+
+		evaluator.evaluateObjects(objects.vector.data(), objects.vector.size(), params, &task_manager, changes);
+		for(size_t i=0; i<changes.size(); ++i)
+		{
+			changes[i].ob->in_proximity = changes[i].in_proximity;
+			if(changes[i].in_proximity)
+				changes[i].ob->current_lod_level = changes[i].lod_level;
+		}
+
+		evaluator.evaluateObjects(objects.vector.data(), objects.vector.size(), params, &task_manager, changes);
+		testAssert(changes.empty());
+
+		// Perf test
+		{
+			const int num_iters = 20;
+			Timer timer;
+			for(int z=0; z<num_iters; ++z)
+				evaluateObjectsReference(obs, params, ref_changes);
+			conPrint("Reference evaluation:            " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_iters, 4) + " ms (" + toString(N) + " objects)");
+
+			timer.reset();
+			for(int z=0; z<num_iters; ++z)
+				evaluator.evaluateObjects(objects.vector.data(), objects.vector.size(), params, /*task_manager=*/NULL, changes);
+			conPrint("ObjectLODEvaluator, single thread: " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_iters, 4) + " ms");
+
+			timer.reset();
+			for(int z=0; z<num_iters; ++z)
+				evaluator.evaluateObjects(objects.vector.data(), objects.vector.size(), params, &task_manager, changes);
+			conPrint("ObjectLODEvaluator, task manager:  " + doubleToStringNSigFigs(timer.elapsed() * 1.0e3 / num_iters, 4) + " ms (" + toString(task_manager.getConcurrency()) + " threads)");
+		}
+	}
+
+	conPrint("ObjectLODEvaluator::test() done.");
+}
+
+
+#endif // BUILD_TESTS
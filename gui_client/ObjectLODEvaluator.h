@@ -0,0 +1,76 @@
+/*=====================================================================
+ObjectLODEvaluator.h
+--------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "../shared/WorldObject.h"
+#include <FastIterMap.h>
+#include <utils/Reference.h>
+#include <maths/Vec4f.h>
+#include <vector>
+namespace glare { class TaskManager; }
+
+
+struct ObjectLODEvaluationParams
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	Vec4f cam_pos;
+	float proj_len_viewable_threshold; // Objects with a projected length > this value are in proximity.
+	float load_everything_distance2; // Objects with squared distance to camera <= this value are in proximity.
+
+	bool use_lod_chunks; // If true, objects in a LOD chunk that is being displayed are not in proximity (unless exclude_from_lod_chunk_mesh is set).
+	float lod_chunk_w;
+	float lod_chunk_display_dist; // LOD chunks with XY distance from the camera to the chunk centre > this value are displayed.
+};
+
+
+struct ObjectLODChange
+{
+	WorldObject* ob;
+	int lod_level; // New LOD level.  Only valid if in_proximity is true.
+	bool in_proximity; // New in_proximity value.
+};
+
+
+class ObjectLODEvaluationTask;
+
+
+/*=====================================================================
+ObjectLODEvaluator
+------------------
+Computes whether each object is in load proximity to the camera, and
+its LOD level, for all objects, and returns just the objects for which
+either value differs from ob->in_proximity or ob->current_lod_level.
+
+Objects are processed in blocks: the centroid, biased AABB length,
+current LOD level and in_proximity of each object in a block are
+gathered into packed SoA arrays, then evaluated 4 objects at a time with
+SSE.  The object range is split over tasks run on a TaskManager.
+
+The results match WorldObject::getLODLevel(float cam_to_ob_d2).
+=====================================================================*/
+class ObjectLODEvaluator
+{
+public:
+	ObjectLODEvaluator();
+	~ObjectLODEvaluator();
+
+	// Objects must not be modified during this call (the world state mutex should be held).
+	// task_manager may be null, in which case evaluation is done on the calling thread.
+	// Changes are returned in object order.
+	void evaluateObjects(const glare::FastIterMapValueInfo<UID, WorldObjectRef>* objects, size_t num_objects, const ObjectLODEvaluationParams& params,
+		glare::TaskManager* task_manager, std::vector<ObjectLODChange>& changes_out);
+
+	// Evaluate objects with indices in [begin, end).  Appends changes to changes_out.
+	static void evaluateObjectRange(const glare::FastIterMapValueInfo<UID, WorldObjectRef>* objects, size_t begin, size_t end, const ObjectLODEvaluationParams& params,
+		std::vector<ObjectLODChange>& changes_out);
+
+	static void test();
+
+private:
+	std::vector<Reference<ObjectLODEvaluationTask>> tasks;
+};
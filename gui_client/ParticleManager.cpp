@@ -11,8 +11,14 @@ Copyright Glare Technologies Limited 2023 -
 #include <tracy/Tracy.hpp>
 
 
-ParticleManager::ParticleManager(const std::string& base_dir_path_, AsyncTextureLoader* async_tex_loader_, OpenGLEngine* opengl_engine_, PhysicsWorld* physics_world_, TerrainDecalManager* terrain_decal_manager_)
+static const size_t MAX_NUM_PARTICLES = 2048; // Each particle is still a separate GLObject, so keep the number reasonably low.
+
+
+ParticleManager::ParticleManager(const std::string& base_dir_path_, AsyncTextureLoader* async_tex_loader_, OpenGLEngine* opengl_engine_, PhysicsWorld* physics_world_, TerrainDecalManager* terrain_decal_manager_,
+	glare::TaskManager* task_manager_)
 :	base_dir_path(base_dir_path_), opengl_engine(opengl_engine_), physics_world(physics_world_), terrain_decal_manager(terrain_decal_manager_),
+	task_manager(task_manager_),
+	sim(MAX_NUM_PARTICLES),
 	async_tex_loader(async_tex_loader_)
 {
 	ZoneScoped; // Tracy profiler
@@ -73,32 +79,30 @@ void ParticleManager::textureLoaded(Reference<OpenGLTexture> texture, const std:
 
 void ParticleManager::clearParticles()
 {
-	for(size_t i=0; i<particles.size(); ++i)
-		if(particles[i].gl_ob)
-			opengl_engine->removeObject(particles[i].gl_ob);
+	for(size_t i=0; i<particle_gl_obs.size(); ++i)
+		if(particle_gl_obs[i])
+			opengl_engine->removeObject(particle_gl_obs[i]);
 
-	particles.clear();
+	particle_gl_obs.clear();
+	sim.clear();
 }
 
 
-void ParticleManager::addParticle(const Particle& particle_)
+void ParticleManager::addParticle(const Particle& particle)
 {
-	// conPrint("addParticle, particles.size(): " + toString(particles.size()));
-
-	const size_t MAX_NUM_PARTICLES = 2048;
+	// conPrint("addParticle, particles.size(): " + toString(sim.size()));
 
-	size_t use_index;
-	if(particles.size() >= MAX_NUM_PARTICLES) // If we have enough particles already:
+	bool replaced_existing;
+	const size_t use_index = sim.addParticle(particle, replaced_existing);
+	if(replaced_existing)
 	{
-		use_index = rng.nextUInt((uint32)particles.size()); // Pick a random existing particle to replace
-
-		// Remove existing particle at this index
-		opengl_engine->removeObject(particles[use_index].gl_ob);
+		// Remove existing particle gl ob at this index
+		opengl_engine->removeObject(particle_gl_obs[use_index]);
 	}
 	else
 	{
-		use_index = particles.size();
-		particles.resize(use_index + 1);
+		assert(use_index == particle_gl_obs.size());
+		particle_gl_obs.resize(use_index + 1);
 	}
 
 
@@ -106,10 +110,10 @@ void ParticleManager::addParticle(const Particle& particle_)
 	GLObjectRef ob = opengl_engine->allocateObject();
 	ob->mesh_data = opengl_engine->getSpriteQuadMeshData();
 	ob->materials.resize(1);
-	ob->materials[0].albedo_linear_rgb = particle_.colour;
-	ob->materials[0].alpha = particle_.cur_opacity;
+	ob->materials[0].albedo_linear_rgb = particle.colour;
+	ob->materials[0].alpha = particle.cur_opacity;
 	ob->materials[0].participating_media = true;
-	if(particle_.particle_type == Particle::ParticleType_Smoke)
+	if(particle.particle_type == Particle::ParticleType_Smoke)
 	{
 		ob->materials[0].albedo_texture             = smoke_sprite_top;
 		ob->materials[0].metallic_roughness_texture = smoke_sprite_bottom;
@@ -118,7 +122,7 @@ void ParticleManager::addParticle(const Particle& particle_)
 		ob->materials[0].backface_albedo_texture    = smoke_sprite_rear;
 		ob->materials[0].transmission_texture       = smoke_sprite_front;
 	}
-	else if(particle_.particle_type == Particle::ParticleType_Foam)
+	else if(particle.particle_type == Particle::ParticleType_Foam)
 	{
 		ob->materials[0].albedo_texture             = foam_sprite_top;
 		ob->materials[0].metallic_roughness_texture = foam_sprite_bottom;
@@ -129,147 +133,89 @@ void ParticleManager::addParticle(const Particle& particle_)
 	}
 
 	ob->materials[0].materialise_start_time = opengl_engine->getCurrentTime(); // For participating media and decals: materialise_start_time = spawn time
-	ob->materials[0].dopacity_dt = particle_.dopacity_dt;
+	ob->materials[0].dopacity_dt = particle.dopacity_dt;
 
-	ob->ob_to_world_matrix = Matrix4f::translationMatrix(particle_.pos) * Matrix4f::uniformScaleMatrix(particle_.width);
-	ob->ob_to_world_matrix.e[1] = particle_.theta; // Since object-space vert positions are just (0,0,0) for particle geometry, we can store info in the model matrix.
+	ob->ob_to_world_matrix = Matrix4f::translationMatrix(particle.pos) * Matrix4f::uniformScaleMatrix(particle.width);
+	ob->ob_to_world_matrix.e[1] = particle.theta; // Since object-space vert positions are just (0,0,0) for particle geometry, we can store info in the model matrix.
 	opengl_engine->addObject(ob);
 
-	Particle particle = particle_;
-	particle.gl_ob = ob;
-
-	particles[use_index] = particle;
+	particle_gl_obs[use_index] = ob;
 }
 
 
-void ParticleManager::think(const float dt)
+void ParticleManager::addParticles(const Particle* particles, size_t num_particles)
 {
-	//Timer timer;
-
-	const bool water_buoyancy_enabled = physics_world->getWaterBuoyancyEnabled();
-	const float water_z = physics_world->getWaterZ();
-
-	for(size_t i=0; i<particles.size();)
-	{
-		Particle& particle = particles[i];
-
-		assert(particle.pos.isFinite());
-
-		const Vec4f pos_delta = particle.vel * dt;
-
-		
-		RayTraceResult results;
-		results.hit_object = NULL;
-		//if(pos_delta.length2() > Maths::square(1.0e-3f))
-			physics_world->traceRay(particle.pos, particle.vel, dt, /*ignore body id=*/JPH::BodyID(), results);
-
-		float remaining_dt = dt;
-		if(results.hit_object)
-		{
-			const float to_hit_dt = results.hit_t;
-			assert(to_hit_dt <= dt);
-			remaining_dt -= to_hit_dt;
+	for(size_t i=0; i<num_particles; ++i)
+		addParticle(particles[i]);
+}
 
-			const Vec4f hitpos = particle.pos + particle.vel * to_hit_dt;
 
-			// Reflect velocity vector in hit normal
-			particle.vel -= results.hit_normal_ws * (2 * dot(results.hit_normal_ws, particle.vel));
-			particle.vel *= particle.restitution; // Apply restitution factor for inelastic collisions.
+int ParticleManager::addEmitter(const ParticleEmitter& emitter)
+{
+	return sim.addEmitter(emitter);
+}
 
-			assert(particle.pos.isFinite());
-			assert(particle.vel.isFinite());
 
-			particle.pos = hitpos + 
-				results.hit_normal_ws * 1.0e-3f + // nudge off surface
-				particle.vel * remaining_dt;
+void ParticleManager::removeEmitter(int emitter_handle)
+{
+	sim.removeEmitter(emitter_handle);
+}
 
-			assert(particle.pos.isFinite());
-			assert(particle.vel.isFinite());
 
-			if(particle.die_when_hit_surface)
-				particle.cur_opacity = -1;
-		}
-		else
-		{
-			particle.pos += pos_delta;
-
-			if(water_buoyancy_enabled && (particle.pos[2] < water_z))
-			{
-				if(particle.die_when_hit_surface && (particle.vel[2] < 0)) // If should die when hit surface, and are moving downwards:
-				{
-					particle.cur_opacity = -1;
-
-					// Create foam decal at hit position
-					Vec4f foam_pos = particle.pos;
-					foam_pos[2] = water_z;
-					terrain_decal_manager->addFoamDecal(foam_pos, /*width=*/particle.width, /*opacity=*/1.f, TerrainDecalManager::DecalType_SparseFoam);
-				}
-
-				// underwater
-				particle.vel[2] = myMax(particle.vel[2], 0.5f); // apply buoyancy in a hacky way while not limiting positive z velocity (e.g. for water spray shooting out of water)
-			}
-			else
-				particle.vel[2] -= 9.81f * dt; // Apply gravity
-		}
+void ParticleManager::setEmitterPos(int emitter_handle, const Vec4f& pos)
+{
+	sim.setEmitterPos(emitter_handle, pos);
+}
 
-		assert(particle.vel.isFinite());
 
-		// Apply wind-resistance drag force
-		const float v_mag2 = particle.vel.length2();
-		if(v_mag2 > Maths::square(1.0e-3f))
-		{
-			// ||a|| = F_d rho * ||v||^2 C_d A / m
-
-			// dvel = -vel/||vel|| * ||a|| * dt    = vel * (||a|| * dt / ||v||)
-			// vel' = vel + devl = vel - vel * (||a|| * dt / ||v||)
-			// vel' = vel - vel * (F_d rho * ||v||^2 C_d A * dt / (m * ||v||))
-			// vel' = vel - vel * (F_d rho * ||v|| C_d A * dt / m)
-			// vel' = vel * (1 - F_d rho * ||v|| C_d A * dt / m)
-
-			const float rho = 1.293f; // air density, kg m^-3
-			const float projected_forwards_area = particle.area;
-			const float forwards_C_d = 0.5f; // drag coefficient
-			const float forwards_F_d = 0.5f * rho * v_mag2 * forwards_C_d * projected_forwards_area;
-			const float mass = particle.mass;
-			const float accel_mag = myMin(10.f, forwards_F_d / mass);
-
-			// dvel = -vel/||vel|| * ||a|| * dt    = vel * (||a|| * dt / ||vel||)
-			// vel' = vel + dvel = vel - vel * (||a|| * dt / ||vel||)
-			// vel' = vel * (1 - (||a|| * dt / ||vel||))
-			particle.vel *= myMax(0.f, 1.f - accel_mag * dt / std::sqrt(v_mag2));
-
-			assert(particle.vel.isFinite());
-		}
+void ParticleManager::think(const float dt)
+{
+	ZoneScoped; // Tracy profiler
 
-		assert(particle.pos.isFinite());
-		assert(particle.vel.isFinite());
-		
-		particle.cur_opacity += particle.dopacity_dt * dt;
-		particle.width       += particle.dwidth_dt   * dt;
+	//Timer timer;
 
-		particle.gl_ob->ob_to_world_matrix = translationMulUniformScaleMatrix(/*translation=*/particle.pos, /*scale=*/particle.width);
-		particle.gl_ob->ob_to_world_matrix.e[1] = particle.theta; // Since object-space vert positions are just (0,0,0) for particle geometry, we can store info in the model matrix.
+	// Create particles from emitters
+	if(sim.numEmitters() > 0)
+	{
+		temp_new_particles.clear();
+		sim.emitParticles(dt, temp_new_particles);
+		addParticles(temp_new_particles.data(), temp_new_particles.size());
+	}
 
-		opengl_engine->updateObjectTransformData(*particle.gl_ob);
+	temp_water_hits.clear();
+	sim.think(dt, physics_world, task_manager, physics_world->getWaterBuoyancyEnabled(), physics_world->getWaterZ(), temp_water_hits);
 
-		// NOTE: changing alpha directly in shader based on particle lifetime now.
-		//particle.gl_ob->materials[0].alpha = particle.cur_opacity;
-		//opengl_engine->updateAllMaterialDataOnGPU(*particle.gl_ob); // Since opacity changed.
+	// Create foam decals where particles hit the water surface
+	for(size_t i=0; i<temp_water_hits.size(); ++i)
+		terrain_decal_manager->addFoamDecal(temp_water_hits[i].pos, /*width=*/temp_water_hits[i].width, /*opacity=*/1.f, TerrainDecalManager::DecalType_SparseFoam);
 
-		if(particle.cur_opacity <= 0)
+	// Update gl object transforms, and remove dead particles
+	for(size_t i=0; i<sim.size();)
+	{
+		if(sim.getOpacity(i) <= 0)
 		{
 			//conPrint("removed particle");
-			opengl_engine->removeObject(particle.gl_ob);
+			opengl_engine->removeObject(particle_gl_obs[i]);
 
 			// Remove particle: swap with last particle in array
-			mySwap(particle, particles.back());
-			particles.pop_back(); // Now remove last array element.
-			
+			particle_gl_obs[i] = particle_gl_obs.back();
+			particle_gl_obs.pop_back(); // Now remove last array element.
+			sim.removeParticle(i);
+
 			// Don't increment i as we there is a new particle in position i that we want to process.
 		}
 		else
+		{
+			GLObject* gl_ob = particle_gl_obs[i].ptr();
+			gl_ob->ob_to_world_matrix = translationMulUniformScaleMatrix(/*translation=*/sim.getPos(i), /*scale=*/sim.getWidth(i));
+			gl_ob->ob_to_world_matrix.e[1] = sim.getTheta(i); // Since object-space vert positions are just (0,0,0) for particle geometry, we can store info in the model matrix.
+
+			opengl_engine->updateObjectTransformData(*gl_ob);
+
+			// NOTE: changing alpha directly in shader based on particle lifetime now.
 			++i;
+		}
 	}
 
-	//conPrint("ParticleManager::think() took " + timer.elapsedStringMSWIthNSigFigs(4) + " for " + toString(particles.size()) + " particles.");
+	//conPrint("ParticleManager::think() took " + timer.elapsedStringMSWIthNSigFigs(4) + " for " + toString(sim.size()) + " particles.");
 }
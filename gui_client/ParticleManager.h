@@ -7,6 +7,7 @@ Copyright Glare Technologies Limited 2023 -
 
 
 #include "PhysicsObject.h"
+#include "ParticleSimulation.h"
 #include <opengl/AsyncTextureLoader.h>
 #include <opengl/IncludeOpenGL.h>
 #include <opengl/OpenGLTexture.h>
@@ -20,44 +21,7 @@ class VertexBufferAllocator;
 class PhysicsWorld;
 class BiomeManager;
 class TerrainDecalManager;
-
-
-struct Particle
-{
-	GLARE_ALIGNED_16_NEW_DELETE
-
-	enum ParticleType
-	{
-		ParticleType_Smoke,
-		ParticleType_Foam
-	};
-
-	Particle() : restitution(0.5f), width(1.f), dwidth_dt(0.5f), cur_opacity(1.f), dopacity_dt(-0.3f), theta(0.f), colour(0.8f), mass(1.0e-6f), area(1.0e-6f), 
-		die_when_hit_surface(false), particle_type(ParticleType_Smoke) {}
-
-	Vec4f pos;
-	Vec4f vel;
-
-	GLObjectRef gl_ob;
-
-	Colour3f colour;
-
-	float area; // particle cross-sectional area (m^2).  Larger area = more wind drag.  TODO: just store ratio of area to mass?
-	float mass;
-	float restitution; // "Restitution of body (dimensionless number, usually between 0 and 1, 0 = completely inelastic collision response, 1 = completely elastic collision response)"
-
-	float width;
-	float dwidth_dt;
-
-	float cur_opacity;
-	float dopacity_dt;
-
-	float theta; // rotation around axis to camera
-
-	bool die_when_hit_surface;
-
-	ParticleType particle_type;
-};
+namespace glare { class TaskManager; }
 
 
 /*=====================================================================
@@ -66,13 +30,18 @@ ParticleManager
 The basic idea is to simulate point particles with ray-traced collisions, and a simple physics model with 
 bouncing off surfaces and with wind resistance.
 See https://github.com/jrouwe/JoltPhysics/discussions/756 for a discussion of the approach.
+
+The simulation itself is done by ParticleSimulation.  ParticleManager creates and
+updates an OpenGL object for each particle.
 =====================================================================*/
 class ParticleManager final : public RefCounted, public AsyncTextureLoadedHandler
 {
 public:
 	GLARE_ALIGNED_16_NEW_DELETE
 
-	ParticleManager(const std::string& base_dir_path, AsyncTextureLoader* async_tex_loader, OpenGLEngine* opengl_engine, PhysicsWorld* physics_world, TerrainDecalManager* terrain_decal_manager);
+	// task_manager may be null, in which case collision queries are done on the calling thread.
+	ParticleManager(const std::string& base_dir_path, AsyncTextureLoader* async_tex_loader, OpenGLEngine* opengl_engine, PhysicsWorld* physics_world, TerrainDecalManager* terrain_decal_manager,
+		glare::TaskManager* task_manager);
 	~ParticleManager();
 
 	void clearParticles();
@@ -80,6 +49,14 @@ public:
 	virtual void textureLoaded(Reference<OpenGLTexture> texture, const std::string& local_filename) override;
 
 	void addParticle(const Particle& particle);
+	void addParticles(const Particle* particles, size_t num_particles);
+
+	// Emitters create particles each think() call.  Returns an emitter handle.
+	int addEmitter(const ParticleEmitter& emitter);
+	void removeEmitter(int emitter_handle);
+	void setEmitterPos(int emitter_handle, const Vec4f& pos);
+
+	size_t getNumParticles() const { return sim.size(); }
 
 	void think(float dt);
 
@@ -88,8 +65,13 @@ private:
 	OpenGLEngine* opengl_engine;
 	PhysicsWorld* physics_world;
 	TerrainDecalManager* terrain_decal_manager;
-	PCG32 rng;
-	std::vector<Particle> particles;
+	glare::TaskManager* task_manager;
+
+	ParticleSimulation sim;
+	std::vector<GLObjectRef> particle_gl_obs; // GL object for each particle in sim, with the same indices.
+
+	js::Vector<Particle, 16> temp_new_particles;
+	std::vector<ParticleSimulation::WaterHit> temp_water_hits;
 
 	Reference<OpenGLTexture> smoke_sprite_top;
 	Reference<OpenGLTexture> smoke_sprite_bottom;
@@ -0,0 +1,670 @@
+/*=====================================================================
+ParticleSimulation.cpp
+----------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ParticleSimulation.h"
+
+
+#include "PhysicsWorld.h"
+#include <utils/Task.h>
+#include <utils/TaskManager.h>
+#include <tracy/Tracy.hpp>
+#include <limits>
+
+
+static const size_t PARTICLES_PER_BROADPHASE_QUERY = 64;
+static const size_t MIN_PARTICLES_FOR_PARALLEL_COLLISIONS = 256;
+
+
+ParticleSimulation::ParticleSimulation(size_t max_num_particles_)
+:	num_particles(0),
+	max_num_particles(max_num_particles_),
+	num_emitters_in_use(0)
+{
+	assert(max_num_particles > 0);
+
+	resizeArrays(Maths::roundUpToMultipleOfPowerOf2<size_t>(max_num_particles, 4));
+}
+
+
+ParticleSimulation::~ParticleSimulation()
+{}
+
+
+void ParticleSimulation::resizeArrays(size_t new_size)
+{
+	js::Vector<float, 16>* float_arrays[] = { &pos_x, &pos_y, &pos_z, &vel_x, &vel_y, &vel_z, &area_over_mass, &restitution, &width, &dwidth_dt, &opacity, &dopacity_dt, &theta,
+		&die_when_hit_surface, &hit_t, &moved_by_collision };
+
+	for(size_t a=0; a<staticArrayNumElems(float_arrays); ++a)
+	{
+		float_arrays[a]->resize(new_size);
+		for(size_t i=0; i<new_size; ++i)
+			(*float_arrays[a])[i] = 0.f; // Initialise, so the SIMD integration of padding elements doesn't read uninitialised memory.
+	}
+
+	hit_normal.resize(new_size);
+	for(size_t i=0; i<new_size; ++i)
+		hit_normal[i] = Vec4f(0.f);
+}
+
+
+void ParticleSimulation::setParticle(size_t i, const Particle& particle)
+{
+	assert(particle.pos.isFinite());
+
+	pos_x[i] = particle.pos[0];
+	pos_y[i] = particle.pos[1];
+	pos_z[i] = particle.pos[2];
+	vel_x[i] = particle.vel[0];
+	vel_y[i] = particle.vel[1];
+	vel_z[i] = particle.vel[2];
+	area_over_mass[i] = particle.area / particle.mass;
+	restitution[i] = particle.restitution;
+	width[i] = particle.width;
+	dwidth_dt[i] = particle.dwidth_dt;
+	opacity[i] = particle.cur_opacity;
+	dopacity_dt[i] = particle.dopacity_dt;
+	theta[i] = particle.theta;
+	die_when_hit_surface[i] = particle.die_when_hit_surface ? 1.f : 0.f;
+}
+
+
+void ParticleSimulation::copyParticle(size_t src, size_t dest)
+{
+	pos_x[dest] = pos_x[src];
+	pos_y[dest] = pos_y[src];
+	pos_z[dest] = pos_z[src];
+	vel_x[dest] = vel_x[src];
+	vel_y[dest] = vel_y[src];
+	vel_z[dest] = vel_z[src];
+	area_over_mass[dest] = area_over_mass[src];
+	restitution[dest] = restitution[src];
+	width[dest] = width[src];
+	dwidth_dt[dest] = dwidth_dt[src];
+	opacity[dest] = opacity[src];
+	dopacity_dt[dest] = dopacity_dt[src];
+	theta[dest] = theta[src];
+	die_when_hit_surface[dest] = die_when_hit_surface[src];
+}
+
+
+size_t ParticleSimulation::addParticle(const Particle& particle, bool& replaced_existing_out)
+{
+	size_t use_index;
+	if(num_particles >= max_num_particles) // If we have enough particles already:
+	{
+		use_index = rng.nextUInt((uint32)num_particles); // Pick a random existing particle to replace
+		replaced_existing_out = true;
+	}
+	else
+	{
+		use_index = num_particles++;
+		replaced_existing_out = false;
+	}
+
+	setParticle(use_index, particle);
+	return use_index;
+}
+
+
+void ParticleSimulation::removeParticle(size_t i)
+{
+	assert(i < num_particles);
+
+	const size_t last_i = num_particles - 1;
+	if(i != last_i)
+		copyParticle(last_i, i);
+	num_particles--;
+}
+
+
+void ParticleSimulation::clear()
+{
+	num_particles = 0;
+}
+
+
+int ParticleSimulation::addEmitter(const ParticleEmitter& emitter)
+{
+	int handle;
+	if(!free_emitter_handles.empty())
+	{
+		handle = free_emitter_handles.back();
+		free_emitter_handles.pop_back();
+	}
+	else
+	{
+		handle = (int)emitters.size();
+		emitters.resize(emitters.size() + 1);
+	}
+
+	emitters[handle] = emitter;
+	emitters[handle].emission_accum = 0;
+	emitters[handle].in_use = true;
+	num_emitters_in_use++;
+	return handle;
+}
+
+
+void ParticleSimulation::removeEmitter(int emitter_handle)
+{
+	if(emitter_handle >= 0 && emitter_handle < (int)emitters.size() && emitters[emitter_handle].in_use)
+	{
+		emitters[emitter_handle].in_use = false;
+		free_emitter_handles.push_back(emitter_handle);
+		num_emitters_in_use--;
+	}
+}
+
+
+void ParticleSimulation::setEmitterPos(int emitter_handle, const Vec4f& pos)
+{
+	if(emitter_handle >= 0 && emitter_handle < (int)emitters.size() && emitters[emitter_handle].in_use)
+		emitters[emitter_handle].prototype.pos = pos;
+}
+
+
+void ParticleSimulation::emitParticles(float dt, js::Vector<Particle, 16>& new_particles_out)
+{
+	for(size_t e=0; e<emitters.size(); ++e)
+	{
+		ParticleEmitter& emitter = emitters[e];
+		if(!emitter.in_use)
+			continue;
+
+		emitter.emission_accum += emitter.emission_rate * dt;
+		const int num_to_emit = (int)myMin<float>(emitter.emission_accum, (float)max_num_particles); // Limit burst size after long frames.
+		emitter.emission_accum -= (float)num_to_emit;
+		emitter.emission_accum = myMin(emitter.emission_accum, 1.f);
+
+		for(int i=0; i<num_to_emit; ++i)
+		{
+			Particle particle = emitter.prototype;
+			particle.pos += emitter.pos_spread * Vec4f(rng.unitRandom() * 2 - 1, rng.unitRandom() * 2 - 1, rng.unitRandom() * 2 - 1, 0);
+			particle.vel += emitter.vel_spread * Vec4f(rng.unitRandom() * 2 - 1, rng.unitRandom() * 2 - 1, rng.unitRandom() * 2 - 1, 0);
+			new_particles_out.push_back(particle);
+		}
+	}
+}
+
+
+// Trace rays for particles in [begin, end), storing results in sim.hit_t and sim.hit_normal.
+// Does a broad-phase query for each group of PARTICLES_PER_BROADPHASE_QUERY particles first, and skips ray tracing for the group if nothing overlaps.
+static void computeCollisionsForRange(ParticleSimulation& sim, PhysicsWorld* physics_world, float dt, size_t begin, size_t end)
+{
+	for(size_t group_begin = begin; group_begin < end; group_begin += PARTICLES_PER_BROADPHASE_QUERY)
+	{
+		const size_t group_end = myMin(end, group_begin + PARTICLES_PER_BROADPHASE_QUERY);
+
+		js::AABBox path_aabb = js::AABBox::emptyAABBox();
+		for(size_t i=group_begin; i<group_end; ++i)
+		{
+			const Vec4f pos = sim.getPos(i);
+			path_aabb.enlargeToHoldPoint(pos);
+			path_aabb.enlargeToHoldPoint(pos + sim.getVel(i) * dt);
+		}
+
+		if(!physics_world->doesAABBOverlapAnyBodies(path_aabb))
+		{
+			for(size_t i=group_begin; i<group_end; ++i)
+				sim.hit_t[i] = -1.f;
+			continue;
+		}
+
+		for(size_t i=group_begin; i<group_end; ++i)
+		{
+			RayTraceResult results;
+			physics_world->traceRay(sim.getPos(i), sim.getVel(i), dt, /*ignore body id=*/JPH::BodyID(), results);
+			if(results.hit_object)
+			{
+				sim.hit_t[i] = results.hit_t;
+				sim.hit_normal[i] = results.hit_normal_ws;
+			}
+			else
+				sim.hit_t[i] = -1.f;
+		}
+	}
+}
+
+
+class ParticleCollisionTask : public glare::Task
+{
+public:
+	void run(size_t /*thread_index*/) override
+	{
+		ZoneScopedN("ParticleCollisionTask::run"); // Tracy profiler
+
+		computeCollisionsForRange(*sim, physics_world, dt, begin, end);
+	}
+
+	ParticleSimulation* sim;
+	PhysicsWorld* physics_world;
+	float dt;
+	size_t begin, end;
+};
+
+
+void ParticleSimulation::computeCollisions(float dt, PhysicsWorld* physics_world, glare::TaskManager* task_manager)
+{
+	ZoneScoped; // Tracy profiler
+
+	if(task_manager && (num_particles >= MIN_PARTICLES_FOR_PARALLEL_COLLISIONS))
+	{
+		if(!collision_task_group)
+		{
+			collision_task_group = new glare::TaskGroup();
+			collision_task_group->tasks.resize(task_manager->getConcurrency());
+			for(size_t i=0; i<collision_task_group->tasks.size(); ++i)
+				collision_task_group->tasks[i] = new ParticleCollisionTask();
+		}
+
+		// Split particles into contiguous ranges, with range sizes a multiple of PARTICLES_PER_BROADPHASE_QUERY.
+		const size_t num_tasks = collision_task_group->tasks.size();
+		const size_t num_per_task = Maths::roundUpToMultipleOfPowerOf2<size_t>(Maths::roundedUpDivide(num_particles, num_tasks), PARTICLES_PER_BROADPHASE_QUERY);
+		for(size_t i=0; i<num_tasks; ++i)
+		{
+			ParticleCollisionTask* task = (ParticleCollisionTask*)collision_task_group->tasks[i].ptr();
+			task->sim = this;
+			task->physics_world = physics_world;
+			task->dt = dt;
+			task->begin = myMin(i * num_per_task,       num_particles);
+			task->end   = myMin((i + 1) * num_per_task, num_particles);
+		}
+
+		task_manager->runTaskGroup(collision_task_group);
+	}
+	else
+		computeCollisionsForRange(*this, physics_world, dt, 0, num_particles);
+}
+
+
+// Do collision response for particles that hit something.
+void ParticleSimulation::applyCollisions(float dt)
+{
+	for(size_t i=0; i<num_particles; ++i)
+	{
+		if(hit_t[i] >= 0)
+		{
+			const float to_hit_dt = hit_t[i];
+			assert(to_hit_dt <= dt);
+			const float remaining_dt = dt - to_hit_dt;
+
+			Vec4f pos = getPos(i);
+			Vec4f vel = getVel(i);
+			const Vec4f n = hit_normal[i];
+
+			const Vec4f hitpos = pos + vel * to_hit_dt;
+
+			// Reflect velocity vector in hit normal
+			vel -= n * (2 * dot(n, vel));
+			vel *= restitution[i]; // Apply restitution factor for inelastic collisions.
+
+			pos = hitpos +
+				n * 1.0e-3f + // nudge off surface
+				vel * remaining_dt;
+
+			assert(pos.isFinite());
+			assert(vel.isFinite());
+
+			pos_x[i] = pos[0]; pos_y[i] = pos[1]; pos_z[i] = pos[2];
+			vel_x[i] = vel[0]; vel_y[i] = vel[1]; vel_z[i] = vel[2];
+
+			if(die_when_hit_surface[i] != 0)
+				opacity[i] = -1;
+
+			moved_by_collision[i] = 1.f;
+		}
+		else
+			moved_by_collision[i] = 0.f;
+	}
+}
+
+
+// Integrate particles not moved by collision response, apply gravity, buoyancy and drag, and update opacity and width.
+// Processes 4 particles at a time.
+void ParticleSimulation::integrate(float dt, bool water_buoyancy_enabled, float water_z, std::vector<WaterHit>& water_hits_out)
+{
+	ZoneScoped; // Tracy profiler
+
+	const float rho = 1.293f; // air density, kg m^-3
+	const float C_d = 0.5f; // drag coefficient
+
+	const Vec4f dt_v(dt);
+	const Vec4f zero(0.f);
+	const Vec4f one(1.f);
+	const Vec4f half(0.5f);
+	const Vec4f gravity_dv(-9.81f * dt);
+	const Vec4f min_underwater_vel_z(0.5f);
+	const Vec4f water_z_v(water_buoyancy_enabled ? water_z : -std::numeric_limits<float>::infinity());
+	const Vec4f drag_factor(0.5f * rho * C_d); // ||a|| = drag_factor * ||v||^2 * area / mass
+	const Vec4f max_accel(10.f);
+	const Vec4f min_v2(Maths::square(1.0e-3f));
+
+	for(size_t i=0; i<num_particles; i += 4)
+	{
+		Vec4f px = loadVec4f(&pos_x[i]);
+		Vec4f py = loadVec4f(&pos_y[i]);
+		Vec4f pz = loadVec4f(&pos_z[i]);
+		Vec4f vx = loadVec4f(&vel_x[i]);
+		Vec4f vy = loadVec4f(&vel_y[i]);
+		Vec4f vz = loadVec4f(&vel_z[i]);
+		const Vec4f moved = loadVec4f(&moved_by_collision[i]);
+
+		// Move particles that weren't already moved by collision response.
+		const Vec4f step_dt = dt_v * (one - moved);
+		px += vx * step_dt;
+		py += vy * step_dt;
+		pz += vz * step_dt;
+
+		// Particles below the water surface (that weren't moved by collision response) get buoyancy, other non-collided particles get gravity.
+		const Vec4f not_moved_mask = parallelLessThan(moved, half);
+		const Vec4f underwater_mask = Vec4f(_mm_and_ps(parallelLessThan(pz, water_z_v).v, not_moved_mask.v));
+		const int underwater_bits = _mm_movemask_ps(underwater_mask.v);
+		const Vec4f pre_buoyancy_vz = vz;
+
+		// If mask element has higher bit set, return a element, else return b element.
+		vz = select(
+			max(vz, min_underwater_vel_z), // apply buoyancy in a hacky way while not limiting positive z velocity (e.g. for water spray shooting out of water)
+			vz + gravity_dv * (one - moved),
+			underwater_mask
+		);
+
+		// Apply wind-resistance drag force
+		// vel' = vel * (1 - ||a|| * dt / ||vel||)
+		const Vec4f v2 = vx*vx + vy*vy + vz*vz;
+		const Vec4f accel_mag = min(max_accel, drag_factor * v2 * loadVec4f(&area_over_mass[i]));
+		const Vec4f drag_scale = select(
+			max(zero, one - accel_mag * dt_v / sqrt(max(v2, min_v2))),
+			one,
+			parallelLessThan(min_v2, v2)
+		);
+		vx *= drag_scale;
+		vy *= drag_scale;
+		vz *= drag_scale;
+
+		const Vec4f old_width = loadVec4f(&width[i]);
+
+		storeVec4f(px, &pos_x[i]);
+		storeVec4f(py, &pos_y[i]);
+		storeVec4f(pz, &pos_z[i]);
+		storeVec4f(vx, &vel_x[i]);
+		storeVec4f(vy, &vel_y[i]);
+		storeVec4f(vz, &vel_z[i]);
+		storeVec4f(loadVec4f(&opacity[i]) + loadVec4f(&dopacity_dt[i]) * dt_v, &opacity[i]);
+		storeVec4f(old_width              + loadVec4f(&dwidth_dt[i])   * dt_v, &width[i]);
+
+		if(underwater_bits != 0)
+		{
+			// Particles that should die when hitting a surface, and are moving downwards into the water, die and may create foam.
+			for(size_t z=0; z<4; ++z)
+			{
+				const size_t particle_i = i + z;
+				if((underwater_bits & (1 << z)) && (particle_i < num_particles) && (die_when_hit_surface[particle_i] != 0) && (pre_buoyancy_vz[z] < 0))
+				{
+					opacity[particle_i] = -1;
+
+					WaterHit hit;
+					hit.pos = Vec4f(px[z], py[z], water_z, 1.f);
+					hit.width = old_width[z];
+					water_hits_out.push_back(hit);
+				}
+			}
+		}
+	}
+}
+
+
+void ParticleSimulation::think(float dt, PhysicsWorld* physics_world, glare::TaskManager* task_manager, bool water_buoyancy_enabled, float water_z, std::vector<WaterHit>& water_hits_out)
+{
+	ZoneScoped; // Tracy profiler
+
+	if(physics_world)
+	{
+		computeCollisions(dt, physics_world, task_manager);
+		applyCollisions(dt);
+	}
+	else
+	{
+		for(size_t i=0; i<num_particles; ++i)
+			moved_by_collision[i] = 0.f;
+	}
+
+	integrate(dt, water_buoyancy_enabled, water_z, water_hits_out);
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Timer.h>
+
+
+// Previous (array-of-structures, one particle at a time) integration code from ParticleManager::think(), without collisions, for comparison.
+struct RefParticle
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	Vec4f pos;
+	Vec4f vel;
+	float area;
+	float mass;
+	float width;
+	float dwidth_dt;
+	float cur_opacity;
+	float dopacity_dt;
+	bool die_when_hit_surface;
+};
+
+
+static void refThink(js::Vector<RefParticle, 16>& particles, float dt, bool water_buoyancy_enabled, float water_z, size_t& num_water_hits)
+{
+	for(size_t i=0; i<particles.size(); ++i)
+	{
+		RefParticle& particle = particles[i];
+
+		particle.pos += particle.vel * dt;
+
+		if(water_buoyancy_enabled && (particle.pos[2] < water_z))
+		{
+			if(particle.die_when_hit_surface && (particle.vel[2] < 0)) // If should die when hit surface, and are moving downwards:
+			{
+				particle.cur_opacity = -1;
+				num_water_hits++;
+			}
+
+			particle.vel[2] = myMax(particle.vel[2], 0.5f);
+		}
+		else
+			particle.vel[2] -= 9.81f * dt; // Apply gravity
+
+		const float v_mag2 = particle.vel.length2();
+		if(v_mag2 > Maths::square(1.0e-3f))
+		{
+			const float rho = 1.293f; // air density, kg m^-3
+			const float forwards_C_d = 0.5f; // drag coefficient
+			const float forwards_F_d = 0.5f * rho * v_mag2 * forwards_C_d * particle.area;
+			const float accel_mag = myMin(10.f, forwards_F_d / particle.mass);
+			particle.vel *= myMax(0.f, 1.f - accel_mag * dt / std::sqrt(v_mag2));
+		}
+
+		particle.cur_opacity += particle.dopacity_dt * dt;
+		particle.width       += particle.dwidth_dt   * dt;
+	}
+}
+
+
+static Particle makeRandomParticle(PCG32& rng)
+{
+	Particle particle;
+	particle.pos = Vec4f(-50 + rng.unitRandom() * 100, -50 + rng.unitRandom() * 100, rng.unitRandom() * 20, 1);
+	particle.vel = Vec4f(-5 + rng.unitRandom() * 10, -5 + rng.unitRandom() * 10, -5 + rng.unitRandom() * 10, 0);
+	particle.area = 0.01f + rng.unitRandom() * 0.1f;
+	particle.mass = 0.1f + rng.unitRandom();
+	particle.width = 0.5f;
+	particle.dwidth_dt = rng.unitRandom();
+	particle.cur_opacity = 1.f;
+	particle.dopacity_dt = -0.1f * rng.unitRandom();
+	particle.die_when_hit_surface = rng.unitRandom() < 0.2f;
+	return particle;
+}
+
+
+static RefParticle makeRefParticle(const Particle& p)
+{
+	RefParticle r;
+	r.pos = p.pos;
+	r.vel = p.vel;
+	r.area = p.area;
+	r.mass = p.mass;
+	r.width = p.width;
+	r.dwidth_dt = p.dwidth_dt;
+	r.cur_opacity = p.cur_opacity;
+	r.dopacity_dt = p.dopacity_dt;
+	r.die_when_hit_surface = p.die_when_hit_surface;
+	return r;
+}
+
+
+void ParticleSimulation::test()
+{
+	conPrint("ParticleSimulation::test()");
+
+	//------------------------- Test pool and removal -------------------------
+	{
+		ParticleSimulation sim(/*max num particles=*/3);
+		Particle p;
+		bool replaced;
+		p.pos = Vec4f(1, 0, 0, 1);
+		testAssert(sim.addParticle(p, replaced) == 0 && !replaced);
+		p.pos = Vec4f(2, 0, 0, 1);
+		testAssert(sim.addParticle(p, replaced) == 1 && !replaced);
+		p.pos = Vec4f(3, 0, 0, 1);
+		testAssert(sim.addParticle(p, replaced) == 2 && !replaced);
+		p.pos = Vec4f(4, 0, 0, 1);
+		const size_t index = sim.addParticle(p, replaced);
+		testAssert(replaced && index < 3);
+		testAssert(sim.size() == 3);
+		testAssert(sim.getPos(index) == Vec4f(4, 0, 0, 1));
+
+		sim.removeParticle(0);
+		testAssert(sim.size() == 2);
+		testAssert(sim.getPos(0)[0] == (index == 2 ? 4.f : 3.f)); // Last particle should have been moved to index 0.
+	}
+
+	//------------------------- Test emitters -------------------------
+	{
+		ParticleSimulation sim(100);
+		ParticleEmitter emitter;
+		emitter.prototype.pos = Vec4f(10, 0, 0, 1);
+		emitter.pos_spread = Vec4f(1, 1, 1, 0);
+		emitter.emission_rate = 100;
+		const int handle = sim.addEmitter(emitter);
+		testAssert(sim.numEmitters() == 1);
+
+		js::Vector<Particle, 16> new_particles;
+		sim.emitParticles(/*dt=*/0.1f, new_particles);
+		testAssert(new_particles.size() == 10 || new_particles.size() == 9); // Allow for rounding
+		for(size_t i=0; i<new_particles.size(); ++i)
+			testAssert(new_particles[i].pos[0] >= 9 && new_particles[i].pos[0] <= 11);
+
+		sim.removeEmitter(handle);
+		testAssert(sim.numEmitters() == 0);
+		new_particles.clear();
+		sim.emitParticles(/*dt=*/0.1f, new_particles);
+		testAssert(new_particles.size() == 0);
+
+		testAssert(sim.addEmitter(emitter) == handle); // Handle should be reused.
+	}
+
+	//------------------------- Test SIMD integration matches reference scalar integration -------------------------
+	{
+		PCG32 rng(1);
+		const size_t N = 1001; // Not a multiple of 4
+		ParticleSimulation sim(N);
+		js::Vector<RefParticle, 16> ref_particles(N);
+		for(size_t i=0; i<N; ++i)
+		{
+			const Particle p = makeRandomParticle(rng);
+			bool replaced;
+			sim.addParticle(p, replaced);
+			ref_particles[i] = makeRefParticle(p);
+		}
+
+		const float water_z = 5.f;
+		std::vector<WaterHit> water_hits;
+		size_t ref_num_water_hits = 0;
+		for(int step=0; step<50; ++step)
+		{
+			sim.think(/*dt=*/0.02f, /*physics world=*/nullptr, /*task manager=*/nullptr, /*water_buoyancy_enabled=*/true, water_z, water_hits);
+			refThink(ref_particles, /*dt=*/0.02f, /*water_buoyancy_enabled=*/true, water_z, ref_num_water_hits);
+
+			// Remove dead particles from both, as ParticleManager does
+			for(size_t i=0; i<sim.size(); )
+			{
+				testAssert((sim.getOpacity(i) <= 0) == (ref_particles[i].cur_opacity <= 0));
+				if(sim.getOpacity(i) <= 0)
+				{
+					sim.removeParticle(i);
+					ref_particles[i] = ref_particles.back();
+					ref_particles.pop_back();
+				}
+				else
+					++i;
+			}
+		}
+
+		testAssert(sim.size() == ref_particles.size());
+		testAssert(water_hits.size() == ref_num_water_hits);
+		for(size_t i=0; i<sim.size(); ++i)
+		{
+			testAssert(sim.getPos(i).getDist(ref_particles[i].pos) < 1.0e-2f);
+			testAssert(sim.getVel(i).getDist(ref_particles[i].vel) < 1.0e-2f);
+			testAssert(std::fabs(sim.getWidth(i) - ref_particles[i].width) < 1.0e-4f);
+		}
+	}
+
+	//------------------------- Perf test: 100k particles -------------------------
+	{
+		PCG32 rng(1);
+		const size_t N = 100000;
+		const int num_steps = 100;
+		ParticleSimulation sim(N);
+		js::Vector<RefParticle, 16> ref_particles(N);
+		for(size_t i=0; i<N; ++i)
+		{
+			Particle p = makeRandomParticle(rng);
+			p.dopacity_dt = 0; // Don't let particles die, so the particle count is constant.
+			p.die_when_hit_surface = false;
+			bool replaced;
+			sim.addParticle(p, replaced);
+			ref_particles[i] = makeRefParticle(p);
+		}
+
+		std::vector<WaterHit> water_hits;
+		Timer timer;
+		for(int step=0; step<num_steps; ++step)
+			sim.think(/*dt=*/0.016f, /*physics world=*/nullptr, /*task manager=*/nullptr, /*water_buoyancy_enabled=*/true, /*water_z=*/5.f, water_hits);
+		const double soa_time = timer.elapsed();
+
+		timer.reset();
+		size_t num_water_hits = 0;
+		for(int step=0; step<num_steps; ++step)
+			refThink(ref_particles, /*dt=*/0.016f, /*water_buoyancy_enabled=*/true, /*water_z=*/5.f, num_water_hits);
+		const double ref_time = timer.elapsed();
+
+		testAssert(sim.size() == N);
+
+		conPrint("ParticleSimulation: " + toString(N) + " particles: " + doubleToStringNSigFigs(soa_time / num_steps * 1.0e3, 4) + " ms / step (SoA SIMD), " +
+			doubleToStringNSigFigs(ref_time / num_steps * 1.0e3, 4) + " ms / step (AoS scalar)");
+	}
+
+	conPrint("ParticleSimulation::test() done");
+}
+
+
+#endif // BUILD_TESTS
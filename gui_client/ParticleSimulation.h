@@ -0,0 +1,181 @@
+/*=====================================================================
+ParticleSimulation.h
+--------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <maths/Vec4f.h>
+#include <maths/PCG32.h>
+#include <graphics/colour3.h>
+#include <utils/Vector.h>
+#include <utils/Reference.h>
+#include <vector>
+class PhysicsWorld;
+namespace glare { class TaskManager; class TaskGroup; }
+
+
+struct Particle
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	enum ParticleType
+	{
+		ParticleType_Smoke,
+		ParticleType_Foam
+	};
+
+	Particle() : restitution(0.5f), width(1.f), dwidth_dt(0.5f), cur_opacity(1.f), dopacity_dt(-0.3f), theta(0.f), colour(0.8f), mass(1.0e-6f), area(1.0e-6f),
+		die_when_hit_surface(false), particle_type(ParticleType_Smoke) {}
+
+	Vec4f pos;
+	Vec4f vel;
+
+	Colour3f colour;
+
+	float area; // particle cross-sectional area (m^2).  Larger area = more wind drag.  TODO: just store ratio of area to mass?
+	float mass;
+	float restitution; // "Restitution of body (dimensionless number, usually between 0 and 1, 0 = completely inelastic collision response, 1 = completely elastic collision response)"
+
+	float width;
+	float dwidth_dt;
+
+	float cur_opacity;
+	float dopacity_dt;
+
+	float theta; // rotation around axis to camera
+
+	bool die_when_hit_surface;
+
+	ParticleType particle_type;
+};
+
+
+/*=====================================================================
+ParticleEmitter
+---------------
+Emits particles continuously, at emission_rate particles per second.
+Each emitted particle is a copy of prototype, with position and velocity
+perturbed by uniformly distributed random offsets in [-spread, spread].
+=====================================================================*/
+struct ParticleEmitter
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	ParticleEmitter() : pos_spread(0.f), vel_spread(0.f), emission_rate(10.f), emission_accum(0.f), in_use(false) {}
+
+	Particle prototype; // prototype.pos is the emitter position.
+	Vec4f pos_spread;
+	Vec4f vel_spread;
+	float emission_rate; // particles / s
+
+	float emission_accum; // Fractional number of particles not yet emitted.
+	bool in_use;
+};
+
+
+/*=====================================================================
+ParticleSimulation
+------------------
+Particle state and physics, without any graphics, used by ParticleManager.
+
+Particles are stored in a fixed-capacity pool, in structure-of-arrays form,
+so that the integration step can update 4 particles at a time with SIMD
+operations.  Arrays are padded to a multiple of 4 particles.
+
+Collisions are found by tracing a ray along each particle's path for the
+time step.  The rays are traced in batches on a task manager, and each batch
+first does a single broad-phase query with the AABB of the batch's particle
+paths, so batches of particles in open space don't need any ray traces.
+
+Removal of particles is done with swap-with-last, so particle indices are
+not stable across think() calls.  ParticleManager keeps graphics objects in
+an array parallel to the particle arrays.
+=====================================================================*/
+class ParticleSimulation
+{
+public:
+	ParticleSimulation(size_t max_num_particles);
+	~ParticleSimulation();
+
+	// Adds a particle.  If the pool is full, a random existing particle is replaced.  Returns the index of the new particle.
+	// If replaced_existing_out is set to true, the particle previously at the returned index was overwritten.
+	size_t addParticle(const Particle& particle, bool& replaced_existing_out);
+
+	// Removes particle i, by moving the last particle into its position.
+	void removeParticle(size_t i);
+
+	void clear();
+
+	//---------------------------------- Emitters ----------------------------------
+	// Returns a handle (index) for the emitter.
+	int addEmitter(const ParticleEmitter& emitter);
+	void removeEmitter(int emitter_handle);
+	void setEmitterPos(int emitter_handle, const Vec4f& pos);
+	size_t numEmitters() const { return num_emitters_in_use; }
+
+	// Creates particles from emitters, for a time step of dt.  The new particles are appended to new_particles_out.
+	void emitParticles(float dt, js::Vector<Particle, 16>& new_particles_out);
+	//------------------------------------------------------------------------------
+
+	// Collision of a particle with the water surface, which may be used to create a foam decal.
+	struct WaterHit
+	{
+		Vec4f pos;
+		float width;
+	};
+
+	// Steps the particles forward by dt.
+	// physics_world may be null, in which case there are no collisions with objects.
+	// If task_manager is non-null, collision queries are done in parallel on it.
+	// Particles with opacity <= 0 should be removed by the caller after think().
+	void think(float dt, PhysicsWorld* physics_world, glare::TaskManager* task_manager, bool water_buoyancy_enabled, float water_z, std::vector<WaterHit>& water_hits_out);
+
+	size_t size() const { return num_particles; }
+	size_t capacity() const { return max_num_particles; }
+
+	inline Vec4f getPos(size_t i) const { return Vec4f(pos_x[i], pos_y[i], pos_z[i], 1.f); }
+	inline Vec4f getVel(size_t i) const { return Vec4f(vel_x[i], vel_y[i], vel_z[i], 0.f); }
+	inline float getWidth(size_t i) const { return width[i]; }
+	inline float getOpacity(size_t i) const { return opacity[i]; }
+	inline float getTheta(size_t i) const { return theta[i]; }
+
+	static void test();
+
+private:
+	void computeCollisions(float dt, PhysicsWorld* physics_world, glare::TaskManager* task_manager);
+	void applyCollisions(float dt);
+	void integrate(float dt, bool water_buoyancy_enabled, float water_z, std::vector<WaterHit>& water_hits_out);
+
+	void setParticle(size_t i, const Particle& particle);
+	void copyParticle(size_t src, size_t dest);
+	void resizeArrays(size_t new_size);
+
+public:
+	// Per-particle state, in structure-of-arrays form.
+	js::Vector<float, 16> pos_x, pos_y, pos_z;
+	js::Vector<float, 16> vel_x, vel_y, vel_z;
+	js::Vector<float, 16> area_over_mass;
+	js::Vector<float, 16> restitution;
+	js::Vector<float, 16> width, dwidth_dt;
+	js::Vector<float, 16> opacity, dopacity_dt;
+	js::Vector<float, 16> theta;
+	js::Vector<float, 16> die_when_hit_surface; // 1 if particle should die when it hits a surface, 0 otherwise.
+
+	// Collision results from computeCollisions()
+	js::Vector<float, 16> hit_t; // Time until hit, or -1 if no hit.
+	js::Vector<Vec4f, 16> hit_normal;
+	js::Vector<float, 16> moved_by_collision; // 1 if the particle's position was updated by collision response this step, 0 otherwise.
+
+private:
+	size_t num_particles;
+	size_t max_num_particles;
+	PCG32 rng;
+
+	std::vector<ParticleEmitter> emitters;
+	std::vector<int> free_emitter_handles;
+	size_t num_emitters_in_use;
+
+	Reference<glare::TaskGroup> collision_task_group;
+};
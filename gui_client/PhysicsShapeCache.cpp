@@ -0,0 +1,196 @@
+/*=====================================================================
+PhysicsShapeCache.cpp
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "PhysicsShapeCache.h"
+
+
+#include "PhysicsWorld.h"
+#include "DiskCacheFile.h"
+#include "../shared/JoltShapeBuilding.h"
+#include <utils/FileUtils.h>
+#include <utils/ConPrint.h>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+
+
+static const uint32 PHYSICS_SHAPE_CACHE_MAGIC_NUMBER = 0x5A3C9E71;
+static const uint32 PHYSICS_SHAPE_CACHE_VERSION = 3; // Increment when the file format, or the way shapes are built, changes.
+
+
+// DiskCacheFile payload:
+// Shape resource data (see JoltShapeBuilding::encodeShapeResource(), includes the Jolt version)
+
+
+PhysicsShapeCache::PhysicsShapeCache(const std::string& cache_dir_)
+:	cache_dir(cache_dir_)
+{
+	try
+	{
+		FileUtils::createDirIfDoesNotExist(cache_dir);
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		conPrint("PhysicsShapeCache: failed to create cache dir: " + e.what());
+	}
+}
+
+
+PhysicsShapeCache::~PhysicsShapeCache()
+{}
+
+
+// Key is the dynamic flag followed by the model URL.
+void PhysicsShapeCache::makeKey(const URLString& model_url, bool dynamic, std::vector<uint8>& key_out)
+{
+	key_out.resize(1 + model_url.size());
+	key_out[0] = dynamic ? 1 : 0;
+	std::memcpy(key_out.data() + 1, model_url.data(), model_url.size());
+}
+
+
+std::string PhysicsShapeCache::getPathForKey(const URLString& model_url, bool dynamic) const
+{
+	std::vector<uint8> key;
+	makeKey(model_url, dynamic, key);
+	return DiskCacheFile::getPathForKey(cache_dir, key, ".joltshape");
+}
+
+
+bool PhysicsShapeCache::tryLoadShape(const URLString& model_url, bool dynamic, PhysicsShape& shape_out)
+{
+	ZoneScoped; // Tracy profiler
+
+	std::vector<uint8> key;
+	makeKey(model_url, dynamic, key);
+
+	const bool loaded = DiskCacheFile::tryReadFile(DiskCacheFile::getPathForKey(cache_dir, key, ".joltshape"), PHYSICS_SHAPE_CACHE_MAGIC_NUMBER, PHYSICS_SHAPE_CACHE_VERSION, key, "PhysicsShapeCache",
+		[&](DiskCacheFile::Reader& reader)
+		{
+			shape_out.jolt_shape = JoltShapeBuilding::decodeShapeResource(reader.currentData(), reader.bytesRemaining());
+			shape_out.size_B = PhysicsWorld::computeSizeBForShape(shape_out.jolt_shape);
+		});
+
+	if(loaded)
+		num_hits.increment();
+	else
+		num_misses.increment();
+	return loaded;
+}
+
+
+void PhysicsShapeCache::storeShape(const URLString& model_url, bool dynamic, const PhysicsShape& shape)
+{
+	ZoneScoped; // Tracy profiler
+
+	if(!shape.jolt_shape)
+		return;
+
+	std::vector<uint8> key;
+	makeKey(model_url, dynamic, key);
+
+	std::vector<uint8> file_data;
+	DiskCacheFile::beginFile(PHYSICS_SHAPE_CACHE_MAGIC_NUMBER, PHYSICS_SHAPE_CACHE_VERSION, key, file_data);
+	JoltShapeBuilding::encodeShapeResource(*shape.jolt_shape, file_data);
+
+	DiskCacheFile::writeFile(DiskCacheFile::getPathForKey(cache_dir, key, ".joltshape"), file_data, "PhysicsShapeCache");
+}
+
+
+#if BUILD_TESTS
+
+
+#include "MeshBuilding.h"
+#include <utils/TestUtils.h>
+#include <utils/PlatformUtils.h>
+
+
+static std::vector<uint8> serialiseShape(const JPH::Shape* shape)
+{
+	std::vector<uint8> data;
+	JoltShapeBuilding::serialiseShape(*shape, data);
+	return data;
+}
+
+
+void PhysicsShapeCache::test()
+{
+	conPrint("PhysicsShapeCache::test()");
+
+	// PhysicsWorld::init() needs to have been called already.
+
+	try
+	{
+		const std::string cache_dir = PlatformUtils::getTempDirPath() + "/physics_shape_cache_test";
+		Reference<PhysicsShapeCache> cache = new PhysicsShapeCache(cache_dir);
+		DiskCacheFile::deleteFilesInDir(cache_dir);
+
+		Reference<Indigo::Mesh> mesh = MeshBuilding::makeUnitCubeIndigoMesh();
+		const URLString url("unit_cube_1234.bmesh");
+
+		for(int dynamic=0; dynamic<2; ++dynamic)
+		{
+			// Should miss before the shape is stored
+			PhysicsShape loaded_shape;
+			testAssert(!cache->tryLoadShape(url, dynamic != 0, loaded_shape));
+
+			const PhysicsShape shape = PhysicsWorld::createJoltShapeForIndigoMesh(*mesh, /*build_dynamic_physics_ob=*/dynamic != 0);
+			cache->storeShape(url, dynamic != 0, shape);
+
+			testAssert(cache->tryLoadShape(url, dynamic != 0, loaded_shape));
+			testAssert(loaded_shape.jolt_shape);
+			testAssert(loaded_shape.jolt_shape->GetSubType() == shape.jolt_shape->GetSubType());
+			testAssert(loaded_shape.size_B == shape.size_B);
+			testAssert(serialiseShape(loaded_shape.jolt_shape.GetPtr()) == serialiseShape(shape.jolt_shape.GetPtr()));
+
+			const JPH::AABox orig_bounds = shape.jolt_shape->GetLocalBounds();
+			const JPH::AABox loaded_bounds = loaded_shape.jolt_shape->GetLocalBounds();
+			testAssert(orig_bounds.mMin == loaded_bounds.mMin && orig_bounds.mMax == loaded_bounds.mMax);
+		}
+
+		// Static and dynamic entries should be distinct
+		{
+			PhysicsShape static_shape, dynamic_shape;
+			testAssert(cache->tryLoadShape(url, /*dynamic=*/false, static_shape));
+			testAssert(cache->tryLoadShape(url, /*dynamic=*/true, dynamic_shape));
+			testAssert(static_shape.jolt_shape->GetSubType() != dynamic_shape.jolt_shape->GetSubType());
+		}
+
+		// A different URL should miss
+		{
+			PhysicsShape loaded_shape;
+			testAssert(!cache->tryLoadShape(URLString("other_5678.bmesh"), /*dynamic=*/false, loaded_shape));
+		}
+
+		// An invalid cache file should be treated as a miss.  (See DiskCacheFile::test() for tests of corrupted and truncated files.)
+		{
+			FileUtils::writeEntireFile(cache->getPathForKey(url, /*dynamic=*/false), "invalid", 7);
+
+			PhysicsShape loaded_shape;
+			testAssert(!cache->tryLoadShape(url, /*dynamic=*/false, loaded_shape));
+		}
+
+		// A new cache object using the same dir should see the dynamic entry stored by the first cache object.
+		{
+			Reference<PhysicsShapeCache> cache2 = new PhysicsShapeCache(cache_dir);
+			PhysicsShape loaded_shape;
+			testAssert(cache2->tryLoadShape(url, /*dynamic=*/true, loaded_shape));
+		}
+
+		DiskCacheFile::deleteFilesInDir(cache_dir);
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("PhysicsShapeCache::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,64 @@
+/*=====================================================================
+PhysicsShapeCache.h
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "PhysicsObject.h"
+#include "../shared/URLString.h"
+#include <ThreadSafeRefCounted.h>
+#include <AtomicInt.h>
+#include <string>
+#include <vector>
+
+
+/*=====================================================================
+PhysicsShapeCache
+-----------------
+On-disk cache of cooked Jolt physics shapes, so that the mesh shape or
+convex hull for a model doesn't need to be rebuilt every session.
+
+Shapes are serialised with Jolt's binary shape serialisation
+(Shape::SaveWithChildren), one file per shape, in cache_dir.
+
+Cache entries are keyed by model URL and whether the shape is a dynamic
+(convex hull) shape.  Model URLs include a hash of the model contents, so
+entries never need to be invalidated when a model changes.  Shapes are built
+unscaled (object scale is applied when the physics object is created), so the
+object scale doesn't need to be part of the key.
+
+Files use the DiskCacheFile format, which stores the full key and a
+checksum, so hash collisions and truncated or corrupted files are detected
+and treated as cache misses.
+
+Threadsafe.
+=====================================================================*/
+class PhysicsShapeCache : public ThreadSafeRefCounted
+{
+public:
+	// Creates cache_dir if it doesn't exist already.
+	PhysicsShapeCache(const std::string& cache_dir);
+	~PhysicsShapeCache();
+
+	// Returns true and sets shape_out if there is a valid cache entry for the given model URL and dynamic flag.
+	bool tryLoadShape(const URLString& model_url, bool dynamic, PhysicsShape& shape_out);
+
+	// Writes the shape to the cache.  Failures to write are ignored (apart from printing a message), since the cache is just an optimisation.
+	void storeShape(const URLString& model_url, bool dynamic, const PhysicsShape& shape);
+
+	std::string getPathForKey(const URLString& model_url, bool dynamic) const;
+
+	size_t numHits() const { return (size_t)num_hits; }
+	size_t numMisses() const { return (size_t)num_misses; }
+
+	static void test();
+
+private:
+	static void makeKey(const URLString& model_url, bool dynamic, std::vector<uint8>& key_out);
+
+	std::string cache_dir;
+	glare::AtomicInt num_hits;
+	glare::AtomicInt num_misses;
+};
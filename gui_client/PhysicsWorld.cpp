@@ -25,6 +25,7 @@ Copyright Glare Technologies Limited 2022 -
 #include <stdarg.h>
 #include <Lock.h>
 #include "JoltUtils.h"
+#include "../shared/JoltShapeBuilding.h"
 
 
 #if USE_JOLT
@@ -54,6 +55,7 @@ Copyright Glare Technologies Limited 2022 -
 #include <Jolt/Physics/Collision/BroadPhase/BroadPhaseQuery.h>
 #include <Jolt/Physics/Collision/RayCast.h>
 #include <Jolt/Physics/Collision/CastResult.h>
+#include <Jolt/Physics/Collision/CollisionCollectorImpl.h>
 #include <Jolt/Physics/Collision/Shape/OffsetCenterOfMassShape.h>
 #endif
 #include <HashSet.h>
@@ -811,275 +813,14 @@ PhysicsShape PhysicsWorld::createJoltShapeForIndigoMesh(const Indigo::Mesh& mesh
 }
 
 
-inline static Vec4f transformSkinnedVertex(const Vec4f vert_pos, size_t joint_offset_B, size_t weights_offset_B, BatchedMesh::ComponentType joints_component_type, BatchedMesh::ComponentType weights_component_type,
-	const js::Vector<Matrix4f, 16>& joint_matrices, const uint8* src_vertex_data, const size_t vert_size_B, size_t i)
-{
-	// Read joint indices
-	uint32 use_joints[4];
-	if(joints_component_type == BatchedMesh::ComponentType_UInt8)
-	{
-		uint8 joints[4];
-		std::memcpy(joints, &src_vertex_data[i * vert_size_B + joint_offset_B], sizeof(uint8) * 4);
-		for(int z=0; z<4; ++z)
-			use_joints[z] = joints[z];
-	}
-	else
-	{
-		assert(joints_component_type == BatchedMesh::ComponentType_UInt16);
-
-		uint16 joints[4];
-		std::memcpy(joints, &src_vertex_data[i * vert_size_B + joint_offset_B], sizeof(uint16) * 4);
-		for(int z=0; z<4; ++z)
-			use_joints[z] = joints[z];
-	}
-
-	// Read weights
-	float use_weights[4];
-	if(weights_component_type == BatchedMesh::ComponentType_UInt8)
-	{
-		uint8 weights[4];
-		std::memcpy(weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(uint8) * 4);
-		for(int z=0; z<4; ++z)
-			use_weights[z] = weights[z] * (1.0f / 255.f);
-	}
-	else if(weights_component_type == BatchedMesh::ComponentType_UInt16)
-	{
-		uint16 weights[4];
-		std::memcpy(weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(uint16) * 4);
-		for(int z=0; z<4; ++z)
-			use_weights[z] = weights[z] * (1.0f / 65535.f);
-	}
-	else
-	{
-		assert(weights_component_type == BatchedMesh::ComponentType_Float);
-
-		std::memcpy(use_weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(float) * 4);
-	}
-
-	for(int z=0; z<4; ++z)
-		assert(use_joints[z] < (uint32)joint_matrices.size());
-	
-	return
-		joint_matrices[use_joints[0]] * vert_pos * use_weights[0] + // joint indices should have been bound checked in BatchedMesh::checkValidAndSanitiseMesh()
-		joint_matrices[use_joints[1]] * vert_pos * use_weights[1] + 
-		joint_matrices[use_joints[2]] * vert_pos * use_weights[2] + 
-		joint_matrices[use_joints[3]] * vert_pos * use_weights[3];
-}
-
-
-
-PhysicsShape PhysicsWorld::createJoltShapeForBatchedMesh(const BatchedMesh& mesh, bool build_dynamic_physics_ob, glare::Allocator* mem_allocator, 
+PhysicsShape PhysicsWorld::createJoltShapeForBatchedMesh(const BatchedMesh& mesh, bool build_dynamic_physics_ob, glare::Allocator* /*mem_allocator*/, 
 		const js::Vector<bool>* create_tris_for_mat) // Should physics triangles be created for this material?  If null, triangles will be created.
 {
-	ZoneScoped; // Tracy profiler
-
-	const size_t vert_size_B = mesh.vertexSize();
-	const size_t num_verts = mesh.numVerts();
-	const size_t num_tris = mesh.numIndices() / 3;
-
-	const BatchedMesh::VertAttribute* pos_attr = mesh.findAttribute(BatchedMesh::VertAttribute_Position);
-	if(!pos_attr)
-		throw glare::Exception("Pos attribute not present.");
-	if(!(pos_attr->component_type == BatchedMesh::ComponentType_Float || pos_attr->component_type == BatchedMesh::ComponentType_UInt16))
-		throw glare::Exception("PhysicsWorld::createJoltShapeForBatchedMesh(): Pos attribute must have float or uint16 type.");
-	const size_t pos_offset = pos_attr->offset_B;
-
-
-	// If mesh has joints and weights, take the skinning transform into account.
-	const AnimationData& anim_data = mesh.animation_data;
-
-	const bool use_skin_transforms = mesh.findAttribute(BatchedMesh::VertAttribute_Joints) && mesh.findAttribute(BatchedMesh::VertAttribute_Weights) &&
-		!anim_data.joint_nodes.empty();
-
-	js::Vector<Matrix4f, 16> joint_matrices;
-
-	size_t joint_offset_B, weights_offset_B;
-	BatchedMesh::ComponentType joints_component_type, weights_component_type;
-	joint_offset_B = weights_offset_B = 0;
-	joints_component_type = weights_component_type = BatchedMesh::ComponentType_UInt8;
-	if(use_skin_transforms)
-	{
-		js::Vector<Matrix4f, 16> node_matrices;
-
-		const size_t num_nodes = anim_data.sorted_nodes.size();
-		node_matrices.resizeNoCopy(num_nodes);
-
-		for(size_t n=0; n<anim_data.sorted_nodes.size(); ++n)
-		{
-			const int node_i = anim_data.sorted_nodes[n];
-			runtimeCheck(node_i >= 0 && node_i < (int)anim_data.nodes.size()); // All these indices should have been bound checked in BatchedMesh::readFromData(), check again anyway.
-			const AnimationNodeData& node_data = anim_data.nodes[node_i];
-			const Vec4f trans = node_data.trans;
-			const Quatf rot = node_data.rot;
-			const Vec4f scale = node_data.scale;
-
-			const Matrix4f rot_mat = rot.toMatrix();
-			const Matrix4f TRS(
-				rot_mat.getColumn(0) * copyToAll<0>(scale),
-				rot_mat.getColumn(1) * copyToAll<1>(scale),
-				rot_mat.getColumn(2) * copyToAll<2>(scale),
-				setWToOne(trans));
-
-			runtimeCheck(node_data.parent_index >= -1 && node_data.parent_index < (int)node_matrices.size());
-			const Matrix4f node_transform = (node_data.parent_index == -1) ? TRS : (node_matrices[node_data.parent_index] * TRS);
-			node_matrices[node_i] = node_transform;
-		}
-
-		joint_matrices.resizeNoCopy(anim_data.joint_nodes.size());
-
-		for(size_t i=0; i<anim_data.joint_nodes.size(); ++i)
-		{
-			const int node_i = anim_data.joint_nodes[i];
-			runtimeCheck(node_i >= 0 && node_i < (int)node_matrices.size() && node_i >= 0 && node_i < (int)anim_data.nodes.size());
-			joint_matrices[i] = node_matrices[node_i] * anim_data.nodes[node_i].inverse_bind_matrix;
-		}
-
-		const BatchedMesh::VertAttribute& joints_attr = mesh.getAttribute(BatchedMesh::VertAttribute_Joints);
-		joint_offset_B = joints_attr.offset_B;
-		joints_component_type = joints_attr.component_type;
-		runtimeCheck(joints_component_type == BatchedMesh::ComponentType_UInt8 || joints_component_type == BatchedMesh::ComponentType_UInt16); // See BatchedMesh::checkValidAndSanitiseMesh().
-		runtimeCheck((num_verts - 1) * vert_size_B + joint_offset_B + BatchedMesh::vertAttributeSize(joints_attr) <= mesh.vertex_data.size());
-
-		const BatchedMesh::VertAttribute& weights_attr = mesh.getAttribute(BatchedMesh::VertAttribute_Weights);
-		weights_offset_B = weights_attr.offset_B;
-		weights_component_type = weights_attr.component_type;
-		runtimeCheck(weights_component_type == BatchedMesh::ComponentType_UInt8 || weights_component_type == BatchedMesh::ComponentType_UInt16 || weights_component_type == BatchedMesh::ComponentType_Float); // See BatchedMesh::checkValidAndSanitiseMesh().
-		runtimeCheck((num_verts - 1) * vert_size_B + weights_offset_B + BatchedMesh::vertAttributeSize(weights_attr) <= mesh.vertex_data.size());
-	}
-
-
-	const bool pos_is_float = pos_attr->component_type == BatchedMesh::ComponentType_Float;
-	const Vec4f dequantisation_scale = div(mesh.aabb_os.span(), Vec4f(65535.f));
-
-	if(build_dynamic_physics_ob)
-	{
-		// Jolt doesn't support dynamic triangles mesh shapes, so we need to convert it to a convex hull shape.
-		JPH::Array<JPH::Vec3> points(num_verts);
-
-		const uint8* src_vertex_data = mesh.vertex_data.data();
-		for(size_t i = 0; i < num_verts; ++i)
-		{
-			Vec4f vert_pos(1.f);
-			if(pos_is_float)
-				std::memcpy(&vert_pos, src_vertex_data + pos_offset + i * vert_size_B, sizeof(::Vec3f));
-			else
-			{
-				uint16 vals[3];
-				std::memcpy(vals, src_vertex_data + pos_offset + i * vert_size_B, sizeof(uint16) * 3);
-				vert_pos = mesh.aabb_os.min_ + dequantisation_scale * Vec4f((float)vals[0], (float)vals[1], (float)vals[2], 0);
-				assert(vert_pos[3] == 1.f);
-			}
-
-			if(use_skin_transforms)
-				vert_pos = transformSkinnedVertex(vert_pos, joint_offset_B, weights_offset_B, joints_component_type, weights_component_type, joint_matrices, src_vertex_data, vert_size_B, i);
-
-			points[i] = JPH::Vec3(vert_pos[0], vert_pos[1], vert_pos[2]);
-		}
-
-		JPH::Ref<JPH::ConvexHullShapeSettings> hull_shape_settings = new JPH::ConvexHullShapeSettings(
-			points
-		);
-
-		JPH::Result<JPH::Ref<JPH::Shape>> result = hull_shape_settings->Create();
-		if(result.HasError())
-			throw glare::Exception(std::string("Error building Jolt shape: ") + result.GetError().c_str());
-		JPH::Ref<JPH::Shape> jolt_shape = result.Get();
-		PhysicsShape shape;
-		shape.jolt_shape = jolt_shape;
-		shape.size_B = computeSizeBForShape(jolt_shape);
-		return shape;
-	}
-	else
-	{
-		JPH::VertexList vertex_list(num_verts);
-		JPH::IndexedTriangleList tri_list(num_tris);
-
-		// Copy Vertices
-		const uint8* src_vertex_data = mesh.vertex_data.data();
-		for(size_t i = 0; i < num_verts; ++i)
-		{
-			Vec4f vert_pos(1.f);
-			if(pos_is_float)
-				std::memcpy(&vert_pos, src_vertex_data + pos_offset + i * vert_size_B, sizeof(::Vec3f));
-			else
-			{
-				uint16 vals[3];
-				std::memcpy(vals, src_vertex_data + pos_offset + i * vert_size_B, sizeof(uint16) * 3);
-				vert_pos = mesh.aabb_os.min_ + dequantisation_scale * Vec4f((float)vals[0], (float)vals[1], (float)vals[2], 0);
-				assert(vert_pos[3] == 1.f);
-			}
-
-			if(use_skin_transforms)
-				vert_pos = transformSkinnedVertex(vert_pos, joint_offset_B, weights_offset_B, joints_component_type, weights_component_type, joint_matrices, src_vertex_data, vert_size_B, i);
-
-			vertex_list[i] = JPH::Float3(vert_pos[0], vert_pos[1], vert_pos[2]);
-		}
-
-		// Copy Triangles
-		const BatchedMesh::ComponentType index_type = mesh.index_type;
-
-		const uint8*  const index_data_uint8  = (const uint8* )mesh.index_data.data();
-		const uint16* const index_data_uint16 = (const uint16*)mesh.index_data.data();
-		const uint32* const index_data_uint32 = (const uint32*)mesh.index_data.data();
-
-		unsigned int dest_tri_i = 0;
-		for(size_t b = 0; b < mesh.batches.size(); ++b)
-		{
-			if(!create_tris_for_mat || (mesh.batches[b].material_index >= create_tris_for_mat->size()) || (*create_tris_for_mat)[mesh.batches[b].material_index])
-			{
-				const size_t tri_begin = mesh.batches[b].indices_start / 3;
-				const size_t tri_end   = tri_begin + mesh.batches[b].num_indices / 3;
-				const uint32 mat_index = mesh.batches[b].material_index;
-
-				for(size_t t = tri_begin; t < tri_end; ++t)
-				{
-					uint32 vertex_indices[3];
-					if(index_type == BatchedMesh::ComponentType_UInt8)
-					{
-						vertex_indices[0] = index_data_uint8[t*3 + 0];
-						vertex_indices[1] = index_data_uint8[t*3 + 1];
-						vertex_indices[2] = index_data_uint8[t*3 + 2];
-					}
-					else if(index_type == BatchedMesh::ComponentType_UInt16)
-					{
-						vertex_indices[0] = index_data_uint16[t*3 + 0];
-						vertex_indices[1] = index_data_uint16[t*3 + 1];
-						vertex_indices[2] = index_data_uint16[t*3 + 2];
-					}
-					else if(index_type == BatchedMesh::ComponentType_UInt32)
-					{
-						vertex_indices[0] = index_data_uint32[t*3 + 0];
-						vertex_indices[1] = index_data_uint32[t*3 + 1];
-						vertex_indices[2] = index_data_uint32[t*3 + 2];
-					}
-					else
-					{
-						throw glare::Exception("Invalid index type.");
-					}
-
-					// We store the original material index in the per-triangle user data.
-					// We don't use triangle material index as it's limited to 32 and requires creating PhysicsMaterial objects. 
-					tri_list[dest_tri_i] = JPH::IndexedTriangle(vertex_indices[0], vertex_indices[1], vertex_indices[2], /*inMaterialIndex=*/0, /*inUserData=*/mat_index);
-
-					dest_tri_i++;
-				}
-			}
-		}
-
-		tri_list.resize(dest_tri_i);
-
-		JPH::Ref<JPH::MeshShapeSettings> mesh_body_settings = new JPH::MeshShapeSettings(vertex_list, tri_list);
-		mesh_body_settings->mPerTriangleUserData = true; // We store the original material index in the per-triangle user data.
-
-		JPH::Result<JPH::Ref<JPH::Shape>> result = mesh_body_settings->Create();
-		if(result.HasError())
-			throw glare::Exception(std::string("Error building Jolt shape: ") + result.GetError().c_str());
-		JPH::Ref<JPH::Shape> jolt_shape = result.Get();
-		PhysicsShape shape;
-		shape.jolt_shape = jolt_shape;
-		shape.size_B = computeSizeBForShape(jolt_shape);
-		return shape;
-	}
+	JPH::Ref<JPH::Shape> jolt_shape = JoltShapeBuilding::buildShapeForBatchedMesh(mesh, build_dynamic_physics_ob, create_tris_for_mat);
+	PhysicsShape shape;
+	shape.jolt_shape = jolt_shape;
+	shape.size_B = computeSizeBForShape(jolt_shape);
+	return shape;
 }
 
 
@@ -1725,6 +1466,15 @@ bool PhysicsWorld::doesRayHitAnything(const Vec4f& origin, const Vec4f& dir, flo
 }
 
 
+bool PhysicsWorld::doesAABBOverlapAnyBodies(const js::AABBox& aabb) const
+{
+	const JPH::AABox box(toJoltVec3(aabb.min_), toJoltVec3(aabb.max_));
+	JPH::AnyHitCollisionCollector<JPH::CollideShapeBodyCollector> collector;
+	this->physics_system->GetBroadPhaseQuery().CollideAABox(box, collector);
+	return collector.HadHit();
+}
+
+
 void PhysicsWorld::writeJoltSnapshotToDisk(const std::string& path)
 {
 	// Convert physics system to scene
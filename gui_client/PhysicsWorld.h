@@ -184,6 +184,9 @@ public:
 
 	bool doesRayHitAnything(const Vec4f& origin, const Vec4f& dir, float max_t) const;
 
+	// Returns true if the broad-phase bounds of any body overlap the given AABB.  Cheaper than ray tracing, so can be used to cull batches of queries.
+	bool doesAABBOverlapAnyBodies(const js::AABBox& aabb) const;
+
 	void writeJoltSnapshotToDisk(const std::string& path);
 
 	static size_t computeSizeBForShape(JPH::Ref<JPH::Shape> jolt_shape);
@@ -295,19 +295,8 @@ void ProximityLoader::updateCamPos(const Vec4f& new_cam_pos)
 
 std::string ProximityLoader::getDiagnostics() const
 {
-	size_t num_obs = 0;
+	const size_t num_obs = ob_grid.numObjects();
 	size_t num_in_proximity_obs = 0;
-	for(size_t i=0; i<ob_grid.buckets.size(); ++i)
-	{
-		for(auto it = ob_grid.buckets[i].objects.begin(); it != ob_grid.buckets[i].objects.end(); ++it)
-		{
-			//const WorldObject* ob = it->ptr();
-
-			num_obs++;
-			//if(ob->in_proximity)
-			//	num_in_proximity_obs++;
-		}
-	}
 
 	return "Obs: " + toString(num_obs) + " (in proximity: " + toString(num_in_proximity_obs) + ", out of proximity: " + toString(num_obs - num_in_proximity_obs) + ")";
 }
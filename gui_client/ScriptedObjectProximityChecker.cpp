@@ -11,6 +11,13 @@ Copyright Glare Technologies Limited 2024 -
 #include "../shared/ObjectEventHandlers.h"
 #include "../shared/MessageUtils.h"
 #include "../shared/Protocol.h"
+#include <opengl/OpenGLEngine.h>
+#include <limits>
+
+
+static const float SCRIPT_PROXIMITY_DIST = 20.f; // Distance from camera to object AABB at which the object is considered to be in proximity.
+static const float GRID_CELL_W = 32.f; // Should be >= SCRIPT_PROXIMITY_DIST so that queries only touch a few cells.
+static const int MAX_NUM_CELLS_PER_OB = 64; // Objects spanning more cells than this are put in large_objects instead.
 
 
 static void enqueueMessageToSend(ClientThread& client_thread, SocketBufferOutStream& packet)
@@ -22,7 +29,12 @@ static void enqueueMessageToSend(ClientThread& client_thread, SocketBufferOutStr
 
 
 ScriptedObjectProximityChecker::ScriptedObjectProximityChecker()
-:	objects(/*empty_val=*/WorldObjectRef())
+:	objects(/*empty_val=*/WorldObjectRef()),
+	gui_client(NULL),
+	cell_w(GRID_CELL_W),
+	recip_cell_w(1 / GRID_CELL_W),
+	cells(/*empty key=*/Vec3<int>(std::numeric_limits<int>::max())),
+	ob_binnings(/*empty key=*/NULL)
 {}
 
 
@@ -30,61 +42,513 @@ ScriptedObjectProximityChecker::~ScriptedObjectProximityChecker()
 {}
 
 
+void ScriptedObjectProximityChecker::addObject(WorldObjectRef ob)
+{
+	if(ob_binnings.find(ob.ptr()) != ob_binnings.end()) // If already added:
+		return;
+
+	objects.insert(ob);
+
+	const ScriptedObBinning binning = computeBinning(ob.ptr());
+	insertIntoCells(ob.ptr(), binning.cell_range);
+	ob_binnings[ob.ptr()] = binning;
+
+	// If the object is already marked as in proximity (e.g. its script was just reloaded), track it so we can send the moved-away event later.
+	if(ob->in_script_proximity)
+		in_proximity_obs.push_back(ob.ptr());
+}
+
+
+void ScriptedObjectProximityChecker::removeObject(WorldObjectRef ob)
+{
+	auto res = ob_binnings.find(ob.ptr());
+	if(res != ob_binnings.end())
+	{
+		removeFromCells(ob.ptr(), res->second.cell_range);
+		ob_binnings.erase(ob.ptr());
+	}
+
+	for(size_t i=0; i<in_proximity_obs.size(); ++i)
+		if(in_proximity_obs[i] == ob.ptr())
+		{
+			in_proximity_obs[i] = in_proximity_obs.back();
+			in_proximity_obs.pop_back();
+			break;
+		}
+
+	objects.erase(ob);
+}
+
+
 void ScriptedObjectProximityChecker::clear()
 {
 	objects.clear();
+	cells.clear();
+	ob_binnings.clear();
+	large_objects.clear();
+	in_proximity_obs.clear();
 }
 
 
-// Iterate over objects, see if the player has moved near to or away from any objects, and execute the relevant event handlers if so.
-void ScriptedObjectProximityChecker::think(const Vec4f& campos, WorldStateLock& world_state_lock)
+void ScriptedObjectProximityChecker::objectTransformChanged(WorldObject* ob)
 {
-	WorldObjectRef* const objects_data = objects.vector.data();
-	const size_t objects_size          = objects.vector.size();
+	auto res = ob_binnings.find(ob);
+	if(res == ob_binnings.end()) // If object is not in the checker:
+		return;
 
-	for(size_t i=0; i<objects_size; ++i)
+	const ScriptedObBinning new_binning = computeBinning(ob);
+	if(new_binning.cell_range != res->second.cell_range)
 	{
-		if(i + 16 < objects_size)
-			_mm_prefetch((const char*)(&objects_data[i + 16]->centroid_ws), _MM_HINT_T0);
+		removeFromCells(ob, res->second.cell_range);
+		insertIntoCells(ob, new_binning.cell_range);
+	}
+	res->second = new_binning;
+}
 
-		WorldObject* const ob = objects_data[i].ptr();
 
-		const bool cur_in_proximity = ob->in_script_proximity;
+// Returns the current world-space AABB of the object.
+// Kinematic path-controlled objects and objects with Winter scripts are moved by updating the OpenGL object transform, without changing ob->pos, so use the OpenGL object AABB if there is one.
+static inline js::AABBox getCurrentAABBWS(const WorldObject* ob)
+{
+	return ob->opengl_engine_ob ? ob->opengl_engine_ob->aabb_ws : ob->getAABBWS();
+}
+
+
+ScriptedObBinning ScriptedObjectProximityChecker::computeBinning(const WorldObject* ob) const
+{
+	const js::AABBox aabb_ws = getCurrentAABBWS(ob);
+
+	ScriptedObBinning binning;
+	binning.aabb_min = Vec3f(aabb_ws.min_[0], aabb_ws.min_[1], aabb_ws.min_[2]);
+	binning.aabb_max = Vec3f(aabb_ws.max_[0], aabb_ws.max_[1], aabb_ws.max_[2]);
+
+	ScriptedObCellRange& range = binning.cell_range;
+	const Vec4i min_i = floorToVec4i(aabb_ws.min_ * recip_cell_w);
+	const Vec4i max_i = floorToVec4i(aabb_ws.max_ * recip_cell_w);
+	range.min = Vec3<int>(min_i[0], min_i[1], min_i[2]);
+	range.max = Vec3<int>(max_i[0], max_i[1], max_i[2]);
+
+	// Compute number of cells spanned in floating point to avoid integer overflow for huge AABBs.  The negated comparison also handles NaNs.
+	const float num_cells = ((float)range.max.x - (float)range.min.x + 1) * ((float)range.max.y - (float)range.min.y + 1) * ((float)range.max.z - (float)range.min.z + 1);
+	range.is_large = !(num_cells <= (float)MAX_NUM_CELLS_PER_OB);
+	if(range.is_large)
+		range.min = range.max = Vec3<int>(0);
+	return binning;
+}
+
+
+void ScriptedObjectProximityChecker::insertIntoCells(WorldObject* ob, const ScriptedObCellRange& range)
+{
+	if(range.is_large)
+	{
+		large_objects.push_back(ob);
+		return;
+	}
+
+	for(int z=range.min.z; z<=range.max.z; ++z)
+	for(int y=range.min.y; y<=range.max.y; ++y)
+	for(int x=range.min.x; x<=range.max.x; ++x)
+		cells[Vec3<int>(x, y, z)].objects.push_back(ob);
+}
 
-		const Vec4f closest_point_in_aabb = ob->getAABBWS().getClosestPointInAABB(campos);
-		const float dist2 = campos.getDist2(closest_point_in_aabb);
-		const bool new_in_proximity = dist2 < Maths::square(20.f);
 
-		if(new_in_proximity != cur_in_proximity)
+static void removeFromVector(std::vector<WorldObject*>& v, WorldObject* ob)
+{
+	for(size_t i=0; i<v.size(); ++i)
+		if(v[i] == ob)
 		{
-			ob->in_script_proximity = new_in_proximity;
+			v[i] = v.back();
+			v.pop_back();
+			return;
+		}
+}
+
 
-			if(new_in_proximity)
+void ScriptedObjectProximityChecker::removeFromCells(WorldObject* ob, const ScriptedObCellRange& range)
+{
+	if(range.is_large)
+	{
+		removeFromVector(large_objects, ob);
+		return;
+	}
+
+	for(int z=range.min.z; z<=range.max.z; ++z)
+	for(int y=range.min.y; y<=range.max.y; ++y)
+	for(int x=range.min.x; x<=range.max.x; ++x)
+	{
+		const Vec3<int> key(x, y, z);
+		auto res = cells.find(key);
+		if(res != cells.end())
+		{
+			removeFromVector(res->second.objects, ob);
+			if(res->second.objects.empty())
+				cells.erase(key);
+		}
+	}
+}
+
+
+static inline bool isAABBInProximity(const js::AABBox& aabb_ws, const Vec4f& campos)
+{
+	const Vec4f closest_point_in_aabb = aabb_ws.getClosestPointInAABB(campos);
+	return campos.getDist2(closest_point_in_aabb) < Maths::square(SCRIPT_PROXIMITY_DIST);
+}
+
+
+// Uses the AABB the object was binned with, so that the result is consistent with the cells the object is in.
+bool ScriptedObjectProximityChecker::isObInProximity(WorldObject* ob, const Vec4f& campos) const
+{
+	auto res = ob_binnings.find(ob);
+	if(res == ob_binnings.end())
+	{
+		assert(0);
+		return false;
+	}
+	const ScriptedObBinning& binning = res->second;
+	return isAABBInProximity(js::AABBox(binning.aabb_min.toVec4fPoint(), binning.aabb_max.toVec4fPoint()), campos);
+}
+
+
+// Check the objects near the camera, see if the player has moved near to or away from any objects, and execute the relevant event handlers if so.
+void ScriptedObjectProximityChecker::think(const Vec4f& campos, WorldStateLock& world_state_lock)
+{
+	temp_moved_near_obs.clear();
+	temp_moved_away_obs.clear();
+
+	// Check objects currently in proximity, to see if the camera has moved away from them.
+	for(size_t i=0; i<in_proximity_obs.size();)
+	{
+		WorldObject* const ob = in_proximity_obs[i];
+		if(!isObInProximity(ob, campos))
+		{
+			ob->in_script_proximity = false;
+			temp_moved_away_obs.push_back(ob);
+
+			in_proximity_obs[i] = in_proximity_obs.back();
+			in_proximity_obs.pop_back();
+		}
+		else
+			++i;
+	}
+
+	// Check objects in grid cells that overlap the proximity radius around the camera, to see if the camera has moved near to them.
+	const Vec4i min_i = floorToVec4i((campos - Vec4f(SCRIPT_PROXIMITY_DIST, SCRIPT_PROXIMITY_DIST, SCRIPT_PROXIMITY_DIST, 0)) * recip_cell_w);
+	const Vec4i max_i = floorToVec4i((campos + Vec4f(SCRIPT_PROXIMITY_DIST, SCRIPT_PROXIMITY_DIST, SCRIPT_PROXIMITY_DIST, 0)) * recip_cell_w);
+
+	for(int z=min_i[2]; z<=max_i[2]; ++z)
+	for(int y=min_i[1]; y<=max_i[1]; ++y)
+	for(int x=min_i[0]; x<=max_i[0]; ++x)
+	{
+		auto res = cells.find(Vec3<int>(x, y, z));
+		if(res != cells.end())
+		{
+			const std::vector<WorldObject*>& cell_obs = res->second.objects;
+			for(size_t i=0; i<cell_obs.size(); ++i)
 			{
-				if(ob->event_handlers && ob->event_handlers->onUserMovedNearToObject_handlers.nonEmpty())
+				WorldObject* const ob = cell_obs[i];
+				// Objects may be in multiple cells, the in_script_proximity check means we only process each object once.
+				if(!ob->in_script_proximity && isObInProximity(ob, campos))
 				{
-					// Execute any event handlers
-					ob->event_handlers->executeOnUserMovedNearToObjectHandlers(/*avatar_uid=*/gui_client->client_avatar_uid, ob->uid, world_state_lock);
-
-					// Send message to server to execute on server as well
-					MessageUtils::initPacket(gui_client->scratch_packet, Protocol::UserMovedNearToObjectMessage);
-					writeToStream(ob->uid, gui_client->scratch_packet);
-					enqueueMessageToSend(*gui_client->client_thread, gui_client->scratch_packet);
+					ob->in_script_proximity = true;
+					in_proximity_obs.push_back(ob);
+					temp_moved_near_obs.push_back(ob);
 				}
 			}
-			else
-			{
-				if(ob->event_handlers && ob->event_handlers->onUserMovedAwayFromObject_handlers.nonEmpty())
-				{
-					// Execute any event handlers
-					ob->event_handlers->executeOnUserMovedAwayFromObjectHandlers(/*avatar_uid=*/gui_client->client_avatar_uid, ob->uid, world_state_lock);
+		}
+	}
 
-					// Send message to server to execute on server as well
-					MessageUtils::initPacket(gui_client->scratch_packet, Protocol::UserMovedAwayFromObjectMessage);
-					writeToStream(ob->uid, gui_client->scratch_packet);
-					enqueueMessageToSend(*gui_client->client_thread, gui_client->scratch_packet);
-				}
+	for(size_t i=0; i<large_objects.size(); ++i)
+	{
+		WorldObject* const ob = large_objects[i];
+		if(!ob->in_script_proximity && isObInProximity(ob, campos))
+		{
+			ob->in_script_proximity = true;
+			in_proximity_obs.push_back(ob);
+			temp_moved_near_obs.push_back(ob);
+		}
+	}
+
+	// Execute event handlers.  Do this after we have finished iterating over the grid, since the handlers may add or remove objects.
+	for(size_t i=0; i<temp_moved_away_obs.size(); ++i)
+		fireMovedAwayFromEvent(temp_moved_away_obs[i].ptr(), world_state_lock);
+
+	for(size_t i=0; i<temp_moved_near_obs.size(); ++i)
+		fireMovedNearToEvent(temp_moved_near_obs[i].ptr(), world_state_lock);
+
+	temp_moved_near_obs.clear();
+	temp_moved_away_obs.clear();
+}
+
+
+void ScriptedObjectProximityChecker::fireMovedNearToEvent(WorldObject* ob, WorldStateLock& world_state_lock)
+{
+	if(ob->event_handlers && ob->event_handlers->onUserMovedNearToObject_handlers.nonEmpty())
+	{
+		// Execute any event handlers
+		ob->event_handlers->executeOnUserMovedNearToObjectHandlers(/*avatar_uid=*/gui_client->client_avatar_uid, ob->uid, world_state_lock);
+
+		// Send message to server to execute on server as well
+		MessageUtils::initPacket(gui_client->scratch_packet, Protocol::UserMovedNearToObjectMessage);
+		writeToStream(ob->uid, gui_client->scratch_packet);
+		enqueueMessageToSend(*gui_client->client_thread, gui_client->scratch_packet);
+	}
+}
+
+
+void ScriptedObjectProximityChecker::fireMovedAwayFromEvent(WorldObject* ob, WorldStateLock& world_state_lock)
+{
+	if(ob->event_handlers && ob->event_handlers->onUserMovedAwayFromObject_handlers.nonEmpty())
+	{
+		// Execute any event handlers
+		ob->event_handlers->executeOnUserMovedAwayFromObjectHandlers(/*avatar_uid=*/gui_client->client_avatar_uid, ob->uid, world_state_lock);
+
+		// Send message to server to execute on server as well
+		MessageUtils::initPacket(gui_client->scratch_packet, Protocol::UserMovedAwayFromObjectMessage);
+		writeToStream(ob->uid, gui_client->scratch_packet);
+		enqueueMessageToSend(*gui_client->client_thread, gui_client->scratch_packet);
+	}
+}
+
+
+#if BUILD_TESTS
+
+
+#include "../utils/ConPrint.h"
+#include "../utils/StringUtils.h"
+#include "../utils/TestUtils.h"
+#include "../utils/Timer.h"
+#include "../maths/PCG32.h"
+
+
+static WorldObjectRef makeTestObject(const Vec3d& pos, float half_w)
+{
+	WorldObjectRef ob = new WorldObject();
+	ob->pos = pos;
+	ob->axis = Vec3f(0, 0, 1);
+	ob->angle = 0;
+	ob->scale = Vec3f(1.f);
+	ob->setAABBOS(js::AABBox(Vec4f(-half_w, -half_w, -half_w, 1), Vec4f(half_w, half_w, half_w, 1)));
+	return ob;
+}
+
+
+void ScriptedObjectProximityChecker::test()
+{
+	conPrint("ScriptedObjectProximityChecker::test()");
+
+	// Note that think() doesn't dereference gui_client or world_state_lock for objects without event handlers, so we can test without a GUIClient.
+	WorldStateMutex mutex;
+	WorldStateLock lock(mutex);
+
+	//-------------------- Test basic moving near to and away from an object --------------------
+	{
+		ScriptedObjectProximityChecker checker;
+		WorldObjectRef ob = makeTestObject(Vec3d(100, 0, 0), /*half_w=*/1.f);
+		checker.addObject(ob);
+
+		checker.think(Vec4f(0, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		checker.think(Vec4f(85, 0, 0, 1), lock); // Dist to AABB is 14
+		testAssert(ob->in_script_proximity);
+
+		checker.think(Vec4f(130, 0, 0, 1), lock); // Dist to AABB is 29
+		testAssert(!ob->in_script_proximity);
+
+		// Move object to camera, check it gets re-binned.
+		ob->pos = Vec3d(1000, 1000, 0);
+		ob->transformChanged();
+		checker.objectTransformChanged(ob.ptr());
+		checker.think(Vec4f(1005, 1000, 0, 1), lock);
+		testAssert(ob->in_script_proximity);
+
+		// Move object away from camera, check we get moved-away.
+		ob->pos = Vec3d(-1000, 1000, 0);
+		ob->transformChanged();
+		checker.objectTransformChanged(ob.ptr());
+		checker.think(Vec4f(1005, 1000, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		checker.removeObject(ob);
+		testAssert(checker.objects.size() == 0);
+		testAssert(checker.cells.size() == 0);
+	}
+
+	//-------------------- Test a kinematic object moved by updating the OpenGL object transform only --------------------
+	// Path-controlled objects are moved like this, ob->pos stays at the initial position.
+	{
+		ScriptedObjectProximityChecker checker;
+		WorldObjectRef ob = makeTestObject(Vec3d(0, 0, 0), /*half_w=*/1.f);
+		ob->opengl_engine_ob = new GLObject();
+		ob->opengl_engine_ob->aabb_ws = ob->getAABBWS();
+		checker.addObject(ob);
+
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		// Move the object towards the camera, over a few frames, as the physics engine update would.
+		for(int i=1; i<=50; ++i)
+		{
+			const Vec4f pos((float)i * 10, 0, 0, 1);
+			ob->opengl_engine_ob->ob_to_world_matrix = Matrix4f::translationMatrix(pos);
+			ob->opengl_engine_ob->aabb_ws = js::AABBox(pos - Vec4f(1, 1, 1, 0), pos + Vec4f(1, 1, 1, 0));
+			ob->doTransformChanged(ob->opengl_engine_ob->ob_to_world_matrix, ob->scale.toVec4fVector());
+			checker.objectTransformChanged(ob.ptr());
+			checker.think(Vec4f(500, 0, 0, 1), lock);
+			testAssert(ob->in_script_proximity == (i >= 48)); // Dist to AABB is < 20 when i >= 48
+		}
+		testAssert(ob->pos == Vec3d(0, 0, 0));
+
+		// Move the object away again
+		ob->opengl_engine_ob->aabb_ws = js::AABBox(Vec4f(-1, -1, -1, 1), Vec4f(1, 1, 1, 1));
+		checker.objectTransformChanged(ob.ptr());
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		checker.removeObject(ob);
+		testAssert(checker.cells.size() == 0);
+	}
+
+	//-------------------- Test an object whose OpenGL object is created and replaced after it was added --------------------
+	{
+		ScriptedObjectProximityChecker checker;
+		WorldObjectRef ob = makeTestObject(Vec3d(0, 0, 0), /*half_w=*/1.f);
+		checker.addObject(ob); // Binned with ob->getAABBWS(), since there is no OpenGL object yet.
+
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		// Create an OpenGL object at a different position, as for a kinematic object that has already moved.
+		ob->opengl_engine_ob = new GLObject();
+		ob->opengl_engine_ob->aabb_ws = js::AABBox(Vec4f(494, -1, -1, 1), Vec4f(496, 1, 1, 1));
+
+		// Until the object is re-binned, the proximity check should use the AABB the object was binned with.
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+		checker.think(Vec4f(5, 0, 0, 1), lock);
+		testAssert(ob->in_script_proximity);
+
+		checker.objectTransformChanged(ob.ptr());
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(ob->in_script_proximity);
+
+		// Replace the OpenGL object with one back at the origin.
+		ob->opengl_engine_ob = new GLObject();
+		ob->opengl_engine_ob->aabb_ws = ob->getAABBWS();
+		checker.objectTransformChanged(ob.ptr());
+		checker.think(Vec4f(500, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		// Remove the OpenGL object, then move the object.  Removing the object from the checker should still remove it from all the cells it was in.
+		ob->opengl_engine_ob = NULL;
+		ob->pos = Vec3d(1000, 0, 0);
+		ob->transformChanged();
+		checker.removeObject(ob);
+		testAssert(checker.cells.size() == 0);
+		testAssert(checker.large_objects.empty());
+	}
+
+	//-------------------- Test a large object that goes in large_objects --------------------
+	{
+		ScriptedObjectProximityChecker checker;
+		WorldObjectRef ob = makeTestObject(Vec3d(0, 0, 0), /*half_w=*/500.f);
+		checker.addObject(ob);
+		testAssert(checker.large_objects.size() == 1);
+
+		checker.think(Vec4f(510, 0, 0, 1), lock);
+		testAssert(ob->in_script_proximity);
+
+		checker.think(Vec4f(600, 0, 0, 1), lock);
+		testAssert(!ob->in_script_proximity);
+
+		checker.removeObject(ob);
+		testAssert(checker.large_objects.empty());
+	}
+
+	//-------------------- Test against brute force with random objects and camera positions --------------------
+	{
+		ScriptedObjectProximityChecker checker;
+		PCG32 rng(1);
+		std::vector<WorldObjectRef> obs;
+		for(int i=0; i<1000; ++i)
+		{
+			WorldObjectRef ob = makeTestObject(Vec3d(rng.unitRandom() * 400, rng.unitRandom() * 400, rng.unitRandom() * 40), /*half_w=*/rng.unitRandom() * 40);
+			obs.push_back(ob);
+			checker.addObject(ob);
+		}
+
+		for(int t=0; t<1000; ++t)
+		{
+			const Vec4f campos(rng.unitRandom() * 400, rng.unitRandom() * 400, rng.unitRandom() * 40, 1);
+
+			// Move some objects
+			for(int z=0; z<10; ++z)
+			{
+				WorldObject* ob = obs[rng.nextUInt((uint32)obs.size())].ptr();
+				ob->pos += Vec3d(rng.unitRandom() * 20 - 10, rng.unitRandom() * 20 - 10, 0);
+				ob->transformChanged();
+				checker.objectTransformChanged(ob);
 			}
+
+			checker.think(campos, lock);
+
+			for(size_t i=0; i<obs.size(); ++i)
+				testAssert(obs[i]->in_script_proximity == isAABBInProximity(getCurrentAABBWS(obs[i].ptr()), campos));
+		}
+	}
+
+	//-------------------- Perf test with 100k scripted objects --------------------
+	{
+		const int NUM_OBS = 100000;
+		const float world_w = 4000.f;
+
+		ScriptedObjectProximityChecker checker;
+		PCG32 rng(1);
+		std::vector<WorldObjectRef> obs;
+		obs.reserve(NUM_OBS);
+
+		Timer timer;
+		for(int i=0; i<NUM_OBS; ++i)
+		{
+			WorldObjectRef ob = makeTestObject(Vec3d(rng.unitRandom() * world_w, rng.unitRandom() * world_w, rng.unitRandom() * 20), /*half_w=*/0.5f + rng.unitRandom() * 2);
+			obs.push_back(ob);
+			checker.addObject(ob);
+		}
+		conPrint("Adding " + toString(NUM_OBS) + " objects took " + timer.elapsedStringNSigFigs(4));
+
+		const int NUM_FRAMES = 1000;
+		timer.reset();
+		for(int t=0; t<NUM_FRAMES; ++t)
+		{
+			const Vec4f campos((float)t * world_w / NUM_FRAMES, world_w / 2, 2, 1); // Fly across the world
+			checker.think(campos, lock);
+		}
+		conPrint("think() with " + toString(NUM_OBS) + " objects: " + doubleToStringNSigFigs(timer.elapsed() / NUM_FRAMES * 1.0e6, 4) + " us / frame");
+
+		// Compare against the old approach of checking every object every frame.
+		timer.reset();
+		int num_in_proximity = 0;
+		for(int t=0; t<NUM_FRAMES; ++t)
+		{
+			const Vec4f campos((float)t * world_w / NUM_FRAMES, world_w / 2, 2, 1);
+			for(size_t i=0; i<obs.size(); ++i)
+				num_in_proximity += isAABBInProximity(getCurrentAABBWS(obs[i].ptr()), campos) ? 1 : 0;
 		}
+		conPrint("Brute force check of " + toString(NUM_OBS) + " objects: " + doubleToStringNSigFigs(timer.elapsed() / NUM_FRAMES * 1.0e6, 4) + " us / frame (num_in_proximity: " + toString(num_in_proximity) + ")");
+
+		timer.reset();
+		for(int i=0; i<NUM_OBS; ++i)
+		{
+			WorldObject* ob = obs[i].ptr();
+			ob->pos += Vec3d(10, 0, 0);
+			ob->transformChanged();
+			checker.objectTransformChanged(ob);
+		}
+		conPrint("Moving " + toString(NUM_OBS) + " objects took " + timer.elapsedStringNSigFigs(4));
 	}
+
+	conPrint("ScriptedObjectProximityChecker::test() done");
 }
+
+
+#endif // BUILD_TESTS
@@ -7,19 +7,81 @@ Copyright Glare Technologies Limited 2024 -
 
 
 #include "../utils/LinearIterSet.h"
+#include "../utils/HashMap.h"
 #include "../shared/WorldObject.h"
+#include <vector>
 class GUIClient;
 class WorldStateLock;
 
 
+struct ScriptedObCellHashFunc
+{
+	size_t operator() (const Vec3<int>& v) const
+	{
+		// NOTE: technically possible undefined behaviour here (signed overflow)
+		return (size_t)((v.x * 73856093) ^ (v.y * 19349663) ^ (v.z * 83492791));
+	}
+};
+
+
+struct ScriptedObPtrHashFunc
+{
+	size_t operator() (const WorldObject* ob) const
+	{
+		return (size_t)ob >> 3; // Assuming 8-byte aligned, get rid of lower zero bits.
+	}
+};
+
+
+class ScriptedObGridCell
+{
+public:
+	std::vector<WorldObject*> objects;
+};
+
+
+// Range of grid cells that an object was inserted into, or is_large = true if the object was added to the large_objects list instead.
+struct ScriptedObCellRange
+{
+	Vec3<int> min;
+	Vec3<int> max;
+	bool is_large;
+
+	bool operator == (const ScriptedObCellRange& other) const { return (is_large == other.is_large) && (min == other.min) && (max == other.max); }
+	bool operator != (const ScriptedObCellRange& other) const { return !(*this == other); }
+};
+
+
+// The world-space AABB an object was binned with, and the resulting cell range.
+// The proximity checks use this AABB as well, so they always agree with the cells the object is in, even if the object's current AABB has changed
+// (for example because its OpenGL object was created or replaced) and objectTransformChanged() hasn't been called yet.
+struct ScriptedObBinning
+{
+	Vec3f aabb_min;
+	Vec3f aabb_max;
+	ScriptedObCellRange cell_range;
+};
+
+
 /*=====================================================================
 ScriptedObjectProximityChecker
 ------------------------------
-Stores references to all objects that have a script that has one of the 
+Stores references to all objects that have a script that has one of the
 spatial event handlers, for example onUserMovedNearToObject.
 
-Currently just uses linear iteration over such objects but could use some kind of
-spatial acceleration data structure in the future.
+Objects are binned into a uniform hashed grid, based on their world-space AABBs
+(the OpenGL object AABB if the object has an OpenGL object, since kinematic objects are
+moved by updating the OpenGL object transform only).
+Each frame, only the cells overlapping the proximity radius around the camera
+are checked, along with the (small) set of objects that are currently in proximity
+(so that onUserMovedAwayFromObject events are fired for them).
+
+Objects with very large AABBs, that would span a lot of cells, are stored in a separate
+list that is iterated over every frame.
+
+objectTransformChanged() should be called whenever a scripted object's world-space
+AABB changes, including for kinematic and Winter-script-animated objects, and when
+its OpenGL object is created or replaced, so it can be re-binned into the correct cells.
 =====================================================================*/
 class ScriptedObjectProximityChecker
 {
@@ -27,14 +89,39 @@ public:
 	ScriptedObjectProximityChecker();
 	~ScriptedObjectProximityChecker();
 
-	void addObject(WorldObjectRef ob) { objects.insert(ob); }
-	void removeObject(WorldObjectRef ob) { objects.erase(ob); }
+	void addObject(WorldObjectRef ob);
+	void removeObject(WorldObjectRef ob);
 	void clear();
 
-	// Iterate over objects, see if the player has moved near to or away from any objects, and execute the relevant event handlers if so.
+	// Notify the checker that an object may have changed position.  Cheap if the object is not in the checker or hasn't moved to new cells.
+	void objectTransformChanged(WorldObject* ob);
+
+	// Check the objects near the camera, see if the player has moved near to or away from any objects, and execute the relevant event handlers if so.
 	void think(const Vec4f& campos, WorldStateLock& world_state_lock);
 
+	static void test();
+
 	glare::LinearIterSet<WorldObjectRef, WorldObjectRefHash> objects;
 
 	GUIClient* gui_client;
+
+private:
+	ScriptedObBinning computeBinning(const WorldObject* ob) const;
+	void insertIntoCells(WorldObject* ob, const ScriptedObCellRange& range);
+	void removeFromCells(WorldObject* ob, const ScriptedObCellRange& range);
+	bool isObInProximity(WorldObject* ob, const Vec4f& campos) const;
+	void fireMovedNearToEvent(WorldObject* ob, WorldStateLock& world_state_lock);
+	void fireMovedAwayFromEvent(WorldObject* ob, WorldStateLock& world_state_lock);
+
+	float cell_w;
+	float recip_cell_w;
+
+	HashMap<Vec3<int>, ScriptedObGridCell, ScriptedObCellHashFunc> cells;
+	HashMap<WorldObject*, ScriptedObBinning, ScriptedObPtrHashFunc> ob_binnings; // AABB and cell range that each object in the checker was inserted with.
+	std::vector<WorldObject*> large_objects; // Objects whose AABBs span too many cells to be inserted in the grid.
+
+	std::vector<WorldObject*> in_proximity_obs; // Objects with in_script_proximity = true.
+
+	std::vector<WorldObjectRef> temp_moved_near_obs;
+	std::vector<WorldObjectRef> temp_moved_away_obs;
 };
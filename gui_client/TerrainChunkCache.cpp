@@ -0,0 +1,421 @@
+/*=====================================================================
+TerrainChunkCache.cpp
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "TerrainChunkCache.h"
+
+
+#include "DiskCacheFile.h"
+#include <utils/FileUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Lock.h>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+
+
+static const uint32 TERRAIN_CHUNK_CACHE_MAGIC_NUMBER = 0x3A9E61C5;
+static const uint32 TERRAIN_CHUNK_CACHE_VERSION = 2; // Increment when the file format, or the way terrain chunks are built, changes.
+
+
+// DiskCacheFile key: uint64 terrain data hash, float chunk_x, float chunk_y, float chunk_w
+// DiskCacheFile payload:
+// uint32 vert_res_with_borders
+// uint32 vertex size in bytes
+// AABB min and max (8 floats)
+// vertex data
+
+
+static void makeKeyData(const TerrainChunkCacheKey& key, std::vector<uint8>& key_data_out)
+{
+	key_data_out.clear();
+	DiskCacheFile::appendToBuffer(key_data_out, key.terrain_data_hash);
+	DiskCacheFile::appendToBuffer(key_data_out, key.chunk_x);
+	DiskCacheFile::appendToBuffer(key_data_out, key.chunk_y);
+	DiskCacheFile::appendToBuffer(key_data_out, key.chunk_w);
+}
+
+
+TerrainChunkCache::TerrainChunkCache(const std::string& cache_dir_, size_t max_mem_bytes_, size_t max_disk_bytes)
+:	cache_dir(cache_dir_),
+	max_mem_bytes(max_mem_bytes_),
+	mem_cache_size_B(0)
+{
+	if(!cache_dir.empty())
+	{
+		try
+		{
+			FileUtils::createDirIfDoesNotExist(cache_dir);
+
+			trimDiskCache(max_disk_bytes);
+		}
+		catch(FileUtils::FileUtilsExcep& e)
+		{
+			conPrint("TerrainChunkCache: failed to create or trim cache dir: " + e.what());
+		}
+	}
+}
+
+
+TerrainChunkCache::~TerrainChunkCache()
+{}
+
+
+// If the total size of the files in the cache dir exceeds max_disk_bytes, delete files until the total size is at most half of max_disk_bytes.
+// We don't have a record of when files were last used, so files are just deleted in directory order.
+void TerrainChunkCache::trimDiskCache(size_t max_disk_bytes)
+{
+	const std::vector<std::string> paths = FileUtils::getFilesInDirFullPaths(cache_dir);
+
+	uint64 total_size = 0;
+	for(size_t i=0; i<paths.size(); ++i)
+		total_size += FileUtils::getFileSize(paths[i]);
+
+	if(total_size > max_disk_bytes)
+	{
+		conPrint("TerrainChunkCache: disk cache size (" + getNiceByteSize(total_size) + ") exceeds limit, deleting some cache files.");
+
+		for(size_t i=0; (i<paths.size()) && (total_size > max_disk_bytes / 2); ++i)
+		{
+			const uint64 file_size = FileUtils::getFileSize(paths[i]);
+			FileUtils::deleteFile(paths[i]);
+			total_size -= file_size;
+		}
+	}
+}
+
+
+std::string TerrainChunkCache::getPathForKey(const TerrainChunkCacheKey& key) const
+{
+	std::vector<uint8> key_data;
+	makeKeyData(key, key_data);
+	return DiskCacheFile::getPathForKey(cache_dir, key_data, ".terrainchunk");
+}
+
+
+Reference<TerrainChunkVertData> TerrainChunkCache::tryLoadChunk(const TerrainChunkCacheKey& key)
+{
+	{
+		Lock lock(mutex);
+
+		auto res = mem_cache.find(key);
+		if(res != mem_cache.end())
+		{
+			// Move to front of LRU list
+			lru_list.splice(lru_list.begin(), lru_list, res->second.lru_it);
+
+			num_mem_hits.increment();
+			return res->second.chunk;
+		}
+	}
+
+	if(!cache_dir.empty())
+	{
+		Reference<TerrainChunkVertData> chunk = tryLoadChunkFromDisk(key);
+		if(chunk.nonNull())
+		{
+			insertIntoMemCache(key, chunk);
+
+			num_disk_hits.increment();
+			return chunk;
+		}
+	}
+
+	num_misses.increment();
+	return nullptr;
+}
+
+
+void TerrainChunkCache::storeChunk(const TerrainChunkCacheKey& key, const Reference<TerrainChunkVertData>& chunk, bool store_on_disk)
+{
+	insertIntoMemCache(key, chunk);
+
+	if(store_on_disk && !cache_dir.empty())
+		writeChunkToDisk(key, *chunk);
+}
+
+
+void TerrainChunkCache::clearMemCache()
+{
+	Lock lock(mutex);
+
+	mem_cache.clear();
+	lru_list.clear();
+	mem_cache_size_B = 0;
+}
+
+
+size_t TerrainChunkCache::getMemCacheSizeB() const
+{
+	Lock lock(mutex);
+	return mem_cache_size_B;
+}
+
+
+std::string TerrainChunkCache::getDiagnostics() const
+{
+	size_t num_entries, size_B;
+	{
+		Lock lock(mutex);
+		num_entries = mem_cache.size();
+		size_B = mem_cache_size_B;
+	}
+
+	return "terrain chunk cache: " + toString(num_entries) + " chunks in mem (" + getNiceByteSize(size_B) + "), mem hits: " + toString(numMemHits()) +
+		", disk hits: " + toString(numDiskHits()) + ", misses: " + toString(numMisses()) + "\n";
+}
+
+
+void TerrainChunkCache::insertIntoMemCache(const TerrainChunkCacheKey& key, const Reference<TerrainChunkVertData>& chunk)
+{
+	Lock lock(mutex);
+
+	auto res = mem_cache.find(key);
+	if(res != mem_cache.end())
+	{
+		mem_cache_size_B -= res->second.chunk->getTotalMemUsage();
+		res->second.chunk = chunk;
+		lru_list.splice(lru_list.begin(), lru_list, res->second.lru_it);
+	}
+	else
+	{
+		lru_list.push_front(key);
+
+		MemCacheEntry entry;
+		entry.chunk = chunk;
+		entry.lru_it = lru_list.begin();
+		mem_cache.insert(std::make_pair(key, entry));
+	}
+	mem_cache_size_B += chunk->getTotalMemUsage();
+
+	// Evict least recently used entries until we are within the size limit.  Always keep the entry just inserted.
+	while(mem_cache_size_B > max_mem_bytes && lru_list.size() > 1)
+	{
+		auto evict_res = mem_cache.find(lru_list.back());
+		assert(evict_res != mem_cache.end());
+		mem_cache_size_B -= evict_res->second.chunk->getTotalMemUsage();
+		mem_cache.erase(evict_res);
+		lru_list.pop_back();
+	}
+}
+
+
+Reference<TerrainChunkVertData> TerrainChunkCache::tryLoadChunkFromDisk(const TerrainChunkCacheKey& key)
+{
+	ZoneScoped; // Tracy profiler
+
+	std::vector<uint8> key_data;
+	makeKeyData(key, key_data);
+
+	Reference<TerrainChunkVertData> chunk = new TerrainChunkVertData();
+	const bool loaded = DiskCacheFile::tryReadFile(DiskCacheFile::getPathForKey(cache_dir, key_data, ".terrainchunk"), TERRAIN_CHUNK_CACHE_MAGIC_NUMBER, TERRAIN_CHUNK_CACHE_VERSION, key_data, "TerrainChunkCache",
+		[&](DiskCacheFile::Reader& reader)
+		{
+			const uint32 vert_res_with_borders = reader.readValue<uint32>();
+			if(vert_res_with_borders > 4096)
+				throw glare::Exception("invalid vert_res_with_borders");
+			chunk->vert_res_with_borders = (int)vert_res_with_borders;
+
+			const uint32 vert_size_B = reader.readValue<uint32>();
+			if(vert_size_B == 0 || vert_size_B > 64)
+				throw glare::Exception("invalid vertex size");
+
+			float aabb_coords[8];
+			reader.read(aabb_coords, sizeof(aabb_coords));
+			chunk->aabb_os = js::AABBox(Vec4f(aabb_coords[0], aabb_coords[1], aabb_coords[2], aabb_coords[3]), Vec4f(aabb_coords[4], aabb_coords[5], aabb_coords[6], aabb_coords[7]));
+
+			const size_t vert_data_size = (size_t)vert_size_B * vert_res_with_borders * vert_res_with_borders;
+			if(vert_data_size != reader.bytesRemaining())
+				throw glare::Exception("invalid vertex data size");
+
+			chunk->vert_data.resizeNoCopy(vert_data_size);
+			reader.read(chunk->vert_data.data(), vert_data_size);
+		});
+
+	return loaded ? chunk : nullptr;
+}
+
+
+void TerrainChunkCache::writeChunkToDisk(const TerrainChunkCacheKey& key, const TerrainChunkVertData& chunk)
+{
+	ZoneScoped; // Tracy profiler
+
+	std::vector<uint8> key_data;
+	makeKeyData(key, key_data);
+
+	std::vector<uint8> file_data;
+	file_data.reserve(128 + chunk.vert_data.size());
+
+	DiskCacheFile::beginFile(TERRAIN_CHUNK_CACHE_MAGIC_NUMBER, TERRAIN_CHUNK_CACHE_VERSION, key_data, file_data);
+	DiskCacheFile::appendToBuffer(file_data, (uint32)chunk.vert_res_with_borders);
+	const size_t num_verts = (size_t)chunk.vert_res_with_borders * chunk.vert_res_with_borders;
+	DiskCacheFile::appendToBuffer(file_data, (uint32)(num_verts > 0 ? (chunk.vert_data.size() / num_verts) : 0));
+	for(int i=0; i<4; ++i)
+		DiskCacheFile::appendToBuffer(file_data, chunk.aabb_os.min_[i]);
+	for(int i=0; i<4; ++i)
+		DiskCacheFile::appendToBuffer(file_data, chunk.aabb_os.max_[i]);
+	file_data.insert(file_data.end(), chunk.vert_data.begin(), chunk.vert_data.end());
+
+	DiskCacheFile::writeFile(DiskCacheFile::getPathForKey(cache_dir, key_data, ".terrainchunk"), file_data, "TerrainChunkCache");
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/PlatformUtils.h>
+
+
+static Reference<TerrainChunkVertData> makeTestChunk(int vert_res_with_borders, uint8 fill_val)
+{
+	Reference<TerrainChunkVertData> chunk = new TerrainChunkVertData();
+	chunk->vert_res_with_borders = vert_res_with_borders;
+	chunk->aabb_os = js::AABBox(Vec4f(0, 0, -1.5f, 1), Vec4f(10, 10, 20.25f, 1));
+	chunk->vert_data.resize((sizeof(float) * 3 + sizeof(uint32)) * vert_res_with_borders * vert_res_with_borders);
+	for(size_t i=0; i<chunk->vert_data.size(); ++i)
+		chunk->vert_data[i] = (uint8)(fill_val + i);
+	return chunk;
+}
+
+
+static void checkChunksEqual(const TerrainChunkVertData& a, const TerrainChunkVertData& b)
+{
+	testAssert(a.vert_res_with_borders == b.vert_res_with_borders);
+	testAssert(a.aabb_os == b.aabb_os);
+	testAssert(a.vert_data.size() == b.vert_data.size());
+	testAssert(std::memcmp(a.vert_data.data(), b.vert_data.data(), a.vert_data.size()) == 0);
+}
+
+
+void TerrainChunkCache::test()
+{
+	conPrint("TerrainChunkCache::test()");
+
+	try
+	{
+		const std::string cache_dir = PlatformUtils::getTempDirPath() + "/terrain_chunk_cache_test";
+
+		TerrainChunkCacheKey key;
+		key.terrain_data_hash = 0x123456789ABCULL;
+		key.chunk_x = 1024.f;
+		key.chunk_y = -512.f;
+		key.chunk_w = 256.f;
+
+		Reference<TerrainChunkVertData> chunk = makeTestChunk(/*vert_res_with_borders=*/10, /*fill_val=*/1);
+
+		//------------------------ Test in-memory cache ------------------------
+		{
+			Reference<TerrainChunkCache> cache = new TerrainChunkCache(/*cache_dir=*/"", /*max_mem_bytes=*/1 << 20, /*max_disk_bytes=*/0);
+
+			testAssert(cache->tryLoadChunk(key).isNull());
+			testAssert(cache->numMisses() == 1);
+
+			cache->storeChunk(key, chunk, /*store_on_disk=*/true); // There is no disk cache, so store_on_disk should be ignored.
+			testAssert(cache->tryLoadChunk(key).ptr() == chunk.ptr());
+			testAssert(cache->numMemHits() == 1);
+
+			// Different key components should miss
+			TerrainChunkCacheKey other_key = key;
+			other_key.terrain_data_hash++;
+			testAssert(cache->tryLoadChunk(other_key).isNull());
+			other_key = key;
+			other_key.chunk_x += 256.f;
+			testAssert(cache->tryLoadChunk(other_key).isNull());
+			other_key = key;
+			other_key.chunk_w = 128.f;
+			testAssert(cache->tryLoadChunk(other_key).isNull());
+
+			cache->clearMemCache();
+			testAssert(cache->tryLoadChunk(key).isNull());
+			testAssert(cache->getMemCacheSizeB() == 0);
+		}
+
+		//------------------------ Test LRU eviction ------------------------
+		{
+			const size_t chunk_mem_usage = makeTestChunk(/*vert_res_with_borders=*/130, 0)->getTotalMemUsage();
+			Reference<TerrainChunkCache> cache = new TerrainChunkCache(/*cache_dir=*/"", /*max_mem_bytes=*/chunk_mem_usage * 4, /*max_disk_bytes=*/0);
+
+			std::vector<TerrainChunkCacheKey> keys(6, key);
+			for(size_t i=0; i<keys.size(); ++i)
+				keys[i].chunk_x = (float)i * 256.f;
+
+			for(size_t i=0; i<4; ++i)
+				cache->storeChunk(keys[i], makeTestChunk(/*vert_res_with_borders=*/130, (uint8)i), /*store_on_disk=*/false);
+			testAssert(cache->getMemCacheSizeB() <= chunk_mem_usage * 4);
+
+			// Use chunk 0, so that chunk 1 is the least recently used.
+			testAssert(cache->tryLoadChunk(keys[0]).nonNull());
+
+			cache->storeChunk(keys[4], makeTestChunk(/*vert_res_with_borders=*/130, 4), /*store_on_disk=*/false); // Should evict chunk 1
+			testAssert(cache->getMemCacheSizeB() <= chunk_mem_usage * 4);
+			testAssert(cache->tryLoadChunk(keys[1]).isNull());
+			testAssert(cache->tryLoadChunk(keys[0]).nonNull());
+			testAssert(cache->tryLoadChunk(keys[2]).nonNull());
+
+			cache->storeChunk(keys[5], makeTestChunk(/*vert_res_with_borders=*/130, 5), /*store_on_disk=*/false); // Should evict chunk 3
+			testAssert(cache->tryLoadChunk(keys[3]).isNull());
+			testAssert(cache->tryLoadChunk(keys[4]).nonNull());
+			testAssert(cache->tryLoadChunk(keys[5]).nonNull());
+		}
+
+		//------------------------ Test disk cache ------------------------
+		{
+			Reference<TerrainChunkCache> cache = new TerrainChunkCache(cache_dir, /*max_mem_bytes=*/1 << 20, /*max_disk_bytes=*/1 << 30);
+			DiskCacheFile::deleteFilesInDir(cache_dir);
+
+			// Chunks stored with store_on_disk = false should not be written to disk.
+			cache->storeChunk(key, chunk, /*store_on_disk=*/false);
+			testAssert(!FileUtils::fileExists(cache->getPathForKey(key)));
+
+			cache->storeChunk(key, chunk, /*store_on_disk=*/true);
+			testAssert(FileUtils::fileExists(cache->getPathForKey(key)));
+
+			// A new cache object using the same dir should load the chunk from disk.
+			{
+				Reference<TerrainChunkCache> cache2 = new TerrainChunkCache(cache_dir, /*max_mem_bytes=*/1 << 20, /*max_disk_bytes=*/1 << 30);
+				Reference<TerrainChunkVertData> loaded_chunk = cache2->tryLoadChunk(key);
+				testAssert(loaded_chunk.nonNull());
+				checkChunksEqual(*chunk, *loaded_chunk);
+				testAssert(cache2->numDiskHits() == 1);
+
+				// Should now be in the memory cache
+				testAssert(cache2->tryLoadChunk(key).ptr() == loaded_chunk.ptr());
+				testAssert(cache2->numMemHits() == 1);
+			}
+
+			// An invalid cache file should be treated as a miss.  (See DiskCacheFile::test() for tests of corrupted and truncated files.)
+			{
+				FileUtils::writeEntireFile(cache->getPathForKey(key), "invalid", 7);
+
+				Reference<TerrainChunkCache> cache2 = new TerrainChunkCache(cache_dir, /*max_mem_bytes=*/1 << 20, /*max_disk_bytes=*/1 << 30);
+				testAssert(cache2->tryLoadChunk(key).isNull());
+			}
+
+			// Constructing a cache with a small max disk size should delete files.
+			{
+				cache->storeChunk(key, chunk, /*store_on_disk=*/true);
+				testAssert(!FileUtils::getFilesInDirFullPaths(cache_dir).empty());
+
+				Reference<TerrainChunkCache> cache2 = new TerrainChunkCache(cache_dir, /*max_mem_bytes=*/1 << 20, /*max_disk_bytes=*/16);
+				testAssert(FileUtils::getFilesInDirFullPaths(cache_dir).empty());
+			}
+
+			DiskCacheFile::deleteFilesInDir(cache_dir);
+		}
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("TerrainChunkCache::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,123 @@
+/*=====================================================================
+TerrainChunkCache.h
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <utils/ThreadSafeRefCounted.h>
+#include <utils/Reference.h>
+#include <utils/Vector.h>
+#include <utils/Mutex.h>
+#include <AtomicInt.h>
+#include <maths/vec3.h>
+#include <physics/jscol_aabbox.h>
+#include <string>
+#include <map>
+#include <list>
+#include <vector>
+
+
+// The vertex data for a terrain chunk, as built by TerrainSystem::makeTerrainChunkVertData().
+struct TerrainChunkVertData : public ThreadSafeRefCounted
+{
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	int vert_res_with_borders;
+	js::AABBox aabb_os;
+	js::Vector<uint8, 16> vert_data; // vert_res_with_borders^2 vertices, each with vertex position (3 floats) and packed normal (uint32).
+
+	size_t getTotalMemUsage() const { return sizeof(TerrainChunkVertData) + vert_data.capacity(); }
+};
+
+
+struct TerrainChunkCacheKey
+{
+	uint64 terrain_data_hash; // Hash of the terrain spec and the state of the terrain source data.  See TerrainSystem::updateTerrainDataHash().
+	float chunk_x, chunk_y; // world-space coords of lower left corner of chunk.
+	float chunk_w;
+
+	bool operator < (const TerrainChunkCacheKey& other) const
+	{
+		if(terrain_data_hash != other.terrain_data_hash) return terrain_data_hash < other.terrain_data_hash;
+		if(chunk_x != other.chunk_x) return chunk_x < other.chunk_x;
+		if(chunk_y != other.chunk_y) return chunk_y < other.chunk_y;
+		return chunk_w < other.chunk_w;
+	}
+	bool operator == (const TerrainChunkCacheKey& other) const
+	{
+		return terrain_data_hash == other.terrain_data_hash && chunk_x == other.chunk_x && chunk_y == other.chunk_y && chunk_w == other.chunk_w;
+	}
+};
+
+
+/*=====================================================================
+TerrainChunkCache
+-----------------
+Cache of terrain chunk vertex data, so that terrain chunks don't need to be
+regenerated from the heightmaps etc. when the camera moves back and forth
+over LOD boundaries, or revisits an area.
+
+Has an in-memory LRU cache with a maximum total size, and an on-disk cache.
+Chunks are only written to disk when storeChunk() is called with
+store_on_disk = true, which should be the case when all terrain source maps
+have been loaded, so that intermediate results (built before the
+heightmaps are loaded) don't get written.
+
+Disk files use the DiskCacheFile format, which stores the full key and a
+checksum, so hash collisions and truncated or corrupted files are detected
+and treated as cache misses.
+
+Threadsafe.
+=====================================================================*/
+class TerrainChunkCache : public ThreadSafeRefCounted
+{
+public:
+	// Creates cache_dir if it doesn't exist already.  cache_dir may be empty, in which case there is no disk cache.
+	// If the disk cache is larger than max_disk_bytes, some cache files are deleted.
+	TerrainChunkCache(const std::string& cache_dir, size_t max_mem_bytes, size_t max_disk_bytes);
+	~TerrainChunkCache();
+
+	// Returns the cached data, or null if there is no valid cache entry.
+	Reference<TerrainChunkVertData> tryLoadChunk(const TerrainChunkCacheKey& key);
+
+	void storeChunk(const TerrainChunkCacheKey& key, const Reference<TerrainChunkVertData>& chunk, bool store_on_disk);
+
+	void clearMemCache();
+
+	std::string getPathForKey(const TerrainChunkCacheKey& key) const;
+
+	size_t numMemHits() const { return (size_t)num_mem_hits; }
+	size_t numDiskHits() const { return (size_t)num_disk_hits; }
+	size_t numMisses() const { return (size_t)num_misses; }
+	size_t getMemCacheSizeB() const;
+
+	std::string getDiagnostics() const;
+
+	static void test();
+
+private:
+	Reference<TerrainChunkVertData> tryLoadChunkFromDisk(const TerrainChunkCacheKey& key);
+	void writeChunkToDisk(const TerrainChunkCacheKey& key, const TerrainChunkVertData& chunk);
+	void insertIntoMemCache(const TerrainChunkCacheKey& key, const Reference<TerrainChunkVertData>& chunk);
+	void trimDiskCache(size_t max_disk_bytes);
+
+	struct MemCacheEntry
+	{
+		Reference<TerrainChunkVertData> chunk;
+		std::list<TerrainChunkCacheKey>::iterator lru_it;
+	};
+
+	std::string cache_dir;
+	size_t max_mem_bytes;
+
+	mutable Mutex mutex;
+	std::map<TerrainChunkCacheKey, MemCacheEntry> mem_cache	GUARDED_BY(mutex);
+	std::list<TerrainChunkCacheKey> lru_list				GUARDED_BY(mutex); // Most recently used at front.
+	size_t mem_cache_size_B									GUARDED_BY(mutex);
+
+	glare::AtomicInt num_mem_hits;
+	glare::AtomicInt num_disk_hits;
+	glare::AtomicInt num_misses;
+};
@@ -10,6 +10,7 @@ Copyright Glare Technologies Limited 2023 -
 #include "OpenGLShader.h"
 #include "BiomeManager.h"
 #include "TerrainTests.h"
+#include "TerrainChunkCache.h"
 #include "graphics/PerlinNoise.h"
 #include "PhysicsWorld.h"
 #include "../shared/ImageDecoding.h"
@@ -30,11 +31,15 @@ Copyright Glare Technologies Limited 2023 -
 #include "meshoptimizer/src/meshoptimizer.h"
 #include "../dll/include/IndigoMesh.h"
 #include <tracy/Tracy.hpp>
+#include <xxhash.h>
+#include <smmintrin.h>
 
 
 TerrainSystem::TerrainSystem()
 {
 	num_uncompleted_tasks = 0;
+	terrain_data_hash = 0;
+	all_terrain_maps_loaded = false;
 }
 
 
@@ -225,7 +230,8 @@ static IndexBufAllocationHandle createIndexBufferForChunkWithRes(OpenGLEngine* o
 
 
 void TerrainSystem::init(const TerrainPathSpec& spec_, const std::string& base_dir_path, OpenGLEngine* opengl_engine_, PhysicsWorld* physics_world_, BiomeManager* biome_manager_, const Vec3d& campos, glare::TaskManager* task_manager_, 
-	glare::StackAllocator& bump_allocator, ThreadSafeQueue<Reference<ThreadMessage> >* out_msg_queue_)
+	glare::StackAllocator& bump_allocator, ThreadSafeQueue<Reference<ThreadMessage> >* out_msg_queue_, 
+	const Reference<TerrainChunkCache>& chunk_cache_)
 {
 	spec = spec_;
 	opengl_engine = opengl_engine_;
@@ -233,6 +239,7 @@ void TerrainSystem::init(const TerrainPathSpec& spec_, const std::string& base_d
 	biome_manager = biome_manager_;
 	task_manager = task_manager_;
 	out_msg_queue = out_msg_queue_;
+	chunk_cache = chunk_cache_;
 
 	terrain_section_w = spec_.terrain_section_width_m;
 	terrain_scale_factor = 1.f / spec_.terrain_section_width_m;
@@ -305,6 +312,8 @@ void TerrainSystem::init(const TerrainPathSpec& spec_, const std::string& base_d
 	//detail_heightmap = PNGDecoder::decode("D:\\terrain\\GroundPack2\\SAND-11\\tex\\SAND-11-DUNES_DEPTH_2k.png");
 	//small_dune_heightmap = PNGDecoder::decode("C:\\Users\\nick\\Downloads\\sand_ground_59_83_height.png");
 
+	updateTerrainDataHash();
+
 	
 	root_node = new TerrainNode();
 	root_node->parent = NULL;
@@ -435,6 +444,8 @@ void TerrainSystem::handleTextureLoaded(const OpenGLTextureKey& path, const Map2
 			opengl_engine->setDetailHeightmap(i, opengl_engine->getTextureIfLoaded(OpenGLTextureKey(path)));
 
 			detail_heightmaps[i] = map;
+			if(i == 0) // Detail heightmap 0 is used in evalTerrainHeight()
+				updateTerrainDataHash();
 		}
 	}
 
@@ -464,6 +475,8 @@ void TerrainSystem::handleTextureLoaded(const OpenGLTextureKey& path, const Map2
 
 	if(terrain_needs_rebuild)
 	{
+		updateTerrainDataHash();
+
 		// Reload terrain:
 		removeSubtree(root_node.ptr(), root_node->old_subtree_gl_obs, root_node->old_subtree_phys_obs);
 
@@ -538,6 +551,59 @@ void TerrainSystem::removeAllNodeDataForSubtree(TerrainNode* node)
 }
 
 
+// Version of the terrain chunk generation code.  Increment when the terrain height function or the chunk vertex data building changes, so old chunks in the disk cache aren't used.
+static const uint32 TERRAIN_CHUNK_GEN_VERSION = 1;
+
+
+template <class T>
+static void appendBytes(std::string& s, const T& x)
+{
+	s.append((const char*)&x, sizeof(T));
+}
+
+
+// Computes terrain_data_hash, a hash of everything that determines the terrain chunk geometry: the terrain spec, and which of the maps used by evalTerrainHeight() have been loaded.
+// Also sets all_terrain_maps_loaded.
+void TerrainSystem::updateTerrainDataHash()
+{
+	std::string s;
+	appendBytes(s, TERRAIN_CHUNK_GEN_VERSION);
+	appendBytes(s, spec.terrain_section_width_m);
+	appendBytes(s, spec.terrain_height_scale);
+	appendBytes(s, spec.default_terrain_z);
+
+	bool all_loaded = true;
+	for(int y=0; y<TERRAIN_DATA_SECTION_RES; ++y)
+	for(int x=0; x<TERRAIN_DATA_SECTION_RES; ++x)
+	{
+		const TerrainDataSection& section = terrain_data_sections[x + y*TERRAIN_DATA_SECTION_RES];
+		const std::string heightmap_path = toStdString(section.heightmap_path);
+		const std::string mask_map_path = toStdString(section.mask_map_path);
+		if(!heightmap_path.empty() || !mask_map_path.empty())
+		{
+			appendBytes(s, x);
+			appendBytes(s, y);
+			s += heightmap_path;
+			s.push_back(section.heightmap.nonNull() ? '1' : '0');
+			s += mask_map_path;
+			s.push_back(section.maskmap.nonNull() ? '1' : '0');
+
+			if((!heightmap_path.empty() && section.heightmap.isNull()) || (!mask_map_path.empty() && section.maskmap.isNull()))
+				all_loaded = false;
+		}
+	}
+
+	const std::string detail_height_map_0_path = toStdString(spec.detail_height_map_paths[0]);
+	s += detail_height_map_0_path;
+	s.push_back(detail_heightmaps[0].nonNull() ? '1' : '0');
+	if(!detail_height_map_0_path.empty() && detail_heightmaps[0].isNull())
+		all_loaded = false;
+
+	terrain_data_hash = XXH64(s.data(), s.size(), /*seed=*/1);
+	all_terrain_maps_loaded = all_loaded;
+}
+
+
 void TerrainSystem::shutdown()
 {
 	// Wait for any MakeTerrainChunkTasks to finish, since they have pointers to this object
@@ -699,6 +765,9 @@ std::string TerrainSystem::getDiagnostics() const
 	s += "terrain section heightmap GPU mem: " + getNiceByteSize(terrain_section_heightmap_GPU_mem) + "\n";
 	s += "terrain section maskmap GPU mem:   " + getNiceByteSize(terrain_section_maskmap_GPU_mem) + "\n";
 
+	if(chunk_cache.nonNull())
+		s += chunk_cache->getDiagnostics();
+
 	s += "Terrain scattering:\n" +
 		terrain_scattering.getDiagnostics();
 
@@ -782,24 +851,12 @@ float TerrainSystem::evalTreeMask(float p_x, float p_y) const
 }
 
 
-// p_x, p_y are world space coordinates.
-float TerrainSystem::evalTerrainHeight(float p_x, float p_y, float quad_w) const
+// Evaluates the terrain height at world space coordinates (p_x, p_y), which lie in the given section, which has a heightmap.
+// nx, ny are the heightmap coordinates of the point, as computed in evalTerrainHeight().
+inline float TerrainSystem::evalTerrainHeightInSection(const TerrainDataSection& section, float p_x, float p_y, float nx, float ny) const
 {
-#if 1
 	const float MIN_TERRAIN_Z = -50.f; // Have a max under-sea depth.  This allows having a flat sea-floor, which in turn allows a lower-res mesh to be used for seafloor chunks.
 
-	const float nx = p_x * terrain_scale_factor + 0.5f; // Offset by 0.5 so that the central heightmap is centered at (0,0,0).
-	const float ny = p_y * terrain_scale_factor + 0.5f;
-
-	// Work out which source terrain data section we are reading from
-	const int section_x = Maths::floorToInt(nx) + TERRAIN_SECTION_OFFSET;
-	const int section_y = Maths::floorToInt(ny) + TERRAIN_SECTION_OFFSET;
-	if(section_x < 0 || section_x >= 8 || section_y < 0 || section_y >= 8)
-		return spec.default_terrain_z;
-	const TerrainDataSection& section = terrain_data_sections[section_x + section_y*TERRAIN_DATA_SECTION_RES]; // terrain_data_sections.elem(section_x, section_y);
-	if(section.heightmap.isNull())
-		return spec.default_terrain_z;
-
 	const float section_nx = nx - Maths::floorToInt(nx);
 	const float section_ny = ny - Maths::floorToInt(ny);
 
@@ -871,6 +928,26 @@ float TerrainSystem::evalTerrainHeight(float p_x, float p_y, float quad_w) const
 		terrain_h += rock_height * 0.8f;
 	}
 	return terrain_h;
+}
+
+
+// p_x, p_y are world space coordinates.
+float TerrainSystem::evalTerrainHeight(float p_x, float p_y, float quad_w) const
+{
+#if 1
+	const float nx = p_x * terrain_scale_factor + 0.5f; // Offset by 0.5 so that the central heightmap is centered at (0,0,0).
+	const float ny = p_y * terrain_scale_factor + 0.5f;
+
+	// Work out which source terrain data section we are reading from
+	const int section_x = Maths::floorToInt(nx) + TERRAIN_SECTION_OFFSET;
+	const int section_y = Maths::floorToInt(ny) + TERRAIN_SECTION_OFFSET;
+	if(section_x < 0 || section_x >= 8 || section_y < 0 || section_y >= 8)
+		return spec.default_terrain_z;
+	const TerrainDataSection& section = terrain_data_sections[section_x + section_y*TERRAIN_DATA_SECTION_RES]; // terrain_data_sections.elem(section_x, section_y);
+	if(section.heightmap.isNull())
+		return spec.default_terrain_z;
+
+	return evalTerrainHeightInSection(section, p_x, p_y, nx, ny);
 
 #elif 0
 	//	return p_x * 0.01f;
@@ -949,7 +1026,85 @@ float TerrainSystem::evalTerrainHeight(float p_x, float p_y, float quad_w) const
 }
 
 
-void TerrainSystem::makeTerrainChunkMesh(float chunk_x, float chunk_y, float chunk_w, bool build_physics_ob, TerrainChunkData& chunk_data_out) const
+// Evaluates the terrain height at the points (x0 + x * spacing, y0 + y * spacing) for x in [0, res_x), y in [0, res_y), and stores the result in heights_out.elem(x, y).
+// Gives exactly the same results as calling evalTerrainHeight() on each point, but computes the point coordinates and source data sections 4 points at a time with SSE,
+// and writes points outside of any section with a heightmap without doing any sampling.
+void TerrainSystem::evalTerrainHeightGrid(float x0, float y0, float spacing, int res_x, int res_y, Array2D<float>& heights_out) const
+{
+	heights_out.resizeNoCopy(res_x, res_y);
+
+	const __m128 x0_v = _mm_set1_ps(x0);
+	const __m128 spacing_v = _mm_set1_ps(spacing);
+	const __m128 scale_v = _mm_set1_ps(terrain_scale_factor);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128i section_offset_v = _mm_set1_epi32(TERRAIN_SECTION_OFFSET);
+	const __m128 default_z_v = _mm_set1_ps(spec.default_terrain_z);
+
+	for(int y=0; y<res_y; ++y)
+	{
+		float* const row = &heights_out.elem(0, y);
+
+		// Use the same operations as in the scalar code in makeTerrainChunkVertData() and evalTerrainHeight(), so that the results are the same.
+		const float p_y = y * spacing + y0;
+		const float ny = p_y * terrain_scale_factor + 0.5f;
+		const int section_y = Maths::floorToInt(ny) + TERRAIN_SECTION_OFFSET;
+		if(section_y < 0 || section_y >= TERRAIN_DATA_SECTION_RES)
+		{
+			for(int x=0; x<res_x; ++x)
+				row[x] = spec.default_terrain_z;
+			continue;
+		}
+
+		const TerrainDataSection* const section_row = &terrain_data_sections[section_y*TERRAIN_DATA_SECTION_RES];
+
+		for(int x=0; x<res_x; x += 4)
+		{
+			const __m128 p_x_v = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_setr_epi32(x, x + 1, x + 2, x + 3)), spacing_v), x0_v);
+			const __m128 nx_v = _mm_add_ps(_mm_mul_ps(p_x_v, scale_v), half);
+			const __m128i section_x_v = _mm_add_epi32(_mm_cvttps_epi32(_mm_floor_ps(nx_v)), section_offset_v);
+
+			alignas(16) float p_x[4];
+			alignas(16) float nx[4];
+			alignas(16) int section_x[4];
+			_mm_store_ps(p_x, p_x_v);
+			_mm_store_ps(nx, nx_v);
+			_mm_store_si128((__m128i*)section_x, section_x_v);
+
+			const int num_in_group = myMin(4, res_x - x);
+
+			// If all points are in the same section, and it has no heightmap (or is out of range), just store the default z value.
+			if((num_in_group == 4) && (section_x[0] == section_x[3]) && 
+				((section_x[0] < 0) || (section_x[0] >= TERRAIN_DATA_SECTION_RES) || section_row[section_x[0]].heightmap.isNull()))
+			{
+				_mm_storeu_ps(row + x, default_z_v);
+				continue;
+			}
+
+			for(int i=0; i<num_in_group; ++i)
+			{
+				if(section_x[i] < 0 || section_x[i] >= TERRAIN_DATA_SECTION_RES || section_row[section_x[i]].heightmap.isNull())
+					row[x + i] = spec.default_terrain_z;
+				else
+					row[x + i] = evalTerrainHeightInSection(section_row[section_x[i]], p_x[i], p_y, nx[i], ny);
+			}
+		}
+	}
+}
+
+
+// Size of a terrain chunk vertex in bytes: position, normal, and if GEOMORPHING_SUPPORT is enabled, morph-z and morph-normal.
+static size_t terrainVertSizeB()
+{
+	const size_t normal_size_B = 4;
+	size_t vert_size_B = sizeof(Vec3f) + normal_size_B; // position, normal
+	if(GEOMORPHING_SUPPORT)
+		vert_size_B += sizeof(float) + normal_size_B; // morph-z, morph-normal
+	return vert_size_B;
+}
+
+
+// Builds the vertex data for a terrain chunk.  This is the expensive part of building a chunk, and the result is cached in TerrainChunkCache.
+void TerrainSystem::makeTerrainChunkVertData(float chunk_x, float chunk_y, float chunk_w, TerrainChunkVertData& vert_data_out) const
 {
 	//Timer timer;
 	/*
@@ -984,141 +1139,43 @@ void TerrainSystem::makeTerrainChunkMesh(float chunk_x, float chunk_y, float chu
 	*/
 
 	// Do a quick pass over the data, to see if the heightfield is completely flat here (e.g. is a flat chunk of sea-floor or ground plane).
+	// Evaluate a row at a time, so we can stop early if the heightfield is not flat.
 	bool completely_flat = true;
 	{
 		const int CHECK_RES = 32;
 		const float quad_w = chunk_w / (CHECK_RES - 1);
-		const float z_0 = evalTerrainHeight(chunk_x, chunk_y, quad_w);
-		for(int y=0; y<CHECK_RES; ++y)
-		for(int x=0; x<CHECK_RES; ++x)
+		Array2D<float> row_heights;
+		float z_0 = 0;
+		for(int y=0; (y<CHECK_RES) && completely_flat; ++y)
 		{
-			const float p_x = x * quad_w + chunk_x;
-			const float p_y = y * quad_w + chunk_y;
-			const float z = evalTerrainHeight(p_x, p_y, quad_w);
-			if(z != z_0)
-			{
-				completely_flat = false;
-				goto done;
-			}
+			evalTerrainHeightGrid(chunk_x, y * quad_w + chunk_y, quad_w, CHECK_RES, /*res_y=*/1, row_heights);
+			if(y == 0)
+				z_0 = row_heights.elem(0, 0);
+			for(int x=0; x<CHECK_RES; ++x)
+				if(row_heights.elem(x, 0) != z_0)
+				{
+					completely_flat = false;
+					break;
+				}
 		}
 	}
-done:
 
 	const int interior_vert_res = completely_flat ? 8 : 128; // Number of vertices along the side of a chunk, excluding the 2 border vertices.  Use a power of 2 for Jolt.
 	const int interior_quad_res = interior_vert_res - 1;
 	const int vert_res_with_borders = interior_vert_res + 2;
-	const int quad_res_with_borders = vert_res_with_borders - 1;
 
 	const float quad_w = chunk_w / interior_quad_res;
 
-	const int jolt_vert_res = interior_vert_res;
-	
-	Array2D<float> jolt_heightfield;
-	if(build_physics_ob)
-	{
-		jolt_heightfield.resizeNoCopy(jolt_vert_res, jolt_vert_res);
-	}
-
 	const size_t normal_size_B = 4;
-	size_t vert_size_B = sizeof(Vec3f) + normal_size_B; // position, normal
-	if(GEOMORPHING_SUPPORT)
-		vert_size_B += sizeof(float) + normal_size_B; // morph-z, morph-normal
-
-	chunk_data_out.vert_res_with_borders = vert_res_with_borders;
-
-	chunk_data_out.mesh_data = new OpenGLMeshRenderData();
-	chunk_data_out.mesh_data->vert_data.setAllocator(this->opengl_engine->mem_allocator);
-	chunk_data_out.mesh_data->vert_data.resize(vert_size_B * vert_res_with_borders * vert_res_with_borders);
-	
-
-	OpenGLMeshRenderData& meshdata = *chunk_data_out.mesh_data;
-
-	meshdata.setIndexType(GL_UNSIGNED_SHORT);
-
-	meshdata.has_uvs = true;
-	meshdata.has_shading_normals = true;
-	meshdata.batches.resize(1);
-	meshdata.batches[0].material_index = 0;
-	meshdata.batches[0].num_indices = (uint32)(quad_res_with_borders * quad_res_with_borders * 6);
-	meshdata.batches[0].prim_start_offset_B = 0;
-
-	meshdata.num_materials_referenced = 1;
-
-	// NOTE: The order of these attributes should be the same as in OpenGLProgram constructor with the glBindAttribLocations.
-	size_t in_vert_offset_B = 0;
-	VertexAttrib pos_attrib;
-	pos_attrib.enabled = true;
-	pos_attrib.num_comps = 3;
-	pos_attrib.type = GL_FLOAT;
-	pos_attrib.normalised = false;
-	pos_attrib.stride = (uint32)vert_size_B;
-	pos_attrib.offset = (uint32)in_vert_offset_B;
-	meshdata.vertex_spec.attributes.push_back(pos_attrib);
-	in_vert_offset_B += sizeof(float) * 3;
-
-	VertexAttrib normal_attrib;
-	normal_attrib.enabled = true;
-	normal_attrib.num_comps = 4;
-	normal_attrib.type = GL_INT_2_10_10_10_REV;
-	normal_attrib.normalised = true;
-	normal_attrib.stride = (uint32)vert_size_B;
-	normal_attrib.offset = (uint32)in_vert_offset_B;
-	meshdata.vertex_spec.attributes.push_back(normal_attrib);
-	in_vert_offset_B += normal_size_B;
-
-	size_t morph_offset_B, morph_normal_offset_B;
-	if(GEOMORPHING_SUPPORT)
-	{
-		morph_offset_B = in_vert_offset_B;
-		VertexAttrib morph_attrib;
-		morph_attrib.enabled = true;
-		morph_attrib.num_comps = 1;
-		morph_attrib.type = GL_FLOAT;
-		morph_attrib.normalised = false;
-		morph_attrib.stride = (uint32)vert_size_B;
-		morph_attrib.offset = (uint32)in_vert_offset_B;
-		meshdata.vertex_spec.attributes.push_back(morph_attrib);
-		in_vert_offset_B += sizeof(float);
-
-		morph_normal_offset_B = in_vert_offset_B;
-		VertexAttrib morph_normal_attrib;
-		morph_normal_attrib.enabled = true;
-		morph_normal_attrib.num_comps = 4;
-		morph_normal_attrib.type = GL_INT_2_10_10_10_REV;
-		morph_normal_attrib.normalised = true;
-		morph_normal_attrib.stride = (uint32)vert_size_B;
-		morph_normal_attrib.offset = (uint32)in_vert_offset_B;
-		meshdata.vertex_spec.attributes.push_back(morph_normal_attrib);
-		in_vert_offset_B += normal_size_B;
-	}
-
-	meshdata.vertex_spec.checkValid();
-
+	const size_t vert_size_B = terrainVertSizeB();
+	const size_t morph_offset_B = sizeof(float) * 3 + normal_size_B;
+	const size_t morph_normal_offset_B = morph_offset_B + sizeof(float);
 
-	assert(in_vert_offset_B == vert_size_B);
+	vert_data_out.vert_res_with_borders = vert_res_with_borders;
+	vert_data_out.vert_data.resizeNoCopy(vert_size_B * vert_res_with_borders * vert_res_with_borders);
 
-	Array2D<float> raw_heightfield(interior_vert_res, interior_vert_res);
-	// Array2D<Vec3f> raw_normals(interior_vert_res, interior_vert_res);
-	for(int y=0; y<interior_vert_res; ++y)
-	for(int x=0; x<interior_vert_res; ++x)
-	{
-		const float p_x = x * quad_w + chunk_x;
-		const float p_y = y * quad_w + chunk_y;
-	// 	const float dx = 0.1f;
-	// 	const float dy = 0.1f;
-	// 
-	 	const float z    = evalTerrainHeight(p_x,      p_y,      quad_w); // z = h(p_x, p_y)
-	// 	const float z_dx = evalTerrainHeight(p_x + dx, p_y,      quad_w, water); // z_dx = h(p_x + dx, dy)
-	// 	const float z_dy = evalTerrainHeight(p_x,      p_y + dy, quad_w, water); // z_dy = h(p_x, p_y + dy)
-	// 
-	// 	const Vec3f p_dx_minus_p(dx, 0, z_dx - z); // p(p_x + dx, dy) - p(p_x, p_y) = (p_x + dx, d_y, z_dx) - (p_x, p_y, z) = (d_x, 0, z_dx - z)
-	// 	const Vec3f p_dy_minus_p(0, dy, z_dy - z);
-	// 
-	// 	const Vec3f normal = normalise(crossProduct(p_dx_minus_p, p_dy_minus_p));
-	// 
-	 	raw_heightfield.elem(x, y) = z;
-	// 	raw_normals.elem(x, y) = normal;
-	}
+	Array2D<float> raw_heightfield;
+	evalTerrainHeightGrid(chunk_x, chunk_y, quad_w, interior_vert_res, interior_vert_res, raw_heightfield);
 
 	//conPrint("eval terrain height took     " + timer.elapsedStringMSWIthNSigFigs(4));
 	//timer.reset();
@@ -1126,7 +1183,7 @@ done:
 	const float skirt_height = chunk_w * (1 / 128.f) * 0.25f; // The skirt height needs to be large enough to cover any cracks, but smaller is better to avoid wasted fragment drawing.
 	const int interior_vert_res_minus_1 = interior_vert_res - 1;
 	
-	uint8* const vert_data = chunk_data_out.mesh_data->vert_data.data();
+	uint8* const vert_data = vert_data_out.vert_data.data();
 	js::AABBox aabb_os = js::AABBox::emptyAABBox();
 
 	for(int y=0; y<vert_res_with_borders; ++y)
@@ -1180,12 +1237,11 @@ done:
 		// This is fast because it avoids calling evalTerrainHeight().
 		// For edge vertices, compute normal using evalTerrainHeight() calls, since the resulting normal should match adjacent chunks more closely,
 		// for example if the adjacent chunk has different tesselation resolution.
-		float h;
+		// The height is always just read from raw_heightfield, which has the heights for all (non-skirt-offset) vertex positions.
+		const float h = raw_heightfield.elem(src_x, src_y);
 		Vec4f normal;
 		if(src_x >= 1 && src_x < interior_vert_res_minus_1 && src_y >= 1 && src_y < interior_vert_res_minus_1)
 		{
-			h = raw_heightfield.elem(src_x, src_y);
-
 			const float dh_dx = (raw_heightfield.elem(src_x+1, src_y) - raw_heightfield.elem(src_x-1, src_y)) * recip_2_quad_w;
 			const float dh_dy = (raw_heightfield.elem(src_x, src_y+1) - raw_heightfield.elem(src_x, src_y-1)) * recip_2_quad_w;
 
@@ -1197,7 +1253,6 @@ done:
 			const float dx = quad_w; 
 			const float dy = quad_w;
 			
-						h    = evalTerrainHeight(chunk_x + p_x,      chunk_y + p_y,      quad_w); // h(p_x, p_y)
 			const float h_dx = evalTerrainHeight(chunk_x + p_x + dx, chunk_y + p_y,      quad_w); // h(p_x + dx, dy)
 			const float h_dy = evalTerrainHeight(chunk_x + p_x,      chunk_y + p_y + dy, quad_w); // h(p_x, p_y + dy)
 			
@@ -1209,14 +1264,6 @@ done:
 
 		const float p_z = h - z_offset; // Z coordinate taking into account downwards offset for skirt, if applicable.
 
-		if(build_physics_ob)
-		{
-			const int int_x = x - 1; // Don't include border/skirt vertices in Jolt heightfield.
-			const int int_y = y - 1;
-			if((int_x >= 0) && (int_x < jolt_vert_res) && (int_y >= 0) && (int_y < jolt_vert_res))
-				jolt_heightfield.elem(int_x, jolt_vert_res - 1 - int_y) = p_z;
-		}
-
 		const Vec4f pos(p_x, p_y, p_z, 1);
 		std::memcpy(vert_data + vert_size_B * (y * vert_res_with_borders + x), &pos, sizeof(float)*3); // Store x,y,z pos coords.
 
@@ -1288,21 +1335,122 @@ done:
 		}
 	}
 
-	meshdata.aabb_os = aabb_os;
+	vert_data_out.aabb_os = aabb_os;
+}
 
-	//conPrint("Creating mesh took           " + timer.elapsedStringMSWIthNSigFigs(4));
-	
+
+// Makes the OpenGL mesh data, and optionally the physics shape, for a terrain chunk, from vertex data built by makeTerrainChunkVertData().
+void TerrainSystem::makeTerrainChunkDataFromVertData(const TerrainChunkVertData& vert_data, float chunk_w, bool build_physics_ob, TerrainChunkData& chunk_data_out) const
+{
+	const int vert_res_with_borders = vert_data.vert_res_with_borders;
+	const int interior_vert_res = vert_res_with_borders - 2;
+	const int quad_res_with_borders = vert_res_with_borders - 1;
+	const float quad_w = chunk_w / (interior_vert_res - 1);
+
+	const size_t normal_size_B = 4;
+	const size_t vert_size_B = terrainVertSizeB();
+	runtimeCheck(vert_data.vert_data.size() == vert_size_B * vert_res_with_borders * vert_res_with_borders);
+
+	chunk_data_out.vert_res_with_borders = vert_res_with_borders;
+
+	chunk_data_out.mesh_data = new OpenGLMeshRenderData();
+	chunk_data_out.mesh_data->vert_data.setAllocator(this->opengl_engine->mem_allocator);
+	chunk_data_out.mesh_data->vert_data.resize(vert_data.vert_data.size());
+	std::memcpy(chunk_data_out.mesh_data->vert_data.data(), vert_data.vert_data.data(), vert_data.vert_data.size());
+
+	OpenGLMeshRenderData& meshdata = *chunk_data_out.mesh_data;
+
+	meshdata.setIndexType(GL_UNSIGNED_SHORT);
+
+	meshdata.has_uvs = true;
+	meshdata.has_shading_normals = true;
+	meshdata.batches.resize(1);
+	meshdata.batches[0].material_index = 0;
+	meshdata.batches[0].num_indices = (uint32)(quad_res_with_borders * quad_res_with_borders * 6);
+	meshdata.batches[0].prim_start_offset_B = 0;
+
+	meshdata.num_materials_referenced = 1;
+
+	// NOTE: The order of these attributes should be the same as in OpenGLProgram constructor with the glBindAttribLocations.
+	size_t in_vert_offset_B = 0;
+	VertexAttrib pos_attrib;
+	pos_attrib.enabled = true;
+	pos_attrib.num_comps = 3;
+	pos_attrib.type = GL_FLOAT;
+	pos_attrib.normalised = false;
+	pos_attrib.stride = (uint32)vert_size_B;
+	pos_attrib.offset = (uint32)in_vert_offset_B;
+	meshdata.vertex_spec.attributes.push_back(pos_attrib);
+	in_vert_offset_B += sizeof(float) * 3;
+
+	VertexAttrib normal_attrib;
+	normal_attrib.enabled = true;
+	normal_attrib.num_comps = 4;
+	normal_attrib.type = GL_INT_2_10_10_10_REV;
+	normal_attrib.normalised = true;
+	normal_attrib.stride = (uint32)vert_size_B;
+	normal_attrib.offset = (uint32)in_vert_offset_B;
+	meshdata.vertex_spec.attributes.push_back(normal_attrib);
+	in_vert_offset_B += normal_size_B;
+
+	if(GEOMORPHING_SUPPORT)
+	{
+		VertexAttrib morph_attrib;
+		morph_attrib.enabled = true;
+		morph_attrib.num_comps = 1;
+		morph_attrib.type = GL_FLOAT;
+		morph_attrib.normalised = false;
+		morph_attrib.stride = (uint32)vert_size_B;
+		morph_attrib.offset = (uint32)in_vert_offset_B;
+		meshdata.vertex_spec.attributes.push_back(morph_attrib);
+		in_vert_offset_B += sizeof(float);
+
+		VertexAttrib morph_normal_attrib;
+		morph_normal_attrib.enabled = true;
+		morph_normal_attrib.num_comps = 4;
+		morph_normal_attrib.type = GL_INT_2_10_10_10_REV;
+		morph_normal_attrib.normalised = true;
+		morph_normal_attrib.stride = (uint32)vert_size_B;
+		morph_normal_attrib.offset = (uint32)in_vert_offset_B;
+		meshdata.vertex_spec.attributes.push_back(morph_normal_attrib);
+		in_vert_offset_B += normal_size_B;
+	}
+
+	meshdata.vertex_spec.checkValid();
+
+
+	assert(in_vert_offset_B == vert_size_B);
+
+	meshdata.aabb_os = vert_data.aabb_os;
 
 	if(build_physics_ob)
 	{
-		//timer.reset();
+		//Timer timer;
+
+		// Build the Jolt heightfield from the z coordinates of the interior vertices.  Don't include border/skirt vertices.
+		const int jolt_vert_res = interior_vert_res;
+		Array2D<float> jolt_heightfield(jolt_vert_res, jolt_vert_res);
+		const uint8* const src_vert_data = vert_data.vert_data.data();
+		for(int int_y=0; int_y<jolt_vert_res; ++int_y)
+		for(int int_x=0; int_x<jolt_vert_res; ++int_x)
+		{
+			float p_z;
+			std::memcpy(&p_z, src_vert_data + vert_size_B * ((int_y + 1) * vert_res_with_borders + int_x + 1) + sizeof(float) * 2, sizeof(float));
+			jolt_heightfield.elem(int_x, jolt_vert_res - 1 - int_y) = p_z;
+		}
 		
 		chunk_data_out.physics_shape = PhysicsWorld::createJoltHeightFieldShape(jolt_vert_res, jolt_heightfield, quad_w);
 
 		//conPrint("Creating physics shape took  " + timer.elapsedStringMSWIthNSigFigs(4));
 	}
+}
+
 
-	//conPrint("---------------");
+void TerrainSystem::makeTerrainChunkMesh(float chunk_x, float chunk_y, float chunk_w, bool build_physics_ob, TerrainChunkData& chunk_data_out) const
+{
+	TerrainChunkVertData vert_data;
+	makeTerrainChunkVertData(chunk_x, chunk_y, chunk_w, vert_data);
+	makeTerrainChunkDataFromVertData(vert_data, chunk_w, build_physics_ob, chunk_data_out);
 }
 
 
@@ -1442,6 +1590,8 @@ void TerrainSystem::createSubtree(TerrainNode* node, const Vec3d& campos)
 		task->chunk_w = node->aabb.max_[0] - node->aabb.min_[0];
 		task->build_physics_ob = min_dist <= MAX_PHYSICS_DIST;
 		//task->build_physics_ob = (max_depth - node->depth) < 3;
+		task->terrain_data_hash = terrain_data_hash;
+		task->store_in_disk_cache = all_terrain_maps_loaded;
 		task->terrain = this;
 		task->out_msg_queue = out_msg_queue;
 		task->num_uncompleted_tasks_ptr = &num_uncompleted_tasks;
@@ -1517,6 +1667,8 @@ void TerrainSystem::updateSubtree(TerrainNode* cur, const Vec3d& campos)
 				task->chunk_w = cur->aabb.max_[0] - cur->aabb.min_[0];
 				task->build_physics_ob = min_dist <= MAX_PHYSICS_DIST;
 				//task->build_physics_ob = (max_depth - cur->depth) < 3;
+				task->terrain_data_hash = terrain_data_hash;
+				task->store_in_disk_cache = all_terrain_maps_loaded;
 				task->terrain = this;
 				task->out_msg_queue = out_msg_queue;
 				task->num_uncompleted_tasks_ptr = &num_uncompleted_tasks;
@@ -1799,8 +1951,27 @@ void MakeTerrainChunkTask::run(size_t thread_index)
 	{
 		assert((*num_uncompleted_tasks_ptr) >= 0);
 
-		// Make terrain
-		terrain->makeTerrainChunkMesh(chunk_x, chunk_y, chunk_w, build_physics_ob, /*chunk data out=*/chunk_data);
+		// Make terrain.  Try and get the chunk vertex data from the chunk cache first.
+		TerrainChunkCacheKey cache_key;
+		cache_key.terrain_data_hash = terrain_data_hash;
+		cache_key.chunk_x = chunk_x;
+		cache_key.chunk_y = chunk_y;
+		cache_key.chunk_w = chunk_w;
+
+		Reference<TerrainChunkVertData> vert_data;
+		if(terrain->chunk_cache.nonNull())
+			vert_data = terrain->chunk_cache->tryLoadChunk(cache_key);
+
+		if(vert_data.isNull())
+		{
+			vert_data = new TerrainChunkVertData();
+			terrain->makeTerrainChunkVertData(chunk_x, chunk_y, chunk_w, *vert_data);
+
+			if(terrain->chunk_cache.nonNull())
+				terrain->chunk_cache->storeChunk(cache_key, vert_data, /*store_on_disk=*/store_in_disk_cache);
+		}
+
+		terrain->makeTerrainChunkDataFromVertData(*vert_data, chunk_w, build_physics_ob, /*chunk data out=*/chunk_data);
 
 		// Send message to out-message-queue (e.g. to MainWindow), saying that we have finished the work.
 		TerrainChunkGeneratedMsg* msg = new TerrainChunkGeneratedMsg();
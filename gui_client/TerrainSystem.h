@@ -25,6 +25,8 @@ class OpenGLMeshRenderData;
 class VertexBufferAllocator;
 class PhysicsWorld;
 class BiomeManager;
+class TerrainChunkCache;
+struct TerrainChunkVertData;
 
 
 /*=====================================================================
@@ -97,6 +99,8 @@ public:
 	float chunk_x, chunk_y; // world-space coords of lower left corner of chunk.
 	float chunk_w; // Width of chunk in world-space (m)
 	bool build_physics_ob;
+	uint64 terrain_data_hash; // TerrainSystem::terrain_data_hash when the task was created.  Used for the chunk cache key.
+	bool store_in_disk_cache; // Only store chunks in the disk cache when all terrain maps are loaded.
 
 	TerrainSystem* terrain;
 
@@ -163,7 +167,8 @@ public:
 	friend class TerrainScattering;
 	friend class MakeTerrainChunkTask;
 
-	void init(const TerrainPathSpec& spec, const std::string& base_dir_path, OpenGLEngine* opengl_engine, PhysicsWorld* physics_world, BiomeManager* biome_manager, const Vec3d& campos, glare::TaskManager* task_manager, glare::StackAllocator& bump_allocator, ThreadSafeQueue<Reference<ThreadMessage> >* out_msg_queue);
+	void init(const TerrainPathSpec& spec, const std::string& base_dir_path, OpenGLEngine* opengl_engine, PhysicsWorld* physics_world, BiomeManager* biome_manager, const Vec3d& campos, glare::TaskManager* task_manager, glare::StackAllocator& bump_allocator, ThreadSafeQueue<Reference<ThreadMessage> >* out_msg_queue, 
+		const Reference<TerrainChunkCache>& chunk_cache);
 
 	void shutdown();
 
@@ -188,9 +193,14 @@ public:
 	Colour4f evalTerrainMask(float p_x, float p_y) const;
 	float evalTreeMask(float p_x, float p_y) const; // Return value >= 0.5: tree allowed
 	float evalTerrainHeight(float p_x, float p_y, float quad_w) const;
+	void evalTerrainHeightGrid(float x0, float y0, float spacing, int res_x, int res_y, Array2D<float>& heights_out) const;
 
 private:
+	float evalTerrainHeightInSection(const TerrainDataSection& section, float p_x, float p_y, float nx, float ny) const;
 	void makeTerrainChunkMesh(float chunk_x, float chunk_y, float chunk_w, bool build_physics_ob, TerrainChunkData& chunk_data_out) const;
+	void makeTerrainChunkVertData(float chunk_x, float chunk_y, float chunk_w, TerrainChunkVertData& vert_data_out) const;
+	void makeTerrainChunkDataFromVertData(const TerrainChunkVertData& vert_data, float chunk_w, bool build_physics_ob, TerrainChunkData& chunk_data_out) const;
+	void updateTerrainDataHash();
 	void updateSubtree(TerrainNode* node, const Vec3d& campos);
 	void removeSubtree(TerrainNode* node, std::vector<GLObjectRef>& old_children_gl_obs_in_out, std::vector<PhysicsObjectRef>& old_children_phys_obs_in_out);
 	void removeLeafGeometry(TerrainNode* node);
@@ -216,6 +226,7 @@ private:
 	BiomeManager* biome_manager;
 	glare::TaskManager* task_manager;
 	ThreadSafeQueue<Reference<ThreadMessage> >* out_msg_queue;
+	Reference<TerrainChunkCache> chunk_cache; // May be null.
 
 	TerrainScattering terrain_scattering;
 
@@ -240,4 +251,7 @@ private:
 	std::vector<GLObjectRef> water_gl_obs;
 
 	glare::AtomicInt num_uncompleted_tasks;
+
+	uint64 terrain_data_hash; // Hash of the terrain spec and which terrain maps have been loaded.  Changes when a map used by evalTerrainHeight() is loaded.
+	bool all_terrain_maps_loaded; // Have all maps used by evalTerrainHeight() been loaded?
 };
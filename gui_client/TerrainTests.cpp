@@ -809,6 +809,42 @@ void TerrainTests::testTerrainSystem(TerrainSystem& terrain_system)
 	}
 	conPrint("makeTerrainChunkMesh elapsed: " + doubleToStringNSigFigs(min_time * 1000, 5) + " ms");
 
+	// Check evalTerrainHeightGrid() gives the same results as evalTerrainHeight(), and time both.
+	{
+		const float chunk_x = 1463.f;
+		const float chunk_y = 1883.9f;
+		const int res = 130;
+		const float quad_w = 64.f / (res - 1);
+
+		Array2D<float> grid_heights;
+		terrain_system.evalTerrainHeightGrid(chunk_x, chunk_y, quad_w, res - 1, res, grid_heights); // Use res_x not a multiple of 4, to test the last partial group.
+		for(int y=0; y<res; ++y)
+		for(int x=0; x<res - 1; ++x)
+			testAssert(epsEqual(grid_heights.elem(x, y), terrain_system.evalTerrainHeight(x * quad_w + chunk_x, y * quad_w + chunk_y, quad_w)));
+
+		double min_scalar_time = 1.0e10;
+		double min_grid_time = 1.0e10;
+		float sum = 0;
+		for(int i=0; i<100; ++i)
+		{
+			{
+				Timer timer;
+				for(int y=0; y<res; ++y)
+				for(int x=0; x<res; ++x)
+					sum += terrain_system.evalTerrainHeight(x * quad_w + chunk_x, y * quad_w + chunk_y, quad_w);
+				min_scalar_time = myMin(min_scalar_time, timer.elapsed());
+			}
+			{
+				Timer timer;
+				terrain_system.evalTerrainHeightGrid(chunk_x, chunk_y, quad_w, res, res, grid_heights);
+				sum += grid_heights.elem(0, 0);
+				min_grid_time = myMin(min_grid_time, timer.elapsed());
+			}
+		}
+		conPrint("evalTerrainHeight:     " + doubleToStringNSigFigs(min_scalar_time * 1000, 5) + " ms (sum: " + toString(sum) + ")");
+		conPrint("evalTerrainHeightGrid: " + doubleToStringNSigFigs(min_grid_time * 1000, 5) + " ms");
+	}
+
 	conPrint("testTerrainSystem() done.");
 	exit(1);
 }
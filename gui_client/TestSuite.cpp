@@ -8,11 +8,25 @@ Copyright Glare Technologies Limited 2023 -
 
 #include "ModelLoading.h"
 #include "PhysicsWorld.h"
+#include "DiskCacheFile.h"
+#include "PhysicsShapeCache.h"
+#include "VoxelMeshCache.h"
+#include "TerrainChunkCache.h"
+#include "VoiceReceiver.h"
 #include "TerrainTests.h"
 #include "URLParser.h"
 #include "CameraController.h"
+#include "ScriptedObjectProximityChecker.h"
+#include "ClientUpdateBatch.h"
+#include "HashedObGrid.h"
+#include "ParticleSimulation.h"
+#include "ObjectLODEvaluator.h"
+#include "LoadItemQueue.h"
+#include "DownloadingResourceQueue.h"
+#include "AvatarPoseUpdater.h"
 #include "../shared/VoxelMeshBuilding.h"
 #include "../shared/LODGeneration.h"
+#include "../shared/JoltShapeBuilding.h"
 #include "../shared/ImageDecoding.h"
 #include "../physics/TreeTest.h"
 #include "../opengl/TextureLoading.h"
@@ -178,6 +192,14 @@ void TestSuite::test()
 	runTest([&]() { js::AABBox::test(); });
 	runTest([&]() { ReferenceTest::run(); });
 	runTest([&]() { CameraController::test(); });
+	runTest([&]() { ScriptedObjectProximityChecker::test(); });
+	runTest([&]() { ClientUpdateBatch::test(); });
+	runTest([&]() { HashedObGrid::test(); });
+	runTest([&]() { ParticleSimulation::test(); });
+	runTest([&]() { ObjectLODEvaluator::test(); });
+	runTest([&]() { LoadItemQueue::test(); });
+	runTest([&]() { DownloadingResourceQueue::test(); });
+	runTest([&]() { AvatarPoseUpdater::test(); });
 
 #if !defined(EMSCRIPTEN)
 
@@ -187,6 +209,12 @@ void TestSuite::test()
 	runTest([&]() { LODGeneration::test(); });
 	runTest([&]() { MeshSimplification::test(); });
 	runTest([&]() { PhysicsWorld::test(); });
+	runTest([&]() { JoltShapeBuilding::test(); });
+	runTest([&]() { DiskCacheFile::test(); });
+	runTest([&]() { PhysicsShapeCache::test(); });
+	runTest([&]() { VoxelMeshCache::test(); });
+	runTest([&]() { TerrainChunkCache::test(); });
+	runTest([&]() { VoiceReceiver::test(); });
 	runTest([&]() { FormatDecoderGLTF::test(); });
 	runTest([&]() { BatchedMeshTests::test(); });
 	runTest([&]() { EXRDecoder::test(); }, /*mem leak allowed=*/true); // OpenEXR leaks some minor stuff
@@ -0,0 +1,799 @@
+/*=====================================================================
+VoiceReceiver.cpp
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "VoiceReceiver.h"
+
+
+#include <utils/ConPrint.h>
+#include <utils/StringUtils.h>
+#include <utils/Exception.h>
+#include <utils/PlatformUtils.h>
+#include <utils/Lock.h>
+#include <maths/mathstypes.h>
+#include <tracy/Tracy.hpp>
+#include <opus.h>
+#include <cmath>
+
+
+VoiceJitterBuffer::VoiceJitterBuffer()
+:	next_seq_num(0),
+	highest_seq_num_received(0),
+	started(false)
+{
+	for(uint32 i=0; i<CAPACITY; ++i)
+		slots[i].valid = false;
+}
+
+
+VoiceJitterBuffer::InsertResult VoiceJitterBuffer::insert(uint32 seq_num, const uint8* data, size_t data_len)
+{
+	InsertResult result = InsertResult_Inserted;
+	if(!started)
+	{
+		started = true;
+		next_seq_num = seq_num;
+		highest_seq_num_received = seq_num;
+	}
+	else if(seq_num < next_seq_num)
+	{
+		return InsertResult_Late;
+	}
+	else if(seq_num - next_seq_num >= CAPACITY)
+	{
+		// Packet is too far ahead to fit in the buffer, probably because of a long run of lost packets.  Restart from this packet.
+		reset();
+		started = true;
+		next_seq_num = seq_num;
+		highest_seq_num_received = seq_num;
+		result = InsertResult_Reset;
+	}
+
+	Slot& slot = slots[seq_num % CAPACITY];
+	if(slot.valid && slot.seq_num == seq_num)
+		return InsertResult_Duplicate;
+
+	slot.data.assign(data, data + data_len);
+	slot.seq_num = seq_num;
+	slot.valid = true;
+
+	highest_seq_num_received = myMax(highest_seq_num_received, seq_num);
+	return result;
+}
+
+
+bool VoiceJitterBuffer::popNextFrame(VoiceFrame& frame_out)
+{
+	if(!started)
+		return false;
+
+	Slot& slot = slots[next_seq_num % CAPACITY];
+	if(slot.valid && slot.seq_num == next_seq_num)
+	{
+		frame_out.seq_num = next_seq_num;
+		frame_out.lost = false;
+		frame_out.data.swap(slot.data);
+		slot.valid = false;
+		next_seq_num++;
+		return true;
+	}
+
+	// The next packet hasn't been received.  If enough later packets have been received, consider it lost.
+	if(highest_seq_num_received > next_seq_num && (highest_seq_num_received - next_seq_num) >= MAX_WAIT_PACKETS)
+	{
+		frame_out.seq_num = next_seq_num;
+		frame_out.lost = true;
+		frame_out.data.clear();
+		next_seq_num++;
+		return true;
+	}
+
+	return false;
+}
+
+
+void VoiceJitterBuffer::reset()
+{
+	for(uint32 i=0; i<CAPACITY; ++i)
+		slots[i].valid = false;
+	started = false;
+}
+
+
+VoiceStream::VoiceStream()
+:	opus_decoder(NULL),
+	sampling_rate(0),
+	stream_id(0),
+	priority(VoiceDecodePriority_Full),
+	cam_dist2(0),
+	decode_queued(false),
+	decoder_needs_reset(false),
+	removed(false)
+{}
+
+
+VoiceStream::~VoiceStream()
+{
+	if(opus_decoder)
+		opus_decoder_destroy(opus_decoder);
+}
+
+
+class VoiceDecodeTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		receiver->decodeNextReadyStream();
+	}
+
+	VoiceReceiver* receiver;
+};
+
+
+VoiceReceiver::VoiceReceiver(glare::AudioEngine* audio_engine_, size_t num_decode_threads)
+:	audio_engine(audio_engine_),
+	listener_pos(0, 0, 0, 1),
+	decode_task_manager("voice decode task manager", num_decode_threads)
+{}
+
+
+VoiceReceiver::~VoiceReceiver()
+{
+	// Decode tasks have a pointer to this object, so make sure they have all finished.
+	decode_task_manager.cancelAndWaitForTasksToComplete();
+}
+
+
+size_t VoiceReceiver::getDefaultNumDecodeThreads()
+{
+	return myClamp<size_t>(PlatformUtils::getNumLogicalProcessors() / 4, 1, 4);
+}
+
+
+void VoiceReceiver::setListenerPos(const Vec4f& pos)
+{
+	Lock lock(mutex);
+	listener_pos = pos;
+}
+
+
+void VoiceReceiver::createOrUpdateStream(uint32 avatar_id, const Reference<glare::AudioSource>& audio_source, uint32 sampling_rate, uint32 stream_id)
+{
+	auto res = streams.find(avatar_id);
+	if(res != streams.end())
+	{
+		if(res->second->stream_id == stream_id)
+			return;
+
+		// The stream ID is different: this indicates a new stream has been created.  Recreate the stream, which will reset the expected next sequence number and recreate the Opus decoder.
+		conPrint("Stream ID changed, recreating voice stream.");
+		removeStream(avatar_id);
+	}
+
+	conPrint("Creating Opus decoder for avatar, sampling_rate: " + toString(sampling_rate));
+
+	int opus_error = 0;
+	OpusDecoder* opus_decoder = opus_decoder_create(
+		sampling_rate, // sampling rate
+		1, // channels
+		&opus_error
+	);
+	if(opus_error != OPUS_OK)
+		throw glare::Exception("opus_decoder_create failed.");
+
+	Reference<VoiceStream> stream = new VoiceStream();
+	stream->audio_source = audio_source;
+	stream->opus_decoder = opus_decoder;
+	stream->sampling_rate = sampling_rate;
+	stream->stream_id = stream_id;
+	stream->pcm_buffer.resize(sampling_rate * 60 / 1000); // Max Opus frame duration is 60 ms.
+
+	streams[avatar_id] = stream;
+}
+
+
+void VoiceReceiver::removeStream(uint32 avatar_id)
+{
+	auto res = streams.find(avatar_id);
+	if(res == streams.end())
+		return;
+
+	// A decode task may still hold a reference to the stream, tell it to stop decoding.  The Opus decoder is destroyed when the last reference is released.
+	{
+		Lock lock(res->second->mutex);
+		res->second->removed = true;
+	}
+
+	streams.erase(res);
+}
+
+
+void VoiceReceiver::getStreamAvatarIDs(std::vector<uint32>& ids_out) const
+{
+	ids_out.clear();
+	for(auto it = streams.begin(); it != streams.end(); ++it)
+		ids_out.push_back(it->first);
+}
+
+
+VoiceDecodePriority VoiceReceiver::getDecodePriority(float cam_dist2, float source_volume)
+{
+	if(source_volume <= 0 || cam_dist2 > Maths::square(MAX_DECODE_DIST))
+		return VoiceDecodePriority_Skip;
+	else if(cam_dist2 > Maths::square(FULL_QUALITY_DIST))
+		return VoiceDecodePriority_Reduced;
+	else
+		return VoiceDecodePriority_Full;
+}
+
+
+void VoiceReceiver::handleVoicePacket(uint32 avatar_id, uint32 seq_num, const uint8* opus_data, size_t opus_data_len)
+{
+	auto res = streams.find(avatar_id);
+	if(res == streams.end())
+	{
+		// conPrint("Received voice packet for avatar without streaming context. UID: " + toString(avatar_id));
+		return;
+	}
+
+	handleStreamPacket(res->second, seq_num, opus_data, opus_data_len);
+}
+
+
+void VoiceReceiver::handleMixedVoicePacket(uint32 stream_id, uint32 seq_num, const Vec4f& pos, const uint8* opus_data, size_t opus_data_len)
+{
+	Reference<VoiceStream> stream;
+	{
+		Lock lock(mutex);
+		auto res = mixed_streams.find(stream_id);
+		if(res == mixed_streams.end())
+		{
+			// The main thread will create the stream in updateMixedStreams().  Packets received until then are dropped.
+			new_mixed_streams[stream_id] = pos;
+			return;
+		}
+
+		res->second.pos = pos;
+		res->second.received_packet = true;
+		stream = res->second.stream;
+	}
+
+	handleStreamPacket(stream, seq_num, opus_data, opus_data_len);
+}
+
+
+void VoiceReceiver::updateMixedStreams(double cur_time)
+{
+	std::vector<std::pair<uint32, Vec4f>> streams_to_create;
+	std::vector<Reference<VoiceStream>> streams_to_remove;
+	{
+		Lock lock(mutex);
+
+		for(auto it = new_mixed_streams.begin(); it != new_mixed_streams.end(); ++it)
+			if(mixed_streams.count(it->first) == 0)
+				streams_to_create.push_back(*it);
+		new_mixed_streams.clear();
+
+		for(auto it = mixed_streams.begin(); it != mixed_streams.end(); )
+		{
+			MixedStream& mixed_stream = it->second;
+			if(mixed_stream.received_packet)
+			{
+				mixed_stream.received_packet = false;
+				mixed_stream.last_packet_time = cur_time;
+
+				// The stream position is the average position of the speakers in the region, so may move.
+				mixed_stream.stream->audio_source->pos = mixed_stream.pos;
+				audio_engine->sourcePositionUpdated(*mixed_stream.stream->audio_source);
+			}
+
+			if(cur_time - mixed_stream.last_packet_time > MIXED_STREAM_TIMEOUT)
+			{
+				streams_to_remove.push_back(mixed_stream.stream);
+				it = mixed_streams.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	for(size_t i=0; i<streams_to_remove.size(); ++i)
+	{
+		{
+			Lock lock(streams_to_remove[i]->mutex);
+			streams_to_remove[i]->removed = true;
+		}
+		audio_engine->removeSource(streams_to_remove[i]->audio_source);
+	}
+
+	for(size_t i=0; i<streams_to_create.size(); ++i)
+	{
+		int opus_error = 0;
+		OpusDecoder* opus_decoder = opus_decoder_create(MIXED_STREAM_SAMPLING_RATE, /*channels=*/1, &opus_error);
+		if(opus_error != OPUS_OK)
+		{
+			conPrint("opus_decoder_create failed.");
+			continue;
+		}
+
+		MixedStream mixed_stream;
+		mixed_stream.stream = new VoiceStream();
+		mixed_stream.stream->opus_decoder = opus_decoder;
+		mixed_stream.stream->sampling_rate = MIXED_STREAM_SAMPLING_RATE;
+		mixed_stream.stream->stream_id = streams_to_create[i].first;
+		mixed_stream.stream->pcm_buffer.resize(MIXED_STREAM_SAMPLING_RATE * 60 / 1000); // Max Opus frame duration is 60 ms.
+
+		mixed_stream.stream->audio_source = new glare::AudioSource();
+		mixed_stream.stream->audio_source->type = glare::AudioSource::SourceType_Streaming;
+		mixed_stream.stream->audio_source->pos = streams_to_create[i].second;
+		mixed_stream.stream->audio_source->sampling_rate = MIXED_STREAM_SAMPLING_RATE;
+		audio_engine->addSource(mixed_stream.stream->audio_source);
+
+		mixed_stream.pos = streams_to_create[i].second;
+		mixed_stream.received_packet = false;
+		mixed_stream.last_packet_time = cur_time;
+
+		Lock lock(mutex);
+		mixed_streams[streams_to_create[i].first] = mixed_stream;
+	}
+}
+
+
+void VoiceReceiver::removeMixedStreams()
+{
+	std::vector<Reference<VoiceStream>> streams_to_remove;
+	{
+		Lock lock(mutex);
+		for(auto it = mixed_streams.begin(); it != mixed_streams.end(); ++it)
+			streams_to_remove.push_back(it->second.stream);
+		mixed_streams.clear();
+		new_mixed_streams.clear();
+	}
+
+	for(size_t i=0; i<streams_to_remove.size(); ++i)
+	{
+		{
+			Lock lock(streams_to_remove[i]->mutex);
+			streams_to_remove[i]->removed = true;
+		}
+		audio_engine->removeSource(streams_to_remove[i]->audio_source);
+	}
+}
+
+
+void VoiceReceiver::handleStreamPacket(const Reference<VoiceStream>& stream_ref, uint32 seq_num, const uint8* opus_data, size_t opus_data_len)
+{
+	VoiceStream* stream = stream_ref.ptr();
+
+	Vec4f cur_listener_pos;
+	{
+		Lock lock(mutex);
+		cur_listener_pos = listener_pos;
+	}
+
+	const float cam_dist2 = stream->audio_source->pos.getDist2(cur_listener_pos);
+	const float volume = stream->audio_source->volume * stream->audio_source->getMuteVolumeFactor();
+	const VoiceDecodePriority priority = getDecodePriority(cam_dist2, volume);
+
+	bool queue_stream = false;
+	{
+		Lock lock(stream->mutex);
+
+		stream->priority = priority;
+		stream->cam_dist2 = cam_dist2;
+
+		if(priority == VoiceDecodePriority_Skip)
+		{
+			// The speaker is inaudible, so don't decode the packet.  Any buffered packets won't be audible either.
+			// The Opus decoder state will be stale when we start decoding again, so reset it then.
+			stream->jitter_buffer.reset();
+			stream->decoder_needs_reset = true;
+			num_packets_skipped.increment();
+			return;
+		}
+
+		const VoiceJitterBuffer::InsertResult insert_res = stream->jitter_buffer.insert(seq_num, opus_data, opus_data_len);
+		if(insert_res == VoiceJitterBuffer::InsertResult_Late)
+		{
+			num_late_packets.increment();
+			return;
+		}
+		else if(insert_res == VoiceJitterBuffer::InsertResult_Duplicate)
+			return;
+
+		if(!stream->decode_queued)
+		{
+			stream->decode_queued = true;
+			queue_stream = true;
+		}
+	}
+
+	if(queue_stream)
+	{
+		{
+			Lock lock(mutex);
+			ReadyStream ready_stream;
+			ready_stream.stream = stream_ref;
+			ready_stream.cam_dist2 = cam_dist2;
+			ready_streams.push_back(ready_stream);
+		}
+
+		VoiceDecodeTask* task = new VoiceDecodeTask();
+		task->receiver = this;
+		decode_task_manager.addTask(task);
+	}
+}
+
+
+void VoiceReceiver::waitForDecodingToComplete()
+{
+	decode_task_manager.waitForTasksToComplete();
+}
+
+
+// There is one VoiceDecodeTask per entry in ready_streams.  Each task decodes the ready stream closest to the listener, so that when decoding falls behind,
+// nearby speakers are decoded first.
+void VoiceReceiver::decodeNextReadyStream()
+{
+	Reference<VoiceStream> stream;
+	{
+		Lock lock(mutex);
+		if(ready_streams.empty())
+			return;
+
+		size_t best_i = 0;
+		for(size_t i=1; i<ready_streams.size(); ++i)
+			if(ready_streams[i].cam_dist2 < ready_streams[best_i].cam_dist2)
+				best_i = i;
+
+		stream = ready_streams[best_i].stream;
+		ready_streams[best_i] = ready_streams.back();
+		ready_streams.pop_back();
+	}
+
+	decodeStream(*stream);
+}
+
+
+void VoiceReceiver::decodeStream(VoiceStream& stream)
+{
+	ZoneScoped; // Tracy profiler
+
+	while(1)
+	{
+		VoiceDecodePriority priority;
+		bool reset_decoder;
+		{
+			Lock lock(stream.mutex);
+			if(stream.removed || !stream.jitter_buffer.popNextFrame(stream.cur_frame))
+			{
+				stream.decode_queued = false;
+				return;
+			}
+			priority = stream.priority;
+			reset_decoder = stream.decoder_needs_reset;
+			stream.decoder_needs_reset = false;
+		}
+
+		decodeFrame(stream, stream.cur_frame, priority, reset_decoder);
+	}
+}
+
+
+void VoiceReceiver::decodeFrame(VoiceStream& stream, const VoiceFrame& frame, VoiceDecodePriority priority, bool reset_decoder)
+{
+	if(reset_decoder)
+		opus_decoder_ctl(stream.opus_decoder, OPUS_RESET_STATE);
+
+	// We are using 10ms frames, so expect sampling_rate * 0.01 samples.
+	const int expected_num_samples = (int)stream.sampling_rate / 100;
+
+	int num_samples_decoded;
+	if(frame.lost)
+	{
+		if(priority != VoiceDecodePriority_Full)
+		{
+			num_lost_frames_not_concealed.increment();
+			return;
+		}
+
+		// Tell Opus we had a missing packet.
+		// "Lost packets can be replaced with loss concealment by calling the decoder with a null pointer and zero length for the missing packet."  https://opus-codec.org/docs/opus_api-1.3.1/group__opus__decoder.html
+		// "For the PLC and FEC cases, frame_size must be a multiple of 2.5 ms."
+		num_samples_decoded = opus_decode_float(stream.opus_decoder, NULL, 0, stream.pcm_buffer.data(), expected_num_samples,
+			0 // decode_fec
+		);
+		num_frames_concealed.increment();
+	}
+	else
+	{
+		num_samples_decoded = opus_decode_float(stream.opus_decoder, frame.data.data(), (opus_int32)frame.data.size(), stream.pcm_buffer.data(), (int)stream.pcm_buffer.size(),
+			0 // decode_fec
+		);
+		num_packets_decoded.increment();
+	}
+
+	if(num_samples_decoded < 0)
+	{
+		conPrint("Opus decoding failed: " + toString(num_samples_decoded));
+		num_decode_errors.increment();
+		return;
+	}
+	if(num_samples_decoded != expected_num_samples)
+	{
+		conPrint("Unexpected number of samples");
+		num_decode_errors.increment();
+		return;
+	}
+
+	// Get max abs value in decoded buffer
+	float max_val = 0;
+	for(int i=0; i<num_samples_decoded; ++i)
+		max_val = myMax(max_val, std::fabs(stream.pcm_buffer[i]));
+
+	// Append to audio source buffer
+	Lock lock(audio_engine->mutex);
+
+	glare::AudioSource* source = stream.audio_source.ptr();
+
+	// If too much data is queued up for this audio source:
+	if(source->buffer.size() > 4096) // 4096 samples ~= 85 ms at 48 khz
+	{
+		// Pop all but 2048 items from the buffer.
+		const size_t num_samples_to_remove = source->buffer.size() - 2048;
+		conPrint("Audio source buffer too full, removing " + toString(num_samples_to_remove) + " samples");
+
+		source->buffer.popFrontNItems(num_samples_to_remove);
+	}
+
+	source->buffer.pushBackNItems(stream.pcm_buffer.data(), num_samples_decoded);
+
+	source->smoothed_cur_level = myMax(source->smoothed_cur_level * 0.95f, max_val);
+}
+
+
+std::string VoiceReceiver::getDiagnostics() const
+{
+	size_t num_mixed_streams;
+	{
+		Lock lock(mutex);
+		num_mixed_streams = mixed_streams.size();
+	}
+
+	return "voice streams: " + toString(streams.size()) + ", mixed streams: " + toString(num_mixed_streams) + ", decoded: " + toString((int64)num_packets_decoded) + ", concealed: " + toString((int64)num_frames_concealed) +
+		", lost (not concealed): " + toString((int64)num_lost_frames_not_concealed) + ", skipped: " + toString((int64)num_packets_skipped) + ", late: " + toString((int64)num_late_packets) + "\n";
+}
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/Timer.h>
+
+
+static void testInsert(VoiceJitterBuffer& buffer, uint32 seq_num, VoiceJitterBuffer::InsertResult expected_res)
+{
+	const uint8 data = (uint8)seq_num;
+	testAssert(buffer.insert(seq_num, &data, 1) == expected_res);
+}
+
+
+static void testPop(VoiceJitterBuffer& buffer, uint32 expected_seq_num, bool expected_lost)
+{
+	VoiceFrame frame;
+	testAssert(buffer.popNextFrame(frame));
+	testAssert(frame.seq_num == expected_seq_num);
+	testAssert(frame.lost == expected_lost);
+	if(!expected_lost)
+		testAssert(frame.data.size() == 1 && frame.data[0] == (uint8)expected_seq_num);
+}
+
+
+static void testNoPop(VoiceJitterBuffer& buffer)
+{
+	VoiceFrame frame;
+	testAssert(!buffer.popNextFrame(frame));
+}
+
+
+struct TestSpeaker
+{
+	Reference<glare::AudioSource> source;
+	uint32 avatar_id;
+	size_t num_samples_received;
+};
+
+
+// Runs a synthetic multi-speaker voice session through a VoiceReceiver.  Returns the elapsed time.
+static double runMultiSpeakerBenchmark(glare::AudioEngine& audio_engine, size_t num_decode_threads, const std::vector<std::vector<uint8>>& packets, int num_speakers, float speaker_spacing,
+	std::vector<TestSpeaker>& speakers_out, Reference<VoiceReceiver>& receiver_out)
+{
+	Reference<VoiceReceiver> receiver = new VoiceReceiver(&audio_engine, num_decode_threads);
+	receiver->setListenerPos(Vec4f(0, 0, 0, 1));
+
+	speakers_out.resize(num_speakers);
+	for(int i=0; i<num_speakers; ++i)
+	{
+		TestSpeaker& speaker = speakers_out[i];
+		speaker.source = new glare::AudioSource();
+		speaker.source->type = glare::AudioSource::SourceType_Streaming;
+		speaker.source->sampling_rate = 48000;
+		speaker.source->pos = Vec4f(i * speaker_spacing, 0, 0, 1);
+		speaker.avatar_id = 1000 + i;
+		speaker.num_samples_received = 0;
+		receiver->createOrUpdateStream(speaker.avatar_id, speaker.source, /*sampling_rate=*/48000, /*stream_id=*/1);
+	}
+
+	Timer timer;
+	const int frames_per_batch = 4; // Deliver packets in batches of 40 ms of audio.
+	const uint32 num_frames = (uint32)packets.size();
+	for(uint32 batch_start = 0; batch_start < num_frames; batch_start += frames_per_batch)
+	{
+		for(uint32 f = batch_start; f < myMin(batch_start + frames_per_batch, num_frames); ++f)
+		for(int i=0; i<num_speakers; ++i)
+		{
+			// Drop some packets, and swap the order of some pairs of packets.
+			if((f * 7 + i) % 20 == 0)
+				continue;
+			uint32 seq_num = f;
+			if(((f / 2) + i) % 13 == 0)
+				seq_num = (f % 2 == 0) ? myMin(f + 1, num_frames - 1) : (f - 1);
+
+			receiver->handleVoicePacket(speakers_out[i].avatar_id, seq_num, packets[seq_num].data(), packets[seq_num].size());
+		}
+
+		receiver->waitForDecodingToComplete();
+
+		// Simulate the audio thread consuming the decoded audio.
+		Lock lock(audio_engine.mutex);
+		for(int i=0; i<num_speakers; ++i)
+		{
+			speakers_out[i].num_samples_received += speakers_out[i].source->buffer.size();
+			speakers_out[i].source->buffer.popFrontNItems(speakers_out[i].source->buffer.size());
+		}
+	}
+
+	receiver_out = receiver;
+	return timer.elapsed();
+}
+
+
+void VoiceReceiver::test()
+{
+	conPrint("VoiceReceiver::test()");
+
+	//------------------------ Test VoiceJitterBuffer ------------------------
+	{
+		// In-order packets
+		VoiceJitterBuffer buffer;
+		testNoPop(buffer);
+		testInsert(buffer, 10, VoiceJitterBuffer::InsertResult_Inserted);
+		testPop(buffer, 10, false);
+		testNoPop(buffer);
+		testInsert(buffer, 11, VoiceJitterBuffer::InsertResult_Inserted);
+		testInsert(buffer, 11, VoiceJitterBuffer::InsertResult_Duplicate);
+		testPop(buffer, 11, false);
+		testInsert(buffer, 11, VoiceJitterBuffer::InsertResult_Late);
+
+		// Out of order packets
+		testInsert(buffer, 13, VoiceJitterBuffer::InsertResult_Inserted);
+		testNoPop(buffer); // Should wait for 12
+		testInsert(buffer, 12, VoiceJitterBuffer::InsertResult_Inserted);
+		testPop(buffer, 12, false);
+		testPop(buffer, 13, false);
+		testNoPop(buffer);
+
+		// Lost packet: 14 is never received.
+		testInsert(buffer, 15, VoiceJitterBuffer::InsertResult_Inserted);
+		testNoPop(buffer);
+		testInsert(buffer, 16, VoiceJitterBuffer::InsertResult_Inserted);
+		testPop(buffer, 14, /*lost=*/true); // 2 later packets have been received, so 14 is considered lost.
+		testPop(buffer, 15, false);
+		testPop(buffer, 16, false);
+		testNoPop(buffer);
+		testInsert(buffer, 14, VoiceJitterBuffer::InsertResult_Late);
+
+		// Packet too far ahead
+		testInsert(buffer, 18, VoiceJitterBuffer::InsertResult_Inserted);
+		testInsert(buffer, 100, VoiceJitterBuffer::InsertResult_Reset);
+		testPop(buffer, 100, false);
+		testNoPop(buffer);
+
+		// Reset
+		buffer.reset();
+		testInsert(buffer, 5, VoiceJitterBuffer::InsertResult_Inserted);
+		testPop(buffer, 5, false);
+	}
+
+	//------------------------ Test getDecodePriority() ------------------------
+	{
+		testAssert(getDecodePriority(0.f, 1.f) == VoiceDecodePriority_Full);
+		testAssert(getDecodePriority(Maths::square(FULL_QUALITY_DIST - 1), 1.f) == VoiceDecodePriority_Full);
+		testAssert(getDecodePriority(Maths::square(FULL_QUALITY_DIST + 1), 1.f) == VoiceDecodePriority_Reduced);
+		testAssert(getDecodePriority(Maths::square(MAX_DECODE_DIST + 1), 1.f) == VoiceDecodePriority_Skip);
+		testAssert(getDecodePriority(0.f, 0.f) == VoiceDecodePriority_Skip); // Muted
+	}
+
+	//------------------------ Synthetic multi-speaker benchmark ------------------------
+	try
+	{
+		// Encode 2 seconds of a synthetic voice-like signal into 10 ms Opus packets.
+		const int sampling_rate = 48000;
+		const int frame_size = sampling_rate / 100;
+		const int num_frames = 200;
+
+		int opus_error = 0;
+		OpusEncoder* opus_encoder = opus_encoder_create(sampling_rate, 1, OPUS_APPLICATION_VOIP, &opus_error);
+		testAssert(opus_error == OPUS_OK);
+
+		std::vector<std::vector<uint8>> packets(num_frames);
+		std::vector<float> pcm(frame_size);
+		std::vector<uint8> encoded(1500);
+		for(int f=0; f<num_frames; ++f)
+		{
+			for(int i=0; i<frame_size; ++i)
+			{
+				const double t = (double)(f * frame_size + i) / sampling_rate;
+				const double envelope = 0.5 + 0.5 * std::sin(t * Maths::get2Pi<double>() * 3.0); // Syllable-rate amplitude modulation
+				pcm[i] = (float)(envelope * 0.3 * (std::sin(t * Maths::get2Pi<double>() * 180.0) + 0.5 * std::sin(t * Maths::get2Pi<double>() * 720.0)));
+			}
+
+			const opus_int32 encoded_B = opus_encode_float(opus_encoder, pcm.data(), frame_size, encoded.data(), (opus_int32)encoded.size());
+			testAssert(encoded_B > 0);
+			packets[f].assign(encoded.begin(), encoded.begin() + encoded_B);
+		}
+		opus_encoder_destroy(opus_encoder);
+
+		glare::AudioEngine audio_engine;
+		const int num_speakers = 64;
+		const float speaker_spacing = 3.f; // Speakers are from 0 to 189 m away from the listener.
+
+		for(int q=0; q<2; ++q)
+		{
+			const size_t num_decode_threads = (q == 0) ? 1 : getDefaultNumDecodeThreads();
+
+			std::vector<TestSpeaker> speakers;
+			Reference<VoiceReceiver> receiver;
+			const double elapsed = runMultiSpeakerBenchmark(audio_engine, num_decode_threads, packets, num_speakers, speaker_spacing, speakers, receiver);
+
+			conPrint("Decoding " + toString(num_speakers) + " speakers x " + toString(num_frames) + " frames with " + toString(num_decode_threads) + " decode thread(s) took " +
+				doubleToStringNSigFigs(elapsed * 1000, 4) + " ms");
+			conPrint(receiver->getDiagnostics());
+
+			testAssert(receiver->num_decode_errors == 0);
+			testAssert(receiver->num_late_packets == 0); // Swapped packet pairs should be reordered by the jitter buffer.
+			testAssert(receiver->num_packets_decoded > 0);
+			testAssert(receiver->num_frames_concealed > 0);
+			testAssert(receiver->num_lost_frames_not_concealed > 0);
+
+			for(int i=0; i<num_speakers; ++i)
+			{
+				const float dist = i * speaker_spacing;
+				if(dist > MAX_DECODE_DIST)
+					testAssert(speakers[i].num_samples_received == 0);
+				else
+				{
+					testAssert(speakers[i].num_samples_received > 0);
+					testAssert(speakers[i].num_samples_received % frame_size == 0);
+					testAssert(speakers[i].num_samples_received <= (size_t)(num_frames * frame_size));
+
+					// Nearby speakers have lost packets concealed, so should receive (almost) all frames.  The last couple of frames may still be waiting in the jitter buffer.
+					if(dist <= FULL_QUALITY_DIST)
+						testAssert(speakers[i].num_samples_received >= (size_t)((num_frames - VoiceJitterBuffer::MAX_WAIT_PACKETS - 1) * frame_size));
+				}
+			}
+		}
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("VoiceReceiver::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,212 @@
+/*=====================================================================
+VoiceReceiver.h
+---------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "../audio/AudioEngine.h"
+#include <utils/ThreadSafeRefCounted.h>
+#include <utils/Reference.h>
+#include <utils/Mutex.h>
+#include <utils/TaskManager.h>
+#include <AtomicInt.h>
+#include <maths/Vec4f.h>
+#include <unordered_map>
+#include <vector>
+struct OpusDecoder;
+
+
+// A voice frame popped from VoiceJitterBuffer.  Either has Opus packet data, or is a lost packet that should be concealed.
+struct VoiceFrame
+{
+	uint32 seq_num;
+	bool lost;
+	std::vector<uint8> data;
+};
+
+
+/*=====================================================================
+VoiceJitterBuffer
+-----------------
+A small per-stream buffer of received voice packets, indexed by sequence
+number.  Packets that arrive out of order are put back in order.
+A missing packet is only treated as lost once MAX_WAIT_PACKETS later
+packets have been received, so a packet that arrives up to
+MAX_WAIT_PACKETS frames late is still used instead of being dropped.
+=====================================================================*/
+class VoiceJitterBuffer
+{
+public:
+	static const uint32 CAPACITY = 8; // Max number of packets buffered.
+	static const uint32 MAX_WAIT_PACKETS = 2; // Number of later packets to receive before a missing packet is considered lost.  With 10 ms frames, this is 20 ms.
+
+	VoiceJitterBuffer();
+
+	enum InsertResult
+	{
+		InsertResult_Inserted,
+		InsertResult_Late, // Packet arrived after it was already popped or treated as lost.  It is discarded.
+		InsertResult_Duplicate,
+		InsertResult_Reset // Packet was too far ahead of the next expected packet, so buffered packets were discarded and the buffer restarted at this packet.
+	};
+
+	InsertResult insert(uint32 seq_num, const uint8* data, size_t data_len);
+
+	// Pops the next frame, if it has been received or is considered lost.  Returns false if there is no frame ready yet.
+	// Swaps frame_out.data with the internal buffer, so frame_out.data storage is reused.
+	bool popNextFrame(VoiceFrame& frame_out);
+
+	// Discards all buffered packets.  The next packet inserted will be the next frame popped.
+	void reset();
+
+	uint32 nextSeqNum() const { return next_seq_num; }
+
+private:
+	struct Slot
+	{
+		std::vector<uint8> data;
+		uint32 seq_num;
+		bool valid;
+	};
+	Slot slots[CAPACITY];
+	uint32 next_seq_num; // Sequence number of the next frame to pop.
+	uint32 highest_seq_num_received;
+	bool started;
+};
+
+
+// How much effort to spend decoding a voice stream, based on distance from the listener and volume.
+enum VoiceDecodePriority
+{
+	VoiceDecodePriority_Full, // Decode all packets, and conceal lost packets.
+	VoiceDecodePriority_Reduced, // Decode received packets, but don't spend time concealing lost packets.
+	VoiceDecodePriority_Skip // Inaudible: don't decode at all.
+};
+
+
+struct VoiceStream : public ThreadSafeRefCounted
+{
+	VoiceStream();
+	~VoiceStream();
+
+	Reference<glare::AudioSource> audio_source;
+	OpusDecoder* opus_decoder;
+	uint32 sampling_rate;
+	uint32 stream_id;
+
+	Mutex mutex;
+	VoiceJitterBuffer jitter_buffer				GUARDED_BY(mutex);
+	VoiceDecodePriority priority				GUARDED_BY(mutex);
+	float cam_dist2								GUARDED_BY(mutex); // Squared distance from listener when the last packet was received.
+	bool decode_queued							GUARDED_BY(mutex); // Is the stream in VoiceReceiver::ready_streams, or being decoded by a VoiceDecodeTask?
+	bool decoder_needs_reset					GUARDED_BY(mutex); // Set when packets were skipped without decoding, so the Opus decoder state is stale.
+	bool removed								GUARDED_BY(mutex);
+
+	// Only accessed by the VoiceDecodeTask decoding the stream.
+	VoiceFrame cur_frame;
+	std::vector<float> pcm_buffer;
+};
+
+
+/*=====================================================================
+VoiceReceiver
+-------------
+Decodes incoming voice chat packets and appends the decoded audio to the
+avatar audio sources.
+
+ClientUDPHandlerThread passes received packets to handleVoicePacket(),
+which puts them in the per-stream jitter buffer.  Decoding is done on a
+small pool of worker threads.  Each stream is decoded by at most one
+task at a time, and when the workers fall behind, streams closest to the
+listener are decoded first.
+
+Streams far from the listener have reduced decoding: lost packets are
+not concealed, and inaudible streams (beyond MAX_DECODE_DIST or with zero
+volume) aren't decoded at all.
+
+In worlds with server voice mixing, the server also sends mixed streams of
+distant speakers, one per region (see ServerVoiceMixer).  These are passed to
+handleMixedVoicePacket().  The audio sources for them are created, moved
+and removed by the main thread in updateMixedStreams().
+=====================================================================*/
+class VoiceReceiver : public ThreadSafeRefCounted
+{
+public:
+	GLARE_ALIGNED_16_NEW_DELETE
+
+	static constexpr float FULL_QUALITY_DIST = 40.f; // Lost packets are concealed for speakers within this distance of the listener.
+	static constexpr float MAX_DECODE_DIST = 120.f; // Speakers further than this from the listener are not decoded.
+	static constexpr double MIXED_STREAM_TIMEOUT = 2.0; // Mixed streams are removed after no packets have been received for this long, in seconds.
+	static const uint32 MIXED_STREAM_SAMPLING_RATE = 48000;
+
+	VoiceReceiver(glare::AudioEngine* audio_engine, size_t num_decode_threads);
+	~VoiceReceiver();
+
+	static size_t getDefaultNumDecodeThreads();
+
+	// Called by the main thread.
+	void setListenerPos(const Vec4f& pos);
+
+	// Called by ClientUDPHandlerThread.
+	void createOrUpdateStream(uint32 avatar_id, const Reference<glare::AudioSource>& audio_source, uint32 sampling_rate, uint32 stream_id);
+	void removeStream(uint32 avatar_id);
+	bool hasStream(uint32 avatar_id) const { return streams.count(avatar_id) != 0; }
+	void getStreamAvatarIDs(std::vector<uint32>& ids_out) const;
+	void handleVoicePacket(uint32 avatar_id, uint32 seq_num, const uint8* opus_data, size_t opus_data_len);
+	void handleMixedVoicePacket(uint32 stream_id, uint32 seq_num, const Vec4f& pos, const uint8* opus_data, size_t opus_data_len);
+
+	// Called by the main thread.  Creates audio sources for new mixed streams, updates their positions, and removes streams that have stopped.
+	void updateMixedStreams(double cur_time);
+	void removeMixedStreams();
+
+	// Blocks until all currently queued decoding is done.
+	void waitForDecodingToComplete();
+
+	static VoiceDecodePriority getDecodePriority(float cam_dist2, float source_volume);
+
+	void decodeNextReadyStream(); // Called by VoiceDecodeTask
+
+	std::string getDiagnostics() const;
+
+	static void test();
+
+	glare::AtomicInt num_packets_decoded;
+	glare::AtomicInt num_frames_concealed;
+	glare::AtomicInt num_lost_frames_not_concealed;
+	glare::AtomicInt num_packets_skipped;
+	glare::AtomicInt num_late_packets;
+	glare::AtomicInt num_decode_errors;
+
+private:
+	void handleStreamPacket(const Reference<VoiceStream>& stream, uint32 seq_num, const uint8* opus_data, size_t opus_data_len);
+	void decodeStream(VoiceStream& stream);
+	void decodeFrame(VoiceStream& stream, const VoiceFrame& frame, VoiceDecodePriority priority, bool reset_decoder);
+
+	glare::AudioEngine* audio_engine;
+
+	std::unordered_map<uint32, Reference<VoiceStream>> streams; // Map from avatar UID to stream.  Only accessed by ClientUDPHandlerThread.
+
+	struct ReadyStream
+	{
+		Reference<VoiceStream> stream;
+		float cam_dist2;
+	};
+
+	struct MixedStream
+	{
+		Reference<VoiceStream> stream;
+		Vec4f pos;
+		bool received_packet; // Has a packet been received since the last updateMixedStreams() call?
+		double last_packet_time;
+	};
+
+	mutable Mutex mutex;
+	Vec4f listener_pos								GUARDED_BY(mutex);
+	std::vector<ReadyStream> ready_streams			GUARDED_BY(mutex); // Streams that have frames ready to be decoded.
+	std::unordered_map<uint32, MixedStream> mixed_streams		GUARDED_BY(mutex); // Map from region stream id to stream.
+	std::unordered_map<uint32, Vec4f> new_mixed_streams		GUARDED_BY(mutex); // Mixed streams packets have been received for, that don't have audio sources yet.  Map from stream id to position.
+
+	glare::TaskManager decode_task_manager;
+};
@@ -0,0 +1,251 @@
+/*=====================================================================
+VoxelMeshCache.cpp
+------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "VoxelMeshCache.h"
+
+
+#include "DiskCacheFile.h"
+#include <utils/FileUtils.h>
+#include <utils/ConPrint.h>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+
+
+static const uint32 VOXEL_MESH_CACHE_MAGIC_NUMBER = 0x7B21D40E;
+static const uint32 VOXEL_MESH_CACHE_VERSION = 1; // Increment when the file format, or the way voxel meshes are built, changes.
+
+
+// DiskCacheFile payload:
+// uint32 subsample factor
+// uint32 num vertices
+// uint32 num triangles
+// vertex positions (3 floats each)
+// triangles (3 uint32 vertex indices, uint32 material index)
+
+
+VoxelMeshCache::VoxelMeshCache(const std::string& cache_dir_)
+:	cache_dir(cache_dir_)
+{
+	try
+	{
+		FileUtils::createDirIfDoesNotExist(cache_dir);
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		conPrint("VoxelMeshCache: failed to create cache dir: " + e.what());
+	}
+}
+
+
+VoxelMeshCache::~VoxelMeshCache()
+{}
+
+
+void VoxelMeshCache::makeKey(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, std::vector<uint8>& key_out)
+{
+	const uint32 num_mats = (uint32)mats_transparent.size();
+
+	key_out.resize(sizeof(uint64) + sizeof(int) + sizeof(uint32) + num_mats);
+	std::memcpy(key_out.data(), &voxel_hash, sizeof(uint64));
+	std::memcpy(key_out.data() + sizeof(uint64), &model_lod_level, sizeof(int));
+	std::memcpy(key_out.data() + sizeof(uint64) + sizeof(int), &num_mats, sizeof(uint32));
+	for(uint32 i=0; i<num_mats; ++i)
+		key_out[sizeof(uint64) + sizeof(int) + sizeof(uint32) + i] = mats_transparent[i] ? 1 : 0;
+}
+
+
+std::string VoxelMeshCache::getPathForKey(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent) const
+{
+	std::vector<uint8> key;
+	makeKey(voxel_hash, model_lod_level, mats_transparent, key);
+	return DiskCacheFile::getPathForKey(cache_dir, key, ".voxmesh");
+}
+
+
+Reference<Indigo::Mesh> VoxelMeshCache::tryLoadMesh(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, int& subsample_factor_out)
+{
+	ZoneScoped; // Tracy profiler
+
+	std::vector<uint8> key;
+	makeKey(voxel_hash, model_lod_level, mats_transparent, key);
+
+	Reference<Indigo::Mesh> mesh;
+	const bool loaded = DiskCacheFile::tryReadFile(DiskCacheFile::getPathForKey(cache_dir, key, ".voxmesh"), VOXEL_MESH_CACHE_MAGIC_NUMBER, VOXEL_MESH_CACHE_VERSION, key, "VoxelMeshCache",
+		[&](DiskCacheFile::Reader& reader)
+		{
+			const uint32 subsample_factor = reader.readValue<uint32>();
+			if(!(subsample_factor == 1 || subsample_factor == 2 || subsample_factor == 4))
+				throw glare::Exception("invalid subsample factor");
+
+			const uint32 num_verts = reader.readValue<uint32>();
+			const uint32 num_tris  = reader.readValue<uint32>();
+			if(((uint64)num_verts * sizeof(Indigo::Vec3f) + (uint64)num_tris * sizeof(uint32) * 4) != reader.bytesRemaining())
+				throw glare::Exception("invalid num verts or tris");
+
+			mesh = new Indigo::Mesh();
+			mesh->setMaxNumTexcoordSets(0);
+
+			mesh->vert_positions.resize(num_verts);
+			reader.read(mesh->vert_positions.data(), num_verts * sizeof(Indigo::Vec3f));
+
+			mesh->triangles.resize(num_tris);
+			for(uint32 i=0; i<num_tris; ++i)
+			{
+				uint32 tri_data[4];
+				reader.read(tri_data, sizeof(tri_data));
+				for(int c=0; c<3; ++c)
+				{
+					if(tri_data[c] >= num_verts)
+						throw glare::Exception("invalid vertex index");
+					mesh->triangles[i].vertex_indices[c] = tri_data[c];
+					mesh->triangles[i].uv_indices[c] = 0;
+				}
+				mesh->triangles[i].tri_mat_index = tri_data[3];
+			}
+
+			mesh->endOfModel();
+
+			subsample_factor_out = (int)subsample_factor;
+		});
+
+	if(!loaded)
+	{
+		num_misses.increment();
+		return nullptr;
+	}
+
+	num_hits.increment();
+	return mesh;
+}
+
+
+void VoxelMeshCache::storeMesh(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, int subsample_factor, const Indigo::Mesh& mesh)
+{
+	ZoneScoped; // Tracy profiler
+
+	std::vector<uint8> key;
+	makeKey(voxel_hash, model_lod_level, mats_transparent, key);
+
+	std::vector<uint8> file_data;
+	file_data.reserve(64 + key.size() + mesh.vert_positions.size() * sizeof(Indigo::Vec3f) + mesh.triangles.size() * sizeof(uint32) * 4);
+
+	DiskCacheFile::beginFile(VOXEL_MESH_CACHE_MAGIC_NUMBER, VOXEL_MESH_CACHE_VERSION, key, file_data);
+	DiskCacheFile::appendToBuffer(file_data, (uint32)subsample_factor);
+	DiskCacheFile::appendToBuffer(file_data, (uint32)mesh.vert_positions.size());
+	DiskCacheFile::appendToBuffer(file_data, (uint32)mesh.triangles.size());
+
+	for(size_t i=0; i<mesh.vert_positions.size(); ++i)
+		DiskCacheFile::appendToBuffer(file_data, mesh.vert_positions[i]);
+
+	for(size_t i=0; i<mesh.triangles.size(); ++i)
+	{
+		const uint32 tri_data[4] = { mesh.triangles[i].vertex_indices[0], mesh.triangles[i].vertex_indices[1], mesh.triangles[i].vertex_indices[2], mesh.triangles[i].tri_mat_index };
+		DiskCacheFile::appendToBuffer(file_data, tri_data);
+	}
+
+	DiskCacheFile::writeFile(DiskCacheFile::getPathForKey(cache_dir, key, ".voxmesh"), file_data, "VoxelMeshCache");
+}
+
+
+#if BUILD_TESTS
+
+
+#include "../shared/VoxelMeshBuilding.h"
+#include "../shared/WorldObject.h"
+#include <utils/TestUtils.h>
+#include <utils/PlatformUtils.h>
+
+
+static void checkMeshesEqual(const Indigo::Mesh& a, const Indigo::Mesh& b)
+{
+	testAssert(a.vert_positions.size() == b.vert_positions.size());
+	testAssert(a.triangles.size() == b.triangles.size());
+	for(size_t i=0; i<a.vert_positions.size(); ++i)
+		testAssert(a.vert_positions[i] == b.vert_positions[i]);
+	for(size_t i=0; i<a.triangles.size(); ++i)
+	{
+		for(int c=0; c<3; ++c)
+			testAssert(a.triangles[i].vertex_indices[c] == b.triangles[i].vertex_indices[c]);
+		testAssert(a.triangles[i].tri_mat_index == b.triangles[i].tri_mat_index);
+	}
+	testAssert(a.num_materials_referenced == b.num_materials_referenced);
+	testAssert(a.aabb_os.bound[0] == b.aabb_os.bound[0] && a.aabb_os.bound[1] == b.aabb_os.bound[1]);
+}
+
+
+void VoxelMeshCache::test()
+{
+	conPrint("VoxelMeshCache::test()");
+
+	try
+	{
+		const std::string cache_dir = PlatformUtils::getTempDirPath() + "/voxel_mesh_cache_test";
+		Reference<VoxelMeshCache> cache = new VoxelMeshCache(cache_dir);
+		DiskCacheFile::deleteFilesInDir(cache_dir);
+
+		VoxelGroup group;
+		group.voxels.push_back(Voxel(Vec3<int>(0, 0, 0), 0));
+		group.voxels.push_back(Voxel(Vec3<int>(1, 0, 0), 0));
+		group.voxels.push_back(Voxel(Vec3<int>(0, 0, 1), 1));
+		group.voxels.push_back(Voxel(Vec3<int>(5, 3, 2), 1));
+
+		js::Vector<bool, 16> mats_transparent(2, false);
+		mats_transparent[1] = true;
+
+		const uint64 voxel_hash = 123456789;
+		const int model_lod_level = 0;
+
+		Reference<Indigo::Mesh> mesh = VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(group, /*subsample_factor=*/1, mats_transparent, /*mem_allocator=*/nullptr);
+
+		// Should miss before the mesh is stored
+		int subsample_factor = 0;
+		testAssert(!cache->tryLoadMesh(voxel_hash, model_lod_level, mats_transparent, subsample_factor));
+
+		cache->storeMesh(voxel_hash, model_lod_level, mats_transparent, /*subsample_factor=*/1, *mesh);
+
+		Reference<Indigo::Mesh> loaded_mesh = cache->tryLoadMesh(voxel_hash, model_lod_level, mats_transparent, subsample_factor);
+		testAssert(loaded_mesh.nonNull());
+		testAssert(subsample_factor == 1);
+		checkMeshesEqual(*mesh, *loaded_mesh);
+
+		// Different key components should miss
+		testAssert(!cache->tryLoadMesh(voxel_hash + 1, model_lod_level, mats_transparent, subsample_factor));
+		testAssert(!cache->tryLoadMesh(voxel_hash, /*model_lod_level=*/1, mats_transparent, subsample_factor));
+		{
+			js::Vector<bool, 16> other_mats_transparent(2, false);
+			testAssert(!cache->tryLoadMesh(voxel_hash, model_lod_level, other_mats_transparent, subsample_factor));
+		}
+
+		// An invalid cache file should be treated as a miss.  (See DiskCacheFile::test() for tests of corrupted and truncated files.)
+		FileUtils::writeEntireFile(cache->getPathForKey(voxel_hash, model_lod_level, mats_transparent), "invalid", 7);
+		testAssert(!cache->tryLoadMesh(voxel_hash, model_lod_level, mats_transparent, subsample_factor));
+
+		// A new cache object using the same dir should see entries stored by the first cache object.
+		{
+			cache->storeMesh(voxel_hash, /*model_lod_level=*/2, mats_transparent, /*subsample_factor=*/4, *mesh);
+
+			Reference<VoxelMeshCache> cache2 = new VoxelMeshCache(cache_dir);
+			loaded_mesh = cache2->tryLoadMesh(voxel_hash, /*model_lod_level=*/2, mats_transparent, subsample_factor);
+			testAssert(loaded_mesh.nonNull());
+			testAssert(subsample_factor == 4);
+			checkMeshesEqual(*mesh, *loaded_mesh);
+		}
+
+		DiskCacheFile::deleteFilesInDir(cache_dir);
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("VoxelMeshCache::test() done.");
+}
+
+
+#endif // BUILD_TESTS
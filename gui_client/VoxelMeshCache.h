@@ -0,0 +1,62 @@
+/*=====================================================================
+VoxelMeshCache.h
+----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <dll/include/IndigoMesh.h>
+#include <utils/Vector.h>
+#include <ThreadSafeRefCounted.h>
+#include <AtomicInt.h>
+#include <string>
+#include <vector>
+
+
+/*=====================================================================
+VoxelMeshCache
+--------------
+On-disk cache of meshes built from voxel groups by
+VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(), so that voxel objects
+don't need to be re-meshed every session.  Objects with identical voxel
+data (copies of the same build) share a cache entry.
+
+Entries are keyed by the hash of the compressed voxel data, the model LOD
+level, and which materials are transparent (which affects which faces are
+created).  The cached mesh doesn't include lightmap UVs, since those depend
+on the object transform.
+
+Files use the DiskCacheFile format, which stores the full key and a
+checksum, so hash collisions and truncated or corrupted files are detected
+and treated as cache misses.
+
+Threadsafe.
+=====================================================================*/
+class VoxelMeshCache : public ThreadSafeRefCounted
+{
+public:
+	// Creates cache_dir if it doesn't exist already.
+	VoxelMeshCache(const std::string& cache_dir);
+	~VoxelMeshCache();
+
+	// Returns the cached mesh and sets subsample_factor_out, or returns null if there is no valid cache entry.
+	Reference<Indigo::Mesh> tryLoadMesh(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, int& subsample_factor_out);
+
+	// Writes the mesh to the cache.  Failures to write are ignored (apart from printing a message), since the cache is just an optimisation.
+	void storeMesh(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, int subsample_factor, const Indigo::Mesh& mesh);
+
+	std::string getPathForKey(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent) const;
+
+	size_t numHits() const { return (size_t)num_hits; }
+	size_t numMisses() const { return (size_t)num_misses; }
+
+	static void test();
+
+private:
+	static void makeKey(uint64 voxel_hash, int model_lod_level, const js::Vector<bool, 16>& mats_transparent, std::vector<uint8>& key_out);
+
+	std::string cache_dir;
+	glare::AtomicInt num_hits;
+	glare::AtomicInt num_misses;
+};
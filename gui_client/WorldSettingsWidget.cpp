@@ -42,6 +42,7 @@ WorldSettingsWidget::WorldSettingsWidget(QWidget* parent)
 	connect(this->layer1ASpinBox,				SIGNAL(valueChanged(double)),		this, SLOT(settingsChangedSlot()));
 	connect(this->layer1HeightScaleSpinBox,		SIGNAL(valueChanged(double)),		this, SLOT(settingsChangedSlot()));
 	connect(this->spawnPointCheckBox,			SIGNAL(toggled(bool)),				this, SLOT(settingsChangedSlot()));
+	connect(this->serverVoiceMixingCheckBox,	SIGNAL(toggled(bool)),				this, SLOT(settingsChangedSlot()));
 	connect(this->spawnXDoubleSpinBox,			SIGNAL(valueChanged(double)),		this, SLOT(settingsChangedSlot()));
 	connect(this->spawnYDoubleSpinBox,			SIGNAL(valueChanged(double)),		this, SLOT(settingsChangedSlot()));
 	connect(this->spawnZDoubleSpinBox,			SIGNAL(valueChanged(double)),		this, SLOT(settingsChangedSlot()));
@@ -113,6 +114,8 @@ void WorldSettingsWidget::setFromWorldSettings(const WorldSettings& world_settin
 	spawnXDoubleSpinBox->setEnabled(BitUtils::isBitSet(world_settings.flags, WorldSettings::USE_SPAWN_POINT_FLAG));
 	spawnYDoubleSpinBox->setEnabled(BitUtils::isBitSet(world_settings.flags, WorldSettings::USE_SPAWN_POINT_FLAG));
 	spawnZDoubleSpinBox->setEnabled(BitUtils::isBitSet(world_settings.flags, WorldSettings::USE_SPAWN_POINT_FLAG));
+
+	SignalBlocker::setChecked(serverVoiceMixingCheckBox, BitUtils::isBitSet(world_settings.flags, WorldSettings::SERVER_VOICE_MIXING_FLAG));
 }
 
 
@@ -182,6 +185,8 @@ void WorldSettingsWidget::toWorldSettings(WorldSettings& world_settings_out)
 	world_settings_out.flags = 0;
 	if(spawnPointCheckBox->isChecked())
 		BitUtils::setBit(world_settings_out.flags, WorldSettings::USE_SPAWN_POINT_FLAG);
+	if(serverVoiceMixingCheckBox->isChecked())
+		BitUtils::setBit(world_settings_out.flags, WorldSettings::SERVER_VOICE_MIXING_FLAG);
 	world_settings_out.spawn_point.x = spawnXDoubleSpinBox->value();
 	world_settings_out.spawn_point.y = spawnYDoubleSpinBox->value();
 	world_settings_out.spawn_point.z = spawnZDoubleSpinBox->value();
@@ -228,6 +233,8 @@ void WorldSettingsWidget::updateControlsEditable()
 	spawnYDoubleSpinBox->setReadOnly(!editable);
 	spawnZDoubleSpinBox->setReadOnly(!editable);
 
+	serverVoiceMixingCheckBox->setEnabled(editable);
+
 	applyPushButton->setEnabled(editable);
 }
 
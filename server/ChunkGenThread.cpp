@@ -8,6 +8,8 @@ Copyright Glare Technologies Limited 2024 -
 
 #include "Server.h"
 #include "ServerWorldState.h"
+#include "ServerMetrics.h"
+#include "ServerProfiler.h"
 #include "../shared/LODGeneration.h"
 #include "../shared/MessageUtils.h"
 #include "../shared/VoxelMeshBuilding.h"
@@ -1057,6 +1059,8 @@ static ChunkBuildResults buildChunkForObInfo(std::vector<ObInfo>& ob_infos, int
 
 static ChunkBuildResults buildChunk(ServerAllWorldsState* world_state, Reference<ServerWorldState> world, const js::AABBox chunk_aabb, int chunk_x, int chunk_y, glare::TaskManager& task_manager)
 {
+	SERVER_PROFILE_ZONE("ChunkGenThread: buildChunk");
+
 	std::vector<ObInfo> ob_infos;
 
 	{
@@ -1087,7 +1091,10 @@ static ChunkBuildResults buildChunk(ServerAllWorldsState* world_state, Reference
 				if(have_mesh)
 				{
 					if(!isFinite(ob->angle))
+					{
 						ob->angle = 0;
+						ob->invalidateNetworkSerialisationCache();
+					}
 
 					if(/*!isFinite(ob->angle) || */!ob->axis.isFinite())
 					{
@@ -1335,6 +1342,8 @@ void ChunkGenThread::doRun()
 
 			for(size_t i=0; i<dirty_chunks.size(); ++i)
 			{
+				ServerMetrics::get().chunk_gen_backlog->set((int64)(dirty_chunks.size() - i));
+
 				LODChunkRef chunk = dirty_chunks[i].chunk;
 				const int x = chunk->coords.x;
 				const int y = chunk->coords.y;
@@ -1455,6 +1464,8 @@ void ChunkGenThread::doRun()
 				}
 			}
 
+			ServerMetrics::get().chunk_gen_backlog->set(0);
+
 			if(!dirty_chunks.empty())
 				conPrint("---------Finished building " + toString(dirty_chunks.size()) + " dirty chunks.---------");
 
@@ -0,0 +1,432 @@
+/*=====================================================================
+ClientSendQueue.cpp
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ClientSendQueue.h"
+
+
+#include "../shared/Protocol.h"
+#include <maths/mathstypes.h>
+#include <cstring>
+
+
+ClientSendQueue::ClientSendQueue(size_t high_watermark_, size_t low_watermark_, double max_time_over_limit_)
+:	transform_bytes(0),
+	in_flight_bytes(0),
+	high_watermark(high_watermark_),
+	low_watermark(low_watermark_),
+	max_time_over_limit(max_time_over_limit_),
+	over_limit(false),
+	over_limit_start_time(0),
+	num_superseded_transform_updates(0)
+{
+	assert(low_watermark <= high_watermark);
+}
+
+
+ClientSendQueue::~ClientSendQueue()
+{}
+
+
+static inline bool isSupersedableMessageType(uint32 msg_type)
+{
+	return (msg_type == Protocol::ObjectTransformUpdate) || (msg_type == Protocol::ObjectPhysicsTransformUpdate) || (msg_type == Protocol::AvatarTransformUpdate);
+}
+
+
+// Reliable messages with an object UID straight after the header.
+static inline bool isObjectUIDMessageType(uint32 msg_type)
+{
+	return (msg_type == Protocol::ObjectCreated) || (msg_type == Protocol::ObjectDestroyed) || (msg_type == Protocol::ObjectFullUpdate) || (msg_type == Protocol::ObjectLightmapURLChanged) ||
+		(msg_type == Protocol::ObjectFlagsChanged) || (msg_type == Protocol::ObjectModelURLChanged) || (msg_type == Protocol::ObjectPhysicsOwnershipTaken) || (msg_type == Protocol::ObjectContentChanged) ||
+		(msg_type == Protocol::ObjectMoveTo) || (msg_type == Protocol::ObjectRotateTo);
+}
+
+
+// Reliable messages with an avatar UID straight after the header.
+static inline bool isAvatarUIDMessageType(uint32 msg_type)
+{
+	return (msg_type == Protocol::AvatarCreated) || (msg_type == Protocol::AvatarDestroyed) || (msg_type == Protocol::AvatarFullUpdate) || (msg_type == Protocol::AvatarIsHere) ||
+		(msg_type == Protocol::AvatarPerformGesture) || (msg_type == Protocol::AvatarStopGesture) || (msg_type == Protocol::AvatarEnteredVehicle) || (msg_type == Protocol::AvatarExitedVehicle) ||
+		(msg_type == Protocol::AvatarSatOnSeat) || (msg_type == Protocol::AvatarGotUpFromSeat);
+}
+
+
+// Messages that contain the full object or avatar state, or destroy it, so any pending transform update for the UID can be discarded.
+static inline bool supersedesTransformUpdates(uint32 msg_type)
+{
+	return (msg_type == Protocol::ObjectDestroyed) || (msg_type == Protocol::ObjectFullUpdate) || (msg_type == Protocol::AvatarDestroyed) || (msg_type == Protocol::AvatarFullUpdate);
+}
+
+
+static void appendData(js::Vector<uint8, 16>& v, const uint8* data, size_t size)
+{
+	if(size > 0)
+	{
+		const size_t write_i = v.size();
+		v.resize(write_i + size);
+		std::memcpy(&v[write_i], data, size);
+	}
+}
+
+
+void ClientSendQueue::enqueueMessages(ArrayRef<uint8> data, double cur_time)
+{
+	const size_t HEADER_SIZE = sizeof(uint32) * 2;
+
+	size_t i = 0;
+	while(i < data.size())
+	{
+		uint32 msg_type = 0;
+		uint32 msg_len = 0;
+		if(i + HEADER_SIZE <= data.size())
+		{
+			std::memcpy(&msg_type, &data[i],     sizeof(uint32));
+			std::memcpy(&msg_len,  &data[i + 4], sizeof(uint32));
+		}
+
+		if((i + HEADER_SIZE > data.size()) || (msg_len < HEADER_SIZE) || (msg_len > data.size() - i))
+		{
+			// Data is not a valid message sequence.  Just append the remaining data to the reliable data so it is sent unchanged.
+			assert(0);
+			appendData(reliable_data, &data[i], data.size() - i);
+			break;
+		}
+
+		if(isSupersedableMessageType(msg_type) && (msg_len >= HEADER_SIZE + sizeof(uint64))) // Transform update messages have the UID straight after the header.
+		{
+			TransformUpdateKey key;
+			std::memcpy(&key.uid, &data[i + HEADER_SIZE], sizeof(uint64));
+			key.is_avatar = (msg_type == Protocol::AvatarTransformUpdate) ? 1 : 0;
+
+			auto res = slot_index_for_key.find(key);
+			if(res != slot_index_for_key.end()) // If there is a pending update for this UID:
+			{
+				// Replace the pending update with the new one.  The pending update may be of the other object transform update type, in which case the slot takes the new message type.
+				TransformUpdateSlot& slot = transform_slots[res->second];
+				if(slot.size == msg_len)
+				{
+					std::memcpy(&transform_data[slot.offset], &data[i], msg_len); // Overwrite in place.
+				}
+				else
+				{
+					transform_bytes -= slot.size;
+					slot.offset = transform_data.size();
+					slot.size = msg_len;
+					appendData(transform_data, &data[i], msg_len);
+					transform_bytes += msg_len;
+				}
+				num_superseded_transform_updates++;
+			}
+			else
+			{
+				TransformUpdateSlot slot;
+				slot.offset = transform_data.size();
+				slot.size = msg_len;
+				appendData(transform_data, &data[i], msg_len);
+				transform_bytes += msg_len;
+
+				slot_index_for_key[key] = transform_slots.size();
+				transform_slots.push_back(slot);
+			}
+		}
+		else
+		{
+			// If there is a pending transform update for the object or avatar this message refers to, it must not be sent after this message, otherwise the client would end up with the stale transform.
+			if(!slot_index_for_key.empty() && (msg_len >= HEADER_SIZE + sizeof(uint64)))
+			{
+				const bool is_object_message = isObjectUIDMessageType(msg_type);
+				if(is_object_message || isAvatarUIDMessageType(msg_type))
+				{
+					TransformUpdateKey key;
+					std::memcpy(&key.uid, &data[i + HEADER_SIZE], sizeof(uint64));
+					key.is_avatar = is_object_message ? 0 : 1;
+					removePendingTransformUpdate(key, /*move_to_reliable_data=*/!supersedesTransformUpdates(msg_type));
+				}
+			}
+
+			appendData(reliable_data, &data[i], msg_len);
+		}
+
+		i += msg_len;
+	}
+
+	updateLimitState(cur_time);
+}
+
+
+// Removes the pending transform update for the key, if any, appending it to the reliable data if move_to_reliable_data is true.
+void ClientSendQueue::removePendingTransformUpdate(const TransformUpdateKey& key, bool move_to_reliable_data)
+{
+	auto res = slot_index_for_key.find(key);
+	if(res != slot_index_for_key.end())
+	{
+		TransformUpdateSlot& slot = transform_slots[res->second];
+		if(move_to_reliable_data)
+			appendData(reliable_data, &transform_data[slot.offset], slot.size);
+		transform_bytes -= slot.size;
+		slot.size = 0;
+
+		slot_index_for_key.erase(res);
+	}
+}
+
+
+void ClientSendQueue::dequeueAll(js::Vector<uint8, 16>& data_out)
+{
+	data_out.reserve(data_out.size() + numQueuedBytes());
+
+	// Reliable messages go first.
+	appendData(data_out, reliable_data.data(), reliable_data.size());
+
+	for(size_t i=0; i<transform_slots.size(); ++i)
+		appendData(data_out, &transform_data[transform_slots[i].offset], transform_slots[i].size); // Removed slots have zero size, so nothing is appended for them.
+
+	reliable_data.clear();
+	transform_data.clear();
+	transform_slots.clear();
+	slot_index_for_key.clear();
+	transform_bytes = 0;
+}
+
+
+void ClientSendQueue::setInFlightBytes(size_t num_bytes, double cur_time)
+{
+	in_flight_bytes = num_bytes;
+
+	updateLimitState(cur_time);
+}
+
+
+void ClientSendQueue::updateLimitState(double cur_time)
+{
+	const size_t total_bytes = numQueuedBytes() + in_flight_bytes;
+	if(over_limit)
+	{
+		if(total_bytes < low_watermark)
+			over_limit = false;
+	}
+	else
+	{
+		if(total_bytes > high_watermark)
+		{
+			over_limit = true;
+			over_limit_start_time = cur_time;
+		}
+	}
+}
+
+
+#if BUILD_TESTS
+
+
+#include "../shared/MessageUtils.h"
+#include "../shared/UID.h"
+#include <ConPrint.h>
+#include <StringUtils.h>
+#include <TestUtils.h>
+#include <SocketBufferOutStream.h>
+#include <BufferViewInStream.h>
+
+
+static void writeTestMessage(uint32 msg_type, uint64 uid, uint32 payload, std::vector<uint8>& data_out)
+{
+	SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+	MessageUtils::initPacket(packet, msg_type);
+	writeToStream(UID(uid), packet);
+	packet.writeUInt32(payload);
+	MessageUtils::updatePacketLengthField(packet);
+
+	data_out.insert(data_out.end(), packet.buf.begin(), packet.buf.end());
+}
+
+
+struct TestMessage
+{
+	uint32 type;
+	uint64 uid;
+	uint32 payload;
+};
+
+
+static std::vector<TestMessage> readTestMessages(const js::Vector<uint8, 16>& data)
+{
+	std::vector<TestMessage> msgs;
+	BufferViewInStream stream(ArrayRef<uint8>(data.data(), data.size()));
+	while(!stream.endOfStream())
+	{
+		TestMessage msg;
+		msg.type = stream.readUInt32();
+		const uint32 len = stream.readUInt32();
+		testAssert(len == sizeof(uint32) * 3 + sizeof(uint64));
+		msg.uid = stream.readUInt64();
+		msg.payload = stream.readUInt32();
+		msgs.push_back(msg);
+	}
+	return msgs;
+}
+
+
+void ClientSendQueue::test()
+{
+	conPrint("ClientSendQueue::test()");
+
+	//-------------------- Test superseding and ordering --------------------
+	{
+		ClientSendQueue queue(/*high_watermark=*/1000000, /*low_watermark=*/100000, /*max_time_over_limit=*/10.0);
+
+		std::vector<uint8> data;
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/100, data);
+		writeTestMessage(Protocol::ChatMessageID,         /*uid=*/0, /*payload=*/200, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/2, /*payload=*/300, data);
+		writeTestMessage(Protocol::AvatarTransformUpdate, /*uid=*/1, /*payload=*/400, data); // Different message type, so shouldn't supersede the object update with uid 1.
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/500, data); // Should supersede the first message.
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+
+		testAssert(queue.numQueuedTransformUpdates() == 3);
+		testAssert(queue.numSupersededTransformUpdates() == 1);
+
+		js::Vector<uint8, 16> out;
+		queue.dequeueAll(out);
+		testAssert(queue.isEmpty());
+		testAssert(queue.numQueuedBytes() == 0);
+
+		const std::vector<TestMessage> msgs = readTestMessages(out);
+		testAssert(msgs.size() == 4);
+		testAssert(msgs[0].type == Protocol::ChatMessageID && msgs[0].payload == 200); // Reliable message should be first
+		testAssert(msgs[1].type == Protocol::ObjectTransformUpdate && msgs[1].uid == 1 && msgs[1].payload == 500); // Superseded update keeps original queue position.
+		testAssert(msgs[2].type == Protocol::ObjectTransformUpdate && msgs[2].uid == 2 && msgs[2].payload == 300);
+		testAssert(msgs[3].type == Protocol::AvatarTransformUpdate && msgs[3].uid == 1 && msgs[3].payload == 400);
+	}
+
+	//-------------------- Test that reliable messages about an object or avatar are not sent before an earlier pending transform update for it --------------------
+	{
+		ClientSendQueue queue(/*high_watermark=*/1000000, /*low_watermark=*/100000, /*max_time_over_limit=*/10.0);
+
+		// Transform update at tick N, then a full update at tick N+1.  The stale transform update should be discarded.
+		std::vector<uint8> data;
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/100, data);
+		writeTestMessage(Protocol::AvatarTransformUpdate, /*uid=*/1, /*payload=*/200, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/2, /*payload=*/300, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+		data.clear();
+		writeTestMessage(Protocol::ObjectFullUpdate, /*uid=*/1, /*payload=*/400, data);
+		writeTestMessage(Protocol::AvatarFullUpdate, /*uid=*/1, /*payload=*/500, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+
+		testAssert(queue.numQueuedTransformUpdates() == 1);
+
+		// A transform update after the full update should still be sent after it.
+		data.clear();
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/600, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+
+		js::Vector<uint8, 16> out;
+		queue.dequeueAll(out);
+		testAssert(queue.isEmpty());
+
+		std::vector<TestMessage> msgs = readTestMessages(out);
+		testAssert(msgs.size() == 4);
+		testAssert(msgs[0].type == Protocol::ObjectFullUpdate && msgs[0].uid == 1 && msgs[0].payload == 400);
+		testAssert(msgs[1].type == Protocol::AvatarFullUpdate && msgs[1].uid == 1 && msgs[1].payload == 500);
+		testAssert(msgs[2].type == Protocol::ObjectTransformUpdate && msgs[2].uid == 2 && msgs[2].payload == 300);
+		testAssert(msgs[3].type == Protocol::ObjectTransformUpdate && msgs[3].uid == 1 && msgs[3].payload == 600);
+
+		// Other messages about the object should be sent after the pending transform update for it.
+		data.clear();
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/700, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/2, /*payload=*/800, data);
+		writeTestMessage(Protocol::ObjectMoveTo,          /*uid=*/1, /*payload=*/900, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/1, /*payload=*/1000, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+		testAssert(queue.numQueuedBytes() == data.size());
+
+		out.clear();
+		queue.dequeueAll(out);
+		msgs = readTestMessages(out);
+		testAssert(msgs.size() == 4);
+		testAssert(msgs[0].type == Protocol::ObjectTransformUpdate && msgs[0].uid == 1 && msgs[0].payload == 700);
+		testAssert(msgs[1].type == Protocol::ObjectMoveTo && msgs[1].uid == 1 && msgs[1].payload == 900);
+		testAssert(msgs[2].type == Protocol::ObjectTransformUpdate && msgs[2].uid == 2 && msgs[2].payload == 800);
+		testAssert(msgs[3].type == Protocol::ObjectTransformUpdate && msgs[3].uid == 1 && msgs[3].payload == 1000);
+	}
+
+	//-------------------- Test interleaved ObjectTransformUpdate and ObjectPhysicsTransformUpdate messages for the same object --------------------
+	{
+		ClientSendQueue queue(/*high_watermark=*/1000000, /*low_watermark=*/100000, /*max_time_over_limit=*/10.0);
+
+		// Transform update A, physics transform update B, then transform update C.  Only C should be sent, otherwise the client would end up with the stale transform from B.
+		std::vector<uint8> data;
+		writeTestMessage(Protocol::ObjectTransformUpdate,        /*uid=*/1, /*payload=*/100, data);
+		writeTestMessage(Protocol::ObjectPhysicsTransformUpdate, /*uid=*/1, /*payload=*/200, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate,        /*uid=*/2, /*payload=*/300, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate,        /*uid=*/1, /*payload=*/400, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+
+		testAssert(queue.numQueuedTransformUpdates() == 2);
+		testAssert(queue.numSupersededTransformUpdates() == 2);
+
+		js::Vector<uint8, 16> out;
+		queue.dequeueAll(out);
+		std::vector<TestMessage> msgs = readTestMessages(out);
+		testAssert(msgs.size() == 2);
+		testAssert(msgs[0].type == Protocol::ObjectTransformUpdate && msgs[0].uid == 1 && msgs[0].payload == 400);
+		testAssert(msgs[1].type == Protocol::ObjectTransformUpdate && msgs[1].uid == 2 && msgs[1].payload == 300);
+
+		// Likewise the other way around: the last physics transform update should be sent.
+		data.clear();
+		writeTestMessage(Protocol::ObjectPhysicsTransformUpdate, /*uid=*/1, /*payload=*/500, data);
+		writeTestMessage(Protocol::ObjectTransformUpdate,        /*uid=*/1, /*payload=*/600, data);
+		writeTestMessage(Protocol::ObjectPhysicsTransformUpdate, /*uid=*/1, /*payload=*/700, data);
+		queue.enqueueMessages(data, /*cur_time=*/0.0);
+
+		out.clear();
+		queue.dequeueAll(out);
+		msgs = readTestMessages(out);
+		testAssert(msgs.size() == 1);
+		testAssert(msgs[0].type == Protocol::ObjectPhysicsTransformUpdate && msgs[0].uid == 1 && msgs[0].payload == 700);
+	}
+
+	//-------------------- Test watermarks and disconnection --------------------
+	{
+		std::vector<uint8> data;
+		writeTestMessage(Protocol::ChatMessageID, /*uid=*/0, /*payload=*/0, data);
+		const size_t msg_size = data.size();
+
+		ClientSendQueue queue(/*high_watermark=*/msg_size * 10, /*low_watermark=*/msg_size * 2, /*max_time_over_limit=*/10.0);
+
+		for(int i=0; i<10; ++i)
+			queue.enqueueMessages(data, /*cur_time=*/0.0);
+		testAssert(!queue.isOverLimit());
+
+		queue.enqueueMessages(data, /*cur_time=*/1.0);
+		testAssert(queue.isOverLimit());
+		testAssert(!queue.shouldDisconnect(/*cur_time=*/5.0));
+		testAssert(queue.shouldDisconnect(/*cur_time=*/11.5));
+
+		// Dequeue, but keep the data in flight.  Should still be over the limit.
+		js::Vector<uint8, 16> out;
+		queue.dequeueAll(out);
+		queue.setInFlightBytes(out.size(), /*cur_time=*/2.0);
+		testAssert(queue.isOverLimit());
+
+		// Data has been written, should be under the low watermark now.
+		queue.setInFlightBytes(0, /*cur_time=*/3.0);
+		testAssert(!queue.isOverLimit());
+		testAssert(!queue.shouldDisconnect(/*cur_time=*/20.0));
+
+		// Transform updates for the same UID shouldn't push the queue over the limit.
+		std::vector<uint8> transform_data;
+		writeTestMessage(Protocol::ObjectTransformUpdate, /*uid=*/123, /*payload=*/0, transform_data);
+		for(int i=0; i<1000; ++i)
+			queue.enqueueMessages(transform_data, /*cur_time=*/4.0);
+		testAssert(!queue.isOverLimit());
+		testAssert(queue.numQueuedBytes() == transform_data.size());
+	}
+
+	conPrint("ClientSendQueue::test() done");
+}
+
+
+#endif // BUILD_TESTS
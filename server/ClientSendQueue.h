@@ -0,0 +1,108 @@
+/*=====================================================================
+ClientSendQueue.h
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <Vector.h>
+#include <ArrayRef.h>
+#include <Platform.h>
+#include <unordered_map>
+#include <vector>
+
+
+/*=====================================================================
+ClientSendQueue
+---------------
+Outbound message queue for a single client connection (WorkerThread).
+
+Data is enqueued as a sequence of complete protocol messages (uint32 message type,
+uint32 message length, payload).  Transform update messages (ObjectTransformUpdate,
+ObjectPhysicsTransformUpdate, AvatarTransformUpdate) are stored separately, keyed by
+UID and whether the UID is an object or avatar UID, and a newer update for the same
+UID replaces any pending one.  ObjectTransformUpdate and ObjectPhysicsTransformUpdate
+share a key, since they both set the object transform, and only the latest should be sent.
+All other (reliable) messages are sent in order, before any pending transform updates.
+
+Reliable messages about an object or avatar, such as ObjectFullUpdate, are never sent
+before a pending transform update for the same UID that was enqueued before them.
+Full updates and destroy messages replace the pending transform update, other
+messages cause it to be moved to the reliable data, in front of the message.
+
+The queue tracks the number of queued and in-flight bytes.  When this goes above
+high_watermark, the queue is considered over the limit, until it drops below low_watermark.
+If the queue stays over the limit for longer than max_time_over_limit, shouldDisconnect()
+returns true.
+
+Not threadsafe, WorkerThread guards it with data_to_send_mutex.
+=====================================================================*/
+class ClientSendQueue
+{
+public:
+	ClientSendQueue(size_t high_watermark, size_t low_watermark, double max_time_over_limit);
+	~ClientSendQueue();
+
+	// Enqueue zero or more complete messages.
+	void enqueueMessages(ArrayRef<uint8> data, double cur_time);
+
+	// Appends all pending data to data_out (reliable messages first, then transform updates), and clears the queue.
+	void dequeueAll(js::Vector<uint8, 16>& data_out);
+
+	// Set the number of bytes that have been dequeued and are currently being written to the socket.  These count towards the watermark limits.
+	void setInFlightBytes(size_t num_bytes, double cur_time);
+
+	bool isEmpty() const { return (reliable_data.size() == 0) && slot_index_for_key.empty(); }
+
+	size_t numQueuedBytes() const { return reliable_data.size() + transform_bytes; }
+	size_t numQueuedTransformUpdates() const { return slot_index_for_key.size(); }
+	size_t numSupersededTransformUpdates() const { return num_superseded_transform_updates; }
+
+	bool isOverLimit() const { return over_limit; }
+
+	// Returns true if the queue has been over the high watermark (and not yet back under the low watermark) for longer than max_time_over_limit.
+	bool shouldDisconnect(double cur_time) const { return over_limit && ((cur_time - over_limit_start_time) > max_time_over_limit); }
+
+	static void test();
+
+private:
+	void updateLimitState(double cur_time);
+	struct TransformUpdateKey
+	{
+		uint64 uid;
+		uint32 is_avatar; // 1 for AvatarTransformUpdate, 0 for ObjectTransformUpdate and ObjectPhysicsTransformUpdate.
+
+		bool operator == (const TransformUpdateKey& other) const { return uid == other.uid && is_avatar == other.is_avatar; }
+	};
+
+	struct TransformUpdateKeyHash
+	{
+		size_t operator() (const TransformUpdateKey& k) const { return (size_t)(k.uid * 0x9E3779B97F4A7C15ull) ^ (size_t)k.is_avatar; }
+	};
+
+	void removePendingTransformUpdate(const TransformUpdateKey& key, bool move_to_reliable_data);
+
+	struct TransformUpdateSlot
+	{
+		size_t offset; // Offset in transform_data
+		size_t size; // Zero if the update was removed.
+	};
+
+	js::Vector<uint8, 16> reliable_data;
+
+	js::Vector<uint8, 16> transform_data; // May contain stale data from superseded updates whose size changed.
+	std::vector<TransformUpdateSlot> transform_slots; // In order of first enqueue.
+	std::unordered_map<TransformUpdateKey, size_t, TransformUpdateKeyHash> slot_index_for_key;
+	size_t transform_bytes; // Sum of sizes of live transform slots.
+
+	size_t in_flight_bytes;
+
+	size_t high_watermark;
+	size_t low_watermark;
+	double max_time_over_limit;
+	bool over_limit;
+	double over_limit_start_time;
+
+	size_t num_superseded_transform_updates;
+};
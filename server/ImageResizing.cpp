@@ -0,0 +1,284 @@
+/*=====================================================================
+ImageResizing.cpp
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ImageResizing.h"
+
+
+#include <maths/Vec4f.h>
+#include <utils/Vector.h>
+#include <utils/Exception.h>
+#include <utils/StringUtils.h>
+#include <cmath>
+#include <vector>
+
+
+namespace ImageResizing
+{
+
+
+// Filter taps for a single destination pixel.
+struct FilterSpan
+{
+	int first_tap_i; // Index into FilterTaps::weights
+	int num_taps;
+};
+
+
+// Taps for all destination pixels along one axis.
+struct FilterTaps
+{
+	std::vector<FilterSpan> spans;
+	std::vector<int> src_indices;
+	std::vector<float> weights;
+};
+
+
+// Computes tent filter weights mapping src_size pixels to dst_size pixels.
+static void computeFilterTaps(int src_size, int dst_size, FilterTaps& taps_out)
+{
+	const float scale = (float)src_size / (float)dst_size; // Source pixels per destination pixel
+	const float radius = myMax(1.f, scale); // Filter radius in source pixels.  Widen when downsampling so all source pixels contribute.
+	const float recip_radius = 1 / radius;
+
+	taps_out.spans.resize(dst_size);
+	taps_out.src_indices.clear();
+	taps_out.weights.clear();
+
+	for(int d=0; d<dst_size; ++d)
+	{
+		const float center = ((float)d + 0.5f) * scale - 0.5f; // Centre of destination pixel in source pixel coordinates.
+		const int begin = (int)std::ceil(center - radius);
+		const int end   = (int)std::floor(center + radius);
+
+		const int first_tap_i = (int)taps_out.weights.size();
+		float weight_sum = 0;
+		for(int s=begin; s<=end; ++s)
+		{
+			const float w = 1 - std::fabs((float)s - center) * recip_radius;
+			if(w > 0)
+			{
+				taps_out.src_indices.push_back(myClamp(s, 0, src_size - 1));
+				taps_out.weights.push_back(w);
+				weight_sum += w;
+			}
+		}
+
+		if(weight_sum == 0) // Shouldn't happen, but handle just in case.
+		{
+			taps_out.src_indices.push_back(myClamp((int)(center + 0.5f), 0, src_size - 1));
+			taps_out.weights.push_back(1.f);
+			weight_sum = 1.f;
+		}
+
+		// Normalise weights
+		const int num_taps = (int)taps_out.weights.size() - first_tap_i;
+		const float recip_weight_sum = 1 / weight_sum;
+		for(int i=0; i<num_taps; ++i)
+			taps_out.weights[first_tap_i + i] *= recip_weight_sum;
+
+		taps_out.spans[d].first_tap_i = first_tap_i;
+		taps_out.spans[d].num_taps = num_taps;
+	}
+}
+
+
+// Filters source row y horizontally into a new_w wide row of Vec4f pixels.
+static void filterRowHorizontally(const ImageMapUInt8& src, int y, const FilterTaps& x_taps, js::Vector<Vec4f, 16>& src_row, Vec4f* dst_row)
+{
+	const int src_w = (int)src.getWidth();
+	const int N = (int)src.getN();
+	const int new_w = (int)x_taps.spans.size();
+
+	// Convert source row to float pixels
+	const uint8* src_row_data = src.getData() + (size_t)y * src_w * N;
+	for(int x=0; x<src_w; ++x)
+	{
+		float p[4] = { 0, 0, 0, 0 };
+		for(int c=0; c<N; ++c)
+			p[c] = (float)src_row_data[x * N + c];
+		src_row[x] = Vec4f(p[0], p[1], p[2], p[3]);
+	}
+
+	for(int x=0; x<new_w; ++x)
+	{
+		const FilterSpan span = x_taps.spans[x];
+		const int* const indices = &x_taps.src_indices[span.first_tap_i];
+		const float* const weights = &x_taps.weights[span.first_tap_i];
+
+		Vec4f sum(0.f);
+		for(int t=0; t<span.num_taps; ++t)
+			sum += src_row[indices[t]] * weights[t];
+		dst_row[x] = sum;
+	}
+}
+
+
+ImageMapUInt8Ref resizeImage(const ImageMapUInt8& src, int new_w, int new_h)
+{
+	const int src_w = (int)src.getWidth();
+	const int src_h = (int)src.getHeight();
+	const int N = (int)src.getN();
+
+	if(N < 1 || N > 4)
+		throw glare::Exception("ImageResizing::resizeImage: unsupported number of channels: " + toString(N));
+	if(src_w < 1 || src_h < 1 || new_w < 1 || new_h < 1)
+		throw glare::Exception("ImageResizing::resizeImage: invalid image size");
+
+	FilterTaps x_taps, y_taps;
+	computeFilterTaps(src_w, new_w, x_taps);
+	computeFilterTaps(src_h, new_h, y_taps);
+
+	// The source rows used by each destination row are a contiguous range, and the range only moves forwards as the destination row increases.
+	// So we only need to keep the horizontally filtered rows for the largest range, in a ring buffer indexed by source row index modulo the ring size.
+	int ring_size = 1;
+	for(int y=0; y<new_h; ++y)
+	{
+		const FilterSpan span = y_taps.spans[y];
+		int min_src_y = src_h;
+		int max_src_y = -1;
+		for(int t=0; t<span.num_taps; ++t)
+		{
+			min_src_y = myMin(min_src_y, y_taps.src_indices[span.first_tap_i + t]);
+			max_src_y = myMax(max_src_y, y_taps.src_indices[span.first_tap_i + t]);
+		}
+		ring_size = myMax(ring_size, max_src_y - min_src_y + 1);
+	}
+
+	js::Vector<Vec4f, 16> src_row(src_w);
+	js::Vector<Vec4f, 16> ring_rows((size_t)ring_size * new_w);
+	std::vector<int> ring_row_src_y(ring_size, -1); // Source row index currently stored in each ring buffer slot, or -1 if none.
+
+	// For each destination row, accumulate weighted horizontally-filtered rows.
+	ImageMapUInt8Ref dst = new ImageMapUInt8(new_w, new_h, N);
+	uint8* const dst_data = dst->getData();
+	js::Vector<Vec4f, 16> accum_row(new_w);
+	const Vec4f zero(0.f);
+	const Vec4f max_val(255.f);
+	const Vec4f half(0.5f);
+
+	for(int y=0; y<new_h; ++y)
+	{
+		const FilterSpan span = y_taps.spans[y];
+
+		for(int x=0; x<new_w; ++x)
+			accum_row[x] = zero;
+
+		for(int t=0; t<span.num_taps; ++t)
+		{
+			const int src_y = y_taps.src_indices[span.first_tap_i + t];
+			const int slot = src_y % ring_size;
+			Vec4f* const row = &ring_rows[(size_t)slot * new_w];
+			if(ring_row_src_y[slot] != src_y)
+			{
+				filterRowHorizontally(src, src_y, x_taps, src_row, row);
+				ring_row_src_y[slot] = src_y;
+			}
+
+			const Vec4f w(y_taps.weights[span.first_tap_i + t]);
+			for(int x=0; x<new_w; ++x)
+				accum_row[x] += row[x] * w;
+		}
+
+		uint8* const dst_row_data = dst_data + (size_t)y * new_w * N;
+		for(int x=0; x<new_w; ++x)
+		{
+			const Vec4f clamped = min(max(accum_row[x] + half, zero), max_val);
+			for(int c=0; c<N; ++c)
+				dst_row_data[x * N + c] = (uint8)clamped[c];
+		}
+	}
+
+	return dst;
+}
+
+
+} // end namespace ImageResizing
+
+
+#if BUILD_TESTS
+
+
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+#include <utils/Timer.h>
+#include <maths/PCG32.h>
+
+
+void ImageResizing::test()
+{
+	conPrint("ImageResizing::test()");
+
+	// Test resizing a constant-colour image gives the same colour
+	{
+		ImageMapUInt8 src(100, 80, 3);
+		for(size_t i=0; i<src.numPixels(); ++i)
+		{
+			src.getPixel(i)[0] = 10;
+			src.getPixel(i)[1] = 128;
+			src.getPixel(i)[2] = 255;
+		}
+
+		ImageMapUInt8Ref resized = resizeImage(src, 33, 17);
+		testAssert(resized->getWidth() == 33 && resized->getHeight() == 17 && resized->getN() == 3);
+		for(size_t i=0; i<resized->numPixels(); ++i)
+		{
+			testAssert(resized->getPixel(i)[0] == 10);
+			testAssert(resized->getPixel(i)[1] == 128);
+			testAssert(resized->getPixel(i)[2] == 255);
+		}
+
+		// Test upsampling also
+		resized = resizeImage(src, 250, 190);
+		for(size_t i=0; i<resized->numPixels(); ++i)
+			testAssert(resized->getPixel(i)[1] == 128);
+	}
+
+	// Test that downsampling approximately preserves the mean value of a random image.
+	{
+		PCG32 rng(1);
+		ImageMapUInt8 src(400, 300, 1);
+		double src_sum = 0;
+		for(size_t i=0; i<src.numPixels(); ++i)
+		{
+			src.getPixel(i)[0] = (uint8)rng.nextUInt(256);
+			src_sum += src.getPixel(i)[0];
+		}
+
+		ImageMapUInt8Ref resized = resizeImage(src, 100, 75);
+		double resized_sum = 0;
+		for(size_t i=0; i<resized->numPixels(); ++i)
+			resized_sum += resized->getPixel(i)[0];
+
+		const double src_mean = src_sum / src.numPixels();
+		const double resized_mean = resized_sum / resized->numPixels();
+		testAssert(std::fabs(src_mean - resized_mean) < 1.0);
+	}
+
+	// Perf test: resize a 4K image to the photo midsize width, compare against resizeMidQuality()
+	{
+		ImageMapUInt8 src(3840, 2160, 3);
+		for(size_t i=0; i<src.numPixels(); ++i)
+			for(int c=0; c<3; ++c)
+				src.getPixel(i)[c] = (uint8)((i * (c + 1)) % 256);
+
+		const int new_w = 1000;
+		const int new_h = 1000 * 2160 / 3840;
+		{
+			Timer timer;
+			ImageMapUInt8Ref resized = resizeImage(src, new_w, new_h);
+			conPrint("ImageResizing::resizeImage 3840x2160 -> " + toString(new_w) + "x" + toString(new_h) + " took " + timer.elapsedStringNSigFigs(4));
+		}
+		{
+			Timer timer;
+			Map2DRef resized = src.resizeMidQuality(new_w, new_h, /*task_manager=*/nullptr);
+			conPrint("resizeMidQuality 3840x2160 -> " + toString(new_w) + "x" + toString(new_h) + " took " + timer.elapsedStringNSigFigs(4));
+		}
+	}
+
+	conPrint("ImageResizing::test() done");
+}
+
+
+#endif // BUILD_TESTS
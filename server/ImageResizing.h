@@ -0,0 +1,31 @@
+/*=====================================================================
+ImageResizing.h
+---------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <graphics/ImageMap.h>
+
+
+/*=====================================================================
+ImageResizing
+-------------
+Separable image resizing using a tent filter whose width is scaled with the
+downsampling ratio (so it is effectively area-averaging when downsampling).
+
+The horizontal and vertical passes work on 4-component float pixels (Vec4f),
+so each filter tap processes all channels of a pixel with a single SIMD multiply-add.
+Horizontally filtered rows are kept in a ring buffer only as long as the vertical
+pass needs them, so memory use doesn't scale with the source image height.
+=====================================================================*/
+namespace ImageResizing
+{
+
+// Resize image to new_w x new_h.  Image must have 1 to 4 channels.
+ImageMapUInt8Ref resizeImage(const ImageMapUInt8& src, int new_w, int new_h);
+
+void test();
+
+}
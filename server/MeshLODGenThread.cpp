@@ -8,9 +8,12 @@ Copyright Glare Technologies Limited 2022 -
 
 #include "Server.h"
 #include "ServerWorldState.h"
+#include "ServerMetrics.h"
+#include "ServerProfiler.h"
 #include "../shared/LODGeneration.h"
 #include "../shared/ImageDecoding.h"
 #include "../shared/Protocol.h"
+#include "../shared/JoltShapeBuilding.h"
 #include <ConPrint.h>
 #include <Exception.h>
 #include <Lock.h>
@@ -53,6 +56,17 @@ struct LODMeshToGen
 };
 
 
+// Physics shape to build from an optimised mesh.
+struct PhysicsShapeToGen
+{
+	std::string model_abs_path; // Optimised mesh path, to read mesh from.
+	std::string shape_abs_path; // Path to write shape resource to.
+	URLString shape_URL;
+	bool dynamic; // Build convex hull shape if true, mesh shape otherwise.
+	UserID owner_id;
+};
+
+
 struct LODTextureToGen
 {
 	std::string source_tex_abs_path; // Absolute base texture path, to read texture from.
@@ -147,6 +161,14 @@ static void checkObjectSpaceAABB(ServerAllWorldsState* world_state, ServerWorldS
 				BatchedMeshRef batched_mesh = LODGeneration::loadModel(model_abs_path);
 					
 				aabb_os = batched_mesh->aabb_os;
+
+				ObjectModelStats model_stats;
+				model_stats.num_triangles = batched_mesh->numIndices() / 3;
+				model_stats.file_size_B = FileUtils::getFileSize(model_abs_path);
+
+				WorldStateLock lock(world_state->mutex);
+				world_state->model_URL_to_stats[ob->model_url] = model_stats;
+				world->updateObjectAccounting(*ob, world_state->model_URL_to_stats, lock); // Account the triangles and bytes now they are known.
 			}
 		}
 		else
@@ -282,7 +304,38 @@ static void checkForLODMeshesToGenerate(ServerAllWorldsState* world_state, Serve
 //static size_t sum_optimised_size_B = 0;
 
 
-static void checkForOptimisedMeshesToGenerate(ServerAllWorldsState* world_state, ServerWorldState* world, WorldObject* ob, std::unordered_set<URLString, URLStringHasher>& lod_URLs_considered, std::vector<LODMeshToGen>& meshes_to_gen)
+// Add the static and dynamic physics shapes for an optimised mesh to shapes_to_gen, if they are not present already.
+// The optimised mesh itself doesn't need to be present yet, as meshes are generated before shapes.
+static void checkForPhysicsShapesToGenerate(ResourceManager* resource_manager, const URLString& opt_lod_URL, const std::string& opt_lod_abs_path, UserID owner_id, 
+	std::unordered_set<URLString, URLStringHasher>& lod_URLs_considered, std::vector<PhysicsShapeToGen>& shapes_to_gen)
+{
+	for(int dynamic=0; dynamic<2; ++dynamic)
+	{
+		const URLString shape_URL = WorldObject::getPhysicsShapeURLForModelURL(opt_lod_URL, /*dynamic=*/dynamic != 0);
+		if(shape_URL.empty())
+			continue;
+
+		if(lod_URLs_considered.count(shape_URL) == 0)
+		{
+			lod_URLs_considered.insert(shape_URL);
+
+			if(!resource_manager->isFileForURLPresent(shape_URL))
+			{
+				PhysicsShapeToGen shape_to_gen;
+				shape_to_gen.model_abs_path = opt_lod_abs_path;
+				shape_to_gen.shape_abs_path = resource_manager->pathForURL(shape_URL);
+				shape_to_gen.shape_URL = shape_URL;
+				shape_to_gen.dynamic = dynamic != 0;
+				shape_to_gen.owner_id = owner_id;
+				shapes_to_gen.push_back(shape_to_gen);
+			}
+		}
+	}
+}
+
+
+static void checkForOptimisedMeshesToGenerate(ServerAllWorldsState* world_state, ServerWorldState* world, WorldObject* ob, std::unordered_set<URLString, URLStringHasher>& lod_URLs_considered, std::vector<LODMeshToGen>& meshes_to_gen,
+	std::vector<PhysicsShapeToGen>& physics_shapes_to_gen)
 {
 	try
 	{
@@ -303,6 +356,9 @@ static void checkForOptimisedMeshesToGenerate(ServerAllWorldsState* world_state,
 						WorldObject::GetLODModelURLOptions options(/*get_optimised_mesh=*/true, Protocol::OPTIMISED_MESH_VERSION);
 
 						const URLString lod_URL = WorldObject::getLODModelURLForLevel(ob->model_url, lvl, options);
+						const std::string lod_abs_path = toStdString(WorldObject::getLODModelURLForLevel(toURLString(base_model_abs_path), lvl, options));
+
+						checkForPhysicsShapesToGenerate(world_state->resource_manager.ptr(), lod_URL, lod_abs_path, base_resource->owner_id, lod_URLs_considered, physics_shapes_to_gen);
 
 						if(lod_URLs_considered.count(lod_URL) == 0)
 						{
@@ -310,8 +366,6 @@ static void checkForOptimisedMeshesToGenerate(ServerAllWorldsState* world_state,
 
 							if(!world_state->resource_manager->isFileForURLPresent(lod_URL))
 							{
-								const std::string lod_abs_path = toStdString(WorldObject::getLODModelURLForLevel(toURLString(base_model_abs_path), lvl, options));
-
 								// Add to list of models to generate
 								LODMeshToGen mesh_to_gen;
 								mesh_to_gen.lod_level = lvl;
@@ -761,6 +815,7 @@ void MeshLODGenThread::doRun()
 			// Set object max_lod_level if it is a generic model or a voxel model.
 			// Compute list of LOD meshes we need to generate.
 			std::vector<LODMeshToGen> meshes_to_gen;
+			std::vector<PhysicsShapeToGen> physics_shapes_to_gen;
 			std::vector<LODTextureToGen> lod_textures_to_gen;
 			std::vector<BasisTextureToGen> basis_textures_to_gen;
 			std::unordered_set<URLString, URLStringHasher> lod_URLs_considered;
@@ -792,7 +847,7 @@ void MeshLODGenThread::doRun()
 									checkMaterialFlags(world_state, world, ob, tex_info);
 
 								checkForLODMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen);
-								checkForOptimisedMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen);
+								checkForOptimisedMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen, physics_shapes_to_gen);
 								checkForLODTexturesToGenerate(world_state, world, ob, lod_URLs_considered, lod_textures_to_gen);
 								checkForBasisTexturesToGenerateForOb(world_state, ob, lod_URLs_considered, basis_textures_to_gen);
 							}
@@ -840,7 +895,7 @@ void MeshLODGenThread::doRun()
 								try
 								{
 									checkForLODMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen);
-									checkForOptimisedMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen);
+									checkForOptimisedMeshesToGenerate(world_state, world, ob, lod_URLs_considered, meshes_to_gen, physics_shapes_to_gen);
 									checkForLODTexturesToGenerate(world_state, world, ob, lod_URLs_considered, lod_textures_to_gen);
 									checkForBasisTexturesToGenerateForOb(world_state, ob, lod_URLs_considered, basis_textures_to_gen);
 								}
@@ -861,9 +916,12 @@ void MeshLODGenThread::doRun()
 				}
 			} // End lock scope
 
-			if(!meshes_to_gen.empty() || !lod_textures_to_gen.empty() || !basis_textures_to_gen.empty())
-				conPrint("MeshLODGenThread: Iterating over objects took " + timer.elapsedStringNSigFigs(4) + ", meshes_to_gen: " + toString(meshes_to_gen.size()) + ", lod_textures_to_gen: " + toString(lod_textures_to_gen.size()) + 
-					", basis_textures_to_gen: " + toString(basis_textures_to_gen.size()));
+			if(!meshes_to_gen.empty() || !physics_shapes_to_gen.empty() || !lod_textures_to_gen.empty() || !basis_textures_to_gen.empty())
+				conPrint("MeshLODGenThread: Iterating over objects took " + timer.elapsedStringNSigFigs(4) + ", meshes_to_gen: " + toString(meshes_to_gen.size()) + ", physics_shapes_to_gen: " + toString(physics_shapes_to_gen.size()) + 
+					", lod_textures_to_gen: " + toString(lod_textures_to_gen.size()) + ", basis_textures_to_gen: " + toString(basis_textures_to_gen.size()));
+
+			MetricsGauge* backlog_gauge = ServerMetrics::get().mesh_lod_gen_backlog;
+			backlog_gauge->set((int64)(meshes_to_gen.size() + physics_shapes_to_gen.size() + lod_textures_to_gen.size() + basis_textures_to_gen.size()));
 
 
 			//-------------------------------------------  Generate each mesh, without holding the world lock -------------------------------------------
@@ -874,6 +932,8 @@ void MeshLODGenThread::doRun()
 
 				for(size_t i=0; i<meshes_to_gen.size(); ++i)
 				{
+					SERVER_PROFILE_ZONE("MeshLODGenThread: Generate mesh");
+					backlog_gauge->add(-1);
 					const LODMeshToGen& mesh_to_gen = meshes_to_gen[i];
 					try
 					{
@@ -924,6 +984,67 @@ void MeshLODGenThread::doRun()
 			}
 
 
+			//------------------------------------------- Generate each physics shape, without holding the world lock -------------------------------------------
+			// Done after generating meshes, since shapes are built from optimised meshes.
+			if(!physics_shapes_to_gen.empty())
+			{
+				conPrint("MeshLODGenThread: Generating physics shapes...");
+				timer.reset();
+
+				for(size_t i=0; i<physics_shapes_to_gen.size(); ++i)
+				{
+					SERVER_PROFILE_ZONE("MeshLODGenThread: Generate physics shape");
+					backlog_gauge->add(-1);
+					const PhysicsShapeToGen& shape_to_gen = physics_shapes_to_gen[i];
+					try
+					{
+						conPrint("MeshLODGenThread: (shape " + toString(i) + " / " + toString(physics_shapes_to_gen.size()) + "): Generating physics shape with URL " + toStdString(shape_to_gen.shape_URL));
+
+						if(!FileUtils::fileExists(shape_to_gen.model_abs_path)) // Optimised mesh generation may have failed.
+							throw glare::Exception("Optimised mesh '" + shape_to_gen.model_abs_path + "' not present.");
+
+						// Process the mesh the same way the client does before building a shape (see ModelLoading::makeGLMeshDataAndPhysicsShape())
+						BatchedMeshRef mesh = LODGeneration::loadModel(shape_to_gen.model_abs_path); // Calls checkValidAndSanitiseMesh()
+						mesh->optimise();
+
+						JPH::Ref<JPH::Shape> shape = JoltShapeBuilding::buildShapeForBatchedMesh(*mesh, shape_to_gen.dynamic);
+
+						JoltShapeBuilding::writeShapeResourceToDisk(*shape, shape_to_gen.shape_abs_path);
+
+						// Now that we have generated the shape, add it to resources.
+						{ // lock scope
+							Lock lock(world_state->mutex);
+
+							const std::string raw_path = FileUtils::getFilename(shape_to_gen.shape_abs_path); // NOTE: assuming we can get raw/relative path from abs path like this.
+
+							ResourceRef resource = new Resource(
+								shape_to_gen.shape_URL, // URL
+								raw_path, // raw local path
+								Resource::State_Present, // state
+								shape_to_gen.owner_id,
+								/*external_resource=*/false
+							);
+
+							world_state->addResourceAsDBDirty(resource);
+							world_state->resource_manager->addResource(resource);
+
+						} // End lock scope
+
+						server->enqueueMsg(new NewResourceGenerated(shape_to_gen.shape_URL));
+					}
+					catch(glare::Exception& e)
+					{
+						conPrint("\tMeshLODGenThread: glare::Exception while generating physics shape for URL '" + toStdString(shape_to_gen.shape_URL) + "': " + e.what());
+					}
+
+					if(should_quit)
+						return;
+				}
+
+				conPrint("MeshLODGenThread: Done generating physics shapes. (Elapsed: " + timer.elapsedStringNSigFigs(4) + ")");
+			}
+
+
 			//------------------------------------------- Generate each texture, without holding the world lock -------------------------------------------
 			if(!lod_textures_to_gen.empty())
 			{
@@ -932,6 +1053,8 @@ void MeshLODGenThread::doRun()
 
 				for(size_t i=0; i<lod_textures_to_gen.size(); ++i)
 				{
+					SERVER_PROFILE_ZONE("MeshLODGenThread: Generate LOD texture");
+					backlog_gauge->add(-1);
 					const LODTextureToGen& tex_to_gen = lod_textures_to_gen[i];
 					try
 					{
@@ -980,6 +1103,8 @@ void MeshLODGenThread::doRun()
 
 				for(size_t i=0; i<basis_textures_to_gen.size(); ++i)
 				{
+					SERVER_PROFILE_ZONE("MeshLODGenThread: Generate basis texture");
+					backlog_gauge->add(-1);
 					const BasisTextureToGen& tex_to_gen = basis_textures_to_gen[i];
 					try
 					{
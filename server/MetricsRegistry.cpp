@@ -0,0 +1,387 @@
+/*=====================================================================
+MetricsRegistry.cpp
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "MetricsRegistry.h"
+
+
+#include <Lock.h>
+#include <Exception.h>
+#include <StringUtils.h>
+#include <ConPrint.h>
+#include <maths/mathstypes.h>
+#include <cstdio>
+#include <limits>
+#if defined(_WIN32)
+#include <intrin.h>
+#endif
+
+
+int Metrics::getCurThreadShardIndex()
+{
+	static std::atomic<int> next_shard_index(0);
+	static thread_local int shard_index = next_shard_index.fetch_add(1) % NUM_SHARDS;
+	return shard_index;
+}
+
+
+static inline int highestSetBitIndex(uint64 x) // x must be non-zero.
+{
+#if defined(_WIN32)
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(x);
+#endif
+}
+
+
+static std::string formatDouble(double x)
+{
+	char buf[64];
+	std::snprintf(buf, sizeof(buf), "%.9g", x);
+	return std::string(buf);
+}
+
+
+//------------------------------------------------ MetricsCounter ------------------------------------------------
+
+
+MetricsCounter::MetricsCounter()
+{
+	for(int i=0; i<Metrics::NUM_SHARDS; ++i)
+		shards[i].value.store(0);
+}
+
+
+uint64 MetricsCounter::getValue() const
+{
+	uint64 sum = 0;
+	for(int i=0; i<Metrics::NUM_SHARDS; ++i)
+		sum += shards[i].value.load(std::memory_order_relaxed);
+	return sum;
+}
+
+
+//------------------------------------------------ MetricsHistogram ------------------------------------------------
+
+
+MetricsHistogram::MetricsHistogram()
+{
+	for(int i=0; i<Metrics::NUM_SHARDS; ++i)
+	{
+		shards[i].count.store(0);
+		shards[i].sum.store(0);
+		for(int z=0; z<NUM_BUCKETS; ++z)
+			shards[i].buckets[z].store(0);
+	}
+}
+
+
+int MetricsHistogram::getBucketIndex(uint64 value)
+{
+	if(value < (uint64)NUM_SUB_BUCKETS)
+		return (int)value;
+
+	const int e = highestSetBitIndex(value); // >= SUB_BUCKET_BITS
+	const int sub_bucket = (int)((value >> (e - SUB_BUCKET_BITS)) & (NUM_SUB_BUCKETS - 1));
+	return NUM_SUB_BUCKETS + (e - SUB_BUCKET_BITS) * NUM_SUB_BUCKETS + sub_bucket;
+}
+
+
+uint64 MetricsHistogram::getBucketLowerBound(int bucket_index)
+{
+	if(bucket_index < NUM_SUB_BUCKETS)
+		return (uint64)bucket_index;
+
+	const int e = (bucket_index - NUM_SUB_BUCKETS) / NUM_SUB_BUCKETS + SUB_BUCKET_BITS;
+	const int sub_bucket = (bucket_index - NUM_SUB_BUCKETS) % NUM_SUB_BUCKETS;
+	return ((uint64)(NUM_SUB_BUCKETS + sub_bucket)) << (e - SUB_BUCKET_BITS);
+}
+
+
+void MetricsHistogram::getSnapshot(Snapshot& snapshot_out) const
+{
+	snapshot_out.count = 0;
+	snapshot_out.sum = 0;
+	snapshot_out.bucket_counts.assign(NUM_BUCKETS, 0);
+
+	for(int i=0; i<Metrics::NUM_SHARDS; ++i)
+	{
+		snapshot_out.count += shards[i].count.load(std::memory_order_relaxed);
+		snapshot_out.sum   += shards[i].sum.load(std::memory_order_relaxed);
+		for(int z=0; z<NUM_BUCKETS; ++z)
+			snapshot_out.bucket_counts[z] += shards[i].buckets[z].load(std::memory_order_relaxed);
+	}
+}
+
+
+uint64 MetricsHistogram::Snapshot::getQuantile(double q) const
+{
+	uint64 total = 0;
+	for(size_t i=0; i<bucket_counts.size(); ++i)
+		total += bucket_counts[i];
+	if(total == 0)
+		return 0;
+
+	const uint64 target = myMax<uint64>(1, (uint64)(q * (double)total + 0.5)); // Rank of the q-quantile value, in [1, total]
+	uint64 cumulative = 0;
+	for(size_t i=0; i<bucket_counts.size(); ++i)
+	{
+		cumulative += bucket_counts[i];
+		if(cumulative >= target)
+			return getBucketLowerBound((int)i);
+	}
+	return getBucketLowerBound(NUM_BUCKETS - 1);
+}
+
+
+//------------------------------------------------ MetricsRegistry ------------------------------------------------
+
+
+MetricsRegistry::MetricsRegistry()
+{}
+
+
+MetricsRegistry::~MetricsRegistry()
+{}
+
+
+MetricsRegistry::Family& MetricsRegistry::getOrCreateFamily(const std::string& name, const std::string& help, MetricType type)
+{
+	auto res = families.find(name);
+	if(res != families.end())
+	{
+		if(res->second.type != type)
+			throw glare::Exception("Metric '" + name + "' already exists with a different type.");
+		return res->second;
+	}
+
+	Family& family = families[name];
+	family.type = type;
+	family.help = help;
+	return family;
+}
+
+
+MetricsCounter* MetricsRegistry::getOrCreateCounter(const std::string& name, const std::string& help, const std::string& labels)
+{
+	Lock lock(mutex);
+	Reference<MetricsCounter>& metric = getOrCreateFamily(name, help, MetricType_Counter).counters[labels];
+	if(metric.isNull())
+		metric = new MetricsCounter();
+	return metric.ptr();
+}
+
+
+MetricsGauge* MetricsRegistry::getOrCreateGauge(const std::string& name, const std::string& help, const std::string& labels)
+{
+	Lock lock(mutex);
+	Reference<MetricsGauge>& metric = getOrCreateFamily(name, help, MetricType_Gauge).gauges[labels];
+	if(metric.isNull())
+		metric = new MetricsGauge();
+	return metric.ptr();
+}
+
+
+MetricsHistogram* MetricsRegistry::getOrCreateHistogram(const std::string& name, const std::string& help, const std::string& labels)
+{
+	Lock lock(mutex);
+	Reference<MetricsHistogram>& metric = getOrCreateFamily(name, help, MetricType_Histogram).histograms[labels];
+	if(metric.isNull())
+		metric = new MetricsHistogram();
+	return metric.ptr();
+}
+
+
+static std::string labelsString(const std::string& labels, const std::string& extra_label = std::string())
+{
+	if(labels.empty() && extra_label.empty())
+		return std::string();
+	else if(labels.empty())
+		return "{" + extra_label + "}";
+	else if(extra_label.empty())
+		return "{" + labels + "}";
+	else
+		return "{" + labels + "," + extra_label + "}";
+}
+
+
+void MetricsRegistry::writePrometheusText(std::string& s) const
+{
+	Lock lock(mutex);
+
+	MetricsHistogram::Snapshot snapshot;
+
+	for(auto it = families.begin(); it != families.end(); ++it)
+	{
+		const std::string& name = it->first;
+		const Family& family = it->second;
+
+		s += "# HELP " + name + " " + family.help + "\n";
+
+		if(family.type == MetricType_Counter)
+		{
+			s += "# TYPE " + name + " counter\n";
+			for(auto z = family.counters.begin(); z != family.counters.end(); ++z)
+				s += name + labelsString(z->first) + " " + toString(z->second->getValue()) + "\n";
+		}
+		else if(family.type == MetricType_Gauge)
+		{
+			s += "# TYPE " + name + " gauge\n";
+			for(auto z = family.gauges.begin(); z != family.gauges.end(); ++z)
+				s += name + labelsString(z->first) + " " + toString(z->second->getValue()) + "\n";
+		}
+		else
+		{
+			s += "# TYPE " + name + " histogram\n";
+			for(auto z = family.histograms.begin(); z != family.histograms.end(); ++z)
+			{
+				z->second->getSnapshot(snapshot);
+
+				// Write cumulative bucket counts for power-of-two bucket boundaries from ~1 us to ~69 s.
+				// Power-of-two boundaries coincide with histogram bucket boundaries, so each count is the exact number of values below the boundary.
+				uint64 cumulative = 0;
+				int next_bucket = 0;
+				for(int e=10; e<=36; ++e)
+				{
+					const uint64 upper_bound_ns = (uint64)1 << e;
+					const int upper_bucket = MetricsHistogram::getBucketIndex(upper_bound_ns); // First bucket that has values >= upper_bound_ns.
+					for(; next_bucket < upper_bucket; ++next_bucket)
+						cumulative += snapshot.bucket_counts[next_bucket];
+
+					s += name + "_bucket" + labelsString(z->first, "le=\"" + formatDouble((double)upper_bound_ns * 1.0e-9) + "\"") + " " + toString(cumulative) + "\n";
+				}
+				s += name + "_bucket" + labelsString(z->first, "le=\"+Inf\"") + " " + toString(snapshot.count) + "\n";
+				s += name + "_sum" + labelsString(z->first) + " " + formatDouble((double)snapshot.sum * 1.0e-9) + "\n";
+				s += name + "_count" + labelsString(z->first) + " " + toString(snapshot.count) + "\n";
+			}
+		}
+	}
+}
+
+
+#if BUILD_TESTS
+
+
+#include <TestUtils.h>
+#include <thread>
+
+
+void MetricsRegistry::test()
+{
+	conPrint("MetricsRegistry::test()");
+
+	//-------------------- Test histogram bucketing --------------------
+	for(uint64 v=0; v<100000; ++v)
+	{
+		const int bucket = MetricsHistogram::getBucketIndex(v);
+		testAssert(bucket >= 0 && bucket < MetricsHistogram::NUM_BUCKETS);
+		testAssert(MetricsHistogram::getBucketLowerBound(bucket) <= v);
+		testAssert(v < MetricsHistogram::getBucketLowerBound(bucket + 1));
+	}
+	for(int e=0; e<64; ++e)
+	{
+		const uint64 v = (uint64)1 << e;
+		testAssert(MetricsHistogram::getBucketLowerBound(MetricsHistogram::getBucketIndex(v)) == v);
+		testAssert(MetricsHistogram::getBucketIndex(v - 1) < MetricsHistogram::getBucketIndex(v) || v == 1);
+	}
+	testAssert(MetricsHistogram::getBucketIndex(std::numeric_limits<uint64>::max()) == MetricsHistogram::NUM_BUCKETS - 1);
+
+	//-------------------- Test histogram quantiles --------------------
+	{
+		MetricsHistogram histogram;
+		for(uint64 i=1; i<=1000; ++i)
+			histogram.record(i * 1000); // 1 us to 1 ms
+
+		MetricsHistogram::Snapshot snapshot;
+		histogram.getSnapshot(snapshot);
+		testAssert(snapshot.count == 1000);
+		testAssert(snapshot.sum == 500500 * 1000);
+
+		// Quantiles should be accurate to within the bucket relative width.
+		const uint64 median = snapshot.getQuantile(0.5);
+		testAssert(median <= 500000 && median >= 500000 * 3 / 4);
+		const uint64 p99 = snapshot.getQuantile(0.99);
+		testAssert(p99 <= 990000 && p99 >= 990000 * 3 / 4);
+	}
+
+	//-------------------- Test counter and histogram updated from multiple threads --------------------
+	{
+		MetricsRegistry registry;
+		MetricsCounter* counter = registry.getOrCreateCounter("test_total", "Test counter");
+		MetricsHistogram* histogram = registry.getOrCreateHistogram("test_seconds", "Test histogram");
+
+		std::vector<std::thread> threads;
+		for(int i=0; i<4; ++i)
+			threads.push_back(std::thread([counter, histogram]()
+				{
+					for(int z=0; z<100000; ++z)
+					{
+						counter->increment();
+						histogram->record(1000);
+					}
+				}));
+		for(size_t i=0; i<threads.size(); ++i)
+			threads[i].join();
+
+		testAssert(counter->getValue() == 400000);
+
+		MetricsHistogram::Snapshot snapshot;
+		histogram->getSnapshot(snapshot);
+		testAssert(snapshot.count == 400000);
+		testAssert(snapshot.sum == (uint64)400000 * 1000);
+	}
+
+	//-------------------- Test registry lookup and Prometheus output --------------------
+	{
+		MetricsRegistry registry;
+		MetricsCounter* a = registry.getOrCreateCounter("messages_total", "Messages", "type=\"1\"");
+		MetricsCounter* b = registry.getOrCreateCounter("messages_total", "Messages", "type=\"2\"");
+		testAssert(a != b);
+		testAssert(registry.getOrCreateCounter("messages_total", "Messages", "type=\"1\"") == a);
+
+		a->add(3);
+		b->increment();
+
+		MetricsGauge* gauge = registry.getOrCreateGauge("queue_length", "Queue length");
+		gauge->set(10);
+		gauge->add(-3);
+		testAssert(gauge->getValue() == 7);
+
+		MetricsHistogram* histogram = registry.getOrCreateHistogram("handler_seconds", "Handler time");
+		histogram->recordSeconds(0.5e-6); // Below first bucket boundary
+		histogram->recordSeconds(1.0e-3);
+		histogram->recordSeconds(1000.0); // Above last bucket boundary
+
+		try
+		{
+			registry.getOrCreateGauge("messages_total", "Messages");
+			failTest("Expected exception");
+		}
+		catch(glare::Exception&)
+		{}
+
+		std::string s;
+		registry.writePrometheusText(s);
+		// conPrint(s);
+
+		testAssert(StringUtils::containsString(s, "# TYPE messages_total counter\n"));
+		testAssert(StringUtils::containsString(s, "messages_total{type=\"1\"} 3\n"));
+		testAssert(StringUtils::containsString(s, "messages_total{type=\"2\"} 1\n"));
+		testAssert(StringUtils::containsString(s, "# TYPE queue_length gauge\n"));
+		testAssert(StringUtils::containsString(s, "queue_length 7\n"));
+		testAssert(StringUtils::containsString(s, "# TYPE handler_seconds histogram\n"));
+		testAssert(StringUtils::containsString(s, "handler_seconds_bucket{le=\"1.024e-06\"} 1\n"));
+		testAssert(StringUtils::containsString(s, "handler_seconds_bucket{le=\"0.001048576\"} 2\n"));
+		testAssert(StringUtils::containsString(s, "handler_seconds_bucket{le=\"+Inf\"} 3\n"));
+		testAssert(StringUtils::containsString(s, "handler_seconds_count 3\n"));
+	}
+
+	conPrint("MetricsRegistry::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,180 @@
+/*=====================================================================
+MetricsRegistry.h
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <ThreadSafeRefCounted.h>
+#include <Reference.h>
+#include <Mutex.h>
+#include <Platform.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <map>
+
+
+namespace Metrics
+{
+	// Metric values are accumulated in a number of shards, with each thread using a single shard, to reduce contention between threads updating the same metric.
+	// The shards are summed when the value is read.
+	static const int NUM_SHARDS = 8;
+
+	int getCurThreadShardIndex();
+}
+
+
+/*=====================================================================
+MetricsCounter
+--------------
+Monotonically increasing count.  Lock-free.
+=====================================================================*/
+class MetricsCounter : public ThreadSafeRefCounted
+{
+public:
+	MetricsCounter();
+
+	void add(uint64 x) { shards[Metrics::getCurThreadShardIndex()].value.fetch_add(x, std::memory_order_relaxed); }
+	void increment() { add(1); }
+
+	uint64 getValue() const;
+
+private:
+	struct Shard
+	{
+		std::atomic<uint64> value;
+		uint8 padding[64 - sizeof(std::atomic<uint64>)]; // Keep shards on separate cache lines.
+	};
+	Shard shards[Metrics::NUM_SHARDS];
+};
+
+
+/*=====================================================================
+MetricsGauge
+------------
+A value that can go up and down, such as a queue length.  Lock-free.
+=====================================================================*/
+class MetricsGauge : public ThreadSafeRefCounted
+{
+public:
+	MetricsGauge() : value(0) {}
+
+	void set(int64 x) { value.store(x, std::memory_order_relaxed); }
+	void add(int64 x) { value.fetch_add(x, std::memory_order_relaxed); }
+
+	int64 getValue() const { return value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<int64> value;
+};
+
+
+/*=====================================================================
+MetricsHistogram
+----------------
+Latency histogram with HDR-style log-linear buckets: each power of two is
+split into NUM_SUB_BUCKETS linear sub-buckets, so the relative error of a
+recorded value is at most 1 / NUM_SUB_BUCKETS, over the entire uint64 range.
+
+Values are recorded in nanoseconds.  Lock-free.
+=====================================================================*/
+class MetricsHistogram : public ThreadSafeRefCounted
+{
+public:
+	static const int SUB_BUCKET_BITS = 2;
+	static const int NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+	static const int NUM_BUCKETS = NUM_SUB_BUCKETS + (64 - SUB_BUCKET_BITS) * NUM_SUB_BUCKETS;
+
+	MetricsHistogram();
+
+	void record(uint64 value_ns)
+	{
+		Shard& shard = shards[Metrics::getCurThreadShardIndex()];
+		shard.count.fetch_add(1, std::memory_order_relaxed);
+		shard.sum.fetch_add(value_ns, std::memory_order_relaxed);
+		shard.buckets[getBucketIndex(value_ns)].fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void recordSeconds(double t)
+	{
+		record((t <= 0) ? 0 : ((t >= 1.0e9) ? (uint64)1.0e18 : (uint64)(t * 1.0e9)));
+	}
+
+	static int getBucketIndex(uint64 value);
+	static uint64 getBucketLowerBound(int bucket_index);
+
+	struct Snapshot
+	{
+		uint64 count;
+		uint64 sum; // Sum of recorded values.
+		std::vector<uint64> bucket_counts;
+
+		uint64 getQuantile(double q) const; // Returns the lower bound of the bucket containing the q-quantile value.
+	};
+
+	void getSnapshot(Snapshot& snapshot_out) const;
+
+private:
+	struct Shard
+	{
+		std::atomic<uint64> count;
+		std::atomic<uint64> sum;
+		std::atomic<uint64> buckets[NUM_BUCKETS];
+	};
+	Shard shards[Metrics::NUM_SHARDS];
+};
+
+
+/*=====================================================================
+MetricsRegistry
+---------------
+A named set of counters, gauges and histograms, that can be written out in
+the Prometheus text exposition format.
+
+Metrics are identified by a family name, and an optional label string
+(e.g. 'type="12"'), so a family can contain a metric per label value.
+The returned metric pointers remain valid for the lifetime of the registry,
+so callers should look a metric up once and keep the pointer, rather than
+looking it up on every update.
+
+Histograms are written with time units of seconds.
+=====================================================================*/
+class MetricsRegistry
+{
+public:
+	MetricsRegistry();
+	~MetricsRegistry();
+
+	// Throws glare::Exception if a metric with the same name, but a different type, already exists.
+	MetricsCounter*   getOrCreateCounter  (const std::string& name, const std::string& help, const std::string& labels = std::string());
+	MetricsGauge*     getOrCreateGauge    (const std::string& name, const std::string& help, const std::string& labels = std::string());
+	MetricsHistogram* getOrCreateHistogram(const std::string& name, const std::string& help, const std::string& labels = std::string());
+
+	void writePrometheusText(std::string& s) const;
+
+	static void test();
+
+private:
+	enum MetricType
+	{
+		MetricType_Counter,
+		MetricType_Gauge,
+		MetricType_Histogram
+	};
+
+	struct Family
+	{
+		MetricType type;
+		std::string help;
+		std::map<std::string, Reference<MetricsCounter>> counters; // Map from label string to metric
+		std::map<std::string, Reference<MetricsGauge>> gauges;
+		std::map<std::string, Reference<MetricsHistogram>> histograms;
+	};
+
+	Family& getOrCreateFamily(const std::string& name, const std::string& help, MetricType type) REQUIRES(mutex);
+
+	mutable Mutex mutex;
+	std::map<std::string, Family> families		GUARDED_BY(mutex);
+};
@@ -0,0 +1,296 @@
+/*=====================================================================
+ObjectAccountingIndex.cpp
+-------------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ObjectAccountingIndex.h"
+
+
+#include <ConPrint.h>
+
+
+ObjectAccountingIndex::ObjectAccountingIndex()
+{}
+
+
+const Parcel* ObjectAccountingIndex::findParcelContainingPoint(const ParcelMapType& parcels, const Vec3d& pos)
+{
+	for(auto it = parcels.begin(); it != parcels.end(); ++it)
+		if(it->second->pointInParcel(pos))
+			return it->second.ptr();
+	return NULL;
+}
+
+
+void ObjectAccountingIndex::removeEntryUsage(const UID& uid, const ObjectAccountingEntry& entry)
+{
+	if(entry.parcel_id.valid())
+	{
+		auto res = parcel_objects.find(entry.parcel_id);
+		if(res != parcel_objects.end())
+		{
+			res->second.erase(uid);
+			if(res->second.empty())
+				parcel_objects.erase(res);
+		}
+	}
+
+	auto res = owner_usage.find(entry.owner_id);
+	if(res != owner_usage.end())
+	{
+		OwnerUsage& usage = res->second;
+		usage.num_objects--;
+		usage.num_triangles -= entry.num_triangles;
+		usage.resource_bytes -= entry.resource_bytes;
+		if(usage.num_objects == 0)
+			owner_usage.erase(res);
+	}
+}
+
+
+void ObjectAccountingIndex::updateObject(const WorldObject& ob, const ParcelMapType& parcels, const ObjectModelStatsMap& model_stats)
+{
+	if(ob.state == WorldObject::State_Dead)
+	{
+		removeObject(ob.uid);
+		return;
+	}
+
+	auto existing = entries.find(ob.uid);
+
+	// Work out which parcel the object is in.  Objects usually stay in the same parcel when they move, so check the current parcel first before searching all parcels.
+	ParcelID parcel_id = ParcelID::invalidParcelID();
+	bool found_parcel = false;
+	if(existing != entries.end() && existing->second.parcel_id.valid())
+	{
+		auto res = parcels.find(existing->second.parcel_id);
+		if(res != parcels.end() && res->second->pointInParcel(ob.pos))
+		{
+			parcel_id = existing->second.parcel_id;
+			found_parcel = true;
+		}
+	}
+	if(!found_parcel)
+	{
+		const Parcel* parcel = findParcelContainingPoint(parcels, ob.pos);
+		if(parcel)
+			parcel_id = parcel->id;
+	}
+
+	ObjectAccountingEntry entry;
+	entry.parcel_id = parcel_id;
+	entry.owner_id = ob.creator_id;
+	entry.num_triangles = 0;
+	entry.resource_bytes = 0;
+	if(!ob.model_url.empty())
+	{
+		auto res = model_stats.find(ob.model_url);
+		if(res != model_stats.end())
+		{
+			entry.num_triangles = res->second.num_triangles;
+			entry.resource_bytes = res->second.file_size_B;
+		}
+	}
+
+	if(existing != entries.end())
+	{
+		const ObjectAccountingEntry& old_entry = existing->second;
+		if(old_entry.parcel_id == entry.parcel_id && old_entry.owner_id == entry.owner_id && old_entry.num_triangles == entry.num_triangles && old_entry.resource_bytes == entry.resource_bytes)
+			return; // Nothing changed.
+
+		removeEntryUsage(ob.uid, old_entry);
+		existing->second = entry;
+	}
+	else
+		entries.insert(std::make_pair(ob.uid, entry));
+
+	if(entry.parcel_id.valid())
+		parcel_objects[entry.parcel_id].insert(ob.uid);
+
+	OwnerUsage& usage = owner_usage[entry.owner_id];
+	usage.num_objects++;
+	usage.num_triangles += entry.num_triangles;
+	usage.resource_bytes += entry.resource_bytes;
+}
+
+
+void ObjectAccountingIndex::removeObject(const UID& uid)
+{
+	auto res = entries.find(uid);
+	if(res == entries.end())
+		return;
+
+	removeEntryUsage(uid, res->second);
+	entries.erase(res);
+}
+
+
+void ObjectAccountingIndex::build(const ObjectMapType& objects, const ParcelMapType& parcels, const ObjectModelStatsMap& model_stats)
+{
+	clear();
+
+	for(auto it = objects.begin(); it != objects.end(); ++it)
+		updateObject(*it->second, parcels, model_stats);
+}
+
+
+void ObjectAccountingIndex::clear()
+{
+	entries.clear();
+	parcel_objects.clear();
+	owner_usage.clear();
+}
+
+
+size_t ObjectAccountingIndex::getNumObjectsInParcel(const ParcelID& parcel_id) const
+{
+	auto res = parcel_objects.find(parcel_id);
+	return (res != parcel_objects.end()) ? res->second.size() : 0;
+}
+
+
+const std::set<UID>* ObjectAccountingIndex::getObjectsInParcel(const ParcelID& parcel_id) const
+{
+	auto res = parcel_objects.find(parcel_id);
+	return (res != parcel_objects.end()) ? &res->second : NULL;
+}
+
+
+ObjectAccountingIndex::OwnerUsage ObjectAccountingIndex::getOwnerUsage(const UserID& owner_id) const
+{
+	auto res = owner_usage.find(owner_id);
+	return (res != owner_usage.end()) ? res->second : OwnerUsage();
+}
+
+
+#if BUILD_TESTS
+
+
+#include <TestUtils.h>
+
+
+static ParcelRef makeTestParcel(uint32 id, const Vec2d& botleft, double width)
+{
+	ParcelRef parcel = new Parcel();
+	parcel->id = ParcelID(id);
+	parcel->zbounds = Vec2d(-1, 10);
+	parcel->verts[0] = botleft;
+	parcel->verts[1] = botleft + Vec2d(width, 0);
+	parcel->verts[2] = botleft + Vec2d(width, width);
+	parcel->verts[3] = botleft + Vec2d(0, width);
+	parcel->build();
+	return parcel;
+}
+
+
+static WorldObjectRef makeTestObject(uint64 uid, const Vec3d& pos, const UserID& creator_id, const URLString& model_url)
+{
+	WorldObjectRef ob = new WorldObject();
+	ob->uid = UID(uid);
+	ob->pos = pos;
+	ob->creator_id = creator_id;
+	ob->model_url = model_url;
+	ob->state = WorldObject::State_Alive;
+	return ob;
+}
+
+
+void ObjectAccountingIndex::test()
+{
+	conPrint("ObjectAccountingIndex::test()");
+
+	ParcelMapType parcels;
+	parcels[ParcelID(1)] = makeTestParcel(1, Vec2d(0, 0), 10);
+	parcels[ParcelID(2)] = makeTestParcel(2, Vec2d(20, 0), 10);
+
+	ObjectModelStatsMap model_stats;
+	const URLString model_a = toURLString("model_a.bmesh");
+	const URLString model_b = toURLString("model_b.bmesh");
+	model_stats[model_a] = ObjectModelStats({/*num_triangles=*/100, /*file_size_B=*/1000});
+	model_stats[model_b] = ObjectModelStats({/*num_triangles=*/5, /*file_size_B=*/50});
+
+	const UserID user_1(1);
+	const UserID user_2(2);
+
+	ObjectAccountingIndex index;
+
+	//-------------------- Test adding objects --------------------
+	WorldObjectRef ob_1 = makeTestObject(1, Vec3d(1, 1, 1), user_1, model_a);
+	WorldObjectRef ob_2 = makeTestObject(2, Vec3d(2, 2, 1), user_1, model_b);
+	WorldObjectRef ob_3 = makeTestObject(3, Vec3d(100, 100, 1), user_2, toURLString("unknown_model.bmesh")); // Not in a parcel, model stats not known.
+	index.updateObject(*ob_1, parcels, model_stats);
+	index.updateObject(*ob_2, parcels, model_stats);
+	index.updateObject(*ob_3, parcels, model_stats);
+
+	testAssert(index.getNumObjects() == 3);
+	testAssert(index.getNumObjectsInParcel(ParcelID(1)) == 2);
+	testAssert(index.getNumObjectsInParcel(ParcelID(2)) == 0);
+	testAssert(index.getObjectsInParcel(ParcelID(2)) == NULL);
+	testAssert(index.getObjectsInParcel(ParcelID(1))->count(UID(1)) == 1);
+	testAssert(index.getOwnerUsage(user_1).num_objects == 2);
+	testAssert(index.getOwnerUsage(user_1).num_triangles == 105);
+	testAssert(index.getOwnerUsage(user_1).resource_bytes == 1050);
+	testAssert(index.getOwnerUsage(user_2).num_objects == 1);
+	testAssert(index.getOwnerUsage(user_2).num_triangles == 0);
+
+	// Updating an unchanged object shouldn't change anything.
+	index.updateObject(*ob_1, parcels, model_stats);
+	testAssert(index.getNumObjects() == 3);
+	testAssert(index.getNumObjectsInParcel(ParcelID(1)) == 2);
+	testAssert(index.getOwnerUsage(user_1).num_objects == 2);
+
+	//-------------------- Test moving an object to another parcel --------------------
+	ob_1->pos = Vec3d(25, 5, 1);
+	index.updateObject(*ob_1, parcels, model_stats);
+	testAssert(index.getNumObjectsInParcel(ParcelID(1)) == 1);
+	testAssert(index.getNumObjectsInParcel(ParcelID(2)) == 1);
+	testAssert(index.getOwnerUsage(user_1).num_objects == 2);
+	testAssert(index.getOwnerUsage(user_1).num_triangles == 105);
+
+	// Move out of all parcels
+	ob_1->pos = Vec3d(-50, 5, 1);
+	index.updateObject(*ob_1, parcels, model_stats);
+	testAssert(index.getNumObjectsInParcel(ParcelID(2)) == 0);
+
+	//-------------------- Test changing model --------------------
+	ob_1->model_url = model_b;
+	index.updateObject(*ob_1, parcels, model_stats);
+	testAssert(index.getOwnerUsage(user_1).num_triangles == 10);
+	testAssert(index.getOwnerUsage(user_1).resource_bytes == 100);
+
+	//-------------------- Test removing objects --------------------
+	ob_2->state = WorldObject::State_Dead;
+	index.updateObject(*ob_2, parcels, model_stats);
+	testAssert(index.getNumObjects() == 2);
+	testAssert(index.getNumObjectsInParcel(ParcelID(1)) == 0);
+	testAssert(index.getOwnerUsage(user_1).num_objects == 1);
+	testAssert(index.getOwnerUsage(user_1).num_triangles == 5);
+
+	index.removeObject(ob_3->uid);
+	index.removeObject(ob_3->uid); // Removing twice should be harmless.
+	testAssert(index.getNumObjects() == 1);
+	testAssert(index.getOwnerUsage(user_2).num_objects == 0);
+
+	//-------------------- Test build --------------------
+	{
+		ObjectMapType objects;
+		for(uint64 i=0; i<100; ++i)
+		{
+			WorldObjectRef ob = makeTestObject(100 + i, Vec3d((i % 2 == 0) ? 5.0 : 25.0, 5, 1), (i < 30) ? user_1 : user_2, model_a);
+			objects[ob->uid] = ob;
+		}
+
+		index.build(objects, parcels, model_stats);
+		testAssert(index.getNumObjects() == 100);
+		testAssert(index.getNumObjectsInParcel(ParcelID(1)) == 50);
+		testAssert(index.getNumObjectsInParcel(ParcelID(2)) == 50);
+		testAssert(index.getOwnerUsage(user_1).num_objects == 30);
+		testAssert(index.getOwnerUsage(user_2).num_objects == 70);
+		testAssert(index.getOwnerUsage(user_2).num_triangles == 7000);
+	}
+
+	conPrint("ObjectAccountingIndex::test() done.");
+}
+
+
+#endif // BUILD_TESTS
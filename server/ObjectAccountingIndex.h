@@ -0,0 +1,95 @@
+/*=====================================================================
+ObjectAccountingIndex.h
+-----------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "../shared/WorldObject.h"
+#include "../shared/Parcel.h"
+#include "../shared/ParcelID.h"
+#include "../shared/UserID.h"
+#include "../shared/UID.h"
+#include "../shared/URLString.h"
+#include <map>
+#include <set>
+#include <unordered_map>
+
+
+// Stats for a model file, used for per-owner usage accounting.  Cached per model URL in ServerAllWorldsState::model_URL_to_stats,
+// filled in when the server loads the model.
+struct ObjectModelStats
+{
+	uint64 num_triangles;
+	uint64 file_size_B;
+};
+
+typedef std::map<URLString, ObjectModelStats> ObjectModelStatsMap;
+
+
+struct ObjectAccountingEntry
+{
+	ParcelID parcel_id; // Invalid if the object isn't in a parcel.
+	UserID owner_id;
+	uint64 num_triangles;
+	uint64 resource_bytes;
+};
+
+
+/*=====================================================================
+ObjectAccountingIndex
+---------------------
+The set of objects in each parcel, and per-owner usage totals (object
+count, triangle count and model resource bytes), for a single world.
+
+Kept up to date incrementally with updateObject() and removeObject() as
+objects are created, moved, changed and deleted, so that limit checks
+don't need to scan every object in the world.
+
+An object is accounted to the first parcel containing its position, and
+to its creator.  Triangle and byte counts come from the model stats cache,
+so are zero for objects whose model the server hasn't loaded yet.
+=====================================================================*/
+class ObjectAccountingIndex
+{
+public:
+	struct OwnerUsage
+	{
+		OwnerUsage() : num_objects(0), num_triangles(0), resource_bytes(0) {}
+
+		size_t num_objects;
+		uint64 num_triangles;
+		uint64 resource_bytes;
+	};
+
+	typedef std::map<ParcelID, ParcelRef> ParcelMapType;
+	typedef std::map<UID, WorldObjectRef> ObjectMapType;
+
+	ObjectAccountingIndex();
+
+	// Adds the object to the index, or updates its entry if it is already in the index (e.g. the object has moved, or its model has changed).
+	// Dead objects are removed.
+	void updateObject(const WorldObject& ob, const ParcelMapType& parcels, const ObjectModelStatsMap& model_stats);
+	void removeObject(const UID& uid);
+
+	void build(const ObjectMapType& objects, const ParcelMapType& parcels, const ObjectModelStatsMap& model_stats);
+	void clear();
+
+	size_t getNumObjects() const { return entries.size(); }
+	size_t getNumObjectsInParcel(const ParcelID& parcel_id) const;
+	const std::set<UID>* getObjectsInParcel(const ParcelID& parcel_id) const; // Returns NULL if there are no objects in the parcel.
+	OwnerUsage getOwnerUsage(const UserID& owner_id) const;
+
+	// Returns the first parcel containing the point, or NULL if none do.
+	static const Parcel* findParcelContainingPoint(const ParcelMapType& parcels, const Vec3d& pos);
+
+	static void test();
+
+private:
+	void removeEntryUsage(const UID& uid, const ObjectAccountingEntry& entry);
+
+	std::unordered_map<UID, ObjectAccountingEntry, UIDHasher> entries;
+	std::map<ParcelID, std::set<UID>> parcel_objects;
+	std::map<UserID, OwnerUsage> owner_usage;
+};
@@ -0,0 +1,123 @@
+/*=====================================================================
+PhotoProcessingService.cpp
+--------------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "PhotoProcessingService.h"
+
+
+#include "WorkerThreadUploadPhotoHandling.h"
+#include <ConPrint.h>
+#include <Exception.h>
+#include <FileUtils.h>
+#include <Lock.h>
+#include <Timer.h>
+
+
+PhotoProcessingJob::PhotoProcessingJob()
+:	service(NULL)
+{}
+
+
+PhotoProcessingJob::~PhotoProcessingJob()
+{}
+
+
+void PhotoProcessingJob::run(size_t thread_index)
+{
+	PhotoProcessingResultRef result = new PhotoProcessingResult();
+	result->succeeded = false;
+
+	try
+	{
+		Timer timer;
+
+		// Make other photo sizes
+		try
+		{
+			WorkerThreadUploadPhotoHandling::saveMidSizeAndThumbnailImages(/*src_full_res_screenshot_filename=*/photo_filename, random_path_hex_str, photo_dir, image_data, 
+				/*midsize_filename_out=*/result->midsize_filename, /*thumbnail_filename_out=*/result->thumbnail_filename);
+		}
+		catch(glare::Exception& e)
+		{
+			conPrint("PhotoProcessingJob: glare::Exception while making thumbnail for photo: " + e.what());
+			throw glare::Exception("Server error: failed to make thumbnail for photo.");
+		}
+
+		try
+		{
+			// Save original/full resolution photo to disk.  Do this after making other photo sizes, which will check it's a valid JPEG file.
+			FileUtils::writeEntireFile(photo_dir + "/" + photo_filename, image_data);
+		}
+		catch(glare::Exception& e)
+		{
+			conPrint("PhotoProcessingJob: glare::Exception while saving photo to disk: " + e.what());
+			throw glare::Exception("Server error: failed to save photo.");
+		}
+
+		conPrint("PhotoProcessingJob: processed photo '" + photo_filename + "' in " + timer.elapsedStringNSigFigs(4));
+
+		result->succeeded = true;
+	}
+	catch(glare::Exception& e)
+	{
+		result->error_msg_for_user = e.what();
+	}
+	catch(std::exception& e) // Catch std::bad_alloc etc.
+	{
+		conPrint(std::string("PhotoProcessingJob: Caught std::exception: ") + e.what());
+		result->error_msg_for_user = "Server error: failed to process photo.";
+	}
+
+	// Free image data now, as the job may be kept alive for a while by the uploading thread.
+	image_data.clear();
+	image_data.shrink_to_fit();
+
+	if(service)
+		service->jobDone();
+
+	result_queue.enqueue(result);
+}
+
+
+PhotoProcessingService::PhotoProcessingService(size_t num_threads, size_t max_num_pending_jobs_)
+:	task_manager("PhotoProcessingService task manager", num_threads),
+	num_pending_jobs(0),
+	max_num_pending_jobs(max_num_pending_jobs_)
+{}
+
+
+PhotoProcessingService::~PhotoProcessingService()
+{
+	task_manager.waitForTasksToComplete();
+}
+
+
+bool PhotoProcessingService::trySubmitJob(Reference<PhotoProcessingJob> job)
+{
+	{
+		Lock lock(mutex);
+		if(num_pending_jobs >= max_num_pending_jobs)
+			return false;
+		num_pending_jobs++;
+	}
+
+	job->service = this;
+	task_manager.addTask(job);
+	return true;
+}
+
+
+size_t PhotoProcessingService::getNumPendingJobs() const
+{
+	Lock lock(mutex);
+	return num_pending_jobs;
+}
+
+
+void PhotoProcessingService::jobDone()
+{
+	Lock lock(mutex);
+	assert(num_pending_jobs > 0);
+	num_pending_jobs--;
+}
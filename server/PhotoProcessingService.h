@@ -0,0 +1,89 @@
+/*=====================================================================
+PhotoProcessingService.h
+------------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <Task.h>
+#include <TaskManager.h>
+#include <ThreadSafeQueue.h>
+#include <ThreadSafeRefCounted.h>
+#include <Mutex.h>
+#include <ThreadSafetyAnalysis.h>
+#include <Platform.h>
+#include <string>
+#include <vector>
+class PhotoProcessingService;
+
+
+class PhotoProcessingResult : public ThreadSafeRefCounted
+{
+public:
+	bool succeeded;
+	std::string error_msg_for_user; // Set if !succeeded
+	std::string midsize_filename;
+	std::string thumbnail_filename;
+};
+typedef Reference<PhotoProcessingResult> PhotoProcessingResultRef;
+
+
+/*=====================================================================
+PhotoProcessingJob
+------------------
+Decodes an uploaded photo, makes the midsize and thumbnail images, and
+saves them and the original photo to disk.
+The result is pushed to result_queue when done.
+=====================================================================*/
+class PhotoProcessingJob : public glare::Task
+{
+public:
+	PhotoProcessingJob();
+	virtual ~PhotoProcessingJob();
+
+	virtual void run(size_t thread_index) override;
+
+	std::vector<uint8> image_data; // Uploaded JPEG data
+	std::string photo_filename; // Filename for the full resolution photo, e.g. "photo_abcd.jpg"
+	std::string random_path_hex_str;
+	std::string photo_dir;
+
+	PhotoProcessingService* service; // jobDone() is called on this when the job is done.
+
+	ThreadSafeQueue<PhotoProcessingResultRef> result_queue;
+};
+
+
+/*=====================================================================
+PhotoProcessingService
+----------------------
+Runs photo processing jobs on a task manager shared by all photo upload
+connections, with a bounded number of pending jobs, so that bursts of photo
+uploads don't oversubscribe the CPU.
+
+The server has no general-purpose task manager to share: the existing ones are
+owned by ChunkGenThread, MeshLODGenThread and the voice mixer, and run long
+batch jobs (or latency-sensitive mixing).  Photo jobs queued behind LOD chunk
+or mesh LOD generation could wait for minutes, so this service has its own
+small pool, like those threads do.
+=====================================================================*/
+class PhotoProcessingService : public ThreadSafeRefCounted
+{
+public:
+	PhotoProcessingService(size_t num_threads, size_t max_num_pending_jobs);
+	~PhotoProcessingService();
+
+	// Returns false if there are already too many pending jobs, in which case the job is not submitted.  Threadsafe.
+	bool trySubmitJob(Reference<PhotoProcessingJob> job);
+
+	size_t getNumPendingJobs() const; // Threadsafe
+
+	void jobDone(); // Called by PhotoProcessingJob.  Threadsafe.
+
+private:
+	glare::TaskManager task_manager;
+	mutable Mutex mutex;
+	size_t num_pending_jobs		GUARDED_BY(mutex);
+	size_t max_num_pending_jobs;
+};
@@ -12,10 +12,13 @@ Copyright Glare Technologies Limited 2023 -
 #include "MeshLODGenThread.h"
 #include "DynamicTextureUpdaterThread.h"
 #include "ChunkGenThread.h"
+#include "ServerMetrics.h"
+#include "ServerProfiler.h"
 #include "WorkerThread.h"
 #include "ServerTestSuite.h"
 #include "WorldCreation.h"
 #include "LuaHTTPRequestManager.h"
+#include "PhotoProcessingService.h"
 #include "WorldMaintenance.h"
 #include "../shared/Protocol.h"
 #include "../shared/Version.h"
@@ -23,6 +26,7 @@ Copyright Glare Technologies Limited 2023 -
 #include "../shared/SubstrataLuaVM.h"
 #include "../shared/ObjectEventHandlers.h"
 #include "../shared/WorldStateLock.h"
+#include "../shared/JoltShapeBuilding.h"
 #include "../webserver/WebServerRequestHandler.h"
 #include "../webserver/AccountHandlers.h"
 #include "../webserver/WebDataStore.h"
@@ -171,6 +175,7 @@ static ServerConfig parseServerConfig(const std::string& config_path)
 	config.enable_registration					= XMLParseUtils::parseBoolWithDefault(root_elem, "enable_registration", /*default val=*/true);
 	config.enable_mcp_server					= XMLParseUtils::parseBoolWithDefault(root_elem, "enable_mcp_server", /*default val=*/true);
 	config.do_mcp_rate_limiting					= XMLParseUtils::parseBoolWithDefault(root_elem, "do_mcp_rate_limiting", /*default val=*/true);
+	config.max_num_timers_per_script			= XMLParseUtils::parseIntWithDefault(root_elem, "max_num_timers_per_script", /*default val=*/LuaScriptEvaluator::DEFAULT_MAX_NUM_TIMERS);
 	config.AI_model_id							= XMLParseUtils::parseStringWithDefault(root_elem, "AI_model_id", /*default val=*/"xai/grok-4.5");
 	config.shared_LLM_prompt_part				= XMLParseUtils::parseStringWithDefault(root_elem, "shared_LLM_prompt_part", /*default val=*/
 		std::string("You are a helpful bot in the Substrata Metaverse.\n") + 
@@ -210,6 +215,7 @@ int main(int argc, char *argv[])
 	PlatformUtils::ignoreUnixSignals();
 	TLSSocket::initTLS();
 	BasisDecoder::init();
+	JoltShapeBuilding::initJolt();
 
 	// Listen for SIGTERM and SIGINT on Linux and Mac.
 	// Upon receiving SIGTERM or SIGINT, save dirty data to database, then try and shut down gracefully.
@@ -358,6 +364,8 @@ int main(int argc, char *argv[])
 #endif
 		FileUtils::createDirIfDoesNotExist(server.photo_dir);
 
+		ServerProfiler::get().setTraceDir(server_state_dir + "/traces"); // Dir trace captures will be written to.
+
 		std::string server_state_path;
 		if(parsed_args.isArgPresent("--db_path"))
 			server_state_path = parsed_args.getArgStringValue("--db_path");
@@ -535,6 +543,8 @@ int main(int argc, char *argv[])
 
 		server.lua_http_manager = new LuaHTTPRequestManager(&server);
 
+		server.photo_processing_service = new PhotoProcessingService(/*num threads=*/myMax<size_t>(1, PlatformUtils::getNumLogicalProcessors() / 4), /*max num pending jobs=*/64);
+
 		//----------------------------------------------- Create any Lua scripts for objects -----------------------------------------------
 		if(isFeatureFlagSet(server.world_state, ServerAllWorldsState::SERVER_SCRIPT_EXEC_FEATURE_FLAG))
 		{ // Begin scope for world_state->mutex lock
@@ -621,12 +631,20 @@ int main(int argc, char *argv[])
 
 		js::Vector<ThreadMessageRef, 16> temp_thread_messages;
 
+		std::vector<VoiceAvatarPosition> temp_voice_avatar_positions;
+		bool published_voice_avatar_positions = false;
+
 		// Main server loop
 		uint64 loop_iter = 0;
 		while(!should_quit)
 		{
 			PlatformUtils::Sleep(100);
 
+			ServerProfiler::get().update(); // Write trace file if a trace capture has finished.
+
+			SERVER_PROFILE_ZONE("Main loop iteration");
+			Timer loop_iteration_timer;
+
 			// Do Lua timer callbacks
 			if(isFeatureFlagSet(server.world_state, ServerAllWorldsState::SERVER_SCRIPT_EXEC_FEATURE_FLAG))
 			{
@@ -644,16 +662,20 @@ int main(int argc, char *argv[])
 						if(script_evaluator)
 						{
 							// Check timer is still valid (has not been destroyed by destroyTimer), by checking the timer id with the same index is still equal to our timer id.
-							assert(timer.timer_index >= 0 && timer.timer_index <= LuaScriptEvaluator::MAX_NUM_TIMERS);
+							assert(timer.timer_index >= 0 && timer.timer_index < (int)script_evaluator->timers.size());
 							if(timer.timer_id == script_evaluator->timers[timer.timer_index].id)
 							{
 								script_evaluator->doOnTimerEvent(timer.onTimerEvent_ref, lock); // Execute the Lua timer event callback function
 
+								// The callback may have destroyed the timer (and possibly created a new timer in the same slot), so check the timer id again.
+								if(timer.timer_id != script_evaluator->timers[timer.timer_index].id)
+									continue;
+
 								if(timer.repeating)
 								{
 									// Re-insert timer with updated trigger time
 									timer.tigger_time = cur_time + timer.period;
-									server.timer_queue.addTimer(cur_time, timer);
+									script_evaluator->timers[timer.timer_index].queue_handle = server.timer_queue.addTimer(cur_time, timer);
 								}
 								else // Else if timer was a one-shot timer, 'destroy' it.
 								{
@@ -868,20 +890,35 @@ int main(int argc, char *argv[])
 			}
 
 			{ // Begin scope for world_state->mutex lock
+				SERVER_PROFILE_ZONE("Generate update packets");
 
 				WorldStateLock lock(server.world_state->mutex);
 
+				temp_voice_avatar_positions.clear();
+
 				for(auto world_it = server.world_state->world_states.begin(); world_it != server.world_state->world_states.end(); ++world_it)
 				{
 					ServerWorldState* world_state = world_it->second.ptr();
 
 					std::vector<uint8>& world_packets = broadcast_packets[world_state];
 
+					const bool server_voice_mixing = BitUtils::isBitSet(world_state->world_settings.flags, WorldSettings::SERVER_VOICE_MIXING_FLAG);
+
 					// Generate packets for avatar changes
 					const ServerWorldState::AvatarMapType& avatars = world_state->getAvatars(lock);
 					for(auto i = avatars.begin(); i != avatars.end();)
 					{
 						Avatar* avatar = i->second.ptr();
+
+						if(server_voice_mixing && avatar->state != Avatar::State_Dead)
+						{
+							VoiceAvatarPosition voice_pos;
+							voice_pos.avatar_id = (uint32)i->first.value();
+							voice_pos.world = world_state;
+							voice_pos.pos = avatar->pos;
+							temp_voice_avatar_positions.push_back(voice_pos);
+						}
+
 						if(avatar->other_dirty)
 						{
 							if(avatar->state == Avatar::State_Alive)
@@ -959,6 +996,8 @@ int main(int argc, char *argv[])
 					for(auto i = dirty_from_remote_objects.begin(); i != dirty_from_remote_objects.end(); ++i)
 					{
 						WorldObject* ob = i->ptr();
+						ob->invalidateNetworkSerialisationCache(); // The object has changed, so the cached serialisation is out of date.
+
 						if(ob->from_remote_other_dirty)
 						{
 							// conPrint("Object 'other' dirty, sending full update");
@@ -967,25 +1006,29 @@ int main(int argc, char *argv[])
 							{
 								// Send ObjectFullUpdate packet
 								MessageUtils::initPacket(scratch_packet, Protocol::ObjectFullUpdate);
-								ob->writeToNetworkStream(scratch_packet);
+								ob->writeToNetworkStreamCached(scratch_packet);
 
 								enqueueMessageToBroadcast(scratch_packet, world_packets);
 
 								ob->from_remote_other_dirty = false;
 								ob->from_remote_transform_dirty = false; // transform is sent in full packet also.
 								server.world_state->markAsChanged();
+
+								world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock); // Object may have moved or had its model changed.
 							}
 							else if(ob->state == WorldObject::State_JustCreated)
 							{
 								// Send ObjectCreated packet
 								MessageUtils::initPacket(scratch_packet, Protocol::ObjectCreated);
-								ob->writeToNetworkStream(scratch_packet);
+								ob->writeToNetworkStreamCached(scratch_packet);
 
 								enqueueMessageToBroadcast(scratch_packet, world_packets);
 
 								ob->state = WorldObject::State_Alive;
 								ob->from_remote_other_dirty = false;
 								server.world_state->markAsChanged();
+
+								world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock);
 							}
 							else if(ob->state == WorldObject::State_Dead)
 							{
@@ -1003,6 +1046,7 @@ int main(int argc, char *argv[])
 
 								// Remove ob from object map
 								world_state->getObjects(lock).erase(ob->uid);
+								world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock); // Removes the dead object from the index.
 
 								conPrint("Removed object from world_state->objects");
 								server.world_state->markAsChanged();
@@ -1033,6 +1077,8 @@ int main(int argc, char *argv[])
 
 								ob->from_remote_transform_dirty = false;
 								server.world_state->markAsChanged();
+
+								world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock);
 							}
 						}
 						else if(ob->from_remote_physics_transform_dirty)
@@ -1059,6 +1105,8 @@ int main(int argc, char *argv[])
 
 								ob->from_remote_transform_dirty = false;
 								server.world_state->markAsChanged();
+
+								world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock);
 							}
 						}
 						else if(ob->from_remote_lightmap_url_dirty)
@@ -1084,6 +1132,8 @@ int main(int argc, char *argv[])
 
 							ob->from_remote_model_url_dirty = false;
 							server.world_state->markAsChanged();
+
+							world_state->updateObjectAccounting(*ob, server.world_state->model_URL_to_stats, lock);
 						}
 						else if(ob->from_remote_content_dirty)
 						{
@@ -1160,6 +1210,17 @@ int main(int argc, char *argv[])
 
 			} // End scope for world_state->mutex lock
 
+			// Pass avatar positions in server voice mixing worlds to UDPHandlerThread.  If there are no such worlds (and weren't last time), there is nothing to do.
+			if(!temp_voice_avatar_positions.empty() || published_voice_avatar_positions)
+			{
+				published_voice_avatar_positions = !temp_voice_avatar_positions.empty();
+				{
+					Lock lock(server.voice_avatar_positions_mutex);
+					server.voice_avatar_positions.swap(temp_voice_avatar_positions);
+				}
+				server.voice_avatar_positions_changed = 1;
+			}
+
 			// Enqueue packets to worker threads to send
 			// For each connected client, get packets for the world the client is connected to, and send to them.
 			{
@@ -1246,6 +1307,8 @@ int main(int argc, char *argv[])
 				}
 			}
 
+			ServerMetrics::get().main_loop_iteration->recordSeconds(loop_iteration_timer.elapsed());
+
 			loop_iter++;
 
 			//if(loop_iter > 100) // TEMP: test shutting down
@@ -1292,6 +1355,7 @@ int main(int argc, char *argv[])
 
 
 Server::Server()
+:	timer_queue(/*tick_period=*/0.1) // Timers are updated in the main loop, which runs every 100 ms.
 {
 	world_state = new ServerAllWorldsState();
 }
@@ -1310,6 +1374,8 @@ Server::~Server()
 
 	lua_http_manager = nullptr;
 
+	photo_processing_service = nullptr; // Wait for any photo processing jobs to complete.
+
 	message_queue.clear();
 	timer_queue.clear();
 
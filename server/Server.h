@@ -18,9 +18,19 @@ class WorkerThread;
 class SubstrataLuaVM;
 class LuaHTTPRequestManager;
 class LuaHTTPRequest;
+class PhotoProcessingService;
 class SocketBufferOutStream;
 
 
+// Position of an avatar in a world with WorldSettings::SERVER_VOICE_MIXING_FLAG set, for voice routing by UDPHandlerThread.
+struct VoiceAvatarPosition
+{
+	uint32 avatar_id; // Lower 32 bits of the avatar UID, as sent in voice packets.
+	const ServerWorldState* world;
+	Vec3d pos;
+};
+
+
 struct ServerConnectedClientInfo
 {
 	IPAddress ip_addr;
@@ -152,9 +162,17 @@ public:
 	std::map<WorkerThread*, ServerConnectedClientInfo> connected_clients;
 	glare::AtomicInt connected_clients_changed;
 
+	// Updated by the main loop, which already holds the world state lock when generating avatar update packets, so UDPHandlerThread doesn't need to take the world state lock.
+	// Empty if no world has server voice mixing enabled.
+	Mutex voice_avatar_positions_mutex;
+	std::vector<VoiceAvatarPosition> voice_avatar_positions;
+	glare::AtomicInt voice_avatar_positions_changed;
+
 	Timer total_timer;
 	ScriptTimerQueue timer_queue;
 	std::vector<ScriptTimerQueueTimer> temp_triggered_timers;
 
 	Reference<LuaHTTPRequestManager> lua_http_manager;
+
+	Reference<PhotoProcessingService> photo_processing_service; // Makes photo thumbnails etc. for uploaded photos.
 };
@@ -12,7 +12,7 @@ Copyright Glare Technologies Limited 2026 -
 class ServerConfig
 {
 public:
-	ServerConfig() : allow_light_mapper_bot_full_perms(false), update_parcel_sales(false), do_lua_http_request_rate_limiting(true), enable_LOD_chunking(true), enable_registration(true), enable_mcp_server(true), do_mcp_rate_limiting(true) {}
+	ServerConfig() : allow_light_mapper_bot_full_perms(false), update_parcel_sales(false), do_lua_http_request_rate_limiting(true), enable_LOD_chunking(true), enable_registration(true), enable_mcp_server(true), do_mcp_rate_limiting(true), max_num_timers_per_script(4) {}
 	
 	std::string webserver_fragments_dir; // empty string = use default.
 	std::string webserver_public_files_dir; // empty string = use default.
@@ -35,6 +35,8 @@ public:
 
 	bool do_mcp_rate_limiting; // Should we rate-limit requests to the MCP endpoint (per API-key owner)?
 
+	int max_num_timers_per_script; // Maximum number of timers (and pending onCompleted callbacks) each Lua script can have at once.  Clamped to LuaScriptEvaluator::MAX_MAX_NUM_TIMERS.
+
 	std::string AI_model_id; // Default value = "xai/grok-4.5"
 	std::string shared_LLM_prompt_part; // Default value = "You are a helpful bot in the Substrata Metaverse." etc..  See parseServerConfig in server.cpp for the default.
 };
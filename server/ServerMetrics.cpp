@@ -0,0 +1,61 @@
+/*=====================================================================
+ServerMetrics.cpp
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ServerMetrics.h"
+
+
+#include <StringUtils.h>
+#include <maths/mathstypes.h>
+
+
+ServerMetrics::ServerMetrics()
+{
+	world_state_lock_wait   = registry.getOrCreateHistogram("substrata_world_state_lock_wait_seconds", "Time spent waiting to acquire the world state mutex with a WorldStateLock.");
+	world_state_lock_hold   = registry.getOrCreateHistogram("substrata_world_state_lock_hold_seconds", "Time the world state mutex was held by a WorldStateLock.");
+	main_loop_iteration     = registry.getOrCreateHistogram("substrata_main_loop_iteration_seconds", "Duration of main server loop iterations, excluding the sleep at the start of each iteration.");
+	client_message_handler  = registry.getOrCreateHistogram("substrata_client_message_handler_seconds", "Time taken to handle a message from a client, over all message types.");
+	client_send_queue_bytes = registry.getOrCreateGauge("substrata_client_send_queue_bytes", "Total bytes queued to send to clients, over all connections.");
+	mesh_lod_gen_backlog    = registry.getOrCreateGauge("substrata_mesh_lod_gen_backlog", "Number of meshes, physics shapes and textures remaining to be generated by MeshLODGenThread.");
+	chunk_gen_backlog       = registry.getOrCreateGauge("substrata_chunk_gen_backlog", "Number of dirty LOD chunks remaining to be built by ChunkGenThread.");
+	serialise_to_disk       = registry.getOrCreateHistogram("substrata_serialise_to_disk_seconds", "Duration of ServerAllWorldsState::serialiseToDisk().");
+	lua_execution           = registry.getOrCreateHistogram("substrata_lua_execution_seconds", "Duration of server-side Lua script event handler and timer callback executions.");
+
+	for(uint32 i=0; i<=MAX_TRACKED_MESSAGE_TYPE; ++i)
+		message_type_metrics[i].store(NULL);
+}
+
+
+ServerMetrics& ServerMetrics::get()
+{
+	static ServerMetrics metrics;
+	return metrics;
+}
+
+
+ServerMetrics::MessageTypeMetrics* ServerMetrics::getMessageTypeMetrics(uint32 msg_type)
+{
+	const uint32 index = myMin(msg_type, MAX_TRACKED_MESSAGE_TYPE);
+
+	MessageTypeMetrics* metrics = message_type_metrics[index].load(std::memory_order_acquire);
+	if(!metrics)
+	{
+		const std::string labels = "type=\"" + ((index == MAX_TRACKED_MESSAGE_TYPE) ? std::string("other") : toString(index)) + "\"";
+
+		// The registry returns the same metric objects for the same labels, so if two threads race here they will create equivalent MessageTypeMetrics.
+		MessageTypeMetrics* new_metrics = new MessageTypeMetrics();
+		new_metrics->num_messages    = registry.getOrCreateCounter("substrata_client_messages_total", "Number of messages received from clients, by message type.", labels);
+		new_metrics->handler_time_ns = registry.getOrCreateCounter("substrata_client_message_handler_nanoseconds_total", "Total time spent handling messages from clients, by message type.", labels);
+
+		MessageTypeMetrics* expected = NULL;
+		if(message_type_metrics[index].compare_exchange_strong(expected, new_metrics))
+			metrics = new_metrics;
+		else
+		{
+			delete new_metrics;
+			metrics = expected;
+		}
+	}
+	return metrics;
+}
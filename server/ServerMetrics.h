@@ -0,0 +1,54 @@
+/*=====================================================================
+ServerMetrics.h
+---------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "MetricsRegistry.h"
+#include <atomic>
+
+
+/*=====================================================================
+ServerMetrics
+-------------
+The runtime metrics collected by the server, and the registry they live in.
+Exposed in Prometheus text format on the /metrics admin route.
+
+There is a single instance, returned by ServerMetrics::get(), so that
+metrics can be updated from code that doesn't have access to the Server
+object, such as WorldStateLock.
+=====================================================================*/
+class ServerMetrics
+{
+public:
+	ServerMetrics();
+
+	static ServerMetrics& get();
+
+	// Per client message type metrics.  Message types >= MAX_TRACKED_MESSAGE_TYPE share a single 'other' entry.
+	struct MessageTypeMetrics
+	{
+		MetricsCounter* num_messages;
+		MetricsCounter* handler_time_ns; // Total time spent handling messages of this type.
+	};
+	MessageTypeMetrics* getMessageTypeMetrics(uint32 msg_type);
+
+	MetricsRegistry registry;
+
+	MetricsHistogram* world_state_lock_wait;
+	MetricsHistogram* world_state_lock_hold;
+	MetricsHistogram* main_loop_iteration;
+	MetricsHistogram* client_message_handler;
+	MetricsGauge* client_send_queue_bytes; // Total over all clients
+	MetricsGauge* mesh_lod_gen_backlog;
+	MetricsGauge* chunk_gen_backlog;
+	MetricsHistogram* serialise_to_disk;
+	MetricsHistogram* lua_execution;
+
+private:
+	static const uint32 MAX_TRACKED_MESSAGE_TYPE = 8192;
+
+	std::atomic<MessageTypeMetrics*> message_type_metrics[MAX_TRACKED_MESSAGE_TYPE + 1]; // Created on first use.
+};
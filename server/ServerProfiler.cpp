@@ -0,0 +1,305 @@
+/*=====================================================================
+ServerProfiler.cpp
+------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ServerProfiler.h"
+
+
+#include <Lock.h>
+#include <Clock.h>
+#include <Exception.h>
+#include <StringUtils.h>
+#include <ConPrint.h>
+#include <FileUtils.h>
+#include <maths/mathstypes.h>
+#include <cstdio>
+
+
+std::atomic<bool> ServerProfiler::capturing(false);
+
+
+ServerProfiler::ServerProfiler()
+:	num_events(0),
+	num_dropped_events(0),
+	capture_start_time(0),
+	capture_end_time(0)
+{}
+
+
+ServerProfiler::~ServerProfiler()
+{}
+
+
+ServerProfiler& ServerProfiler::get()
+{
+	static ServerProfiler profiler;
+	return profiler;
+}
+
+
+double ServerProfiler::getCurTime()
+{
+	return Clock::getTimeSinceInit();
+}
+
+
+void ServerProfiler::setTraceDir(const std::string& dir)
+{
+	Lock lock(mutex);
+	trace_dir = dir;
+}
+
+
+ServerProfiler::ThreadBuffer* ServerProfiler::getThreadBuffer()
+{
+	static thread_local ThreadBuffer* thread_buffer = NULL;
+	if(!thread_buffer)
+	{
+		Reference<ThreadBuffer> new_buffer = new ThreadBuffer();
+
+		Lock lock(mutex);
+		new_buffer->thread_index = (uint32)thread_buffers.size() + 1;
+		thread_buffers.push_back(new_buffer); // thread_buffers keeps the buffer alive after the thread exits, so its events can still be written.
+		thread_buffer = new_buffer.ptr();
+	}
+	return thread_buffer;
+}
+
+
+void ServerProfiler::startCapture(double duration)
+{
+	if(!(duration > 0 && duration <= MAX_CAPTURE_DURATION))
+		throw glare::Exception("Invalid capture duration, must be in (0, " + toString(MAX_CAPTURE_DURATION) + "] s.");
+
+	Lock lock(mutex);
+
+	if(capturing)
+		throw glare::Exception("A capture is already running.");
+	if(trace_dir.empty())
+		throw glare::Exception("Trace dir not set.");
+
+	// Clear any events left from a previous capture
+	for(size_t i=0; i<thread_buffers.size(); ++i)
+	{
+		Lock buffer_lock(thread_buffers[i]->mutex);
+		thread_buffers[i]->events.clear();
+	}
+
+	num_events = 0;
+	num_dropped_events = 0;
+	capture_start_time = getCurTime();
+	capture_end_time = capture_start_time + duration;
+	capturing = true;
+
+	conPrint("ServerProfiler: Started " + doubleToStringNSigFigs(duration, 3) + " s trace capture.");
+}
+
+
+void ServerProfiler::recordEvent(const char* name, double start_time, double end_time, const char* arg_name, int64 arg_value)
+{
+	if(!capturing)
+		return;
+
+	if(num_events.fetch_add(1, std::memory_order_relaxed) >= MAX_EVENTS)
+	{
+		num_dropped_events.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	ServerTraceEvent event;
+	event.name = name;
+	event.start_time = start_time;
+	event.duration = end_time - start_time;
+	event.arg_name = arg_name;
+	event.arg_value = arg_value;
+	event.thread_index = buffer->thread_index;
+
+	Lock lock(buffer->mutex); // Only contended while the capture is being written.
+	buffer->events.push_back(event);
+}
+
+
+void ServerProfiler::update()
+{
+	if(!capturing)
+		return;
+
+	std::vector<ServerTraceEvent> events;
+	std::string path;
+	{
+		Lock lock(mutex);
+
+		if(getCurTime() < capture_end_time)
+			return;
+
+		capturing = false;
+
+		// Gather events from all threads, with times made relative to the capture start time.
+		for(size_t i=0; i<thread_buffers.size(); ++i)
+		{
+			Lock buffer_lock(thread_buffers[i]->mutex);
+			for(size_t z=0; z<thread_buffers[i]->events.size(); ++z)
+			{
+				ServerTraceEvent event = thread_buffers[i]->events[z];
+				event.start_time -= capture_start_time;
+				events.push_back(event);
+			}
+			thread_buffers[i]->events.clear();
+		}
+
+		path = trace_dir + "/server_trace_" + toString((uint64)Clock::getSecsSince1970()) + ".json";
+	}
+
+	try
+	{
+		std::string json;
+		writeTraceJSON(events, json);
+
+		FileUtils::createDirIfDoesNotExist(FileUtils::getDirectory(path));
+		FileUtils::writeEntireFileTextMode(path, json);
+
+		conPrint("ServerProfiler: Wrote " + toString(events.size()) + " events to '" + path + "'" +
+			((num_dropped_events > 0) ? (" (" + toString((uint64)num_dropped_events) + " events were dropped)") : std::string()));
+
+		Lock lock(mutex);
+		last_trace_path = path;
+	}
+	catch(glare::Exception& e)
+	{
+		conPrint("ServerProfiler: Error while writing trace: " + e.what());
+	}
+}
+
+
+std::string ServerProfiler::getStatusDescription()
+{
+	Lock lock(mutex);
+
+	std::string s;
+	if(capturing)
+		s = "Capture running, " + doubleToStringNSigFigs(myMax(0.0, capture_end_time - getCurTime()), 3) + " s remaining.";
+	else
+		s = "No capture running.";
+
+	if(!last_trace_path.empty())
+		s += "  Last trace written to '" + last_trace_path + "'.";
+
+#if TRACY_ENABLE
+	s += "  Tracy support is enabled.";
+#endif
+	return s;
+}
+
+
+static void appendJSONEscapedString(const char* str, std::string& s)
+{
+	for(const char* c = str; *c != 0; ++c)
+	{
+		if(*c == '"' || *c == '\\')
+		{
+			s.push_back('\\');
+			s.push_back(*c);
+		}
+		else if((unsigned char)*c >= 32)
+			s.push_back(*c);
+	}
+}
+
+
+void ServerProfiler::writeTraceJSON(const std::vector<ServerTraceEvent>& events, std::string& json_out)
+{
+	json_out.reserve(json_out.size() + events.size() * 100);
+
+	json_out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	char buf[256];
+	for(size_t i=0; i<events.size(); ++i)
+	{
+		const ServerTraceEvent& event = events[i];
+
+		json_out += "{\"name\":\"";
+		appendJSONEscapedString(event.name, json_out);
+		std::snprintf(buf, sizeof(buf), "\",\"cat\":\"server\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u", event.start_time * 1.0e6, event.duration * 1.0e6, event.thread_index);
+		json_out += buf;
+		if(event.arg_name)
+		{
+			json_out += ",\"args\":{\"";
+			appendJSONEscapedString(event.arg_name, json_out);
+			json_out += "\":" + toString(event.arg_value) + "}";
+		}
+		json_out += (i + 1 < events.size()) ? "},\n" : "}\n";
+	}
+
+	json_out += "]}\n";
+}
+
+
+#if BUILD_TESTS
+
+
+#include <TestUtils.h>
+
+
+void ServerProfiler::test()
+{
+	conPrint("ServerProfiler::test()");
+
+	//-------------------- Test JSON writing --------------------
+	{
+		std::vector<ServerTraceEvent> events;
+
+		std::string json;
+		writeTraceJSON(events, json);
+		testAssert(json == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+
+		ServerTraceEvent event;
+		event.name = "Main loop";
+		event.start_time = 0.5;
+		event.duration = 0.001;
+		event.arg_name = NULL;
+		event.arg_value = 0;
+		event.thread_index = 2;
+		events.push_back(event);
+
+		event.name = "Handle \"message\"";
+		event.arg_name = "msg_type";
+		event.arg_value = 12;
+		events.push_back(event);
+
+		json.clear();
+		writeTraceJSON(events, json);
+		testAssert(json ==
+			"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+			"{\"name\":\"Main loop\",\"cat\":\"server\",\"ph\":\"X\",\"ts\":500000.000,\"dur\":1000.000,\"pid\":1,\"tid\":2},\n"
+			"{\"name\":\"Handle \\\"message\\\"\",\"cat\":\"server\",\"ph\":\"X\",\"ts\":500000.000,\"dur\":1000.000,\"pid\":1,\"tid\":2,\"args\":{\"msg_type\":12}}\n"
+			"]}\n");
+	}
+
+	//-------------------- Test that events are not recorded when not capturing --------------------
+	{
+		testAssert(!isCapturing());
+		{
+			ServerProfileZone zone("test zone");
+		}
+		ServerProfiler::get().recordEvent("test event", 0, 1);
+		testAssert(ServerProfiler::get().num_events == 0);
+	}
+
+	//-------------------- Test invalid capture durations are rejected --------------------
+	try
+	{
+		ServerProfiler::get().startCapture(-1.0);
+		failTest("Expected exception");
+	}
+	catch(glare::Exception&)
+	{}
+	testAssert(!isCapturing());
+
+	conPrint("ServerProfiler::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,124 @@
+/*=====================================================================
+ServerProfiler.h
+----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <ThreadSafeRefCounted.h>
+#include <Reference.h>
+#include <Mutex.h>
+#include <Platform.h>
+#include <tracy/Tracy.hpp>
+#include <atomic>
+#include <string>
+#include <vector>
+
+
+struct ServerTraceEvent
+{
+	const char* name; // Must be a string literal, or otherwise outlive the capture.
+	double start_time; // Seconds, relative to capture start
+	double duration; // Seconds
+	const char* arg_name; // May be NULL
+	int64 arg_value;
+	uint32 thread_index;
+};
+
+
+/*=====================================================================
+ServerProfiler
+--------------
+Trace capture for the server process, so that intermittent latency spikes
+can be captured in production without attaching an external profiler.
+
+Code is instrumented with SERVER_PROFILE_ZONE("name").  This creates a
+Tracy zone (when built with TRACY_ENABLED), and while a capture is running,
+records the zone as a trace event.
+
+A capture is started from the admin page with startCapture().  Events are
+appended to per-thread buffers, so instrumented threads don't contend with
+each other.  When the capture duration has passed, update(), which is called
+from the main server loop, writes the events to a JSON file in the Chrome
+trace event format, which can be opened in Perfetto (ui.perfetto.dev) or
+chrome://tracing.
+=====================================================================*/
+class ServerProfiler
+{
+public:
+	static const size_t MAX_EVENTS = 4000000; // Events after this many in a capture are dropped.
+	static constexpr double MAX_CAPTURE_DURATION = 60.0;
+
+	ServerProfiler();
+	~ServerProfiler();
+
+	static ServerProfiler& get();
+
+	static bool isCapturing() { return capturing.load(std::memory_order_relaxed); }
+	static double getCurTime();
+
+	void setTraceDir(const std::string& dir);
+
+	// Throws glare::Exception if a capture is already running, or if the trace dir has not been set.
+	void startCapture(double duration);
+
+	// Finishes the capture and writes the trace file, if a capture is running and its duration has passed.
+	void update();
+
+	std::string getStatusDescription();
+
+	// Time args are from getCurTime().
+	void recordEvent(const char* name, double start_time, double end_time, const char* arg_name = NULL, int64 arg_value = 0);
+
+	static void writeTraceJSON(const std::vector<ServerTraceEvent>& events, std::string& json_out);
+
+	static void test();
+
+private:
+	struct ThreadBuffer : public ThreadSafeRefCounted
+	{
+		Mutex mutex;
+		std::vector<ServerTraceEvent> events		GUARDED_BY(mutex);
+		uint32 thread_index;
+	};
+
+	ThreadBuffer* getThreadBuffer();
+
+	static std::atomic<bool> capturing;
+
+	std::atomic<uint64> num_events;
+	std::atomic<uint64> num_dropped_events;
+
+	Mutex mutex;
+	std::vector<Reference<ThreadBuffer>> thread_buffers	GUARDED_BY(mutex);
+	double capture_start_time							GUARDED_BY(mutex);
+	double capture_end_time								GUARDED_BY(mutex);
+	std::string trace_dir								GUARDED_BY(mutex);
+	std::string last_trace_path							GUARDED_BY(mutex);
+};
+
+
+// Records the lifetime of the object as a trace event, if a capture is running.
+class ServerProfileZone
+{
+public:
+	ServerProfileZone(const char* name_) : name(name_), arg_name(NULL), arg_value(0), start_time(ServerProfiler::isCapturing() ? ServerProfiler::getCurTime() : -1.0) {}
+	~ServerProfileZone()
+	{
+		if(start_time >= 0)
+			ServerProfiler::get().recordEvent(name, start_time, ServerProfiler::getCurTime(), arg_name, arg_value);
+	}
+
+	void setIntArg(const char* arg_name_, int64 arg_value_) { arg_name = arg_name_; arg_value = arg_value_; }
+
+private:
+	const char* name;
+	const char* arg_name;
+	int64 arg_value;
+	double start_time;
+};
+
+
+// Profiling zone for both Tracy and ServerProfiler trace captures.  name should be a string literal.
+#define SERVER_PROFILE_ZONE(name) ZoneScopedN(name); ServerProfileZone server_profile_zone(name)
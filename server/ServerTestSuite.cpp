@@ -7,11 +7,20 @@ Copyright Glare Technologies Limited 2023 -
 
 
 #include "AccountHandlers.h"
+#include "AdminPagination.h"
 #include "ServerLuaScriptTests.h"
 #include "SubEvent.h"
+#include "ClientSendQueue.h"
+#include "ImageResizing.h"
+#include "ServerVoiceMixer.h"
+#include "ObjectAccountingIndex.h"
+#include "MetricsRegistry.h"
+#include "ServerProfiler.h"
 #include "../shared/WorldObject.h"
 #include "../shared/RateLimiter.h"
+#include "../shared/ScriptTimerQueue.h"
 #include "../shared/LODGeneration.h"
+#include "../shared/JoltShapeBuilding.h"
 #include "../ethereum/RLP.h"
 #include "../ethereum/Signing.h"
 #include "../ethereum/Infura.h"
@@ -109,6 +118,14 @@ void ServerTestSuite::test()
 	runTest([&]() { TimeStamp::test();													});
 	runTest([&]() { SubEvent::test();													});
 	runTest([&]() { RateLimiter::test();												});
+	runTest([&]() { ScriptTimerQueue::test();											});
+	runTest([&]() { ClientSendQueue::test();											});
+	runTest([&]() { ImageResizing::test();												});
+	runTest([&]() { ServerVoiceMixer::test();											});
+	runTest([&]() { ObjectAccountingIndex::test();										});
+	runTest([&]() { MetricsRegistry::test();											});
+	runTest([&]() { ServerProfiler::test();												});
+	runTest([&]() { JoltShapeBuilding::test();											});
 	runTest([&]() { testHashMap();														});
 	runTest([&]() { doArrayRefTests();													});
 	runTest([&]() { URL::test();														});
@@ -135,6 +152,7 @@ void ServerTestSuite::test()
 	runTest([&]() { RLP::test();														});
 	runTest([&]() { Signing::test();													});
 	runTest([&]() { AccountHandlers::test();											});
+	runTest([&]() { AdminPagination::test();											});
 	runTest([&]() { HTTPClient::test();													}, /*mem leak allowed=*/true); // Leaks due to libtls allocating globals
 	
 	// runTest([&]() { BatchedMeshTests::test();										}); // Uses some Indigo files
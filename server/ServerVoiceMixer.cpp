@@ -0,0 +1,573 @@
+/*=====================================================================
+ServerVoiceMixer.cpp
+--------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "ServerVoiceMixer.h"
+
+
+#include <ConPrint.h>
+#include <StringUtils.h>
+#include <Exception.h>
+#include <PlatformUtils.h>
+#include <Lock.h>
+#include <Timer.h>
+#include <maths/mathstypes.h>
+#include <opus.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+static const int MAX_IDLE_FRAMES = 100; // Speakers and regions with no packets for this many frames (1 s) are removed.
+static const size_t MAX_OPUS_PACKET_SIZE = 1276;
+
+
+ServerVoiceMixer::Speaker::Speaker()
+:	opus_decoder(NULL),
+	pcm_valid(false),
+	frames_without_packet(0)
+{}
+
+
+ServerVoiceMixer::Speaker::~Speaker()
+{
+	if(opus_decoder)
+		opus_decoder_destroy(opus_decoder);
+}
+
+
+ServerVoiceMixer::Region::Region()
+:	opus_encoder(NULL),
+	world(NULL),
+	stream_id(0),
+	seq_num(0),
+	num_speakers(0),
+	packet_valid(false),
+	frames_without_speakers(0)
+{}
+
+
+ServerVoiceMixer::Region::~Region()
+{
+	if(opus_encoder)
+		opus_encoder_destroy(opus_encoder);
+}
+
+
+class SpeakerDecodeTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		for(size_t i=begin; i<end; ++i)
+		{
+			ServerVoiceMixer::Speaker* speaker = speakers[i].ptr();
+			const int num_samples_decoded = opus_decode_float(speaker->opus_decoder, speaker->cur_packet.data(), (opus_int32)speaker->cur_packet.size(), speaker->pcm.data(), (int)speaker->pcm.size(),
+				0 // decode_fec
+			);
+			speaker->pcm_valid = num_samples_decoded == ServerVoiceMixer::SAMPLES_PER_FRAME;
+			if(speaker->pcm_valid)
+				mixer->num_packets_decoded.increment();
+			else
+				mixer->num_decode_errors.increment();
+		}
+	}
+
+	ServerVoiceMixer* mixer;
+	const Reference<ServerVoiceMixer::Speaker>* speakers;
+	size_t begin, end;
+};
+
+
+class RegionEncodeTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		for(size_t i=begin; i<end; ++i)
+		{
+			ServerVoiceMixer::Region* region = regions[i].ptr();
+
+			region->packet.resize(ServerVoiceMixer::MIXED_VOICE_PACKET_HEADER_SIZE + MAX_OPUS_PACKET_SIZE);
+			const opus_int32 encoded_len = opus_encode_float(region->opus_encoder, region->mix.data(), ServerVoiceMixer::SAMPLES_PER_FRAME,
+				region->packet.data() + ServerVoiceMixer::MIXED_VOICE_PACKET_HEADER_SIZE, (opus_int32)MAX_OPUS_PACKET_SIZE);
+			if(encoded_len < 0)
+			{
+				region->packet_valid = false;
+				continue;
+			}
+
+			const uint32 type = ServerVoiceMixer::MIXED_VOICE_PACKET_TYPE;
+			const float pos[3] = { (float)region->pos.x, (float)region->pos.y, (float)region->pos.z };
+			std::memcpy(region->packet.data() + 0, &type, 4);
+			std::memcpy(region->packet.data() + 4, &region->stream_id, 4);
+			std::memcpy(region->packet.data() + 8, &region->seq_num, 4);
+			std::memcpy(region->packet.data() + 12, pos, 12);
+			region->packet.resize(ServerVoiceMixer::MIXED_VOICE_PACKET_HEADER_SIZE + encoded_len);
+			region->packet_valid = true;
+			region->seq_num++;
+
+			mixer->num_region_packets_encoded.increment();
+		}
+	}
+
+	ServerVoiceMixer* mixer;
+	const Reference<ServerVoiceMixer::Region>* regions;
+	size_t begin, end;
+};
+
+
+ServerVoiceMixer::ServerVoiceMixer(size_t num_threads)
+:	task_manager("voice mixer task manager", num_threads)
+{}
+
+
+ServerVoiceMixer::~ServerVoiceMixer()
+{
+}
+
+
+size_t ServerVoiceMixer::getDefaultNumThreads()
+{
+	return myClamp<size_t>(PlatformUtils::getNumLogicalProcessors() / 4, 1, 4);
+}
+
+
+VoiceRegionKey ServerVoiceMixer::getRegionKey(const ServerWorldState* world, const Vec3d& pos)
+{
+	VoiceRegionKey key;
+	key.world = world;
+	key.x = (int)std::floor(pos.x / REGION_WIDTH);
+	key.y = (int)std::floor(pos.y / REGION_WIDTH);
+	return key;
+}
+
+
+bool ServerVoiceMixer::isSpeakerNear(const Vec3d& listener_pos, const Vec3d& speaker_pos)
+{
+	const VoiceRegionKey listener_region = getRegionKey(NULL, listener_pos);
+	const VoiceRegionKey speaker_region  = getRegionKey(NULL, speaker_pos);
+	return std::abs(listener_region.x - speaker_region.x) <= 1 && std::abs(listener_region.y - speaker_region.y) <= 1;
+}
+
+
+uint32 ServerVoiceMixer::getRegionStreamID(const VoiceRegionKey& key)
+{
+	uint64 h = (uint64)(size_t)key.world * 0x9E3779B97F4A7C15ull;
+	h ^= (uint64)(uint32)key.x * 0xC2B2AE3D27D4EB4Full;
+	h ^= (uint64)(uint32)key.y * 0x165667B19E3779F9ull;
+	h ^= h >> 29;
+	return (uint32)(h ^ (h >> 32));
+}
+
+
+void ServerVoiceMixer::setClients(const std::vector<VoiceClientInfo>& new_clients)
+{
+	Lock lock(mutex);
+	clients = new_clients;
+}
+
+
+void ServerVoiceMixer::addSpeakerPacket(const VoiceClientInfo& speaker_info, const uint8* opus_data, size_t opus_data_len)
+{
+	Lock lock(mutex);
+
+	auto res = speakers.find(speaker_info.avatar_id);
+	Speaker* speaker;
+	if(res == speakers.end())
+	{
+		int opus_error = 0;
+		OpusDecoder* opus_decoder = opus_decoder_create(SAMPLE_RATE, /*channels=*/1, &opus_error);
+		if(opus_error != OPUS_OK)
+			throw glare::Exception("opus_decoder_create failed.");
+
+		Reference<Speaker> new_speaker = new Speaker();
+		new_speaker->opus_decoder = opus_decoder;
+		new_speaker->pcm.resize(SAMPLES_PER_FRAME);
+		speakers[speaker_info.avatar_id] = new_speaker;
+		speaker = new_speaker.ptr();
+	}
+	else
+		speaker = res->second.ptr();
+
+	speaker->region = getRegionKey(speaker_info.world, speaker_info.pos);
+	speaker->pos = speaker_info.pos;
+
+	if(speaker->queued_packets.size() >= MAX_QUEUED_PACKETS_PER_SPEAKER)
+	{
+		num_packets_dropped.increment();
+		return;
+	}
+
+	speaker->queued_packets.push_back(std::vector<uint8>(opus_data, opus_data + opus_data_len));
+}
+
+
+void ServerVoiceMixer::mixFrame()
+{
+	// Take the next packet from each speaker, and remove speakers that have stopped talking.
+	decode_speakers.clear();
+	{
+		Lock lock(mutex);
+
+		for(auto it = speakers.begin(); it != speakers.end(); )
+		{
+			Speaker* speaker = it->second.ptr();
+			if(!speaker->queued_packets.empty())
+			{
+				speaker->cur_packet.swap(speaker->queued_packets.front());
+				speaker->queued_packets.pop_front();
+				speaker->mix_region = speaker->region;
+				speaker->mix_pos = speaker->pos;
+				speaker->frames_without_packet = 0;
+				decode_speakers.push_back(it->second);
+				++it;
+			}
+			else if(++speaker->frames_without_packet > MAX_IDLE_FRAMES)
+				it = speakers.erase(it);
+			else
+				++it;
+		}
+
+		temp_clients = clients;
+	}
+
+	// Decode speaker packets in parallel.  Each speaker has its own decoder, so speakers can be decoded independently.
+	{
+		const size_t num_speakers = decode_speakers.size();
+		const size_t num_tasks = myClamp<size_t>(num_speakers, 1, task_manager.getConcurrency());
+		const size_t speakers_per_task = Maths::roundedUpDivide(num_speakers, num_tasks);
+
+		Reference<glare::TaskGroup> task_group = new glare::TaskGroup();
+		for(size_t begin = 0; begin < num_speakers; begin += speakers_per_task)
+		{
+			SpeakerDecodeTask* task = new SpeakerDecodeTask();
+			task->mixer = this;
+			task->speakers = decode_speakers.data();
+			task->begin = begin;
+			task->end = myMin(begin + speakers_per_task, num_speakers);
+			task_group->tasks.push_back(task);
+		}
+		if(!task_group->tasks.empty())
+			task_manager.runTaskGroup(task_group);
+	}
+
+	// Sum decoded speakers into their regions
+	for(auto it = regions.begin(); it != regions.end(); ++it)
+	{
+		Region* region = it->second.ptr();
+		std::fill(region->mix.begin(), region->mix.end(), 0.f);
+		region->pos_sum = Vec3d(0.0);
+		region->num_speakers = 0;
+		region->packet_valid = false;
+	}
+
+	for(size_t i=0; i<decode_speakers.size(); ++i)
+	{
+		const Speaker* speaker = decode_speakers[i].ptr();
+		if(!speaker->pcm_valid)
+			continue;
+
+		Reference<Region>& region_ref = regions[speaker->mix_region];
+		if(region_ref.isNull())
+		{
+			int opus_error = 0;
+			OpusEncoder* opus_encoder = opus_encoder_create(SAMPLE_RATE, /*channels=*/1, OPUS_APPLICATION_VOIP, &opus_error);
+			if(opus_error != OPUS_OK)
+				throw glare::Exception("opus_encoder_create failed.");
+
+			region_ref = new Region();
+			region_ref->opus_encoder = opus_encoder;
+			region_ref->world = speaker->mix_region.world;
+			region_ref->stream_id = getRegionStreamID(speaker->mix_region);
+			region_ref->mix.resize(SAMPLES_PER_FRAME, 0.f);
+		}
+
+		Region* region = region_ref.ptr();
+		for(int z=0; z<SAMPLES_PER_FRAME; ++z)
+			region->mix[z] += speaker->pcm[z];
+		region->pos_sum += speaker->mix_pos;
+		region->num_speakers++;
+	}
+
+	// Normalise mixes that would clip, and remove regions that have been silent for a while.
+	encode_regions.clear();
+	for(auto it = regions.begin(); it != regions.end(); )
+	{
+		Region* region = it->second.ptr();
+		if(region->num_speakers > 0)
+		{
+			float max_val = 0;
+			for(int z=0; z<SAMPLES_PER_FRAME; ++z)
+				max_val = myMax(max_val, std::fabs(region->mix[z]));
+			if(max_val > 1.f)
+			{
+				const float scale = 1.f / max_val;
+				for(int z=0; z<SAMPLES_PER_FRAME; ++z)
+					region->mix[z] *= scale;
+			}
+
+			region->pos = region->pos_sum * (1.0 / region->num_speakers);
+			region->frames_without_speakers = 0;
+			encode_regions.push_back(it->second);
+			++it;
+		}
+		else if(++region->frames_without_speakers > MAX_IDLE_FRAMES)
+			it = regions.erase(it);
+		else
+			++it;
+	}
+
+	// Encode region mixes in parallel.
+	{
+		const size_t num_regions = encode_regions.size();
+		const size_t num_tasks = myClamp<size_t>(num_regions, 1, task_manager.getConcurrency());
+		const size_t regions_per_task = Maths::roundedUpDivide(num_regions, num_tasks);
+
+		Reference<glare::TaskGroup> task_group = new glare::TaskGroup();
+		for(size_t begin = 0; begin < num_regions; begin += regions_per_task)
+		{
+			RegionEncodeTask* task = new RegionEncodeTask();
+			task->mixer = this;
+			task->regions = encode_regions.data();
+			task->begin = begin;
+			task->end = myMin(begin + regions_per_task, num_regions);
+			task_group->tasks.push_back(task);
+		}
+		if(!task_group->tasks.empty())
+			task_manager.runTaskGroup(task_group);
+	}
+}
+
+
+void ServerVoiceMixer::getRegionPacketsForListener(const VoiceClientInfo& listener, std::vector<const std::vector<uint8>*>& packets_out)
+{
+	packets_out.clear();
+	if(!listener.server_mixing || !listener.world)
+		return;
+
+	// Get regions in the listener's world that aren't near the listener.  Speakers in near regions are forwarded to the listener individually.
+	temp_candidate_regions.clear();
+	for(size_t i=0; i<encode_regions.size(); ++i)
+	{
+		const Region* region = encode_regions[i].ptr();
+		if(region->packet_valid && (region->world == listener.world) && !isSpeakerNear(listener.pos, region->pos))
+			temp_candidate_regions.push_back(std::make_pair(listener.pos.getDist2(region->pos), region));
+	}
+
+	// Keep the closest regions
+	const size_t num_to_send = myMin(temp_candidate_regions.size(), MAX_REGION_STREAMS_PER_LISTENER);
+	std::partial_sort(temp_candidate_regions.begin(), temp_candidate_regions.begin() + num_to_send, temp_candidate_regions.end(),
+		[](const std::pair<double, const Region*>& a, const std::pair<double, const Region*>& b) { return a.first < b.first; });
+
+	for(size_t i=0; i<num_to_send; ++i)
+		packets_out.push_back(&temp_candidate_regions[i].second->packet);
+}
+
+
+void ServerVoiceMixer::sendRegionStreams(UDPSocket& socket)
+{
+	if(encode_regions.empty())
+		return;
+
+	for(size_t i=0; i<temp_clients.size(); ++i)
+	{
+		const VoiceClientInfo& client = temp_clients[i];
+		if(client.client_UDP_port <= 0)
+			continue;
+
+		getRegionPacketsForListener(client, temp_packets);
+		for(size_t z=0; z<temp_packets.size(); ++z)
+		{
+			socket.sendPacket(temp_packets[z]->data(), temp_packets[z]->size(), client.ip_addr, client.client_UDP_port);
+			num_region_packets_sent.increment();
+		}
+	}
+}
+
+
+std::string ServerVoiceMixer::getDiagnostics() const
+{
+	size_t num_speakers;
+	{
+		Lock lock(mutex);
+		num_speakers = speakers.size();
+	}
+
+	return "Voice mixer: speakers: " + toString(num_speakers) + ", packets decoded: " + toString(num_packets_decoded) + ", decode errors: " + toString(num_decode_errors) +
+		", region packets encoded: " + toString(num_region_packets_encoded) + ", region packets sent: " + toString(num_region_packets_sent) + ", packets dropped: " + toString(num_packets_dropped);
+}
+
+
+ServerVoiceMixerThread::ServerVoiceMixerThread(Reference<ServerVoiceMixer> mixer_, Reference<UDPSocket> udp_socket_)
+:	mixer(mixer_),
+	udp_socket(udp_socket_)
+{}
+
+
+void ServerVoiceMixerThread::doRun()
+{
+	PlatformUtils::setCurrentThreadNameIfTestsEnabled("ServerVoiceMixerThread");
+
+	try
+	{
+		Timer timer;
+		double next_frame_time = 0;
+		while(die == 0)
+		{
+			mixer->mixFrame();
+			mixer->sendRegionStreams(*udp_socket);
+
+			next_frame_time += 0.01;
+			const double sleep_time = next_frame_time - timer.elapsed();
+			if(sleep_time > 0)
+				PlatformUtils::Sleep((int)(sleep_time * 1000));
+			else if(sleep_time < -0.1)
+				next_frame_time = timer.elapsed(); // If we have fallen a long way behind, don't try and catch up.
+		}
+	}
+	catch(glare::Exception& e)
+	{
+		conPrint("ServerVoiceMixerThread: glare::Exception: " + e.what());
+	}
+}
+
+
+#if BUILD_TESTS
+
+
+#include <TestUtils.h>
+
+
+void ServerVoiceMixer::test()
+{
+	conPrint("ServerVoiceMixer::test()");
+
+	//-------------------- Test region helpers --------------------
+	{
+		const ServerWorldState* world = (const ServerWorldState*)(size_t)0x1000;
+
+		testAssert(getRegionKey(world, Vec3d(0, 0, 0)) == getRegionKey(world, Vec3d(31, 31, 100)));
+		testAssert(!(getRegionKey(world, Vec3d(0, 0, 0)) == getRegionKey(world, Vec3d(33, 0, 0))));
+		testAssert(getRegionKey(world, Vec3d(-1, -1, 0)).x == -1);
+		testAssert(getRegionKey(world, Vec3d(-1, -1, 0)).y == -1);
+
+		testAssert(isSpeakerNear(Vec3d(0, 0, 0), Vec3d(10, 10, 0)));
+		testAssert(isSpeakerNear(Vec3d(0, 0, 0), Vec3d(-20, 50, 0))); // Adjacent region
+		testAssert(!isSpeakerNear(Vec3d(0, 0, 0), Vec3d(70, 0, 0)));
+		testAssert(!isSpeakerNear(Vec3d(0, 0, 0), Vec3d(-40, 0, 0)));
+
+		testAssert(getRegionStreamID(getRegionKey(world, Vec3d(0, 0, 0))) != getRegionStreamID(getRegionKey(world, Vec3d(40, 0, 0))));
+		testAssert(getRegionStreamID(getRegionKey(world, Vec3d(0, 0, 0))) == getRegionStreamID(getRegionKey(world, Vec3d(1, 2, 3))));
+	}
+
+	//-------------------- Test mixing distant speakers into a region stream --------------------
+	try
+	{
+		const ServerWorldState* world       = (const ServerWorldState*)(size_t)0x1000;
+		const ServerWorldState* other_world = (const ServerWorldState*)(size_t)0x2000;
+
+		Reference<ServerVoiceMixer> mixer = new ServerVoiceMixer(/*num threads=*/2);
+
+		std::vector<VoiceClientInfo> speakers(2);
+		for(int i=0; i<2; ++i)
+		{
+			speakers[i].client_UDP_port = 1000 + i;
+			speakers[i].avatar_id = i;
+			speakers[i].world = world;
+			speakers[i].pos = Vec3d(200 + i * 5.0, 0, 0);
+			speakers[i].server_mixing = true;
+		}
+
+		VoiceClientInfo far_listener = speakers[0];
+		far_listener.avatar_id = 10;
+		far_listener.pos = Vec3d(0, 0, 0);
+
+		VoiceClientInfo near_listener = far_listener;
+		near_listener.avatar_id = 11;
+		near_listener.pos = Vec3d(190, 10, 0);
+
+		VoiceClientInfo other_world_listener = far_listener;
+		other_world_listener.avatar_id = 12;
+		other_world_listener.world = other_world;
+
+		int opus_error = 0;
+		OpusEncoder* encoder = opus_encoder_create(SAMPLE_RATE, 1, OPUS_APPLICATION_VOIP, &opus_error);
+		testAssert(opus_error == OPUS_OK);
+		OpusDecoder* decoder = opus_decoder_create(SAMPLE_RATE, 1, &opus_error);
+		testAssert(opus_error == OPUS_OK);
+
+		std::vector<float> pcm(SAMPLES_PER_FRAME);
+		std::vector<uint8> encoded(MAX_OPUS_PACKET_SIZE);
+		std::vector<const std::vector<uint8>*> packets;
+		float max_decoded_val = 0;
+		uint32 last_seq_num = 0;
+		int num_region_packets = 0;
+		for(int frame=0; frame<30; ++frame)
+		{
+			for(int i=0; i<2; ++i)
+			{
+				for(int z=0; z<SAMPLES_PER_FRAME; ++z)
+					pcm[z] = 0.3f * std::sin((frame * SAMPLES_PER_FRAME + z) * (i + 1) * 440.f * 6.2831853f / SAMPLE_RATE);
+				const opus_int32 len = opus_encode_float(encoder, pcm.data(), SAMPLES_PER_FRAME, encoded.data(), (opus_int32)encoded.size());
+				testAssert(len > 0);
+				mixer->addSpeakerPacket(speakers[i], encoded.data(), len);
+			}
+
+			mixer->mixFrame();
+
+			mixer->getRegionPacketsForListener(near_listener, packets);
+			testAssert(packets.empty()); // Near listener should get the speakers individually instead.
+
+			mixer->getRegionPacketsForListener(other_world_listener, packets);
+			testAssert(packets.empty());
+
+			mixer->getRegionPacketsForListener(far_listener, packets);
+			testAssert(packets.size() == 1);
+
+			const std::vector<uint8>& packet = *packets[0];
+			testAssert(packet.size() > MIXED_VOICE_PACKET_HEADER_SIZE);
+			uint32 type, stream_id, seq_num;
+			float pos[3];
+			std::memcpy(&type, packet.data(), 4);
+			std::memcpy(&stream_id, packet.data() + 4, 4);
+			std::memcpy(&seq_num, packet.data() + 8, 4);
+			std::memcpy(pos, packet.data() + 12, 12);
+			testAssert(type == MIXED_VOICE_PACKET_TYPE);
+			testAssert(stream_id == getRegionStreamID(getRegionKey(world, speakers[0].pos)));
+			if(num_region_packets > 0)
+				testAssert(seq_num == last_seq_num + 1);
+			last_seq_num = seq_num;
+			testAssert(epsEqual(pos[0], 202.5f));
+
+			const int num_decoded = opus_decode_float(decoder, packet.data() + MIXED_VOICE_PACKET_HEADER_SIZE, (opus_int32)(packet.size() - MIXED_VOICE_PACKET_HEADER_SIZE), pcm.data(), SAMPLES_PER_FRAME, 0);
+			testAssert(num_decoded == SAMPLES_PER_FRAME);
+			for(int z=0; z<SAMPLES_PER_FRAME; ++z)
+				max_decoded_val = myMax(max_decoded_val, std::fabs(pcm[z]));
+
+			num_region_packets++;
+		}
+
+		testAssert(max_decoded_val > 0.1f); // Mixed stream should not be silent.
+		testAssert(mixer->num_packets_decoded == 60);
+		testAssert(mixer->num_decode_errors == 0);
+
+		// Check the region stream stops when the speakers stop.
+		mixer->mixFrame();
+		mixer->getRegionPacketsForListener(far_listener, packets);
+		testAssert(packets.empty());
+
+		opus_encoder_destroy(encoder);
+		opus_decoder_destroy(decoder);
+	}
+	catch(glare::Exception& e)
+	{
+		failTest(e.what());
+	}
+
+	conPrint("ServerVoiceMixer::test() done.");
+}
+
+
+#endif // BUILD_TESTS
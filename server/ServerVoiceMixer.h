@@ -0,0 +1,198 @@
+/*=====================================================================
+ServerVoiceMixer.h
+------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <ThreadSafeRefCounted.h>
+#include <Reference.h>
+#include <Mutex.h>
+#include <TaskManager.h>
+#include <MessageableThread.h>
+#include <UDPSocket.h>
+#include <IPAddress.h>
+#include <AtomicInt.h>
+#include <vec3.h>
+#include <vector>
+#include <deque>
+#include <map>
+class ServerWorldState;
+struct OpusDecoder;
+struct OpusEncoder;
+
+
+// A connected client, as used for voice routing.  Built by UDPHandlerThread from Server::connected_clients and the avatar positions in the world states.
+struct VoiceClientInfo
+{
+	IPAddress ip_addr;
+	int client_UDP_port; // -1 if not known yet.
+	uint32 avatar_id; // Lower 32 bits of the client avatar UID, as sent in voice packets.
+	const ServerWorldState* world; // World the client avatar is in, or NULL if the avatar wasn't found.  Just used for identifying the world, not dereferenced.
+	Vec3d pos; // Client avatar position.
+	bool server_mixing; // Does the world have WorldSettings::SERVER_VOICE_MIXING_FLAG set?
+};
+
+
+// A square region of a world.  Distant speakers in the same region are mixed together into a single stream.
+struct VoiceRegionKey
+{
+	const ServerWorldState* world;
+	int x, y; // Region coordinates
+
+	bool operator < (const VoiceRegionKey& other) const
+	{
+		if(world != other.world) return world < other.world;
+		if(x != other.x) return x < other.x;
+		return y < other.y;
+	}
+	bool operator == (const VoiceRegionKey& other) const { return world == other.world && x == other.x && y == other.y; }
+};
+
+
+/*=====================================================================
+ServerVoiceMixer
+----------------
+Server voice mixing mode, enabled per world with
+WorldSettings::SERVER_VOICE_MIXING_FLAG.
+
+In this mode, speakers near a listener (in the listener's region or an
+adjacent region) are still forwarded to the listener individually by
+UDPHandlerThread, for full spatial quality.
+
+Packets from speakers that are far from at least one listener are passed to
+addSpeakerPacket().  Every 10 ms, ServerVoiceMixerThread calls mixFrame(),
+which decodes one packet per speaker, mixes the speakers in each region
+together, and re-encodes each region mix with Opus.  Decoding and encoding
+are done on a worker pool.  Each listener is then sent the mixed streams of
+the closest MAX_REGION_STREAMS_PER_LISTENER non-adjacent regions, positioned
+at the average speaker position in each region.
+
+So the number of streams a listener receives is bounded by the number of
+speakers in nearby regions plus MAX_REGION_STREAMS_PER_LISTENER, instead
+of the total number of speakers in the world.
+
+Mixed stream packets have packet type 3, with header:
+type (uint32), region stream id (uint32), sequence number (uint32), position (3 * float)
+followed by Opus data.
+=====================================================================*/
+class ServerVoiceMixer : public ThreadSafeRefCounted
+{
+public:
+	static const int SAMPLE_RATE = 48000; // Speakers are decoded, and region mixes are encoded, at this sampling rate.
+	static const int SAMPLES_PER_FRAME = SAMPLE_RATE / 100; // Clients send 10 ms frames.
+	static constexpr double REGION_WIDTH = 32.0; // Width of regions in metres.
+	static const size_t MAX_REGION_STREAMS_PER_LISTENER = 4;
+	static const size_t MAX_QUEUED_PACKETS_PER_SPEAKER = 4;
+	static const uint32 MIXED_VOICE_PACKET_TYPE = 3;
+	static const size_t MIXED_VOICE_PACKET_HEADER_SIZE = 24;
+
+	ServerVoiceMixer(size_t num_threads);
+	~ServerVoiceMixer();
+
+	static size_t getDefaultNumThreads();
+
+	static VoiceRegionKey getRegionKey(const ServerWorldState* world, const Vec3d& pos);
+
+	// Is the speaker in the listener's region or an adjacent region?  If so the speaker is forwarded to the listener individually.
+	static bool isSpeakerNear(const Vec3d& listener_pos, const Vec3d& speaker_pos);
+
+	static uint32 getRegionStreamID(const VoiceRegionKey& key);
+
+	// Called by UDPHandlerThread
+	void setClients(const std::vector<VoiceClientInfo>& clients);
+	void addSpeakerPacket(const VoiceClientInfo& speaker, const uint8* opus_data, size_t opus_data_len);
+
+	// Called by ServerVoiceMixerThread every 10 ms.
+	void mixFrame();
+	void sendRegionStreams(UDPSocket& socket);
+
+	// Gets the mixed stream packets from the last mixFrame() call that the listener should receive.
+	void getRegionPacketsForListener(const VoiceClientInfo& listener, std::vector<const std::vector<uint8>*>& packets_out);
+
+	std::string getDiagnostics() const;
+
+	static void test();
+
+	glare::AtomicInt num_packets_decoded;
+	glare::AtomicInt num_decode_errors;
+	glare::AtomicInt num_region_packets_encoded;
+	glare::AtomicInt num_region_packets_sent;
+	glare::AtomicInt num_packets_dropped; // Packets dropped because the speaker queue was full.
+
+	struct Speaker : public ThreadSafeRefCounted
+	{
+		Speaker();
+		~Speaker();
+
+		OpusDecoder* opus_decoder;
+		std::deque<std::vector<uint8>> queued_packets; // Protected by ServerVoiceMixer::mutex.
+		VoiceRegionKey region; // Protected by ServerVoiceMixer::mutex.
+		Vec3d pos; // Protected by ServerVoiceMixer::mutex.
+
+		// Only accessed by the mixer thread and decode tasks:
+		std::vector<uint8> cur_packet;
+		std::vector<float> pcm;
+		bool pcm_valid;
+		VoiceRegionKey mix_region;
+		Vec3d mix_pos;
+		int frames_without_packet;
+	};
+
+	struct Region : public ThreadSafeRefCounted
+	{
+		Region();
+		~Region();
+
+		OpusEncoder* opus_encoder;
+		const ServerWorldState* world;
+		uint32 stream_id;
+		uint32 seq_num;
+		std::vector<float> mix;
+		Vec3d pos_sum;
+		int num_speakers;
+		Vec3d pos; // Average position of speakers mixed this frame.
+		std::vector<uint8> packet; // Mixed voice packet encoded this frame, including header.
+		bool packet_valid;
+		int frames_without_speakers;
+	};
+
+private:
+	mutable Mutex mutex;
+	std::map<uint32, Reference<Speaker>> speakers		GUARDED_BY(mutex); // Map from avatar id to speaker.
+	std::vector<VoiceClientInfo> clients				GUARDED_BY(mutex);
+
+	// Only accessed by the mixer thread:
+	std::map<VoiceRegionKey, Reference<Region>> regions;
+	std::vector<Reference<Speaker>> decode_speakers;
+	std::vector<Reference<Region>> encode_regions;
+	std::vector<VoiceClientInfo> temp_clients;
+	std::vector<const std::vector<uint8>*> temp_packets;
+	std::vector<std::pair<double, const Region*>> temp_candidate_regions;
+
+	glare::TaskManager task_manager;
+};
+
+
+/*=====================================================================
+ServerVoiceMixerThread
+----------------------
+Calls ServerVoiceMixer::mixFrame() and sendRegionStreams() every 10 ms.
+Sends on the UDPHandlerThread socket, so clients receive mixed streams from
+the same server port as individual voice packets.
+=====================================================================*/
+class ServerVoiceMixerThread : public MessageableThread
+{
+public:
+	ServerVoiceMixerThread(Reference<ServerVoiceMixer> mixer, Reference<UDPSocket> udp_socket);
+
+	virtual void doRun() override;
+
+	virtual void kill() override { die = 1; }
+
+private:
+	Reference<ServerVoiceMixer> mixer;
+	Reference<UDPSocket> udp_socket;
+	glare::AtomicInt die;
+};
@@ -19,7 +19,12 @@ Generated at 2016-01-12 12:22:34 +1300
 #include <Database.h>
 #include <BufferOutStream.h>
 #include <BufferViewInStream.h>
+#include <PlatformUtils.h>
+#include <Task.h>
+#include <TaskManager.h>
 #include "../shared/LODChunk.h"
+#include "ServerMetrics.h"
+#include "ServerProfiler.h"
 
 
 static const uint32 SERVER_SINGLE_WORLD_STATE_SERIALISATON_VERSION = 1;
@@ -87,6 +92,53 @@ AvatarRef ServerWorldState::createAndInsertAvatarForChatBot(ServerAllWorldsState
 }
 
 
+const ObjectAccountingIndex& ServerWorldState::getObjectAccountingIndex(const ObjectModelStatsMap& model_stats, WorldStateLock& /*world_state_lock*/)
+{
+	if(!object_accounting_index_valid)
+	{
+		Timer timer;
+		object_accounting_index.build(objects, parcels, model_stats);
+		object_accounting_index_valid = true;
+		conPrint("Built object accounting index for " + toString(objects.size()) + " objects (" + timer.elapsedStringNSigFigs(3) + ")");
+	}
+	return object_accounting_index;
+}
+
+
+InitialParcelDataSnapshotRef ServerWorldState::getInitialParcelDataSnapshot(uint32 client_protocol_version, WorldStateLock& /*world_state_lock*/)
+{
+	auto res = initial_parcel_data_snapshots.find(client_protocol_version);
+	if(res != initial_parcel_data_snapshots.end() && res->second->parcels_version == parcels_version)
+		return res->second;
+	else
+		return InitialParcelDataSnapshotRef();
+}
+
+
+void ServerWorldState::setInitialParcelDataSnapshot(uint32 client_protocol_version, InitialParcelDataSnapshotRef snapshot, WorldStateLock& /*world_state_lock*/)
+{
+	// Only store the snapshot if the parcels haven't changed while it was being built.
+	if(snapshot->parcels_version == parcels_version)
+		initial_parcel_data_snapshots[client_protocol_version] = snapshot;
+}
+
+
+const std::set<ParcelID>& ServerWorldState::getParcelsOwnedBy(const UserID& owner_id, WorldStateLock& /*world_state_lock*/)
+{
+	if(parcel_owner_index_version != parcels_version)
+	{
+		parcel_owner_index.clear();
+		for(auto it = parcels.begin(); it != parcels.end(); ++it)
+			parcel_owner_index[it->second->owner_id].insert(it->first);
+		parcel_owner_index_version = parcels_version;
+	}
+
+	static const std::set<ParcelID> empty_set;
+	auto res = parcel_owner_index.find(owner_id);
+	return (res != parcel_owner_index.end()) ? res->second : empty_set;
+}
+
+
 ServerAllWorldsState::ServerAllWorldsState()
 :	lua_vms(/*empty key=*/UserID::invalidUserID())
 {
@@ -178,6 +230,342 @@ static const uint32 USER_SECRET_VERSION = 1;
 static const uint32 MIGRATION_VERSION_CHUNK_VERSION = 1;
 
 
+// A valid record from the database, to be deserialised by a WorldStateLoadTask.
+struct DBRecordToLoad
+{
+	DatabaseKey database_key;
+	const uint8* data; // Points into the database's record data.
+	size_t len;
+};
+
+
+// Loading statistics for a single record (chunk) type.
+struct RecordTypeLoadStats
+{
+	RecordTypeLoadStats() : num_records(0), decode_time(0), merge_time(0) {}
+
+	size_t num_records;
+	double decode_time; // Summed over all loader threads.
+	double merge_time;
+};
+
+static const uint32 MAX_LOADED_CHUNK_TYPE = 128; // All chunk types apart from EOS_CHUNK are less than this.
+
+
+static const char* chunkTypeName(uint32 chunk)
+{
+	switch(chunk)
+	{
+	case WORLD_CHUNK: return "world";
+	case WORLD_SETTINGS_CHUNK: return "world settings";
+	case WORLD_OBJECT_CHUNK: return "object";
+	case USER_CHUNK: return "user";
+	case PARCEL_CHUNK: return "parcel";
+	case RESOURCE_CHUNK: return "resource";
+	case ORDER_CHUNK: return "order";
+	case USER_WEB_SESSION_CHUNK: return "user web session";
+	case PARCEL_AUCTION_CHUNK: return "parcel auction";
+	case SCREENSHOT_CHUNK: return "screenshot";
+	case SUB_ETH_TRANSACTIONS_CHUNK: return "sub eth transaction";
+	case LAST_PARCEL_SALE_UPDATE_CHUNK: return "last parcel sale update";
+	case MAP_TILE_INFO_CHUNK: return "map tile info";
+	case ETH_INFO_CHUNK: return "eth info";
+	case NEWS_POST_CHUNK: return "news post";
+	case FEATURE_FLAG_CHUNK: return "feature flag";
+	case OBJECT_STORAGE_ITEM_CHUNK: return "object storage item";
+	case USER_SECRET_CHUNK: return "user secret";
+	case LOD_CHUNK_CHUNK: return "LOD chunk";
+	case SUB_EVENT_CHUNK: return "event";
+	case MIGRATION_VERSION_CHUNK: return "migration version";
+	case PHOTO_CHUNK: return "photo";
+	case CHATBOT_CHUNK: return "chatbot";
+	case GEAR_ITEM_CHUNK: return "gear item";
+	case API_KEY_CHUNK: return "API key";
+	default: return "unknown";
+	}
+}
+
+
+static ObjectStorageItemRef readObjectStorageItemRecord(RandomAccessInStream& stream)
+{
+	const uint32 item_version = stream.readUInt32();
+	if(item_version != OBJECT_STORAGE_ITEM_VERSION)
+		throw glare::Exception("invalid object storage item version: " + toString(item_version));
+
+	ObjectStorageItemRef item = new ObjectStorageItem();
+
+	// Read key
+	item->key.ob_uid = readUIDFromStream(stream);
+	item->key.key_string = stream.readStringLengthFirst(1000);
+
+	// Read size of data
+	const uint32 data_size = stream.readUInt32();
+	if(data_size > (1 << 16))
+		throw glare::Exception("Invalid object storage data size: " + toString(data_size));
+
+	// Read data
+	item->data.resizeNoCopy(data_size);
+	stream.readData(item->data.data(), data_size);
+	return item;
+}
+
+
+static UserSecretRef readUserSecretRecord(RandomAccessInStream& stream)
+{
+	const uint32 user_secret_version = stream.readUInt32();
+	if(user_secret_version != USER_SECRET_VERSION)
+		throw glare::Exception("invalid user secret version: " + toString(user_secret_version));
+
+	UserSecretRef secret = new UserSecret();
+
+	// Read key
+	secret->key.user_id = readUserIDFromStream(stream);
+	secret->key.secret_name = stream.readStringLengthFirst(UserSecret::MAX_SECRET_NAME_SIZE);
+
+	secret->value = stream.readStringLengthFirst(UserSecret::MAX_VALUE_SIZE);
+	return secret;
+}
+
+
+/*=====================================================================
+WorldStateLoadTask
+------------------
+Deserialises a contiguous range of database records into per-task buffers.
+Doesn't touch ServerAllWorldsState, so doesn't need the world state lock.
+The buffers are merged into the world state maps by ServerAllWorldsState::readFromDisk()
+once all tasks are done, in task order, so records of a given type are merged in database order.
+
+Rare record types that update singleton state (world settings, eth info, map tile info etc.)
+are just collected in serial_records, and deserialised in the merge step.
+=====================================================================*/
+class WorldStateLoadTask : public glare::Task
+{
+public:
+	WorldStateLoadTask() : records(NULL), begin(0), end(0), failed(false) {}
+
+	virtual void run(size_t thread_index) override
+	{
+		try
+		{
+			for(size_t i=begin; i<end; ++i)
+				loadRecord(records[i]);
+		}
+		catch(glare::Exception& e)
+		{
+			failed = true;
+			error_msg = e.what();
+		}
+		catch(std::exception& e) // Catch std::bad_alloc etc.
+		{
+			failed = true;
+			error_msg = std::string("std::exception: ") + e.what();
+		}
+	}
+
+	void loadRecord(const DBRecordToLoad& record)
+	{
+		Timer timer;
+
+		BufferViewInStream stream(ArrayRef<uint8>(record.data, record.len));
+		const uint32 chunk = stream.readUInt32();
+		if(chunk == WORLD_CHUNK)
+		{
+			ServerWorldStateRef world = new ServerWorldState();
+			readServerWorldStateFromStream(stream, *world);
+			world->database_key = record.database_key;
+			worlds.push_back(world);
+		}
+		else if(chunk == WORLD_OBJECT_CHUNK)
+		{
+			const std::string world_name = stream.readStringLengthFirst(10000);
+
+			WorldObjectRef world_ob = new WorldObject();
+			readWorldObjectFromStream(stream, *world_ob);
+
+			//TEMP HACK: clear lightmap needed flag
+			BitUtils::zeroBit(world_ob->flags, WorldObject::LIGHTMAP_NEEDS_COMPUTING_FLAG);
+
+			world_ob->database_key = record.database_key;
+			objects.push_back(std::make_pair(world_name, world_ob));
+		}
+		else if(chunk == USER_CHUNK)
+		{
+			UserRef user = new User();
+			readUserFromStream(stream, *user);
+			user->database_key = record.database_key;
+			users.push_back(user);
+		}
+		else if(chunk == PARCEL_CHUNK)
+		{
+			const std::string world_name = stream.readStringLengthFirst(10000);
+
+			ParcelRef parcel = new Parcel();
+			readFromStream(stream, *parcel);
+			parcel->database_key = record.database_key;
+			parcels.push_back(std::make_pair(world_name, parcel));
+		}
+		else if(chunk == RESOURCE_CHUNK)
+		{
+			ResourceRef resource = new Resource();
+			const uint32 res_version = readFromStream(stream, *resource);
+
+			// Resource serialisation version 3 added serialisation of resource state.  If we are reading a resource before that, just assume it is present on disk,
+			// which is what addResource() used to do.
+			if(res_version < 3)
+				resource->setState(Resource::State_Present);
+
+			resource->database_key = record.database_key;
+			resources.push_back(resource);
+		}
+		else if(chunk == ORDER_CHUNK)
+		{
+			OrderRef order = new Order();
+			readFromStream(stream, *order);
+			order->database_key = record.database_key;
+			orders.push_back(order);
+		}
+		else if(chunk == USER_WEB_SESSION_CHUNK)
+		{
+			UserWebSessionRef session = new UserWebSession();
+			readFromStream(stream, *session);
+			session->database_key = record.database_key;
+			sessions.push_back(session);
+		}
+		else if(chunk == PARCEL_AUCTION_CHUNK)
+		{
+			ParcelAuctionRef auction = new ParcelAuction();
+			readFromStream(stream, *auction);
+			auction->database_key = record.database_key;
+			auctions.push_back(auction);
+		}
+		else if(chunk == SCREENSHOT_CHUNK)
+		{
+			ScreenshotRef shot = new Screenshot();
+			readScreenshotFromStream(stream, *shot);
+			shot->database_key = record.database_key;
+			screenshots.push_back(shot);
+		}
+		else if(chunk == PHOTO_CHUNK)
+		{
+			PhotoRef photo = new Photo();
+			readPhotoFromStream(stream, *photo);
+			photo->database_key = record.database_key;
+			photos.push_back(photo);
+		}
+		else if(chunk == CHATBOT_CHUNK)
+		{
+			const std::string world_name = stream.readStringLengthFirst(10000);
+
+			ChatBotRef chatbot = new ChatBot();
+			readChatBotFromStream(stream, *chatbot);
+			chatbot->database_key = record.database_key;
+			chatbots.push_back(std::make_pair(world_name, chatbot));
+		}
+		else if(chunk == SUB_ETH_TRANSACTIONS_CHUNK)
+		{
+			SubEthTransactionRef trans = new SubEthTransaction();
+			readFromStream(stream, *trans);
+			trans->database_key = record.database_key;
+			sub_eth_transactions.push_back(trans);
+		}
+		else if(chunk == NEWS_POST_CHUNK)
+		{
+			NewsPostRef post = new NewsPost();
+			readNewsPostFromStream(stream, *post);
+			post->database_key = record.database_key;
+			news_posts.push_back(post);
+		}
+		else if(chunk == OBJECT_STORAGE_ITEM_CHUNK)
+		{
+			ObjectStorageItemRef item = readObjectStorageItemRecord(stream);
+			item->database_key = record.database_key;
+			object_storage_items.push_back(item);
+		}
+		else if(chunk == USER_SECRET_CHUNK)
+		{
+			UserSecretRef secret = readUserSecretRecord(stream);
+			secret->database_key = record.database_key;
+			user_secrets.push_back(secret);
+		}
+		else if(chunk == API_KEY_CHUNK)
+		{
+			APIKeyRef key = new APIKey();
+			readFromStream(stream, *key);
+			key->database_key = record.database_key;
+			api_keys.push_back(key);
+		}
+		else if(chunk == LOD_CHUNK_CHUNK)
+		{
+			const std::string world_name = stream.readStringLengthFirst(10000);
+
+			Reference<LODChunk> lod_chunk = new LODChunk();
+			readLODChunkFromStream(stream, *lod_chunk);
+			lod_chunk->database_key = record.database_key;
+			lod_chunks.push_back(std::make_pair(world_name, lod_chunk));
+		}
+		else if(chunk == SUB_EVENT_CHUNK)
+		{
+			SubEventRef event = new SubEvent();
+			readSubEventFromStream(stream, *event);
+			event->database_key = record.database_key;
+			events.push_back(event);
+		}
+		else if(chunk == GEAR_ITEM_CHUNK)
+		{
+			GearItemRef item = new GearItem();
+			readGearItemFromStream(stream, *item);
+			item->database_key = record.database_key;
+			gear_items.push_back(item);
+		}
+		else if(chunk == WORLD_SETTINGS_CHUNK || chunk == ETH_INFO_CHUNK || chunk == FEATURE_FLAG_CHUNK || chunk == LAST_PARCEL_SALE_UPDATE_CHUNK || 
+			chunk == MAP_TILE_INFO_CHUNK || chunk == MIGRATION_VERSION_CHUNK)
+		{
+			serial_records.push_back(record);
+		}
+		else
+		{
+			throw glare::Exception("Unknown chunk type '" + toString(chunk) + "'");
+		}
+
+		RecordTypeLoadStats& type_stats = stats[chunk];
+		type_stats.num_records++;
+		type_stats.decode_time += timer.elapsed();
+	}
+
+	const DBRecordToLoad* records;
+	size_t begin, end;
+
+	std::vector<ServerWorldStateRef> worlds;
+	std::vector<std::pair<std::string, WorldObjectRef>> objects; // (world name, object) pairs
+	std::vector<UserRef> users;
+	std::vector<std::pair<std::string, ParcelRef>> parcels; // (world name, parcel) pairs
+	std::vector<ResourceRef> resources;
+	std::vector<OrderRef> orders;
+	std::vector<UserWebSessionRef> sessions;
+	std::vector<ParcelAuctionRef> auctions;
+	std::vector<ScreenshotRef> screenshots;
+	std::vector<PhotoRef> photos;
+	std::vector<std::pair<std::string, ChatBotRef>> chatbots; // (world name, chatbot) pairs
+	std::vector<SubEthTransactionRef> sub_eth_transactions;
+	std::vector<NewsPostRef> news_posts;
+	std::vector<ObjectStorageItemRef> object_storage_items;
+	std::vector<UserSecretRef> user_secrets;
+	std::vector<APIKeyRef> api_keys;
+	std::vector<std::pair<std::string, Reference<LODChunk>>> lod_chunks; // (world name, LOD chunk) pairs
+	std::vector<SubEventRef> events;
+	std::vector<GearItemRef> gear_items;
+	std::vector<DBRecordToLoad> serial_records; // Records to be deserialised in the merge step, in database order.
+
+	RecordTypeLoadStats stats[MAX_LOADED_CHUNK_TYPE]; // Indexed by chunk type.
+
+	bool failed;
+	std::string error_msg;
+};
+
+
+static const size_t MIN_RECORDS_PER_LOAD_TASK = 4096;
+
+
 void ServerAllWorldsState::readFromDisk(const std::string& path)
 {
 	conPrint("Reading world state from '" + path + "'...");
@@ -221,282 +609,338 @@ void ServerAllWorldsState::readFromDisk(const std::string& path)
 		// Using database
 		database.startReadingFromDisk(path);
 
+		// Gather the valid records, up to any EOS chunk.  Records are deserialised in place from the database's record data.
+		std::vector<DBRecordToLoad> records;
+		records.reserve(database.getRecordMap().size());
 		for(auto it = database.getRecordMap().begin(); it != database.getRecordMap().end(); ++it)
 		{
-			const DatabaseKey database_key = it->first;
 			const Database::RecordInfo& record = it->second;
-
 			if(record.isRecordValid())
 			{
-				BufferViewInStream stream(ArrayRef<uint8>(database.getInitialRecordData(record), record.len));
+				DBRecordToLoad record_to_load;
+				record_to_load.database_key = it->first;
+				record_to_load.data = database.getInitialRecordData(record);
+				record_to_load.len = record.len;
 
-				// Now deserialise from our temp buffer
-				const uint32 chunk = stream.readUInt32();
-				if(chunk == WORLD_CHUNK)
+				if(record_to_load.len >= sizeof(uint32))
 				{
-					ServerWorldStateRef world = new ServerWorldState();
-					readServerWorldStateFromStream(stream, *world);
+					uint32 chunk;
+					std::memcpy(&chunk, record_to_load.data, sizeof(uint32));
+					if(chunk == EOS_CHUNK)
+						break;
+				}
 
-					// See if we have already created this world object while reading a WORLD_OBJECT_CHUNK, PARCEL_CHUNK etc. below
-					auto res = world_states.find(world->details.name);
-					if(res == world_states.end())
-					{
-						// World is not created and inserted into world_states yet:
-						
-						world->database_key = database_key;
+				records.push_back(record_to_load);
+			}
+		}
 
-						setWorldState(/*world name=*/world->details.name, world);
-					}
-					else
-					{
-						// World object has already been created and inserted into world_states.
-						// In this case just copy over the properties we read from disk and the database key.
-						ServerWorldStateRef existing_world = res->second;
-						existing_world->details = world->details;
-						existing_world->database_key = database_key;
-					}
-					
-					num_worlds++;
+		// Deserialise records in parallel.  Each task takes a contiguous range of records.
+		Timer decode_timer;
+		const size_t num_tasks = myClamp<size_t>(records.size() / MIN_RECORDS_PER_LOAD_TASK, 1, PlatformUtils::getNumLogicalProcessors());
+		std::vector<Reference<WorldStateLoadTask>> tasks(num_tasks);
+		{
+			glare::TaskManager task_manager("world state loader", num_tasks);
+			for(size_t i=0; i<num_tasks; ++i)
+			{
+				tasks[i] = new WorldStateLoadTask();
+				tasks[i]->records = records.data();
+				tasks[i]->begin = records.size() * i / num_tasks;
+				tasks[i]->end   = records.size() * (i + 1) / num_tasks;
+				task_manager.addTask(tasks[i].ptr());
+			}
+			task_manager.waitForTasksToComplete();
+		}
+		const double decode_elapsed = decode_timer.elapsed();
+
+		for(size_t i=0; i<num_tasks; ++i)
+			if(tasks[i]->failed)
+				throw glare::Exception(tasks[i]->error_msg);
+
+		// Merge the per-task buffers into the world state.  Merge all records of one type at a time, in task order, so records of a type are merged in database order.
+		Timer merge_timer;
+		RecordTypeLoadStats stats[MAX_LOADED_CHUNK_TYPE];
+		for(size_t i=0; i<num_tasks; ++i)
+			for(uint32 c=0; c<MAX_LOADED_CHUNK_TYPE; ++c)
+			{
+				stats[c].num_records += tasks[i]->stats[c].num_records;
+				stats[c].decode_time += tasks[i]->stats[c].decode_time;
+			}
+
+		Timer timer2;
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->worlds.size(); ++i)
+			{
+				ServerWorldStateRef world = tasks[t]->worlds[i];
+
+				// See if we have already created this world object while merging records with a world name below (can happen when loading from the pre-database format)
+				auto res = world_states.find(world->details.name);
+				if(res == world_states.end())
+				{
+					// World is not created and inserted into world_states yet:
+					setWorldState(/*world name=*/world->details.name, world);
 				}
-				else if(chunk == WORLD_OBJECT_CHUNK)
+				else
 				{
-					// Read world name
-					const std::string world_name = stream.readStringLengthFirst(10000);
+					// World object has already been created and inserted into world_states.
+					// In this case just copy over the properties we read from disk and the database key.
+					ServerWorldStateRef existing_world = res->second;
+					existing_world->details = world->details;
+					existing_world->database_key = world->database_key;
+				}
+				num_worlds++;
+			}
+		stats[WORLD_CHUNK].merge_time = timer2.elapsed();
 
-					// Create ServerWorldState for world name if needed
-					if(world_states.count(world_name) == 0) 
-						setWorldState(/*world name=*/world_name, new ServerWorldState());
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->objects.size(); ++i)
+			{
+				const std::string& world_name = tasks[t]->objects[i].first;
+				const WorldObjectRef& world_ob = tasks[t]->objects[i].second;
 
-					// Deserialise object
-					WorldObjectRef world_ob = new WorldObject();
-					readWorldObjectFromStream(stream, *world_ob);
+				// Create ServerWorldState for world name if needed
+				if(world_states.count(world_name) == 0)
+					setWorldState(/*world name=*/world_name, new ServerWorldState());
 
-					//TEMP HACK: clear lightmap needed flag
-					BitUtils::zeroBit(world_ob->flags, WorldObject::LIGHTMAP_NEEDS_COMPUTING_FLAG);
+				world_states[world_name]->getObjects(lock)[world_ob->uid] = world_ob; // Add to object map
+				num_obs++;
 
-					world_ob->database_key = database_key;
-					world_states[world_name]->getObjects(lock)[world_ob->uid] = world_ob; // Add to object map
-					num_obs++;
+				next_object_uid = UID(myMax(world_ob->uid.value() + 1, next_object_uid.value()));
+			}
+		stats[WORLD_OBJECT_CHUNK].merge_time = timer2.elapsed();
 
-					next_object_uid = UID(myMax(world_ob->uid.value() + 1, next_object_uid.value()));
-				}
-				else if(chunk == USER_CHUNK)
-				{
-					// Deserialise user
-					UserRef user = new User();
-					readUserFromStream(stream, *user);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->users.size(); ++i)
+			{
+				const UserRef& user = tasks[t]->users[i];
+				user_id_to_users[user->id] = user; // Add to user map
+				name_to_users[user->name] = user; // Add to user map
+			}
+		stats[USER_CHUNK].merge_time = timer2.elapsed();
 
-					user->database_key = database_key;
-					user_id_to_users[user->id] = user; // Add to user map
-					name_to_users[user->name] = user; // Add to user map
-				}
-				else if(chunk == PARCEL_CHUNK)
-				{
-					// Read world name
-					const std::string world_name = stream.readStringLengthFirst(10000);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->parcels.size(); ++i)
+			{
+				const std::string& world_name = tasks[t]->parcels[i].first;
+				const ParcelRef& parcel = tasks[t]->parcels[i].second;
 
-					// Create ServerWorldState for world name if needed
-					if(world_states.count(world_name) == 0) 
-						setWorldState(/*world name=*/world_name, new ServerWorldState());
+				// Create ServerWorldState for world name if needed
+				if(world_states.count(world_name) == 0)
+					setWorldState(/*world name=*/world_name, new ServerWorldState());
 
-					// Deserialise parcel
-					ParcelRef parcel = new Parcel();
-					readFromStream(stream, *parcel);
+				world_states[world_name]->getParcels(lock)[parcel->id] = parcel; // Add to parcel map
+				num_parcels++;
+			}
+		stats[PARCEL_CHUNK].merge_time = timer2.elapsed();
 
-					parcel->database_key = database_key;
-					world_states[world_name]->getParcels(lock)[parcel->id] = parcel; // Add to parcel map
-					num_parcels++;
-				}
-				else if(chunk == WORLD_SETTINGS_CHUNK)
-				{
-					// Read world name
-					const std::string world_name = stream.readStringLengthFirst(10000);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->resources.size(); ++i)
+			{
+				this->resource_manager->addResource(tasks[t]->resources[i]);
+				num_resources++;
+			}
+		stats[RESOURCE_CHUNK].merge_time = timer2.elapsed();
 
-					// Create ServerWorldState for world name if needed
-					if(world_states.count(world_name) == 0)
-						setWorldState(/*world name=*/world_name, new ServerWorldState());
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->orders.size(); ++i)
+			{
+				const OrderRef& order = tasks[t]->orders[i];
+				orders[order->id] = order; // Add to order map
 
-					// NOTE: There was a bug with multiple world settings for the same world getting saved to the database.  Resolve ambiguity of which one to use by choosing the setting with the largest database key value.
-					// Use these new settings iff the existing settings are either uninitialised (in which case database_key will be invalid), or the settings we are reading from the DB have a greater key 
-					// value than the existing settings.
-					const bool use_settings = !world_states[world_name]->world_settings.database_key.valid() || (database_key.value() > world_states[world_name]->world_settings.database_key.value());
-					if(use_settings)
-					{	
-						// Deserialise world settings
-						readWorldSettingsFromStream(stream, world_states[world_name]->world_settings);
+				next_order_uid = myMax(order->id + 1, next_order_uid);
+				num_orders++;
+			}
+		stats[ORDER_CHUNK].merge_time = timer2.elapsed();
 
-						world_states[world_name]->world_settings.database_key = database_key;
-					}
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->sessions.size(); ++i)
+			{
+				const UserWebSessionRef& session = tasks[t]->sessions[i];
+				user_web_sessions[session->id] = session; // Add to session map
+				num_sessions++;
+			}
+		stats[USER_WEB_SESSION_CHUNK].merge_time = timer2.elapsed();
 
-					num_world_settings++;
-				}
-				else if(chunk == RESOURCE_CHUNK)
-				{
-					// Deserialise resource
-					ResourceRef resource = new Resource();
-					const uint32 res_version = readFromStream(stream, *resource);
-					
-					// Resource serialisation version 3 added serialisation of resource state.  If we are reading a resource before that, just assume it is present on disk,
-					// which is what addResource() below used to do.
-					if(res_version < 3)
-						resource->setState(Resource::State_Present);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->auctions.size(); ++i)
+			{
+				const ParcelAuctionRef& auction = tasks[t]->auctions[i];
+				parcel_auctions[auction->id] = auction;
+				num_auctions++;
+			}
+		stats[PARCEL_AUCTION_CHUNK].merge_time = timer2.elapsed();
 
-					//conPrint("Loaded resource:\n  URL: '" + resource->URL + "'\n  local_path: '" + resource->getRawLocalPath() + "'\n  owner_id: " + resource->owner_id.toString());
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->screenshots.size(); ++i)
+			{
+				const ScreenshotRef& shot = tasks[t]->screenshots[i];
+				screenshots[shot->id] = shot;
+				num_screenshots++;
+			}
+		stats[SCREENSHOT_CHUNK].merge_time = timer2.elapsed();
 
-					resource->database_key = database_key;
-					this->resource_manager->addResource(resource);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->photos.size(); ++i)
+			{
+				const PhotoRef& photo = tasks[t]->photos[i];
+				photos[photo->id] = photo;
+				num_photos++;
+			}
+		stats[PHOTO_CHUNK].merge_time = timer2.elapsed();
 
-					num_resources++;
-				}
-				else if(chunk == ORDER_CHUNK)
-				{
-					// Deserialise order
-					OrderRef order = new Order();
-					readFromStream(stream, *order);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->chatbots.size(); ++i)
+			{
+				const std::string& world_name = tasks[t]->chatbots[i].first;
+				const ChatBotRef& chatbot = tasks[t]->chatbots[i].second;
 
-					order->database_key = database_key;
-					orders[order->id] = order; // Add to order map
+				// Create ServerWorldState for world name if needed
+				if(world_states.count(world_name) == 0)
+					setWorldState(/*world name=*/world_name, new ServerWorldState());
 
-					next_order_uid = myMax(order->id + 1, next_order_uid);
-					num_orders++;
-				}
-				else if(chunk == USER_WEB_SESSION_CHUNK)
-				{
-					// Deserialise UserWebSession
-					UserWebSessionRef session = new UserWebSession();
-					readFromStream(stream, *session);
+				chatbot->world = world_states[world_name].ptr();
 
-					session->database_key = database_key;
-					user_web_sessions[session->id] = session; // Add to session map
-					num_sessions++;
-				}
-				else if(chunk == PARCEL_AUCTION_CHUNK)
-				{
-					// Deserialise ParcelAuction
-					ParcelAuctionRef auction = new ParcelAuction();
-					readFromStream(stream, *auction);
+				next_chatbot_uid = myMax(chatbot->id + 1, next_chatbot_uid);
 
-					auction->database_key = database_key;
-					parcel_auctions[auction->id] = auction;
-					num_auctions++;
-				}
-				else if(chunk == SCREENSHOT_CHUNK)
-				{
-					// Deserialise Screenshot
-					ScreenshotRef shot = new Screenshot();
-					readScreenshotFromStream(stream, *shot);
+				world_states[world_name]->getChatBots(lock)[chatbot->id] = chatbot;
+				num_chatbots++;
+			}
+		stats[CHATBOT_CHUNK].merge_time = timer2.elapsed();
 
-					shot->database_key = database_key;
-					screenshots[shot->id] = shot;
-					num_screenshots++;
-				}
-				else if(chunk == PHOTO_CHUNK)
-				{
-					// Deserialise Photo
-					PhotoRef photo = new Photo();
-					readPhotoFromStream(stream, *photo);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->sub_eth_transactions.size(); ++i)
+			{
+				const SubEthTransactionRef& trans = tasks[t]->sub_eth_transactions[i];
 
-					photo->database_key = database_key;
-					photos[photo->id] = photo;
-					num_photos++;
-				}
-				else if(chunk == CHATBOT_CHUNK)
-				{
-					// Read world name
-					const std::string world_name = stream.readStringLengthFirst(10000);
+				next_sub_eth_transaction_uid = myMax(trans->id + 1, next_sub_eth_transaction_uid);
 
-					// Create ServerWorldState for world name if needed
-					if(world_states.count(world_name) == 0) 
-						setWorldState(/*world name=*/world_name, new ServerWorldState());
+				sub_eth_transactions[trans->id] = trans;
+				num_sub_eth_transactions++;
+			}
+		stats[SUB_ETH_TRANSACTIONS_CHUNK].merge_time = timer2.elapsed();
 
-					// Deserialise ChatBot
-					ChatBotRef chatbot = new ChatBot();
-					readChatBotFromStream(stream, *chatbot);
-					chatbot->world = world_states[world_name].ptr();
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->news_posts.size(); ++i)
+			{
+				const NewsPostRef& post = tasks[t]->news_posts[i];
+				news_posts[post->id] = post;
+				num_news_posts++;
+			}
+		stats[NEWS_POST_CHUNK].merge_time = timer2.elapsed();
 
-					next_chatbot_uid = myMax(chatbot->id + 1, next_chatbot_uid);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->object_storage_items.size(); ++i)
+			{
+				const ObjectStorageItemRef& item = tasks[t]->object_storage_items[i];
+				object_storage_items[item->key] = item;
+				object_num_storage_items[item->key.ob_uid]++;
+				num_object_storage_items++;
+			}
+		stats[OBJECT_STORAGE_ITEM_CHUNK].merge_time = timer2.elapsed();
 
-					chatbot->database_key = database_key;
-					world_states[world_name]->getChatBots(lock)[chatbot->id] = chatbot;
-					num_chatbots++;
-				}
-				else if(chunk == SUB_ETH_TRANSACTIONS_CHUNK)
-				{
-					// Deserialise SubEthTransaction
-					SubEthTransactionRef trans = new SubEthTransaction();
-					readFromStream(stream, *trans);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->user_secrets.size(); ++i)
+			{
+				const UserSecretRef& secret = tasks[t]->user_secrets[i];
+				user_secrets[secret->key] = secret;
+				num_user_secrets++;
+			}
+		stats[USER_SECRET_CHUNK].merge_time = timer2.elapsed();
 
-					next_sub_eth_transaction_uid = myMax(trans->id + 1, next_sub_eth_transaction_uid);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->api_keys.size(); ++i)
+			{
+				const APIKeyRef& key = tasks[t]->api_keys[i];
+				api_keys[key->key_hash] = key; // Add to API key map
+				num_api_keys++;
+			}
+		stats[API_KEY_CHUNK].merge_time = timer2.elapsed();
 
-					trans->database_key = database_key;
-					sub_eth_transactions[trans->id] = trans;
-					num_sub_eth_transactions++;
-				}
-				else if(chunk == NEWS_POST_CHUNK)
-				{
-					// Deserialise NewsPost
-					NewsPostRef post = new NewsPost();
-					readNewsPostFromStream(stream, *post);
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->lod_chunks.size(); ++i)
+			{
+				const std::string& world_name = tasks[t]->lod_chunks[i].first;
+				const Reference<LODChunk>& lod_chunk = tasks[t]->lod_chunks[i].second;
 
-					post->database_key = database_key;
-					news_posts[post->id] = post;
-					num_news_posts++;
-				}
-				else if(chunk == OBJECT_STORAGE_ITEM_CHUNK)
-				{
-					// Deserialise ObjectStorageItem
-					const uint32 item_version = stream.readUInt32();
-					if(item_version != OBJECT_STORAGE_ITEM_VERSION)
-						throw glare::Exception("invalid object storage item version: " + toString(item_version));
-
-					ObjectStorageItemRef item = new ObjectStorageItem();
-
-					// Read key
-					item->key.ob_uid = readUIDFromStream(stream);
-					item->key.key_string = stream.readStringLengthFirst(1000);
-
-					// Read size of data
-					const uint32 data_size = stream.readUInt32();
-					if(data_size > (1 << 16))
-						throw glare::Exception("Invalid object storage data size: " + toString(data_size));
-
-					// Read data
-					item->data.resizeNoCopy(data_size);
-					stream.readData(item->data.data(), data_size);
-
-					item->database_key = database_key;
-					object_storage_items[item->key] = item;
-					object_num_storage_items[item->key.ob_uid]++;
-					num_object_storage_items++;
-				}
-				else if(chunk == USER_SECRET_CHUNK)
-				{
-					// Deserialise UserSecret
-					const uint32 user_secret_version = stream.readUInt32();
-					if(user_secret_version != USER_SECRET_VERSION)
-						throw glare::Exception("invalid user secret version: " + toString(user_secret_version));
-
-					UserSecretRef secret = new UserSecret();
-
-					// Read key
-					secret->key.user_id = readUserIDFromStream(stream);
-					secret->key.secret_name = stream.readStringLengthFirst(UserSecret::MAX_SECRET_NAME_SIZE);
-					
-					secret->value = stream.readStringLengthFirst(UserSecret::MAX_VALUE_SIZE);
-
-					secret->database_key = database_key;
-					user_secrets[secret->key] = secret;
-					num_user_secrets++;
-				}
-				else if(chunk == API_KEY_CHUNK)
+				// Create ServerWorldState for world name if needed
+				if(world_states.count(world_name) == 0)
+					setWorldState(/*world name=*/world_name, new ServerWorldState());
+
+				world_states[world_name]->getLODChunks(lock)[lod_chunk->coords] = lod_chunk;
+				num_lod_chunks++;
+			}
+		stats[LOD_CHUNK_CHUNK].merge_time = timer2.elapsed();
+
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->events.size(); ++i)
+			{
+				const SubEventRef& event = tasks[t]->events[i];
+				events[event->id] = event;
+				num_events++;
+			}
+		stats[SUB_EVENT_CHUNK].merge_time = timer2.elapsed();
+
+		timer2.reset();
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->gear_items.size(); ++i)
+			{
+				const GearItemRef& item = tasks[t]->gear_items[i];
+
+				next_gear_item_uid = UID(myMax(item->id.value() + 1, next_gear_item_uid.value()));
+
+				gear_items[item->id] = item;
+				num_gear_items++;
+			}
+		stats[GEAR_ITEM_CHUNK].merge_time = timer2.elapsed();
+
+		// Deserialise and merge the remaining record types, in database order.
+		for(size_t t=0; t<num_tasks; ++t)
+			for(size_t i=0; i<tasks[t]->serial_records.size(); ++i)
+			{
+				timer2.reset();
+
+				const DatabaseKey database_key = tasks[t]->serial_records[i].database_key;
+				BufferViewInStream stream(ArrayRef<uint8>(tasks[t]->serial_records[i].data, tasks[t]->serial_records[i].len));
+
+				const uint32 chunk = stream.readUInt32();
+				if(chunk == WORLD_SETTINGS_CHUNK)
 				{
-					// Deserialise APIKey
-					APIKeyRef key = new APIKey();
-					readFromStream(stream, *key);
+					// Read world name
+					const std::string world_name = stream.readStringLengthFirst(10000);
+
+					// Create ServerWorldState for world name if needed
+					if(world_states.count(world_name) == 0)
+						setWorldState(/*world name=*/world_name, new ServerWorldState());
 
-					key->database_key = database_key;
-					api_keys[key->key_hash] = key; // Add to API key map
-					num_api_keys++;
+					// NOTE: There was a bug with multiple world settings for the same world getting saved to the database.  Resolve ambiguity of which one to use by choosing the setting with the largest database key value.
+					// Use these new settings iff the existing settings are either uninitialised (in which case database_key will be invalid), or the settings we are reading from the DB have a greater key 
+					// value than the existing settings.
+					const bool use_settings = !world_states[world_name]->world_settings.database_key.valid() || (database_key.value() > world_states[world_name]->world_settings.database_key.value());
+					if(use_settings)
+					{	
+						// Deserialise world settings
+						readWorldSettingsFromStream(stream, world_states[world_name]->world_settings);
+
+						world_states[world_name]->world_settings.database_key = database_key;
+					}
+
+					num_world_settings++;
 				}
 				else if(chunk == ETH_INFO_CHUNK)
 				{
@@ -535,11 +979,11 @@ void ServerAllWorldsState::readFromDisk(const std::string& path)
 						throw glare::Exception("invalid map_tile_info_version: " + toString(map_tile_info_version));
 
 					const int num_tiles = stream.readInt32();
-					for(int i=0; i<num_tiles; ++i)
+					for(int tile_i=0; tile_i<num_tiles; ++tile_i)
 					{
-						const int x = stream.readInt32();
-						const int y = stream.readInt32();
-						const int z = stream.readInt32();
+						const int tile_x = stream.readInt32();
+						const int tile_y = stream.readInt32();
+						const int tile_z = stream.readInt32();
 
 						TileInfo tile_info;
 						const bool cur_tile_screenshot_non_null = stream.readInt32() != 0;
@@ -555,52 +999,13 @@ void ServerAllWorldsState::readFromDisk(const std::string& path)
 							readScreenshotFromStream(stream, *tile_info.prev_tile_screenshot);
 						}
 
-						map_tile_info.info[Vec3<int>(x, y, z)] = tile_info; // Insert
+						map_tile_info.info[Vec3<int>(tile_x, tile_y, tile_z)] = tile_info; // Insert
 					}
 
 					map_tile_info.database_key = database_key;
 
 					num_tiles_read = num_tiles;
 				}
-				else if(chunk == LOD_CHUNK_CHUNK)
-				{
-					// Read world name
-					const std::string world_name = stream.readStringLengthFirst(10000);
-
-					// Create ServerWorldState for world name if needed
-					if(world_states.count(world_name) == 0)
-						setWorldState(/*world name=*/world_name, new ServerWorldState());
-
-					Reference<LODChunk> lod_chunk = new LODChunk();
-
-					readLODChunkFromStream(stream, *lod_chunk);
-					
-					lod_chunk->database_key = database_key;
-					world_states[world_name]->getLODChunks(lock)[lod_chunk->coords] = lod_chunk;
-					num_lod_chunks++;
-				}
-				else if(chunk == SUB_EVENT_CHUNK)
-				{
-					// Deserialise SubEvent
-					SubEventRef event = new SubEvent();
-					readSubEventFromStream(stream, *event);
-
-					event->database_key = database_key;
-					events[event->id] = event;
-					num_events++;
-				}
-				else if(chunk == GEAR_ITEM_CHUNK)
-				{
-					// Deserialise GearItem
-					GearItemRef item = new GearItem();
-					readGearItemFromStream(stream, *item);
-
-					next_gear_item_uid = UID(myMax(item->id.value() + 1, next_gear_item_uid.value()));
-
-					item->database_key = database_key;
-					gear_items[item->id] = item;
-					num_gear_items++;
-				}
 				else if(chunk == MIGRATION_VERSION_CHUNK)
 				{
 					const uint32 chunk_version = stream.readInt32();
@@ -611,16 +1016,15 @@ void ServerAllWorldsState::readFromDisk(const std::string& path)
 
 					this->migration_version_info.database_key = database_key;
 				}
-				else if(chunk == EOS_CHUNK)
-				{
-					break;
-				}
-				else
-				{
-					throw glare::Exception("Unknown chunk type '" + toString(chunk) + "'");
-				}
+
+				stats[chunk].merge_time += timer2.elapsed();
 			}
-		}
+
+		conPrint("Deserialised " + toString(records.size()) + " record(s) with " + toString(num_tasks) + " thread(s) in " + doubleToStringNSigFigs(decode_elapsed, 4) + " s, merged in " + merge_timer.elapsedStringNSigFigs(4));
+		for(uint32 c=0; c<MAX_LOADED_CHUNK_TYPE; ++c)
+			if(stats[c].num_records > 0)
+				conPrint("    " + std::string(chunkTypeName(c)) + ": " + toString(stats[c].num_records) + " record(s), decode: " + doubleToStringNSigFigs(stats[c].decode_time, 4) + " s (thread time), merge: " + 
+					doubleToStringNSigFigs(stats[c].merge_time, 4) + " s");
 
 
 		database.finishReadingFromDisk();
@@ -1269,6 +1673,8 @@ void ServerAllWorldsState::saveSanitisedDatabase()
 // Write any changed data (objects in dirty set) to disk.  Mutex should be held already.
 void ServerAllWorldsState::serialiseToDisk(WorldStateLock& lock)
 {
+	SERVER_PROFILE_ZONE("serialiseToDisk");
+
 	conPrint("Saving world state to disk...");
 
 	Timer timer;
@@ -1860,6 +2266,8 @@ void ServerAllWorldsState::serialiseToDisk(WorldStateLock& lock)
 		removeSuffixInPlace(msg, ", ");
 		msg += " in " + timer.elapsedStringNSigFigs(4);
 		conPrint(msg);
+
+		ServerMetrics::get().serialise_to_disk->recordSeconds(timer.elapsed());
 	}
 	catch(FileUtils::FileUtilsExcep& e)
 	{
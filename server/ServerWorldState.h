@@ -28,6 +28,7 @@ Copyright Glare Technologies Limited 2024 -
 #include "Photo.h"
 #include "ChatBot.h"
 #include "SubEthTransaction.h"
+#include "ObjectAccountingIndex.h"
 #include "../shared/RateLimiter.h"
 #include <ThreadSafeRefCounted.h>
 #include <Platform.h>
@@ -37,6 +38,8 @@ Copyright Glare Technologies Limited 2024 -
 #include <SimpleCredentials.h>
 #include <HashMap.h>
 #include <map>
+#include <set>
+#include <limits>
 #include <unordered_set>
 class ServerWorldState;
 class ServerAllWorldsState;
@@ -211,6 +214,17 @@ struct UserSecretRefHash
 };
 
 
+// Prebuilt parcel data for a world, as sent to a newly connected client in sendPerWorldInitialDataToClient().
+// Either a ParcelInitialSendCompressed message, or a sequence of ParcelCreated messages for older clients.
+// Immutable once built, so can be shared between worker threads and sent without holding the world state mutex.
+struct InitialParcelDataSnapshot : public ThreadSafeRefCounted
+{
+	uint64 parcels_version; // ServerWorldState parcels version when the snapshot was built.
+	js::Vector<uint8, 16> data;
+};
+typedef Reference<InitialParcelDataSnapshot> InitialParcelDataSnapshotRef;
+
+
 /*=====================================================================
 ServerWorldState
 ----------------
@@ -223,10 +237,10 @@ members private and having accessor methods that take a WorldStateLock argument.
 class ServerWorldState : public ThreadSafeRefCounted
 {
 public:
-	ServerWorldState() : db_dirty(false) {}
+	ServerWorldState() : db_dirty(false), object_accounting_index_valid(false), parcels_version(0), parcel_owner_index_version(std::numeric_limits<uint64>::max()) {}
 
-	void addParcelAsDBDirty     (const ParcelRef parcel,  WorldStateLock& /*world_state_lock*/) { db_dirty_parcels.insert(parcel); }
-	void addWorldObjectAsDBDirty(const WorldObjectRef ob, WorldStateLock& /*world_state_lock*/) { db_dirty_world_objects.insert(ob); }
+	void addParcelAsDBDirty     (const ParcelRef parcel,  WorldStateLock& /*world_state_lock*/) { db_dirty_parcels.insert(parcel); parcels_version++; }
+	void addWorldObjectAsDBDirty(const WorldObjectRef ob, WorldStateLock& /*world_state_lock*/) { db_dirty_world_objects.insert(ob); ob->invalidateNetworkSerialisationCache(); }
 	void addLODChunkAsDBDirty   (const LODChunkRef ob,    WorldStateLock& /*world_state_lock*/) { db_dirty_lod_chunks.insert(ob); }
 	void addChatBotAsDBDirty    (const ChatBotRef ob,     WorldStateLock& /*world_state_lock*/) { db_dirty_chatbots.insert(ob); }
 
@@ -262,6 +276,25 @@ public:
 	std::unordered_set<ChatBotRef, ChatBotRefHash>&         getDBDirtyChatBots(WorldStateLock& /*world_state_lock*/) { return db_dirty_chatbots; }
 
 	AvatarRef createAndInsertAvatarForChatBot(ServerAllWorldsState* all_world_state, const ChatBot* chatbot, WorldStateLock& /*world_state_lock*/);
+
+	// Per-parcel object sets and per-owner usage totals.  Built on first use, then kept up to date incrementally with updateObjectAccounting()
+	// as objects are created, changed and deleted.  Rebuilt on next use after invalidateObjectAccountingIndex() is called, which should be done when parcel geometry changes.
+	const ObjectAccountingIndex& getObjectAccountingIndex(const ObjectModelStatsMap& model_stats, WorldStateLock& world_state_lock);
+	void updateObjectAccounting(const WorldObject& ob, const ObjectModelStatsMap& model_stats, WorldStateLock& /*world_state_lock*/)
+		{ if(object_accounting_index_valid) object_accounting_index.updateObject(ob, parcels, model_stats); }
+	void invalidateObjectAccountingIndex(WorldStateLock& /*world_state_lock*/) { object_accounting_index_valid = false; }
+
+	// The parcels version is incremented whenever a parcel is changed (by addParcelAsDBDirty()), or markParcelsChanged() is called,
+	// which should be done if parcels are added without being marked as DB dirty.  Used to tell if initial parcel data snapshots are out of date.
+	void markParcelsChanged(WorldStateLock& /*world_state_lock*/) { parcels_version++; }
+	uint64 getParcelsVersion(WorldStateLock& /*world_state_lock*/) const { return parcels_version; }
+
+	// Returns the initial parcel data snapshot for the given client protocol version, or NULL if there isn't one, or it is out of date.
+	InitialParcelDataSnapshotRef getInitialParcelDataSnapshot(uint32 client_protocol_version, WorldStateLock& world_state_lock);
+	void setInitialParcelDataSnapshot(uint32 client_protocol_version, InitialParcelDataSnapshotRef snapshot, WorldStateLock& world_state_lock);
+
+	// Returns the IDs of the parcels owned by the given user.  The owner index is rebuilt on use if the parcels version has changed since it was built.
+	const std::set<ParcelID>& getParcelsOwnedBy(const UserID& owner_id, WorldStateLock& world_state_lock);
 private:
 	ObjectMapType objects;
 	DirtyFromRemoteObjectSetType dirty_from_remote_objects; // TODO: could just use vector for this, and avoid duplicates by checking object dirty flag.
@@ -273,6 +306,15 @@ private:
 	std::unordered_set<ParcelRef, ParcelRefHash>			db_dirty_parcels;
 	std::unordered_set<LODChunkRef, LODChunkRefHash>		db_dirty_lod_chunks;
 	std::unordered_set<ChatBotRef, ChatBotRefHash>			db_dirty_chatbots;
+
+	ObjectAccountingIndex object_accounting_index;
+	bool object_accounting_index_valid;
+
+	uint64 parcels_version;
+	std::map<uint32, InitialParcelDataSnapshotRef> initial_parcel_data_snapshots; // Map from client protocol version to snapshot.
+
+	std::map<UserID, std::set<ParcelID>> parcel_owner_index; // Map from owner ID to IDs of parcels owned by that user.
+	uint64 parcel_owner_index_version; // Parcels version when parcel_owner_index was built.
 };
 
 typedef Reference<ServerWorldState> ServerWorldStateRef;
@@ -443,6 +485,9 @@ public:
 	// Ephemeral state: A cache of object-space AABBs for models, used by the MCP endpoint for object creation.
 	std::map<URLString, js::AABBox> mesh_URL_to_aabb_os GUARDED_BY(mutex);
 
+	// Ephemeral state: triangle counts and file sizes for models that the server has loaded.  Used for per-owner usage accounting, see ObjectAccountingIndex.
+	ObjectModelStatsMap model_URL_to_stats GUARDED_BY(mutex);
+
 	// Sets of objects that should be written to (updated) in the database.
 	std::unordered_set<ResourceRef, ResourceRefHash>					db_dirty_resources				GUARDED_BY(mutex);
 	std::unordered_set<SubEthTransactionRef, SubEthTransactionRefHash>	db_dirty_sub_eth_transactions	GUARDED_BY(mutex);
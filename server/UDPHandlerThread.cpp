@@ -39,6 +39,9 @@ void UDPHandlerThread::doRun()
 
 		conPrint("UDPHandlerThread: Bound to port " + toString(server_UDP_port));
 
+		voice_mixer = new ServerVoiceMixer(ServerVoiceMixer::getDefaultNumThreads());
+		voice_mixer_thread_manager.addThread(new ServerVoiceMixerThread(voice_mixer, udp_socket));
+
 		std::vector<uint8> packet_buf(4096);
 		uint64 num_packets_rcvd = 0;
 
@@ -58,30 +61,10 @@ void UDPHandlerThread::doRun()
 				std::memcpy(&type, packet_buf.data(), 4);
 				if(type == 1) // If packet has voice type:
 				{
-					if(server->connected_clients_changed != 0)
-					{
-						// Rebuild our connected_clients vector.
-						connected_clients.clear();
-
-						{
-							Lock lock(server->connected_clients_mutex);
-
-							for(auto it = server->connected_clients.begin(); it != server->connected_clients.end(); ++it)
-								if(it->second.client_UDP_port > 0) // If remote UDP port is known:
-									connected_clients.push_back(ConnectedClientInfo({it->second.ip_addr, it->second.client_UDP_port}));
-
-							server->connected_clients_changed = 0;
-						}
-					}
+					if(server->connected_clients_changed != 0 || server->voice_avatar_positions_changed != 0)
+						updateVoiceClients();
 
-					// Broadcast packet to clients
-					for(size_t i=0; i<connected_clients.size(); ++i)
-					{
-						if(num_packets_rcvd % 512 == 0) // Log occasional packets:
-							conPrint("UDPHandlerThread: Sending packet to " + connected_clients[i].ip_addr.toString() + ", port " + toString(connected_clients[i].client_UDP_port) + " ...");
-
-						udp_socket->sendPacket(packet_buf.data(), packet_len, connected_clients[i].ip_addr, connected_clients[i].client_UDP_port);
-					}
+					handleVoicePacket(packet_buf.data(), packet_len, /*log_packet=*/num_packets_rcvd % 512 == 0);
 				}
 				else if(type == 2) // If packet is a discorvery UDP packet:
 				{
@@ -105,12 +88,111 @@ void UDPHandlerThread::doRun()
 		conPrint("UDPHandlerThread: Caught std::bad_alloc.");
 	}
 
+	voice_mixer_thread_manager.killThreadsBlocking();
+	voice_mixer = NULL;
+
 	udp_socket = NULL;
 
 	conPrint("UDPHandlerThread: terminating.");
 }
 
 
+// Rebuild voice_clients from the server connected clients, and look up the world and position of each client avatar in a server voice mixing world.
+// Avatar positions are passed to us by the main server loop, so we don't need to take the world state lock.
+void UDPHandlerThread::updateVoiceClients()
+{
+	voice_clients.clear();
+	{
+		Lock lock(server->connected_clients_mutex);
+
+		for(auto it = server->connected_clients.begin(); it != server->connected_clients.end(); ++it)
+			if(it->second.client_UDP_port > 0) // If remote UDP port is known:
+			{
+				VoiceClientInfo info;
+				info.ip_addr = it->second.ip_addr;
+				info.client_UDP_port = it->second.client_UDP_port;
+				info.avatar_id = (uint32)it->second.client_avatar_id.value();
+				info.world = NULL;
+				info.pos = Vec3d(0.0);
+				info.server_mixing = false;
+				voice_clients.push_back(info);
+			}
+
+		server->connected_clients_changed = 0;
+	}
+
+	avatar_id_to_client_index.clear();
+	for(size_t i=0; i<voice_clients.size(); ++i)
+		avatar_id_to_client_index[voice_clients[i].avatar_id] = i;
+
+	{
+		Lock lock(server->voice_avatar_positions_mutex);
+
+		server->voice_avatar_positions_changed = 0;
+
+		for(size_t i=0; i<server->voice_avatar_positions.size(); ++i)
+		{
+			const VoiceAvatarPosition& voice_pos = server->voice_avatar_positions[i];
+			auto res = avatar_id_to_client_index.find(voice_pos.avatar_id);
+			if(res != avatar_id_to_client_index.end())
+			{
+				VoiceClientInfo& info = voice_clients[res->second];
+				info.world = voice_pos.world;
+				info.pos = voice_pos.pos;
+				info.server_mixing = true;
+			}
+		}
+	}
+
+	voice_mixer->setClients(voice_clients);
+}
+
+
+void UDPHandlerThread::handleVoicePacket(const uint8* packet, size_t packet_len, bool log_packet)
+{
+	const VoiceClientInfo* speaker = NULL;
+	if(packet_len >= 12) // type, avatar id, sequence number
+	{
+		uint32 speaker_avatar_id;
+		std::memcpy(&speaker_avatar_id, packet + 4, 4);
+		auto res = avatar_id_to_client_index.find(speaker_avatar_id);
+		if(res != avatar_id_to_client_index.end())
+			speaker = &voice_clients[res->second];
+	}
+
+	if(speaker && speaker->server_mixing && speaker->world)
+	{
+		// Forward the packet only to listeners near the speaker.  If there are any listeners in the world further away, pass the packet to the mixer.
+		bool have_far_listener = false;
+		for(size_t i=0; i<voice_clients.size(); ++i)
+		{
+			const VoiceClientInfo& listener = voice_clients[i];
+			if(listener.world != speaker->world)
+				continue;
+
+			if(ServerVoiceMixer::isSpeakerNear(listener.pos, speaker->pos))
+				udp_socket->sendPacket(packet, packet_len, listener.ip_addr, listener.client_UDP_port);
+			else
+				have_far_listener = true;
+		}
+
+		if(have_far_listener)
+			voice_mixer->addSpeakerPacket(*speaker, packet + 12, packet_len - 12);
+	}
+	else
+	{
+		// Broadcast packet to clients
+		for(size_t i=0; i<voice_clients.size(); ++i)
+		{
+			if(log_packet)
+				conPrint("UDPHandlerThread: Sending packet to " + voice_clients[i].ip_addr.toString() + ", port " + toString(voice_clients[i].client_UDP_port) + " ...");
+
+			udp_socket->sendPacket(packet, packet_len, voice_clients[i].ip_addr, voice_clients[i].client_UDP_port);
+		}
+	}
+}
+
+
 void UDPHandlerThread::kill()
 {
 	Reference<UDPSocket> udp_socket_ = udp_socket;
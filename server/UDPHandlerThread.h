@@ -6,24 +6,25 @@ Copyright Glare Technologies Limited 2023 -
 #pragma once
 
 
+#include "ServerVoiceMixer.h"
 #include <MessageableThread.h>
+#include <ThreadManager.h>
 #include <UDPSocket.h>
 #include <IPAddress.h>
 #include <vector>
+#include <unordered_map>
 class Server;
 
 
-struct ConnectedClientInfo
-{
-	IPAddress ip_addr;
-	int client_UDP_port;
-};
-
-
 /*=====================================================================
 UDPHandlerThread
 ----------------
 Handles UDP messages from clients, sends back to connected clients.
+
+Voice packets are broadcast to all connected clients, unless the speaker is
+in a world with WorldSettings::SERVER_VOICE_MIXING_FLAG set.  In that case
+the packet is only forwarded to listeners near the speaker, and distant
+listeners get the speaker mixed into a region stream by ServerVoiceMixer.
 =====================================================================*/
 class UDPHandlerThread : public MessageableThread
 {
@@ -36,7 +37,15 @@ public:
 	virtual void kill() override;
 
 private:
-	std::vector<ConnectedClientInfo> connected_clients;
+	void updateVoiceClients();
+	void handleVoicePacket(const uint8* packet, size_t packet_len, bool log_packet);
+
+	std::vector<VoiceClientInfo> voice_clients;
+	std::unordered_map<uint32, size_t> avatar_id_to_client_index; // Map from avatar id to index in voice_clients.
+
+	Reference<ServerVoiceMixer> voice_mixer;
+	ThreadManager voice_mixer_thread_manager;
+
 	Reference<UDPSocket> udp_socket;
 	Server* server;
 };
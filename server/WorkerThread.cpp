@@ -14,6 +14,8 @@ Copyright Glare Technologies Limited 2018 -
 #include "MeshLODGenThread.h"
 #include "WorkerThreadUploadPhotoHandling.h"
 #include "BuilderAISession.h"
+#include "ServerMetrics.h"
+#include "ServerProfiler.h"
 #include "../webserver/LoginHandlers.h"
 #include "../shared/Protocol.h"
 #include "../shared/ProtocolStructs.h"
@@ -56,11 +58,15 @@ Copyright Glare Technologies Limited 2018 -
 static const bool VERBOSE = false;
 static const int MAX_STRING_LEN = 10000;
 static const bool CAPTURE_TRACES = false; // If true, records a trace of data read from the socket, for fuzz seeding.
+static const size_t SEND_QUEUE_HIGH_WATERMARK = 64 * 1024 * 1024; // If more than this many bytes are queued or being written to a client, the client is considered over the limit.
+static const size_t SEND_QUEUE_LOW_WATERMARK = 8 * 1024 * 1024; // The client is no longer over the limit once the queued and in-flight bytes drop below this.
+static const double SEND_QUEUE_MAX_TIME_OVER_LIMIT = 30.0; // Clients that stay over the limit for longer than this (in seconds) are disconnected.
 
 
 WorkerThread::WorkerThread(const Reference<SocketInterface>& socket_, Server* server_, bool is_websocket_connection_)
 :	socket(socket_),
 	server(server_),
+	send_queue(SEND_QUEUE_HIGH_WATERMARK, SEND_QUEUE_LOW_WATERMARK, SEND_QUEUE_MAX_TIME_OVER_LIMIT),
 	scratch_packet(SocketBufferOutStream::DontUseNetworkByteOrder),
 	fuzzing(false),
 	write_trace(false),
@@ -75,6 +81,9 @@ WorkerThread::WorkerThread(const Reference<SocketInterface>& socket_, Server* se
 
 WorkerThread::~WorkerThread()
 {
+	// Remove any bytes still in the send queue from the total queued bytes metric.
+	Lock lock(data_to_send_mutex);
+	ServerMetrics::get().client_send_queue_bytes->add(-(int64)send_queue.numQueuedBytes());
 }
 
 
@@ -922,35 +931,96 @@ static void compressWithZstd(const void* src, size_t src_size, int compression_l
 
 // Sends a bunch of data about a particular world to the client.
 // Called when the client connects initially, or when the client changes the current world.
-void WorkerThread::sendPerWorldInitialDataToClient(ServerAllWorldsState* world_state,
-	uint32 client_protocol_version)
+// Builds a snapshot of all parcel data in cur_world_state, and stores it in cur_world_state for use by other clients.
+// Send compressed parcel data if the client is new enough to handle it.
+// As of 3/4/2025, uncompressed parcel data on substrata.info is 308331 B.
+// With zstd compression: 
+// Compressed to size 59929 B with compression level 3, compression took 2.454600064083934 ms
+InitialParcelDataSnapshotRef WorkerThread::buildInitialParcelDataSnapshot(ServerAllWorldsState* world_state, uint32 client_protocol_version)
 {
-	runtimeCheck(cur_world_state.nonNull());
+	SERVER_PROFILE_ZONE("buildInitialParcelDataSnapshot");
 
-	// Send world settings to client
-	{
-		MessageUtils::initPacket(scratch_packet, Protocol::WorldSettingsInitialSendMessage);
+	InitialParcelDataSnapshotRef snapshot = new InitialParcelDataSnapshot();
+
+	SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
+	{ // Lock scope
+		WorldStateLock lock(world_state->mutex);
+		snapshot->parcels_version = cur_world_state->getParcelsVersion(lock);
 
+		for(auto it = cur_world_state->getParcels(lock).begin(); it != cur_world_state->getParcels(lock).end(); ++it)
 		{
-			Lock lock(world_state->mutex);
-			cur_world_state->world_settings.writeToStream(scratch_packet);
+			const Parcel* parcel = it->second.getPointer();
+
+			// Build ParcelCreated message in scratch_packet
+			MessageUtils::initPacket(scratch_packet, Protocol::ParcelCreated);
+			writeParcelToNetworkStream(*parcel, scratch_packet, client_protocol_version);
+			MessageUtils::updatePacketLengthField(scratch_packet);
+
+			packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size()); // Append scratch_packet to packet
 		}
+	} // End lock scope
 
+	const bool send_compressed_parcel_data = client_protocol_version >= 42;
+	if(send_compressed_parcel_data)
+	{
+		// Compress packet to temp_buf.  Done without holding the world state lock.
+		Timer timer;
+		compressWithZstd(/*src=*/packet.buf.data(), /*src size=*/packet.buf.size(), /*compression level=*/ZSTD_CLEVEL_DEFAULT, /*compressed data out=*/m_temp_buf);
+		const double compression_elapsed = timer.elapsed();
+
+		// Initialise ParcelInitialSendCompressed message in scratch_packet
+		MessageUtils::initPacket(scratch_packet, Protocol::ParcelInitialSendCompressed);
+		scratch_packet.writeData(m_temp_buf.data(), m_temp_buf.size()); // Write compressed data to scratch_packet
 		MessageUtils::updatePacketLengthField(scratch_packet);
-		socket->writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
+
+		snapshot->data.resize(scratch_packet.buf.size());
+		if(scratch_packet.buf.size() > 0)
+			std::memcpy(snapshot->data.data(), scratch_packet.buf.data(), scratch_packet.buf.size());
+
+		conPrint("Built " + toString(snapshot->data.size()) + " B ParcelInitialSendCompressed message (compression took " + doubleToStringNSigFigs(compression_elapsed * 1.0e3, 4) + " ms)");
 	}
+	else
+	{
+		snapshot->data.resize(packet.buf.size());
+		if(packet.buf.size() > 0)
+			std::memcpy(snapshot->data.data(), packet.buf.data(), packet.buf.size());
+	}
+
+	{
+		WorldStateLock lock(world_state->mutex);
+		cur_world_state->setInitialParcelDataSnapshot(client_protocol_version, snapshot, lock);
+	}
+
+	return snapshot;
+}
+
+
+void WorkerThread::sendPerWorldInitialDataToClient(ServerAllWorldsState* world_state,
+	uint32 client_protocol_version)
+{
+	SERVER_PROFILE_ZONE("sendPerWorldInitialDataToClient");
+
+	runtimeCheck(cur_world_state.nonNull());
 
-	// Send the current world details (contains world name, owner, description etc. to client)
+	// Send world settings and the current world details (contains world name, owner, description etc.) to client
 	{
-		MessageUtils::initPacket(scratch_packet, Protocol::WorldDetailsInitialSendMessage);
+		SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
 
 		{
 			Lock lock(world_state->mutex);
+
+			MessageUtils::initPacket(scratch_packet, Protocol::WorldSettingsInitialSendMessage);
+			cur_world_state->world_settings.writeToStream(scratch_packet);
+			MessageUtils::updatePacketLengthField(scratch_packet);
+			packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
+
+			MessageUtils::initPacket(scratch_packet, Protocol::WorldDetailsInitialSendMessage);
 			cur_world_state->details.writeToNetworkStream(scratch_packet);
+			MessageUtils::updatePacketLengthField(scratch_packet);
+			packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
 		}
 
-		MessageUtils::updatePacketLengthField(scratch_packet);
-		socket->writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
+		socket->writeData(packet.buf.data(), packet.buf.size());
 	}
 
 
@@ -1021,66 +1091,19 @@ void WorkerThread::sendPerWorldInitialDataToClient(ServerAllWorldsState* world_s
 	}*/
 
 	// Send all current parcel data to client.
-	// Send compressed parcel data if the client is new enough to handle it.
-	// As of 3/4/2025, uncompressed parcel data on substrata.info is 308331 B.
-	// With zstd compression: 
-	// Compressed to size 59929 B with compression level 3, compression took 2.454600064083934 ms
-	const bool send_compressed_parcel_data = client_protocol_version >= 42;
-	if(send_compressed_parcel_data)
-	{
-		SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
-
-		{ // Lock scope
-			WorldStateLock lock(world_state->mutex);
-			for(auto it = cur_world_state->getParcels(lock).begin(); it != cur_world_state->getParcels(lock).end(); ++it)
-			{
-				const Parcel* parcel = it->second.getPointer();
-
-				// Build ParcelCreated message in scratch_packet
-				MessageUtils::initPacket(scratch_packet, Protocol::ParcelCreated);
-				writeParcelToNetworkStream(*parcel, scratch_packet, client_protocol_version);
-				MessageUtils::updatePacketLengthField(scratch_packet);
-
-				packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size()); // Append scratch_packet to packet
-			}
-		} // End lock scope
-
-		// Compress packet to temp_buf
-		Timer timer;
-		compressWithZstd(/*src=*/packet.buf.data(), /*src size=*/packet.buf.size(), /*compression level=*/ZSTD_CLEVEL_DEFAULT, /*compressed data out=*/m_temp_buf);
-		const double compression_elapsed = timer.elapsed();
-
-		// Initialise ParcelInitialSendCompressed message in scratch_packet
-		MessageUtils::initPacket(scratch_packet, Protocol::ParcelInitialSendCompressed);
-		scratch_packet.writeData(m_temp_buf.data(), m_temp_buf.size()); // Write compressed data to scratch_packet
-		MessageUtils::updatePacketLengthField(scratch_packet);
-
-		// Write the ParcelInitialSendCompressed message
-		socket->writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
-		socket->flush();
-		conPrint("Sent " + toString(scratch_packet.getWriteIndex()) + " B ParcelInitialSendCompressed message (compression took " + doubleToStringNSigFigs(compression_elapsed * 1.0e3, 4) + " ms)");
-	}
-	else
+	// The parcel data is prebuilt into a snapshot shared by all clients connecting to the world, and is only rebuilt when parcels change, 
+	// so that lots of clients connecting at once don't each rebuild and recompress the same data.
 	{
-		SocketBufferOutStream packet(SocketBufferOutStream::DontUseNetworkByteOrder);
-
-		{ // Lock scope
+		InitialParcelDataSnapshotRef snapshot;
+		{
 			WorldStateLock lock(world_state->mutex);
-			for(auto it = cur_world_state->getParcels(lock).begin(); it != cur_world_state->getParcels(lock).end(); ++it)
-			{
-				const Parcel* parcel = it->second.getPointer();
-
-				// Send ParcelCreated message
-				MessageUtils::initPacket(scratch_packet, Protocol::ParcelCreated);
-				writeParcelToNetworkStream(*parcel, scratch_packet, client_protocol_version);
-				MessageUtils::updatePacketLengthField(scratch_packet);
+			snapshot = cur_world_state->getInitialParcelDataSnapshot(client_protocol_version, lock);
+		}
 
-				packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
-			}
-		} // End lock scope
+		if(snapshot.isNull())
+			snapshot = buildInitialParcelDataSnapshot(world_state, client_protocol_version);
 
-		// conPrint("Sending total of " + toString(packet.getWriteIndex()) + " B in ParcelCreated messages");
-		socket->writeData(packet.buf.data(), packet.buf.size());
+		socket->writeData(snapshot->data.data(), snapshot->data.size());
 		socket->flush();
 	}
 
@@ -1179,7 +1202,8 @@ void WorkerThread::doRun()
 
 		if(client_protocol_version >= 41) // Sending server_capabilities was added in protocol version 41.
 		{
-			const uint32 server_capabilities = Protocol::OBJECT_TEXTURE_BASISU_SUPPORT | Protocol::TERRAIN_DETAIL_MAPS_BASISU_SUPPORT | Protocol::OPTIMISED_MESH_SUPPORT;
+			const uint32 server_capabilities = Protocol::OBJECT_TEXTURE_BASISU_SUPPORT | Protocol::TERRAIN_DETAIL_MAPS_BASISU_SUPPORT | Protocol::OPTIMISED_MESH_SUPPORT | 
+				Protocol::PHYSICS_SHAPE_SUPPORT;
 			socket->writeUInt32(server_capabilities);
 		}
 
@@ -1320,8 +1344,12 @@ void WorkerThread::doRun()
 				// We don't want to do network writes while holding the data_to_send_mutex.  So copy to temp_data_to_send.
 				{
 					Lock lock(data_to_send_mutex);
-					temp_data_to_send = data_to_send;
-					data_to_send.clear();
+					if(send_queue.shouldDisconnect(Clock::getTimeSinceInit()))
+						throw glare::Exception("Client send queue has been over the limit for too long (client is not reading data fast enough), disconnecting.");
+
+					ServerMetrics::get().client_send_queue_bytes->add(-(int64)send_queue.numQueuedBytes());
+					send_queue.dequeueAll(temp_data_to_send);
+					send_queue.setInFlightBytes(temp_data_to_send.size(), Clock::getTimeSinceInit());
 				}
 
 				if(temp_data_to_send.nonEmpty())
@@ -1329,6 +1357,9 @@ void WorkerThread::doRun()
 					socket->writeData(temp_data_to_send.data(), temp_data_to_send.size());
 					socket->flush();
 					temp_data_to_send.clear();
+
+					Lock lock(data_to_send_mutex);
+					send_queue.setInFlightBytes(0, Clock::getTimeSinceInit());
 				}
 
 
@@ -1362,6 +1393,12 @@ void WorkerThread::doRun()
 
 					socket->readData(msg_buffer.buf.data() + sizeof(uint32) * 2, msg_len - sizeof(uint32) * 2); // Read rest of message, store in msg_buffer.
 
+					SERVER_PROFILE_ZONE("WorkerThread message handler");
+					server_profile_zone.setIntArg("msg_type", msg_type);
+					ZoneValue(msg_type);
+
+					Timer message_handler_timer;
+
 					switch(msg_type)
 					{
 					case Protocol::CyberspaceGoodbye:
@@ -2254,6 +2291,7 @@ void WorkerThread::doRun()
 									{
 										ob->physics_owner_id = physics_owner_id;
 										ob->last_physics_ownership_change_global_time = client_global_time;
+										ob->invalidateNetworkSerialisationCache(); // Physics ownership is serialised, so the cached serialisation is out of date.
 
 										// Consider physics_owner_id ephemeral state, so doesn't need to be written to DB.
 									}
@@ -2329,6 +2367,7 @@ void WorkerThread::doRun()
 										cur_world_state->addWorldObjectAsDBDirty(new_ob, lock);
 										cur_world_state->getDirtyFromRemoteObjects(lock).insert(new_ob);
 										cur_world_state->getObjects(lock).insert(std::make_pair(new_ob->uid, new_ob));
+										cur_world_state->updateObjectAccounting(*new_ob, world_state->model_URL_to_stats, lock);
 
 										markLODChunkAsNeedsRebuildForChangedObject(cur_world_state.ptr(), new_ob.ptr(), lock);
 
@@ -2402,11 +2441,11 @@ void WorkerThread::doRun()
 								const ServerWorldState::ObjectMapType& objects = cur_world_state->getObjects(lock);
 								for(auto it = objects.begin(); it != objects.end(); ++it)
 								{
-									const WorldObject* ob = it->second.getPointer();
+									WorldObject* ob = it->second.getPointer();
 
 									// Build ObjectInitialSend message
 									MessageUtils::initPacket(scratch_packet, Protocol::ObjectInitialSend);
-									ob->writeToNetworkStream(scratch_packet);
+									ob->writeToNetworkStreamCached(scratch_packet);
 									MessageUtils::updatePacketLengthField(scratch_packet);
 
 									temp_buf.writeData(scratch_packet.buf.data(), scratch_packet.buf.size());
@@ -2467,7 +2506,7 @@ void WorkerThread::doRun()
 								const ServerWorldState::ObjectMapType& objects = cur_world_state->getObjects(lock);
 								for(auto it = objects.begin(); it != objects.end(); ++it)
 								{
-									const WorldObject* ob = it->second.ptr();
+									WorldObject* ob = it->second.ptr();
 
 									// See if the object is in any of the cell AABBs
 									bool in_cell = false;
@@ -2482,7 +2521,7 @@ void WorkerThread::doRun()
 									{
 										// Send ObjectInitialSend packet
 										MessageUtils::initPacket(scratch_packet, Protocol::ObjectInitialSend);
-										ob->writeToNetworkStream(scratch_packet);
+										ob->writeToNetworkStreamCached(scratch_packet);
 										MessageUtils::updatePacketLengthField(scratch_packet);
 
 										packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size()); 
@@ -2539,7 +2578,7 @@ void WorkerThread::doRun()
 							chunk_begin_offsets.push_back(0);
 							size_t last_chunk_begin_offset = 0;
 
-							std::vector<const WorldObject*> obs;
+							std::vector<WorldObject*> obs;
 							obs.reserve(16384);
 
 							{ // Lock scope
@@ -2547,7 +2586,7 @@ void WorkerThread::doRun()
 								const ServerWorldState::ObjectMapType& objects = cur_world_state->getObjects(lock);
 								for(auto it = objects.begin(); it != objects.end(); ++it)
 								{
-									const WorldObject* ob = it->second.ptr();
+									WorldObject* ob = it->second.ptr();
 									const Vec4f ob_pos_vec4f = ob->pos.toVec4fPoint();
 									if(ob_pos_vec4f.isFinite() && aabb.contains(ob_pos_vec4f)) // If the object position is valid, and if it's in the query AABB:
 										obs.push_back(ob);
@@ -2571,11 +2610,11 @@ void WorkerThread::doRun()
 
 								for(size_t i=0; i<obs.size(); ++i)
 								{
-									const WorldObject* ob = obs[i];
+									WorldObject* ob = obs[i];
 
 									// Create ObjectInitialSend message, store in scratch_packet
 									MessageUtils::initPacket(scratch_packet, Protocol::ObjectInitialSend);
-									ob->writeToNetworkStream(scratch_packet);
+									ob->writeToNetworkStreamCached(scratch_packet);
 									MessageUtils::updatePacketLengthField(scratch_packet);
 
 									packet.writeData(scratch_packet.buf.data(), scratch_packet.buf.size()); // Append scratch_packet with ObjectInitialSend message to packet.
@@ -3701,6 +3740,7 @@ void WorkerThread::doRun()
 									new_ob->state = WorldObject::State_JustCreated;
 									new_ob->from_remote_other_dirty = true;
 									cur_world_state->getObjects(lock).insert(std::make_pair(new_ob->uid, new_ob));
+									cur_world_state->updateObjectAccounting(*new_ob, world_state->model_URL_to_stats, lock);
 									cur_world_state->addWorldObjectAsDBDirty(new_ob, lock);
 									cur_world_state->getDirtyFromRemoteObjects(lock).insert(new_ob);
 
@@ -3833,6 +3873,16 @@ void WorkerThread::doRun()
 							throw glare::Exception("Unknown message id: " + toString(msg_type));
 						}
 					}
+
+					// Record message handling metrics
+					{
+						const double handler_time = message_handler_timer.elapsed();
+						ServerMetrics& metrics = ServerMetrics::get();
+						metrics.client_message_handler->recordSeconds(handler_time);
+						ServerMetrics::MessageTypeMetrics* type_metrics = metrics.getMessageTypeMetrics(msg_type);
+						type_metrics->num_messages->increment();
+						type_metrics->handler_time_ns->add((uint64)(handler_time * 1.0e9));
+					}
 				}
 				else
 				{
@@ -3926,13 +3976,23 @@ void WorkerThread::enqueueDataToSend(const SocketBufferOutStream& packet) // thr
 
 void WorkerThread::enqueueDataToSend(const ArrayRef<uint8> data) // threadsafe
 {
-	// Append data to data_to_send
+	// Append data to send_queue
+	bool should_disconnect = false;
 	if(!data.empty())
 	{
 		Lock lock(data_to_send_mutex);
-		const size_t write_i = data_to_send.size();
-		data_to_send.resize(write_i + data.size());
-		std::memcpy(&data_to_send[write_i], data.data(), data.size());
+		const double cur_time = Clock::getTimeSinceInit();
+		const size_t prev_queued_bytes = send_queue.numQueuedBytes();
+		send_queue.enqueueMessages(data, cur_time);
+		ServerMetrics::get().client_send_queue_bytes->add((int64)send_queue.numQueuedBytes() - (int64)prev_queued_bytes);
+		should_disconnect = send_queue.shouldDisconnect(cur_time);
+	}
+
+	// If the client has not been reading data fast enough for a while, disconnect it.  The worker thread may be blocked in a socket write, so shut down the socket to unblock it.
+	if(should_disconnect && !should_quit)
+	{
+		conPrint("WorkerThread: client send queue has been over the limit for too long, disconnecting client.");
+		kill();
 	}
 
 	event_fd.notify();
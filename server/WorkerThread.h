@@ -6,6 +6,7 @@ Copyright Glare Technologies Limited 2018 -
 #pragma once
 
 
+#include "ClientSendQueue.h"
 #include "../shared/URLString.h"
 #include <RequestInfo.h>
 #include <MessageableThread.h>
@@ -22,6 +23,7 @@ Copyright Glare Technologies Limited 2018 -
 class Server;
 class ServerAllWorldsState;
 class ServerWorldState;
+struct InitialParcelDataSnapshot;
 class BuilderAISession;
 
 
@@ -43,6 +45,7 @@ public:
 
 	Reference<ServerWorldState> cur_world_state; // World the client is connected to.
 
+	// Data should consist of complete protocol messages.  Pending transform updates for the same UID are superseded by newer ones, see ClientSendQueue.
 	void enqueueDataToSend(const SocketBufferOutStream& packet); // threadsafe
 	void enqueueDataToSend(const ArrayRef<uint8> data); // threadsafe
 
@@ -56,6 +59,7 @@ private:
 	void handleEthBotConnection();
 	void conPrintIfNotFuzzing(const std::string& msg);
 	void sendPerWorldInitialDataToClient(ServerAllWorldsState* world_state, uint32 client_protocol_version);
+	Reference<InitialParcelDataSnapshot> buildInitialParcelDataSnapshot(ServerAllWorldsState* world_state, uint32 client_protocol_version);
 	void enqueuePacketToBroadcast(const SocketBufferOutStream& packet_buffer);
 	void handleBuilderAIUserMessage(UserID client_user_id, const std::string& client_user_name);
 
@@ -64,7 +68,7 @@ private:
 	EventFD event_fd;	
 
 	Mutex data_to_send_mutex;
-	js::Vector<uint8, 16> data_to_send			GUARDED_BY(data_to_send_mutex);
+	ClientSendQueue send_queue					GUARDED_BY(data_to_send_mutex);
 	js::Vector<uint8, 16> temp_data_to_send;
 
 	js::Vector<uint8, 16> m_temp_buf;
@@ -8,6 +8,8 @@ Copyright Glare Technologies Limited 2025 -
 
 #include "ServerWorldState.h"
 #include "Server.h"
+#include "ImageResizing.h"
+#include "PhotoProcessingService.h"
 #include "../webserver/LoginHandlers.h"
 #include "../shared/Protocol.h"
 #include <graphics/jpegdecoder.h>
@@ -150,36 +152,36 @@ void handlePhotoUploadConnection(Reference<SocketInterface> socket, Server* serv
 		// Save photo to path
 		if(!fuzzing) // Don't write to disk while fuzzing
 		{
-			// Make other photo sizes
-			try
+			// Make other photo sizes and save to disk on the photo processing service task manager.
+			// This bounds the CPU used for photo processing when there are lots of uploads at once.
+			Reference<PhotoProcessingJob> job = new PhotoProcessingJob();
+			job->image_data = std::move(data);
+			job->photo_filename = photo_filename;
+			job->random_path_hex_str = random_path_hex_str;
+			job->photo_dir = server->photo_dir;
+
+			if(!server->photo_processing_service || !server->photo_processing_service->trySubmitJob(job))
 			{
-				saveMidSizeAndThumbnailImages(/*src_full_res_screenshot_filename=*/photo_filename, random_path_hex_str, server->photo_dir, data, 
-					/*midsize_filename_out=*/midsize_filename, /*thumbnail_filename_out=*/thumbnail_filename);
-			}
-			catch(glare::Exception& e)
-			{
-				conPrint("handlePhotoUploadConnection: glare::Exception while making thumbnail for photo: " + e.what());
+				conPrint("handlePhotoUploadConnection: photo processing queue is full, rejecting photo.");
 
 				socket->writeUInt32(Protocol::PhotoUploadFailed);
-				socket->writeStringLengthFirst("Server error: failed to make thumbnail for photo.");
+				socket->writeStringLengthFirst("Server is busy processing other photos, please try again later.");
 				socket->flush();
 				return;
 			}
 
-			try
+			// Wait for the job to complete.  This just blocks this connection thread, the processing work is done on the task manager threads.
+			const PhotoProcessingResultRef result = job->result_queue.dequeue();
+			if(!result->succeeded)
 			{
-				// Save original/full resolution photo to disk.  Do this after making other photo sizes, which will check it's a valid JPEG file.
-				FileUtils::writeEntireFile(photo_path, data);
-			}
-			catch(glare::Exception& e)
-			{
-				conPrint("handlePhotoUploadConnection: glare::Exception while saving photo to disk: " + e.what());
-
 				socket->writeUInt32(Protocol::PhotoUploadFailed);
-				socket->writeStringLengthFirst("Server error: failed to save photo.");
+				socket->writeStringLengthFirst(result->error_msg_for_user);
 				socket->flush();
 				return;
 			}
+
+			midsize_filename   = result->midsize_filename;
+			thumbnail_filename = result->thumbnail_filename;
 		}
 
 		conPrint("Saved to disk at " + photo_path);
@@ -268,11 +270,7 @@ void saveMidSizeAndThumbnailImages(const std::string& src_full_res_screenshot_fi
 			const int midsize_height = (int)(1000.0 * (double)im->getMapHeight() / (double)im->getMapWidth());
 
 			// Do the resize
-			Map2DRef resized = im->resizeMidQuality(midsize_width, midsize_height, /*task_manager=*/nullptr);
-			if(!resized)
-				throw glare::Exception("resizeMidQuality failed.");
-			if(!resized.isType<ImageMapUInt8>())
-				throw glare::Exception("resized image was not ImageMapUInt8");
+			ImageMapUInt8Ref resized = ImageResizing::resizeImage(*im.downcast<ImageMapUInt8>(), midsize_width, midsize_height);
 
 			// Save to disk
 			const std::string midsize_filename = "photo_" + random_path_hex_str + "_midsize1000.jpg";
@@ -280,7 +278,7 @@ void saveMidSizeAndThumbnailImages(const std::string& src_full_res_screenshot_fi
 
 			conPrint("Saving resized midsize image to disk at '" + midsize_path + "'...");
 
-			JPEGDecoder::save(resized.downcast<ImageMapUInt8>(), midsize_path, JPEGDecoder::SaveOptions(/*quality=*/95));
+			JPEGDecoder::save(resized, midsize_path, JPEGDecoder::SaveOptions(/*quality=*/95));
 
 			midsize_filename_out = midsize_filename;
 		}
@@ -322,11 +320,7 @@ void saveMidSizeAndThumbnailImages(const std::string& src_full_res_screenshot_fi
 		ImageMapUInt8Ref cropped = im.downcast<ImageMapUInt8>()->cropImage(/*start_x=*/left_right_edge_w, /*start_y=*/top_bottom_edge_w, cropped_w, cropped_h);
 
 		// Do the resize
-		Map2DRef resized = cropped->resizeMidQuality(thumb_width, thumb_height, /*task_manager=*/nullptr);
-		if(!resized)
-			throw glare::Exception("resizeMidQuality failed.");
-		if(!resized.isType<ImageMapUInt8>())
-			throw glare::Exception("resized image was not ImageMapUInt8");
+		ImageMapUInt8Ref resized = ImageResizing::resizeImage(*cropped, thumb_width, thumb_height);
 
 		// Save to disk
 		const std::string thumbnail_filename = "photo_" + random_path_hex_str + "_thumb_" + toString(thumb_width) + "x" + toString(thumb_height) + ".jpg";
@@ -334,7 +328,7 @@ void saveMidSizeAndThumbnailImages(const std::string& src_full_res_screenshot_fi
 
 		conPrint("Saving thumbnail image to disk at '" + thumbnail_path + "'...");
 
-		JPEGDecoder::save(resized.downcast<ImageMapUInt8>(), thumbnail_path, JPEGDecoder::SaveOptions(/*quality=*/95));
+		JPEGDecoder::save(resized, thumbnail_path, JPEGDecoder::SaveOptions(/*quality=*/95));
 
 		thumbnail_filename_out = thumbnail_filename;
 	}
@@ -779,6 +779,7 @@ void WorldCreation::createParcelsAndRoads(Reference<ServerAllWorldsState> world_
 			parcel->build();
 
 			world_state->getRootWorldState()->getParcels(lock)[parcel_id] = parcel;
+			world_state->getRootWorldState()->markParcelsChanged(lock);
 		}
 	}
 
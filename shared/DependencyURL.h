@@ -14,13 +14,14 @@ Copyright Glare Technologies Limited 2021 -
 
 struct DependencyURL
 {
-	explicit DependencyURL() : use_sRGB(true), is_lightmap(false) {}
-	explicit DependencyURL(const URLString& URL_) : URL(URL_), use_sRGB(true), is_lightmap(false) {}
-	explicit DependencyURL(const URLString& URL_, bool use_sRGB_) : URL(URL_), use_sRGB(use_sRGB_), is_lightmap(false) {}
+	explicit DependencyURL() : use_sRGB(true), is_lightmap(false), is_physics_shape(false) {}
+	explicit DependencyURL(const URLString& URL_) : URL(URL_), use_sRGB(true), is_lightmap(false), is_physics_shape(false) {}
+	explicit DependencyURL(const URLString& URL_, bool use_sRGB_) : URL(URL_), use_sRGB(use_sRGB_), is_lightmap(false), is_physics_shape(false) {}
 
 	URLString URL;
 	bool use_sRGB; // for textures.  We keep track of this so we can load e.g. metallic-roughness textures into the OpenGL engine without sRGB.
 	bool is_lightmap; // If this is true, we want to load the texture (when downloaded) as not using mipmaps.
+	bool is_physics_shape; // A precooked physics shape (.joltshape) for a model, built by the server.  Not loaded directly when downloaded, but used by LoadModelTask when loading the model.
 
 	inline bool operator < (const DependencyURL& other) const { return URL < other.URL; }
 };
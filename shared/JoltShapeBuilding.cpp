@@ -0,0 +1,563 @@
+/*=====================================================================
+JoltShapeBuilding.cpp
+---------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "JoltShapeBuilding.h"
+
+
+#include <maths/Matrix4f.h>
+#include <maths/Quat.h>
+#include <utils/Exception.h>
+#include <utils/RuntimeCheck.h>
+#include <utils/FileUtils.h>
+#include <utils/MemMappedFile.h>
+#include <utils/StringUtils.h>
+#include <xxhash.h>
+#include <Jolt/RegisterTypes.h>
+#include <Jolt/Core/Factory.h>
+#include <Jolt/Core/Memory.h>
+#include <Jolt/Core/StreamIn.h>
+#include <Jolt/Core/StreamOut.h>
+#include <Jolt/Physics/Collision/Shape/ConvexHullShape.h>
+#include <Jolt/Physics/Collision/Shape/MeshShape.h>
+#include <tracy/Tracy.hpp>
+#include <cstring>
+
+
+static const uint32 JOLT_SHAPE_RESOURCE_MAGIC_NUMBER = 0x4A53484D;
+static const uint32 JOLT_SHAPE_RESOURCE_VERSION = 1;
+
+#ifdef JPH_VERSION_ID
+static const uint32 JOLT_VERSION_ID = JPH_VERSION_ID;
+#else
+static const uint32 JOLT_VERSION_ID = (JPH_VERSION_MAJOR << 16) | (JPH_VERSION_MINOR << 8) | JPH_VERSION_PATCH;
+#endif
+
+
+void JoltShapeBuilding::initJolt()
+{
+	JPH::RegisterDefaultAllocator();
+
+	JPH::Factory::sInstance = new JPH::Factory();
+
+	JPH::RegisterTypes();
+}
+
+
+inline static Vec4f transformSkinnedVertex(const Vec4f vert_pos, size_t joint_offset_B, size_t weights_offset_B, BatchedMesh::ComponentType joints_component_type, BatchedMesh::ComponentType weights_component_type,
+	const js::Vector<Matrix4f, 16>& joint_matrices, const uint8* src_vertex_data, const size_t vert_size_B, size_t i)
+{
+	// Read joint indices
+	uint32 use_joints[4];
+	if(joints_component_type == BatchedMesh::ComponentType_UInt8)
+	{
+		uint8 joints[4];
+		std::memcpy(joints, &src_vertex_data[i * vert_size_B + joint_offset_B], sizeof(uint8) * 4);
+		for(int z=0; z<4; ++z)
+			use_joints[z] = joints[z];
+	}
+	else
+	{
+		assert(joints_component_type == BatchedMesh::ComponentType_UInt16);
+
+		uint16 joints[4];
+		std::memcpy(joints, &src_vertex_data[i * vert_size_B + joint_offset_B], sizeof(uint16) * 4);
+		for(int z=0; z<4; ++z)
+			use_joints[z] = joints[z];
+	}
+
+	// Read weights
+	float use_weights[4];
+	if(weights_component_type == BatchedMesh::ComponentType_UInt8)
+	{
+		uint8 weights[4];
+		std::memcpy(weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(uint8) * 4);
+		for(int z=0; z<4; ++z)
+			use_weights[z] = weights[z] * (1.0f / 255.f);
+	}
+	else if(weights_component_type == BatchedMesh::ComponentType_UInt16)
+	{
+		uint16 weights[4];
+		std::memcpy(weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(uint16) * 4);
+		for(int z=0; z<4; ++z)
+			use_weights[z] = weights[z] * (1.0f / 65535.f);
+	}
+	else
+	{
+		assert(weights_component_type == BatchedMesh::ComponentType_Float);
+
+		std::memcpy(use_weights, &src_vertex_data[i * vert_size_B + weights_offset_B], sizeof(float) * 4);
+	}
+
+	for(int z=0; z<4; ++z)
+		assert(use_joints[z] < (uint32)joint_matrices.size());
+	
+	return
+		joint_matrices[use_joints[0]] * vert_pos * use_weights[0] + // joint indices should have been bound checked in BatchedMesh::checkValidAndSanitiseMesh()
+		joint_matrices[use_joints[1]] * vert_pos * use_weights[1] + 
+		joint_matrices[use_joints[2]] * vert_pos * use_weights[2] + 
+		joint_matrices[use_joints[3]] * vert_pos * use_weights[3];
+}
+
+
+
+JPH::Ref<JPH::Shape> JoltShapeBuilding::buildShapeForBatchedMesh(const BatchedMesh& mesh, bool build_dynamic_physics_ob, const js::Vector<bool>* create_tris_for_mat)
+{
+	ZoneScoped; // Tracy profiler
+
+	const size_t vert_size_B = mesh.vertexSize();
+	const size_t num_verts = mesh.numVerts();
+	const size_t num_tris = mesh.numIndices() / 3;
+
+	const BatchedMesh::VertAttribute* pos_attr = mesh.findAttribute(BatchedMesh::VertAttribute_Position);
+	if(!pos_attr)
+		throw glare::Exception("Pos attribute not present.");
+	if(!(pos_attr->component_type == BatchedMesh::ComponentType_Float || pos_attr->component_type == BatchedMesh::ComponentType_UInt16))
+		throw glare::Exception("JoltShapeBuilding::buildShapeForBatchedMesh(): Pos attribute must have float or uint16 type.");
+	const size_t pos_offset = pos_attr->offset_B;
+
+
+	// If mesh has joints and weights, take the skinning transform into account.
+	const AnimationData& anim_data = mesh.animation_data;
+
+	const bool use_skin_transforms = mesh.findAttribute(BatchedMesh::VertAttribute_Joints) && mesh.findAttribute(BatchedMesh::VertAttribute_Weights) &&
+		!anim_data.joint_nodes.empty();
+
+	js::Vector<Matrix4f, 16> joint_matrices;
+
+	size_t joint_offset_B, weights_offset_B;
+	BatchedMesh::ComponentType joints_component_type, weights_component_type;
+	joint_offset_B = weights_offset_B = 0;
+	joints_component_type = weights_component_type = BatchedMesh::ComponentType_UInt8;
+	if(use_skin_transforms)
+	{
+		js::Vector<Matrix4f, 16> node_matrices;
+
+		const size_t num_nodes = anim_data.sorted_nodes.size();
+		node_matrices.resizeNoCopy(num_nodes);
+
+		for(size_t n=0; n<anim_data.sorted_nodes.size(); ++n)
+		{
+			const int node_i = anim_data.sorted_nodes[n];
+			runtimeCheck(node_i >= 0 && node_i < (int)anim_data.nodes.size()); // All these indices should have been bound checked in BatchedMesh::readFromData(), check again anyway.
+			const AnimationNodeData& node_data = anim_data.nodes[node_i];
+			const Vec4f trans = node_data.trans;
+			const Quatf rot = node_data.rot;
+			const Vec4f scale = node_data.scale;
+
+			const Matrix4f rot_mat = rot.toMatrix();
+			const Matrix4f TRS(
+				rot_mat.getColumn(0) * copyToAll<0>(scale),
+				rot_mat.getColumn(1) * copyToAll<1>(scale),
+				rot_mat.getColumn(2) * copyToAll<2>(scale),
+				setWToOne(trans));
+
+			runtimeCheck(node_data.parent_index >= -1 && node_data.parent_index < (int)node_matrices.size());
+			const Matrix4f node_transform = (node_data.parent_index == -1) ? TRS : (node_matrices[node_data.parent_index] * TRS);
+			node_matrices[node_i] = node_transform;
+		}
+
+		joint_matrices.resizeNoCopy(anim_data.joint_nodes.size());
+
+		for(size_t i=0; i<anim_data.joint_nodes.size(); ++i)
+		{
+			const int node_i = anim_data.joint_nodes[i];
+			runtimeCheck(node_i >= 0 && node_i < (int)node_matrices.size() && node_i >= 0 && node_i < (int)anim_data.nodes.size());
+			joint_matrices[i] = node_matrices[node_i] * anim_data.nodes[node_i].inverse_bind_matrix;
+		}
+
+		const BatchedMesh::VertAttribute& joints_attr = mesh.getAttribute(BatchedMesh::VertAttribute_Joints);
+		joint_offset_B = joints_attr.offset_B;
+		joints_component_type = joints_attr.component_type;
+		runtimeCheck(joints_component_type == BatchedMesh::ComponentType_UInt8 || joints_component_type == BatchedMesh::ComponentType_UInt16); // See BatchedMesh::checkValidAndSanitiseMesh().
+		runtimeCheck((num_verts - 1) * vert_size_B + joint_offset_B + BatchedMesh::vertAttributeSize(joints_attr) <= mesh.vertex_data.size());
+
+		const BatchedMesh::VertAttribute& weights_attr = mesh.getAttribute(BatchedMesh::VertAttribute_Weights);
+		weights_offset_B = weights_attr.offset_B;
+		weights_component_type = weights_attr.component_type;
+		runtimeCheck(weights_component_type == BatchedMesh::ComponentType_UInt8 || weights_component_type == BatchedMesh::ComponentType_UInt16 || weights_component_type == BatchedMesh::ComponentType_Float); // See BatchedMesh::checkValidAndSanitiseMesh().
+		runtimeCheck((num_verts - 1) * vert_size_B + weights_offset_B + BatchedMesh::vertAttributeSize(weights_attr) <= mesh.vertex_data.size());
+	}
+
+
+	const bool pos_is_float = pos_attr->component_type == BatchedMesh::ComponentType_Float;
+	const Vec4f dequantisation_scale = div(mesh.aabb_os.span(), Vec4f(65535.f));
+
+	if(build_dynamic_physics_ob)
+	{
+		// Jolt doesn't support dynamic triangles mesh shapes, so we need to convert it to a convex hull shape.
+		JPH::Array<JPH::Vec3> points(num_verts);
+
+		const uint8* src_vertex_data = mesh.vertex_data.data();
+		for(size_t i = 0; i < num_verts; ++i)
+		{
+			Vec4f vert_pos(1.f);
+			if(pos_is_float)
+				std::memcpy(&vert_pos, src_vertex_data + pos_offset + i * vert_size_B, sizeof(::Vec3f));
+			else
+			{
+				uint16 vals[3];
+				std::memcpy(vals, src_vertex_data + pos_offset + i * vert_size_B, sizeof(uint16) * 3);
+				vert_pos = mesh.aabb_os.min_ + dequantisation_scale * Vec4f((float)vals[0], (float)vals[1], (float)vals[2], 0);
+				assert(vert_pos[3] == 1.f);
+			}
+
+			if(use_skin_transforms)
+				vert_pos = transformSkinnedVertex(vert_pos, joint_offset_B, weights_offset_B, joints_component_type, weights_component_type, joint_matrices, src_vertex_data, vert_size_B, i);
+
+			points[i] = JPH::Vec3(vert_pos[0], vert_pos[1], vert_pos[2]);
+		}
+
+		JPH::Ref<JPH::ConvexHullShapeSettings> hull_shape_settings = new JPH::ConvexHullShapeSettings(
+			points
+		);
+
+		JPH::Result<JPH::Ref<JPH::Shape>> result = hull_shape_settings->Create();
+		if(result.HasError())
+			throw glare::Exception(std::string("Error building Jolt shape: ") + result.GetError().c_str());
+		return result.Get();
+	}
+	else
+	{
+		JPH::VertexList vertex_list(num_verts);
+		JPH::IndexedTriangleList tri_list(num_tris);
+
+		// Copy Vertices
+		const uint8* src_vertex_data = mesh.vertex_data.data();
+		for(size_t i = 0; i < num_verts; ++i)
+		{
+			Vec4f vert_pos(1.f);
+			if(pos_is_float)
+				std::memcpy(&vert_pos, src_vertex_data + pos_offset + i * vert_size_B, sizeof(::Vec3f));
+			else
+			{
+				uint16 vals[3];
+				std::memcpy(vals, src_vertex_data + pos_offset + i * vert_size_B, sizeof(uint16) * 3);
+				vert_pos = mesh.aabb_os.min_ + dequantisation_scale * Vec4f((float)vals[0], (float)vals[1], (float)vals[2], 0);
+				assert(vert_pos[3] == 1.f);
+			}
+
+			if(use_skin_transforms)
+				vert_pos = transformSkinnedVertex(vert_pos, joint_offset_B, weights_offset_B, joints_component_type, weights_component_type, joint_matrices, src_vertex_data, vert_size_B, i);
+
+			vertex_list[i] = JPH::Float3(vert_pos[0], vert_pos[1], vert_pos[2]);
+		}
+
+		// Copy Triangles
+		const BatchedMesh::ComponentType index_type = mesh.index_type;
+
+		const uint8*  const index_data_uint8  = (const uint8* )mesh.index_data.data();
+		const uint16* const index_data_uint16 = (const uint16*)mesh.index_data.data();
+		const uint32* const index_data_uint32 = (const uint32*)mesh.index_data.data();
+
+		unsigned int dest_tri_i = 0;
+		for(size_t b = 0; b < mesh.batches.size(); ++b)
+		{
+			if(!create_tris_for_mat || (mesh.batches[b].material_index >= create_tris_for_mat->size()) || (*create_tris_for_mat)[mesh.batches[b].material_index])
+			{
+				const size_t tri_begin = mesh.batches[b].indices_start / 3;
+				const size_t tri_end   = tri_begin + mesh.batches[b].num_indices / 3;
+				const uint32 mat_index = mesh.batches[b].material_index;
+
+				for(size_t t = tri_begin; t < tri_end; ++t)
+				{
+					uint32 vertex_indices[3];
+					if(index_type == BatchedMesh::ComponentType_UInt8)
+					{
+						vertex_indices[0] = index_data_uint8[t*3 + 0];
+						vertex_indices[1] = index_data_uint8[t*3 + 1];
+						vertex_indices[2] = index_data_uint8[t*3 + 2];
+					}
+					else if(index_type == BatchedMesh::ComponentType_UInt16)
+					{
+						vertex_indices[0] = index_data_uint16[t*3 + 0];
+						vertex_indices[1] = index_data_uint16[t*3 + 1];
+						vertex_indices[2] = index_data_uint16[t*3 + 2];
+					}
+					else if(index_type == BatchedMesh::ComponentType_UInt32)
+					{
+						vertex_indices[0] = index_data_uint32[t*3 + 0];
+						vertex_indices[1] = index_data_uint32[t*3 + 1];
+						vertex_indices[2] = index_data_uint32[t*3 + 2];
+					}
+					else
+					{
+						throw glare::Exception("Invalid index type.");
+					}
+
+					// We store the original material index in the per-triangle user data.
+					// We don't use triangle material index as it's limited to 32 and requires creating PhysicsMaterial objects. 
+					tri_list[dest_tri_i] = JPH::IndexedTriangle(vertex_indices[0], vertex_indices[1], vertex_indices[2], /*inMaterialIndex=*/0, /*inUserData=*/mat_index);
+
+					dest_tri_i++;
+				}
+			}
+		}
+
+		tri_list.resize(dest_tri_i);
+
+		JPH::Ref<JPH::MeshShapeSettings> mesh_body_settings = new JPH::MeshShapeSettings(vertex_list, tri_list);
+		mesh_body_settings->mPerTriangleUserData = true; // We store the original material index in the per-triangle user data.
+
+		JPH::Result<JPH::Ref<JPH::Shape>> result = mesh_body_settings->Create();
+		if(result.HasError())
+			throw glare::Exception(std::string("Error building Jolt shape: ") + result.GetError().c_str());
+		return result.Get();
+	}
+}
+
+
+// Jolt output stream that appends to a std::vector.
+class VectorJoltStreamOut : public JPH::StreamOut
+{
+public:
+	VectorJoltStreamOut(std::vector<uint8>& data_) : data(data_) {}
+
+	virtual void WriteBytes(const void* src, size_t num_bytes) override
+	{
+		const size_t write_i = data.size();
+		data.resize(write_i + num_bytes);
+		if(num_bytes > 0)
+			std::memcpy(&data[write_i], src, num_bytes);
+	}
+
+	virtual bool IsFailed() const override { return false; }
+
+	std::vector<uint8>& data;
+};
+
+
+// Jolt input stream that reads from a buffer.  Reads past the end of the buffer set the failed flag and zero the output.
+class BufferJoltStreamIn : public JPH::StreamIn
+{
+public:
+	BufferJoltStreamIn(const uint8* data_, size_t size_) : data(data_), size(size_), read_i(0), failed(false) {}
+
+	virtual void ReadBytes(void* dest, size_t num_bytes) override
+	{
+		if(failed || num_bytes > size - read_i)
+		{
+			failed = true;
+			std::memset(dest, 0, num_bytes);
+			return;
+		}
+		std::memcpy(dest, data + read_i, num_bytes);
+		read_i += num_bytes;
+	}
+
+	virtual bool IsEOF() const override { return read_i >= size; }
+	virtual bool IsFailed() const override { return failed; }
+
+	const uint8* data;
+	size_t size;
+	size_t read_i;
+	bool failed;
+};
+
+
+void JoltShapeBuilding::serialiseShape(const JPH::Shape& shape, std::vector<uint8>& data_out)
+{
+	VectorJoltStreamOut stream(data_out);
+	JPH::Shape::ShapeToIDMap shape_to_id_map;
+	JPH::Shape::MaterialToIDMap material_to_id_map;
+	shape.SaveWithChildren(stream, shape_to_id_map, material_to_id_map);
+}
+
+
+JPH::Ref<JPH::Shape> JoltShapeBuilding::deserialiseShape(const uint8* data, size_t data_size)
+{
+	BufferJoltStreamIn stream(data, data_size);
+	JPH::Shape::IDToShapeMap id_to_shape_map;
+	JPH::Shape::IDToMaterialMap id_to_material_map;
+	JPH::Shape::ShapeResult result = JPH::Shape::sRestoreWithChildren(stream, id_to_shape_map, id_to_material_map);
+	if(result.HasError())
+		throw glare::Exception(std::string("Error restoring Jolt shape: ") + result.GetError().c_str());
+	if(stream.IsFailed())
+		throw glare::Exception("Error restoring Jolt shape: unexpected end of data");
+	return result.Get();
+}
+
+
+// Shape resource layout:
+// uint32 magic number
+// uint32 resource version
+// uint32 Jolt version
+// uint64 shape data size, followed by shape data (Shape::SaveWithChildren output)
+// uint64 XXH64 hash of shape data
+
+void JoltShapeBuilding::encodeShapeResource(const JPH::Shape& shape, std::vector<uint8>& data_out)
+{
+	std::vector<uint8> shape_data;
+	serialiseShape(shape, shape_data);
+
+	VectorJoltStreamOut stream(data_out);
+	stream.Write(JOLT_SHAPE_RESOURCE_MAGIC_NUMBER);
+	stream.Write(JOLT_SHAPE_RESOURCE_VERSION);
+	stream.Write(JOLT_VERSION_ID);
+	stream.Write((uint64)shape_data.size());
+	stream.WriteBytes(shape_data.data(), shape_data.size());
+	stream.Write((uint64)XXH64(shape_data.data(), shape_data.size(), /*seed=*/1));
+}
+
+
+JPH::Ref<JPH::Shape> JoltShapeBuilding::decodeShapeResource(const uint8* data, size_t data_size)
+{
+	BufferJoltStreamIn stream(data, data_size);
+
+	uint32 magic, version, jolt_version;
+	stream.Read(magic);
+	stream.Read(version);
+	stream.Read(jolt_version);
+	if(stream.IsFailed())
+		throw glare::Exception("Shape resource is too short");
+	if(magic != JOLT_SHAPE_RESOURCE_MAGIC_NUMBER)
+		throw glare::Exception("Invalid shape resource magic number");
+	if(version != JOLT_SHAPE_RESOURCE_VERSION)
+		throw glare::Exception("Unsupported shape resource version " + toString(version));
+	if(jolt_version != JOLT_VERSION_ID)
+		throw glare::Exception("Shape resource was written with a different Jolt version");
+
+	uint64 shape_data_size;
+	stream.Read(shape_data_size);
+	const size_t remaining_size = data_size - stream.read_i;
+	if(stream.IsFailed() || shape_data_size > remaining_size || sizeof(uint64) > remaining_size - shape_data_size)
+		throw glare::Exception("Shape resource is truncated");
+
+	const uint8* shape_data = data + stream.read_i;
+	uint64 stored_hash;
+	std::memcpy(&stored_hash, shape_data + shape_data_size, sizeof(uint64));
+	if(XXH64(shape_data, shape_data_size, /*seed=*/1) != stored_hash)
+		throw glare::Exception("Shape resource checksum mismatch");
+
+	return deserialiseShape(shape_data, shape_data_size);
+}
+
+
+void JoltShapeBuilding::writeShapeResourceToDisk(const JPH::Shape& shape, const std::string& path)
+{
+	std::vector<uint8> data;
+	encodeShapeResource(shape, data);
+
+	try
+	{
+		FileUtils::writeEntireFile(path, (const char*)data.data(), data.size());
+	}
+	catch(FileUtils::FileUtilsExcep& e)
+	{
+		throw glare::Exception(e.what());
+	}
+}
+
+
+JPH::Ref<JPH::Shape> JoltShapeBuilding::readShapeResourceFromDisk(const std::string& path)
+{
+	MemMappedFile file(path);
+	return decodeShapeResource((const uint8*)file.fileData(), file.fileSize());
+}
+
+
+#if BUILD_TESTS
+
+
+#include <dll/include/IndigoMesh.h>
+#include <utils/TestUtils.h>
+#include <utils/ConPrint.h>
+
+
+static BatchedMeshRef makeTestMesh()
+{
+	// Make a mesh with two unit cubes, at x=0 and x=2, using materials 0 and 1.
+	Indigo::Mesh mesh;
+	mesh.num_uv_mappings = 0;
+
+	const unsigned int quad_verts[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+
+	for(unsigned int b=0; b<2; ++b)
+	{
+		const unsigned int v_start = b * 8;
+		for(int i=0; i<8; ++i)
+			mesh.addVertex(Indigo::Vec3f((float)(i & 1) + b * 2.f, (float)((i >> 1) & 1), (float)((i >> 2) & 1)));
+
+		for(int q=0; q<6; ++q)
+		{
+			const unsigned int vertex_indices[]   = { v_start + quad_verts[q][0], v_start + quad_verts[q][1], v_start + quad_verts[q][2] };
+			mesh.addTriangle(vertex_indices, vertex_indices, /*material index=*/b);
+			const unsigned int vertex_indices_2[] = { v_start + quad_verts[q][0], v_start + quad_verts[q][2], v_start + quad_verts[q][3] };
+			mesh.addTriangle(vertex_indices_2, vertex_indices_2, /*material index=*/b);
+		}
+	}
+
+	mesh.endOfModel();
+
+	return BatchedMesh::buildFromIndigoMesh(mesh);
+}
+
+
+void JoltShapeBuilding::test()
+{
+	conPrint("JoltShapeBuilding::test()");
+
+	// Jolt types need to have been registered already (with PhysicsWorld::init() or initJolt()).
+
+	BatchedMeshRef mesh = makeTestMesh();
+
+	for(int dynamic=0; dynamic<2; ++dynamic)
+	{
+		JPH::Ref<JPH::Shape> shape = buildShapeForBatchedMesh(*mesh, /*build_dynamic_physics_ob=*/dynamic != 0);
+		testAssert(shape->GetSubType() == (dynamic ? JPH::EShapeSubType::ConvexHull : JPH::EShapeSubType::Mesh));
+
+		// Test encoding and decoding
+		std::vector<uint8> data;
+		encodeShapeResource(*shape, data);
+
+		JPH::Ref<JPH::Shape> decoded_shape = decodeShapeResource(data.data(), data.size());
+		testAssert(decoded_shape->GetSubType() == shape->GetSubType());
+		testAssert(decoded_shape->GetLocalBounds().mMin == shape->GetLocalBounds().mMin);
+		testAssert(decoded_shape->GetLocalBounds().mMax == shape->GetLocalBounds().mMax);
+
+		std::vector<uint8> shape_data, decoded_shape_data;
+		serialiseShape(*shape, shape_data);
+		serialiseShape(*decoded_shape, decoded_shape_data);
+		testAssert(shape_data == decoded_shape_data);
+
+		// Test that corrupted and truncated data is rejected.
+		for(size_t i=0; i<data.size(); i += myMax<size_t>(1, data.size() / 64))
+		{
+			std::vector<uint8> corrupted = data;
+			corrupted[i] ^= 0x10;
+			try
+			{
+				decodeShapeResource(corrupted.data(), corrupted.size());
+				failTest("Expected exception");
+			}
+			catch(glare::Exception&)
+			{}
+		}
+
+		for(size_t len=0; len<data.size(); len += myMax<size_t>(1, data.size() / 64))
+		{
+			try
+			{
+				decodeShapeResource(data.data(), len);
+				failTest("Expected exception");
+			}
+			catch(glare::Exception&)
+			{}
+		}
+	}
+
+	// Test create_tris_for_mat: only create triangles for the second box.
+	{
+		js::Vector<bool> create_tris_for_mat(2);
+		create_tris_for_mat[0] = false;
+		create_tris_for_mat[1] = true;
+		JPH::Ref<JPH::Shape> shape = buildShapeForBatchedMesh(*mesh, /*build_dynamic_physics_ob=*/false, &create_tris_for_mat);
+		testAssert(shape->GetLocalBounds().mMin.GetX() >= 1.99f);
+	}
+
+	conPrint("JoltShapeBuilding::test() done.");
+}
+
+
+#endif // BUILD_TESTS
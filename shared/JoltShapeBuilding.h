@@ -0,0 +1,59 @@
+/*=====================================================================
+JoltShapeBuilding.h
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include <graphics/BatchedMesh.h>
+#include <utils/Vector.h>
+#include <vector>
+#include <Jolt/Jolt.h>
+#include <Jolt/Physics/Collision/Shape/Shape.h>
+
+
+/*=====================================================================
+JoltShapeBuilding
+-----------------
+Building of Jolt physics shapes for meshes, and serialisation of shapes.
+
+Used by the client (PhysicsWorld, PhysicsShapeCache) and by the server,
+which builds shapes for meshes in MeshLODGenThread so that clients can
+download them instead of building them.
+
+Shape resources (.joltshape files) contain the output of
+Shape::SaveWithChildren, with a header containing the format version and Jolt
+version, and a checksum.  Jolt doesn't guarantee its binary format is stable
+between Jolt versions, so decoding a resource written with a different Jolt
+version fails, and the caller should build the shape itself.
+=====================================================================*/
+namespace JoltShapeBuilding
+{
+
+// Sets the default Jolt allocators and registers Jolt types.  Only needed if PhysicsWorld::init() is not called (e.g. on the server).
+void initJolt();
+
+// If build_dynamic_physics_ob is true, builds a convex hull shape, otherwise builds a mesh shape.
+// create_tris_for_mat: Should physics triangles be created for this material?  If null, triangles will be created.
+// Throws glare::Exception on failure.
+JPH::Ref<JPH::Shape> buildShapeForBatchedMesh(const BatchedMesh& mesh, bool build_dynamic_physics_ob, const js::Vector<bool>* create_tris_for_mat = nullptr);
+
+// Serialise shape (and child shapes) with Shape::SaveWithChildren.  Appends to data_out.
+void serialiseShape(const JPH::Shape& shape, std::vector<uint8>& data_out);
+
+// Throws glare::Exception on failure.
+JPH::Ref<JPH::Shape> deserialiseShape(const uint8* data, size_t data_size);
+
+// Encode as a shape resource (.joltshape file contents).
+void encodeShapeResource(const JPH::Shape& shape, std::vector<uint8>& data_out);
+
+// Decode shape resource.  Throws glare::Exception if the data is invalid, or if it was written with a different format or Jolt version.
+JPH::Ref<JPH::Shape> decodeShapeResource(const uint8* data, size_t data_size);
+
+void writeShapeResourceToDisk(const JPH::Shape& shape, const std::string& path);
+JPH::Ref<JPH::Shape> readShapeResourceFromDisk(const std::string& path);
+
+void test();
+
+} // end namespace JoltShapeBuilding
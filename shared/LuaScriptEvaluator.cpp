@@ -11,6 +11,11 @@ Copyright Glare Technologies Limited 2024 -
 #include "WorldStateLock.h"
 #include "WorldObject.h"
 #include "../server/LuaHTTPRequestManager.h" // For LuaHTTPRequestResult
+#if SERVER
+#include "../server/ServerMetrics.h"
+#include "../server/ServerProfiler.h"
+#include <utils/Timer.h>
+#endif
 #include <utils/Exception.h>
 #include <utils/ConPrint.h>
 #include <utils/StringUtils.h>
@@ -21,11 +26,15 @@ Copyright Glare Technologies Limited 2024 -
 
 // Sets script_evaluator->cur_world_state_lock pointer to the world_state_lock address for the lifetime of the object.
 // This is so functions that are called from lua code can check that we hold the world state lock.
+// On the server, also records the lifetime of the object (the Lua execution time) in ServerMetrics, and as a trace event if a trace capture is running.
 class SetCurWorldStateLockClass
 {
 public:
 	SetCurWorldStateLockClass(LuaScriptEvaluator* script_evaluator_, WorldStateLock& world_state_lock)
 	:	script_evaluator(script_evaluator_)
+#if SERVER
+		, profile_zone("Lua callback")
+#endif
 	{
 		script_evaluator_->cur_world_state_lock = &world_state_lock;
 	}
@@ -33,10 +42,17 @@ public:
 	~SetCurWorldStateLockClass()
 	{
 		script_evaluator->cur_world_state_lock = nullptr;
+#if SERVER
+		ServerMetrics::get().lua_execution->recordSeconds(timer.elapsed());
+#endif
 	}
 
 private:
 	LuaScriptEvaluator* script_evaluator;
+#if SERVER
+	Timer timer;
+	ServerProfileZone profile_zone;
+#endif
 };
 
 
@@ -58,7 +74,8 @@ LuaScriptEvaluator::LuaScriptEvaluator(const Reference<SubstrataLuaVM>& substrat
 	num_obs_event_listening(0),
 	cur_world_state_lock(nullptr)
 {
-	for(int i=0; i<MAX_NUM_TIMERS; ++i)
+	timers.resize(myClamp(substrata_lua_vm->max_num_timers_per_script, 1, MAX_MAX_NUM_TIMERS));
+	for(size_t i=0; i<timers.size(); ++i)
 		timers[i].id = -1;
 
 	LuaScriptOptions options;
@@ -533,6 +550,11 @@ void LuaScriptEvaluator::destroyTimer(int timer_index)
 	// Mark slot as free
 	timers[timer_index].id = -1;
 
+	// Remove timer from the timer queue, if it is still pending.
+	if(substrata_lua_vm->timer_queue)
+		substrata_lua_vm->timer_queue->cancelTimer(timers[timer_index].queue_handle);
+	timers[timer_index].queue_handle = ScriptTimerHandle();
+
 	// Free reference to Lua onTimerEvent function, if valid
 	if(timers[timer_index].onTimerEvent_ref != LUA_NOREF)
 		lua_unref(lua_script->thread_state, timers[timer_index].onTimerEvent_ref); 
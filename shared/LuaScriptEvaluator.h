@@ -9,12 +9,14 @@ Copyright Glare Technologies Limited 2024 -
 #include "UserID.h"
 #include "UID.h"
 #include "ParcelID.h"
+#include "ScriptTimerQueue.h"
 #include <lua/LuaScript.h>
 #include <maths/Vec4f.h>
 #include <utils/RefCounted.h>
 #include <utils/WeakRefCounted.h>
 #include <utils/UniqueRef.h>
 #include <memory>
+#include <vector>
 class SubstrataLuaVM;
 class WorldObject;
 class ServerWorldState;
@@ -83,14 +85,16 @@ public:
 
 	WorldStateLock* cur_world_state_lock; // Non-null if the world state lock is currently held by this thread, null otherwise.
 
-	static const int MAX_NUM_TIMERS = 4;
+	static const int DEFAULT_MAX_NUM_TIMERS = 4;
+	static const int MAX_MAX_NUM_TIMERS = 1024; // Upper limit for SubstrataLuaVM::max_num_timers_per_script.
 
 	struct LuaTimerInfo
 	{
 		int id; // -1 means no timer.
 		int onTimerEvent_ref; // Reference to Lua callback function
+		ScriptTimerHandle queue_handle; // Handle of the timer in the script timer queue, used to cancel it when the timer is destroyed.
 	};
-	LuaTimerInfo timers[MAX_NUM_TIMERS];
+	std::vector<LuaTimerInfo> timers; // Size is the maximum number of timers for this script.
 
 	int next_timer_id;
 
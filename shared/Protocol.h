@@ -251,7 +251,9 @@ const uint32 SENDS_USER_MOVED_CHATBOT_MSGS			= 0x2;//  Does the client send User
 const uint32 OBJECT_TEXTURE_BASISU_SUPPORT			= 0x1;
 const uint32 TERRAIN_DETAIL_MAPS_BASISU_SUPPORT		= 0x2;
 const uint32 OPTIMISED_MESH_SUPPORT					= 0x4;
+const uint32 PHYSICS_SHAPE_SUPPORT					= 0x8; // Server builds precooked physics shapes (version PHYSICS_SHAPE_VERSION) for optimised meshes.
 
 const int OPTIMISED_MESH_VERSION = 3;
+const int PHYSICS_SHAPE_VERSION = 1;
 
 } // end namespace Protocol
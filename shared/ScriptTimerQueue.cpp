@@ -6,6 +6,11 @@ Copyright Glare Technologies Limited 2024 -
 #include "ScriptTimerQueue.h"
 
 
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+
+
 ScriptTimerQueueTimer::ScriptTimerQueueTimer()
 {}
 
@@ -13,43 +18,20 @@ ScriptTimerQueueTimer::ScriptTimerQueueTimer()
 ScriptTimerQueueTimer::ScriptTimerQueueTimer(double tigger_time_) : tigger_time(tigger_time_)/*, valid(true)*/ {}
 
 
-ScriptTimerQueue::ScriptTimerQueue()
-{
-#if 0
-	bucket_max_ttt[0] = 0.03125;
-	bucket_max_ttt[1] = 0.125;
-	bucket_max_ttt[2] = 0.5;
-	bucket_max_ttt[3] = 2;
-	bucket_max_ttt[4] = 8;
-	bucket_max_ttt[5] = 32;
-	bucket_max_ttt[6] = 128;
-	bucket_max_ttt[7] = std::numeric_limits<double>::infinity();
-
-	bucket_min_ttt[0] = 0;
-	bucket_min_ttt[1] = 0.03125;
-	bucket_min_ttt[2] = 0.125;
-	bucket_min_ttt[3] = 0.5;
-	bucket_min_ttt[4] = 2;
-	bucket_min_ttt[5] = 8;
-	bucket_min_ttt[6] = 32;
-	bucket_min_ttt[7] = 128;
-
-	// Initialise buckets
-	for(size_t b=0; b<8; ++b)
-	{
-		TimerQueueBucket& bucket = buckets[b];
+static const uint64 MAX_TICKS_AHEAD = (uint64)1 << 40; // Clamp expiry ticks to at most this far ahead of the current tick, to avoid overflow.
 
-		const size_t initial_num = 1024;
-		bucket.timers.resize(initial_num);
-		bucket.freelist.resize(initial_num);
 
-		for(size_t i=0; i<initial_num; ++i)
-			bucket.timers[i].valid = false;
+ScriptTimerQueue::ScriptTimerQueue(double tick_period_)
+:	tick_period(tick_period_),
+	recip_tick_period(1 / tick_period_),
+	cur_tick(0),
+	next_sequence_num(0),
+	num_pending_timers(0)
+{
+	assert(tick_period > 0);
 
-		for(size_t i=0; i<initial_num; ++i)
-			bucket.freelist[i] = (int)i;
-	}
-#endif
+	for(int i=0; i<NUM_LISTS; ++i)
+		list_heads[i] = -1;
 }
 
 
@@ -58,172 +40,229 @@ ScriptTimerQueue::~ScriptTimerQueue()
 }
 
 
-void ScriptTimerQueue::addTimer(double cur_time, const ScriptTimerQueueTimer& timer)
+// Returns the tick for time t, rounded up or down.  Clamped to [cur_tick, cur_tick + MAX_TICKS_AHEAD].
+uint64 ScriptTimerQueue::tickForTime(double t, bool round_up) const
 {
-	// const double ttt = timer.tigger_time - cur_time; // time-to-trigger
-	// const size_t new_bucket_i = getBucketForTimeToTrigger(ttt);
-	// addTimerToBucket(timer, new_bucket_i);
+	const double tick_f = round_up ? std::ceil(t * recip_tick_period) : std::floor(t * recip_tick_period);
+	if(!(tick_f > (double)cur_tick)) // Written like this to handle NaNs.
+		return cur_tick;
+	if(tick_f >= (double)(cur_tick + MAX_TICKS_AHEAD))
+		return cur_tick + MAX_TICKS_AHEAD;
+	return (uint64)tick_f;
+}
+
 
-	queue.push(timer);
+void ScriptTimerQueue::pushNodeOntoList(int node_i, int list_index)
+{
+	TimerNode& node = nodes[node_i];
+	node.list_index = list_index;
+	node.prev = -1;
+	node.next = list_heads[list_index];
+	if(node.next >= 0)
+		nodes[node.next].prev = node_i;
+	list_heads[list_index] = node_i;
 }
 
 
-void ScriptTimerQueue::update(double cur_time, std::vector<ScriptTimerQueueTimer>& triggered_timers_out)
+void ScriptTimerQueue::unlinkNode(int node_i)
 {
-	triggered_timers_out.resize(0);
+	TimerNode& node = nodes[node_i];
+	assert(node.list_index != FREE_NODE_LIST_INDEX);
 
-#if 1
-	while(!queue.empty() && queue.top().tigger_time <= cur_time)
-	{
-		triggered_timers_out.push_back(queue.top());
-		queue.pop();
-	}
-#else
-	for(size_t b=0; b<8; ++b)
-	{
-		TimerQueueBucket& bucket = buckets[b];
+	if(node.prev >= 0)
+		nodes[node.prev].next = node.next;
+	else
+		list_heads[node.list_index] = node.next;
 
-		const double min_ttt = bucket_min_ttt[b];
+	if(node.next >= 0)
+		nodes[node.next].prev = node.prev;
 
-		const double min_trigger_time = cur_time + min_ttt; // Minimum trigger time for a timer to remain in this bucket.
+	node.prev = node.next = -1;
+}
 
-		for(size_t i=0; i<bucket.timers.size(); ++i)
-		{
-			TimerQueueTimer& timer = bucket.timers[i];
-			if(timer.valid)
-			{
-				const double tt = timer.tigger_time;
-				if(cur_time >= tt)
-				{
-					// Timer has triggered
-					triggered_timers_out.push_back(timer);
 
-					timer.valid = false;
+void ScriptTimerQueue::freeNode(int node_i)
+{
+	TimerNode& node = nodes[node_i];
+	node.list_index = FREE_NODE_LIST_INDEX;
+	node.generation++;
+	node.timer.lua_script_evaluator = WeakReference<LuaScriptEvaluator>(); // Don't keep weak reference alive for a free node.
+	free_node_indices.push_back(node_i);
+	num_pending_timers--;
+}
 
-					// Add to free list
-					bucket.freelist.push_back((int)i);
-				}
-				else
-				{
-					if(tt < min_trigger_time)
-					{
-						const double ttt = tt - cur_time;
-						const size_t new_bucket_i = getBucketForTimeToTrigger(ttt);
-						if(new_bucket_i != b) // Check we don't try and remove and add to same bucket due to numerical issues.
-						{
-							// Remove from this bucket, place in other bucket
-							timer.valid = false;
-
-							// Add to free list
-							bucket.freelist.push_back((int)i);
-
-							addTimerToBucket(timer, new_bucket_i);
-						}
-					}
-				}
-			}
+
+// Put a node (not currently in any list) in the appropriate slot for its expiry tick, relative to cur_tick.
+void ScriptTimerQueue::placeNode(int node_i)
+{
+	const uint64 expiry_tick = nodes[node_i].expiry_tick;
+	if(expiry_tick <= cur_tick)
+	{
+		pushNodeOntoList(node_i, DUE_LIST_INDEX);
+		return;
+	}
+
+	uint64 delta = expiry_tick - cur_tick;
+	for(int level=0; level<NUM_LEVELS; ++level)
+	{
+		if(delta < ((uint64)1 << (LEVEL_BITS * (level + 1))))
+		{
+			const int slot_i = (int)((expiry_tick >> (LEVEL_BITS * level)) & (NUM_SLOTS_PER_LEVEL - 1));
+			pushNodeOntoList(node_i, level * NUM_SLOTS_PER_LEVEL + slot_i);
+			return;
 		}
 	}
-#endif
+
+	// Timer is too far in the future for the top level: place it in the furthest top-level slot.  It will be re-placed when that slot is cascaded.
+	const int top_level = NUM_LEVELS - 1;
+	const uint64 furthest_tick = cur_tick + ((uint64)1 << (LEVEL_BITS * NUM_LEVELS)) - 1;
+	const int slot_i = (int)((furthest_tick >> (LEVEL_BITS * top_level)) & (NUM_SLOTS_PER_LEVEL - 1));
+	pushNodeOntoList(node_i, top_level * NUM_SLOTS_PER_LEVEL + slot_i);
 }
 
-void ScriptTimerQueue::clear()
+
+ScriptTimerHandle ScriptTimerQueue::addTimer(double /*cur_time*/, const ScriptTimerQueueTimer& timer)
 {
-	while(!queue.empty())
-		queue.pop();
+	int node_i;
+	if(!free_node_indices.empty())
+	{
+		node_i = free_node_indices.back();
+		free_node_indices.pop_back();
+	}
+	else
+	{
+		node_i = (int)nodes.size();
+		nodes.push_back(TimerNode());
+		nodes.back().generation = 0;
+	}
+
+	TimerNode& node = nodes[node_i];
+	node.timer = timer;
+	node.expiry_tick = tickForTime(timer.tigger_time, /*round up=*/true);
+	node.sequence_num = next_sequence_num++;
+	num_pending_timers++;
+
+	placeNode(node_i);
+
+	ScriptTimerHandle handle;
+	handle.node_index = node_i;
+	handle.generation = node.generation;
+	return handle;
 }
 
-#if 0
-size_t TimerQueue::numValidTimersInBucket(size_t bucket_i)
+
+bool ScriptTimerQueue::cancelTimer(const ScriptTimerHandle& handle)
 {
-	const TimerQueueBucket& bucket = buckets[bucket_i];
+	if(handle.node_index < 0 || handle.node_index >= (int)nodes.size())
+		return false;
+
+	const TimerNode& node = nodes[handle.node_index];
+	if(node.generation != handle.generation || node.list_index == FREE_NODE_LIST_INDEX)
+		return false;
 
-	size_t num = 0;
-	for(size_t i=0; i<bucket.timers.size(); ++i)
-		if(bucket.timers[i].valid)
-			num++;
-	return num;
+	unlinkNode(handle.node_index);
+	freeNode(handle.node_index);
+	return true;
 }
 
 
-size_t TimerQueue::getBucketForTimeToTrigger(double ttt)
+// Move all timers in the given slot down to lower levels (or the due list).
+void ScriptTimerQueue::cascade(int level, int slot_i)
 {
-	/*
-	0.03125
-	0.125
-	0.5
-	2
-	8
-	32
-	128
-	inf
-	*/
-
-	if(ttt < 2.0)
+	const int list_index = level * NUM_SLOTS_PER_LEVEL + slot_i;
+	int node_i = list_heads[list_index];
+	list_heads[list_index] = -1;
+	while(node_i >= 0)
 	{
-		if(ttt < 0.125)
-		{
-			if(ttt < 0.03125)
-				return 0;
-			else
-				return 1; // < 0.125
-		}
-		else
-		{
-			if(ttt < 0.5)
-				return 2;
-			else
-				return 3; // < 2
-		}
+		const int next = nodes[node_i].next;
+		placeNode(node_i);
+		node_i = next;
 	}
-	else // ttt >= 2
+}
+
+
+void ScriptTimerQueue::moveListToExpired(int list_index)
+{
+	int node_i = list_heads[list_index];
+	list_heads[list_index] = -1;
+	while(node_i >= 0)
+	{
+		expired_nodes.push_back(node_i);
+		node_i = nodes[node_i].next;
+	}
+}
+
+
+bool ScriptTimerQueue::ExpiredNodeComparator::operator() (int a, int b) const
+{
+	const TimerNode& node_a = nodes[a];
+	const TimerNode& node_b = nodes[b];
+	if(node_a.timer.tigger_time != node_b.timer.tigger_time)
+		return node_a.timer.tigger_time < node_b.timer.tigger_time;
+	return node_a.sequence_num < node_b.sequence_num;
+}
+
+
+void ScriptTimerQueue::update(double cur_time, std::vector<ScriptTimerQueueTimer>& triggered_timers_out)
+{
+	triggered_timers_out.resize(0);
+	expired_nodes.resize(0);
+
+	moveListToExpired(DUE_LIST_INDEX);
+
+	const uint64 target_tick = tickForTime(cur_time, /*round up=*/false);
+	while(cur_tick < target_tick)
 	{
-		if(ttt < 32.0)
+		if(num_pending_timers == expired_nodes.size()) // If there are no timers left in the wheel, we can skip straight to the target tick.
 		{
-			if(ttt < 8.0)
-				return 4;
-			else
-				return 5; // < 32
+			cur_tick = target_tick;
+			break;
 		}
-		else
+
+		cur_tick++;
+
+		const int slot_i = (int)(cur_tick & (NUM_SLOTS_PER_LEVEL - 1));
+		if(slot_i == 0) // If level 0 has wrapped around:
 		{
-			if(ttt < 128)
-				return 6;
-			else
-				return 7; // < inf
+			// Cascade timers down from the levels above, until we reach a level that hasn't wrapped around.
+			for(int level=1; level<NUM_LEVELS; ++level)
+			{
+				const int level_slot_i = (int)((cur_tick >> (LEVEL_BITS * level)) & (NUM_SLOTS_PER_LEVEL - 1));
+				cascade(level, level_slot_i);
+				if(level_slot_i != 0)
+					break;
+			}
 		}
+
+		moveListToExpired(/*list index=*/slot_i); // Level 0 slot for this tick
+		moveListToExpired(DUE_LIST_INDEX); // Timers cascaded directly to the due list
 	}
-}
 
+	if(expired_nodes.empty())
+		return;
 
-void TimerQueue::addTimerToBucket(const TimerQueueTimer& timer, size_t new_bucket_i)
-{
-	TimerQueueBucket& new_bucket = buckets[new_bucket_i];
+	std::sort(expired_nodes.begin(), expired_nodes.end(), ExpiredNodeComparator(nodes));
 
-	// Query freelist of bucket
-	if(new_bucket.freelist.empty()) // If there are no free slots in bucket:
+	triggered_timers_out.resize(expired_nodes.size());
+	for(size_t i=0; i<expired_nodes.size(); ++i)
 	{
-		// Expand bucket
-		const size_t old_size = new_bucket.timers.size();
-		const size_t new_num_items = old_size;
-		new_bucket.timers.resize(old_size + new_num_items);
-
-		// Add new slots to freelist
-		const size_t old_freelist_size = new_bucket.freelist.size();
-		new_bucket.freelist.resize(old_freelist_size + new_num_items);
-		for(size_t z=0; z<new_num_items; ++z)
-			new_bucket.freelist[old_freelist_size + z] = (int)(old_size + z);
+		triggered_timers_out[i] = nodes[expired_nodes[i]].timer;
+		freeNode(expired_nodes[i]);
 	}
+}
+
+
+void ScriptTimerQueue::clear()
+{
+	for(int i=0; i<NUM_LISTS; ++i)
+		list_heads[i] = -1;
 
-	assert(!new_bucket.freelist.empty());
-	const int free_index = new_bucket.freelist.back();
-	new_bucket.freelist.pop_back();
-	assert(free_index < (int)new_bucket.timers.size());
+	for(size_t i=0; i<nodes.size(); ++i)
+		if(nodes[i].list_index != FREE_NODE_LIST_INDEX)
+			freeNode((int)i);
 
-	new_bucket.timers[free_index] = timer;
-	new_bucket.timers[free_index].valid = true;
+	assert(num_pending_timers == 0);
 }
-#endif
 
 
 #if BUILD_TESTS
@@ -234,13 +273,113 @@ void TimerQueue::addTimerToBucket(const TimerQueueTimer& timer, size_t new_bucke
 #include "../utils/TestUtils.h"
 #include "../maths/PCG32.h"
 #include <Timer.h>
+#include <queue>
+
+
+namespace
+{
+
+struct HeapTimerComparator
+{
+	bool operator() (const ScriptTimerQueueTimer& a, const ScriptTimerQueueTimer& b) const { return a.tigger_time > b.tigger_time; }
+};
+
+typedef std::priority_queue<ScriptTimerQueueTimer, std::vector<ScriptTimerQueueTimer>, HeapTimerComparator> TimerHeap;
+
+}
+
+
+// Simulates NUM_TIMERS repeating script timers, where some timers are destroyed and re-created each tick, using either the timing wheel or a binary heap.
+// With the heap, destroyed timers are left in the heap, and discarded when they are popped, as the old priority_queue implementation did.
+static double runTimerBenchmark(bool use_heap, int num_timers, int num_ticks, double tick_period, size_t& num_triggered_out)
+{
+	PCG32 rng(1);
+	std::vector<int> cur_timer_ids(num_timers);
+	std::vector<ScriptTimerHandle> handles(num_timers);
+	int next_timer_id = 0;
+
+	ScriptTimerQueue wheel(tick_period);
+	TimerHeap heap;
+	std::vector<ScriptTimerQueueTimer> triggered;
+
+	Timer timer;
+
+	for(int i=0; i<num_timers; ++i)
+	{
+		ScriptTimerQueueTimer t(/*trigger time=*/0);
+		t.period = 0.1 + rng.unitRandom() * 10.0;
+		t.tigger_time = t.period;
+		t.repeating = true;
+		t.timer_index = i;
+		t.timer_id = next_timer_id++;
+		cur_timer_ids[i] = t.timer_id;
+		if(use_heap)
+			heap.push(t);
+		else
+			handles[i] = wheel.addTimer(0.0, t);
+	}
+
+	size_t num_triggered = 0;
+	for(int tick=1; tick<=num_ticks; ++tick)
+	{
+		const double cur_time = tick * tick_period;
+
+		// Destroy and re-create 1% of timers
+		for(int z=0; z<num_timers / 100; ++z)
+		{
+			const int i = (int)rng.nextUInt((uint32)num_timers);
+			ScriptTimerQueueTimer t(/*trigger time=*/0);
+			t.period = 0.1 + rng.unitRandom() * 10.0;
+			t.tigger_time = cur_time + t.period;
+			t.repeating = true;
+			t.timer_index = i;
+			t.timer_id = next_timer_id++;
+			cur_timer_ids[i] = t.timer_id;
+			if(use_heap)
+				heap.push(t);
+			else
+			{
+				wheel.cancelTimer(handles[i]);
+				handles[i] = wheel.addTimer(cur_time, t);
+			}
+		}
+
+		if(use_heap)
+		{
+			triggered.resize(0);
+			while(!heap.empty() && heap.top().tigger_time <= cur_time)
+			{
+				triggered.push_back(heap.top());
+				heap.pop();
+			}
+		}
+		else
+			wheel.update(cur_time, triggered);
+
+		for(size_t z=0; z<triggered.size(); ++z)
+		{
+			ScriptTimerQueueTimer& t = triggered[z];
+			if(t.timer_id == cur_timer_ids[t.timer_index]) // Skip destroyed timers
+			{
+				num_triggered++;
+				t.tigger_time = cur_time + t.period;
+				if(use_heap)
+					heap.push(t);
+				else
+					handles[t.timer_index] = wheel.addTimer(cur_time, t);
+			}
+		}
+	}
+
+	num_triggered_out = num_triggered;
+	return timer.elapsed();
+}
 
 
 void ScriptTimerQueue::test()
 {
 	conPrint("ScriptTimerQueue::test()");
 
-#if 1
 	{
 		ScriptTimerQueue timer_queue;
 
@@ -265,68 +404,149 @@ void ScriptTimerQueue::test()
 
 		timer_queue.update(/*cur_time=*/2.5, triggered_timers);
 		testAssert(triggered_timers.size() == 1 && triggered_timers[0].timer_id == 1);
+
+		testAssert(timer_queue.numPendingTimers() == 0);
 	}
 
+	// Test that a timer added with a trigger time in the past is triggered on the next update
 	{
 		ScriptTimerQueue timer_queue;
+		std::vector<ScriptTimerQueueTimer> triggered_timers;
+		timer_queue.update(/*cur_time=*/10.0, triggered_timers);
 
-		PCG32 rng(1);
-		for(int i=0; i<1000; ++i)
-		{
-			ScriptTimerQueueTimer timer_a(rng.unitRandom() * 1000.0);
-			timer_queue.addTimer(/*cur time=*/0.0, timer_a);
-		}
+		ScriptTimerQueueTimer timer_a(5.0);
+		timer_a.timer_id = 0;
+		timer_queue.addTimer(/*cur time=*/10.0, timer_a);
+
+		timer_queue.update(/*cur_time=*/10.0, triggered_timers);
+		testAssert(triggered_timers.size() == 1 && triggered_timers[0].timer_id == 0);
+	}
+
+	// Test cancelling timers
+	{
+		ScriptTimerQueue timer_queue;
+
+		ScriptTimerQueueTimer timer_a(1.0);
+		timer_a.timer_id = 0;
+		const ScriptTimerHandle handle_a = timer_queue.addTimer(/*cur time=*/0.0, timer_a);
+
+		ScriptTimerQueueTimer timer_b(1.0);
+		timer_b.timer_id = 1;
+		const ScriptTimerHandle handle_b = timer_queue.addTimer(/*cur time=*/0.0, timer_b);
+		testAssert(timer_queue.numPendingTimers() == 2);
+
+		testAssert(timer_queue.cancelTimer(handle_a));
+		testAssert(!timer_queue.cancelTimer(handle_a)); // Already cancelled
+		testAssert(timer_queue.numPendingTimers() == 1);
+
+		// Add another timer, which will probably reuse timer_a's node.  The stale handle_a should not cancel it.
+		ScriptTimerQueueTimer timer_c(1.0);
+		timer_c.timer_id = 2;
+		timer_queue.addTimer(/*cur time=*/0.0, timer_c);
+		testAssert(!timer_queue.cancelTimer(handle_a));
 
 		std::vector<ScriptTimerQueueTimer> triggered_timers;
-		for(int t=0; t<1000; ++t)
+		timer_queue.update(/*cur_time=*/2.0, triggered_timers);
+		testAssert(triggered_timers.size() == 2 && triggered_timers[0].timer_id == 1 && triggered_timers[1].timer_id == 2);
+
+		testAssert(!timer_queue.cancelTimer(handle_b)); // Already triggered
+	}
+
+	// Test ordering: timers triggered in the same update should be ordered by trigger time, then by insertion order.
+	{
+		ScriptTimerQueue timer_queue(/*tick period=*/0.1);
+
+		const double trigger_times[] = { 3.0, 1.0, 3.0, 2.0, 1.0, 3.0 };
+		for(int i=0; i<6; ++i)
 		{
-			timer_queue.update(/*cur_time=*/(double)t, triggered_timers);
-			
-			for(size_t z=0; z<triggered_timers.size(); ++z)
-			{
-				testAssert(triggered_timers[z].tigger_time <= (double)t);
-				printVar(triggered_timers[z].tigger_time);
-			}
+			ScriptTimerQueueTimer t(trigger_times[i]);
+			t.timer_id = i;
+			timer_queue.addTimer(/*cur time=*/0.0, t);
 		}
 
-		// Perf test
-		Timer timer;
-		const int NUM_TIMERS = 1000;
-		for(int i=0; i<NUM_TIMERS; ++i)
+		std::vector<ScriptTimerQueueTimer> triggered_timers;
+		timer_queue.update(/*cur_time=*/10.0, triggered_timers);
+		testAssert(triggered_timers.size() == 6);
+		const int expected_ids[] = { 1, 4, 3, 0, 2, 5 };
+		for(int i=0; i<6; ++i)
+			testAssert(triggered_timers[i].timer_id == expected_ids[i]);
+	}
+
+	// Test against a reference, with timers spread over all wheel levels, and some beyond the top level.
+	{
+		const double tick_period = 1.0;
+		ScriptTimerQueue timer_queue(tick_period);
+
+		PCG32 rng(1);
+		std::vector<double> pending_trigger_times; // Reference
+		int next_id = 0;
+		for(int i=0; i<2000; ++i)
 		{
-			ScriptTimerQueueTimer timer_a(rng.unitRandom() * 1000.0);
-			timer_queue.addTimer(/*cur time=*/0.0, timer_a);
+			const double max_time = (i % 2 == 0) ? 100.0 : 3.0e7; // 3.0e7 ticks is beyond the top level.
+			ScriptTimerQueueTimer t(rng.unitRandom() * max_time);
+			t.timer_id = next_id++;
+			timer_queue.addTimer(/*cur time=*/0.0, t);
+			pending_trigger_times.push_back(t.tigger_time);
 		}
 
-		for(int t=0; t<NUM_TIMERS; ++t)
+		std::vector<ScriptTimerQueueTimer> triggered_timers;
+		double cur_time = 0;
+		while(!pending_trigger_times.empty())
 		{
-			timer_queue.update(/*cur_time=*/(double)t, triggered_timers);
-		}
+			cur_time += 1 + rng.unitRandom() * ((cur_time < 200) ? 10.0 : 1.0e6);
+			timer_queue.update(cur_time, triggered_timers);
 
-		const double elapsed = timer.elapsed();
-		conPrint("Adding and removing " + toString(NUM_TIMERS) + " timers took " + doubleToStringNSigFigs(elapsed * 1.0e3, 4) + " ms");
-		const double time_per_timer = elapsed / NUM_TIMERS * 1.0e9;
-		conPrint("time_per_timer (ns): " + toString(time_per_timer));
+			// Timers should trigger iff the tick boundary at or after the trigger time has been reached.
+			std::vector<double> expected_triggered;
+			std::vector<double> still_pending;
+			for(size_t z=0; z<pending_trigger_times.size(); ++z)
+			{
+				if(std::ceil(pending_trigger_times[z] / tick_period) <= std::floor(cur_time / tick_period))
+					expected_triggered.push_back(pending_trigger_times[z]);
+				else
+					still_pending.push_back(pending_trigger_times[z]);
+			}
+			pending_trigger_times = still_pending;
+			std::sort(expected_triggered.begin(), expected_triggered.end());
 
+			testAssert(triggered_timers.size() == expected_triggered.size());
+			for(size_t z=0; z<triggered_timers.size(); ++z)
+			{
+				testAssert(triggered_timers[z].tigger_time == expected_triggered[z]);
+				testAssert(triggered_timers[z].tigger_time <= cur_time);
+			}
+			testAssert(timer_queue.numPendingTimers() == pending_trigger_times.size());
+		}
 	}
 
-#else
+	// Test clear
 	{
 		ScriptTimerQueue timer_queue;
+		const ScriptTimerHandle handle = timer_queue.addTimer(/*cur time=*/0.0, ScriptTimerQueueTimer(1.0));
+		timer_queue.addTimer(/*cur time=*/0.0, ScriptTimerQueueTimer(1000.0));
+		timer_queue.clear();
+		testAssert(timer_queue.numPendingTimers() == 0);
+		testAssert(!timer_queue.cancelTimer(handle));
 
-		
-		timer_queue.addTimer(/*cur time=*/0.0, TimerQueueTimer(1.0)); // Should insert in bucket 3.
-		testAssert(timer_queue.numValidTimersInBucket(/*bucket_i=*/0) == 0);
-		testAssert(timer_queue.numValidTimersInBucket(/*bucket_i=*/3) == 1);
+		std::vector<ScriptTimerQueueTimer> triggered_timers;
+		timer_queue.update(/*cur_time=*/2000.0, triggered_timers);
+		testAssert(triggered_timers.empty());
+	}
 
-		std::vector<TimerQueueTimer> triggered_timers;
-		timer_queue.update(/*cur_time=*/0.6, triggered_timers); // time-to-trigger will be 0.4, so should move to bucket 2.
-		testAssert(timer_queue.numValidTimersInBucket(/*bucket_i=*/2) == 1);
-		testAssert(timer_queue.numValidTimersInBucket(/*bucket_i=*/3) == 0);
+	// Benchmark timing wheel against binary heap
+	{
+		const int num_timers = 50000;
+		const int num_ticks = 1000;
+		const double tick_period = 0.1;
 
-		testAssert(triggered_timers.empty());
+		size_t num_triggered_wheel, num_triggered_heap;
+		const double wheel_elapsed = runTimerBenchmark(/*use_heap=*/false, num_timers, num_ticks, tick_period, num_triggered_wheel);
+		const double heap_elapsed  = runTimerBenchmark(/*use_heap=*/true,  num_timers, num_ticks, tick_period, num_triggered_heap);
+
+		conPrint(toString(num_timers) + " repeating timers, " + toString(num_ticks) + " ticks:");
+		conPrint("    timing wheel: " + doubleToStringNSigFigs(wheel_elapsed * 1.0e3, 4) + " ms (" + toString(num_triggered_wheel) + " timer events)");
+		conPrint("    binary heap:  " + doubleToStringNSigFigs(heap_elapsed * 1.0e3, 4) + " ms (" + toString(num_triggered_heap) + " timer events)");
 	}
-#endif
 
 	conPrint("ScriptTimerQueue::test() done");
 }
@@ -9,10 +9,9 @@ Copyright Glare Technologies Limited 2024 -
 #include <maths/Vec4f.h>
 #include <utils/RefCounted.h>
 #include <utils/WeakReference.h>
-#include <utils/GenerationalArray.h>
+#include <utils/Platform.h>
 #include <string>
 #include <vector>
-#include <queue>
 
 
 class LuaScript;
@@ -37,11 +36,15 @@ public:
 };
 
 
-class TimerQueueBucket
+// Identifies a pending timer in a ScriptTimerQueue, so it can be cancelled.
+struct ScriptTimerHandle
 {
-public:
-	std::vector<ScriptTimerQueueTimer> timers;
-	std::vector<int> freelist;
+	ScriptTimerHandle() : node_index(-1), generation(0) {}
+
+	bool valid() const { return node_index >= 0; }
+
+	int node_index;
+	uint32 generation;
 };
 
 
@@ -49,47 +52,89 @@ public:
 ScriptTimerQueue
 ----------------
 Handles timer events for Lua scripts.
-Currently using priority_queue.
-There is also some commented-out and unfinished code for a bucket-based solution
-that may be more efficient.
+
+Uses a hierarchical timing wheel: NUM_LEVELS levels of 64 slots each.
+Level 0 slots are one tick wide, level 1 slots are 64 ticks wide etc.
+A timer is placed in the slot of the lowest level that can represent its
+time-to-trigger, and is moved down a level when the wheel above it turns over.
+Timers further in the future than the top level can represent are placed in the
+last top-level slot, and re-placed when that slot is cascaded.
+
+Inserting and cancelling timers is O(1).  Timers are stored in a node pool, with
+intrusive doubly-linked lists for the slots.
+
+Trigger times are rounded up to a tick boundary, and a timer is triggered by the first
+update() call at or after that boundary, so timers never trigger early, and trigger at most
+one tick late.  The tick period should be matched to how often update() is called.
+
+Timers triggered in the same update() call are returned sorted by trigger time,
+with timers with equal trigger times returned in the order they were added.
 =====================================================================*/
 class ScriptTimerQueue
 {
 public:
-	ScriptTimerQueue();
+	ScriptTimerQueue(double tick_period = 1.0 / 32);
 	~ScriptTimerQueue();
 
-	void addTimer(double cur_time, const ScriptTimerQueueTimer& timer);
-	/*
-	segment 0: time to trigger < 0.03125
-	0.125
-	0.5
-	2
-	8
-	32
-	128
-	inf
-	*/
+	// Returns a handle that can be passed to cancelTimer().
+	ScriptTimerHandle addTimer(double cur_time, const ScriptTimerQueueTimer& timer);
+
+	// Removes a pending timer.  Returns false if the handle does not refer to a pending timer, e.g. if the timer has already been triggered or cancelled.
+	bool cancelTimer(const ScriptTimerHandle& handle);
 
 	void update(double cur_time, std::vector<ScriptTimerQueueTimer>& triggered_timers_out);
 
+	size_t numPendingTimers() const { return num_pending_timers; }
+
+	double getTickPeriod() const { return tick_period; }
+
 	void clear(); // Just used for testing
 
 	static void test();
 
 private:
-	//size_t numValidTimersInBucket(size_t bucket_i);
-	//size_t getBucketForTimeToTrigger(double ttt);
-	//void addTimerToBucket(const TimerQueueTimer& timer, size_t new_bucket_i);
-
-	//TimerQueueBucket buckets[8];
-	//double bucket_min_ttt[8];
-	//double bucket_max_ttt[8];
+	static const int LEVEL_BITS = 6;
+	static const int NUM_SLOTS_PER_LEVEL = 1 << LEVEL_BITS;
+	static const int NUM_LEVELS = 4;
+	static const int DUE_LIST_INDEX = NUM_LEVELS * NUM_SLOTS_PER_LEVEL; // List of timers that are due at the next update() call.
+	static const int NUM_LISTS = DUE_LIST_INDEX + 1;
+	static const int FREE_NODE_LIST_INDEX = -1;
+
+	struct TimerNode
+	{
+		ScriptTimerQueueTimer timer;
+		uint64 expiry_tick;
+		uint64 sequence_num; // For ordering timers with the same trigger time.
+		int prev;
+		int next;
+		int list_index; // Index of the list in list_heads that this node is in, or FREE_NODE_LIST_INDEX if the node is free.
+		uint32 generation; // Incremented each time the node is freed, so stale handles can be detected.
+	};
 
-	struct ScriptTimerComparator
+	struct ExpiredNodeComparator
 	{
-		bool operator() (const ScriptTimerQueueTimer& a, const ScriptTimerQueueTimer& b) const { return a.tigger_time > b.tigger_time; }
+		ExpiredNodeComparator(const std::vector<TimerNode>& nodes_) : nodes(nodes_) {}
+		bool operator() (int a, int b) const;
+		const std::vector<TimerNode>& nodes;
 	};
 
-	std::priority_queue<ScriptTimerQueueTimer, std::vector<ScriptTimerQueueTimer>, ScriptTimerComparator> queue;
+	uint64 tickForTime(double t, bool round_up) const;
+	void placeNode(int node_i);
+	void pushNodeOntoList(int node_i, int list_index);
+	void unlinkNode(int node_i);
+	void freeNode(int node_i);
+	void cascade(int level, int slot_i);
+	void moveListToExpired(int list_index);
+
+	std::vector<TimerNode> nodes;
+	std::vector<int> free_node_indices;
+	int list_heads[NUM_LISTS];
+
+	double tick_period;
+	double recip_tick_period;
+	uint64 cur_tick; // All ticks up to and including cur_tick have been processed.
+	uint64 next_sequence_num;
+	size_t num_pending_timers;
+
+	std::vector<int> expired_nodes; // Temp buffer used in update()
 };
@@ -977,7 +977,7 @@ static int createTimer(lua_State* state)
 #endif
 
 	// Find free timer slot
-	for(int i=0; i<LuaScriptEvaluator::MAX_NUM_TIMERS; ++i)
+	for(int i=0; i<(int)script_evaluator->timers.size(); ++i)
 	{
 		if(script_evaluator->timers[i].id == -1) // If timer slot is free:
 		{
@@ -996,7 +996,7 @@ static int createTimer(lua_State* state)
 			timer.timer_id = timer_id;
 			//timer.lua_script_evaluator_handle = script_evaluator->generational_handle;
 			timer.lua_script_evaluator = script_evaluator;
-			timer_queue.addTimer(cur_time, timer);
+			script_evaluator->timers[i].queue_handle = timer_queue.addTimer(cur_time, timer);
 
 			lua_pushnumber(state, (double)i); // Push timer id
 			return 1; // Count of returned values
@@ -1005,7 +1005,7 @@ static int createTimer(lua_State* state)
 
 	// If got here, there are no free timer slots
 	lua_unref(state, onTimerEvent_ref); // Free the callback reference so we don't leak it
-	throw glare::Exception("createTimer(): Could not create timer, 4 timers already created." + errorContextString(state));
+	throw glare::Exception("createTimer(): Could not create timer, " + toString(script_evaluator->timers.size()) + " timers already created." + errorContextString(state));
 //#else
 //	throw glare::Exception("createTimer(): todo on server.");
 //#endif
@@ -1023,7 +1023,7 @@ static int destroyTimer(lua_State* state)
 	LuaScript* script = (LuaScript*)lua_getthreaddata(state);
 	LuaScriptEvaluator* script_evaluator = (LuaScriptEvaluator*)script->userdata;
 
-	for(int i=0; i<LuaScriptEvaluator::MAX_NUM_TIMERS; ++i)
+	for(int i=0; i<(int)script_evaluator->timers.size(); ++i)
 		if(script_evaluator->timers[i].id == timer_id)
 		{
 			script_evaluator->destroyTimer(/*timer index=*/i);
@@ -1269,7 +1269,7 @@ static void scheduleOneShotServerCallback(SubstrataLuaVM* sub_lua_vm, LuaScriptE
 	const double cur_time = sub_lua_vm->server->total_timer.elapsed();
 	ScriptTimerQueue& timer_queue = sub_lua_vm->server->timer_queue;
 
-	for(int i=0; i<LuaScriptEvaluator::MAX_NUM_TIMERS; ++i)
+	for(int i=0; i<(int)script_evaluator->timers.size(); ++i)
 	{
 		if(script_evaluator->timers[i].id == -1) // If timer slot is free:
 		{
@@ -1286,14 +1286,14 @@ static void scheduleOneShotServerCallback(SubstrataLuaVM* sub_lua_vm, LuaScriptE
 			timer.timer_index = i;
 			timer.timer_id = timer_id;
 			timer.lua_script_evaluator = script_evaluator;
-			timer_queue.addTimer(cur_time, timer);
+			script_evaluator->timers[i].queue_handle = timer_queue.addTimer(cur_time, timer);
 			return;
 		}
 	}
 
 	// No free timer slot.  Free the callback reference so we don't leak it, then report the error.
 	lua_unref(script_evaluator->lua_script->thread_state, callback_ref);
-	throw glare::Exception("Could not register onCompleted callback: too many active timers/callbacks (max " + toString(LuaScriptEvaluator::MAX_NUM_TIMERS) + ").");
+	throw glare::Exception("Could not register onCompleted callback: too many active timers/callbacks (max " + toString(script_evaluator->timers.size()) + ").");
 }
 #endif // SERVER
 
@@ -1350,6 +1350,7 @@ static int luaMoveTo(lua_State* state)
 	// Note: we deliberately do not set from_remote_transform_dirty, as that would broadcast an ObjectTransformUpdate that snaps clients to the target.
 	ob->pos = target_pos;
 	script_evaluator->world_state->addWorldObjectAsDBDirty(ob, *script_evaluator->cur_world_state_lock);
+	script_evaluator->world_state->updateObjectAccounting(*ob, sub_lua_vm->server->world_state->model_URL_to_stats, *script_evaluator->cur_world_state_lock); // Object may have moved to a different parcel.
 	sub_lua_vm->server->world_state->markAsChanged();
 
 	// If an onCompleted callback was provided, schedule it to fire when the move finishes.
@@ -2253,6 +2254,20 @@ SubstrataLuaVM::SubstrataLuaVM(const SubstrataLuaVMArgs& args)
 	server(args.server)
 #endif
 {
+	timer_queue = nullptr;
+	max_num_timers_per_script = LuaScriptEvaluator::DEFAULT_MAX_NUM_TIMERS;
+#if GUI_CLIENT
+	if(gui_client)
+		timer_queue = &gui_client->script_timer_queue;
+#endif
+#if SERVER
+	if(server)
+	{
+		timer_queue = &server->timer_queue;
+		max_num_timers_per_script = server->config.max_num_timers_per_script;
+	}
+#endif
+
 	lua_vm.set(new LuaVM());
 	lua_vm->max_total_mem_allowed = 16 * 1024 * 1024;
 
@@ -15,6 +15,7 @@ class PlayerPhysics;
 class GUIClient;
 class Server;
 class LuaVM;
+class ScriptTimerQueue;
 
 
 /*=====================================================================
@@ -100,6 +101,9 @@ public:
 #if SERVER
 	Server* server;
 #endif
+
+	ScriptTimerQueue* timer_queue; // Timers created by scripts in this VM are added to this queue.  May be null.
+	int max_num_timers_per_script;
 	
 	int worldObjectClassMetaTable_ref;
 	int worldMaterialClassMetaTable_ref;
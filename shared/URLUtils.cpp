@@ -7,6 +7,7 @@ Copyright Glare Technologies Limited 2026 -
 
 
 #include "STLArenaAllocator.h"
+#include <utils/StringUtils.h>
 
 
 namespace URLUtils
@@ -55,4 +56,28 @@ URLString makeOptimisedMeshURL(const URLString& base_model_url, int lod_level, b
 }
 
 
+// Converts something like
+// 
+// base_34345436654_lod2_opt3.bmesh
+// to
+// base_34345436654_lod2_opt3_meshshape1.joltshape  (or base_34345436654_lod2_opt3_hullshape1.joltshape for dynamic objects)
+URLString makePhysicsShapeURL(const URLString& lod_model_url, bool dynamic, int physics_shape_version, glare::ArenaAllocator* arena_allocator)
+{
+	glare::STLArenaAllocator<char> stl_arena_allocator(arena_allocator);
+	URLString new_url(stl_arena_allocator);
+
+	if(!hasExtension(lod_model_url, "bmesh") || hasPrefix(lod_model_url, "http:") || hasPrefix(lod_model_url, "https:"))
+		return new_url;
+
+	new_url.reserve(lod_model_url.size() + 32);
+
+	const std::string::size_type dot_index = lod_model_url.find_last_of('.');
+	new_url.assign(lod_model_url, /*subpos=*/0, /*count=*/dot_index);
+	new_url += dynamic ? "_hullshape" : "_meshshape";
+	new_url += toString(physics_shape_version);
+	new_url += ".joltshape";
+	return new_url;
+}
+
+
 } // end namespace URLUtils
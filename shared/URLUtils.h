@@ -15,4 +15,7 @@ namespace URLUtils
 
 URLString makeOptimisedMeshURL(const URLString& base_model_url, int lod_level, bool get_optimised_mesh, int opt_mesh_version, glare::ArenaAllocator* arena_allocator);
 
+// Returns the URL of the precooked physics shape the server builds for a (.bmesh) model URL, or the empty string if the server doesn't build shapes for this kind of model.
+URLString makePhysicsShapeURL(const URLString& lod_model_url, bool dynamic, int physics_shape_version, glare::ArenaAllocator* arena_allocator);
+
 } // end namespace URLUtils
@@ -20,6 +20,8 @@ Copyright Glare Technologies Limited 2022 -
 #include "../utils/Sort.h"
 #include "../utils/Array2D.h"
 #include "../utils/Array3D.h"
+#include "../utils/BitUtils.h"
+#include "../utils/TaskManager.h"
 #if GUI_CLIENT
 #include "superluminal/PerformanceAPI.h"
 #endif
@@ -93,499 +95,646 @@ public:
 };
 
 
-template <class VertPosKeyType, typename VertPosIntType, class VertPosKeyHashFunc>
-static void makeVoxelMeshForVertPosKeyType(const VoxelBounds& bounds_, const Vec3<int>& res_, const Array3D<VoxelMatIndexType>& voxel_array, size_t num_orig_voxels, const js::Vector<bool, 16>& mats_transparent_, Indigo::Mesh* mesh, glare::Allocator* mem_allocator)
+// Get the axes of a slice perpendicular to dim.  We want a_axis x b_axis = dim_axis.
+static inline void getSliceAxes(int dim, int& dim_a, int& dim_b)
 {
-	const VoxelBounds bounds = bounds_;
-	const Vec3<int> res = res_;
-	const VoxelMatIndexType no_voxel_mat = std::numeric_limits<VoxelMatIndexType>::max();
+	if(dim == 0)
+	{
+		dim_a = 1;
+		dim_b = 2;
+	}
+	else if(dim == 1)
+	{
+		dim_a = 2;
+		dim_b = 0;
+	}
+	else // dim == 2:
+	{
+		dim_a = 0;
+		dim_b = 1;
+	}
+}
 
-	// Build a local array of mat-transparent booleans, one for each material.  If no such entry in mats_transparent_ for a given index, assume opaque.
-	bool mat_transparent[256];
-	for(size_t i=0; i<256; ++i)
-		mat_transparent[i] = (i < mats_transparent_.size()) && mats_transparent_[i];
 
-	// Hash map from voxel coordinates to index of created vertex in mesh->vert_positions.
-	// Note that a lot of voxel models create not a lot of vertices.  So don't start the hashmap with too large a size, or it just wastes memory.
-	VertPosKeyType vertpos_empty_key;
-	vertpos_empty_key.v[0] = vertpos_empty_key.v[1] = vertpos_empty_key.v[2] = 0;
-	vertpos_empty_key.misc = 0;
-	HashMap<VertPosKeyType, int, VertPosKeyHashFunc> vertpos_hash(/*empty key=*/vertpos_empty_key, /*expected_num_items=*/num_orig_voxels / 100, mem_allocator);
+// A greedy quad in a slice of the voxel array.
+// Coordinates are voxel array indices along dim_a (x) and dim_b (y) of the slice.  End coordinates are exclusive.
+struct VoxelQuad
+{
+	int dim_coord; // Index of the slice along dim.
+	int start_x, start_y, end_x, end_y;
+	VoxelMatIndexType mat;
+	bool upper; // True for a face on the upper side of the voxels along dim, false for a face on the lower side.
+};
 
 
-	const int dim_mask_val = (int)std::numeric_limits<VertPosIntType>::max();
-	const int dim_num_bits = (dim_mask_val == 255) ? 8 : 16;
+// Flags for each material index, used for building slice bitmasks.
+static const uint8 MAT_FLAG_OCCUPIED    = 1; // There is a voxel with this material index (false for no_voxel_mat)
+static const uint8 MAT_FLAG_TRANSPARENT = 2;
+static const uint8 MAT_FLAG_BLOCKING    = 4; // Voxel is opaque.  Faces of voxels adjacent to it are never visible.
 
-	// Bit 7: set for any used key (to distinguish from empty key)
-	// Bit 0: Value overflow along x axis (for example we get an overflow if value is 256 for uint8 coords)
-	// Bit 1: Value overflow along y axis
-	// Bit 2: Value overflow along z axis
-	const int default_used_bit = 128;
 
+// A slice of the voxel array, with a bitmask for each of the material flags.
+// Bits are packed along dim_a into rows of words_per_row 64-bit words, one row for each coordinate along dim_b.
+struct VoxelSlice
+{
+	void resize(int a_size, int b_size, int words_per_row)
+	{
+		mats.resizeNoCopy((size_t)a_size * b_size);
+		occupied   .resizeNoCopy((size_t)words_per_row * b_size);
+		transparent.resizeNoCopy((size_t)words_per_row * b_size);
+		blocking   .resizeNoCopy((size_t)words_per_row * b_size);
+	}
 
-	// For each dimension (x, y, z)
-	for(int dim=0; dim<3; ++dim)
+	js::Vector<VoxelMatIndexType, 16> mats; // Material index of the voxel at (x, y), stored at x + y * a_size.
+	js::Vector<uint64, 16> occupied;
+	js::Vector<uint64, 16> transparent;
+	js::Vector<uint64, 16> blocking;
+	bool in_bounds; // False if the slice is outside of the voxel array, in which case all the voxels are treated as empty.
+};
+
+
+static void loadVoxelSlice(const Array3D<VoxelMatIndexType>& voxel_array, const Vec3<int>& res, int dim, int dim_a, int dim_b, int dim_coord, int words_per_row, const uint8* mat_flags, VoxelSlice& slice_out)
+{
+	slice_out.in_bounds = (dim_coord >= 0) && (dim_coord < res[dim]);
+	if(!slice_out.in_bounds)
+		return;
+
+	const int a_size = res[dim_a];
+	const int b_size = res[dim_b];
+
+	Vec3<int> vox_indices;
+	vox_indices[dim] = dim_coord;
+	for(int y=0; y<b_size; ++y)
 	{
-		// Want the a_axis x b_axis = dim_axis
-		int dim_a, dim_b;
-		if(dim == 0)
-		{
-			dim_a = 1;
-			dim_b = 2;
-		}
-		else if(dim == 1)
+		vox_indices[dim_b] = y;
+		VoxelMatIndexType* const mats_row = &slice_out.mats[(size_t)y * a_size];
+		const size_t row_word_offset = (size_t)y * words_per_row;
+
+		for(int w=0; w<words_per_row; ++w)
 		{
-			dim_a = 2;
-			dim_b = 0;
+			uint64 occupied = 0, transparent = 0, blocking = 0;
+			const int x_begin = w * 64;
+			const int x_end = myMin(x_begin + 64, a_size);
+			for(int x=x_begin; x<x_end; ++x)
+			{
+				vox_indices[dim_a] = x;
+				const VoxelMatIndexType mat = voxel_array.elem(vox_indices.x, vox_indices.y, vox_indices.z);
+				mats_row[x] = mat;
+
+				const uint64 flags = mat_flags[mat];
+				const int bit = x - x_begin;
+				occupied    |= ( flags       & 1) << bit;
+				transparent |= ((flags >> 1) & 1) << bit;
+				blocking    |= ((flags >> 2) & 1) << bit;
+			}
+			slice_out.occupied   [row_word_offset + w] = occupied;
+			slice_out.transparent[row_word_offset + w] = transparent;
+			slice_out.blocking   [row_word_offset + w] = blocking;
 		}
-		else // dim == 2:
+	}
+}
+
+
+// Compute bitmask of voxels in slice 'cur' that need a face on the side adjacent to slice 'adj'.
+//
+// For an opaque or transparent voxel (the material assigned to it at least), adjacent to an empty voxel, we want to create a face.
+// For a voxel adjacent to an opaque voxel, we don't want to create a face, as it won't be visible.
+// For a voxel adjacent to a transparent voxel with a different material, we want to create a face with the voxel's material.
+// This is done 64 voxels at a time with bitmask operations, apart from the material comparison for voxels adjacent to transparent voxels.
+static void computeFaceBits(const VoxelSlice& cur, const VoxelSlice& adj, int a_size, int words_per_row, size_t num_words, js::Vector<uint64, 16>& face_bits_out)
+{
+	if(!adj.in_bounds)
+	{
+		for(size_t i=0; i<num_words; ++i)
+			face_bits_out[i] = cur.occupied[i];
+		return;
+	}
+
+	for(size_t i=0; i<num_words; ++i)
+	{
+		uint64 faces = cur.occupied[i] & ~adj.blocking[i];
+
+		// Remove faces between voxels with the same transparent material.
+		uint64 check_mat_bits = faces & adj.transparent[i];
+		if(check_mat_bits != 0)
 		{
-			dim_a = 0;
-			dim_b = 1;
+			const size_t y = i / words_per_row;
+			const size_t x_begin = (i % words_per_row) * 64;
+			while(check_mat_bits != 0)
+			{
+				const uint32 bit = BitUtils::lowestSetBitIndex(check_mat_bits);
+				check_mat_bits &= check_mat_bits - 1; // Clear lowest set bit
+
+				const size_t index = y * a_size + x_begin + bit;
+				if(cur.mats[index] == adj.mats[index])
+					faces &= ~((uint64)1 << bit);
+			}
 		}
 
-		// Get the extents along dim_a, dim_b
-		const int a_min = bounds.min[dim_a];
-		const int a_size = res[dim_a];
+		face_bits_out[i] = faces;
+	}
+}
 
-		const int b_min = bounds.min[dim_b];
-		const int b_size = res[dim_b];
 
-		// Walk from lower to greater coords, look for downwards facing faces
-		const int dim_min = bounds.min[dim];
-		const int dim_size = res[dim];
+// Find greedy quads covering the faces in face_bits, appending them to quads_out.
+// face_needed_mat must have all elements set to no_voxel_mat.  It is left that way on return.
+static void findGreedyQuadsForSliceFaces(const VoxelSlice& cur, const js::Vector<uint64, 16>& face_bits, int a_size, int b_size, int words_per_row, int dim_coord, bool upper,
+	js::Vector<VoxelMatIndexType, 16>& face_needed_mat, js::Vector<VoxelQuad, 16>& quads_out)
+{
+	const VoxelMatIndexType no_voxel_mat = std::numeric_limits<VoxelMatIndexType>::max();
 
-		// An array of voxel faces that still need to be processed.  We store the face material index if the face needs to be processed, and no_voxel_mat otherwise.  Processed = included in a greedy quad already.
-		Array2D<VoxelMatIndexType> face_needed_mat(a_size, b_size);
+	// Set face_needed_mat for the faces we need to process.  Processed = included in a greedy quad already.
+	for(int y=0; y<b_size; ++y)
+	for(int w=0; w<words_per_row; ++w)
+	{
+		uint64 bits = face_bits[(size_t)y * words_per_row + w];
+		while(bits != 0)
+		{
+			const int x = w * 64 + (int)BitUtils::lowestSetBitIndex(bits);
+			bits &= bits - 1;
+			const size_t index = (size_t)y * a_size + x;
+			face_needed_mat[index] = cur.mats[index];
+		}
+	}
 
-		for(int dim_coord = 0; dim_coord < dim_size; ++dim_coord)
+	// For each voxel face, in order of increasing y then x:
+	for(int start_y=0; start_y<b_size; ++start_y)
+	for(int w=0; w<words_per_row; ++w)
+	{
+		uint64 bits = face_bits[(size_t)start_y * words_per_row + w];
+		while(bits != 0)
 		{
-			Vec3<int> vox_indices, adjacent_vox_indices; // pos coords of current voxel, and adjacent voxel
-
-			//================= Do lower faces along dim ==========================
-			// Build face_needed_mat data for this slice
-			vox_indices[dim] = dim_coord;
-			adjacent_vox_indices[dim] = dim_coord - 1;
-			for(int y=0; y<b_size; ++y)
-			for(int x=0; x<a_size; ++x)
-			{
-				vox_indices[dim_a] = x;
-				vox_indices[dim_b] = y;
+			const int start_x = w * 64 + (int)BitUtils::lowestSetBitIndex(bits);
+			bits &= bits - 1;
+
+			const VoxelMatIndexType start_face_needed_mat = face_needed_mat[(size_t)start_y * a_size + start_x];
+			if(start_face_needed_mat == no_voxel_mat) // If this face was already included in a quad:
+				continue;
 
-				VoxelMatIndexType this_face_needed_mat = no_voxel_mat;
-				const auto vox_mat_index = voxel_array.elem(vox_indices.x, vox_indices.y, vox_indices.z);
-				if(vox_mat_index != no_voxel_mat) // If there is a voxel here
+			// Start a quad here (start corner at (start_x, start_y))
+			// The quad will range from (start_x, start_y) to (end_x, end_y)
+			int end_x = start_x + 1;
+			int end_y = start_y + 1;
+
+			bool x_increase_ok = true;
+			bool y_increase_ok = true;
+			while(x_increase_ok || y_increase_ok)
+			{
+				// Try and increase in x direction
+				if(x_increase_ok)
 				{
-					adjacent_vox_indices[dim_a] = x;
-					adjacent_vox_indices[dim_b] = y;
-					if(dim_coord > 0) // If adjacent vox indices are in array bounds: (if dim_coord - 1 >= 0)
+					if(end_x < a_size) // If there is still room to increase in x direction:
 					{
-						const auto adjacent_vox_mat_index = voxel_array.elem(adjacent_vox_indices.x, adjacent_vox_indices.y, adjacent_vox_indices.z);
-
-						// For an opaque or transparent voxel (the material assigned to it at least), adjacent to an empty voxel, we want to create a face.
-						// For an opaque voxel adjacent to another opaque voxel, we don't want to create a face, as it won't be visible.
-						// For an opaque voxel adjacent to a transparent voxel, we want to create a single face with the opaque material.
-						if((adjacent_vox_mat_index == no_voxel_mat) || // If adjacent voxel is empty, or
-							(mat_transparent[adjacent_vox_mat_index] && (adjacent_vox_mat_index != vox_mat_index))) // the adjacent voxel is transparent, and the adjacent voxel has a different material.
-							this_face_needed_mat = vox_mat_index;
+						// Check y values for new x = end_x
+						for(int y = start_y; y < end_y; ++y)
+							if(face_needed_mat[(size_t)y * a_size + end_x] != start_face_needed_mat)
+							{
+								x_increase_ok = false;
+								break;
+							}
+
+						if(x_increase_ok)
+							end_x++;
 					}
 					else
-						this_face_needed_mat = vox_mat_index;
+						x_increase_ok = false;
 				}
 
-				face_needed_mat.elem(x, y) = this_face_needed_mat;
-			}
-
-			// For each voxel face:
-			for(int start_y=0; start_y<b_size; ++start_y)
-			for(int start_x=0; start_x<a_size; ++start_x)
-			{
-				const int start_face_needed_mat = face_needed_mat.elem(start_x, start_y);
-				if(start_face_needed_mat != no_voxel_mat) // If we need a face here:
+				// Try and increase in y direction
+				if(y_increase_ok)
 				{
-					// Start a quad here (start corner at (start_x, start_y))
-					// The quad will range from (start_x, start_y) to (end_x, end_y)
-					int end_x = start_x + 1;
-					int end_y = start_y + 1;
-
-					bool x_increase_ok = true;
-					bool y_increase_ok = true;
-					while(x_increase_ok || y_increase_ok)
+					if(end_y < b_size)
 					{
-						// Try and increase in x direction
-						if(x_increase_ok)
-						{
-							if(end_x < a_size) // If there is still room to increase in x direction:
+						// Check x values for new y = end_y
+						const VoxelMatIndexType* const row = &face_needed_mat[(size_t)end_y * a_size];
+						for(int x = start_x; x < end_x; ++x)
+							if(row[x] != start_face_needed_mat)
 							{
-								// Check y values for new x = end_x
-								for(int y = start_y; y < end_y; ++y)
-									if(face_needed_mat.elem(end_x, y) != start_face_needed_mat)
-									{
-										x_increase_ok = false;
-										break;
-									}
-
-								if(x_increase_ok)
-									end_x++;
+								y_increase_ok = false;
+								break;
 							}
-							else
-								x_increase_ok = false;
-						}
 
-						// Try and increase in y direction
 						if(y_increase_ok)
-						{
-							if(end_y < b_size)
-							{
-								// Check x values for new y = end_y
-								for(int x = start_x; x < end_x; ++x)
-									if(face_needed_mat.elem(x, end_y) != start_face_needed_mat)
-									{
-										y_increase_ok = false;
-										break;
-									}
-
-								if(y_increase_ok)
-									end_y++;
-							}
-							else
-								y_increase_ok = false;
-						}
+							end_y++;
 					}
+					else
+						y_increase_ok = false;
+				}
+			}
 
-					// We have worked out the greedy quad.  Mark elements in it as processed
-					for(int y=start_y; y < end_y; ++y)
-					for(int x=start_x; x < end_x; ++x)
-						face_needed_mat.elem(x, y) = no_voxel_mat;
+			// We have worked out the greedy quad.  Mark elements in it as processed
+			for(int y=start_y; y < end_y; ++y)
+			for(int x=start_x; x < end_x; ++x)
+				face_needed_mat[(size_t)y * a_size + x] = no_voxel_mat;
+
+			VoxelQuad quad;
+			quad.dim_coord = dim_coord;
+			quad.start_x = start_x;
+			quad.start_y = start_y;
+			quad.end_x = end_x;
+			quad.end_y = end_y;
+			quad.mat = start_face_needed_mat;
+			quad.upper = upper;
+			quads_out.push_back(quad);
+		}
+	}
+}
 
-					// Add the greedy quad
-					unsigned int v_i[4]; // quad vert indices
-					Indigo::Vec3f v; // Vertex position coordinates
-					v[dim] = (float)(dim_min + dim_coord);
 
-					VertPosKeyType key;
-					assert(dim_coord >= 0 && dim_coord <= std::numeric_limits<VertPosIntType>::max());
-					key.v[dim] = (VertPosIntType)dim_coord;
+// Find greedy quads for slices [slice_begin, slice_end) along dim.
+// For each slice, quads for lower faces are added, then quads for upper faces.
+// Greedy quads lie within a single slice, so the quads found don't depend on how the slices are split into ranges.
+static void findQuadsForSlices(const Array3D<VoxelMatIndexType>& voxel_array, const Vec3<int>& res, const uint8* mat_flags, int dim, int slice_begin, int slice_end, js::Vector<VoxelQuad, 16>& quads_out)
+{
+	const VoxelMatIndexType no_voxel_mat = std::numeric_limits<VoxelMatIndexType>::max();
 
-					const float start_x_coord = (float)(start_x + a_min);
-					const float start_y_coord = (float)(start_y + b_min);
-					const float end_x_coord   = (float)(end_x + a_min);
-					const float end_y_coord   = (float)(end_y + b_min);
+	int dim_a, dim_b;
+	getSliceAxes(dim, dim_a, dim_b);
 
-					assert(start_x >= 0 && start_x <= std::numeric_limits<VertPosIntType>::max());
-					assert(start_y >= 0 && start_y <= std::numeric_limits<VertPosIntType>::max());
-					assert(end_x   >= 0 && end_x   <= std::numeric_limits<VertPosIntType>::max() + 1);
-					assert(end_y   >= 0 && end_y   <= std::numeric_limits<VertPosIntType>::max() + 1);
+	const int a_size = res[dim_a];
+	const int b_size = res[dim_b];
+	const int words_per_row = Maths::roundedUpDivide(a_size, 64);
+	const size_t num_words = (size_t)words_per_row * b_size;
 
-					{
-						// bot left
-						v[dim_a] = start_x_coord;
-						v[dim_b] = start_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)(start_x);
-						key.v[dim_b] = (VertPosIntType)(start_y);
-						key.misc = default_used_bit;
-
-						// returns object of type std::pair<iterator, bool>
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size())); // Try and insert vertex
-						v_i[0] = insert_res.first->second; // Get existing or new item (insert_res.first) - a (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{
-						// top left
-						v[dim_a] = start_x_coord;
-						v[dim_b] = end_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)start_x;
-						key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
-						key.misc = (VertPosIntType)(default_used_bit |
-							((end_y >> dim_num_bits) << dim_b)
-							);
-						
-						// An example with uint8 coords:
-						// end_y >> dim_num_bits will be 0, or 1 if end_y == 256
-					
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[1] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{
-						// top right
-						v[dim_a] = end_x_coord;
-						v[dim_b] = end_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
-						key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
-						key.misc = (VertPosIntType)(default_used_bit |
-							((end_x >> dim_num_bits) << dim_a) |
-							((end_y >> dim_num_bits) << dim_b)
-							);
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[2] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{
-						// bot right
-						v[dim_a] = end_x_coord;
-						v[dim_b] = start_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
-						key.v[dim_b] = (VertPosIntType)start_y;
-						key.misc = (VertPosIntType)(
-							default_used_bit |
-							((end_x >> dim_num_bits) << dim_a)
-							);
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[3] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
+	// Keep the previous, current and next slices along dim, so that each slice only needs to be read from the voxel array once.
+	VoxelSlice slices[3];
+	for(int i=0; i<3; ++i)
+		slices[i].resize(a_size, b_size, words_per_row);
+	VoxelSlice* prev = &slices[0];
+	VoxelSlice* cur  = &slices[1];
+	VoxelSlice* next = &slices[2];
 
-					assert(mesh->vert_positions.size() == vertpos_hash.size());
+	loadVoxelSlice(voxel_array, res, dim, dim_a, dim_b, slice_begin - 1, words_per_row, mat_flags, *prev);
+	loadVoxelSlice(voxel_array, res, dim, dim_a, dim_b, slice_begin,     words_per_row, mat_flags, *cur);
 
-					const size_t tri_start = mesh->triangles.size();
-					mesh->triangles.resize(tri_start + 2);
+	js::Vector<VoxelMatIndexType, 16> face_needed_mat((size_t)a_size * b_size, no_voxel_mat);
+	js::Vector<uint64, 16> face_bits(num_words);
 
-					assert(start_face_needed_mat != no_voxel_mat);
+	for(int dim_coord = slice_begin; dim_coord < slice_end; ++dim_coord)
+	{
+		loadVoxelSlice(voxel_array, res, dim, dim_a, dim_b, dim_coord + 1, words_per_row, mat_flags, *next);
 
-					mesh->triangles[tri_start + 0].vertex_indices[0] = v_i[0];
-					mesh->triangles[tri_start + 0].vertex_indices[1] = v_i[1];
-					mesh->triangles[tri_start + 0].vertex_indices[2] = v_i[2];
-					mesh->triangles[tri_start + 0].uv_indices[0]     = 0;
-					mesh->triangles[tri_start + 0].uv_indices[1]     = 0;
-					mesh->triangles[tri_start + 0].uv_indices[2]     = 0;
-					mesh->triangles[tri_start + 0].tri_mat_index     = (uint32)start_face_needed_mat;
+		// Do lower faces along dim
+		computeFaceBits(*cur, *prev, a_size, words_per_row, num_words, face_bits);
+		findGreedyQuadsForSliceFaces(*cur, face_bits, a_size, b_size, words_per_row, dim_coord, /*upper=*/false, face_needed_mat, quads_out);
 
-					mesh->triangles[tri_start + 1].vertex_indices[0] = v_i[0];
-					mesh->triangles[tri_start + 1].vertex_indices[1] = v_i[2];
-					mesh->triangles[tri_start + 1].vertex_indices[2] = v_i[3];
-					mesh->triangles[tri_start + 1].uv_indices[0]     = 0;
-					mesh->triangles[tri_start + 1].uv_indices[1]     = 0;
-					mesh->triangles[tri_start + 1].uv_indices[2]     = 0;
-					mesh->triangles[tri_start + 1].tri_mat_index     = (uint32)start_face_needed_mat;
-				}
-			}
+		// Do upper faces along dim
+		computeFaceBits(*cur, *next, a_size, words_per_row, num_words, face_bits);
+		findGreedyQuadsForSliceFaces(*cur, face_bits, a_size, b_size, words_per_row, dim_coord, /*upper=*/true, face_needed_mat, quads_out);
+
+		// Advance slices
+		VoxelSlice* const old_prev = prev;
+		prev = cur;
+		cur = next;
+		next = old_prev;
+	}
+}
+
+
+class FindVoxelQuadsTask : public glare::Task
+{
+public:
+	virtual void run(size_t /*thread_index*/)
+	{
+		findQuadsForSlices(*voxel_array, res, mat_flags, dim, slice_begin, slice_end, quads);
+	}
+
+	const Array3D<VoxelMatIndexType>* voxel_array;
+	Vec3<int> res;
+	const uint8* mat_flags;
+	int dim;
+	int slice_begin, slice_end;
+	js::Vector<VoxelQuad, 16> quads; // Output
+};
 
-			//================= Do upper faces along dim ==========================
-			// Build face_needed data for this slice
-			adjacent_vox_indices[dim] = dim_coord + 1;
-			for(int y=0; y<b_size; ++y)
-			for(int x=0; x<a_size; ++x)
+
+// Voxel arrays with at least this many elements will have quads found in parallel, if a task manager is given.
+static const int64 MIN_VOXEL_ARRAY_SIZE_FOR_PARALLEL_MESHING = 1 << 18;
+static const int MIN_SLICES_PER_TASK = 8;
+
+
+// Create vertices and triangles for the quads.
+template <class VertPosKeyType, typename VertPosIntType, class VertPosKeyHashFunc>
+static void addQuadsToMesh(const VoxelBounds& bounds_, const std::vector<Reference<FindVoxelQuadsTask>>& tasks, size_t num_orig_voxels, Indigo::Mesh* mesh, glare::Allocator* mem_allocator)
+{
+	const VoxelBounds bounds = bounds_;
+
+	// Hash map from voxel coordinates to index of created vertex in mesh->vert_positions.
+	// Note that a lot of voxel models create not a lot of vertices.  So don't start the hashmap with too large a size, or it just wastes memory.
+	VertPosKeyType vertpos_empty_key;
+	vertpos_empty_key.v[0] = vertpos_empty_key.v[1] = vertpos_empty_key.v[2] = 0;
+	vertpos_empty_key.misc = 0;
+	HashMap<VertPosKeyType, int, VertPosKeyHashFunc> vertpos_hash(/*empty key=*/vertpos_empty_key, /*expected_num_items=*/num_orig_voxels / 100, mem_allocator);
+
+
+	const int dim_mask_val = (int)std::numeric_limits<VertPosIntType>::max();
+	const int dim_num_bits = (dim_mask_val == 255) ? 8 : 16;
+
+	// Bit 7: set for any used key (to distinguish from empty key)
+	// Bit 0: Value overflow along x axis (for example we get an overflow if value is 256 for uint8 coords)
+	// Bit 1: Value overflow along y axis
+	// Bit 2: Value overflow along z axis
+	const int default_used_bit = 128;
+
+	// Tasks are in order of dim, then slice range.
+	for(size_t task_i=0; task_i<tasks.size(); ++task_i)
+	{
+		const int dim = tasks[task_i]->dim;
+		const js::Vector<VoxelQuad, 16>& quads = tasks[task_i]->quads;
+
+		int dim_a, dim_b;
+		getSliceAxes(dim, dim_a, dim_b);
+
+		const int a_min = bounds.min[dim_a];
+		const int b_min = bounds.min[dim_b];
+		const int dim_min = bounds.min[dim];
+
+		for(size_t quad_i=0; quad_i<quads.size(); ++quad_i)
+		{
+			const VoxelQuad& quad = quads[quad_i];
+			const int dim_coord = quad.dim_coord;
+			const int start_x = quad.start_x;
+			const int start_y = quad.start_y;
+			const int end_x = quad.end_x;
+			const int end_y = quad.end_y;
+			const int start_face_needed_mat = quad.mat;
+
+			unsigned int v_i[4]; // quad vert indices
+
+			if(!quad.upper)
 			{
-				vox_indices[dim_a] = x;
-				vox_indices[dim_b] = y;
-				const auto vox_mat_index = voxel_array.elem(vox_indices.x, vox_indices.y, vox_indices.z);
+				//================= Add greedy quad for lower face along dim ==========================
+				Indigo::Vec3f v; // Vertex position coordinates
+				v[dim] = (float)(dim_min + dim_coord);
+
+				VertPosKeyType key;
+				assert(dim_coord >= 0 && dim_coord <= std::numeric_limits<VertPosIntType>::max());
+				key.v[dim] = (VertPosIntType)dim_coord;
+
+				const float start_x_coord = (float)(start_x + a_min);
+				const float start_y_coord = (float)(start_y + b_min);
+				const float end_x_coord   = (float)(end_x + a_min);
+				const float end_y_coord   = (float)(end_y + b_min);
+
+				assert(start_x >= 0 && start_x <= std::numeric_limits<VertPosIntType>::max());
+				assert(start_y >= 0 && start_y <= std::numeric_limits<VertPosIntType>::max());
+				assert(end_x   >= 0 && end_x   <= std::numeric_limits<VertPosIntType>::max() + 1);
+				assert(end_y   >= 0 && end_y   <= std::numeric_limits<VertPosIntType>::max() + 1);
 
-				VoxelMatIndexType this_face_needed_mat = no_voxel_mat;
-				if(vox_mat_index != no_voxel_mat) // If there is a voxel here
 				{
-					adjacent_vox_indices[dim_a] = x;
-					adjacent_vox_indices[dim_b] = y;
-					if(dim_coord < dim_size - 1) // If adjacent vox indices are in array bounds: (if dim_coord + 1 < dim_size)
-					{
-						const auto adjacent_vox_mat_index = voxel_array.elem(adjacent_vox_indices.x, adjacent_vox_indices.y, adjacent_vox_indices.z);
-						if((adjacent_vox_mat_index == no_voxel_mat) || 
-							(mat_transparent[adjacent_vox_mat_index] && (adjacent_vox_mat_index != vox_mat_index)))
-							this_face_needed_mat = vox_mat_index;
-					}
-					else
-						this_face_needed_mat = vox_mat_index;
+					// bot left
+					v[dim_a] = start_x_coord;
+					v[dim_b] = start_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)(start_x);
+					key.v[dim_b] = (VertPosIntType)(start_y);
+					key.misc = default_used_bit;
+
+					// returns object of type std::pair<iterator, bool>
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size())); // Try and insert vertex
+					v_i[0] = insert_res.first->second; // Get existing or new item (insert_res.first) - a (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{
+					// top left
+					v[dim_a] = start_x_coord;
+					v[dim_b] = end_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)start_x;
+					key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
+					key.misc = (VertPosIntType)(default_used_bit |
+						((end_y >> dim_num_bits) << dim_b)
+						);
+
+					// An example with uint8 coords:
+					// end_y >> dim_num_bits will be 0, or 1 if end_y == 256
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[1] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{
+					// top right
+					v[dim_a] = end_x_coord;
+					v[dim_b] = end_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
+					key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
+					key.misc = (VertPosIntType)(default_used_bit |
+						((end_x >> dim_num_bits) << dim_a) |
+						((end_y >> dim_num_bits) << dim_b)
+						);
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[2] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{
+					// bot right
+					v[dim_a] = end_x_coord;
+					v[dim_b] = start_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
+					key.v[dim_b] = (VertPosIntType)start_y;
+					key.misc = (VertPosIntType)(
+						default_used_bit |
+						((end_x >> dim_num_bits) << dim_a)
+						);
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[3] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
 				}
-				face_needed_mat.elem(x, y) = this_face_needed_mat;
-			}
 
-			// For each voxel face:
-			for(int start_y=0; start_y<b_size; ++start_y)
-			for(int start_x=0; start_x<a_size; ++start_x)
+				assert(mesh->vert_positions.size() == vertpos_hash.size());
+			}
+			else
 			{
-				const int start_face_needed_mat = face_needed_mat.elem(start_x, start_y);
-				if(start_face_needed_mat != no_voxel_mat)
+				//================= Add greedy quad for upper face along dim ==========================
+				Indigo::Vec3f v;
+				v[dim] = (float)(dim_coord + dim_min + 1);
+
+				VertPosKeyType key;
+				VertPosIntType dim_initial_used;
+				if(dim_coord == std::numeric_limits<VertPosIntType>::max()) // NOTE: for vertices on upper face of entire voxel volume, we ran out of coordinates (e.g. has value 256 for uint8 keys)
 				{
-					// Start a quad here (start corner at (start_x, start_y))
-					// The quad will range from (start_x, start_y) to (end_x, end_y)
-					int end_x = start_x + 1;
-					int end_y = start_y + 1;
-
-					bool x_increase_ok = true;
-					bool y_increase_ok = true;
-					while(x_increase_ok || y_increase_ok)
-					{
-						// Try and increase in x direction
-						if(x_increase_ok)
-						{
-							if(end_x < a_size) // If there is still room to increase in x direction:
-							{
-								// Check y values for new x = end_x
-								for(int y = start_y; y < end_y; ++y)
-									if(face_needed_mat.elem(end_x, y) != start_face_needed_mat)
-									{
-										x_increase_ok = false;
-										break;
-									}
-
-								if(x_increase_ok)
-									end_x++;
-							}
-							else
-								x_increase_ok = false;
-						}
+					key.v[dim] = 0;
+					dim_initial_used = default_used_bit | (1 << dim);
+				}
+				else
+				{
+					assert((dim_coord + 1) >= 0 && (dim_coord + 1) <= std::numeric_limits<VertPosIntType>::max());
+					key.v[dim] = (VertPosIntType)(dim_coord + 1);
+					dim_initial_used = default_used_bit;
+				}
 
-						// Try and increase in y direction
-						if(y_increase_ok)
-						{
-							if(end_y < b_size)
-							{
-								// Check x values for new y = end_y
-								for(int x = start_x; x < end_x; ++x)
-									if(face_needed_mat.elem(x, end_y) != start_face_needed_mat)
-									{
-										y_increase_ok = false;
-										break;
-									}
-
-								if(y_increase_ok)
-									end_y++;
-							}
-							else
-								y_increase_ok = false;
-						}
-					}
+				assert(start_x >= 0 && start_x <= std::numeric_limits<VertPosIntType>::max());
+				assert(start_y >= 0 && start_y <= std::numeric_limits<VertPosIntType>::max());
+				assert(end_x   >= 0 && end_x   <= std::numeric_limits<VertPosIntType>::max() + 1);
+				assert(end_y   >= 0 && end_y   <= std::numeric_limits<VertPosIntType>::max() + 1);
 
-					// We have worked out the greedy quad.  Mark elements in it as processed
-					for(int y=start_y; y < end_y; ++y)
-					for(int x=start_x; x < end_x; ++x)
-						face_needed_mat.elem(x, y) = no_voxel_mat;
+				const float start_x_coord = (float)(start_x + a_min);
+				const float start_y_coord = (float)(start_y + b_min);
+				const float end_x_coord   = (float)(end_x + a_min);
+				const float end_y_coord   = (float)(end_y + b_min);
 
-					// Add the greedy quad
-					unsigned int v_i[4]; // quad vert indices
-					Indigo::Vec3f v;
-					v[dim] = (float)(dim_coord + dim_min + 1);
+				{ // Add bot left vert
+					v[dim_a] = start_x_coord;
+					v[dim_b] = start_y_coord;
 
-					VertPosKeyType key;
-					VertPosIntType dim_initial_used;
-					if(dim_coord == std::numeric_limits<VertPosIntType>::max()) // NOTE: for vertices on upper face of entire voxel volume, we ran out of coordinates (e.g. has value 256 for uint8 keys)
-					{
-						key.v[dim] = 0;
-						dim_initial_used = default_used_bit | (1 << dim);
-					}
-					else
-					{
-						assert((dim_coord + 1) >= 0 && (dim_coord + 1) <= std::numeric_limits<VertPosIntType>::max());
-						key.v[dim] = (VertPosIntType)(dim_coord + 1);
-						dim_initial_used = default_used_bit;
-					}
+					key.v[dim_a] = (VertPosIntType)start_x;
+					key.v[dim_b] = (VertPosIntType)start_y;
+					key.misc = dim_initial_used;
 
-					assert(start_x >= 0 && start_x <= std::numeric_limits<VertPosIntType>::max());
-					assert(start_y >= 0 && start_y <= std::numeric_limits<VertPosIntType>::max());
-					assert(end_x   >= 0 && end_x   <= std::numeric_limits<VertPosIntType>::max() + 1);
-					assert(end_y   >= 0 && end_y   <= std::numeric_limits<VertPosIntType>::max() + 1);
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[0] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{ // bot right
+					v[dim_a] = end_x_coord;
+					v[dim_b] = start_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
+					key.v[dim_b] = (VertPosIntType)start_y;
+					key.misc = (VertPosIntType)(dim_initial_used |
+						((end_x >> dim_num_bits) << dim_a)
+						);
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[1] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{ // top right
+					v[dim_a] = end_x_coord;
+					v[dim_b] = end_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
+					key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
+					key.misc = (VertPosIntType)(dim_initial_used |
+						((end_x >> dim_num_bits) << dim_a) |
+						((end_y >> dim_num_bits) << dim_b)
+						);
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[2] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+				{ // top left
+					v[dim_a] = start_x_coord;
+					v[dim_b] = end_y_coord;
+
+					key.v[dim_a] = (VertPosIntType)start_x;
+					key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
+					key.misc = (VertPosIntType)(dim_initial_used |
+						((end_y >> dim_num_bits) << dim_b)
+						);
+
+					const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
+					v_i[3] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
+					if(insert_res.second) // If inserted new value:
+						mesh->vert_positions.push_back(v);
+				}
+			}
 
-					const float start_x_coord = (float)(start_x + a_min);
-					const float start_y_coord = (float)(start_y + b_min);
-					const float end_x_coord   = (float)(end_x + a_min);
-					const float end_y_coord   = (float)(end_y + b_min);
+			const size_t tri_start = mesh->triangles.size();
+			mesh->triangles.resize(tri_start + 2);
+
+			assert(start_face_needed_mat != std::numeric_limits<VoxelMatIndexType>::max());
+
+			mesh->triangles[tri_start + 0].vertex_indices[0] = v_i[0];
+			mesh->triangles[tri_start + 0].vertex_indices[1] = v_i[1];
+			mesh->triangles[tri_start + 0].vertex_indices[2] = v_i[2];
+			mesh->triangles[tri_start + 0].uv_indices[0]     = 0;
+			mesh->triangles[tri_start + 0].uv_indices[1]     = 0;
+			mesh->triangles[tri_start + 0].uv_indices[2]     = 0;
+			mesh->triangles[tri_start + 0].tri_mat_index     = (uint32)start_face_needed_mat;
+
+			mesh->triangles[tri_start + 1].vertex_indices[0] = v_i[0];
+			mesh->triangles[tri_start + 1].vertex_indices[1] = v_i[2];
+			mesh->triangles[tri_start + 1].vertex_indices[2] = v_i[3];
+			mesh->triangles[tri_start + 1].uv_indices[0]     = 0;
+			mesh->triangles[tri_start + 1].uv_indices[1]     = 0;
+			mesh->triangles[tri_start + 1].uv_indices[2]     = 0;
+			mesh->triangles[tri_start + 1].tri_mat_index     = (uint32)start_face_needed_mat;
+		}
+	}
+}
 
-					{ // Add bot left vert
-						v[dim_a] = start_x_coord;
-						v[dim_b] = start_y_coord;
 
-						key.v[dim_a] = (VertPosIntType)start_x;
-						key.v[dim_b] = (VertPosIntType)start_y;
-						key.misc = dim_initial_used;
+// Does greedy meshing of the voxel array.
+// Faces are culled and greedy quads found in each slice of the voxel array, using per-slice bitmasks so that 64 voxels are processed at once, and so that empty regions of a slice are skipped quickly.
+// If task_manager is non-null and the voxel array is large, slices are split into ranges that are processed in parallel.
+// Vertices and triangles are then created for the quads on the calling thread, in the same order regardless of how slices were split.
+static void makeVoxelMesh(const VoxelBounds& bounds, const Vec3<int>& res, const Array3D<VoxelMatIndexType>& voxel_array, size_t num_orig_voxels, const js::Vector<bool, 16>& mats_transparent_,
+	glare::TaskManager* task_manager, Indigo::Mesh* mesh, glare::Allocator* mem_allocator)
+{
+	const VoxelMatIndexType no_voxel_mat = std::numeric_limits<VoxelMatIndexType>::max();
 
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[0] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{ // bot right
-						v[dim_a] = end_x_coord;
-						v[dim_b] = start_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
-						key.v[dim_b] = (VertPosIntType)start_y;
-						key.misc = (VertPosIntType)(dim_initial_used |
-							((end_x >> dim_num_bits) << dim_a)
-							);
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[1] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{ // top right
-						v[dim_a] = end_x_coord;
-						v[dim_b] = end_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)(end_x & dim_mask_val);
-						key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
-						key.misc = (VertPosIntType)(dim_initial_used |
-							((end_x >> dim_num_bits) << dim_a) |
-							((end_y >> dim_num_bits) << dim_b)
-							);
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[2] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
-					{ // top left
-						v[dim_a] = start_x_coord;
-						v[dim_b] = end_y_coord;
-
-						key.v[dim_a] = (VertPosIntType)start_x;
-						key.v[dim_b] = (VertPosIntType)(end_y & dim_mask_val);
-						key.misc = (VertPosIntType)(dim_initial_used |
-							((end_y >> dim_num_bits) << dim_b)
-							);
-
-						const auto insert_res = vertpos_hash.insert(std::make_pair(key, (int)vertpos_hash.size()));
-						v_i[3] = insert_res.first->second; // deref iterator to get (key, index) pair, then get the index.
-						if(insert_res.second) // If inserted new value:
-							mesh->vert_positions.push_back(v);
-					}
+	// Build a local array of flags for each material.  If no entry in mats_transparent_ for a given index, assume opaque.
+	uint8 mat_flags[256];
+	for(size_t i=0; i<256; ++i)
+	{
+		const bool transparent = (i < mats_transparent_.size()) && mats_transparent_[i];
+		mat_flags[i] = MAT_FLAG_OCCUPIED | (transparent ? MAT_FLAG_TRANSPARENT : MAT_FLAG_BLOCKING);
+	}
+	mat_flags[no_voxel_mat] = 0;
 
-					const size_t tri_start = mesh->triangles.size();
-					mesh->triangles.resize(tri_start + 2);
-
-					assert(start_face_needed_mat != no_voxel_mat);
-
-					mesh->triangles[tri_start + 0].vertex_indices[0] = v_i[0];
-					mesh->triangles[tri_start + 0].vertex_indices[1] = v_i[1];
-					mesh->triangles[tri_start + 0].vertex_indices[2] = v_i[2];
-					mesh->triangles[tri_start + 0].uv_indices[0]     = 0;
-					mesh->triangles[tri_start + 0].uv_indices[1]     = 0;
-					mesh->triangles[tri_start + 0].uv_indices[2]     = 0;
-					mesh->triangles[tri_start + 0].tri_mat_index     = (uint32)start_face_needed_mat;
-
-					mesh->triangles[tri_start + 1].vertex_indices[0] = v_i[0];
-					mesh->triangles[tri_start + 1].vertex_indices[1] = v_i[2];
-					mesh->triangles[tri_start + 1].vertex_indices[2] = v_i[3];
-					mesh->triangles[tri_start + 1].uv_indices[0]     = 0;
-					mesh->triangles[tri_start + 1].uv_indices[1]     = 0;
-					mesh->triangles[tri_start + 1].uv_indices[2]     = 0;
-					mesh->triangles[tri_start + 1].tri_mat_index     = (uint32)start_face_needed_mat;
-				}
-			}
-		}
+	const int64 voxel_array_size = (int64)res.x * (int64)res.y * (int64)res.z;
+	const bool do_parallel = task_manager && (task_manager->getConcurrency() > 1) && (voxel_array_size >= MIN_VOXEL_ARRAY_SIZE_FOR_PARALLEL_MESHING);
 
-		//conPrint("Dim " + toString(dim) + " took " + dim_timer.elapsedStringNSigFigs(4));
-	} // End for each dim
-}
+	// Make tasks for finding quads, in order of dim, then slice range.
+	std::vector<Reference<FindVoxelQuadsTask>> tasks;
+	for(int dim=0; dim<3; ++dim)
+	{
+		const int dim_size = res[dim];
+		const int num_ranges = do_parallel ? myClamp(dim_size / MIN_SLICES_PER_TASK, 1, (int)task_manager->getConcurrency()) : 1;
+		const int slices_per_range = Maths::roundedUpDivide(dim_size, num_ranges);
+		for(int slice_begin=0; slice_begin<dim_size; slice_begin += slices_per_range)
+		{
+			Reference<FindVoxelQuadsTask> task = new FindVoxelQuadsTask();
+			task->voxel_array = &voxel_array;
+			task->res = res;
+			task->mat_flags = mat_flags;
+			task->dim = dim;
+			task->slice_begin = slice_begin;
+			task->slice_end = myMin(slice_begin + slices_per_range, dim_size);
+			tasks.push_back(task);
+		}
+	}
 
+	if(do_parallel)
+	{
+		Reference<glare::TaskGroup> task_group = new glare::TaskGroup();
+		task_group->tasks.resize(tasks.size());
+		for(size_t i=0; i<tasks.size(); ++i)
+			task_group->tasks[i] = tasks[i].ptr();
 
+		task_manager->runTaskGroup(task_group);
+	}
+	else
+	{
+		for(size_t i=0; i<tasks.size(); ++i)
+			tasks[i]->run(/*thread_index=*/0);
+	}
 
+	if(res[0] <= 256 && res[1] <= 256 && res[2] <= 256)
+		addQuadsToMesh<VertPosKeyInt8, uint8, VertPosKeyInt8HashFunc>(bounds, tasks, num_orig_voxels, mesh, mem_allocator);
+	else
+		addQuadsToMesh<VertPosKeyInt16, uint16, VertPosKeyInt16HashFunc>(bounds, tasks, num_orig_voxels, mesh, mem_allocator);
+}
 
 
 // Does greedy meshing.
 // Splats voxels to 3d array.
-static Reference<Indigo::Mesh> doMakeIndigoMeshForVoxelGroupWith3dArray(const glare::AllocatorVector<Voxel, 16>& voxels, int subsample_factor, const js::Vector<bool, 16>& mats_transparent_, glare::Allocator* mem_allocator)
+static Reference<Indigo::Mesh> doMakeIndigoMeshForVoxelGroupWith3dArray(const glare::AllocatorVector<Voxel, 16>& voxels, int subsample_factor, const js::Vector<bool, 16>& mats_transparent_, glare::Allocator* mem_allocator,
+	glare::TaskManager* task_manager)
 {
 #if GUI_CLIENT
 	PERFORMANCEAPI_INSTRUMENT_FUNCTION();
@@ -667,14 +816,7 @@ static Reference<Indigo::Mesh> doMakeIndigoMeshForVoxelGroupWith3dArray(const gl
 		//if(voxel_array.getData().size() > 100000)
 		//	conPrint("voxel_array size: " + toString(voxel_array.getData().size()) + " elems, " + toString(voxel_array.getData().dataSizeBytes()) + " B");
 
-		if(res[0] <= 256 && res[1] <= 256 && res[2] <= 256)
-		{
-			makeVoxelMeshForVertPosKeyType<VertPosKeyInt8, uint8, VertPosKeyInt8HashFunc>(bounds, res, voxel_array, voxels.size(), mats_transparent_, mesh.ptr(), mem_allocator);
-		}
-		else
-		{
-			makeVoxelMeshForVertPosKeyType<VertPosKeyInt16, uint16, VertPosKeyInt16HashFunc>(bounds, res, voxel_array, voxels.size(), mats_transparent_, mesh.ptr(), mem_allocator);
-		}
+		makeVoxelMesh(bounds, res, voxel_array, voxels.size(), mats_transparent_, task_manager, mesh.ptr(), mem_allocator);
 
 		mesh->endOfModel();
 		assert(isFinite(mesh->aabb_os.bound[0].x));
@@ -1174,12 +1316,12 @@ Reference<Indigo::Mesh> VoxelMeshBuilding::makeIndigoMeshWithShadingNormalsForVo
 
 
 Reference<Indigo::Mesh> VoxelMeshBuilding::makeIndigoMeshForVoxelGroup(const VoxelGroup& voxel_group, const int subsample_factor, const js::Vector<bool, 16>& mats_transparent,
-	glare::Allocator* mem_allocator)
+	glare::Allocator* mem_allocator, glare::TaskManager* task_manager)
 {
 	assert(voxel_group.voxels.size() > 0);
 	// conPrint("Adding " + toString(voxel_group.voxels.size()) + " voxels.");
 
-	return doMakeIndigoMeshForVoxelGroupWith3dArray(voxel_group.voxels, subsample_factor, mats_transparent, mem_allocator);
+	return doMakeIndigoMeshForVoxelGroupWith3dArray(voxel_group.voxels, subsample_factor, mats_transparent, mem_allocator, task_manager);
 }
 
 
@@ -1499,6 +1641,43 @@ void VoxelMeshBuilding::test()
 		}
 	}
 
+	// Test that parallel meshing of a large group gives the same result as serial meshing.
+	{
+		VoxelGroup group;
+		for(int z=0; z<80; ++z)
+		for(int y=0; y<80; ++y)
+		for(int x=0; x<80; ++x)
+		{
+			// A pattern with solid regions, holes and some thin walls, using several materials.
+			const int h = (x * 7 + y * 13 + z * 31) % 17;
+			if(h < 11 || (x % 20 == 0))
+				group.voxels.push_back(Voxel(Vec3<int>(x, y, z), (x / 10 + z / 25) % 4));
+		}
+
+		js::Vector<bool, 16> mat_transparent(4, false);
+		mat_transparent[1] = true;
+		mat_transparent[3] = true;
+
+		for(int subsample_factor=1; subsample_factor<=2; subsample_factor *= 2)
+		{
+			Reference<Indigo::Mesh> serial_mesh   = makeIndigoMeshForVoxelGroup(group, subsample_factor, mat_transparent, /*allocator=*/NULL, /*task_manager=*/NULL);
+			Reference<Indigo::Mesh> parallel_mesh = makeIndigoMeshForVoxelGroup(group, subsample_factor, mat_transparent, /*allocator=*/NULL, &task_manager);
+
+			testAssert(serial_mesh->triangles.size() > 0);
+			testAssert(serial_mesh->num_materials_referenced == parallel_mesh->num_materials_referenced);
+			testAssert(serial_mesh->vert_positions.size() == parallel_mesh->vert_positions.size());
+			testAssert(serial_mesh->triangles.size() == parallel_mesh->triangles.size());
+			for(size_t i=0; i<serial_mesh->vert_positions.size(); ++i)
+				testAssert(serial_mesh->vert_positions[i] == parallel_mesh->vert_positions[i]);
+			for(size_t i=0; i<serial_mesh->triangles.size(); ++i)
+			{
+				for(int c=0; c<3; ++c)
+					testAssert(serial_mesh->triangles[i].vertex_indices[c] == parallel_mesh->triangles[i].vertex_indices[c]);
+				testAssert(serial_mesh->triangles[i].tri_mat_index == parallel_mesh->triangles[i].tri_mat_index);
+			}
+		}
+	}
+
 	conPrint("VoxelMeshBuilding::test() done.");
 }
 
@@ -10,7 +10,7 @@ Copyright Glare Technologies Limited 2022 -
 #include <maths/vec3.h>
 #include <utils/Vector.h>
 class VoxelGroup;
-namespace glare { class Allocator; }
+namespace glare { class Allocator; class TaskManager; }
 
 
 /*=====================================================================
@@ -23,8 +23,9 @@ class VoxelMeshBuilding
 {
 public:
 	// If mats_transparent is lacking entries for a particular material index, the material is assumed to be opaque.
+	// If task_manager is non-null, large voxel groups are meshed in parallel using it.  The resulting mesh is the same either way.
 	static Reference<Indigo::Mesh> makeIndigoMeshForVoxelGroup(const VoxelGroup& voxel_group, const int subsample_factor, const js::Vector<bool, 16>& mats_transparent,
-		glare::Allocator* mem_allocator);
+		glare::Allocator* mem_allocator, glare::TaskManager* task_manager = nullptr);
 
 
 	// Build a mesh with shading normals and UVs.  This is used in ChunkGenThread.
@@ -10,6 +10,7 @@ Copyright Glare Technologies Limited 2016 -
 #include "LuaScriptEvaluator.h"
 #include "ObjectEventHandlers.h"
 #include "URLUtils.h"
+#include "Protocol.h"
 #if GUI_CLIENT
 #include "../audio/AudioEngine.h"
 #include "../gui_client/WinterShaderEvaluator.h"
@@ -82,6 +83,10 @@ WorldObject::WorldObject() noexcept
 	changed_flags = 0;
 	using_placeholder_model = false;
 
+#if SERVER
+	network_serialisation_cache_valid = false;
+#endif
+
 #if GUI_CLIENT
 	is_selected = false;
 	in_proximity = false;
@@ -158,6 +163,12 @@ URLString WorldObject::makeOptimisedMeshURL(const URLString& base_model_url, int
 }
 
 
+URLString WorldObject::getPhysicsShapeURLForModelURL(const URLString& lod_model_url, bool dynamic, glare::ArenaAllocator* arena_allocator)
+{
+	return URLUtils::makePhysicsShapeURL(lod_model_url, dynamic, Protocol::PHYSICS_SHAPE_VERSION, arena_allocator);
+}
+
+
 URLString WorldObject::getLODModelURLForLevel(const URLString& base_model_url, int lod_level, const GetLODModelURLOptions& options)
 {
 	if((lod_level == 0) && !options.get_optimised_mesh)
@@ -299,7 +310,18 @@ void WorldObject::appendDependencyURLs(int ob_lod_level, const GetDependencyOpti
 
 		GetLODModelURLOptions url_options(/*get_optimised_mesh=*/options.get_optimised_mesh, options.opt_mesh_version);
 		url_options.allocator = options.allocator;
-		URLs_out.push_back(DependencyURL(getLODModelURLForLevel(model_url, ob_model_lod_level, url_options)));
+		const URLString lod_model_url = getLODModelURLForLevel(model_url, ob_model_lod_level, url_options);
+		URLs_out.push_back(DependencyURL(lod_model_url));
+
+		if(options.get_physics_shape)
+		{
+			DependencyURL physics_shape_dependency_url(getPhysicsShapeURLForModelURL(lod_model_url, this->isDynamic(), options.allocator));
+			if(!physics_shape_dependency_url.URL.empty())
+			{
+				physics_shape_dependency_url.is_physics_shape = true;
+				URLs_out.push_back(physics_shape_dependency_url);
+			}
+		}
 	}
 
 	if(options.include_lightmaps && !lightmap_url.empty())
@@ -1011,6 +1033,21 @@ void WorldObject::writeToNetworkStream(RandomAccessOutStream& stream) const // W
 }
 
 
+#if SERVER
+void WorldObject::writeToNetworkStreamCached(RandomAccessOutStream& stream)
+{
+	if(!network_serialisation_cache_valid)
+	{
+		network_serialisation_cache.buf.resize(0);
+		writeToNetworkStream(network_serialisation_cache);
+		network_serialisation_cache_valid = true;
+	}
+
+	stream.writeData(network_serialisation_cache.buf.data(), network_serialisation_cache.buf.size());
+}
+#endif
+
+
 void WorldObject::copyNetworkStateFrom(const WorldObject& other)
 {
 	// NOTE: The data in here needs to match that in readFromNetworkStreamGivenUID()
@@ -1064,6 +1101,10 @@ void WorldObject::copyNetworkStateFrom(const WorldObject& other)
 
 
 	exclude_from_lod_chunk_mesh = BitUtils::isBitSet(flags, WorldObject::EXCLUDE_FROM_LOD_CHUNK_MESH);
+
+#if SERVER
+	invalidateNetworkSerialisationCache();
+#endif
 }
 
 
@@ -1962,11 +2003,49 @@ static void testObjectsEqual(WorldObject& ob1, WorldObject& ob2)
 }
 
 
+#if SERVER
+static bool buffersEqual(const BufferOutStream& a, const BufferOutStream& b)
+{
+	return (a.buf.size() == b.buf.size()) && (a.buf.size() == 0 || std::memcmp(a.buf.data(), b.buf.data(), a.buf.size()) == 0);
+}
+#endif
+
+
 void WorldObject::test()
 {
 	conPrint("WorldObject::test()");
 
 
+#if SERVER
+	//----------------------------- Test writeToNetworkStreamCached ------------------------------
+	{
+		WorldObject ob;
+		ob.uid = UID(123);
+		ob.model_url = "model.bmesh";
+		ob.pos = Vec3d(1, 2, 3);
+
+		BufferOutStream uncached;
+		ob.writeToNetworkStream(uncached);
+
+		BufferOutStream cached;
+		ob.writeToNetworkStreamCached(cached);
+		testAssert(buffersEqual(cached, uncached));
+
+		// Should give the same result when written from the cache.
+		cached.buf.resize(0);
+		ob.writeToNetworkStreamCached(cached);
+		testAssert(buffersEqual(cached, uncached));
+
+		// After changing and invalidating, should reflect the change.
+		ob.pos = Vec3d(4, 5, 6);
+		ob.invalidateNetworkSerialisationCache();
+		uncached.buf.resize(0);
+		ob.writeToNetworkStream(uncached);
+		cached.buf.resize(0);
+		ob.writeToNetworkStreamCached(cached);
+		testAssert(buffersEqual(cached, uncached));
+	}
+#endif
 
 
 	//----------------------------- Test obToWorldMatrix ------------------------------
@@ -2021,6 +2100,12 @@ void WorldObject::test()
 	testAssert(getLODModelURLForLevel("base", /*lod level=*/2, GetLODModelURLOptions(/*get optimised mesh=*/true, /*opt mesh version=*/89)) == "base_lod2_opt89.bmesh");
 
 
+	//----------------------------- Test getPhysicsShapeURLForModelURL ----------------------------
+	testAssert(getPhysicsShapeURLForModelURL("something_5345345435_opt3.bmesh", /*dynamic=*/false) == toURLString("something_5345345435_opt3_meshshape" + toString(Protocol::PHYSICS_SHAPE_VERSION) + ".joltshape"));
+	testAssert(getPhysicsShapeURLForModelURL("something_5345345435_lod2_opt3.bmesh", /*dynamic=*/true) == toURLString("something_5345345435_lod2_opt3_hullshape" + toString(Protocol::PHYSICS_SHAPE_VERSION) + ".joltshape"));
+	testAssert(getPhysicsShapeURLForModelURL("something_5345345435.subvox", /*dynamic=*/false).empty());
+	testAssert(getPhysicsShapeURLForModelURL("https://example.com/something.bmesh", /*dynamic=*/false).empty());
+
 	//----------------------------- Test getLODLevelForURL ----------------------------
 	testAssert(getLODLevelForURL("something_5345345435.bmesh") == 0);
 	testAssert(getLODLevelForURL("something_5345345435_lod1.bmesh") == 1);
@@ -27,6 +27,9 @@ Copyright Glare Technologies Limited 2016 -
 //#include "../gui_client/MeshManager.h"
 //#include <graphics/ImageMap.h>
 #endif
+#if SERVER
+#include <utils/BufferOutStream.h>
+#endif
 #include <string>
 #include <vector>
 #include <set>
@@ -175,6 +178,8 @@ public:
 	static OpenGLTextureKey getLODLightmapPathForLevel(const OpenGLTextureKey& base_lightmap_path, int level);
 #endif
 	static URLString makeOptimisedMeshURL(const URLString& base_model_url, int lod_level, bool get_optimised_mesh, int opt_mesh_version, glare::ArenaAllocator* allocator = nullptr);
+	// Returns the URL of the server-built physics shape for the given LOD model URL, or the empty string if there isn't one.
+	static URLString getPhysicsShapeURLForModelURL(const URLString& lod_model_url, bool dynamic, glare::ArenaAllocator* allocator = nullptr);
 
 	inline int getLODLevel(const Vec3d& campos) const;
 	inline int getLODLevel(const Vec4f& campos) const;
@@ -187,11 +192,12 @@ public:
 	// Sometimes we are not interested in all dependencies, such as lightmaps.  So make returning those optional.
 	struct GetDependencyOptions
 	{
-		GetDependencyOptions() : include_lightmaps(true), use_basis(true), get_optimised_mesh(false), opt_mesh_version(-1), allocator(nullptr) {}
+		GetDependencyOptions() : include_lightmaps(true), use_basis(true), get_optimised_mesh(false), opt_mesh_version(-1), get_physics_shape(false), allocator(nullptr) {}
 		bool include_lightmaps;
 		bool use_basis;
 		bool get_optimised_mesh;
 		int opt_mesh_version;
+		bool get_physics_shape; // Include the server-built physics shape for the model.  Only set if the server has Protocol::PHYSICS_SHAPE_SUPPORT.
 		glare::ArenaAllocator* allocator;
 	};
 	void appendDependencyURLs(int ob_lod_level, const GetDependencyOptions& options, DependencyURLVector& URLs_out) const;
@@ -239,6 +245,12 @@ public:
 
 	void writeToStream(RandomAccessOutStream& stream) const;
 	void writeToNetworkStream(RandomAccessOutStream& stream) const; // Write without version
+#if SERVER
+	// Writes the same data as writeToNetworkStream(), but from a cached copy that is built on first use and shared by all clients the object is sent to.
+	// The world state mutex should be held.
+	void writeToNetworkStreamCached(RandomAccessOutStream& stream);
+	void invalidateNetworkSerialisationCache() { network_serialisation_cache_valid = false; }
+#endif
 
 	void copyNetworkStateFrom(const WorldObject& other);
 
@@ -536,6 +548,15 @@ public:
 	double last_touch_event_time;
 #endif // GUI_CLIENT
 
+#if SERVER
+	// Cached writeToNetworkStream() output.  Invalidated by ServerWorldState::addWorldObjectAsDBDirty(), and by the server for each object in
+	// dirty_from_remote_objects before sending updates.
+	// Code that changes a serialised field without doing either of those (e.g. physics ownership changes, which aren't saved to the DB)
+	// must call invalidateNetworkSerialisationCache() itself.
+	BufferOutStream network_serialisation_cache;
+	bool network_serialisation_cache_valid;
+#endif
+
 	float max_load_dist2;
 	
 	/*
@@ -97,6 +97,7 @@ public:
 	uint32 flags;
 
 	static const uint32 USE_SPAWN_POINT_FLAG = 1;
+	static const uint32 SERVER_VOICE_MIXING_FLAG = 2; // If set, the server mixes distant voice chat speakers into per-region streams.  See ServerVoiceMixer.
 
 	Vec3d spawn_point; // Default starting position for visitors.  Used if USE_SPAWN_POINT_FLAG is set in flags.
 
@@ -9,6 +9,11 @@ Copyright Glare Technologies Limited 2024 -
 #include <utils/ThreadSafetyAnalysis.h>
 #include <utils/Lock.h>
 #include <utils/Mutex.h>
+#if SERVER
+#include <utils/Timer.h>
+#include "../server/ServerMetrics.h"
+#include "../server/ServerProfiler.h"
+#endif
 
 
 /*=====================================================================
@@ -22,19 +27,58 @@ class WorldStateMutex : public Mutex
 };
 
 
+#if SERVER
+// Base class of WorldStateLock that is constructed before the Lock base class acquires the mutex, so the timer measures the time spent waiting for the mutex.
+class WorldStateLockTiming
+{
+protected:
+	Timer lock_timer;
+};
+#endif
+
+
 /*=====================================================================
 WorldStateLock
 --------------
+On the server, records the time spent waiting for the mutex, and the time
+it was held, in ServerMetrics, and as trace events if a ServerProfiler
+capture is running.
 =====================================================================*/
-class SCOPED_CAPABILITY WorldStateLock : public Lock
+class SCOPED_CAPABILITY WorldStateLock : 
+#if SERVER
+	private WorldStateLockTiming,
+#endif
+	public Lock
 {
 public:
 	WorldStateLock(WorldStateMutex& mutex_) ACQUIRE(mutex_) // blocking
 	:	Lock(mutex_)
-	{}
+	{
+#if SERVER
+		const double wait_time = lock_timer.elapsed();
+		ServerMetrics::get().world_state_lock_wait->recordSeconds(wait_time);
+		TracyPlot("WorldStateLock wait (ms)", wait_time * 1.0e3);
+		lock_timer.reset();
+		if(ServerProfiler::isCapturing())
+		{
+			const double cur_time = ServerProfiler::getCurTime();
+			ServerProfiler::get().recordEvent("WorldStateLock wait", cur_time - wait_time, cur_time);
+		}
+#endif
+	}
 
 	~WorldStateLock() RELEASE()
-	{}
+	{
+#if SERVER
+		const double hold_time = lock_timer.elapsed();
+		ServerMetrics::get().world_state_lock_hold->recordSeconds(hold_time);
+		if(ServerProfiler::isCapturing())
+		{
+			const double cur_time = ServerProfiler::getCurTime();
+			ServerProfiler::get().recordEvent("WorldStateLock held", cur_time - hold_time, cur_time);
+		}
+#endif
+	}
 private:
 	GLARE_DISABLE_COPY(WorldStateLock);
 };
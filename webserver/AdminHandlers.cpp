@@ -14,7 +14,10 @@ Copyright Glare Technologies Limited 2021 -
 #include "WebServerResponseUtils.h"
 #include "LoginHandlers.h"
 #include "WorldHandlers.h"
+#include "AdminPagination.h"
 #include "../server/ServerWorldState.h"
+#include "../server/ServerMetrics.h"
+#include "../server/ServerProfiler.h"
 #include <ConPrint.h>
 #include <Exception.h>
 #include <Lock.h>
@@ -26,13 +29,20 @@ namespace AdminHandlers
 {
 
 
+// Returns the value of the URL param, or the empty string if it is not present.
+static std::string getURLParamOrEmpty(const web::RequestInfo& request, const std::string& name)
+{
+	return request.isURLParamPresent(name) ? request.getURLParam(name).str() : std::string();
+}
+
+
 std::string sharedAdminHeader(ServerAllWorldsState& world_state, const web::RequestInfo& request_info)
 {
 	std::string page_out = WebServerResponseUtils::standardHeader(world_state, request_info, /*page title=*/"Admin");
 
 	page_out += "<p><a href=\"/admin\">Main admin page</a> | <a href=\"/admin_users\">Users</a> | <a href=\"/admin_parcels\">Parcels</a> | ";
 	page_out += "<a href=\"/admin_parcel_auctions\">Parcel Auctions</a> | <a href=\"/admin_orders\">Orders</a> | <a href=\"/admin_sub_eth_transactions\">Eth Transactions</a> | <a href=\"/admin_map\">Map</a> | ";
-	page_out += "<a href=\"/admin_news_posts\">News Posts</a> | <a href=\"/admin_lod_chunks\">LOD Chunks</a> | <a href=\"/admin_worlds\">Worlds</a> | <a href=\"/admin_gear\">Gear</a> </p>";
+	page_out += "<a href=\"/admin_news_posts\">News Posts</a> | <a href=\"/admin_lod_chunks\">LOD Chunks</a> | <a href=\"/admin_worlds\">Worlds</a> | <a href=\"/admin_gear\">Gear</a> | <a href=\"/metrics\">Metrics</a> </p>";
 
 	return page_out;
 }
@@ -88,6 +98,14 @@ void renderMainAdminPage(ServerAllWorldsState& world_state, const web::RequestIn
 
 	page_out += "<br/><br/>";
 
+	page_out += "<p>Trace capture: " + web::Escaping::HTMLEscape(ServerProfiler::get().getStatusDescription()) + "</p>";
+	page_out += "<form action=\"/admin_start_trace_capture_post\" method=\"post\">";
+	page_out += "<input type=\"number\" name=\"duration\" value=\"10\">";
+	page_out += "<input type=\"submit\" value=\"Start trace capture (duration in s)\">";
+	page_out += "</form>";
+
+	page_out += "<br/><br/>";
+
 	{ // Lock scope
 		Lock lock(world_state.mutex);
 
@@ -155,34 +173,76 @@ void renderUsersPage(ServerAllWorldsState& world_state, const web::RequestInfo&
 		return;
 	}
 
-	std::string page_out = sharedAdminHeader(world_state, request);
+	const AdminPagination::PageParams params = AdminPagination::parsePageParams(request, /*default_descending=*/true);
+	const bool sort_by_name = getURLParamOrEmpty(request, "sort") == "name";
+	const std::string search = getURLParamOrEmpty(request, "search");
+
+	// Copy the fields to display for the users on this page while holding the lock, then build the HTML after releasing it.
+	struct UserRow
+	{
+		std::string id, name, email_address, joined, controlled_eth_address;
+	};
+	std::vector<UserRow> rows;
+	std::string next_cursor;
 
 	{ // Lock scope
 		Lock lock(world_state.mutex);
 
-		// Print out users
-		page_out += "<h2>Users</h2>\n";
-
-		for(auto it = world_state.user_id_to_users.begin(); it != world_state.user_id_to_users.end(); ++it)
+		auto filter = [&](const Reference<User>& user)
 		{
-			const User* user = it->second.ptr();
-			page_out += "<div>\n";
-			page_out += "<a href=\"/admin_user/" + user->id.toString() + "\">id: " + user->id.toString() + "</a>,       username: " + web::Escaping::HTMLEscape(user->name) + ",       email: " + web::Escaping::HTMLEscape(user->email_address) + ",      joined " + user->created_time.timeAgoDescription() +
-				"  linked eth address: <span class=\"eth-address\">" + user->controlled_eth_address + "</span>";
-			page_out += "</div>\n";
+			return search.empty() || (user->name.find(search) != std::string::npos) || (user->email_address.find(search) != std::string::npos);
+		};
+		auto process = [&](const Reference<User>& user)
+		{
+			UserRow row;
+			row.id = user->id.toString();
+			row.name = user->name;
+			row.email_address = user->email_address;
+			row.joined = user->created_time.timeAgoDescription();
+			row.controlled_eth_address = user->controlled_eth_address;
+			rows.push_back(row);
+		};
+
+		if(sort_by_name) // Use the username index
+		{
+			const auto res = AdminPagination::walkPage(world_state.name_to_users, params,
+				[&](const std::string& /*name*/, const Reference<User>& user) { return filter(user); }, [&](const std::string& /*name*/, const Reference<User>& user) { process(user); });
+			next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
 		}
-
-		/*page_out += "<table>";
-		for(auto it = world_state.user_id_to_users.begin(); it != world_state.user_id_to_users.end(); ++it)
+		else
 		{
-		const User* user = it->second.ptr();
-		page_out += "<tr>\n";
-		page_out += "<td>" + user->id.toString() + "</td><td>" + web::Escaping::HTMLEscape(user->name) + "</td><td>" + web::Escaping::HTMLEscape(user->email_address) + "</td><td>" + user->created_time.timeAgoDescription() + "</td>";
-		page_out += "</tr>\n";
+			const auto res = AdminPagination::walkPage(world_state.user_id_to_users, params,
+				[&](const UserID& /*id*/, const Reference<User>& user) { return filter(user); }, [&](const UserID& /*id*/, const Reference<User>& user) { process(user); });
+			next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
 		}
-		page_out += "</table>";*/
 	} // End Lock scope
 
+	std::string page_out = sharedAdminHeader(world_state, request);
+
+	page_out += "<h2>Users</h2>\n";
+
+	page_out += "<form action=\"/admin_users\" method=\"get\">";
+	page_out += "<input type=\"hidden\" name=\"sort\" value=\"" + std::string(sort_by_name ? "name" : "id") + "\">";
+	page_out += "Username or email contains: <input type=\"text\" name=\"search\" value=\"" + web::Escaping::HTMLEscape(search) + "\">";
+	page_out += "<input type=\"submit\" value=\"Search\">";
+	page_out += "</form>";
+
+	const std::string base_url = "/admin_users?sort=" + std::string(sort_by_name ? "name" : "id") + (search.empty() ? "" : ("&search=" + web::Escaping::URLEscape(search)));
+	page_out += "<p>Sort by: <a href=\"/admin_users?sort=id\">Join order</a> | <a href=\"/admin_users?sort=name\">Username</a></p>";
+	const std::string page_links = AdminPagination::makePageLinksForCursor(base_url, params, next_cursor, sort_by_name ? "A-Z" : "Oldest first", sort_by_name ? "Z-A" : "Newest first");
+	page_out += page_links;
+
+	for(size_t i=0; i<rows.size(); ++i)
+	{
+		const UserRow& row = rows[i];
+		page_out += "<div>\n";
+		page_out += "<a href=\"/admin_user/" + row.id + "\">id: " + row.id + "</a>,       username: " + web::Escaping::HTMLEscape(row.name) + ",       email: " + web::Escaping::HTMLEscape(row.email_address) + ",      joined " + row.joined +
+			"  linked eth address: <span class=\"eth-address\">" + web::Escaping::HTMLEscape(row.controlled_eth_address) + "</span>";
+		page_out += "</div>\n";
+	}
+
+	page_out += page_links;
+
 	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page_out);
 }
 
@@ -266,55 +326,41 @@ void renderParcelsPage(ServerAllWorldsState& world_state, const web::RequestInfo
 		return;
 	}
 
-	std::string page_out = sharedAdminHeader(world_state, request);
-
-	{ // Lock scope
-		Lock lock(world_state.mutex);
-
-		page_out += "<h2>Root world Parcels</h2>\n";
-
-		//-----------------------
-		page_out += "<hr/>";
-		page_out += "<form action=\"/admin_regenerate_multiple_parcel_screenshots\" method=\"post\">";
-		page_out += "start parcel id: <input type=\"number\" name=\"start_parcel_id\" value=\"" + toString(0) + "\"><br/>";
-		page_out += "end parcel id: <input type=\"number\" name=\"end_parcel_id\" value=\"" + toString(10) + "\"><br/>";
-		page_out += "<input type=\"submit\" value=\"Regenerate/recreate parcel screenshots\" onclick=\"return confirm('Are you sure you want to recreate parcel screenshots?');\" >";
-		page_out += "</form>";
-		page_out += "<hr/>";
-		//-----------------------
-
-		//-----------------------
-		page_out += "<hr/>";
-		page_out += "<form action=\"/admin_create_parcel\" method=\"post\">";
-		page_out += "<input type=\"submit\" value=\"Create new parcel\" onclick=\"return confirm('Are you sure you want to create a parcel?');\" >";
-		page_out += "</form>";
-		page_out += "<hr/>";
-		//-----------------------
+	const AdminPagination::PageParams params = AdminPagination::parsePageParams(request, /*default_descending=*/false);
+	const std::string owner_param = getURLParamOrEmpty(request, "owner");
+	UserID owner_id;
+	const bool filter_by_owner = AdminPagination::decodeCursor(owner_param, owner_id);
 
+	// Copy the fields to display for the parcels on this page while holding the lock, then build the HTML after releasing it.
+	struct ParcelRow
+	{
+		std::string id, owner_username, description, created, auctions_html;
+	};
+	std::vector<ParcelRow> rows;
+	std::string next_cursor;
 
+	{ // Lock scope
+		WorldStateLock lock(world_state.mutex);
 
 		Reference<ServerWorldState> root_world = world_state.getRootWorldState();
+		const ServerWorldState::ParcelMapType& parcels = root_world->getParcels(lock);
 
-		for(auto it = root_world->parcels.begin(); it != root_world->parcels.end(); ++it)
+		auto process = [&](const Parcel* parcel)
 		{
-			const Parcel* parcel = it->second.ptr();
+			ParcelRow row;
+			row.id = parcel->id.toString();
 
 			// Look up owner
-			std::string owner_username;
 			auto user_res = world_state.user_id_to_users.find(parcel->owner_id);
 			if(user_res == world_state.user_id_to_users.end())
-				owner_username = "[No user found]";
+				row.owner_username = "[No user found]";
 			else
-				owner_username = user_res->second->name;
+				row.owner_username = user_res->second->name;
 
-			page_out += "<p>\n";
-			page_out += "<a href=\"/parcel/" + parcel->id.toString() + "\">Parcel " + parcel->id.toString() + "</a><br/>" +
-				"owner: " + web::Escaping::HTMLEscape(owner_username) + "<br/>" +
-				"description: " + web::Escaping::HTMLEscape(parcel->description) + "<br/>" +
-				"created " + parcel->created_time.timeAgoDescription();
+			row.description = parcel->description;
+			row.created = parcel->created_time.timeAgoDescription();
 
 			// Get any auctions for parcel
-			page_out += "<div>    \n";
 			for(size_t i=0; i<parcel->parcel_auction_ids.size(); ++i)
 			{
 				const uint32 auction_id = parcel->parcel_auction_ids[i];
@@ -323,20 +369,84 @@ void renderParcelsPage(ServerAllWorldsState& world_state, const web::RequestInfo
 				{
 					const ParcelAuction* auction = auction_res->second.ptr();
 					if(auction->auction_state == ParcelAuction::AuctionState_ForSale)
-						page_out += " <a href=\"/parcel_auction/" + toString(auction->id) + "\">Auction " + toString(auction->id) + ": For sale</a><br/>";
+						row.auctions_html += " <a href=\"/parcel_auction/" + toString(auction->id) + "\">Auction " + toString(auction->id) + ": For sale</a><br/>";
 					else if(auction->auction_state == ParcelAuction::AuctionState_Sold)
-						page_out += " <a href=\"/parcel_auction/" + toString(auction->id) + "\">Auction " + toString(auction->id) + ": Parcel sold.</a><br/>";
+						row.auctions_html += " <a href=\"/parcel_auction/" + toString(auction->id) + "\">Auction " + toString(auction->id) + ": Parcel sold.</a><br/>";
 				}
 			}
-			page_out += "</div>    \n";
-
-			page_out += " <a href=\"/admin_create_parcel_auction/" + parcel->id.toString() + "\">Create auction</a>";
+			rows.push_back(row);
+		};
 
-			page_out += "</p>\n";
-			page_out += "<br/>  \n";
+		if(filter_by_owner) // Use the parcel owner index
+		{
+			const std::set<ParcelID>& owned_parcels = root_world->getParcelsOwnedBy(owner_id, lock);
+			const auto res = AdminPagination::walkSetPage(owned_parcels, params,
+				/*filter=*/[&](const ParcelID& parcel_id) { return parcels.count(parcel_id) != 0; },
+				/*process=*/[&](const ParcelID& parcel_id) { process(parcels.find(parcel_id)->second.ptr()); });
+			next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
+		}
+		else
+		{
+			const auto res = AdminPagination::walkPage(parcels, params,
+				/*filter=*/[&](const ParcelID& /*parcel_id*/, const ParcelRef& /*parcel*/) { return true; },
+				/*process=*/[&](const ParcelID& /*parcel_id*/, const ParcelRef& parcel) { process(parcel.ptr()); });
+			next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
 		}
 	} // End Lock scope
 
+	std::string page_out = sharedAdminHeader(world_state, request);
+
+	page_out += "<h2>Root world Parcels</h2>\n";
+
+	//-----------------------
+	page_out += "<hr/>";
+	page_out += "<form action=\"/admin_regenerate_multiple_parcel_screenshots\" method=\"post\">";
+	page_out += "start parcel id: <input type=\"number\" name=\"start_parcel_id\" value=\"" + toString(0) + "\"><br/>";
+	page_out += "end parcel id: <input type=\"number\" name=\"end_parcel_id\" value=\"" + toString(10) + "\"><br/>";
+	page_out += "<input type=\"submit\" value=\"Regenerate/recreate parcel screenshots\" onclick=\"return confirm('Are you sure you want to recreate parcel screenshots?');\" >";
+	page_out += "</form>";
+	page_out += "<hr/>";
+	//-----------------------
+
+	//-----------------------
+	page_out += "<hr/>";
+	page_out += "<form action=\"/admin_create_parcel\" method=\"post\">";
+	page_out += "<input type=\"submit\" value=\"Create new parcel\" onclick=\"return confirm('Are you sure you want to create a parcel?');\" >";
+	page_out += "</form>";
+	page_out += "<hr/>";
+	//-----------------------
+
+	page_out += "<form action=\"/admin_parcels\" method=\"get\">";
+	page_out += "Owner user id: <input type=\"number\" name=\"owner\" value=\"" + web::Escaping::HTMLEscape(owner_param) + "\">";
+	page_out += "<input type=\"submit\" value=\"Filter by owner\">";
+	page_out += "</form>";
+
+	const std::string base_url = filter_by_owner ? ("/admin_parcels?owner=" + owner_id.toString()) : std::string("/admin_parcels");
+	const std::string page_links = AdminPagination::makePageLinksForCursor(base_url, params, next_cursor, "Lowest id first", "Highest id first");
+	page_out += page_links;
+
+	for(size_t i=0; i<rows.size(); ++i)
+	{
+		const ParcelRow& row = rows[i];
+
+		page_out += "<p>\n";
+		page_out += "<a href=\"/parcel/" + row.id + "\">Parcel " + row.id + "</a><br/>" +
+			"owner: " + web::Escaping::HTMLEscape(row.owner_username) + "<br/>" +
+			"description: " + web::Escaping::HTMLEscape(row.description) + "<br/>" +
+			"created " + row.created;
+
+		page_out += "<div>    \n";
+		page_out += row.auctions_html;
+		page_out += "</div>    \n";
+
+		page_out += " <a href=\"/admin_create_parcel_auction/" + row.id + "\">Create auction</a>";
+
+		page_out += "</p>\n";
+		page_out += "<br/>  \n";
+	}
+
+	page_out += page_links;
+
 	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page_out);
 }
 
@@ -499,41 +609,83 @@ void renderOrdersPage(ServerAllWorldsState& world_state, const web::RequestInfo&
 		return;
 	}
 
-	std::string page_out = sharedAdminHeader(world_state, request);
+	const AdminPagination::PageParams params = AdminPagination::parsePageParams(request, /*default_descending=*/true);
+	const std::string confirmed_param = getURLParamOrEmpty(request, "confirmed"); // "1", "0", or empty for all orders.
+
+	// Copy the fields to display for the orders on this page while holding the lock, then build the HTML after releasing it.
+	struct OrderRow
+	{
+		uint64 id;
+		std::string orderer_username, parcel_id, created_time, payer_email, gross_payment, paypal_data, coinbase_charge_code, coinbase_status;
+		bool confirmed;
+	};
+	std::vector<OrderRow> rows;
+	std::string next_cursor;
 
 	{ // Lock scope
 		Lock lock(world_state.mutex);
 
-		page_out += "<h2>Orders</h2>\n";
+		const auto res = AdminPagination::walkPage(world_state.orders, params,
+			/*filter=*/[&](const uint64& /*order_id*/, const OrderRef& order)
+			{
+				return confirmed_param.empty() || (order->confirmed == (confirmed_param == "1"));
+			},
+			/*process=*/[&](const uint64& /*order_id*/, const OrderRef& order)
+			{
+				OrderRow row;
+				row.id = order->id;
 
-		for(auto it = world_state.orders.begin(); it != world_state.orders.end(); ++it)
-		{
-			const Order* order = it->second.ptr();
+				// Look up user who made the order
+				auto user_res = world_state.user_id_to_users.find(order->user_id);
+				if(user_res == world_state.user_id_to_users.end())
+					row.orderer_username = "[No user found]";
+				else
+					row.orderer_username = user_res->second->name;
+
+				row.parcel_id = order->parcel_id.toString();
+				row.created_time = order->created_time.RFC822FormatedString() + "(" + order->created_time.timeAgoDescription() + ")";
+				row.payer_email = order->payer_email;
+				row.gross_payment = ::toString(order->gross_payment);
+				row.paypal_data = order->paypal_data.substr(0, 60);
+				row.coinbase_charge_code = order->coinbase_charge_code;
+				row.coinbase_status = order->coinbase_status;
+				row.confirmed = order->confirmed;
+				rows.push_back(row);
+			}
+		);
+		next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
+	} // End Lock scope
 
-			// Look up user who made the order
-			std::string orderer_username;
-			auto user_res = world_state.user_id_to_users.find(order->user_id);
-			if(user_res == world_state.user_id_to_users.end())
-				orderer_username = "[No user found]";
-			else
-				orderer_username = user_res->second->name;
+	std::string page_out = sharedAdminHeader(world_state, request);
 
+	page_out += "<h2>Orders</h2>\n";
 
-			page_out += "<p>\n";
-			page_out += "<a href=\"/admin_order/" + toString(order->id) + "\">Order " + toString(order->id) + "</a>, " +
-				"orderer: " + web::Escaping::HTMLEscape(orderer_username) + "<br/>" +
-				"parcel: <a href=\"/parcel/" + order->parcel_id.toString() + "\">" + order->parcel_id.toString() + "</a>, " + "<br/>" +
-				"created_time: " + order->created_time.RFC822FormatedString() + "(" + order->created_time.timeAgoDescription() + ")<br/>" +
-				"payer_email: " + web::Escaping::HTMLEscape(order->payer_email) + "<br/>" +
-				"gross_payment: " + ::toString(order->gross_payment) + "<br/>" +
-				"paypal_data: " + web::Escaping::HTMLEscape(order->paypal_data.substr(0, 60)) + "...</br>" +
-				"coinbase charge code: " + order->coinbase_charge_code + "</br>" +
-				"coinbase charge status: " + order->coinbase_status + "</br>" +
-				"confirmed: " + boolToString(order->confirmed);
+	page_out += "<p>Show: <a href=\"/admin_orders\">All orders</a> | <a href=\"/admin_orders?confirmed=1\">Confirmed</a> | <a href=\"/admin_orders?confirmed=0\">Unconfirmed</a></p>";
 
-			page_out += "</p>    \n";
-		}
-	} // End Lock scope
+	const std::string base_url = confirmed_param.empty() ? std::string("/admin_orders") : ("/admin_orders?confirmed=" + std::string((confirmed_param == "1") ? "1" : "0"));
+	const std::string page_links = AdminPagination::makePageLinksForCursor(base_url, params, next_cursor, "Oldest first", "Newest first");
+	page_out += page_links;
+
+	for(size_t i=0; i<rows.size(); ++i)
+	{
+		const OrderRow& row = rows[i];
+
+		page_out += "<p>\n";
+		page_out += "<a href=\"/admin_order/" + toString(row.id) + "\">Order " + toString(row.id) + "</a>, " +
+			"orderer: " + web::Escaping::HTMLEscape(row.orderer_username) + "<br/>" +
+			"parcel: <a href=\"/parcel/" + row.parcel_id + "\">" + row.parcel_id + "</a>, " + "<br/>" +
+			"created_time: " + row.created_time + "<br/>" +
+			"payer_email: " + web::Escaping::HTMLEscape(row.payer_email) + "<br/>" +
+			"gross_payment: " + row.gross_payment + "<br/>" +
+			"paypal_data: " + web::Escaping::HTMLEscape(row.paypal_data) + "...</br>" +
+			"coinbase charge code: " + row.coinbase_charge_code + "</br>" +
+			"coinbase charge status: " + row.coinbase_status + "</br>" +
+			"confirmed: " + boolToString(row.confirmed);
+
+		page_out += "</p>    \n";
+	}
+
+	page_out += page_links;
 
 	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page_out);
 }
@@ -547,55 +699,110 @@ void renderSubEthTransactionsPage(ServerAllWorldsState& world_state, const web::
 		return;
 	}
 
-	std::string page_out = sharedAdminHeader(world_state, request);
+	const AdminPagination::PageParams params = AdminPagination::parsePageParams(request, /*default_descending=*/true);
+	uint64 state_filter = 0;
+	const bool filter_by_state = AdminPagination::decodeCursor(getURLParamOrEmpty(request, "state"), state_filter);
+
+	// Copy the fields to display for the transactions on this page while holding the lock, then build the HTML after releasing it.
+	struct TransactionRow
+	{
+		uint64 id;
+		std::string username, user_eth_address, parcel_id, created_time, state, submitted_time, transaction_hash, submission_error_message;
+		bool is_new;
+		uint64 nonce;
+	};
+	std::vector<TransactionRow> rows;
+	std::string next_cursor;
+	int min_next_nonce;
 
 	{ // Lock scope
 		Lock lock(world_state.mutex);
 
+		min_next_nonce = world_state.eth_info.min_next_nonce;
 
-		page_out += "<form action=\"/admin_set_min_next_nonce_post\" method=\"post\">";
-		page_out += "<input type=\"number\" name=\"min_next_nonce\" value=\"" + toString(world_state.eth_info.min_next_nonce) + "\">";
-		page_out += "<input type=\"submit\" value=\"Set min next nonce\" onclick=\"return confirm('Are you sure you want set the min next nonce?');\" >";
-		page_out += "</form>";
+		const auto res = AdminPagination::walkPage(world_state.sub_eth_transactions, params,
+			/*filter=*/[&](const uint64& /*trans_id*/, const SubEthTransactionRef& trans)
+			{
+				return !filter_by_state || ((uint64)trans->state == state_filter);
+			},
+			/*process=*/[&](const uint64& /*trans_id*/, const SubEthTransactionRef& trans)
+			{
+				TransactionRow row;
+				row.id = trans->id;
 
+				// Look up user who initiated the transaction
+				auto user_res = world_state.user_id_to_users.find(trans->initiating_user_id);
+				if(user_res == world_state.user_id_to_users.end())
+					row.username = "[No user found]";
+				else
+					row.username = user_res->second->name;
+
+				row.user_eth_address = trans->user_eth_address;
+				row.parcel_id = trans->parcel_id.toString();
+				row.created_time = trans->created_time.RFC822FormatedString() + "(" + trans->created_time.timeAgoDescription() + ")";
+				row.state = SubEthTransaction::statestring(trans->state);
+				row.is_new = trans->state == SubEthTransaction::State_New;
+				if(!row.is_new)
+				{
+					row.submitted_time = trans->submitted_time.RFC822FormatedString() + "(" + trans->submitted_time.timeAgoDescription() + ")";
+					row.transaction_hash = trans->transaction_hash.toHexString();
+					row.submission_error_message = trans->submission_error_message;
+				}
+				row.nonce = trans->nonce;
+				rows.push_back(row);
+			}
+		);
+		next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
+	} // End Lock scope
 
-		page_out += "<h2>Substrata Ethereum Transactions</h2>\n";
+	std::string page_out = sharedAdminHeader(world_state, request);
 
-		for(auto it = world_state.sub_eth_transactions.begin(); it != world_state.sub_eth_transactions.end(); ++it)
-		{
-			const SubEthTransaction* trans = it->second.ptr();
+	page_out += "<form action=\"/admin_set_min_next_nonce_post\" method=\"post\">";
+	page_out += "<input type=\"number\" name=\"min_next_nonce\" value=\"" + toString(min_next_nonce) + "\">";
+	page_out += "<input type=\"submit\" value=\"Set min next nonce\" onclick=\"return confirm('Are you sure you want set the min next nonce?');\" >";
+	page_out += "</form>";
 
-			// Look up user who initiated the transaction
-			std::string username;
-			auto user_res = world_state.user_id_to_users.find(trans->initiating_user_id);
-			if(user_res == world_state.user_id_to_users.end())
-				username = "[No user found]";
-			else
-				username = user_res->second->name;
 
-			page_out += "<h3><a href=\"/admin_sub_eth_transaction/" + toString(trans->id) + "\">Transaction " + toString(trans->id) + "</a></h3>";
-			page_out += "<p>\n";
-			page_out += 
-				"initiating user: " + web::Escaping::HTMLEscape(username) + "<br/>" +
-				"user_eth_address: <a href=\"https://etherscan.io/address/" + web::Escaping::HTMLEscape(trans->user_eth_address) + "\">" + web::Escaping::HTMLEscape(trans->user_eth_address) + "</a><br/>" +
-				"parcel: <a href=\"/parcel/" + trans->parcel_id.toString() + "\">" + trans->parcel_id.toString() + "</a>, " + "<br/>" +
-				"created_time: " + trans->created_time.RFC822FormatedString() + "(" + trans->created_time.timeAgoDescription() + ")<br/>" +
-				"state: " + web::Escaping::HTMLEscape(SubEthTransaction::statestring(trans->state)) + "<br/>";
-			if(trans->state != SubEthTransaction::State_New)
-			{
-				page_out += "submitted_time: " + trans->submitted_time.RFC822FormatedString() + "(" + trans->submitted_time.timeAgoDescription() + ")<br/>";
-				page_out += "txn hash: <a href=\"https://etherscan.io/tx/0x" + trans->transaction_hash.toHexString() + "\">" + web::Escaping::HTMLEscape(trans->transaction_hash.toHexString()) + "</a><br/>";
-				page_out += "error msg: " + web::Escaping::HTMLEscape(trans->submission_error_message) + "<br/>";
-			}
+	page_out += "<h2>Substrata Ethereum Transactions</h2>\n";
 
-			page_out +=
-				"nonce: " + toString(trans->nonce) + "<br/>";
+	page_out += "<p>Show: <a href=\"/admin_sub_eth_transactions\">All transactions</a>";
+	const SubEthTransaction::State states[] = { SubEthTransaction::State_New, SubEthTransaction::State_Submitted, SubEthTransaction::State_Completed };
+	for(size_t i=0; i<staticArrayNumElems(states); ++i)
+		page_out += " | <a href=\"/admin_sub_eth_transactions?state=" + toString((uint32)states[i]) + "\">" + web::Escaping::HTMLEscape(SubEthTransaction::statestring(states[i])) + "</a>";
+	page_out += "</p>";
 
-			page_out += "</p>    \n";
+	const std::string base_url = filter_by_state ? ("/admin_sub_eth_transactions?state=" + toString(state_filter)) : std::string("/admin_sub_eth_transactions");
+	const std::string page_links = AdminPagination::makePageLinksForCursor(base_url, params, next_cursor, "Oldest first", "Newest first");
+	page_out += page_links;
 
-			page_out += "<br/>";
+	for(size_t i=0; i<rows.size(); ++i)
+	{
+		const TransactionRow& row = rows[i];
+
+		page_out += "<h3><a href=\"/admin_sub_eth_transaction/" + toString(row.id) + "\">Transaction " + toString(row.id) + "</a></h3>";
+		page_out += "<p>\n";
+		page_out += 
+			"initiating user: " + web::Escaping::HTMLEscape(row.username) + "<br/>" +
+			"user_eth_address: <a href=\"https://etherscan.io/address/" + web::Escaping::HTMLEscape(row.user_eth_address) + "\">" + web::Escaping::HTMLEscape(row.user_eth_address) + "</a><br/>" +
+			"parcel: <a href=\"/parcel/" + row.parcel_id + "\">" + row.parcel_id + "</a>, " + "<br/>" +
+			"created_time: " + row.created_time + "<br/>" +
+			"state: " + web::Escaping::HTMLEscape(row.state) + "<br/>";
+		if(!row.is_new)
+		{
+			page_out += "submitted_time: " + row.submitted_time + "<br/>";
+			page_out += "txn hash: <a href=\"https://etherscan.io/tx/0x" + row.transaction_hash + "\">" + web::Escaping::HTMLEscape(row.transaction_hash) + "</a><br/>";
+			page_out += "error msg: " + web::Escaping::HTMLEscape(row.submission_error_message) + "<br/>";
 		}
-	} // End Lock scope
+
+		page_out +=
+			"nonce: " + toString(row.nonce) + "<br/>";
+
+		page_out += "</p>    \n";
+
+		page_out += "<br/>";
+	}
+
+	page_out += page_links;
 
 	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page_out);
 }
@@ -875,47 +1082,113 @@ void renderAdminLODChunksPage(ServerAllWorldsState& all_worlds_state, const web:
 		return;
 	}
 
-	std::string page_out = sharedAdminHeader(all_worlds_state, request);
+	const AdminPagination::PageParams params = AdminPagination::parsePageParams(request, /*default_descending=*/false);
+	const std::string world_name = getURLParamOrEmpty(request, "world");
+	const bool only_needing_rebuild = getURLParamOrEmpty(request, "needs_rebuild") == "1";
+
+	// Copy the fields to display for the chunks on this page while holding the lock, then build the HTML after releasing it.
+	struct ChunkRow
+	{
+		std::string coords, mesh_url, combined_array_texture_url;
+		size_t compressed_mat_info_size;
+		bool needs_rebuild;
+	};
+	std::vector<std::pair<std::string, size_t>> world_num_chunks; // (world name, num chunks) for worlds with chunks.
+	bool world_found = false;
+	std::vector<ChunkRow> rows;
+	std::string next_cursor;
 
 	{ // Lock scope
 		WorldStateLock lock(all_worlds_state.mutex);
 
-		page_out += "<h2>LOD Chunks</h2>\n";
-
-		//-----------------------
-		page_out += "<hr/>";
-		page_out += "<form action=\"/admin_rebuild_world_lod_chunks\" method=\"post\">";
-		page_out += "world name: (Enter 'ALL' to rebuild chunks in all worlds) <input type=\"text\" name=\"world_name\"><br>";
-		page_out += "<input type=\"submit\" value=\"Rebuild world LOD chunks\">";
-		page_out += "</form>";
-		page_out += "<hr/>";
-		//-----------------------
-
 		for(auto it = all_worlds_state.world_states.begin(); it != all_worlds_state.world_states.end(); ++it)
 		{
-			ServerWorldState* world_state = it->second.ptr();
-
-			ServerWorldState::LODChunkMapType& lod_chunks = world_state->getLODChunks(lock);
+			const size_t num_chunks = it->second->getLODChunks(lock).size();
+			if(num_chunks > 0)
+				world_num_chunks.push_back(std::make_pair(it->first, num_chunks));
+		}
 
-			if(!lod_chunks.empty())
-			{
-				page_out += "<h3>World: '" + web::Escaping::HTMLEscape(it->first) + "'</h3>";
+		auto world_res = all_worlds_state.world_states.find(world_name);
+		if(world_res != all_worlds_state.world_states.end())
+		{
+			world_found = true;
 
-				for(auto lod_it = lod_chunks.begin(); lod_it != lod_chunks.end(); ++lod_it)
+			const auto res = AdminPagination::walkPage(world_res->second->getLODChunks(lock), params,
+				/*filter=*/[&](const Vec3i& /*coords*/, const LODChunkRef& chunk) { return !only_needing_rebuild || chunk->needs_rebuild; },
+				/*process=*/[&](const Vec3i& /*coords*/, const LODChunkRef& chunk)
 				{
-					const LODChunk* chunk = lod_it->second.ptr();
-
-					page_out += "<div>Coords: " + chunk->coords.toString() + ", <br/> mesh_url: " + web::Escaping::HTMLEscape(toStdString(chunk->getMeshURL())) + ", <br/> combined_array_texture_url: " + web::Escaping::HTMLEscape(toStdString(chunk->combined_array_texture_url)) + 
-						"<br/> compressed_mat_info: " + toString(chunk->compressed_mat_info.size()) + " B, <br/> needs_rebuild: " + boolToString(chunk->needs_rebuild) + "</div><br/>";
+					ChunkRow row;
+					row.coords = chunk->coords.toString();
+					row.mesh_url = toStdString(chunk->getMeshURL());
+					row.combined_array_texture_url = toStdString(chunk->combined_array_texture_url);
+					row.compressed_mat_info_size = chunk->compressed_mat_info.size();
+					row.needs_rebuild = chunk->needs_rebuild;
+					rows.push_back(row);
 				}
-			}
+			);
+			next_cursor = res.has_next_page ? AdminPagination::encodeCursor(res.next_cursor) : std::string();
 		}
 	} // End Lock scope
 
+	std::string page_out = sharedAdminHeader(all_worlds_state, request);
+
+	page_out += "<h2>LOD Chunks</h2>\n";
+
+	//-----------------------
+	page_out += "<hr/>";
+	page_out += "<form action=\"/admin_rebuild_world_lod_chunks\" method=\"post\">";
+	page_out += "world name: (Enter 'ALL' to rebuild chunks in all worlds) <input type=\"text\" name=\"world_name\"><br>";
+	page_out += "<input type=\"submit\" value=\"Rebuild world LOD chunks\">";
+	page_out += "</form>";
+	page_out += "<hr/>";
+	//-----------------------
+
+	page_out += "<h3>Worlds with LOD chunks</h3>";
+	for(size_t i=0; i<world_num_chunks.size(); ++i)
+	{
+		const std::string world_url = "/admin_lod_chunks?world=" + web::Escaping::URLEscape(world_num_chunks[i].first);
+		page_out += "<div><a href=\"" + web::Escaping::HTMLEscape(world_url) + "\">'" + web::Escaping::HTMLEscape(world_num_chunks[i].first) + "'</a>: " + toString(world_num_chunks[i].second) + " chunks " +
+			"(<a href=\"" + web::Escaping::HTMLEscape(world_url + "&needs_rebuild=1") + "\">needing rebuild</a>)</div>";
+	}
+
+	if(world_found)
+	{
+		page_out += "<h3>World: '" + web::Escaping::HTMLEscape(world_name) + "'" + (only_needing_rebuild ? " (chunks needing rebuild)" : "") + "</h3>";
+
+		const std::string base_url = "/admin_lod_chunks?world=" + web::Escaping::URLEscape(world_name) + (only_needing_rebuild ? "&needs_rebuild=1" : "");
+		const std::string page_links = AdminPagination::makePageLinksForCursor(base_url, params, next_cursor, "Ascending coords", "Descending coords");
+		page_out += page_links;
+
+		for(size_t i=0; i<rows.size(); ++i)
+		{
+			const ChunkRow& row = rows[i];
+			page_out += "<div>Coords: " + row.coords + ", <br/> mesh_url: " + web::Escaping::HTMLEscape(row.mesh_url) + ", <br/> combined_array_texture_url: " + web::Escaping::HTMLEscape(row.combined_array_texture_url) + 
+				"<br/> compressed_mat_info: " + toString(row.compressed_mat_info_size) + " B, <br/> needs_rebuild: " + boolToString(row.needs_rebuild) + "</div><br/>";
+		}
+
+		page_out += page_links;
+	}
+
 	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page_out);
 }
 
 
+void renderMetricsPage(ServerAllWorldsState& world_state, const web::RequestInfo& request, web::ReplyInfo& reply_info)
+{
+	if(!LoginHandlers::loggedInUserHasAdminPrivs(world_state, request))
+	{
+		web::ResponseUtils::writeHTTPUnauthorizedHeaderAndData(reply_info, "Access denied sorry.");
+		return;
+	}
+
+	std::string page;
+	page.reserve(65536);
+	ServerMetrics::get().registry.writePrometheusText(page);
+
+	web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, page.data(), page.size(), /*content type=*/"text/plain; version=0.0.4");
+}
+
+
 void renderAdminWorldsPage(ServerAllWorldsState& all_worlds_state, const web::RequestInfo& request, web::ReplyInfo& reply_info)
 {
 	if(!LoginHandlers::loggedInUserHasAdminPrivs(all_worlds_state, request))
@@ -1438,6 +1711,7 @@ void handleSetParcelVertexPost(ServerAllWorldsState& world_state, const web::Req
 
 				parcel->verts[vert_i] = new_vert_pos;
 				parcel->build();
+				world_state.getRootWorldState()->invalidateObjectAccountingIndex(lock); // Objects may now be in different parcels.
 				
 				world_state.getRootWorldState()->addParcelAsDBDirty(parcel, lock);
 				world_state.markAsChanged();
@@ -1486,6 +1760,7 @@ void handleSetParcelZBoundsPost(ServerAllWorldsState& world_state, const web::Re
 
 				parcel->zbounds = new_zbounds;
 				parcel->build();
+				world_state.getRootWorldState()->invalidateObjectAccountingIndex(lock); // Objects may now be in different parcels.
 				
 				world_state.getRootWorldState()->addParcelAsDBDirty(parcel, lock);
 				world_state.markAsChanged();
@@ -1536,6 +1811,7 @@ void handleSetParcelWidthsPost(ServerAllWorldsState& world_state, const web::Req
 				parcel->verts[2] = parcel->verts[0] + widths;
 				parcel->verts[3] = parcel->verts[0] + Vec2d(0, widths.y);
 				parcel->build();
+				world_state.getRootWorldState()->invalidateObjectAccountingIndex(lock); // Objects may now be in different parcels.
 
 				world_state.getRootWorldState()->addParcelAsDBDirty(parcel, lock);
 				world_state.markAsChanged();
@@ -1796,6 +2072,7 @@ void handleCreateParcelPost(ServerAllWorldsState& world_state, const web::Reques
 			parcel->build();
 
 			world_state.getRootWorldState()->parcels[new_id] = parcel;
+			world_state.getRootWorldState()->invalidateObjectAccountingIndex(lock);
 			world_state.getRootWorldState()->addParcelAsDBDirty(parcel, lock);
 			world_state.markAsChanged();
 
@@ -2396,6 +2673,31 @@ void handleForceDynTexUpdatePost(ServerAllWorldsState& world_state, const web::R
 }
 
 
+void handleStartTraceCapturePost(ServerAllWorldsState& world_state, const web::RequestInfo& request, web::ReplyInfo& reply_info)
+{
+	if(!LoginHandlers::loggedInUserHasAdminPrivs(world_state, request))
+	{
+		web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, "Access denied sorry.");
+		return;
+	}
+
+	try
+	{
+		const int duration = request.getPostIntField("duration");
+
+		ServerProfiler::get().startCapture(duration);
+
+		web::ResponseUtils::writeRedirectTo(reply_info, "/admin");
+	}
+	catch(glare::Exception& e)
+	{
+		if(!request.fuzzing)
+			conPrint("handleStartTraceCapturePost error: " + e.what());
+		web::ResponseUtils::writeHTTPOKHeaderAndData(reply_info, "Error: " + e.what());
+	}
+}
+
+
 void handleSetUserAsWorldGardenerPost(ServerAllWorldsState& world_state, const web::RequestInfo& request, web::ReplyInfo& reply_info)
 {
 	if(!LoginHandlers::loggedInUserHasAdminPrivs(world_state, request))
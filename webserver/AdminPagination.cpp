@@ -0,0 +1,266 @@
+/*=====================================================================
+AdminPagination.cpp
+-------------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#include "AdminPagination.h"
+
+
+#include "RequestInfo.h"
+#include "Escaping.h"
+#include <StringUtils.h>
+#include <Parser.h>
+#include <maths/mathstypes.h>
+#include <limits>
+
+
+namespace AdminPagination
+{
+
+
+PageParams parsePageParams(const web::RequestInfo& request, bool default_descending)
+{
+	PageParams params;
+	params.descending = default_descending;
+	params.page_size = DEFAULT_PAGE_SIZE;
+
+	if(request.isURLParamPresent("order"))
+	{
+		const std::string order = request.getURLParam("order").str();
+		if(order == "asc")
+			params.descending = false;
+		else if(order == "desc")
+			params.descending = true;
+	}
+
+	if(request.isURLParamPresent("page_size"))
+	{
+		uint64 page_size;
+		if(decodeCursor(request.getURLParam("page_size").str(), page_size) && page_size > 0)
+			params.page_size = (size_t)myMin<uint64>(page_size, MAX_PAGE_SIZE);
+	}
+
+	if(request.isURLParamPresent("cursor"))
+		params.cursor = request.getURLParam("cursor").str();
+
+	return params;
+}
+
+
+std::string encodeCursor(uint64 key)				{ return toString(key); }
+std::string encodeCursor(const UserID& key)			{ return toString(key.value()); }
+std::string encodeCursor(const ParcelID& key)		{ return toString(key.value()); }
+std::string encodeCursor(const Vec3i& key)			{ return toString(key.x) + "," + toString(key.y) + "," + toString(key.z); }
+std::string encodeCursor(const std::string& key)	{ return key; }
+
+
+bool decodeCursor(const std::string& s, uint64& key_out)
+{
+	if(s.empty() || s.size() > 20)
+		return false;
+
+	uint64 x = 0;
+	for(size_t i=0; i<s.size(); ++i)
+	{
+		if(s[i] < '0' || s[i] > '9')
+			return false;
+		const uint64 digit = (uint64)(s[i] - '0');
+		if(x > (std::numeric_limits<uint64>::max() - digit) / 10) // Check for overflow
+			return false;
+		x = x * 10 + digit;
+	}
+	key_out = x;
+	return true;
+}
+
+
+bool decodeCursor(const std::string& s, UserID& key_out)
+{
+	uint64 x;
+	if(!decodeCursor(s, x) || x > std::numeric_limits<uint32>::max())
+		return false;
+	key_out = UserID((uint32)x);
+	return true;
+}
+
+
+bool decodeCursor(const std::string& s, ParcelID& key_out)
+{
+	uint64 x;
+	if(!decodeCursor(s, x) || x > std::numeric_limits<uint32>::max())
+		return false;
+	key_out = ParcelID((uint32)x);
+	return true;
+}
+
+
+bool decodeCursor(const std::string& s, Vec3i& key_out)
+{
+	Parser parser(s);
+	Vec3i v;
+	if(!parser.parseInt(v.x) || !parser.parseChar(',') || !parser.parseInt(v.y) || !parser.parseChar(',') || !parser.parseInt(v.z) || !parser.eof())
+		return false;
+	key_out = v;
+	return true;
+}
+
+
+bool decodeCursor(const std::string& s, std::string& key_out)
+{
+	key_out = s;
+	return true;
+}
+
+
+static std::string makePageURL(const std::string& base_url, bool descending, size_t page_size, const std::string& cursor)
+{
+	std::string url = base_url + ((base_url.find('?') == std::string::npos) ? "?" : "&") + "order=" + (descending ? "desc" : "asc");
+	if(page_size != DEFAULT_PAGE_SIZE)
+		url += "&page_size=" + toString((uint64)page_size);
+	if(!cursor.empty())
+		url += "&cursor=" + web::Escaping::URLEscape(cursor);
+	return url;
+}
+
+
+std::string makePageLinksForCursor(const std::string& base_url, const PageParams& params, const std::string& next_cursor, const std::string& asc_label, const std::string& desc_label)
+{
+	std::string s = "<p>";
+	s += "<a href=\"" + web::Escaping::HTMLEscape(makePageURL(base_url, /*descending=*/false, params.page_size, /*cursor=*/"")) + "\">" + web::Escaping::HTMLEscape(asc_label) + "</a> | ";
+	s += "<a href=\"" + web::Escaping::HTMLEscape(makePageURL(base_url, /*descending=*/true,  params.page_size, /*cursor=*/"")) + "\">" + web::Escaping::HTMLEscape(desc_label) + "</a>";
+	if(!next_cursor.empty())
+		s += " | <a href=\"" + web::Escaping::HTMLEscape(makePageURL(base_url, params.descending, params.page_size, next_cursor)) + "\">Next page</a>";
+	s += "</p>\n";
+	return s;
+}
+
+
+} // end namespace AdminPagination
+
+
+#if BUILD_TESTS
+
+
+#include <TestUtils.h>
+#include <ConPrint.h>
+#include <map>
+#include <set>
+#include <vector>
+
+
+static std::vector<uint64> walkTestMap(const std::map<uint64, int>& map, bool descending, const uint64* cursor, size_t page_size, size_t max_num_scanned, bool only_even,
+	AdminPagination::PageResult<uint64>& result_out)
+{
+	std::vector<uint64> keys;
+	result_out = AdminPagination::walkPage(map, descending, cursor, page_size, max_num_scanned,
+		/*filter=*/[&](const uint64& /*key*/, const int& value) { return !only_even || (value % 2 == 0); },
+		/*process=*/[&](const uint64& key, const int& /*value*/) { keys.push_back(key); }
+	);
+	return keys;
+}
+
+
+void AdminPagination::test()
+{
+	conPrint("AdminPagination::test()");
+
+	//-------------------- Test cursor encoding and decoding --------------------
+	{
+		uint64 x = 0;
+		testAssert(decodeCursor(encodeCursor((uint64)1234567890123ull), x) && x == 1234567890123ull);
+		testAssert(decodeCursor("18446744073709551615", x) && x == std::numeric_limits<uint64>::max());
+		testAssert(!decodeCursor("18446744073709551616", x)); // Overflow
+		testAssert(!decodeCursor("", x));
+		testAssert(!decodeCursor("-1", x));
+		testAssert(!decodeCursor("12a", x));
+
+		UserID user_id;
+		testAssert(decodeCursor(encodeCursor(UserID(42)), user_id) && user_id == UserID(42));
+		testAssert(!decodeCursor("4294967296", user_id));
+
+		Vec3i v(0, 0, 0);
+		testAssert(decodeCursor(encodeCursor(Vec3i(-3, 4, -5)), v) && v == Vec3i(-3, 4, -5));
+		testAssert(!decodeCursor("1,2", v));
+		testAssert(!decodeCursor("1,2,3,", v));
+	}
+
+	//-------------------- Test walking pages --------------------
+	{
+		std::map<uint64, int> map;
+		for(int i=0; i<10; ++i)
+			map[(uint64)i * 10] = i;
+
+		AdminPagination::PageResult<uint64> result;
+
+		// Ascending, first page
+		std::vector<uint64> keys = walkTestMap(map, /*descending=*/false, /*cursor=*/NULL, /*page size=*/4, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 0, 10, 20, 30 }));
+		testAssert(result.has_next_page && result.next_cursor == 30);
+
+		// Ascending, from cursor
+		keys = walkTestMap(map, /*descending=*/false, &result.next_cursor, /*page size=*/4, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 40, 50, 60, 70 }));
+		keys = walkTestMap(map, /*descending=*/false, &result.next_cursor, /*page size=*/4, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 80, 90 }));
+		testAssert(!result.has_next_page);
+
+		// Exactly a full page at the end of the map should not have a next page.
+		uint64 cursor = 50;
+		keys = walkTestMap(map, /*descending=*/false, &cursor, /*page size=*/4, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 60, 70, 80, 90 }));
+		testAssert(!result.has_next_page);
+
+		// Cursor that is not a key in the map (e.g. the entry was deleted)
+		cursor = 35;
+		keys = walkTestMap(map, /*descending=*/false, &cursor, /*page size=*/2, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 40, 50 }));
+
+		// Descending
+		keys = walkTestMap(map, /*descending=*/true, /*cursor=*/NULL, /*page size=*/3, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 90, 80, 70 }));
+		testAssert(result.has_next_page && result.next_cursor == 70);
+		keys = walkTestMap(map, /*descending=*/true, &result.next_cursor, /*page size=*/3, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 60, 50, 40 }));
+		cursor = 35;
+		keys = walkTestMap(map, /*descending=*/true, &cursor, /*page size=*/10, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys == std::vector<uint64>({ 30, 20, 10, 0 }));
+		testAssert(!result.has_next_page);
+
+		// Filtered
+		keys = walkTestMap(map, /*descending=*/false, /*cursor=*/NULL, /*page size=*/2, MAX_NUM_SCANNED, /*only even=*/true, result);
+		testAssert(keys == std::vector<uint64>({ 0, 20 }));
+		testAssert(result.has_next_page && result.next_cursor == 20);
+
+		// Filtered, with the scan limit reached before the page is full.  The next page should continue from the last entry scanned.
+		keys = walkTestMap(map, /*descending=*/false, /*cursor=*/NULL, /*page size=*/10, /*max num scanned=*/3, /*only even=*/true, result);
+		testAssert(keys == std::vector<uint64>({ 0, 20 }));
+		testAssert(result.has_next_page && result.next_cursor == 20 && result.num_scanned == 3);
+		keys = walkTestMap(map, /*descending=*/false, &result.next_cursor, /*page size=*/10, /*max num scanned=*/3, /*only even=*/true, result);
+		testAssert(keys == std::vector<uint64>({ 40 }));
+		testAssert(result.has_next_page && result.next_cursor == 50);
+
+		// Set
+		std::set<uint64> set;
+		for(uint64 i=0; i<10; ++i)
+			set.insert(i * 10);
+
+		PageParams params;
+		params.descending = true;
+		params.page_size = 3;
+		params.cursor = "50";
+		keys.clear();
+		result = walkSetPage(set, params, /*filter=*/[&](const uint64& /*key*/) { return true; }, /*process=*/[&](const uint64& key) { keys.push_back(key); });
+		testAssert(keys == std::vector<uint64>({ 40, 30, 20 }));
+		testAssert(result.has_next_page && encodeCursor(result.next_cursor) == "20");
+
+		// Empty map
+		std::map<uint64, int> empty_map;
+		keys = walkTestMap(empty_map, /*descending=*/true, /*cursor=*/NULL, /*page size=*/10, MAX_NUM_SCANNED, /*only even=*/false, result);
+		testAssert(keys.empty() && !result.has_next_page);
+	}
+
+	conPrint("AdminPagination::test() done.");
+}
+
+
+#endif // BUILD_TESTS
@@ -0,0 +1,178 @@
+/*=====================================================================
+AdminPagination.h
+-----------------
+Copyright Glare Technologies Limited 2026 -
+=====================================================================*/
+#pragma once
+
+
+#include "../shared/UserID.h"
+#include "../shared/ParcelID.h"
+#include <maths/vec3.h>
+#include <Platform.h>
+#include <string>
+#include <iterator>
+
+
+namespace web
+{
+class RequestInfo;
+}
+
+
+/*=====================================================================
+AdminPagination
+---------------
+Cursor-based pagination for admin pages that list the entries of a map in
+the world state, such as users, parcels and orders.
+
+A page is made by walking the map from the cursor (the key of the last
+entry examined for the previous page), so the time the world state lock is
+held is proportional to the page size, not to the size of the map.
+Filtered pages examine at most max_num_scanned entries.  If the limit is
+reached, the page is cut short and its 'next page' link continues the scan.
+
+Handlers should copy the fields they display while holding the lock, and
+build the page HTML after releasing it.
+=====================================================================*/
+namespace AdminPagination
+{
+	static const size_t DEFAULT_PAGE_SIZE = 100;
+	static const size_t MAX_PAGE_SIZE = 1000;
+	static const size_t MAX_NUM_SCANNED = 20000;
+
+
+	struct PageParams
+	{
+		bool descending; // Walk the map in reverse key order.  Map keys are assigned in creation order, so this means newest first.
+		size_t page_size;
+		std::string cursor; // Encoded key of the last entry examined for the previous page, or empty for the first page.
+	};
+
+	// Reads the 'order' ('asc' or 'desc'), 'page_size' and 'cursor' URL params.  Missing or invalid params get default values.
+	PageParams parsePageParams(const web::RequestInfo& request, bool default_descending);
+
+
+	// Cursor encoding for the map key types used by admin pages.  decodeCursor() returns false if the string is not a valid encoding.
+	std::string encodeCursor(uint64 key);
+	std::string encodeCursor(const UserID& key);
+	std::string encodeCursor(const ParcelID& key);
+	std::string encodeCursor(const Vec3i& key);
+	std::string encodeCursor(const std::string& key);
+
+	bool decodeCursor(const std::string& s, uint64& key_out);
+	bool decodeCursor(const std::string& s, UserID& key_out);
+	bool decodeCursor(const std::string& s, ParcelID& key_out);
+	bool decodeCursor(const std::string& s, Vec3i& key_out);
+	bool decodeCursor(const std::string& s, std::string& key_out);
+
+
+	template <class Key>
+	struct PageResult
+	{
+		bool has_next_page;
+		Key next_cursor; // Key of the last entry examined.  Only valid if has_next_page is true.
+		size_t num_scanned;
+		size_t num_processed;
+	};
+
+
+	template <class Key, class Iterator, class GetKeyFunc, class FilterFunc, class ProcessFunc>
+	PageResult<Key> walkRange(Iterator it, Iterator end, size_t page_size, size_t max_num_scanned, GetKeyFunc get_key, FilterFunc filter, ProcessFunc process)
+	{
+		PageResult<Key> result;
+		result.has_next_page = false;
+		result.next_cursor = Key();
+		result.num_scanned = 0;
+		result.num_processed = 0;
+
+		for(; it != end; ++it)
+		{
+			if(result.num_processed >= page_size || result.num_scanned >= max_num_scanned)
+			{
+				result.has_next_page = true;
+				break;
+			}
+
+			result.num_scanned++;
+			result.next_cursor = get_key(*it);
+			if(filter(*it))
+			{
+				process(*it);
+				result.num_processed++;
+			}
+		}
+		return result;
+	}
+
+
+	// Walks a sorted container (std::map or std::set) from after cursor_key, if it is non-NULL.  filter and process are called with the container entries.
+	template <class ContainerType, class GetKeyFunc, class FilterFunc, class ProcessFunc>
+	PageResult<typename ContainerType::key_type> walkContainer(const ContainerType& container, bool descending, const typename ContainerType::key_type* cursor_key, size_t page_size, size_t max_num_scanned,
+		GetKeyFunc get_key, FilterFunc filter, ProcessFunc process)
+	{
+		typedef typename ContainerType::key_type Key;
+		if(descending)
+		{
+			auto begin = cursor_key ? std::make_reverse_iterator(container.lower_bound(*cursor_key)) : container.rbegin();
+			return walkRange<Key>(begin, container.rend(), page_size, max_num_scanned, get_key, filter, process);
+		}
+		else
+		{
+			auto begin = cursor_key ? container.upper_bound(*cursor_key) : container.begin();
+			return walkRange<Key>(begin, container.end(), page_size, max_num_scanned, get_key, filter, process);
+		}
+	}
+
+
+	// Calls process(key, value) for the first page_size entries of the map for which filter(key, value) returns true, in key order (or reverse key order if descending),
+	// starting after cursor_key if it is non-NULL.
+	template <class MapType, class FilterFunc, class ProcessFunc>
+	PageResult<typename MapType::key_type> walkPage(const MapType& map, bool descending, const typename MapType::key_type* cursor_key, size_t page_size, size_t max_num_scanned,
+		FilterFunc filter, ProcessFunc process)
+	{
+		typedef typename MapType::key_type Key;
+		typedef typename MapType::value_type Entry;
+		return walkContainer(map, descending, cursor_key, page_size, max_num_scanned,
+			/*get_key=*/[](const Entry& entry) -> const Key& { return entry.first; },
+			/*filter=*/[&](const Entry& entry) { return filter(entry.first, entry.second); },
+			/*process=*/[&](const Entry& entry) { process(entry.first, entry.second); }
+		);
+	}
+
+
+	// As above, with the order, page size and cursor from params.  An invalid cursor gives the first page.
+	template <class MapType, class FilterFunc, class ProcessFunc>
+	PageResult<typename MapType::key_type> walkPage(const MapType& map, const PageParams& params, FilterFunc filter, ProcessFunc process)
+	{
+		typename MapType::key_type cursor_key;
+		const bool have_cursor = !params.cursor.empty() && decodeCursor(params.cursor, cursor_key);
+		return walkPage(map, params.descending, have_cursor ? &cursor_key : NULL, params.page_size, MAX_NUM_SCANNED, filter, process);
+	}
+
+
+	// Pages through the keys of a set, such as a secondary index.  filter and process are called with the key.
+	template <class SetType, class FilterFunc, class ProcessFunc>
+	PageResult<typename SetType::key_type> walkSetPage(const SetType& set, const PageParams& params, FilterFunc filter, ProcessFunc process)
+	{
+		typedef typename SetType::key_type Key;
+		Key cursor_key;
+		const bool have_cursor = !params.cursor.empty() && decodeCursor(params.cursor, cursor_key);
+		return walkContainer(set, params.descending, have_cursor ? &cursor_key : NULL, params.page_size, MAX_NUM_SCANNED,
+			/*get_key=*/[](const Key& key) -> const Key& { return key; }, filter, process);
+	}
+
+
+	// Returns HTML for links to the first page in each order, and to the next page if next_cursor is non-empty.
+	// base_url is the page path plus any filter params, e.g. "/admin_orders?confirmed=1".
+	std::string makePageLinksForCursor(const std::string& base_url, const PageParams& params, const std::string& next_cursor, const std::string& asc_label, const std::string& desc_label);
+
+	template <class Key>
+	std::string makePageLinks(const std::string& base_url, const PageParams& params, const PageResult<Key>& result, const std::string& asc_label, const std::string& desc_label)
+	{
+		return makePageLinksForCursor(base_url, params, result.has_next_page ? encodeCursor(result.next_cursor) : std::string(), asc_label, desc_label);
+	}
+
+
+	void test();
+}
@@ -27,6 +27,7 @@ Copyright Glare Technologies Limited 2026 -
 #include <BitUtils.h>
 #include <Clock.h>
 #include <Parser.h>
+#include <FileUtils.h>
 #include <cmath>
 
 
@@ -314,7 +315,7 @@ static void markLODChunkNeedsRebuild(ServerWorldState* world, const WorldObject*
 // Enforce object-count limits on MCP-created objects, to stop an agent from filling up a world or parcel.  God users are
 // exempt (consistent with permission checks).  Throws glare::Exception if a limit would be exceeded.
 // NOTE: the world state mutex must be held.
-static void checkObjectCountLimits(const WorldObject& ob, const std::string& world_name, ServerWorldState& world, const UserID acting_user_id, WorldStateLock& lock)
+static void checkObjectCountLimits(const WorldObject& ob, ServerAllWorldsState& all_worlds, const std::string& world_name, ServerWorldState& world, const UserID acting_user_id, WorldStateLock& lock)
 {
 	if(isGodUser(acting_user_id))
 		return;
@@ -324,28 +325,12 @@ static void checkObjectCountLimits(const WorldObject& ob, const std::string& wor
 	if(!world_name.empty() && (world.getObjects(lock).size() >= MCP_MAX_OBJECTS_PER_WORLD))
 		throw glare::Exception("World object limit reached (" + toString(MCP_MAX_OBJECTS_PER_WORLD) + " objects); cannot create more objects in this world.");
 
-	// Per-parcel limit: if the new object lies within a parcel, cap the number of (live) objects in that parcel.  There is
-	// no per-parcel object index, so we count by scanning the world's objects - acceptable at the (rate-limited) frequency
-	// of MCP object creation.
-	const Vec4f ob_pos = ob.pos.toVec4fPoint();
-	const Parcel* target_parcel = NULL;
-	for(auto it = world.getParcels(lock).begin(); it != world.getParcels(lock).end(); ++it)
-		if(it->second->pointInParcel(ob_pos))
-		{
-			target_parcel = it->second.ptr();
-			break;
-		}
-
+	// Per-parcel limit: if the new object lies within a parcel, cap the number of (live) objects in that parcel.  Uses the
+	// world's object accounting index for the count.
+	const Parcel* target_parcel = ObjectAccountingIndex::findParcelContainingPoint(world.getParcels(lock), ob.pos);
 	if(target_parcel)
 	{
-		size_t num_in_parcel = 0;
-		for(auto it = world.getObjects(lock).begin(); it != world.getObjects(lock).end(); ++it)
-		{
-			const WorldObject* other = it->second.ptr();
-			if((other->state != WorldObject::State_Dead) && target_parcel->pointInParcel(other->pos.toVec4fPoint()))
-				num_in_parcel++;
-		}
-
+		const size_t num_in_parcel = world.getObjectAccountingIndex(all_worlds.model_URL_to_stats, lock).getNumObjectsInParcel(target_parcel->id);
 		if(num_in_parcel >= MCP_MAX_OBJECTS_PER_PARCEL)
 			throw glare::Exception("Parcel object limit reached (" + toString(MCP_MAX_OBJECTS_PER_PARCEL) + " objects); cannot create more objects in this parcel.");
 	}
@@ -370,7 +355,7 @@ static const std::string createObjectInWorld(ServerAllWorldsState& all_worlds, c
 	if(!userHasObjectCreationPermissionsForAABB(ob->getAABBWS(), acting_user_id, *world, lock))
 		throw glare::Exception("Permission denied: cannot create an object here.  The object bounds must be entirely inside a parcel you have write permissions for.");
 
-	checkObjectCountLimits(*ob, world_name, *world, acting_user_id, lock);
+	checkObjectCountLimits(*ob, all_worlds, world_name, *world, acting_user_id, lock);
 
 	ob->creator_id = acting_user_id;
 	ob->created_time = TimeStamp::currentTime();
@@ -382,6 +367,7 @@ static const std::string createObjectInWorld(ServerAllWorldsState& all_worlds, c
 	world->addWorldObjectAsDBDirty(ob, lock);
 	world->getDirtyFromRemoteObjects(lock).insert(ob);
 	world->getObjects(lock).insert(std::make_pair(ob->uid, ob));
+	world->updateObjectAccounting(*ob, all_worlds.model_URL_to_stats, lock);
 
 	markLODChunkNeedsRebuild(world, ob.ptr(), lock);
 	all_worlds.markAsChanged();
@@ -424,10 +410,15 @@ static const std::string tool_createObject(ServerAllWorldsState& all_worlds, con
 					
 				aabb_os = batched_mesh->aabb_os;
 
-				// Insert into AABB cache:
+				ObjectModelStats model_stats;
+				model_stats.num_triangles = batched_mesh->numIndices() / 3;
+				model_stats.file_size_B = FileUtils::getFileSize(model_abs_path);
+
+				// Insert into AABB and model stats caches:
 				{
 					WorldStateLock lock(all_worlds.mutex);
 					all_worlds.mesh_URL_to_aabb_os.insert(std::make_pair(model_URL, aabb_os));
+					all_worlds.model_URL_to_stats[model_URL] = model_stats;
 				}
 			}
 		}
@@ -32,6 +32,7 @@ Copyright Glare Technologies Limited 2021 -
 #include "ParcelHandlers.h"
 #include "../server/WorkerThread.h"
 #include "../server/Server.h"
+#include "../server/ServerProfiler.h"
 #include <StringUtils.h>
 #include <Parser.h>
 #include <MemMappedFile.h>
@@ -71,6 +72,8 @@ WebServerRequestHandler::~WebServerRequestHandler()
 
 void WebServerRequestHandler::handleRequest(const web::RequestInfo& request, web::ReplyInfo& reply_info)
 {
+	SERVER_PROFILE_ZONE("WebServerRequestHandler::handleRequest");
+
 	if(!request.tls_connection)
 	{
 		// Redirect to https (unless the server is running on localhost, which we will allow to use non-https for testing)
@@ -234,6 +237,10 @@ void WebServerRequestHandler::handleRequest(const web::RequestInfo& request, web
 		{
 			AdminHandlers::handleForceDynTexUpdatePost(*this->world_state, request, reply_info);
 		}
+		else if(request.path == "/admin_start_trace_capture_post")
+		{
+			AdminHandlers::handleStartTraceCapturePost(*this->world_state, request, reply_info);
+		}
 		else if(request.path == "/admin_delete_transaction_post")
 		{
 			AdminHandlers::handleDeleteTransactionPost(*this->world_state, request, reply_info);
@@ -517,6 +524,10 @@ void WebServerRequestHandler::handleRequest(const web::RequestInfo& request, web
 		{
 			AdminHandlers::renderAdminLODChunksPage(*this->world_state, request, reply_info);
 		}
+		else if(request.path == "/metrics")
+		{
+			AdminHandlers::renderMetricsPage(*this->world_state, request, reply_info);
+		}
 		else if(request.path == "/admin_worlds")
 		{
 			AdminHandlers::renderAdminWorldsPage(*this->world_state, request, reply_info);